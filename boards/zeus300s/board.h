@@ -47,6 +47,15 @@
 #define BOARD_GOWIN_USART              USART1
 #endif
 
+/**< Debug (logger) UART Settings */
+#ifndef BOARD_LOGGER_FLEXCOMM_IRQ
+#define BOARD_LOGGER_FLEXCOMM_IRQ      FLEXCOMM3_IRQHandler
+#endif
+
+#ifndef BOARD_LOGGER_FLEXCOMM_IRQN
+#define BOARD_LOGGER_FLEXCOMM_IRQN     FLEXCOMM3_IRQn
+#endif
+
 /**< I2C Settings to MainCPU */
 #ifndef BOARD_I2C_MAINCPU_FLEXCOMM_IRQ
 #define BOARD_I2C_MAINCPU_FLEXCOMM_IRQ FLEXCOMM4_IRQHandler
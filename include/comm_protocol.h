@@ -61,10 +61,12 @@ typedef enum __attribute__((__packed__)) {      // !< Force enum to be packed to
     COMMP_CMD_SET_SPI1,                     // !< select spi1 for readback
     COMMP_CMD_SET_ROM0,                     // !< select rom0
     COMMP_CMD_SET_ROM1,                     // !< select rom1
+    COMMP_CMD_VERINFO,                      // !< version and git version, COMMP_CMD_VERSION_SEPERATOR between
     COMMP_NR_OF_COMMANDS                    // !< Number of commands
 } comm_proto_cmd_t;
 
 #define COMMP_CMD_ERROR           -1
+#define COMMP_CMD_VERSION_SEPERATOR "*" // !< between version and git version of COMMP_CMD_VERINFO
 
 typedef enum __attribute__((__packed__)) {      // !< Force enum to be packed to 1 byte
     COMMP_ERR_SEQ = 0x1,                    // !< Sequence error, packet not what expected
@@ -1,6 +1,7 @@
 #ifndef _GPMCU_CRC_H_
 #define _GPMCU_CRC_H_
 
+#ifndef UNIT_TEST
 #include "fsl_crc.h"
 #include "peripherals.h"
 
@@ -12,5 +13,21 @@ static inline uint32_t crc_run_crc32(uint8_t * buffer, size_t size) {
     CRCEngine_init(CRC_ENGINE, 0xFFFFFFFFU);
     return checksum32;
 }
+#else
+#include <stddef.h>
+#include <stdint.h>
+
+// native: bitwise CRC-32, same setup as CRCEngine_init (reflected, seed 0xFFFFFFFF, complemented out)
+static inline uint32_t crc_run_crc32(uint8_t * buffer, size_t size) {
+    uint32_t crc = 0xFFFFFFFFU;
+
+    while (size--) {
+        crc ^= *buffer++;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+    return ~crc;
+}
+#endif
 
 #endif /* _GPMCU_CRC_H_ */
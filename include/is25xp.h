@@ -14,6 +14,8 @@
 
 #include <sys/types.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 /*******************************************************************************
  * Pre-processor Definitions
@@ -32,10 +34,13 @@
 #define CONFIG_IS25XP_SPIMODE       SPIDEV_MODE0
 #endif
 
-/* SPI Frequency.  May be up to 50MHz. */
+/* SPI Frequency.  The HS SPI (FLEXCOMM8) goes up to 50MHz, the limit of a
+ * standard READ (0x03) as well: the reads use FAST_READ (0x0b, one dummy
+ * byte, up to 133MHz), the other instructions go up to 133MHz too.
+ */
 
 #ifndef CONFIG_IS25XP_SPIFREQUENCY
-#define CONFIG_IS25XP_SPIFREQUENCY  20000000
+#define CONFIG_IS25XP_SPIFREQUENCY  50000000
 #endif
 
 /* IS25 Registers *************************************************************/
@@ -67,6 +72,7 @@
 #define IS25_IS25LP128_PAGE_SHIFT   8       /* Page size 1 << 8 = 256 */
 #define IS25_IS25LP128_NPAGES       65536
 #define IS25_IS25XP_BYTES_PER_PAGE  256
+#define IS25_FAST_READ_HEADER       5 // !< instruction, 3 address bytes, dummy byte
 
 /* Instructions */
 /*      Command        Value      N Description             Addr Dummy  Data  */
@@ -176,11 +182,82 @@ int is25xp_erase(off_t startblock, size_t nblocks);
 
 ssize_t is25xp_bread(off_t startblock, size_t nblocks, uint8_t * buffer, uint8_t verbose);
 ssize_t is25xp_bwrite(off_t startblock, size_t nblocks, uint8_t * buf, uint8_t verbose);
+/*
+ * @brief is25xp_read
+ * FAST_READ of any length, received straight into buffer
+ * @return nbytes
+ */
 ssize_t is25xp_read(off_t offset, size_t nbytes, uint8_t * buffer, uint8_t verbose);
+
+/*
+ * @brief is25xp_read_throughput
+ * Logs the MB/s of an is25xp_read of nbytes (DWT cycle counter)
+ * @return kB/s, 0 on an error
+ */
+uint32_t is25xp_read_throughput(off_t offset, size_t nbytes, uint8_t * buffer);
 #ifdef CONFIG_MTD_BYTE_WRITE
 ssize_t is25xp_write(off_t offset, size_t nbytes, const uint8_t * buffer);
 #endif
 void is25xp_ReleasePowerDownGetDeviceID();
 void is25xp_PowerDown();
 
+/* Non-blocking operations ****************************************************/
+/* One operation at a time: the page program and read data go over the SPI8
+ * interrupt transfer (SPI_MasterTransferNonBlocking), an erase only sends its
+ * 4 byte command. The caller polls is25xp_busy() instead of waiting for the
+ * write cycle. The blocking functions above wait for a transfer in flight.
+ */
+
+/*
+ * @brief is25xp_async_init
+ * Create the SPI8 transfer handle, the board's FLEXCOMM8 interrupt handler
+ * must call is25xp_irqhandler()
+ * @param done - called from the interrupt when a transfer completed, NULL for none
+ */
+void is25xp_async_init(void (*done)(void));
+void is25xp_irqhandler(void);
+
+/*
+ * @brief is25xp_async_ready
+ * @return true once is25xp_async_init created the transfer handle (not in the
+ * bootloader): the non-blocking operations can be used
+ */
+bool is25xp_async_ready(void);
+
+/*
+ * @brief is25xp_busy
+ * A transfer in flight or the write cycle of a program/erase (one RDSR)
+ * @return true while busy, nothing can be started
+ */
+bool is25xp_busy(void);
+
+/*
+ * @brief is25xp_transfer_done
+ * @return true when no transfer is in flight, the read data is in the buffer
+ */
+bool is25xp_transfer_done(void);
+
+/*
+ * @brief is25xp_erase_start
+ * Start a sector/block erase (IS25_SE, IS25_SE_, IS25_BE32, IS25_BE64) or the
+ * chip erase (IS25_CER, sector ignored)
+ * @return 0: started, -EBUSY: the flash is busy
+ */
+int is25xp_erase_start(off_t sector, uint8_t type);
+
+/*
+ * @brief is25xp_pagewrite_start
+ * Start a page program, the data is copied
+ * @return 0: started, -EBUSY: the flash is busy
+ */
+int is25xp_pagewrite_start(const uint8_t * buffer, off_t page);
+
+/*
+ * @brief is25xp_read_start
+ * Start a FAST_READ of nbytes (any length), the data lands in buffer once
+ * is25xp_transfer_done(): the buffer must stay valid until then
+ * @return 0: started, -EBUSY: the flash is busy, -EINVAL: nothing to read
+ */
+int is25xp_read_start(off_t offset, size_t nbytes, uint8_t * buffer);
+
 #endif // __SPI_IS25XP_H__
\ No newline at end of file
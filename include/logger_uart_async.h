@@ -0,0 +1,38 @@
+/**
+ * @file logger_uart_async.h
+ * @brief  Non-blocking UART driver for logger
+ *
+ * Log lines are formatted into a fixed-size ring and drained by the logger
+ * UART's TX FIFO interrupt, a LOG_* call never waits for the transmission.
+ * Writing is lock-free and allowed from interrupt context.
+ *
+ * @version v0.1
+ * @date 2022-09-26
+ */
+
+#ifndef _LOGGER_UART_ASYNC_H_
+#define _LOGGER_UART_ASYNC_H_
+
+#include <stdint.h>
+
+#ifndef LOGGER_UART_ASYNC_SIZE
+#define LOGGER_UART_ASYNC_SIZE       2048   // !< Ring size in bytes, power of 2
+#endif
+
+#define LOGGER_UART_DROP_NEWEST      0      // !< Full: discard the new line
+#define LOGGER_UART_DROP_OLDEST      1      // !< Full: discard the oldest pending lines
+
+#ifndef LOGGER_UART_ASYNC_POLICY
+#define LOGGER_UART_ASYNC_POLICY     LOGGER_UART_DROP_NEWEST
+#endif
+
+#if (LOGGER_UART_ASYNC_SIZE & (LOGGER_UART_ASYNC_SIZE - 1)) != 0
+#error "LOGGER_UART_ASYNC_SIZE must be a power of 2"
+#endif
+
+/**
+ * @brief  Number of log lines dropped since boot because the ring was full
+ */
+uint32_t logger_uart_async_dropped(void);
+
+#endif /* _LOGGER_UART_ASYNC_H_ */
@@ -40,6 +40,10 @@ extern uint32_t __ssram_log_start__;    // !< Start of Shared SRAM
 extern uint32_t __ssram_log_size__;     // !< Size of Shared SRAM
 extern uint32_t __ssram_log_end__;      // !< End of Shared SRAM
 
+// !< Span tracer ring (tracer.h), end of the shared region right before the log
+#define SSRAM_TRACE_SIZE  0x1C00U
+#define SSRAM_TRACE_START ((void *)((uint8_t *)&__ssram_log_start__ - SSRAM_TRACE_SIZE))
+
 // extern uint32_t __wflash_size__;
 
 extern uint32_t _stext;                 // !< Start of text segment
@@ -83,10 +87,12 @@ struct ssram_data_t {
  */
 static inline void jump_to(__maybe_unused uint32_t pc,
                            __maybe_unused uint32_t sp) {
+#ifdef __arm__
     __asm(
         "           \n\
             msr msp, r1 /* load r1 into MSP */\n\
             bx r0       /* branch to the address at r0 */\n"    );
+#endif
 }
 
 /**
@@ -96,8 +102,13 @@ static inline void jump_to(__maybe_unused uint32_t pc,
 static inline uint32_t get_pc_reg() {
     uint32_t pcReg;
 
+#ifdef __arm__
     // The Program Counter (PC) is register R15 in arm cortex0 assembly
     __asm("mov %[pcReg], r15;" :[pcReg] "=r" (pcReg));
+#else
+    // native build (tests/native): runs from the first partition
+    pcReg = (uint32_t)(uintptr_t)&__approm0_start__;
+#endif
     return(pcReg);
 }
 
@@ -0,0 +1,86 @@
+/**
+ * @file spi_cache.h
+ * @brief  LRU read cache of spi flash pages
+ *
+ * SPI_CACHE_PAGES pages of 256 bytes in front of is25xp_read, shared by the
+ * storage layer (storage_spi_flash.c) and the application 0x61 readback
+ * (spi_master.c). Pages are dropped on a page program or an erase, not
+ * written through: a program only clears bits of what the flash holds.
+ *
+ * Reads up to one page fill the cache, longer reads (partition crc,
+ * spi_update verify) are served from it but read their misses straight
+ * from the flash, a scan does not evict the pages read over and over
+ * (partition contexts, 0x61 readback).
+ *
+ * Not for interrupt context. An asynchronous read fills its page with the
+ * epoch of its start: an invalidation in between discards it.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _SPI_CACHE_H_
+#define _SPI_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifndef SPI_CACHE_PAGES
+#define SPI_CACHE_PAGES      16     // !< cached pages, override with -DSPI_CACHE_PAGES=n
+#endif
+#define SPI_CACHE_PAGE_SHIFT 8
+#define SPI_CACHE_PAGE_SIZE  (1U << SPI_CACHE_PAGE_SHIFT)
+
+/**
+ * @brief  Statistics since spi_cache_init, free running u32's
+ */
+struct spi_cache_stats_t {
+    uint32_t hits;              // !< pages served from the cache
+    uint32_t misses;            // !< pages read from the flash
+    uint32_t invalidated;       // !< cached pages dropped by a program/erase
+};
+
+/**
+ * @brief  Empty the cache, restart the statistics
+ *
+ * @param count called per page looked up (PerfCounters), NULL: none
+ */
+void spi_cache_init(void (*count)(bool hit));
+
+/**
+ * @brief  is25xp_read through the cache
+ *
+ * @returns nbytes or the is25xp_read error
+ */
+ssize_t spi_cache_read(off_t offset, size_t nbytes, uint8_t * buffer);
+
+/**
+ * @brief  Cached page, counted as hit or miss
+ *
+ * @returns the page data or NULL, valid until the next cache call
+ */
+const uint8_t * spi_cache_lookup(uint32_t page);
+
+/**
+ * @brief  Epoch of a read started asynchronously, for spi_cache_fill
+ */
+uint32_t spi_cache_epoch(void);
+
+/**
+ * @brief  Add a page read asynchronously, ignored after an invalidation
+ *         since epoch
+ */
+void spi_cache_fill(uint32_t page, const uint8_t * data, uint32_t epoch);
+
+/**
+ * @brief  Drop the pages [page, page + pages) on a program or an erase
+ */
+void spi_cache_invalidate(uint32_t page, uint32_t pages);
+
+/**
+ * @brief  The statistics counted since spi_cache_init
+ */
+const struct spi_cache_stats_t * spi_cache_stats(void);
+
+#endif /* _SPI_CACHE_H_ */
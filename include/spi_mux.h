@@ -0,0 +1,118 @@
+/**
+ * @file spi_mux.h
+ * @brief  Lease arbiter of the spi flash mux (GP <-> Gowin)
+ *
+ * The spi flash is shared with the Gowin FPGA, which loads its bitfile from
+ * it. A client leases the bus for a batch of operations instead of switching
+ * the mux around every is25xp call: the mux goes to the GP on the first
+ * lease and stays there across consecutive leases. It goes back to the
+ * Gowin once no lease was held for SPI_MUX_IDLE_US (spi_mux_poll) or right
+ * away when the FPGA needs its flash (spi_mux_fpga_request, a reconfigure).
+ *
+ * While the FPGA loads (power-up, after a reconfigure) a lease waits for its
+ * READY signal, at most for the timeout of the lease and never longer than
+ * SPI_MUX_FPGA_LOAD_US: an FPGA without bitfile does not block the updates.
+ *
+ * Leases are counted per client and may nest. Not for interrupt context.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _SPI_MUX_H_
+#define _SPI_MUX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef SPI_MUX_IDLE_US
+#define SPI_MUX_IDLE_US        2000    // !< no lease this long: back to the Gowin
+#endif
+#define SPI_MUX_FPGA_LOAD_US   1000000 // !< max bitfile load time of the Gowin
+#define SPI_MUX_TIMEOUT_US     100000  // !< blocking users (storage_spi_flash)
+
+/**
+ * @brief  Clients of the mux, one lease count each
+ */
+typedef enum {
+    SPI_MUX_CLIENT_QUEUE = 0,   // !< spi_master.c message queue (application)
+    SPI_MUX_CLIENT_STORAGE,     // !< storage_spi_flash.c (spi_update, i2c_stream, bootloader)
+    SPI_MUX_CLIENT_NUM
+} spi_mux_client_t;
+
+/**
+ * @brief  Statistics since spi_mux_init, free running u32's
+ */
+struct spi_mux_stats_t {
+    uint32_t switches;          // !< mux switched to the GP
+    uint32_t leases;            // !< leases granted
+    uint32_t hold_max_us;       // !< worst-case time the GP held the bus
+    uint32_t timeouts;          // !< leases refused, FPGA still loading
+    uint32_t revoked;           // !< leases taken back for the FPGA
+};
+
+/**
+ * @brief  Events of the statistics, for a counter of the caller
+ */
+typedef enum {
+    SPI_MUX_EV_SWITCH = 0,      // !< switched to the GP
+    SPI_MUX_EV_LEASE,           // !< lease granted
+    SPI_MUX_EV_HOLD,            // !< back to the Gowin, value: held (us)
+    SPI_MUX_EV_TIMEOUT,         // !< lease refused
+    SPI_MUX_EV_REVOKE,          // !< leases taken back
+} spi_mux_event_t;
+
+/**
+ * @brief  Start the arbiter, the FPGA is assumed loading
+ *
+ * @param event called on every statistics event (PerfCounters), NULL: none
+ * @param cycles_per_us core clock (DWT cycle counter) in MHz
+ */
+void spi_mux_init(void (*event)(spi_mux_event_t ev, uint32_t value), uint32_t cycles_per_us);
+
+/**
+ * @brief  Lease the bus, selects the GP if not yet
+ *
+ * @param client the lease holder
+ * @param timeout_us max wait for an FPGA loading its bitfile, 0: don't wait
+ *
+ * @returns false on a timeout, the caller must not access the flash
+ */
+bool spi_mux_acquire(spi_mux_client_t client, uint32_t timeout_us);
+
+/**
+ * @brief  End a lease, the mux stays on the GP until idle
+ */
+void spi_mux_release(spi_mux_client_t client);
+
+/**
+ * @brief  Give the bus back to the Gowin after SPI_MUX_IDLE_US without lease,
+ *         end the FPGA load window. Call it regularly, also without leases:
+ *         the window is timed on the wrapping 32bit DWT cycle counter
+ *
+ * @returns true while the GP still has the bus
+ */
+bool spi_mux_poll(void);
+
+/**
+ * @brief  Give the bus back to the Gowin now, the leases are revoked
+ */
+void spi_mux_reset(void);
+
+/**
+ * @brief  The FPGA needs its flash (about to be reconfigured): give the bus
+ *         back now and hold new leases until it is READY
+ */
+void spi_mux_fpga_request(void);
+
+/**
+ * @brief  Lease count of a client
+ */
+uint8_t spi_mux_held(spi_mux_client_t client);
+
+/**
+ * @brief  The statistics counted since spi_mux_init
+ */
+const struct spi_mux_stats_t * spi_mux_stats(void);
+
+#endif /* _SPI_MUX_H_ */
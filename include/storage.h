@@ -9,9 +9,21 @@
 #ifndef _GPMCU_STORAGE_H_
 #define _GPMCU_STORAGE_H_
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 struct storage_driver_t;
+struct storage_req_t;
+
+/**
+ * @brief  One buffer of a scatter-gather list
+ */
+struct storage_iovec_t {
+    uint8_t * base;             // !< Buffer
+    size_t len;                 // !< Length of the buffer
+};
 
 /** storage init typedef */
 typedef int (* storage_init)(struct storage_driver_t * sdriver);
@@ -28,14 +40,34 @@ typedef int (* storage_erase)(struct storage_driver_t * sdriver);
 /** storage flush typedef */
 typedef int (* storage_flush)(struct storage_driver_t * sdriver);
 
-/** storage flush typedef */
-typedef uint32_t (* storage_crc)(struct storage_driver_t * sdriver);
+/** storage crc typedef: len bytes from the area start, 0 for the whole area */
+typedef uint32_t (* storage_crc)(struct storage_driver_t * sdriver, size_t len);
 
 /** storage close typedef */
 typedef int (* storage_close)(struct storage_driver_t * sdriver);
 
+/** storage positional read typedef: offset in the current area, buffers filled in order */
+typedef int (* storage_preadv)(struct storage_driver_t * sdriver, uint32_t offset,
+                               const struct storage_iovec_t * iov, int iovcnt);
+
+/** storage positional write typedef: offset in the current area, buffers written in order */
+typedef int (* storage_pwritev)(struct storage_driver_t * sdriver, uint32_t offset,
+                                const struct storage_iovec_t * iov, int iovcnt);
+
+/** storage submit typedef: queue a request, completed by storage_poll_requests */
+typedef int (* storage_submit)(struct storage_driver_t * sdriver, struct storage_req_t * req);
+
+/** storage poll typedef: progress the queued requests */
+typedef int (* storage_poll)(struct storage_driver_t * sdriver);
+
 /**
  * @brief  Storage ops structure
+ *
+ * read/write/erase/flush/crc work on the current area at its cursor (the
+ * area's offset). The v2 calls take the offset in the current area instead
+ * and leave the cursor alone: preadv/pwritev block until done, submit/poll
+ * overlap the transfer with the caller (NULL: storage_submit_request runs
+ * the request through preadv/pwritev).
  */
 struct storage_ops_t {
     storage_init init;          // !< Init fn pointer
@@ -45,6 +77,38 @@ struct storage_ops_t {
     storage_flush flush;        // !< Flush fn pointer
     storage_crc crc;              // !< CRC fn pointer
     storage_close close;        // !< Close fn pointer
+    storage_preadv preadv;      // !< Positional read fn pointer
+    storage_pwritev pwritev;    // !< Positional write fn pointer
+    storage_submit submit;      // !< Asynchronous submit fn pointer, optional
+    storage_poll poll;          // !< Asynchronous poll fn pointer, optional
+};
+
+/**
+ * @brief  Storage request type
+ */
+typedef enum {
+    STORAGE_REQ_READ,           // !< preadv
+    STORAGE_REQ_WRITE,          // !< pwritev
+} storage_req_op_t;
+
+/**
+ * @brief  Asynchronous storage request, owned by the driver from
+ *         storage_submit_request until it completes: the request and its
+ *         buffers must stay valid until then
+ */
+struct storage_req_t {
+    storage_req_op_t op;                        // !< Read or write
+    uint32_t offset;                            // !< Offset in the area
+    const struct storage_iovec_t * iov;         // !< Buffers
+    int iovcnt;                                 // !< Number of buffers
+    void (* done)(struct storage_req_t * req);  // !< Called on completion, NULL for none
+    void * ctx;                                 // !< Caller's data
+
+    volatile bool busy;                         // !< Submitted, not completed
+    int result;                                 // !< Bytes transferred or -1, once completed
+
+    void * area;                                // !< Driver: the area at submit
+    struct storage_req_t * next;                // !< Driver: queue
 };
 
 /**
@@ -171,14 +235,14 @@ static inline int storage_erase_storage(struct storage_driver_t * driver) {
  * @returns crc or -1 if failed
  */
 static inline uint32_t storage_crc_storage(struct storage_driver_t * driver,
-                                           __attribute__((unused)) size_t len) {
+                                           size_t len) {
     if (!driver) {
         return 0;
     }
     if (!driver->ops || !driver->ops->crc) {
         return 0;
     }
-    return driver->ops->crc(driver);
+    return driver->ops->crc(driver, len);
 }
 
 /**
@@ -198,4 +262,196 @@ static inline int storage_close_storage(struct storage_driver_t * driver) {
     return driver->ops->close(driver);
 }
 
+/**
+ * @brief Total length of a scatter-gather list
+ */
+static inline size_t storage_iov_length(const struct storage_iovec_t * iov,
+                                        int iovcnt) {
+    size_t len = 0;
+
+    for (int i = 0; i < iovcnt; i++) {
+        len += iov[i].len;
+    }
+    return len;
+}
+
+/**
+ * @brief Byte 'from' of a scatter-gather list
+ *
+ * @param avail The contiguous bytes from there, in that buffer
+ *
+ * @returns  Pointer into the buffer, NULL past the end
+ */
+static inline uint8_t * storage_iov_at(const struct storage_iovec_t * iov,
+                                       int iovcnt,
+                                       size_t from,
+                                       size_t * avail) {
+    for (int i = 0; i < iovcnt; i++) {
+        if (from < iov[i].len) {
+            *avail = iov[i].len - from;
+            return iov[i].base + from;
+        }
+        from -= iov[i].len;
+    }
+    *avail = 0;
+    return NULL;
+}
+
+/**
+ * @brief Gather len bytes from byte 'from' of a scatter-gather list
+ *
+ * @returns  The bytes copied, less past the end
+ */
+static inline size_t storage_iov_copy(const struct storage_iovec_t * iov,
+                                      int iovcnt,
+                                      size_t from,
+                                      uint8_t * dst,
+                                      size_t len) {
+    size_t copied = 0;
+
+    while (copied < len) {
+        size_t avail;
+        const uint8_t * src = storage_iov_at(iov, iovcnt, from + copied, &avail);
+
+        if (!src) {
+            break;
+        }
+        if (avail > len - copied) {
+            avail = len - copied;
+        }
+        memcpy(&dst[copied], src, avail);
+        copied += avail;
+    }
+    return copied;
+}
+
+/**
+ * @brief Read into a scatter-gather list at an offset of the current area
+ *
+ * @param driver The driver from which we'll read
+ * @param offset Offset in the area, the cursor is not used nor moved
+ * @param iov Buffers filled in order
+ * @param iovcnt Number of buffers
+ *
+ * @returns The length read or -1 if failed
+ */
+static inline int storage_preadv_data(struct storage_driver_t * driver,
+                                      uint32_t offset,
+                                      const struct storage_iovec_t * iov,
+                                      int iovcnt) {
+    if (!driver || !iov || (iovcnt < 0)) {
+        return -1;
+    }
+    if (!driver->ops || !driver->ops->preadv) {
+        return -1;
+    }
+    return driver->ops->preadv(driver, offset, iov, iovcnt);
+}
+
+/**
+ * @brief Write a scatter-gather list at an offset of the current area
+ *
+ * @param driver The driver to which we'll write
+ * @param offset Offset in the area, the cursor is not used nor moved
+ * @param iov Buffers written in order
+ * @param iovcnt Number of buffers
+ *
+ * @returns The length written or -1 if failed
+ */
+static inline int storage_pwritev_data(struct storage_driver_t * driver,
+                                       uint32_t offset,
+                                       const struct storage_iovec_t * iov,
+                                       int iovcnt) {
+    if (!driver || !iov || (iovcnt < 0)) {
+        return -1;
+    }
+    if (!driver->ops || !driver->ops->pwritev) {
+        return -1;
+    }
+    return driver->ops->pwritev(driver, offset, iov, iovcnt);
+}
+
+/**
+ * @brief Read at an offset of the current area
+ *
+ * @returns The length read or -1 if failed
+ */
+static inline int storage_pread_data(struct storage_driver_t * driver,
+                                     uint32_t offset,
+                                     uint8_t * data,
+                                     size_t len) {
+    const struct storage_iovec_t iov = { data, len };
+
+    return storage_preadv_data(driver, offset, &iov, 1);
+}
+
+/**
+ * @brief Write at an offset of the current area
+ *
+ * @returns The length written or -1 if failed
+ */
+static inline int storage_pwrite_data(struct storage_driver_t * driver,
+                                      uint32_t offset,
+                                      const uint8_t * data,
+                                      size_t len) {
+    const struct storage_iovec_t iov = { (uint8_t *)data, len };
+
+    return storage_pwritev_data(driver, offset, &iov, 1);
+}
+
+/**
+ * @brief Submit an asynchronous request on the current area
+ *
+ * Drivers without asynchronous transfers run it right away: it is
+ * completed (and req->done called) when this returns.
+ *
+ * @param driver The driver that will run the request
+ * @param req The request, req->busy until completed
+ *
+ * @returns 0 or -1 if failed (not submitted)
+ */
+static inline int storage_submit_request(struct storage_driver_t * driver,
+                                         struct storage_req_t * req) {
+    if (!driver || !req || req->busy) {
+        return -1;
+    }
+    if (!driver->ops) {
+        return -1;
+    }
+    req->busy = true;
+    req->result = -1;
+    if (driver->ops->submit) {
+        if (driver->ops->submit(driver, req) < 0) {
+            req->busy = false;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (req->op == STORAGE_REQ_READ) {
+        req->result = storage_preadv_data(driver, req->offset, req->iov, req->iovcnt);
+    } else {
+        req->result = storage_pwritev_data(driver, req->offset, req->iov, req->iovcnt);
+    }
+    req->busy = false;
+    if (req->done) {
+        req->done(req);
+    }
+    return 0;
+}
+
+/**
+ * @brief Progress the submitted requests of a driver, from the main loop
+ *
+ * @param driver The driver of the requests
+ *
+ * @returns The number of requests completed by this call
+ */
+static inline int storage_poll_requests(struct storage_driver_t * driver) {
+    if (!driver || !driver->ops || !driver->ops->poll) {
+        return 0;
+    }
+    return driver->ops->poll(driver);
+}
+
 #endif /* _GPMCU_STORAGE_H_ */
@@ -1,25 +1,217 @@
 package main
 
+// Decodes a RAM dump of the shared SRAM log region (see src/bootloader/README.md).
+//
+//	go run process_memlog.go                         text log (logger_mem.c) from out.bin
+//	go run process_memlog.go -elf app-flash0.elf     tokenized log (logger-tok.c)
+//	go run process_memlog.go -tok app-flash0.logtok  tokenized log, token table only
+//
+// The tokenized log only holds format-string tokens and raw arguments, the
+// text is rebuilt here from the `logtok` section of the image. With -elf also
+// '%s' arguments pointing into the image get resolved.
+
 import (
-	"io/ioutil"
-	"fmt"
+	"debug/elf"
 	"encoding/binary"
+	"flag"
+	"fmt"
+	"io/ioutil"
 	"log"
+	"strings"
 )
 
 const LINE_LEN = 128
 
-func main() {
-	memBytes, err := ioutil.ReadFile("out.bin")
-	if err != nil {
-		log.Fatal("File not found")
+const (
+	TOK_MAGIC   = 0x4B4F544C // "LTOK"
+	TOK_PAD     = 0xFFFFFFFF
+	TOK_HDR_LEN = 32 // struct logger_tok_ring_t
+)
+
+var levels = []string{"DEBUG", "INFO", "OKAY", "WARN", "ERROR", "RAW"}
+
+type image struct {
+	tokens   []byte
+	sections []*elf.Section
+}
+
+func loadImage(elfName string, tokName string) *image {
+	img := &image{}
+	if elfName != "" {
+		f, err := elf.Open(elfName)
+		if err != nil {
+			log.Fatal("Failed to open elf: ", err)
+		}
+		for _, s := range f.Sections {
+			if s.Flags&elf.SHF_ALLOC != 0 && s.Type == elf.SHT_PROGBITS {
+				img.sections = append(img.sections, s)
+			}
+		}
+		if s := f.Section("logtok"); s != nil {
+			img.tokens, _ = s.Data()
+		}
 	}
+	if tokName != "" {
+		data, err := ioutil.ReadFile(tokName)
+		if err != nil {
+			log.Fatal("Token table not found")
+		}
+		img.tokens = data
+	}
+	if img.tokens == nil {
+		log.Fatal("No logtok section/token table found")
+	}
+	return img
+}
+
+func cstring(data []byte) string {
+	if i := strings.IndexByte(string(data), 0); i >= 0 {
+		return string(data[:i])
+	}
+	return string(data)
+}
+
+// string at a target address, only when it lives in the image
+func (img *image) str(addr uint32) string {
+	for _, s := range img.sections {
+		if uint64(addr) >= s.Addr && uint64(addr) < s.Addr+s.Size {
+			data, err := s.Data()
+			if err == nil {
+				return cstring(data[uint64(addr)-s.Addr:])
+			}
+		}
+	}
+	return fmt.Sprintf("<str@0x%08x>", addr)
+}
 
-	for i := LINE_LEN; i < len(memBytes); i+=LINE_LEN {
-		if (string(memBytes[i+4:i+LINE_LEN])[0] == 0) {
+// printf with 32bit arguments, C conversions are mapped onto Go's fmt
+func (img *image) format(f string, args []uint32) string {
+	var out strings.Builder
+	n := 0
+	for i := 0; i < len(f); i++ {
+		if f[i] != '%' {
+			out.WriteByte(f[i])
+			continue
+		}
+		j := i + 1
+		for j < len(f) && strings.IndexByte("-+ #0123456789.", f[j]) >= 0 {
+			j++
+		}
+		spec := f[i+1 : j]
+		for j < len(f) && strings.IndexByte("hlzjt", f[j]) >= 0 {
+			j++ // length modifiers, all arguments are 32bit
+		}
+		if j >= len(f) {
+			out.WriteString(f[i:])
+			break
+		}
+		conv := f[j]
+		i = j
+		if conv == '%' {
+			out.WriteByte('%')
+			continue
+		}
+		if n >= len(args) {
+			out.WriteString("%!(MISSING)")
+			continue
+		}
+		a := args[n]
+		n++
+		switch conv {
+		case 'd', 'i':
+			out.WriteString(fmt.Sprintf("%"+spec+"d", int32(a)))
+		case 'u':
+			out.WriteString(fmt.Sprintf("%"+spec+"d", a))
+		case 'x', 'X', 'o':
+			out.WriteString(fmt.Sprintf("%"+spec+string(conv), a))
+		case 'c':
+			out.WriteString(fmt.Sprintf("%"+spec+"c", rune(a&0xff)))
+		case 'p':
+			out.WriteString(fmt.Sprintf("0x%08x", a))
+		case 's':
+			out.WriteString(fmt.Sprintf("%"+spec+"s", img.str(a)))
+		default:
+			out.WriteString(fmt.Sprintf("%%!%c(0x%x)", conv, a))
+		}
+	}
+	return out.String()
+}
+
+func processText(memBytes []byte) {
+	for i := LINE_LEN; i+LINE_LEN <= len(memBytes); i += LINE_LEN {
+		if memBytes[i+4] == 0 {
 			continue
 		}
 		fmt.Printf("%d : %s\n", binary.BigEndian.Uint32(memBytes[i:i+4]),
-			string(memBytes[i+4:i+LINE_LEN]))
+			cstring(memBytes[i+4:i+LINE_LEN]))
+	}
+}
+
+func processTokenized(memBytes []byte, img *image) {
+	le := binary.LittleEndian
+	size := le.Uint32(memBytes[4:])
+	rd := le.Uint32(memBytes[8:])
+	used := le.Uint32(memBytes[16:])
+	count := le.Uint32(memBytes[20:])
+	evicted := le.Uint32(memBytes[24:])
+	data := memBytes[TOK_HDR_LEN:]
+
+	if uint32(len(data)) < size || rd >= size || used > size {
+		log.Fatal("Corrupt tokenized log header")
+	}
+	fmt.Printf("# %d records logged, %d overwritten\n", count, evicted)
+
+	seq := count - evicted
+	for used > 0 {
+		hdr := le.Uint32(data[rd:])
+		if hdr == TOK_PAD {
+			used -= size - rd
+			rd = 0
+			continue
+		}
+		nargs := (hdr >> 8) & 0xF
+		rlen := 4 * (1 + nargs)
+		args := make([]uint32, nargs)
+		for k := uint32(0); k < nargs; k++ {
+			args[k] = le.Uint32(data[(rd+4*(1+k))%size:])
+		}
+
+		token := hdr >> 16
+		lvl := (hdr >> 12) & 0xF
+		text := fmt.Sprintf("<unknown token 0x%04x>", token)
+		if int(token) < len(img.tokens) {
+			text = img.format(cstring(img.tokens[token:]), args)
+		}
+		lvlName := "?"
+		if int(lvl) < len(levels) {
+			lvlName = levels[lvl]
+		}
+		if hdr&0xFF != seq&0xFF {
+			fmt.Printf("--- sequence mismatch (%d <> %d) ---\n", hdr&0xFF, seq&0xFF)
+			seq = (seq &^ 0xFF) | (hdr & 0xFF)
+		}
+		fmt.Printf("%d : [%5s] %s\n", seq, lvlName, text)
+
+		seq++
+		rd = (rd + rlen) % size
+		used -= rlen
+	}
+}
+
+func main() {
+	inName := flag.String("in", "out.bin", "RAM dump of the log region")
+	elfName := flag.String("elf", "", "elf image (tokenized log)")
+	tokName := flag.String("tok", "", "token table, <image>.logtok (tokenized log)")
+	flag.Parse()
+
+	memBytes, err := ioutil.ReadFile(*inName)
+	if err != nil {
+		log.Fatal("File not found")
+	}
+
+	if len(memBytes) >= TOK_HDR_LEN && binary.LittleEndian.Uint32(memBytes) == TOK_MAGIC {
+		processTokenized(memBytes, loadImage(*elfName, *tokName))
+	} else {
+		processText(memBytes)
 	}
 }
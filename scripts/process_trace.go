@@ -0,0 +1,201 @@
+package main
+
+// Converts a RAM dump of the span tracer ring (third-party/logger/include/tracer.h)
+// into Chrome trace / Perfetto JSON, open it in https://ui.perfetto.dev or
+// chrome://tracing.
+//
+//	go run process_trace.go -elf app-flash0.elf > trace.json
+//	go run process_trace.go -in out.bin -tok app-flash0.tracetok -out trace.json
+//
+// The dump may cover more than the ring (e.g. the whole shared SRAM), the ring
+// header is searched for. Names are only stored as offsets in the `tracetok`
+// section, they are resolved from the image or the extracted table.
+
+import (
+	"debug/elf"
+	"encoding/binary"
+	"encoding/json"
+	"flag"
+	"fmt"
+	"io/ioutil"
+	"log"
+	"os"
+	"strings"
+)
+
+const (
+	TRACE_MAGIC   = 0x43525454 // "TTRC"
+	TRACE_HDR_LEN = 16         // struct tracer_ring_t
+	TRACE_REC_LEN = 12         // struct tracer_rec_t
+	TRACE_INVALID = 0xFFFF
+)
+
+type event struct {
+	Name string            `json:"name"`
+	Ph   string            `json:"ph"`
+	Ts   float64           `json:"ts"`
+	Pid  int               `json:"pid"`
+	Tid  int               `json:"tid"`
+	S    string            `json:"s,omitempty"`
+	Args map[string]uint32 `json:"args,omitempty"`
+}
+
+type meta struct {
+	Name string            `json:"name"`
+	Ph   string            `json:"ph"`
+	Pid  int               `json:"pid"`
+	Tid  int               `json:"tid"`
+	Args map[string]string `json:"args"`
+}
+
+func loadNames(elfName string, tokName string) []byte {
+	if elfName != "" {
+		f, err := elf.Open(elfName)
+		if err != nil {
+			log.Fatal("Failed to open elf: ", err)
+		}
+		if s := f.Section("tracetok"); s != nil {
+			data, _ := s.Data()
+			return data
+		}
+	}
+	if tokName != "" {
+		data, err := ioutil.ReadFile(tokName)
+		if err != nil {
+			log.Fatal("Name table not found")
+		}
+		return data
+	}
+	log.Fatal("No tracetok section/name table found")
+	return nil
+}
+
+func cstring(data []byte) string {
+	if i := strings.IndexByte(string(data), 0); i >= 0 {
+		return string(data[:i])
+	}
+	return string(data)
+}
+
+// offset of a plausible ring header in the dump
+func findRing(mem []byte) int {
+	le := binary.LittleEndian
+	for off := 0; off+TRACE_HDR_LEN <= len(mem); off += 4 {
+		if le.Uint32(mem[off:]) != TRACE_MAGIC {
+			continue
+		}
+		capacity := le.Uint32(mem[off+8:])
+		if capacity != 0 && capacity&(capacity-1) == 0 &&
+			off+TRACE_HDR_LEN+int(capacity)*TRACE_REC_LEN <= len(mem) {
+			return off
+		}
+	}
+	log.Fatal("No trace ring found in the dump")
+	return -1
+}
+
+func ctxName(ctx int) string {
+	switch {
+	case ctx == 0:
+		return "thread"
+	case ctx < 16:
+		return fmt.Sprintf("exception %d", ctx)
+	default:
+		return fmt.Sprintf("irq %d", ctx-16)
+	}
+}
+
+func main() {
+	inName := flag.String("in", "out.bin", "RAM dump holding the trace ring")
+	elfName := flag.String("elf", "", "elf image")
+	tokName := flag.String("tok", "", "name table, <image>.tracetok")
+	outName := flag.String("out", "", "output file (default stdout)")
+	flag.Parse()
+
+	mem, err := ioutil.ReadFile(*inName)
+	if err != nil {
+		log.Fatal("File not found")
+	}
+	names := loadNames(*elfName, *tokName)
+
+	le := binary.LittleEndian
+	off := findRing(mem)
+	clkHz := le.Uint32(mem[off+4:])
+	capacity := le.Uint32(mem[off+8:])
+	head := le.Uint32(mem[off+12:])
+	recs := mem[off+TRACE_HDR_LEN:]
+	if clkHz == 0 {
+		log.Fatal("Corrupt trace header")
+	}
+
+	n := head
+	if n > capacity {
+		n = capacity
+	}
+	fmt.Fprintf(os.Stderr, "# %d records traced, %d overwritten, %d Hz\n", head, head-n, clkHz)
+
+	var events []interface{}
+	depth := map[int]int{}
+	var abs int64
+	var prev uint32
+	for i := uint32(0); i < n; i++ {
+		idx := head - n + i
+		r := recs[(idx&(capacity-1))*TRACE_REC_LEN:]
+		ts := le.Uint32(r[0:])
+		name := le.Uint16(r[4:])
+		typ := string(r[6])
+		tid := int(r[7])
+		arg := le.Uint32(r[8:])
+
+		// 32bit timestamps, a nested interrupt may store a slightly older one
+		if i > 0 {
+			abs += int64(int32(ts - prev))
+		}
+		prev = ts
+
+		nameStr := fmt.Sprintf("<unknown 0x%04x>", name)
+		if name != TRACE_INVALID && int(name) < len(names) {
+			nameStr = cstring(names[name:])
+		}
+
+		if _, ok := depth[tid]; !ok {
+			depth[tid] = 0
+			events = append(events, meta{Name: "thread_name", Ph: "M", Pid: 1, Tid: tid,
+				Args: map[string]string{"name": ctxName(tid)}})
+		}
+
+		e := event{Name: nameStr, Ph: typ, Ts: float64(abs) * 1e6 / float64(clkHz), Pid: 1, Tid: tid}
+		switch typ {
+		case "B":
+			depth[tid]++
+		case "E":
+			if depth[tid] == 0 {
+				continue // its begin got overwritten
+			}
+			depth[tid]--
+		case "i":
+			e.S = "t"
+			e.Args = map[string]uint32{"arg": arg}
+		case "C":
+			e.Args = map[string]uint32{"value": arg}
+		default:
+			continue
+		}
+		events = append(events, e)
+	}
+
+	out, err := json.Marshal(map[string]interface{}{
+		"traceEvents":     events,
+		"displayTimeUnit": "ns",
+	})
+	if err != nil {
+		log.Fatal(err)
+	}
+	if *outName == "" {
+		os.Stdout.Write(out)
+		return
+	}
+	if err := ioutil.WriteFile(*outName, out, 0644); err != nil {
+		log.Fatal(err)
+	}
+}
@@ -15,6 +15,7 @@
 #include "softversions.h"
 #include "protocol.h"
 #include "gowin_protocol.h"
+#include "spi/spi_update.h"
 
 #ifndef UNIT_TEST
   #include "fsl_gpio.h"
@@ -75,6 +76,91 @@ void sharedram_log_read(u8 * RxBuf,
 #endif
 }
 
+// ------------------------------------------------------------------------------
+// sharedram_log_collect - packs memory-log slots with counter >= *Cursor
+// The memory logger (logger_mem.c) writes 128-byte slots in a ring after its
+// context slot: [COUNTER(4byte BE) | TEXT '\0'], counter N lives in slot N % NrOfSlots.
+// Head is the counter of the next entry to be written (log_mem_ctxt_t.count).
+// When the cursor points to entries that were already overwritten we continue at
+// the oldest entry still present, the host detects the gap in the counters.
+// A cursor beyond Head means the log got restarted (reboot), start over at the oldest.
+// Returns the number of bytes written to Dest, *Cursor is set to the next counter.
+// ------------------------------------------------------------------------------
+u16 sharedram_log_collect(const u8 * Slots,
+                          u16 NrOfSlots,
+                          u32 Head,
+                          u32 * Cursor,
+                          u8 * Dest,
+                          u16 MaxBytes) {
+    const u16 TEXT_SIZE = LOG_MEM_SLOT_SIZE - sizeof(u32);
+    u32 Oldest = (Head > NrOfSlots) ? (Head - NrOfSlots) : 0;
+    u32 Counter = *Cursor;
+    u16 Used = 0;
+
+    if ((Counter < Oldest) || (Counter > Head))
+        Counter = Oldest;
+
+    while (Counter < Head) {
+        const u8 * Slot = Slots + (Counter % NrOfSlots) * LOG_MEM_SLOT_SIZE;
+        u32 SlotCounter = ((u32)Slot[0] << 24) | ((u32)Slot[1] << 16) |
+                          ((u32)Slot[2] << 8) | (u32)Slot[3];
+
+        if (SlotCounter == Counter) { // slot not (yet) overwritten
+            u8 Length = (u8)strnlen((const char *)Slot + sizeof(u32), TEXT_SIZE);
+            if ((Used + LOGFOLLOW_RECORD_HEADER + Length) > MaxBytes)
+                break; // next poll continues here
+            memcpy(Dest + Used, Slot, sizeof(u32));
+            Dest[Used + sizeof(u32)] = Length;
+            memcpy(Dest + Used + LOGFOLLOW_RECORD_HEADER, Slot + sizeof(u32), Length);
+            Used = (u16)(Used + LOGFOLLOW_RECORD_HEADER + Length);
+        }
+        Counter++;
+    }
+
+    *Cursor = Counter;
+    return Used;
+}
+
+// ------------------------------------------------------------------------------
+// sharedram_log_follow - reply with the log entries newer than Cursor
+// Reply DATA: [HEAD(4byte BE), NR_OF_RECORDS, RECORD[0..]] , see comm.h
+// No logging in here, every poll would otherwise add an entry to the log it reads.
+// ------------------------------------------------------------------------------
+void sharedram_log_follow(u8 * RxBuf,
+                          u32 Cursor) {
+#ifndef UNIT_TEST // gets mocked for UNIT_TESTS
+    log_mem_ctxt_t * ctxt = (log_mem_ctxt_t *)&__ssram_log_start__;
+    const u8 * Slots = (const u8 *)&__ssram_log_start__ + LOG_MEM_SLOT_SIZE;
+    u16 NrOfSlots = (u16)(((u32)&__ssram_log_end__ - (u32)&__ssram_log_start__) /
+                          LOG_MEM_SLOT_SIZE - 1);
+
+    if (ctxt->mem_base != &__ssram_log_start__) { // memory logger not initialised
+        reply_invalid(COMM_NACK_OUTOFBOUNDARY);
+        return;
+    }
+
+    u32 Head = ctxt->count;
+    u8 * Data = RxBuf + PROTOCOL_RX_OFFSET_ADR;
+    u8 * Records = Data + LOGFOLLOW_HEADER_SIZE;
+    u16 Used = 0;
+    u8 NrOfRecords = 0;
+
+    Used = sharedram_log_collect(Slots, NrOfSlots, Head, &Cursor, Records,
+                                 LOGFOLLOW_MAX_PAYLOAD - LOGFOLLOW_HEADER_SIZE);
+    for (u16 i = 0; i < Used; i = (u16)(i + LOGFOLLOW_RECORD_HEADER + Records[i + sizeof(u32)]))
+        NrOfRecords++;
+
+    Data[0] = (u8)(Head >> 24);
+    Data[1] = (u8)(Head >> 16);
+    Data[2] = (u8)(Head >> 8);
+    Data[3] = (u8)Head;
+    Data[4] = NrOfRecords;
+    PROTO_TX_SendMsg(UART1, RxBuf, (u16)(PROTOCOL_RX_OFFSET_ADR + LOGFOLLOW_HEADER_SIZE + Used));
+#else
+    LOG_ERROR("sharedram_log_follow should be mocked");
+#endif
+}
+
 // ------------------------------------------------------------------------------
 // SharedRamStruct_Write - struct at 0x20040000 in ram
 // the shared ram struct starts with ssram_data_t struct (memory_map.h)
@@ -160,7 +246,16 @@ void comm_handler(void) {
                 break;
             // --------------------------------------------------------------------------
             case CMD_READ_ARRAY:
-                if (COMM_DATA[UART1].MsgLength == ARRAY_READ_EXPECTED_RX_SIZE) { // valid read command...
+                if (Identifier == CMD_ID_LOGFOLLOW) { // carries a 4byte cursor instead of offset/length
+                    if (COMM_DATA[UART1].MsgLength == LOGFOLLOW_RX_SIZE) {
+                        u8 * Cursor = COMM_DATA[UART1].MsgBuf + PROTOCOL_RX_OFFSET_OFFSET;
+                        sharedram_log_follow(COMM_DATA[UART1].MsgBuf,
+                                             ((u32)Cursor[0] << 24) | ((u32)Cursor[1] << 16) |
+                                             ((u32)Cursor[2] << 8) | (u32)Cursor[3]);
+                    } else {
+                        reply_invalid(COMM_NACK_MSG_LENGTH);
+                    }
+                } else if (COMM_DATA[UART1].MsgLength == ARRAY_READ_EXPECTED_RX_SIZE) { // valid read command...
                     switch (Identifier) {
                         case CMD_ID_BOOTLOG:
                             sharedram_log_read(COMM_DATA[UART1].MsgBuf,
@@ -182,6 +277,13 @@ void comm_handler(void) {
                 }
                 break;
             // --------------------------------------------------------------------------
+            case CMD_WRITE_ARRAY:
+                if (Identifier == CMD_ID_SPIUPDATE) // opcode and arguments instead of offset/length
+                    spi_update_handler(COMM_DATA[UART1].MsgBuf, COMM_DATA[UART1].MsgLength);
+                else
+                    Run_CommHandler(COMM_DATA[UART1].MsgBuf, COMM_DATA[UART1].MsgLength);
+                break;
+            // --------------------------------------------------------------------------
             // r/w byte, integer, array-commands handled below
             default:
                 Run_CommHandler(COMM_DATA[UART1].MsgBuf, COMM_DATA[UART1].MsgLength);
@@ -199,7 +301,7 @@ void comm_handler(void) {
 // ------------------------------------------------------------------------------
 void comm_handler_gowin(void) {
     if (Main.Diagnostics.PendingGowinCmd != NO_GOWIN_CMD) {
-        GOWIN_TX_SendMsg(Main.Diagnostics.PendingGowinCmd);
+        GOWIN_Queue_Tx_Msg(Main.Diagnostics.PendingGowinCmd);
         Main.Diagnostics.PendingGowinCmd = NO_GOWIN_CMD;
     } else {
         // If we get here we received an EDID/DPCD message
@@ -42,8 +42,21 @@
 #define CMD_ID_DPCD1      0x24
 #define CMD_ID_DPCD2      0x25
 #define CMD_ID_DPCD3      0x26
+#define CMD_ID_SPIUPDATE  0x50      // Gowin bitfile update, array write, see spi/spi_update.h
+#define CMD_ID_PERFCOUNTERS 0x60    // PerfCounters block, little endian u32's
+#define CMD_ID_LOOPSTATS    0x61    // LoopStats, offset = task index (LoopTask_t)
 #define CMD_ID_RESERVED   0x80      // don't use reserved characters
 #define CMD_ID_BOOTLOG    0xA0
+#define CMD_ID_LOGFOLLOW  0xA1      // stream memory-log entries newer than a cursor
+
+// CMD_ID_LOGFOLLOW request : [ADR, CMD_READ_ARRAY, CMD_ID_LOGFOLLOW, CURSOR(4byte BE)]
+// reply DATA : [HEAD(4byte BE), NR_OF_RECORDS, RECORD[0..]]
+// each RECORD: [COUNTER(4byte BE), TEXT_LENGTH, TEXT(without '\0')]
+#define LOG_MEM_SLOT_SIZE       128 // keep in sync with MAX_LOG_LEN in logger_mem.c
+#define LOGFOLLOW_RX_SIZE       7
+#define LOGFOLLOW_HEADER_SIZE   5
+#define LOGFOLLOW_RECORD_HEADER 5
+#define LOGFOLLOW_MAX_PAYLOAD   512 // must fit in MSGBUF_SIZE together with ADR and CMD
 
 
 // error values communication
@@ -70,5 +83,13 @@ void reply_invalid(const u8 nack_type);
 void sharedram_log_read(u8 * RxBuf,
                         u8 Offset,
                         u8 NrOfBytes);
+void sharedram_log_follow(u8 * RxBuf,
+                          u32 Cursor);
+u16  sharedram_log_collect(const u8 * Slots,
+                           u16 NrOfSlots,
+                           u32 Head,
+                           u32 * Cursor,
+                           u8 * Dest,
+                           u16 MaxBytes);
 
 #endif // _COMM_H_
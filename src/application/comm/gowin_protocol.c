@@ -32,8 +32,13 @@
 #include <stdio.h>
 
 #include "logger.h"
+#include "tracer.h"
+#include "ring.h"
 
 #include "data_map.h"
+#include "gowin_shadow.h"
+#include "scheduler.h"
+#include "timer_wheel.h"
 
 /*******************************************************************************
  * Variables
@@ -50,17 +55,31 @@ t_gowin_data GOWIN_DATA = { (u8 *)&FPGA_MSGBUF,   (u8 *)&FPGA_MSGBUF,
                             0,
                             0,                    0,                   0,
                             0,                    0,
-                            0,                    0,
-                            0 };
+                            0,                    0 };
 
-t_gowin_msg GOWIN_MSG_QUEUE[GOWIN_MSG_QUEUE_SIZE] = {};
+// TX message queue: a FIFO per priority, the message in flight until its reply
+typedef struct {
+    t_gowin_msg msg[GOWIN_MSG_QUEUE_SIZE];
+    u8 rd;    // oldest pending
+    u8 count;
+} t_gowin_fifo;
 
-static const uint8_t GOWIN_START = GOWIN_START_BYTE;
-static const uint8_t GOWIN_STOP = GOWIN_STOP_BYTE;
+static t_gowin_fifo MsgQueue[GOWIN_PRIO_NUM];
+static t_gowin_msg MsgInFlight = { NO_GOWIN_CMD, 0 };
+static u8 MsgRetries = 0; // resends of MsgInFlight
 
 static u8 EdidIndex = 0;
 static u8 DpcdIndex = 0;
-static u8 MsgIndex = 0;
+
+static Timer_t ReplyTimer = TIMER_EVENT_INIT(SCHED_EV_GOWIN_RX); // wakes the gowin task on expiry
+
+// TX: task -> ring -> UART interrupt
+RING_DEFINE(GowinTxRing, u8, GOWIN_TX_RING_SIZE);
+static volatile bool TxBusy = false;                      // request in the ring or shift register
+static t_gowin_state TxNextState = GOWIN_WAIT_FOR_START;  // entered when the request is sent
+static t_gowin_command TxCmd = NO_GOWIN_CMD;
+
+static void _tx_complete(void);
 
 /*******************************************************************************
  * Enum/Define to string helper code
@@ -87,6 +106,8 @@ const char * returnStateName(t_gowin_state val) {
             return "GOWIN_READING_1BYTE";
         case GOWIN_READING_2BYTE:
             return "GOWIN_READING_2BYTE";
+        case GOWIN_WAIT_FOR_TX:
+            return "GOWIN_WAIT_FOR_TX";
         default:
             return "";
             break;
@@ -198,7 +219,7 @@ void StartByte() {
     GOWIN_DATA.MsgBufWr = (u8 *)GOWIN_DATA.MsgBuf; // reset write pointer
     GOWIN_DATA.offset = 0;
     GOWIN_DATA.previous_char = 0;
-    GOWIN_DATA.TimeoutCount = 0;
+    timer_start(&ReplyTimer, GOWIN_REPLY_TIMEOUT_MS);
     GOWIN_DATA.MsgBufSize = FPGA_MSGBUF_SIZE;
 }
 
@@ -233,10 +254,16 @@ int8_t process_rx_character(const u8 c) {
             LOG_DEBUG("State[%s] GOWIN_NACK received", returnStateName(GOWIN_DATA.State));
             if (GOWIN_DATA.BadMsgCount < 0xFFFF)
                 GOWIN_DATA.BadMsgCount++; // increment bad msg counter
+            PERF_COUNT(GowinNack);
             GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_START);
             return GOWIN_RETURN_ERROR;
             break;
         // --------------------------------------------------------------------------
+        case WAKE_UP: // FPGA (re)started, EDID/DPCD content lost
+            LOG_DEBUG("State[%s] WAKE_UP received", returnStateName(GOWIN_DATA.State));
+            gowin_shadow_invalidate();
+            break;
+        // --------------------------------------------------------------------------
         default:
             // unknown characters do not get processed
             break;
@@ -258,10 +285,9 @@ void process_rx_data_character(const u8 c,
         // incoming-data has no STOPBYTE! simulate it here.
         StopByte();
 
-        LOG_DEBUG("State[%s] done (timeout count = %d/%d) , rx size[%d]",
+        LOG_DEBUG("State[%s] done (%lu ms left) , rx size[%d]",
                   returnStateName(GOWIN_DATA.State),
-                  GOWIN_DATA.TimeoutCount,
-                  GOWIN_REPLY_TIMEOUT,
+                  (unsigned long)(ReplyTimer.expires - timer_now()),
                   GOWIN_DATA.MsgLength);
 
         // LOG_DEBUG("..Last byte [%x], First byte [%x]", *(GOWIN_DATA.MsgBufWr-1), *(GOWIN_DATA.MsgBufWr-1-GOWIN_DATA.MsgLength));
@@ -269,10 +295,12 @@ void process_rx_data_character(const u8 c,
         switch (GOWIN_DATA.State) {
             case GOWIN_READING_EDID:
                 store_edid_data(EdidIndex, GOWIN_DATA.MsgBufWr - GOWIN_DATA.MsgLength - 1);
+                gowin_shadow_learn(GOWIN_TABLE_EDID, GOWIN_DATA.MsgBufWr - GOWIN_DATA.MsgLength - 1);
                 GOWIN_Print_edid_in_log(EdidIndex);
                 break;
             case GOWIN_READING_DPCD:
                 store_dpcd_data(DpcdIndex, GOWIN_DATA.MsgBufWr - GOWIN_DATA.MsgLength - 1);
+                gowin_shadow_learn(GOWIN_TABLE_DPCD, GOWIN_DATA.MsgBufWr - GOWIN_DATA.MsgLength - 1);
                 GOWIN_Print_edid_in_log(DpcdIndex + 3u);
                 break;
             case GOWIN_READING_1BYTE:
@@ -300,6 +328,7 @@ void process_rx_data_character(const u8 c,
 // Called upon every received char
 // ------------------------------------------------------------------------------
 int8_t GOWIN_State_Machine(const u8 c) {
+    TRACE_SCOPE("GOWIN_State_Machine");
     // LOG_DEBUG("State_machine char %02X,state = %s", c,returnStateName(GOWIN_DATA.State));
     switch (GOWIN_DATA.State) {
         case GOWIN_WAIT_FOR_EDID:
@@ -324,6 +353,10 @@ int8_t GOWIN_State_Machine(const u8 c) {
         case GOWIN_WAIT_FOR_EDID_WRITE_ACK:
             if (c == GOWIN_ACK) {
                 GOWIN_DATA.GoodMsgCount++;
+                if (MsgInFlight.cmd == WRITE_EDID)
+                    gowin_shadow_commit(GOWIN_TABLE_EDID);
+                else if (MsgInFlight.cmd == WRITE_DPCD)
+                    gowin_shadow_commit(GOWIN_TABLE_DPCD);
                 LOG_DEBUG("State[%s] GOWIN_ACK received", returnStateName(GOWIN_DATA.State));
                 GOWIN_DATA.State = GOWIN_WAIT_FOR_START;
                 GOWIN_DATA.RxBusy = false;
@@ -333,6 +366,11 @@ int8_t GOWIN_State_Machine(const u8 c) {
             }
             break;
         // --------------------------------------------------------------------------
+        case GOWIN_WAIT_FOR_TX: // request still being sent, no reply yet
+            LOG_DEBUG("State[%s] - dropping byte [0x%02x,%c]",
+                      returnStateName(GOWIN_DATA.State), c, c);
+            break;
+        // --------------------------------------------------------------------------
         case GOWIN_READING_EDID:
         case GOWIN_READING_DPCD:
             process_rx_data_character(c, GOWIN_EDID_BYTE_LENGTH);
@@ -415,6 +453,10 @@ int8_t GOWIN_Protocol(t_uart_channel uart_channel) {
         LOG_WARN("Flexcomm Gowin kUSART_RxFifoFullFlag [%X]", UART_DATA[UART1].flags);
     }
 
+    // request sent (TX interrupt posted SCHED_EV_GOWIN_RX) -> wait for the reply
+    if ((GOWIN_DATA.State == GOWIN_WAIT_FOR_TX) && !TxBusy)
+        _tx_complete();
+
     // LOG_DEBUG("GOWIN Wr(%x)Rd(%x)",UART_DATA[uart_channel].RxBufWr,UART_DATA[uart_channel].RxBufRd);
     while (UART_DATA[uart_channel].RxBufWr != UART_DATA[uart_channel].RxBufRd) {
         // check if we can still receive another msg
@@ -448,30 +490,34 @@ int8_t GOWIN_Protocol(t_uart_channel uart_channel) {
             break;
     }
 
-    // LOG_DEBUG("GOWIN_Protocol queue index=%d\t state=%s", MsgIndex, returnStateName(GOWIN_DATA.State));
+    // LOG_DEBUG("GOWIN_Protocol queue size=%d\t state=%s", GOWIN_Queue_size(), returnStateName(GOWIN_DATA.State));
 
-    // timeout processing (based on nr of iterations of this loop, to do: use timer)
+    // timeout processing, the reply timer posts SCHED_EV_GOWIN_RX when it expires
     if (GOWIN_DATA.State != GOWIN_WAIT_FOR_START) {
-        if (GOWIN_DATA.TimeoutCount++ > GOWIN_REPLY_TIMEOUT) {
+        if (timer_expired(&ReplyTimer)) {
             LOG_DEBUG("GOWIN reply Timeout reached on state %s", returnStateName(GOWIN_DATA.State));
             if (GOWIN_DATA.BadMsgCount < 0xFFFF)
                 GOWIN_DATA.BadMsgCount++; // increment bad msg counter
-            GOWIN_DATA.TimeoutCount = 0;
+            PERF_COUNT(GowinTimeout);
+            gowin_shadow_invalidate(); // FPGA may be resetting, or missed a write
             GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_START);
             GOWIN_DATA.RxBusy = false;
             GOWIN_DATA.WaitForReply = false;
             return GOWIN_RETURN_TIMEOUT;
         }
 
+        if (!timer_pending(&ReplyTimer)) // state entered without start byte/setter
+            timer_start(&ReplyTimer, GOWIN_REPLY_TIMEOUT_MS);
+
         if (GOWIN_DATA.State == GOWIN_WAIT_FOR_EDID_WRITE_ACK)
             return GOWIN_RETURN_WAIT_EDID_ACK;
     } else { // GOWIN_WAIT_FOR_START
+        timer_cancel(&ReplyTimer);
         if (GOWIN_DATA.WaitForReply == true) {
             GOWIN_DATA.WaitForReply = false;
-            if (GOWIN_MSG_QUEUE[MsgIndex].cmd != NO_GOWIN_CMD)
-                LOG_DEBUG("Finished queue-msg index %d with cmd %s", MsgIndex,
-                          returnCmdName(GOWIN_MSG_QUEUE[MsgIndex].cmd));
-            GOWIN_MSG_QUEUE[MsgIndex].cmd = NO_GOWIN_CMD;
+            if (MsgInFlight.cmd != NO_GOWIN_CMD)
+                LOG_DEBUG("Finished queue-msg cmd %s", returnCmdName(MsgInFlight.cmd));
+            MsgInFlight.cmd = NO_GOWIN_CMD;
         } else {
             if (GOWIN_Queue_size())
                 GOWIN_Process_Queue();
@@ -483,33 +529,145 @@ int8_t GOWIN_Protocol(t_uart_channel uart_channel) {
 }
 
 // ------------------------------------------------------------------------------
-u8 GOWIN_QueueIndex_get() {
-    return MsgIndex;
+bool GOWIN_Busy(void) {
+    if (GOWIN_DATA.MsgCount)
+        return true;
+    if (GOWIN_DATA.State != GOWIN_WAIT_FOR_START)
+        return false; // awaiting the reply
+    if (GOWIN_DATA.WaitForReply)
+        return true;
+
+    for (int prio = 0; prio < GOWIN_PRIO_NUM; prio++) {
+        if (MsgQueue[prio].count)
+            return true;
+    }
+    return false;
+}
+
+// ------------------------------------------------------------------------------
+// local helpers: queue priority and coalescing of a command
+static t_gowin_prio _msg_prio(t_gowin_command cmd) {
+    switch (cmd) {
+        case SET_STANDBY_ON:
+        case SET_STANDBY_OFF:
+        case SET_FPGA_ON:
+        case SET_FPGA_OFF:
+        case PANEL_PWR_ON:
+        case PANEL_PWR_OFF:
+        case PANEL_VOLTAGELO:
+        case PANEL_VOLTAGEHI:
+        case BACKLIGHT_ON: // ordered with panel power: off before power off, on after power on
+        case BACKLIGHT_OFF:
+            return GOWIN_PRIO_POWER;
+        case WRITE_EDID:
+        case READ_EDID:
+        case WRITE_DPCD:
+        case READ_DPCD:
+            return GOWIN_PRIO_BULK;
+        default:
+            return GOWIN_PRIO_CONTROL;
+    }
+}
+
+// the setting a command changes, both values of a setting map to one command
+// NO_GOWIN_CMD: never coalesced
+static t_gowin_command _msg_setting(t_gowin_command cmd) {
+    switch (cmd) {
+        case SET_STANDBY_ON:
+        case SET_STANDBY_OFF:
+            return SET_STANDBY_ON;
+        case SET_FPGA_ON:
+        case SET_FPGA_OFF:
+            return SET_FPGA_ON;
+        case PANEL_PWR_ON:
+        case PANEL_PWR_OFF:
+            return PANEL_PWR_ON;
+        case PANEL_VOLTAGELO:
+        case PANEL_VOLTAGEHI:
+            return PANEL_VOLTAGEHI;
+        case BACKLIGHT_ON:
+        case BACKLIGHT_OFF:
+            return BACKLIGHT_ON;
+        case HDMI_WRITE_PROTECT_ON:
+        case HDMI_WRITE_PROTECT_OFF:
+            return HDMI_WRITE_PROTECT_ON;
+        case WRITE_EDID: // the data is taken from Main when sent
+        case WRITE_DPCD:
+        case READ_ETH_STATUS:
+        case READ_BL_CURRENT:
+            return cmd;
+        default: // EDID/DPCD readback must follow the writes queued before it,
+                 // ACK/NACK and unknown pass through commands
+            return NO_GOWIN_CMD;
+    }
+}
+
+// ------------------------------------------------------------------------------
+// static void _queue_put(t_gowin_command cmd, u8 param)
+//  coalesce with a pending message of the same setting (and index), otherwise
+//  append to the FIFO of its priority, drop when full. In the power FIFO only
+//  the newest message is replaced, an older one would move the new value
+//  ahead of the power/backlight commands queued after it.
+static void _queue_put(t_gowin_command cmd,
+                       u8 param) {
+    t_gowin_prio prio = _msg_prio(cmd);
+    t_gowin_fifo * fifo = &MsgQueue[prio];
+    t_gowin_command setting = _msg_setting(cmd);
+    t_gowin_msg * msg;
+
+    if (setting != NO_GOWIN_CMD) {
+        u8 i = ((prio == GOWIN_PRIO_POWER) && fifo->count) ? (fifo->count - 1) : 0;
+
+        for (; i < fifo->count; i++) {
+            msg = &fifo->msg[(fifo->rd + i) & (GOWIN_MSG_QUEUE_SIZE - 1)];
+            if ((_msg_setting(msg->cmd) == setting) && (msg->param == param)) {
+                LOG_DEBUG("GOWIN queue %s replaced by %s", returnCmdName(msg->cmd),
+                          returnCmdName(cmd));
+                msg->cmd = cmd;
+                PERF_COUNT(GowinCoalesced);
+                return;
+            }
+        }
+    }
+
+    if (fifo->count >= GOWIN_MSG_QUEUE_SIZE) {
+        LOG_WARN("Gowin message-Queue is FULL, %s dropped", returnCmdName(cmd));
+        PERF_COUNT(GowinQueueDrop);
+        return;
+    }
+    msg = &fifo->msg[(fifo->rd + fifo->count) & (GOWIN_MSG_QUEUE_SIZE - 1)];
+    msg->cmd = cmd;
+    msg->param = param;
+    fifo->count++;
+    sched_post(SCHED_EV_GOWIN_RX); // wake the gowin task
+}
+
+// ------------------------------------------------------------------------------
+t_gowin_command GOWIN_Queue_current() {
+    return MsgInFlight.cmd;
 }
 
 // ------------------------------------------------------------------------------
 void GOWIN_Queue_Init() {
-    for (int i = 0u; i < GOWIN_MSG_QUEUE_SIZE; i++) {
-        GOWIN_MSG_QUEUE[i].cmd = NO_GOWIN_CMD;
-        GOWIN_MSG_QUEUE[i].param = 0;
+    for (int prio = 0; prio < GOWIN_PRIO_NUM; prio++) {
+        MsgQueue[prio].rd = 0;
+        MsgQueue[prio].count = 0;
     }
-    MsgIndex = 0;
+    MsgInFlight.cmd = NO_GOWIN_CMD;
+    MsgInFlight.param = 0;
+    MsgRetries = 0;
+    gowin_shadow_invalidate();
 }
 
 // ------------------------------------------------------------------------------
 u8 GOWIN_Queue_size() {
-    u8 pending_msg = 0;
+    u8 pending_msg = (MsgInFlight.cmd != NO_GOWIN_CMD) ? 1 : 0;
 
-    for (int i = 0u; i < GOWIN_MSG_QUEUE_SIZE; i++) {
-        if (GOWIN_MSG_QUEUE[i].cmd != NO_GOWIN_CMD)
-            pending_msg++;
-    }
+    for (int prio = 0; prio < GOWIN_PRIO_NUM; prio++)
+        pending_msg += MsgQueue[prio].count;
     if (pending_msg != 0)
         LOG_DEBUG("Queue size is %d", pending_msg);
 
-    if (pending_msg == GOWIN_MSG_QUEUE_SIZE)
-        LOG_WARN("Gowin message-Queue is FULL!");
-
     return pending_msg;
 }
 
@@ -517,18 +675,8 @@ u8 GOWIN_Queue_size() {
 // void GOWIN_Queue_Tx_Msg(t_gowin_command cmd)
 //  queue up messages for TX
 void GOWIN_Queue_Tx_Msg(t_gowin_command cmd) {
-    u8 newId = MsgIndex;
-
-    for (int i = 0u; i < GOWIN_MSG_QUEUE_SIZE; i++) {
-        if (GOWIN_MSG_QUEUE[i].cmd == NO_GOWIN_CMD) {
-            newId = (u8)i;
-            break;
-        }
-    }
-
-    GOWIN_MSG_QUEUE[newId].cmd = cmd;
-
-    LOG_DEBUG("GOWIN_Queue_Tx_Msg %s on index %d", returnCmdName(cmd), newId);
+    LOG_DEBUG("GOWIN_Queue_Tx_Msg %s", returnCmdName(cmd));
+    _queue_put(cmd, 0);
 }
 
 // ------------------------------------------------------------------------------
@@ -537,137 +685,254 @@ void GOWIN_Queue_Tx_Msg(t_gowin_command cmd) {
 void GOWIN_Queue_Tx_Msg_Index(t_gowin_command cmd,
                               u8 storage_index) {
     // we could transmit immediatly, but queue anyhow
+    LOG_DEBUG("GOWIN_Queue_Tx_Msg_Index %s[%d]", returnCmdName(cmd), storage_index);
+    _queue_put(cmd, storage_index);
+}
 
-    u8 newId = MsgIndex;
-
-    for (int i = 0u; i < GOWIN_MSG_QUEUE_SIZE; i++) {
-        if (GOWIN_MSG_QUEUE[i].cmd == NO_GOWIN_CMD) {
-            newId = (u8)i;
-            break;
-        }
-    }
-    GOWIN_MSG_QUEUE[newId].cmd = cmd;
-    LOG_DEBUG("GOWIN_Queue_Tx_Msg_Index %s[%d] on index %d", returnCmdName(cmd), storage_index,
-              newId);
-
-    if ((cmd == WRITE_EDID) || (cmd == READ_EDID))
-        GOWIN_MSG_QUEUE[newId].param = storage_index;
-
-    if ((cmd == WRITE_DPCD) || (cmd == READ_DPCD))
-        GOWIN_MSG_QUEUE[newId].param = storage_index;
+// ------------------------------------------------------------------------------
+// local helper: source buffer of an EDID/DPCD write (EdidIndex/DpcdIndex)
+static const u8 * _write_data(t_gowin_command cmd) {
+    static const u8 * const edid[3] = { Main.Edid.Edid1, Main.Edid.Edid2, Main.Edid.Edid3 };
+    static const u8 * const dpcd[3] = { Main.Dpcd.Dpcd1, Main.Dpcd.Dpcd2, Main.Dpcd.Dpcd3 };
+
+    if ((cmd == WRITE_EDID) && (EdidIndex < 3))
+        return edid[EdidIndex];
+    if ((cmd == WRITE_DPCD) && (DpcdIndex < 3))
+        return dpcd[DpcdIndex];
+    return NULL;
 }
 
 // ------------------------------------------------------------------------------
 // void GOWIN_Process_Queue()
-//  Processes the messages ready for transmit
+//  Transmits the oldest message of the highest priority, it stays in flight
+//  until its reply or GOWIN_MSG_RETRY_MAX resends
 void GOWIN_Process_Queue() {
-    // set index to next command
-    for (int i = 0u; i < GOWIN_MSG_QUEUE_SIZE; i++) {
-        if (GOWIN_MSG_QUEUE[i].cmd != NO_GOWIN_CMD) {
-            MsgIndex = (u8)i;
-            break;
+    t_gowin_fifo * fifo = NULL;
+    t_gowin_msg * msg;
+
+    if (MsgInFlight.cmd != NO_GOWIN_CMD) { // no reply before the timeout: send it again
+        if (MsgRetries < GOWIN_MSG_RETRY_MAX) {
+            LOG_DEBUG("GOWIN_Process_Queue retry [%s][%d]", returnCmdName(MsgInFlight.cmd),
+                      MsgInFlight.param);
+            if (GOWIN_TX_SendMsg(MsgInFlight.cmd) >= 0) // tx ring full: retried on the next run
+                MsgRetries++;
+            return;
         }
+        LOG_WARN("Gowin %s[%d] unanswered after %d retries, dropped",
+                 returnCmdName(MsgInFlight.cmd), MsgInFlight.param, MsgRetries);
+        PERF_COUNT(GowinRetryDrop);
+        MsgInFlight.cmd = NO_GOWIN_CMD; // the queue behind it goes on
     }
 
-    if (GOWIN_MSG_QUEUE[MsgIndex].cmd == NO_GOWIN_CMD)
+    for (int prio = 0; prio < GOWIN_PRIO_NUM; prio++) {
+        if (MsgQueue[prio].count) {
+            fifo = &MsgQueue[prio];
+            break;
+        }
+    }
+    if (fifo == NULL)
         return;
 
-    LOG_DEBUG("GOWIN_Process_Queue %d cmd [%s][%d]", MsgIndex,
-              returnCmdName(GOWIN_MSG_QUEUE[MsgIndex].cmd),
-              GOWIN_MSG_QUEUE[MsgIndex].param);
+    msg = &fifo->msg[fifo->rd];
+    LOG_DEBUG("GOWIN_Process_Queue cmd [%s][%d]", returnCmdName(msg->cmd), msg->param);
 
-    switch (GOWIN_MSG_QUEUE[MsgIndex].cmd) {
+    switch (msg->cmd) {
         case WRITE_EDID:
         case READ_EDID:
-            EdidIndex = GOWIN_MSG_QUEUE[MsgIndex].param;
+            EdidIndex = msg->param;
             break;
         case WRITE_DPCD:
         case READ_DPCD:
-            DpcdIndex = GOWIN_MSG_QUEUE[MsgIndex].param;
+            DpcdIndex = msg->param;
             break;
         default:
             break;
     }
 
-    GOWIN_TX_SendMsg(GOWIN_MSG_QUEUE[MsgIndex].cmd);
+    // the FPGA already holds this table (all writes before it are acknowledged)
+    if (((msg->cmd == WRITE_EDID) || (msg->cmd == WRITE_DPCD)) && _write_data(msg->cmd) &&
+        (gowin_shadow_dirty((msg->cmd == WRITE_EDID) ? GOWIN_TABLE_EDID : GOWIN_TABLE_DPCD,
+                            _write_data(msg->cmd)) == 0)) {
+        LOG_DEBUG("GOWIN %s[%d] unchanged, not sent", returnCmdName(msg->cmd), msg->param);
+        PERF_COUNT(GowinWriteSkipped);
+        fifo->rd = (fifo->rd + 1) & (GOWIN_MSG_QUEUE_SIZE - 1);
+        fifo->count--;
+        return;
+    }
+
+    if (GOWIN_TX_SendMsg(msg->cmd) < 0)
+        return; // tx ring full, retried on the next run
+
+    if (GOWIN_DATA.WaitForReply) { // ACK/NACK expect no reply
+        MsgInFlight = *msg;
+        MsgRetries = 0;
+    }
+    fifo->rd = (fifo->rd + 1) & (GOWIN_MSG_QUEUE_SIZE - 1);
+    fifo->count--;
 }
 
 // ------------------------------------------------------------------------------
-// void GOWIN_TX_SendMsg(u8 *data, u16 length)
-//  Sends a serial stream according to the GOWIN protocol
-//
-//  Format (3 bytes):
+// TX port: start the interrupt driven transmission of the ring
 // ------------------------------------------------------------------------------
-int8_t GOWIN_TX_SendMsg(t_gowin_command cmd) {
 #ifndef UNIT_TEST
-    USART_Type * base;
-    base = USART1;
+static void _tx_kick(void) {
+    USART_EnableInterrupts(USART1, kUSART_TxLevelInterruptEnable);
+}
 
-    if ((cmd == ACK) | (cmd == NACK)) { // single byte reply
-        USART_WriteBlocking(base, (u8 *)&cmd, 1);
-    } else { // 3 byte tx
-        GOWIN_DATA.WaitForReply = true;
-        USART_WriteBlocking(base, (u8 *)&GOWIN_START, 1);
-        USART_WriteBlocking(base, (u8 *)&cmd, 1);
-        USART_WriteBlocking(base, (u8 *)&GOWIN_STOP, 1);
-        if (cmd == READ_EDID) {
-            GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_EDID);
-            LOG_DEBUG("State->GOWIN_WAIT_FOR_EDID[%d]", EdidIndex);
-        } else if (cmd == READ_DPCD) {
-            GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_DPCD);
-            LOG_DEBUG("State->GOWIN_WAIT_FOR_DPCD[%d]", DpcdIndex);
-        } else if (cmd == WRITE_EDID) { // 256byte of data
-            GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_EDID_WRITE_ACK);
-            LOG_DEBUG("GOWIN_WRITE_EDID index[%d]", EdidIndex);
-            if (EdidIndex == 0)
-                USART_WriteBlocking(base, (u8 *)&Main.Edid.Edid1, EDID_SIZE);
-            else if (EdidIndex == 1)
-                USART_WriteBlocking(base, (u8 *)&Main.Edid.Edid2, EDID_SIZE);
-            else if (EdidIndex == 2)
-                USART_WriteBlocking(base, (u8 *)&Main.Edid.Edid3, EDID_SIZE);
-            else
-                LOG_ERROR("GOWIN_WRITE_EDID wrong index");
-        } else if (cmd == WRITE_DPCD) { // 256byte of data
-            GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_EDID_WRITE_ACK);
-            LOG_DEBUG("GOWIN_WRITE_DPCD index[%d]", DpcdIndex);
-            if (DpcdIndex == 0)
-                USART_WriteBlocking(base, (u8 *)&Main.Dpcd.Dpcd1, EDID_SIZE);
-            else if (DpcdIndex == 1)
-                USART_WriteBlocking(base, (u8 *)&Main.Dpcd.Dpcd2, EDID_SIZE);
-            else if (DpcdIndex == 2)
-                USART_WriteBlocking(base, (u8 *)&Main.Dpcd.Dpcd3, EDID_SIZE);
-            else
-                LOG_ERROR("GOWIN_WRITE_DPCD wrong index");
-            // LOG_RAW("---WRITE DPCD DATA---");
-            // GOWIN_Print_edid_in_log(DpcdIndex + 3u);
-        } else if (cmd == READ_ETH_STATUS) {
-            GOWIN_Protocol_state_set(GOWIN_READING_1BYTE);
-            StartByte();
-        } else if (cmd == READ_BL_CURRENT) {
-            GOWIN_Protocol_state_set(GOWIN_READING_2BYTE);
-            StartByte();
-        } else { // All ACK readback commands
-            LOG_DEBUG("GOWIN %s '%c' sent", returnCmdName(cmd), cmd);
-            GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_ACK);
+// ------------------------------------------------------------------------------
+// void GOWIN_TX_IRQHandler(void)
+//  Called from the Gowin UART IRQ: feeds the TX FIFO from the ring, when the
+//  ring is empty waits for TX idle (last stop bit out) to complete the request
+// ------------------------------------------------------------------------------
+void GOWIN_TX_IRQHandler(void) {
+    USART_Type * base = USART1;
+    u8 c;
 
-            switch (cmd) {
-                case SET_STANDBY_ON:
-                    Main.Diagnostics.InLowPowerMode = true;
-                    break;
-                case SET_STANDBY_OFF:
-                    Main.Diagnostics.InLowPowerMode = false;
-                    break;
-                default:
-                    break;
-            }
-        }
+    if (!(USART_GetEnabledInterrupts(base) & kUSART_TxLevelInterruptEnable) &&
+        !(base->INTENSET & USART_INTENSET_TXIDLEEN_MASK))
+        return; // rx interrupt only
+
+    while ((kUSART_TxFifoNotFullFlag & USART_GetStatusFlags(base)) &&
+           (ring_pop(&GowinTxRing, &c) == 0))
+        USART_WriteByte(base, c);
+
+    if (ring_count(&GowinTxRing))
+        return; // back on the FIFO level
+
+    USART_DisableInterrupts(base, kUSART_TxLevelInterruptEnable);
+    if (ring_count(&GowinTxRing)) { // pushed between the check and the disable
+        USART_EnableInterrupts(base, kUSART_TxLevelInterruptEnable);
+        return;
     }
 
-    while (!(kUSART_TxFifoEmptyFlag & USART_GetStatusFlags(base))) {
-    } // wait until transmission complete
+    if (base->STAT & USART_STAT_TXIDLE_MASK) {
+        base->INTENCLR = USART_INTENCLR_TXIDLECLR_MASK;
+        if (TxBusy) {
+            TxBusy = false;
+            sched_post(SCHED_EV_GOWIN_RX);
+        }
+    } else {
+        base->INTENSET = USART_INTENSET_TXIDLEEN_MASK; // back when the shift register is empty
+    }
+}
 #else
-    LOG_ERROR("Mocking failure");
+static void _tx_kick(void) {
+}
+
+// ------------------------------------------------------------------------------
+u16 GOWIN_TX_fake_transmit(u8 * buf,
+                           u16 size) {
+    u16 len = 0;
+    u8 c;
+
+    while ((len < size) && (ring_pop(&GowinTxRing, &c) == 0))
+        buf[len++] = c;
+    if (ring_count(&GowinTxRing) == 0) {
+        TxBusy = false;
+        sched_post(SCHED_EV_GOWIN_RX);
+    }
+    return len;
+}
 #endif
+
+// ------------------------------------------------------------------------------
+static int8_t _tx_put(const u8 * data,
+                      u16 length) {
+    if ((ring_capacity(&GowinTxRing) - ring_count(&GowinTxRing)) < length) {
+        LOG_ERROR("GOWIN tx ring full, %d bytes dropped", length);
+        return -1;
+    }
+    for (u16 i = 0; i < length; i++)
+        ring_push(&GowinTxRing, &data[i]);
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+// static void _tx_complete(void)
+//  The request left the shift register: enter the reply state, the reply
+//  timeout counts from here
+// ------------------------------------------------------------------------------
+static void _tx_complete(void) {
+    GOWIN_DATA.State = TxNextState;
+    timer_start(&ReplyTimer, GOWIN_REPLY_TIMEOUT_MS);
+
+    switch (TxCmd) {
+        case READ_ETH_STATUS:
+        case READ_BL_CURRENT: // reply has no start byte
+            StartByte();
+            break;
+        case SET_STANDBY_ON:
+            Main.Diagnostics.InLowPowerMode = true;
+            break;
+        case SET_STANDBY_OFF:
+            Main.Diagnostics.InLowPowerMode = false;
+            break;
+        default:
+            break;
+    }
+}
+
+// ------------------------------------------------------------------------------
+// int8_t GOWIN_TX_SendMsg(t_gowin_command cmd)
+//  Sends a serial stream according to the GOWIN protocol, non-blocking
+//
+//  Format (3 bytes):  START <cmd> STOP [256 byte EDID/DPCD]
+//  ACK/NACK: 1 byte
+// ------------------------------------------------------------------------------
+int8_t GOWIN_TX_SendMsg(t_gowin_command cmd) {
+    const u8 frame[3] = { GOWIN_START_BYTE, (u8)cmd, GOWIN_STOP_BYTE };
+    const u8 * payload = NULL;
+    t_gowin_state next;
+
+    if ((cmd == ACK) | (cmd == NACK)) { // single byte reply
+        if (_tx_put(&frame[1], 1) < 0)
+            return -1;
+        _tx_kick();
+        return 0;
+    }
+
+    if (cmd == READ_EDID) {
+        next = GOWIN_WAIT_FOR_EDID;
+        LOG_DEBUG("State->GOWIN_WAIT_FOR_EDID[%d]", EdidIndex);
+    } else if (cmd == READ_DPCD) {
+        next = GOWIN_WAIT_FOR_DPCD;
+        LOG_DEBUG("State->GOWIN_WAIT_FOR_DPCD[%d]", DpcdIndex);
+    } else if (cmd == WRITE_EDID) { // 256byte of data
+        next = GOWIN_WAIT_FOR_EDID_WRITE_ACK;
+        LOG_DEBUG("GOWIN_WRITE_EDID index[%d]", EdidIndex);
+        payload = _write_data(cmd);
+        if (payload == NULL)
+            LOG_ERROR("GOWIN_WRITE_EDID wrong index");
+    } else if (cmd == WRITE_DPCD) { // 256byte of data
+        next = GOWIN_WAIT_FOR_EDID_WRITE_ACK;
+        LOG_DEBUG("GOWIN_WRITE_DPCD index[%d]", DpcdIndex);
+        payload = _write_data(cmd);
+        if (payload == NULL)
+            LOG_ERROR("GOWIN_WRITE_DPCD wrong index");
+    } else if (cmd == READ_ETH_STATUS) {
+        next = GOWIN_READING_1BYTE;
+    } else if (cmd == READ_BL_CURRENT) {
+        next = GOWIN_READING_2BYTE;
+    } else { // All ACK readback commands
+        LOG_DEBUG("GOWIN %s '%c' sent", returnCmdName(cmd), cmd);
+        next = GOWIN_WAIT_FOR_ACK;
+    }
+
+    if ((ring_capacity(&GowinTxRing) - ring_count(&GowinTxRing)) <
+        (sizeof(frame) + (payload ? EDID_SIZE : 0))) {
+        LOG_ERROR("GOWIN tx ring full, %s not sent", returnCmdName(cmd));
+        return -1;
+    }
+    _tx_put(frame, sizeof(frame));
+    if (payload)
+        _tx_put(payload, EDID_SIZE);
+
+    GOWIN_DATA.WaitForReply = true;
+    TxCmd = cmd;
+    TxNextState = next;
+    GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_TX); // reply timer also guards a stuck tx
+    TxBusy = true; // after the push: a running ACK transmission must not complete it
+    _tx_kick();
     return 0;
 }
 
@@ -678,7 +943,12 @@ t_gowin_state GOWIN_Protocol_state_get(void) {
 
 // ------------------------------------------------------------------------------
 // prefer setting this global variable via this setter
+// leaving GOWIN_WAIT_FOR_START (request sent) starts the reply timeout
 void GOWIN_Protocol_state_set(t_gowin_state state) {
+    if (state == GOWIN_WAIT_FOR_START)
+        timer_cancel(&ReplyTimer);
+    else if (GOWIN_DATA.State == GOWIN_WAIT_FOR_START)
+        timer_start(&ReplyTimer, GOWIN_REPLY_TIMEOUT_MS);
     GOWIN_DATA.State = state;
 }
 
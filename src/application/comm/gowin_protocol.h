@@ -3,6 +3,7 @@
 
 #include "protocol.h"  // for uart channel definition
 #include "stdint.h"
+#include <stdbool.h>
 
 /*******************************************************************************
  * Definitions
@@ -61,7 +62,8 @@ typedef enum {
     GOWIN_WAIT_FOR_EDID_WRITE_ACK,
     GOWIN_WAIT_FOR_ACK,
     GOWIN_READING_1BYTE,
-    GOWIN_READING_2BYTE
+    GOWIN_READING_2BYTE,
+    GOWIN_WAIT_FOR_TX       // request queued, reply state entered once it is sent
 } t_gowin_state;
 
 // return codes
@@ -75,10 +77,12 @@ typedef enum {
 
 
 #define GOWIN_MAX_NO_MSG           1
-#define GOWIN_MSG_QUEUE_SIZE       10
-#define GOWIN_REPLY_TIMEOUT        8000
+#define GOWIN_MSG_QUEUE_SIZE       8   // per priority, power of 2
+#define GOWIN_REPLY_TIMEOUT_MS     250 // last start byte/request -> reply complete
+#define GOWIN_MSG_RETRY_MAX        3   // resends of a message without reply, then dropped
 
 #define GOWIN_EDID_BYTE_LENGTH     256
+#define GOWIN_TX_RING_SIZE         512 // one request incl. 256byte payload + ACK/NACK replies, power of 2
 
 #define GOWIN_ACK                  0x06u // command executed successfully
 #define GOWIN_NACK                 0x15u // command not executed (NACK)
@@ -95,7 +99,13 @@ typedef struct {
     u8 param;
 } t_gowin_msg;
 
-EXTERN t_gowin_msg GOWIN_MSG_QUEUE[GOWIN_MSG_QUEUE_SIZE];  // Max 5 pending messages
+// queue priority, a higher priority message is sent first
+typedef enum {
+    GOWIN_PRIO_POWER = 0, // standby, fpga, panel power/voltage, backlight: kept in order
+    GOWIN_PRIO_CONTROL,   // write protect, status reads, any other cmd
+    GOWIN_PRIO_BULK,      // EDID/DPCD read/write (256 bytes)
+    GOWIN_PRIO_NUM
+} t_gowin_prio;
 
 typedef struct {
     u8 * MsgBuf;        // pointer to buffer where the decoded message will be stored
@@ -112,7 +122,6 @@ typedef struct {
     u8 WaitForReply;   // flag to indicate we are waiting for a reply
     u8 ReplyCount;     // keep track of the number of replies
     u8 RetryCounter;   // keep track of the number of retries
-    u16 TimeoutCount;  // reply timeout counter
     u8 RxBusy;         // busy flag
     u8 verifyReadBack; // verify flag, meant for edid/dpcd-write verification
 } t_gowin_data;
@@ -134,8 +143,40 @@ const char * returnStateName(t_gowin_state val);
  * @param uart_channel ( UART2 -> Gowin FPGA)
  */
 EXTERN int8_t GOWIN_Protocol(t_uart_channel uart_channel);
+
+/*
+ * @brief GOWIN_TX_SendMsg
+ * Queue a command (+ EDID/DPCD payload) in the TX ring, the UART interrupt
+ * transmits it. A request enters GOWIN_WAIT_FOR_TX; GOWIN_Protocol moves on to
+ * the reply state once the last byte left the shift register.
+ * @return -1 if the ring has no room, otherwise 0
+ */
 EXTERN int8_t GOWIN_TX_SendMsg(t_gowin_command cmd);
 
+/*
+ * @brief GOWIN_TX_IRQHandler
+ * TX part of the Gowin UART IRQ: ring -> FIFO, completion on TX idle
+ */
+void GOWIN_TX_IRQHandler(void);
+
+#ifdef UNIT_TEST
+/*
+ * @brief GOWIN_TX_fake_transmit
+ * Native port: 'transmit' the ring into buf (no UART) and complete the frame
+ * @return number of bytes
+ */
+u16 GOWIN_TX_fake_transmit(u8 * buf,
+                           u16 size);
+#endif
+
+/*
+ * @brief GOWIN_Busy
+ * @return true while a message is unhandled or the queue is not empty
+ *         -> GOWIN_Protocol needs to run again. An awaited reply is not
+ *         busy: rx bytes or the reply timer (SCHED_EV_GOWIN_RX) wake it.
+ */
+bool GOWIN_Busy(void);
+
 t_gowin_state GOWIN_Protocol_state_get(void);
 void GOWIN_Protocol_state_set(t_gowin_state state);
 
@@ -154,9 +195,18 @@ unsigned int GOWIN_Compare_EdidDpcd(u8 * block1,
                                     const char * logtxt);
 void GOWIN_Print_edid_in_log(unsigned index);
 
-u8   GOWIN_QueueIndex_get();
+/*
+ * Message queue: one FIFO of GOWIN_MSG_QUEUE_SIZE per t_gowin_prio, one
+ * message in flight until its reply, resent GOWIN_MSG_RETRY_MAX times on a
+ * reply timeout and then dropped (PerfCounters GowinRetryDrop). A message for
+ * a setting that is already pending (write protect on/off, EDID write of the
+ * same index ...) replaces the pending one in place (GowinCoalesced), in the
+ * power FIFO only the newest pending message, so the power and backlight
+ * sequence keeps its order. A full FIFO drops the new message (GowinQueueDrop).
+ */
+t_gowin_command GOWIN_Queue_current(); // in flight, NO_GOWIN_CMD if none
 void GOWIN_Queue_Init();
-u8   GOWIN_Queue_size();
+u8   GOWIN_Queue_size();              // pending + in flight
 void GOWIN_Queue_Tx_Msg(t_gowin_command cmd);
 void GOWIN_Queue_Tx_Msg_Index(t_gowin_command cmd,
                               u8 storage_index);
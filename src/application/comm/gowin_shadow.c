@@ -0,0 +1,74 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : gowin_shadow.c
+* Author              : Barco
+* created             : 12/10/2022
+* Description         : Shadow of the EDID/DPCD tables held by the Gowin FPGA
+* History:
+* 12/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#include "gowin_shadow.h"
+
+#include "crc.h"
+#include "logger.h"
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+typedef struct {
+    u32 crc[GOWIN_SHADOW_HALVES];     // !< FPGA content per half
+    u32 pending[GOWIN_SHADOW_HALVES]; // !< write in flight, until its ACK
+    u8 valid;                         // !< bitmap: halves with known content
+} t_gowin_shadow;
+
+static t_gowin_shadow _shadow[GOWIN_TABLE_NUM];
+
+// halves the FPGA keeps per table
+static const u8 _halves[GOWIN_TABLE_NUM] = {
+    GOWIN_SHADOW_HALVES, // EDID
+    1,                   // DPCD: 128 bytes
+};
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+static u32 _crc(const u8 * data,
+                u8 half) {
+    return crc_run_crc32((u8 *)data + half * GOWIN_SHADOW_HALF, GOWIN_SHADOW_HALF);
+}
+
+void gowin_shadow_invalidate(void) {
+    for (u8 table = 0; table < GOWIN_TABLE_NUM; table++)
+        _shadow[table].valid = 0;
+}
+
+u8 gowin_shadow_dirty(t_gowin_table table,
+                      const u8 * data) {
+    t_gowin_shadow * shadow = &_shadow[table];
+    u8 dirty = 0;
+
+    for (u8 half = 0; half < _halves[table]; half++) {
+        shadow->pending[half] = _crc(data, half);
+        if (!(shadow->valid & (1U << half)) || (shadow->pending[half] != shadow->crc[half]))
+            dirty |= 1U << half;
+    }
+    LOG_DEBUG("gowin shadow %s dirty [0x%x]", (table == GOWIN_TABLE_EDID) ? "EDID" : "DPCD", dirty);
+    return dirty;
+}
+
+void gowin_shadow_commit(t_gowin_table table) {
+    t_gowin_shadow * shadow = &_shadow[table];
+
+    for (u8 half = 0; half < _halves[table]; half++)
+        shadow->crc[half] = shadow->pending[half];
+    shadow->valid = (1U << _halves[table]) - 1U;
+}
+
+void gowin_shadow_learn(t_gowin_table table,
+                        const u8 * data) {
+    t_gowin_shadow * shadow = &_shadow[table];
+
+    for (u8 half = 0; half < _halves[table]; half++)
+        shadow->crc[half] = _crc(data, half);
+    shadow->valid = (1U << _halves[table]) - 1U;
+}
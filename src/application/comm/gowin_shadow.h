@@ -0,0 +1,64 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : gowin_shadow.h
+* Author              : Barco
+* created             : 12/10/2022
+* Description         : Shadow of the EDID/DPCD tables held by the Gowin FPGA
+*
+*   Per table the CRC32 of each GOWIN_SHADOW_HALF bytes the FPGA acknowledged
+*   (write ACK) or returned (readback). Before a write the table is compared
+*   half by half, an unchanged table is not sent again. The Gowin protocol only
+*   writes whole tables: one dirty half sends the table. The FPGA keeps 128
+*   bytes of DPCD, changes in the upper half are not sent.
+*
+*   The shadow starts invalid and is invalidated when the FPGA may have lost
+*   its content: reconfigure, WAKE_UP from the FPGA, reply timeout.
+*
+* History:
+* 12/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#ifndef _GOWIN_SHADOW_H_
+#define _GOWIN_SHADOW_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "data_map.h"
+
+#define GOWIN_SHADOW_HALF   128 // !< dirty granularity [bytes]
+#define GOWIN_SHADOW_HALVES (EDID_SIZE / GOWIN_SHADOW_HALF)
+
+typedef enum {
+    GOWIN_TABLE_EDID = 0,
+    GOWIN_TABLE_DPCD,
+    GOWIN_TABLE_NUM
+} t_gowin_table;
+
+/**
+ * @brief  Forget the content of all tables, the next writes are sent
+ */
+void gowin_shadow_invalidate(void);
+
+/**
+ * @brief  Compare a table about to be written with the FPGA content
+ *
+ * The CRCs are kept until gowin_shadow_commit (write acknowledged).
+ *
+ * @param data EDID_SIZE bytes
+ * @returns bitmap of the halves that differ (or are unknown), 0: skip the write
+ */
+u8 gowin_shadow_dirty(t_gowin_table table,
+                      const u8 * data);
+
+/**
+ * @brief  The write of the last gowin_shadow_dirty table was acknowledged
+ */
+void gowin_shadow_commit(t_gowin_table table);
+
+/**
+ * @brief  Readback: the FPGA holds this table
+ */
+void gowin_shadow_learn(t_gowin_table table,
+                        const u8 * data);
+
+#endif /* _GOWIN_SHADOW_H_ */
@@ -33,6 +33,9 @@
 #endif
 
 #include "logger.h"
+#include "tracer.h"
+
+#include "data_map.h"
 
 /*******************************************************************************
  * Variables
@@ -74,6 +77,7 @@ const u8 COMM_ESC = COMM_ESCAPE;
 //  The ADR is the first byte of the *data stream
 // ------------------------------------------------------------------------------
 t_comm_protocol_return_value COMM_Protocol(t_uart_channel uart_channel) {
+    TRACE_SCOPE("COMM_Protocol");
     u8 c;
 
     while (UART_DATA[uart_channel].RxBufWr != UART_DATA[uart_channel].RxBufRd) {
@@ -154,6 +158,7 @@ t_comm_protocol_return_value COMM_Protocol(t_uart_channel uart_channel) {
                         if (COMM_DATA[uart_channel].BadMsgCount < 0xFFFF) {
                             COMM_DATA[uart_channel].BadMsgCount++; // increment bad msg counter
                         }
+                        PERF_COUNT(ChecksumError);
                         return CRC_ERROR;
                     }
                     break;
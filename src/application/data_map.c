@@ -41,7 +41,9 @@ const u8 * IdentifierInternalAddress[] = {
     (u8 *)&Main.GowinPartitionInfo,
     (u8 *)&Main.Edid,
     (u8 *)&Main.Dpcd,
-    0 // debugLog
+    0, // debugLog
+    (u8 *)&Main.PerfCounters,
+    (u8 *)&Main.LoopStats
 };
 
 const u8 IdentifierAccessType[NumberOfIdentifiers] = {
@@ -53,7 +55,9 @@ const u8 IdentifierAccessType[NumberOfIdentifiers] = {
     READ,  // GowinPartitionInfo
     WRITE, // Edid
     WRITE, // Dpcd
-    0      // DebugLog
+    0,     // DebugLog
+    READ,  // PerfCounters, cleared with byte write 0x60
+    READ   // LoopStats, reset with byte write 0x70
 };
 
 const u32 IdentifierMaxLength[NumberOfIdentifiers] = {
@@ -65,7 +69,9 @@ const u32 IdentifierMaxLength[NumberOfIdentifiers] = {
     sizeof(Main.GowinPartitionInfo),
     sizeof(Main.Edid),
     sizeof(Main.Dpcd),
-    0
+    0,
+    sizeof(Main.PerfCounters),
+    sizeof(Main.LoopStats)
 };
 
 /** DisplayPort Configuration Data **
@@ -242,6 +248,8 @@ void initialize_global_data_map() {
 
     initializeEdidDpcd();
 
+    clear_perf_counters();
+
     memset(Main.Debug.eeprom, 0, EEPROM_SIZE);
     memcpy(Main.Debug.eeprom, eepromInitValues, sizeof(eepromInitValues) * sizeof(u8));
 
@@ -271,6 +279,8 @@ void initialize_global_data_map() {
         struct spi_ctxt_t spi_ctxt = get_spi_rom_context();
         Main.GowinPartitionInfo.gowin[0] = spi_ctxt.gowin[0];
         Main.GowinPartitionInfo.gowin[1] = spi_ctxt.gowin[1];
+        Main.GowinPartitionInfo.crc = spi_ctxt.crc;
+        Main.GowinPartitionInfo.part = spi_ctxt.part; // always 0, the FPGA loads spi0
         LOG_INFO("SPI partition bitfile crc %.8x", Main.GowinPartitionInfo.gowin[0].bitfile_crc);
         LOG_INFO("SPI partition bitfile size %.8x", Main.GowinPartitionInfo.gowin[0].bitfile_size);
     }
@@ -298,6 +308,15 @@ void initialize_global_data_map() {
 #endif
 }
 
+/** clear_perf_counters()
+ * @brief  Restart all PerfCounters, maxima included
+ *
+ * @returns  void
+ */
+void clear_perf_counters(void) {
+    memset((u8 *)&Main.PerfCounters, 0x00, sizeof(Main.PerfCounters));
+}
+
 /** store_edid_data()
  * @brief  Fill in the EDID data in the selected EDID buffer
  *
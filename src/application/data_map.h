@@ -44,7 +44,7 @@ typedef struct __attribute__((packed)) { // pack to 1-byte structure!
 typedef struct __attribute__((packed)) { // pack to 1-byte structure!
     u8 byteTestRegister;
     u32 intTestRegister;
-    u8 SpiFlashPage[SPIFLASHPAGE_SIZE];
+    u8 SpiFlashPage[2][SPIFLASHPAGE_SIZE]; // 0x61 readback, ping-pong (i2c_slave_addr.c)
     u8 eeprom[EEPROM_SIZE];
     u8 eeprom_address_cnt; // auto increment for reading eeprom 24c02 emulation
 } Debug_t;
@@ -91,6 +91,92 @@ typedef struct __attribute__((packed)) { // pack to 1-byte structure!
     u8 Dpcd3[EDID_SIZE];
 } Dpcd_t;
 
+/* PerfCounters definition
+ * Updated from the hot paths and interrupts, all fields are u32 so they can be
+ * read one by one with the 4-byte read (0x60 + index) or as a block with
+ * CMD_ID_PERFCOUNTERS. Counters are free running and wrap, the host computes
+ * rates from the difference between two samples. Byte write 0x60 clears all.
+ */
+#define PERF_UART_CHANNELS  3 // MainCPU, Gowin, 2nd CPU (t_uart_channel order)
+typedef struct __attribute__((packed)) { // pack to 1-byte structure!
+    u32 MainLoopCount;       // main-loop iterations
+    u32 MainLoopMaxUs;       // worst-case main-loop iteration time (us)
+    u32 UartOverrun[PERF_UART_CHANNELS]; // rx fifo overflow or rx ring overwritten
+    u32 ChecksumError;       // protocol messages dropped on a bad checksum
+    u32 GowinNack;           // NACK replies from the Gowin
+    u32 GowinTimeout;        // Gowin reply timeouts
+    u32 SpiQueueHighWater;   // max pending SPI messages
+    u32 I2cSlaveError;       // unknown address/event or completion timeout
+    u32 IdleSleeps;          // scheduler WFI entries
+    u32 GowinQueueDrop;      // Gowin messages dropped, queue full
+    u32 GowinCoalesced;      // Gowin messages replaced by a newer value
+    u32 GowinWriteSkipped;   // EDID/DPCD writes dropped, FPGA table unchanged
+    u32 I2cPagePrefetchHit;  // 0x61 page reads served from the prefetched page
+    u32 SpiReadMaxUs;        // worst-case spi queue page read, start to data (us)
+    u32 SpiProgramMaxUs;     // worst-case spi queue page program, start to write cycle end (us)
+    u32 SpiEraseMaxUs;       // worst-case spi queue erase, start to write cycle end (us)
+    u32 SpiWipPolls;         // write cycle polls of the spi queue, flash still busy
+    u32 SpiQueueOverflow;    // spi messages rejected, queue full
+    u32 SpiQueueMaxWaitUs;   // worst-case spi message queued to started (us)
+    u32 SpiMerged;           // spi messages merged into an other's batch
+    u32 SpiMuxSwitches;      // spi mux switched to the GP
+    u32 SpiMuxLeases;        // spi mux leases granted
+    u32 SpiMuxHoldMaxUs;     // worst-case time the GP held the spi flash (us)
+    u32 SpiMuxTimeouts;      // spi mux leases refused, Gowin loading its bitfile
+    u32 SpiMuxRevoked;       // spi mux leases taken back for a Gowin reconfigure
+    u32 SpiCacheHit;         // spi flash pages served from the page cache
+    u32 SpiCacheMiss;        // spi flash pages read, not cached
+    u32 GowinRetryDrop;      // Gowin messages dropped, unanswered after GOWIN_MSG_RETRY_MAX resends
+} PerfCounters_t;
+
+#define PERF_COUNTERS_NUM   (sizeof(PerfCounters_t) / sizeof(u32))
+
+// cheap enough for interrupt context, a clear may race with one update
+#define PERF_COUNT(counter) (Main.PerfCounters.counter++)
+#define PERF_MAX(counter, value) \
+    do { \
+        if ((u32)(value) > Main.PerfCounters.counter) \
+            Main.PerfCounters.counter = (u32)(value); \
+    } while (0)
+
+/* LoopStats definition
+ * Cycle accounting of the superloop (see loop_stats.h), one entry per task
+ * and one for the whole iteration. Array read CMD_ID_LOOPSTATS with the task
+ * index as offset returns one entry, index LOOP_TASK_NUM returns the trailer
+ * (CoreClockHz, SampleShift). Byte write 0x70 resets, 0x71 sets SampleShift.
+ */
+#define LOOPSTATS_BUCKETS   20 // log2 histogram, last bucket >= 2^19 cycles
+typedef enum {
+    LOOP_TASK_COMM,          // COMM_Protocol(UART1)
+    LOOP_TASK_COMM_HANDLER,  // comm_handler(), only when a message is pending
+    LOOP_TASK_CPU2,          // 2nd CPU protocol + handler (BOARD_GAIA only)
+    LOOP_TASK_GOWIN,         // GOWIN_Protocol(UART2)
+    LOOP_TASK_GOWIN_HANDLER, // comm_handler_gowin(), only when a message is pending
+    LOOP_TASK_I2C,           // i2c_update()
+    LOOP_TASK_SPI,           // spi_master_update()
+    LOOP_TASK_GPIO,          // _handle_gpio_request()
+    LOOP_TASK_TIMER,         // timer_process(), expired timers and their callbacks
+    LOOP_TASK_SPI_UPDATE,    // spi_update_process(), bitfile stream into spi flash
+    LOOP_TASK_I2C_STREAM,    // i2c_stream_process(), spi flash pages to i2c
+    LOOP_TASK_ITERATION,     // whole main-loop iteration, never sampled
+    LOOP_TASK_NUM
+} LoopTask_t;
+
+typedef struct __attribute__((packed)) { // pack to 1-byte structure!
+    u32 Count;               // number of samples
+    u32 Min;                 // cycles
+    u32 Max;                 // cycles
+    u32 Mean;                // cycles, calculated when read
+    uint64_t Sum;            // cycles
+    u32 Histogram[LOOPSTATS_BUCKETS]; // [n]: 2^n <= cycles < 2^(n+1), [0] includes 0
+} LoopStatsEntry_t;
+
+typedef struct __attribute__((packed)) { // pack to 1-byte structure!
+    LoopStatsEntry_t Task[LOOP_TASK_NUM];
+    u32 CoreClockHz;         // cycles per second
+    u32 SampleShift;         // tasks are timed every 2^SampleShift iterations
+} LoopStats_t;
+
 /* MainMcuRegisterStructure definition */
 struct bootloader_ctxt_t; // type defined in bootloader.h
 struct spi_ctxt_c; // type defined in bootloader_spi.h
@@ -105,6 +191,8 @@ typedef struct {
     Edid_t Edid __attribute__((aligned));
     Dpcd_t Dpcd __attribute__((aligned));
     log_mem_ctxt_t sramLogData __attribute__((aligned));
+    PerfCounters_t PerfCounters __attribute__((aligned));
+    LoopStats_t LoopStats __attribute__((aligned));
 } MainMcuRegisterStructure_t;
 
 /* Address identifier definition */
@@ -119,6 +207,8 @@ typedef enum AddressIdentifier {
     Edid,
     Dpcd,
     DebugLog, // SharedRam with boot-code
+    PerfCounters,
+    LoopStats,
     // add here
     NumberOfIdentifiers
 }AddressIdentifier_t;
@@ -145,6 +235,7 @@ extern void _bootloader_swap_partitions(struct bootloader_ctxt_t * bctxt);
  * @returns void
  */
 extern void initialize_global_data_map();
+extern void clear_perf_counters(void);
 extern app_partition_t switch_boot_partition();
 extern void store_edid_data(u8 index,
                             u8 * data);
@@ -8,19 +8,23 @@
 * History:
 * 01/10/2021 : introduced in gpmcu code     - DAVTH
 * 07/02/2022 : eeprom address 0x62 added    - DAVTH
+* 14/10/2022 : streamed spi flash programming on 0x63, see i2c_stream.h
+* 16/10/2022 : buffers per address and port (i2c_slave_addr.c), 0x61 ping-pong
+* 19/10/2022 : buffers handed out in the event order of the vendor driver
 *******************************************************************************/
 
 #define _I2C_SLAVE_C_
 
 #include "i2c_slave.h"
+#include "i2c_slave_addr.h"
 #include "fsl_i2c.h"
-#include "run/comm_run.h"
+#include "spi/spi_master.h"
 #include "data_map.h"
+#include "scheduler.h"
+#include "timer_wheel.h"
 
-#ifndef UNIT_TEST
 #include <board.h>
 #include "peripherals.h"
-#endif
 
 #include "logger.h"
 
@@ -31,17 +35,10 @@
 #define FLEXCOMM_I2C_MAINCPU_SLAVE   ((I2C_Type *)BOARD_I2C_MAINCPU_BASE)
 #define FLEXCOMM_I2C_USB_SLAVE       ((I2C_Type *)BOARD_I2C_USB_USART)
 
-#define I2C_MASTER_SLAVE_ADDR_7BIT   (0x60U)
-#define I2C_MASTER_SLAVE_ADDR_BIS    (I2C_MASTER_SLAVE_ADDR_7BIT + 1)
-#define I2C_MASTER_SLAVE_ADDR_EEPROM (I2C_MASTER_SLAVE_ADDR_7BIT + 2)
-#define I2C_FLASH_CMD_IDENTIFIER     (0x50u)
-#define I2C_CMD_LENGTH               (2) // Typical/default command length
-#define I2C_DATA_LENGTH              (256) // MAX is 256
-#define I2C_EMULATED_EEPROM_SIZE     (EEPROM_SIZE) // define in data_map.h
+#define I2C_TIMEOUT_MS               500 // address match -> completion
 
-#define I2C_TOGGLE_TX_SIZE_CMD       0xff // Command for selecting page or per byte r/w
-
-#define I2C_TIMEOUT_LOOPS            0x1FFFF // to do: make this a timer independent of clk
+#define I2C_SLAVE_EVENTS             (kI2C_SlaveAddressMatchEvent | kI2C_SlaveCompletionEvent | \
+                                      kI2C_SlaveDeselectedEvent)
 
 /*******************************************************************************
  * Prototypes
@@ -51,14 +48,19 @@
  * Variables
  ******************************************************************************/
 
-uint8_t g_slave_buff[I2C_DATA_LENGTH]; // we share the buffer for both ports
+// per port (userData): the transfer in progress, the buffers are per address
+typedef struct {
+    u8 address;
+    bool read;
+    bool open; // buffer handed out, not completed yet
+} t_i2c_port;
+
+static t_i2c_port g_port_maincpu;
+static t_i2c_port g_port_usb;
 i2c_slave_handle_t g_s_handle_maincpu;
 i2c_slave_handle_t g_s_handle_usb;
 volatile bool g_SlaveCompletionFlag = false;
-
-// Switch between sending whole page in blocks or per byte
-volatile bool g_SlaveTxPageSize = false;
-volatile bool g_SlaveTxEepromSize = false;
+static Timer_t CompletionTimer = TIMER_EVENT_INIT(SCHED_EV_I2C);
 
 /*******************************************************************************
  * Code
@@ -74,189 +76,99 @@ void BOARD_I2C_USB_FLEXCOMM_IRQ(void) {
     SDK_ISR_EXIT_BARRIER;
 }
 
+// completion, or a stop/repeated start before the buffer was consumed
+// (smbus block read of 32 bytes from a 256 byte page, offset write)
+static void i2c_slave_close(t_i2c_port * port,
+                            volatile i2c_slave_transfer_t * xfer) {
+    if (!port->open)
+        return;
+    port->open = false;
+    xfer->rxData = NULL; // the buffer is the address's again
+    xfer->rxSize = 0;
+    xfer->txData = NULL;
+    xfer->txSize = 0;
+    if (!i2c_slave_addr_done(port->address, port->read, (u16)xfer->transferredCount)) {
+        LOG_WARN("{0x%02X} uncovered kI2C_SlaveCompletionEvent event", port->address);
+        PERF_COUNT(I2cSlaveError);
+    }
+    g_SlaveCompletionFlag = true;
+    sched_post(SCHED_EV_I2C | SCHED_EV_REQUEST); // a write may have queued gowin/spi work
+}
+
+// hand out the buffer of the address just matched, zero-copy for reads
+static void i2c_slave_open(t_i2c_port * port,
+                           volatile i2c_slave_transfer_t * xfer) {
+    u16 size = 0;
+
+    i2c_slave_close(port, xfer); // repeated start, the previous buffer was not consumed
+    port->address = (xfer->receivedAddress) >> 1;
+    port->read = (xfer->receivedAddress) & 0x01; // READ = 1 , WRITE = 0
+    port->open = true;
+    if (port->read) {
+        xfer->txData = i2c_slave_addr_tx(port->address, &size);
+        xfer->txSize = size;
+    } else {
+        xfer->rxData = i2c_slave_addr_rx(port->address, &size);
+        xfer->rxSize = size;
+    }
+    if (size == 0) {
+        LOG_WARN("%s UNKNOWN ADDRESS %02X",
+                 (port->read) ? "kI2C_SlaveTransmitEvent" : "kI2C_SlaveReceiveEvent",
+                 port->address);
+        PERF_COUNT(I2cSlaveError);
+    }
+}
+
+/*
+ * The vendor driver (I2C_SlaveTransferHandleIRQ) asks for the buffer with
+ * kI2C_SlaveTransmitEvent/kI2C_SlaveReceiveEvent while it handles the
+ * address, before kI2C_SlaveAddressMatchEvent, and again when a buffer ran
+ * out within the transfer. Each event takes the address and direction from
+ * xfer->receivedAddress, it is set before either.
+ */
 static void i2c_slave_callback(__attribute__((unused)) I2C_Type * base,
-                               __attribute__((unused)) volatile i2c_slave_transfer_t * xfer,
-                               __attribute__((unused)) void * userData) {
-    u8 identifier;
+                               volatile i2c_slave_transfer_t * xfer,
+                               void * userData) {
+    t_i2c_port * port = (t_i2c_port *)userData;
     u8 address = (xfer->receivedAddress) >> 1;
     bool read = (xfer->receivedAddress) & 0x01; // READ = 1 , WRITE = 0
-    static u16 expectedBytes = 0;
-    // keep verbose 'false' for SPI Flash program speed, 'true' for debug
-    bool verbose = false;
 
     switch (xfer->event) {
-        /* Transmit request  - FIRST EVENT without data */
+        /* Transmit request - FIRST EVENT without data, zero-copy from the address data */
         case kI2C_SlaveTransmitEvent:
-            identifier = *((uint8_t *)userData);
-            if (verbose)
-                LOG_DEBUG("{0x%02X} kI2C_SlaveTransmitEvent requested byte Id(%x)@%02X %s",
-                          address, identifier, address, (read) ? "READ" : "WRITE");
-
-            if ( read ) {
-                switch (address) {
-                    case I2C_MASTER_SLAVE_ADDR_7BIT:
-                        g_slave_buff[0] = byteReadbyId(identifier);
-                        xfer->txSize = 1;
-                        break;
-                    case I2C_MASTER_SLAVE_ADDR_BIS: // readback spi flash data
-                        if (g_SlaveTxPageSize) {
-                            // This means we will need to read 256 bytes !
-                            memcpy(g_slave_buff, Main.Debug.SpiFlashPage, I2C_DATA_LENGTH);
-                            xfer->txSize = I2C_DATA_LENGTH;
-                        } else {
-                            g_slave_buff[0] = Main.Debug.SpiFlashPage[identifier];
-                            xfer->txSize = 1;
-                        }
-                        break;
-                    case I2C_MASTER_SLAVE_ADDR_EEPROM: // 24c02 eeprom behaviour
-                        if (g_SlaveTxEepromSize) {
-                            memcpy(g_slave_buff, Main.Debug.eeprom, I2C_EMULATED_EEPROM_SIZE);
-                            xfer->txSize = I2C_EMULATED_EEPROM_SIZE;
-                        } else {
-                            if (identifier >= I2C_EMULATED_EEPROM_SIZE)
-                                g_slave_buff[0] = 0x00;
-                            else {
-                                if (identifier > 0)
-                                    Main.Debug.eeprom_address_cnt = identifier;
-
-                                g_slave_buff[0] =
-                                    Main.Debug.eeprom[Main.Debug.eeprom_address_cnt++];
-                            }
-                            if (Main.Debug.eeprom_address_cnt >= I2C_EMULATED_EEPROM_SIZE)
-                                Main.Debug.eeprom_address_cnt = 0;
-
-                            xfer->txSize = 1;
-                        }
-                        break;
-                    default:
-                        LOG_WARN("kI2C_SlaveTransmitEvent UNKNOWN ADDRESS %02X", address);
-                        break;
-                }
-            }
-            xfer->txData = &g_slave_buff[0];
-            break;
-
         /* Setup the slave receive buffer - FIRST EVENT when data byte is received */
         case kI2C_SlaveReceiveEvent:
-            if (verbose)
-                LOG_DEBUG("{0x%02X} kI2C_SlaveReceiveEvent -- count[%d] expected[%d] %s",
-                          address, xfer->transferredCount, (int)xfer->rxSize, (read) ? "READ" :
-                          "WRITE");
-            /*  Update information for received process */
-            xfer->rxData = g_slave_buff;
-            if ( !read ) { // WRITE
-                if (verbose)
-                    LOG_DEBUG("{0x%02X} kI2C_SlaveReceiveEvent -- 1st data byte [0x%02X]",
-                              g_slave_buff[0]);
-                switch (address) {
-                    case I2C_MASTER_SLAVE_ADDR_7BIT:
-                        if (expectedBytes > 0) {
-                            xfer->rxSize = expectedBytes;
-                            g_SlaveCompletionFlag = true; // disable timeout during eeprom flash
-                        } else
-                            xfer->rxSize = I2C_CMD_LENGTH;
-                        break;
-                    case I2C_MASTER_SLAVE_ADDR_BIS: // readback spi flash data
-                        xfer->rxSize = I2C_CMD_LENGTH;
-                        break;
-                    case I2C_MASTER_SLAVE_ADDR_EEPROM: // eeprom behaviour
-                        Main.Debug.eeprom_address_cnt = g_slave_buff[0];
-                        if (g_SlaveTxEepromSize)
-                            xfer->rxSize = I2C_EMULATED_EEPROM_SIZE;
-                        else
-                            xfer->rxSize = I2C_CMD_LENGTH;
-                        break;
-                    default:
-                        LOG_WARN("kI2C_SlaveReceiveEvent UNKNOWN ADDRESS %02X", address);
-                }
-            }
+            i2c_slave_open(port, xfer);
             break;
 
         /* Address match event - 2ND EVENT */
         case kI2C_SlaveAddressMatchEvent:
-            if (((xfer->receivedAddress) >> 1) != address) // <- for debug
-                LOG_WARN("i2c address mismatch");
-            g_SlaveCompletionFlag = false;
-            if (verbose)
-                LOG_DEBUG("{0x%02X} kI2C_SlaveAddressMatchEvent - %s", address, (read) ? "READ" :
-                          "WRITE");
-            xfer->rxData = NULL;
-            xfer->rxSize = 0;
+            // no buffer was asked for: a repeated start while the previous
+            // transfer's buffer still had room, that one is not for this transfer
+            if (!port->open || (xfer->transferredCount != 0) || (port->address != address) ||
+                (port->read != read)) {
+                i2c_slave_open(port, xfer);
+                xfer->transferredCount = 0;
+            }
+            // disable timeout during eeprom flash
+            g_SlaveCompletionFlag = !read && (address == I2C_MASTER_SLAVE_ADDR_7BIT) &&
+                                    i2c_slave_addr_expecting();
+            sched_post(SCHED_EV_I2C); // completion timeout runs
             break;
 
-        /* The master has sent a stop transition on the bus */
+        /* All data of the buffer consumed */
         case kI2C_SlaveCompletionEvent:
-            g_SlaveCompletionFlag = true;
-            if ( !read ) { // WRITE
-                switch (address) {
-                    case I2C_MASTER_SLAVE_ADDR_EEPROM:
-                        if ( xfer->transferredCount == I2C_CMD_LENGTH ) {
-                            if ( g_slave_buff[0] == I2C_TOGGLE_TX_SIZE_CMD ) {
-                                g_SlaveTxEepromSize = (g_slave_buff[1] == 1);
-                                LOG_DEBUG("{0x%02x} Set tx to MaxSize (8byte) %s", address,
-                                          ((g_SlaveTxEepromSize) ? "ON" : "OFF"));
-                            }
-                        }
-                        if ( xfer->transferredCount > 8 )
-                            LOG_WARN("{0x%02x} xfer->transferredCount %x", address,
-                                     xfer->transferredCount);
-                        // I2C_EMULATED_EEPROM_SIZE-byte write supported
-                        if ( xfer->transferredCount == 8 ) {
-                            for (int i = 0; i < I2C_EMULATED_EEPROM_SIZE; i++) {
-                                Main.Debug.eeprom[i] = g_slave_buff[i];
-                            }
-                        }
-                        // 1 byte with index write
-                        else {
-                            Main.Debug.eeprom[g_slave_buff[0]] = g_slave_buff[1];
-                        }
-                        break;
-                    case I2C_MASTER_SLAVE_ADDR_BIS:
-                        // we have the page transfer tx-size i2cde  disabled by default for i2cdetect
-                        // Page transfer speeds up reading back the SPI flash data per 256byte
-                        if ( xfer->transferredCount == I2C_CMD_LENGTH ) {
-                            if (g_slave_buff[0] == I2C_TOGGLE_TX_SIZE_CMD ) {
-                                g_SlaveTxPageSize = (g_slave_buff[1] == 1);
-                                LOG_DEBUG("{0x%02x} Set Page tx to %s", address,
-                                          ((g_SlaveTxPageSize) ? "ON" : "OFF"));
-                            }
-                        }
-                        break;
-                    case I2C_MASTER_SLAVE_ADDR_7BIT:
-                        // Gateway to the SPI Flash if I2C_FLASH_CMD_IDENTIFIER
-                        if (expectedBytes > 0) { // Data coming in
-                            // This is the data packet following a previous command
-                            expectedBytes = byteWrite2SPI(g_slave_buff, expectedBytes);
-                        } else if (g_slave_buff[0] == I2C_FLASH_CMD_IDENTIFIER) {
-                            // This is the 2 byte command
-                            expectedBytes = byteWrite2SPI(g_slave_buff, I2C_CMD_LENGTH);
-                        } else if (xfer->transferredCount == I2C_CMD_LENGTH) { // Assume a write when we receive 2 bytes
-                            // Gowin UART write - data-byte (See Gowin Commands overview wiki)
-                            byteWritebyId(g_slave_buff[0], g_slave_buff[1]);
-                        }
-                        break;
-                    default:
-                        LOG_WARN("{0x%02X} uncovered kI2C_SlaveCompletionEvent event", address);
-                        break;
-                }
-            }
-            if (verbose) {
-                LOG_DEBUG(
-                    "{0x%02X} kI2C_SlaveCompletionEvent [%x %x]%x, transfer count[%d] Status[%X] %s",
-                    address,
-                    g_slave_buff[0],
-                    g_slave_buff[1],
-                    *((uint8_t *)userData),       // = g_slave_buff[0]
-                    xfer->transferredCount,
-                    xfer->completionStatus,
-                    (read) ? "READ" : "WRITE");
-                LOG_DEBUG("--- I2C_SlaveCompletionEvent --- ");
-            }
-            memset(g_slave_buff, 0, sizeof(g_slave_buff));
+            i2c_slave_close(port, xfer);
+            break;
+
+        /* The master has sent a stop transition on the bus */
+        case kI2C_SlaveDeselectedEvent:
+            i2c_slave_close(port, xfer);
             break;
 
         default:
             LOG_WARN("{0x%02X} uncovered i2c_slave_callback event(%02X)", address, xfer->event);
+            PERF_COUNT(I2cSlaveError);
             g_SlaveCompletionFlag = true;
             break;
     }
@@ -270,7 +182,9 @@ int i2c_slave_setup() {
     i2c_slave_config_t slaveConfig;
     status_t reVal = kStatus_Fail;
 
-    memset(g_slave_buff, 0, sizeof(g_slave_buff));
+    i2c_slave_addr_init();
+    memset(&g_port_maincpu, 0, sizeof(g_port_maincpu));
+    memset(&g_port_usb, 0, sizeof(g_port_usb));
 
     /* Set up i2c slave */
     I2C_SlaveGetDefaultConfig(&slaveConfig);
@@ -283,6 +197,9 @@ int i2c_slave_setup() {
     /* 3th address meant for eeprom simulation */
     slaveConfig.address2.address = I2C_MASTER_SLAVE_ADDR_EEPROM;
     slaveConfig.address2.addressDisable = false;
+    /* 4th address meant for streamed spi flash programming */
+    slaveConfig.address3.address = I2C_MASTER_SLAVE_ADDR_STREAM;
+    slaveConfig.address3.addressDisable = false;
 
     /* Initialize the I2C slave peripheral */
     I2C_SlaveInit(FLEXCOMM_I2C_MAINCPU_SLAVE, &slaveConfig, I2C_SLAVE_CLOCK_FREQUENCY);
@@ -290,20 +207,20 @@ int i2c_slave_setup() {
 
     /* Create the I2C handle for the non-blocking transfer */
     I2C_SlaveTransferCreateHandle(FLEXCOMM_I2C_MAINCPU_SLAVE, &g_s_handle_maincpu,
-                                  i2c_slave_callback, g_slave_buff);
+                                  i2c_slave_callback, &g_port_maincpu);
     I2C_SlaveTransferCreateHandle(FLEXCOMM_I2C_USB_SLAVE, &g_s_handle_usb, i2c_slave_callback,
-                                  g_slave_buff);
+                                  &g_port_usb);
 
     /* Start accepting I2C transfers on the I2C slave peripheral */
     reVal = I2C_SlaveTransferNonBlocking(FLEXCOMM_I2C_MAINCPU_SLAVE, &g_s_handle_maincpu,
-                                         kI2C_SlaveAddressMatchEvent | kI2C_SlaveCompletionEvent);
+                                         I2C_SLAVE_EVENTS);
     if (reVal != kStatus_Success) {
         LOG_WARN("i2c_slave_setup flexcomm maincpu failed");
         return -1;
     }
 
     reVal = I2C_SlaveTransferNonBlocking(FLEXCOMM_I2C_USB_SLAVE, &g_s_handle_usb,
-                                         kI2C_SlaveAddressMatchEvent | kI2C_SlaveCompletionEvent);
+                                         I2C_SLAVE_EVENTS);
     if (reVal != kStatus_Success) {
         LOG_WARN("i2c_slave_setup flexcomm usb failed");
         return -1;
@@ -317,21 +234,30 @@ int i2c_slave_setup() {
 }
 
 void i2c_update() {
-    static int timeout = I2C_TIMEOUT_LOOPS;
-
-    if (!g_SlaveCompletionFlag) {
-        // on 0x61 we need to read 256bytes, depending on g_SlaveTxPageSize
-        // on 0x62 we need to read 8 bytes
-        // Otherwise we pass here.
-        timeout--;
-        if (timeout == 0) {
-            LOG_WARN("i2c completion timeout");
-            timeout = I2C_TIMEOUT_LOOPS;
-            i2c_slave_disable();
-            i2c_slave_setup();
-        }
-    } else {
-        timeout = I2C_TIMEOUT_LOOPS;
+    u16 page;
+
+    // read ahead of the 0x61 page, keep a queue slot for the READ of the host
+    if (i2c_slave_page_prefetch(&page) && (spi_queue_size(false) < SPI_MSG_QUEUE_LENGTH - 1)) {
+        u8 msg[3] = { SPI_IS25_PREFETCH, (u8)(page >> 8), (u8)page };
+        spi_queue_msg_param(msg, sizeof(msg));
+    }
+
+    if (g_SlaveCompletionFlag) {
+        timer_cancel(&CompletionTimer);
+        return;
+    }
+    // on 0x61 we need to read 256bytes, depending on the page mode
+    // on 0x62 we need to read 8 bytes
+    // Otherwise we pass here.
+    if (timer_expired(&CompletionTimer)) {
+        LOG_WARN("i2c completion timeout");
+        PERF_COUNT(I2cSlaveError);
+        timer_cancel(&CompletionTimer);
+        i2c_slave_disable();
+        if (i2c_slave_setup() < 0)
+            timer_start(&CompletionTimer, I2C_TIMEOUT_MS); // retry
+    } else if (!timer_pending(&CompletionTimer)) {
+        timer_start(&CompletionTimer, I2C_TIMEOUT_MS);
     }
 }
 
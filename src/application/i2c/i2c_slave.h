@@ -2,6 +2,7 @@
 #define __I2C_SLAVE_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 
 typedef uint8_t u8;
 typedef uint16_t u16;
@@ -33,7 +34,8 @@ void i2c_slave_disable();
 
 /*
  * @brief i2c_update
- * update
+ * completion timeout while a transfer is in progress, runs on SCHED_EV_I2C
+ * (transfer started/completed, timeout timer expired)
  * @return void
  */
 void i2c_update();
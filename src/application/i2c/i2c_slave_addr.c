@@ -0,0 +1,329 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : i2c_slave_addr.c
+* Author              : Barco
+* created             : 16/10/2022
+* Description         : Per address side of the i2c slave, buffers and handlers
+*                       of 0x60..0x63, no hardware access: i2c_slave.c maps
+*                       the events of both ports onto it
+* History:
+* 16/10/2022 : introduced in gpmcu code, split from i2c_slave.c
+* 18/10/2022 : a fill that spans a program/erase is not kept as the page
+*******************************************************************************/
+
+#include <string.h>
+
+#include "i2c_slave_addr.h"
+#include "i2c_stream.h"
+#include "run/comm_run.h"
+
+#ifndef UNIT_TEST
+#include "fsl_device_registers.h"
+#define PAGE_LOCK()   __disable_irq()
+#define PAGE_UNLOCK() __enable_irq()
+#else
+#define PAGE_LOCK()
+#define PAGE_UNLOCK()
+#endif
+
+#include "logger.h"
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+// receive buffers, the first byte is the identifier of the next read
+static u8 _rx_cmd[I2C_DATA_LENGTH];              // !< 0x60, command or page data
+static u8 _rx_page[I2C_CMD_LENGTH];              // !< 0x61, offset or toggle
+static u8 _rx_eeprom[I2C_EMULATED_EEPROM_SIZE];  // !< 0x62, index + data
+static u8 _tx_byte;                              // !< 0x60 byte read
+static u8 _tx_status[I2C_STREAM_STATUS_LENGTH];  // !< 0x63 status register
+static const u8 _tx_zero = 0x00;
+
+static u16 _expected = 0;                        // !< 0x60 page data to come
+
+// Switch between sending whole page in blocks or per byte
+static volatile bool _tx_page_size = false;
+static volatile bool _tx_eeprom_size = false;
+
+// 0x61 ping-pong: the interrupt reads the front, the task fills the back
+static volatile u8 _front = 0;
+static volatile u16 _page_nr[2] = { I2C_PAGE_NONE, I2C_PAGE_NONE };
+static volatile u8 _page_readers = 0;            // !< 0x61 reads in progress
+static volatile bool _page_swap = false;         // !< publish the back after the read
+static volatile u16 _prefetch = I2C_PAGE_NONE;
+static volatile bool _back_stale = false;        // !< flash changed during the fill
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+#define BACK (_front ^ 1)
+
+static void _page_publish(void) { // locked or from the interrupt
+    if (_page_readers) {
+        _page_swap = true;
+    } else {
+        _front = BACK;
+        _page_swap = false;
+    }
+}
+
+void i2c_slave_addr_init(void) {
+    memset(_rx_cmd, 0, sizeof(_rx_cmd));
+    memset(_rx_page, 0, sizeof(_rx_page));
+    memset(_rx_eeprom, 0, sizeof(_rx_eeprom));
+    _page_readers = 0;
+    if (_page_swap)
+        _page_publish();
+}
+
+bool i2c_slave_addr_expecting(void) {
+    return _expected > 0;
+}
+
+// 0x61 page mode: the rest of the front page from the offset, else one byte
+static const u8 * _tx_page(u16 * size) {
+    const u8 * page = Main.Debug.SpiFlashPage[_front];
+    u8 offset = _rx_page[0];
+
+    _page_readers++;
+    if (!_tx_page_size) {
+        *size = 1;
+        return &page[offset];
+    }
+
+    u16 next = (u16)(_page_nr[_front] + 1);
+    if ((offset == 0) && (_page_nr[_front] != I2C_PAGE_NONE) &&
+        (next != I2C_PAGE_NONE) && (_page_nr[BACK] != next))
+        _prefetch = next;
+    *size = (u16)(I2C_DATA_LENGTH - offset);
+    return &page[offset];
+}
+
+// 0x62 24c02 eeprom behaviour
+static const u8 * _tx_eeprom(u16 * size) {
+    u8 identifier = _rx_eeprom[0];
+    const u8 * data = &_tx_zero;
+
+    *size = 1;
+    if (_tx_eeprom_size) {
+        *size = I2C_EMULATED_EEPROM_SIZE;
+        return Main.Debug.eeprom;
+    }
+    if (identifier < I2C_EMULATED_EEPROM_SIZE) {
+        if (identifier > 0)
+            Main.Debug.eeprom_address_cnt = identifier;
+        data = &Main.Debug.eeprom[Main.Debug.eeprom_address_cnt++];
+    }
+    if (Main.Debug.eeprom_address_cnt >= I2C_EMULATED_EEPROM_SIZE)
+        Main.Debug.eeprom_address_cnt = 0;
+    return data;
+}
+
+const u8 * i2c_slave_addr_tx(u8 address,
+                             u16 * size) {
+    switch (address) {
+        case I2C_MASTER_SLAVE_ADDR_7BIT:
+            _tx_byte = byteReadbyId(_rx_cmd[0]);
+            *size = 1;
+            return &_tx_byte;
+        case I2C_MASTER_SLAVE_ADDR_BIS: // readback spi flash data
+            return _tx_page(size);
+        case I2C_MASTER_SLAVE_ADDR_EEPROM:
+            return _tx_eeprom(size);
+        case I2C_MASTER_SLAVE_ADDR_STREAM: // streamed programming status
+            *size = i2c_stream_status(_tx_status);
+            return _tx_status;
+        default:
+            *size = 0;
+            return &_tx_zero;
+    }
+}
+
+u8 * i2c_slave_addr_rx(u8 address,
+                       u16 * size) {
+    switch (address) {
+        case I2C_MASTER_SLAVE_ADDR_7BIT:
+            *size = (_expected > 0) ? _expected : I2C_CMD_LENGTH;
+            return _rx_cmd;
+        case I2C_MASTER_SLAVE_ADDR_BIS:
+            *size = I2C_CMD_LENGTH;
+            return _rx_page;
+        case I2C_MASTER_SLAVE_ADDR_EEPROM:
+            Main.Debug.eeprom_address_cnt = _rx_eeprom[0];
+            *size = _tx_eeprom_size ? I2C_EMULATED_EEPROM_SIZE : I2C_CMD_LENGTH;
+            return _rx_eeprom;
+        case I2C_MASTER_SLAVE_ADDR_STREAM: // page goes straight in the fifo
+            *size = I2C_STREAM_FRAME_SIZE;
+            return i2c_stream_rx_buffer();
+        default:
+            *size = 0;
+            return _rx_cmd;
+    }
+}
+
+static void _done_cmd(u16 count) {
+    // Gateway to the SPI Flash if I2C_FLASH_CMD_IDENTIFIER
+    if (_expected > 0) { // Data coming in
+        // This is the data packet following a previous command
+        _expected = byteWrite2SPI(_rx_cmd, _expected);
+    } else if (_rx_cmd[0] == I2C_FLASH_CMD_IDENTIFIER) {
+        // This is the 2 byte command
+        _expected = byteWrite2SPI(_rx_cmd, I2C_CMD_LENGTH);
+    } else if (count == I2C_CMD_LENGTH) { // Assume a write when we receive 2 bytes
+        // Gowin UART write - data-byte (See Gowin Commands overview wiki)
+        byteWritebyId(_rx_cmd[0], _rx_cmd[1]);
+    }
+}
+
+static void _done_eeprom(u8 address,
+                         u16 count) {
+    if ((count == I2C_CMD_LENGTH) && (_rx_eeprom[0] == I2C_TOGGLE_TX_SIZE_CMD)) {
+        _tx_eeprom_size = (_rx_eeprom[1] == 1);
+        LOG_DEBUG("{0x%02x} Set tx to MaxSize (8byte) %s", address,
+                  ((_tx_eeprom_size) ? "ON" : "OFF"));
+        return;
+    }
+    if (count > 8)
+        LOG_WARN("{0x%02x} xfer->transferredCount %x", address, count);
+    // I2C_EMULATED_EEPROM_SIZE-byte write supported
+    if (count == 8)
+        memcpy(Main.Debug.eeprom, _rx_eeprom, I2C_EMULATED_EEPROM_SIZE);
+    // 1 byte with index write
+    else if ((count == I2C_CMD_LENGTH) && (_rx_eeprom[0] < I2C_EMULATED_EEPROM_SIZE))
+        Main.Debug.eeprom[_rx_eeprom[0]] = _rx_eeprom[1];
+}
+
+bool i2c_slave_addr_done(u8 address,
+                         bool read,
+                         u16 count) {
+    bool keep = !read && (count == 1); // the identifier of the read after it
+
+    switch (address) {
+        case I2C_MASTER_SLAVE_ADDR_7BIT:
+            if (!read)
+                _done_cmd(count);
+            if (!keep)
+                memset(_rx_cmd, 0, sizeof(_rx_cmd));
+            break;
+        case I2C_MASTER_SLAVE_ADDR_BIS:
+            if (read) {
+                if (_page_readers)
+                    _page_readers--;
+                if (_page_swap)
+                    _page_publish();
+            } else if ((count == I2C_CMD_LENGTH) && (_rx_page[0] == I2C_TOGGLE_TX_SIZE_CMD)) {
+                // we have the page transfer tx-size disabled by default for i2cdetect
+                // Page transfer speeds up reading back the SPI flash data per 256byte
+                _tx_page_size = (_rx_page[1] == 1);
+                LOG_DEBUG("{0x%02x} Set Page tx to %s", address,
+                          ((_tx_page_size) ? "ON" : "OFF"));
+            }
+            if (!keep)
+                memset(_rx_page, 0, sizeof(_rx_page));
+            break;
+        case I2C_MASTER_SLAVE_ADDR_EEPROM:
+            if (!read)
+                _done_eeprom(address, count);
+            if (!keep)
+                memset(_rx_eeprom, 0, sizeof(_rx_eeprom));
+            break;
+        case I2C_MASTER_SLAVE_ADDR_STREAM:
+            if (!read)
+                i2c_stream_received(count);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+bool i2c_slave_page_prefetch(u16 * page) {
+    PAGE_LOCK();
+    *page = _prefetch;
+    _prefetch = I2C_PAGE_NONE;
+    PAGE_UNLOCK();
+    return *page != I2C_PAGE_NONE;
+}
+
+const u8 * i2c_slave_page_lookup(u16 page) {
+    const u8 * data = NULL;
+
+    PAGE_LOCK();
+    if ((page != I2C_PAGE_NONE) && (_page_nr[BACK] == page)) {
+        data = Main.Debug.SpiFlashPage[BACK];
+        _page_publish();
+    } else if ((page != I2C_PAGE_NONE) && (_page_nr[_front] == page)) {
+        data = Main.Debug.SpiFlashPage[_front];
+        _page_swap = false; // already shown
+    }
+    PAGE_UNLOCK();
+    return data;
+}
+
+u8 * i2c_slave_page_back(u16 page,
+                         bool prefetch) {
+    u8 * data = NULL;
+
+    PAGE_LOCK();
+    if (!prefetch || (!_page_swap && (_page_nr[0] != page) && (_page_nr[1] != page))) {
+        _page_swap = false; // a newer READ wins
+        _page_nr[BACK] = I2C_PAGE_NONE;
+        _back_stale = false;
+        data = Main.Debug.SpiFlashPage[BACK];
+    }
+    PAGE_UNLOCK();
+    return data;
+}
+
+void i2c_slave_page_filled(u16 page,
+                           bool publish) {
+    PAGE_LOCK();
+    _page_nr[BACK] = _back_stale ? I2C_PAGE_NONE : page;
+    if (publish)
+        _page_publish();
+    PAGE_UNLOCK();
+}
+
+void i2c_slave_page_invalidate(void) {
+    PAGE_LOCK();
+    _page_nr[0] = I2C_PAGE_NONE;
+    _page_nr[1] = I2C_PAGE_NONE;
+    _prefetch = I2C_PAGE_NONE;
+    _back_stale = true;
+    PAGE_UNLOCK();
+}
+
+#ifdef UNIT_TEST
+// ------------------------------------------------------------------------------
+void i2c_fake_start(t_i2c_fake_xfer * xfer,
+                    u8 address,
+                    bool read) {
+    xfer->address = address;
+    xfer->read = read;
+    xfer->count = 0;
+    xfer->rx = NULL;
+    xfer->tx = NULL;
+    if (read)
+        xfer->tx = i2c_slave_addr_tx(address, &xfer->size);
+    else
+        xfer->rx = i2c_slave_addr_rx(address, &xfer->size);
+}
+
+// ------------------------------------------------------------------------------
+u16 i2c_fake_clock(t_i2c_fake_xfer * xfer,
+                   u8 * data,
+                   u16 length) {
+    if (length > xfer->size - xfer->count) // slave NACKs the rest
+        length = (u16)(xfer->size - xfer->count);
+    if (xfer->read)
+        memcpy(data, &xfer->tx[xfer->count], length);
+    else
+        memcpy(&xfer->rx[xfer->count], data, length);
+    xfer->count = (u16)(xfer->count + length);
+    return length;
+}
+
+// ------------------------------------------------------------------------------
+void i2c_fake_stop(t_i2c_fake_xfer * xfer) {
+    i2c_slave_addr_done(xfer->address, xfer->read, xfer->count);
+}
+#endif
@@ -0,0 +1,160 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : i2c_slave_addr.h
+* Author              : Barco
+* created             : 16/10/2022
+* Description         : Per address side of the i2c slave, buffers and handlers
+*
+*   Each slave address owns its receive/transmit buffers, a transfer on one
+*   address (or port) no longer clears or overwrites the data of an other:
+*
+*     0x60  byte read/write by id, gateway to the spi flash (0x50 commands)
+*     0x61  spi flash page readback, byte mode or page mode (toggle [0xFF, 1])
+*     0x62  24c02 eeprom emulation, byte mode or block mode (toggle [0xFF, 1])
+*     0x63  streamed spi flash programming, see i2c_stream.h
+*
+*   Reads are zero-copy, the transmit pointer goes straight into the data.
+*   The 0x61 page is ping-pong buffered (Main.Debug.SpiFlashPage[2]): the
+*   host clocks out the front page while the spi task fills the back one.
+*   A page mode read of page N from offset 0 asks for N+1 to be prefetched,
+*   the next 0x50 READ of N+1 then only swaps the buffers. A swap during a
+*   read of the front page waits until the read completes. Page mode reads
+*   honour the offset of the smbus block reads (write offset, read N bytes).
+*
+* History:
+* 16/10/2022 : introduced in gpmcu code, split from i2c_slave.c
+* 18/10/2022 : i2c_slave_page_invalidate() drops a fill in progress
+*******************************************************************************/
+
+#ifndef _I2C_SLAVE_ADDR_H_
+#define _I2C_SLAVE_ADDR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "data_map.h"
+
+#define I2C_MASTER_SLAVE_ADDR_7BIT   (0x60U)
+#define I2C_MASTER_SLAVE_ADDR_BIS    (I2C_MASTER_SLAVE_ADDR_7BIT + 1)
+#define I2C_MASTER_SLAVE_ADDR_EEPROM (I2C_MASTER_SLAVE_ADDR_7BIT + 2)
+#define I2C_MASTER_SLAVE_ADDR_STREAM (I2C_MASTER_SLAVE_ADDR_7BIT + 3)
+#define I2C_FLASH_CMD_IDENTIFIER     (0x50u)
+#define I2C_CMD_LENGTH               (2) // Typical/default command length
+#define I2C_DATA_LENGTH              (SPIFLASHPAGE_SIZE) // MAX is 256
+#define I2C_EMULATED_EEPROM_SIZE     (EEPROM_SIZE) // define in data_map.h
+
+#define I2C_TOGGLE_TX_SIZE_CMD       0xff // Command for selecting page or per byte r/w
+
+#define I2C_PAGE_NONE                0xFFFF // !< page buffer holds no spi flash page
+
+/**
+ * @brief  Drop the transfers in progress (slave (re)setup), the byte/page
+ *         modes and the pages held are kept
+ */
+void i2c_slave_addr_init(void);
+
+/**
+ * @brief  Transmit data of a read, called from the i2c interrupt
+ *         (kI2C_SlaveTransmitEvent)
+ *
+ * @param address 7bit slave address
+ * @param size    bytes to send, 0 for an unknown address
+ * @returns buffer to send from, valid until i2c_slave_addr_done()
+ */
+const u8 * i2c_slave_addr_tx(u8 address,
+                             u16 * size);
+
+/**
+ * @brief  Receive buffer of a write, called from the i2c interrupt
+ *         (kI2C_SlaveReceiveEvent)
+ *
+ * @param address 7bit slave address
+ * @param size    bytes expected, 0 for an unknown address
+ * @returns buffer to receive in
+ */
+u8 * i2c_slave_addr_rx(u8 address,
+                       u16 * size);
+
+/**
+ * @brief  Transfer completed, called from the i2c interrupt
+ *         (kI2C_SlaveCompletionEvent)
+ *
+ * @param address 7bit slave address
+ * @param read    the master read
+ * @param count   bytes transferred
+ * @returns false for an unknown address
+ */
+bool i2c_slave_addr_done(u8 address,
+                         bool read,
+                         u16 count);
+
+/**
+ * @brief  A page program is in progress on 0x60: the next write is the data
+ */
+bool i2c_slave_addr_expecting(void);
+
+/**
+ * @brief  Page prefetch asked by a 0x61 page read, taken once (task)
+ *
+ * @param page the page to read ahead
+ * @returns true when a prefetch is pending
+ */
+bool i2c_slave_page_prefetch(u16 * page);
+
+/**
+ * @brief  0x50 READ of a page held in a page buffer (task): the page is
+ *         published without an spi read, now or once the read in progress
+ *         completes
+ *
+ * @returns the buffer holding the page, NULL when not held
+ */
+const u8 * i2c_slave_page_lookup(u16 page);
+
+/**
+ * @brief  Back page buffer to fill from the spi flash (task)
+ *
+ * @param page     page that will be read in it
+ * @param prefetch a read ahead: NULL when the page is held already or the
+ *                 back buffer still waits to be published
+ * @returns buffer of I2C_DATA_LENGTH bytes
+ */
+u8 * i2c_slave_page_back(u16 page,
+                         bool prefetch);
+
+/**
+ * @brief  The back buffer holds page (task)
+ *
+ * @param publish swap it to the front (a 0x50 READ), else keep it back
+ */
+void i2c_slave_page_filled(u16 page,
+                           bool publish);
+
+/**
+ * @brief  The spi flash changed (program, erase): forget which pages are held,
+ *         a back buffer being filled (non-blocking read) is not kept as a page
+ */
+void i2c_slave_page_invalidate(void);
+
+#ifdef UNIT_TEST
+/*
+ * Native i2c slave side: the callback of one port as the interrupt sees it,
+ * start/clock/stop can be interleaved over two ports (two transfers).
+ */
+typedef struct {
+    u8 address;
+    bool read;
+    u8 * rx;
+    const u8 * tx;
+    u16 size;
+    u16 count;
+} t_i2c_fake_xfer;
+
+void i2c_fake_start(t_i2c_fake_xfer * xfer,
+                    u8 address,
+                    bool read);     // !< address match, transmit/receive event
+u16 i2c_fake_clock(t_i2c_fake_xfer * xfer,
+                   u8 * data,
+                   u16 length);     // !< bytes in (write) or out (read)
+void i2c_fake_stop(t_i2c_fake_xfer * xfer); // !< completion event
+#endif
+
+#endif /* _I2C_SLAVE_ADDR_H_ */
@@ -0,0 +1,246 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : i2c_stream.c
+* Author              : Barco
+* created             : 14/10/2022
+* Description         : Streamed spi flash programming over the i2c slave,
+*                       staging fifo filled from the i2c interrupt
+* History:
+* 14/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#include <string.h>
+
+#include "i2c_stream.h"
+#include "i2c_slave_addr.h"
+
+#include "storage_spi_flash.h"
+
+#include "logger.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define I2C_STREAM_SECTOR       (MIN_ERASE_SIZE)
+#define I2C_STREAM_SECTOR_PAGES (I2C_STREAM_SECTOR / I2C_STREAM_PAGE_SIZE)
+#define I2C_STREAM_PART_PAGES   (SPI_PART_SIZE / I2C_STREAM_PAGE_SIZE)
+#define I2C_STREAM_IMAGE_PAGES  (I2C_STREAM_PART_PAGES - I2C_STREAM_SECTOR_PAGES) // !< last 4k: spi context
+#define I2C_STREAM_PARTITIONS   2 // !< spi0, spi1
+#define I2C_STREAM_FLASH_SIZE   (SPI1_START_ADDR + SPI_PART_SIZE)
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static struct storage_driver_t * _sdriver = NULL;
+static struct spi_flash_area_t _area;          // !< whole flash, page writes
+static struct spi_flash_area_t _sector;        // !< erase step
+
+// fifo: the interrupt owns _head and _expected, the task _tail and _committed
+static u8 _slots[I2C_STREAM_SLOTS][I2C_STREAM_FRAME_SIZE];
+static u8 _scratch[I2C_STREAM_FRAME_SIZE];     // !< frames that do not go in a slot
+static u8 * volatile _rx = NULL;               // !< buffer handed to the interrupt
+static volatile u8 _head = 0;
+static volatile u8 _tail = 0;
+
+static volatile bool _active = false;
+static volatile bool _failed = false;
+static volatile u8 _error = I2C_STREAM_ERR_NONE;
+static volatile u32 _expected = 0;             // !< next page from the host
+static volatile u32 _committed = 0;            // !< next page to program
+static u32 _end = 0;                           // !< page after the stream
+static u32 _erased = 0;                        // !< flash erased up to here
+
+// START/ABORT: taken by the task
+static volatile u8 _request = 0;
+static volatile u16 _request_page = 0;
+static volatile u16 _request_count = 0;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+static u8 _count(void) {
+    return (u8)(_head - _tail);
+}
+
+static bool _fail(t_i2c_stream_error error) {
+    LOG_ERROR("i2c stream: flash error %d at page 0x%X", error, _committed);
+    _error = error;
+    _failed = true;
+    _active = false;
+    return false;
+}
+
+// whole sectors of the image area of one partition, the erase does not touch
+// the pages around the range nor the spi context sector
+static bool _range_valid(u32 page,
+                         u32 count) {
+    u32 base = page - (page % I2C_STREAM_PART_PAGES);
+
+    if ((count == 0) || (page % I2C_STREAM_SECTOR_PAGES) || (count % I2C_STREAM_SECTOR_PAGES))
+        return false;
+    if (page >= I2C_STREAM_PARTITIONS * I2C_STREAM_PART_PAGES)
+        return false;
+    return page + count <= base + I2C_STREAM_IMAGE_PAGES;
+}
+
+static void _start(u16 page,
+                   u16 count) {
+    if (!_sdriver || !_range_valid(page, count)) {
+        LOG_WARN("i2c stream: start of %d pages at 0x%X refused", count, page);
+        _error = I2C_STREAM_ERR_COMMAND;
+        return;
+    }
+
+    strncpy(_area.area_name, "i2c-stream", MAX_AREA_NAME);
+    _area.start_addr = 0;
+    _area.size = I2C_STREAM_FLASH_SIZE;
+    _sector = _area;
+    _sector.size = I2C_STREAM_SECTOR;
+
+    _head = 0;
+    _tail = 0;
+    _expected = page;
+    _committed = page;
+    _end = (u32)page + count;
+    _erased = (u32)page * I2C_STREAM_PAGE_SIZE;
+    _error = I2C_STREAM_ERR_NONE;
+    _failed = false;
+    _active = true; // last: opens the fifo for the interrupt
+    LOG_INFO("i2c stream: %d pages from 0x%X", count, page);
+}
+
+void i2c_stream_init(struct storage_driver_t * sdriver) {
+    _sdriver = sdriver;
+    _active = false;
+    _failed = false;
+    _request = 0;
+    _error = I2C_STREAM_ERR_NONE;
+    _head = 0;
+    _tail = 0;
+}
+
+u8 * i2c_stream_rx_buffer(void) {
+    if (_active && !_request && (_count() < I2C_STREAM_SLOTS))
+        _rx = _slots[_head % I2C_STREAM_SLOTS];
+    else
+        _rx = _scratch;
+    return _rx;
+}
+
+void i2c_stream_received(u16 length) {
+    u8 * frame = _rx;
+
+    _rx = NULL;
+    if (!frame || (length == 0))
+        return;
+
+    switch (frame[0]) {
+        case I2C_STREAM_CMD_START:
+            if (length != I2C_STREAM_START_LENGTH) {
+                _error = I2C_STREAM_ERR_LENGTH;
+                break;
+            }
+            _request_page = (u16)((frame[1] << 8) | frame[2]);
+            _request_count = (u16)((frame[3] << 8) | frame[4]);
+            _request = I2C_STREAM_CMD_START;
+            break;
+        case I2C_STREAM_CMD_ABORT:
+            _request = I2C_STREAM_CMD_ABORT;
+            break;
+        case I2C_STREAM_CMD_DATA:
+            if (length != I2C_STREAM_FRAME_SIZE)
+                _error = I2C_STREAM_ERR_LENGTH;
+            else if (!_active || _request)
+                _error = I2C_STREAM_ERR_STATE;
+            else if (frame == _scratch)
+                _error = I2C_STREAM_ERR_OVERFLOW;
+            else if ((((u32)frame[1] << 8) | frame[2]) != _expected || (_expected >= _end))
+                _error = I2C_STREAM_ERR_SEQUENCE;
+            else {
+                _expected++;
+                _head++; // the page stays where it was received
+            }
+            break;
+        default:
+            _error = I2C_STREAM_ERR_COMMAND;
+            break;
+    }
+}
+
+// [FLAGS, FREE_SLOTS, LAST_ERROR, COMMITTED(4byte BE), NEXT_PAGE(2byte BE)]
+u16 i2c_stream_status(u8 * buf) {
+    u32 committed = _committed * I2C_STREAM_PAGE_SIZE;
+    bool busy = _request || (_active && ((_count() > 0) ||
+                                         (_erased < _end * I2C_STREAM_PAGE_SIZE)));
+
+    buf[0] = (u8)((busy ? I2C_STREAM_FLAG_BUSY : 0) |
+                  (_active ? I2C_STREAM_FLAG_ACTIVE : 0) |
+                  (_failed ? I2C_STREAM_FLAG_ERROR : 0));
+    buf[1] = (_active && !_request) ? (u8)(I2C_STREAM_SLOTS - _count()) : 0;
+    buf[2] = _error;
+    buf[3] = (u8)(committed >> 24);
+    buf[4] = (u8)(committed >> 16);
+    buf[5] = (u8)(committed >> 8);
+    buf[6] = (u8)committed;
+    buf[7] = (u8)(_expected >> 8);
+    buf[8] = (u8)_expected;
+    return I2C_STREAM_STATUS_LENGTH;
+}
+
+bool i2c_stream_process(void) {
+    if (_request) {
+        if (_request == I2C_STREAM_CMD_START)
+            _start(_request_page, _request_count);
+        else if (_active) {
+            LOG_WARN("i2c stream: aborted at page 0x%X", _committed);
+            _active = false;
+        }
+        _request = 0;
+        return true;
+    }
+    if (!_active)
+        return false;
+
+    // program what is buffered and erased, erase ahead while the host is slow
+    if ((_count() > 0) && (_committed * I2C_STREAM_PAGE_SIZE < _erased)) {
+        _area.offset = _committed * I2C_STREAM_PAGE_SIZE;
+        STORAGE_SETPRIV(_sdriver, &_area);
+        if (storage_write_data(_sdriver, &_slots[_tail % I2C_STREAM_SLOTS][I2C_STREAM_HEADER],
+                               I2C_STREAM_PAGE_SIZE) < 0)
+            return _fail(I2C_STREAM_ERR_WRITE);
+        i2c_slave_page_invalidate(); // 0x61 readback pages
+        _committed++;
+        _tail++;
+        if (_committed == _end) {
+            LOG_OK("i2c stream: committed up to 0x%X", _committed * I2C_STREAM_PAGE_SIZE);
+            _active = false;
+            return false;
+        }
+        return true;
+    }
+    if (_erased < _end * I2C_STREAM_PAGE_SIZE) {
+        _sector.start_addr = _erased;
+        STORAGE_SETPRIV(_sdriver, &_sector);
+        if (storage_erase_storage(_sdriver) < 0)
+            return _fail(I2C_STREAM_ERR_ERASE);
+        i2c_slave_page_invalidate();
+        _erased += I2C_STREAM_SECTOR;
+        return true;
+    }
+    return false; // waiting for the host
+}
+
+#ifdef UNIT_TEST
+// ------------------------------------------------------------------------------
+void i2c_stream_fake_write(const u8 * data,
+                           u16 length) {
+    u8 * buf = i2c_stream_rx_buffer(); // kI2C_SlaveReceiveEvent
+
+    memcpy(buf, data, (length > I2C_STREAM_FRAME_SIZE) ? I2C_STREAM_FRAME_SIZE : length);
+    i2c_stream_received(length);       // kI2C_SlaveCompletionEvent
+}
+
+// ------------------------------------------------------------------------------
+u16 i2c_stream_fake_read(u8 * buf) {
+    return i2c_stream_status(buf);     // kI2C_SlaveTransmitEvent
+}
+#endif
@@ -0,0 +1,117 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : i2c_stream.h
+* Author              : Barco
+* created             : 14/10/2022
+* Description         : Streamed spi flash programming over the i2c slave
+*
+*   i2c address 0x63, writes (first byte is the command):
+*
+*     I2C_STREAM_CMD_START  [PAGE(2byte BE), COUNT(2byte BE)]  erase and program
+*                           COUNT pages of 256 bytes from PAGE on. PAGE and COUNT
+*                           are multiples of 16 (4k sectors), the range lies in
+*                           the image area of spi0 or spi1 (not the context
+*                           sector), refused otherwise
+*     I2C_STREAM_CMD_DATA   [PAGE(2byte BE), DATA(256)]  the next page, one write
+*     I2C_STREAM_CMD_ABORT
+*
+*   a read returns the status register (I2C_STREAM_STATUS_LENGTH bytes):
+*
+*     [FLAGS, FREE_SLOTS, LAST_ERROR, COMMITTED(4byte BE), NEXT_PAGE(2byte BE)]
+*
+*     FLAGS      : I2C_STREAM_FLAG_BUSY (erase/program pending), _ACTIVE (stream
+*                  open), _ERROR (flash failure, stream stopped)
+*     FREE_SLOTS : pages the host may send without polling again
+*     COMMITTED  : flash address up to which the pages are programmed
+*     NEXT_PAGE  : page expected by the next CMD_DATA
+*
+*   Pages land in a I2C_STREAM_SLOTS deep staging fifo straight from the i2c
+*   interrupt, the erase (4k sectors) and the page writes run in the background,
+*   one step per run of the task. A page out of sequence or without a free slot
+*   is dropped with LAST_ERROR set, the stream stays open: resend from
+*   NEXT_PAGE. START and ABORT are taken by the task, the stream is open once
+*   the status reads ACTIVE. It closes when COUNT pages are committed.
+*
+* History:
+* 14/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#ifndef _I2C_STREAM_H_
+#define _I2C_STREAM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "data_map.h"
+#include "storage.h"
+
+#define I2C_STREAM_PAGE_SIZE     256
+#define I2C_STREAM_SLOTS         8   // !< staging fifo, 2k
+#define I2C_STREAM_HEADER        3   // !< CMD, PAGE(2)
+#define I2C_STREAM_FRAME_SIZE    (I2C_STREAM_HEADER + I2C_STREAM_PAGE_SIZE)
+#define I2C_STREAM_START_LENGTH  5
+#define I2C_STREAM_STATUS_LENGTH 9
+
+#define I2C_STREAM_CMD_START     0x01
+#define I2C_STREAM_CMD_DATA      0x02
+#define I2C_STREAM_CMD_ABORT     0x04
+
+#define I2C_STREAM_FLAG_BUSY     (1 << 0)
+#define I2C_STREAM_FLAG_ACTIVE   (1 << 1)
+#define I2C_STREAM_FLAG_ERROR    (1 << 2)
+
+typedef enum {
+    I2C_STREAM_ERR_NONE = 0,
+    I2C_STREAM_ERR_SEQUENCE,     // !< page is not NEXT_PAGE
+    I2C_STREAM_ERR_OVERFLOW,     // !< no free slot
+    I2C_STREAM_ERR_LENGTH,       // !< frame size
+    I2C_STREAM_ERR_STATE,        // !< data without an open stream
+    I2C_STREAM_ERR_COMMAND,      // !< unknown command, START unaligned or out of range
+    I2C_STREAM_ERR_ERASE,
+    I2C_STREAM_ERR_WRITE,
+} t_i2c_stream_error;
+
+/**
+ * @brief  Set the storage driver of the spi flash, NULL: streams are refused
+ */
+void i2c_stream_init(struct storage_driver_t * sdriver);
+
+/**
+ * @brief  Receive buffer of the next write, called from the i2c interrupt
+ *         (kI2C_SlaveReceiveEvent): the free slot, the page is not copied
+ *
+ * @returns buffer of I2C_STREAM_FRAME_SIZE bytes
+ */
+u8 * i2c_stream_rx_buffer(void);
+
+/**
+ * @brief  Write completed, called from the i2c interrupt (kI2C_SlaveCompletionEvent)
+ *
+ * @param length bytes received in the i2c_stream_rx_buffer()
+ */
+void i2c_stream_received(u16 length);
+
+/**
+ * @brief  Status register, called from the i2c interrupt (kI2C_SlaveTransmitEvent)
+ *
+ * @returns I2C_STREAM_STATUS_LENGTH
+ */
+u16 i2c_stream_status(u8 * buf);
+
+/**
+ * @brief  Background step: apply START/ABORT, erase a sector or program a page
+ *
+ * @returns true while work remains
+ */
+bool i2c_stream_process(void);
+
+#ifdef UNIT_TEST
+/**
+ * @brief  Native i2c slave side: a master write/read on 0x63 as the interrupt
+ *         would see it
+ */
+void i2c_stream_fake_write(const u8 * data,
+                           u16 length);
+u16 i2c_stream_fake_read(u8 * buf);
+#endif
+
+#endif /* _I2C_STREAM_H_ */
@@ -14,13 +14,19 @@
 extern struct logger_driver_t stdio_logger;
 #endif /* CFG_LOGGER_SIMPLE_LOGGER && !CFG_LOGGER_ADV_LOGGER */
 
-extern struct logger_driver_t uart_logger;
+extern struct logger_driver_t uart_async_logger;
 extern struct logger_driver_t app_mem_logger;
+extern struct logger_driver_t app_tok_logger;
 
 struct logger_driver_t * adrivers[] = {
 #if defined(CFG_LOGGER_SIMPLE_LOGGER) && !defined(CFG_LOGGER_ADV_LOGGER)
     &stdio_logger,
 #endif /* CFG_LOGGER_SIMPLE_LOGGER && !CFG_LOGGER_ADV_LOGGER */
-    &uart_logger,
+    &uart_async_logger,
+#if defined(CFG_LOGGER_TOKENIZED)
+    &app_tok_logger,
+#else
+    &app_mem_logger,
+#endif /* CFG_LOGGER_TOKENIZED */
     NULL,
 };
@@ -0,0 +1,109 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : loop_stats.c
+* Author              : Barco
+* created             : 08/10/2022
+* Description         : Superloop cycle accounting, min/max/mean and a log2
+*                       histogram per task, kept in Main.LoopStats
+* History:
+* 08/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#include <string.h>
+
+#include "loop_stats.h"
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static volatile bool _reset_request = false;
+static bool _started = false;  // !< _last holds the start of an iteration
+static u32 _last = 0;
+static u32 _iteration = 0;
+static u32 _cycles_per_us = 1;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+static void _reset(void) {
+    memset((u8 *)Main.LoopStats.Task, 0x00, sizeof(Main.LoopStats.Task));
+    for (int i = 0; i < LOOP_TASK_NUM; i++) {
+        Main.LoopStats.Task[i].Min = UINT32_MAX;
+    }
+}
+
+static inline void _account(LoopStatsEntry_t * entry,
+                            u32 cycles) {
+    u32 bucket = cycles ? (31u - (u32)__builtin_clz(cycles)) : 0u; // single CLZ on the M33
+
+    if (bucket >= LOOPSTATS_BUCKETS)
+        bucket = LOOPSTATS_BUCKETS - 1;
+
+    entry->Count++;
+    entry->Sum += cycles;
+    if (cycles < entry->Min)
+        entry->Min = cycles;
+    if (cycles > entry->Max)
+        entry->Max = cycles;
+    entry->Histogram[bucket]++;
+}
+
+void loop_stats_init(u32 core_clk_hz) {
+#ifndef UNIT_TEST
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    Main.LoopStats.CoreClockHz = core_clk_hz;
+    Main.LoopStats.SampleShift = LOOPSTATS_SAMPLE_SHIFT;
+    _cycles_per_us = (core_clk_hz >= 1000000U) ? core_clk_hz / 1000000U : 1U;
+    _started = false;
+    _iteration = 0;
+    _reset_request = false;
+    _reset();
+}
+
+bool loop_stats_iteration(u32 now) {
+    if (_reset_request) {
+        _reset_request = false;
+        _reset();
+    }
+
+    if (_started) {
+        u32 cycles = now - _last;
+        _account(&Main.LoopStats.Task[LOOP_TASK_ITERATION], cycles);
+        if (cycles > Main.PerfCounters.MainLoopMaxUs * _cycles_per_us) {
+            Main.PerfCounters.MainLoopMaxUs = cycles / _cycles_per_us;
+        }
+    }
+    _started = true;
+    _last = now;
+    PERF_COUNT(MainLoopCount);
+
+    return (_iteration++ & ((1u << Main.LoopStats.SampleShift) - 1u)) == 0;
+}
+
+void loop_stats_idle(void) {
+    _started = false;
+}
+
+void loop_stats_add(LoopTask_t task,
+                    u32 cycles) {
+    _account(&Main.LoopStats.Task[task], cycles);
+}
+
+void loop_stats_request_reset(void) {
+    _reset_request = true;
+}
+
+bool loop_stats_set_sample_shift(u8 shift) {
+    if (shift > LOOPSTATS_SHIFT_MAX)
+        return false;
+    Main.LoopStats.SampleShift = shift;
+    return true;
+}
+
+void loop_stats_update_mean(void) {
+    for (int i = 0; i < LOOP_TASK_NUM; i++) {
+        LoopStatsEntry_t * entry = &Main.LoopStats.Task[i];
+        entry->Mean = entry->Count ? (u32)(entry->Sum / entry->Count) : 0;
+    }
+}
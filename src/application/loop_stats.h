@@ -0,0 +1,104 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : loop_stats.h
+* Author              : Barco
+* created             : 08/10/2022
+* Description         : Superloop cycle accounting
+*
+*   The whole iteration is measured every loop, the tasks only every
+*   2^SampleShift iterations (default LOOPSTATS_SAMPLE_SHIFT) so the
+*   instrumentation stays a small fraction of an idle loop. Results are kept
+*   in Main.LoopStats (data_map.h) and read over the register protocol.
+*
+*   while (g_main_loop) {
+*       bool sample = loop_stats_iteration(LOOP_STATS_NOW());
+*       LOOP_STATS_RUN(sample, LOOP_TASK_I2C, i2c_update());
+*   }
+*
+* History:
+* 08/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#ifndef _LOOP_STATS_H_
+#define _LOOP_STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "data_map.h"
+
+#ifndef UNIT_TEST
+#include "fsl_device_registers.h"
+#define LOOP_STATS_NOW() (DWT->CYCCNT) // !< core cycles
+#elif !defined(LOOP_STATS_NOW)
+#define LOOP_STATS_NOW() (0U)          // !< native: tests pass the times in
+#endif
+
+#define LOOPSTATS_SAMPLE_SHIFT 4  // !< time the tasks every 16th iteration
+#define LOOPSTATS_SHIFT_MAX    15
+
+/**
+ * @brief  Time a task when this iteration is sampled
+ */
+#define LOOP_STATS_RUN(sample, task, stmt) \
+    do { \
+        if (sample) { \
+            u32 _ls_start = LOOP_STATS_NOW(); \
+            stmt; \
+            loop_stats_add(task, LOOP_STATS_NOW() - _ls_start); \
+        } else { \
+            stmt; \
+        } \
+    } while (0)
+
+/**
+ * @brief  Start the cycle counter and reset the statistics
+ *
+ * @param core_clk_hz cycles per second, reported to the host
+ */
+void loop_stats_init(u32 core_clk_hz);
+
+/**
+ * @brief  Account the previous iteration, call at the top of the main loop
+ *
+ * Also maintains PerfCounters.MainLoopCount/MainLoopMaxUs and applies a
+ * pending reset.
+ *
+ * @param now cycle counter
+ *
+ * @returns true if the tasks of this iteration are to be timed
+ */
+bool loop_stats_iteration(u32 now);
+
+/**
+ * @brief  The current iteration went to sleep, it is not accounted
+ */
+void loop_stats_idle(void);
+
+/**
+ * @brief  Add one duration to a task
+ *
+ * @param task LoopTask_t
+ * @param cycles duration
+ */
+void loop_stats_add(LoopTask_t task,
+                    u32 cycles);
+
+/**
+ * @brief  Request a reset, applied at the start of the next iteration
+ *         Safe to call from interrupt context (i2c slave).
+ */
+void loop_stats_request_reset(void);
+
+/**
+ * @brief  Set the task sample rate to 1 per 2^shift iterations
+ *
+ * @returns false if shift > LOOPSTATS_SHIFT_MAX
+ */
+bool loop_stats_set_sample_shift(u8 shift);
+
+/**
+ * @brief  Fill in the Mean of every entry, called before the host reads
+ */
+void loop_stats_update_mean(void);
+
+#endif /* _LOOP_STATS_H_ */
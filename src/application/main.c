@@ -9,6 +9,9 @@
  * 2021-09-15 | davth | wdog and usb initialisation
  * 2021-06-08 | davth | added irq based comm protocol
  * 2022-01-10 | davth | spi_master added on Flexcomm8
+ * 2022-10-09 | barco | superloop replaced by the event scheduler, WFI idle
+ * 2022-10-18 | barco | spi flash mux leases (spi_mux.c)
+ * 2022-10-18 | barco | spi flash page cache (spi_cache.c)
  *______________________________________________________________________________
  */
 
@@ -20,17 +23,28 @@
 #include "clock_config.h"
 
 #include "logger.h"
+#include "tracer.h"
 #include "version.h"
 #include "memory_map.h"
 
 #include "comm/protocol.h"
 #include "comm/gowin_protocol.h"
+#include "comm/gowin_shadow.h"
 #include "comm/comm.h"
 #include "softversions.h"
 #include "data_map.h"
+#include "loop_stats.h"
+#include "scheduler.h"
+#include "tasks.h"
+#include "timer_wheel.h"
 #include "i2c/i2c_master.h"
 #include "i2c/i2c_slave.h"
+#include "i2c/i2c_stream.h"
 #include "spi/spi_master.h"
+#include "spi/spi_update.h"
+#include "storage_spi_flash.h"
+#include "spi_mux.h"
+#include "spi_cache.h"
 
 #include "../bootloader/bootloader_usb_helpers.h"
 
@@ -42,6 +56,10 @@
 extern void initialise_monitor_handles(void);
 #endif
 
+#define AUTORECOVER_DELAY_MS 10000 // standby -> recover
+#define USB_RETRY_MS         1000
+#define USB_RETRY_MAX        10
+
 /*******************************************************************************
  * GLOBAL Variables
  ******************************************************************************/
@@ -83,6 +101,11 @@ volatile t_uart_data_raw UART_DATA[NUMBER_OF_PROTOCOL_UARTS] = {
 wwdt_config_t g_wwdt_config;
 bool g_main_loop = true;
 
+// gpio request timers, post SCHED_EV_REQUEST -> _handle_gpio_request
+static Timer_t AutorecoverTimer = TIMER_EVENT_INIT(SCHED_EV_REQUEST);
+static Timer_t UsbRetryTimer = TIMER_EVENT_INIT(SCHED_EV_REQUEST);
+static u8 UsbRetries = 0;
+
 /**
  * @brief  Setup the board
  *
@@ -100,7 +123,12 @@ static int _initialize_board(void) {
     BOARD_AppInitClocks(FRO96, false); // !< Initialize Board Clocks
     BOARD_AppInitPeripherals(); // !< Initialize Board peripherals
 
-    // !< Note: logger init was done in bootloader
+    // !< Note: the bootloader initialized its own drivers, the application's
+    // !< copies still need theirs (memory logger continues the bootloader log)
+    logger_init();
+#if defined(CFG_TRACER)
+    tracer_init(SSRAM_TRACE_START, SSRAM_TRACE_SIZE, SystemCoreClock); // !< New trace, DWT cycles
+#endif /* CFG_TRACER */
 
     return 0;
 }
@@ -112,10 +140,13 @@ static int _initialize_board(void) {
  *   Handle the pin_mux access here (prevents unittest dependency problems)
  * @returns void
  */
-void _handle_gpio_request() {
+void _handle_gpio_request(void) {
     if (Main.Diagnostics.ReconfigureGowin) {
         LOG_DEBUG("Request: Reconfigure Gowin");
+        spi_master_disable();   // the transfer in flight ends first
+        spi_mux_fpga_request(); // the Gowin reads its bitfile
         BOARD_Reconfigure_Gowin(200000);
+        gowin_shadow_invalidate(); // reloaded FPGA has its default tables
         // MainCPU is off here
         LOG_DEBUG("Gowin Ready State is [%s]", (BOARD_Ready_Gowin() == 1 ? "OK" : "NOK"));
 
@@ -125,27 +156,36 @@ void _handle_gpio_request() {
         Main.Diagnostics.ReconfigureGowin = false;
     }
 
-    static int autorecoverDelay = 1000; // About 10s
     // auto recover from Standby
     if (Main.Diagnostics.InLowPowerMode) {
-        SDK_DelayAtLeastUs(10000, 96000000U); // 10ms sleep
-        autorecoverDelay--;
-        if (autorecoverDelay == 0) {
+        if (timer_expired(&AutorecoverTimer)) {
             LOG_DEBUG("Recover from Standby");
             Main.Diagnostics.PendingGowinCmd = SET_STANDBY_OFF;
             comm_handler_gowin();
-            autorecoverDelay = 1000;
+            timer_cancel(&AutorecoverTimer); // restarted below while still in standby
 
             // The uart cmd is not functional -> recover via pins toggle
             BOARD_PwrOn_MainCPU(500000);
 
             // We need to reinit the USB as well
-            while (i2c_master_initialize_usb() < 0) {
-                SDK_DelayAtLeastUs(1000000, 96000000U);
+            UsbRetries = 0;
+            timer_start(&UsbRetryTimer, 0);
+        } else if (!timer_pending(&AutorecoverTimer)) {
+            timer_start(&AutorecoverTimer, AUTORECOVER_DELAY_MS);
+        }
+    } else {
+        timer_cancel(&AutorecoverTimer);
+    }
+
+    if (timer_expired(&UsbRetryTimer)) {
+        timer_cancel(&UsbRetryTimer);
+        if (i2c_master_initialize_usb() < 0) {
+            if (++UsbRetries < USB_RETRY_MAX) {
                 LOG_INFO("retrying usb initialisation..");
-                // will auto reboot via wdog
+                timer_start(&UsbRetryTimer, USB_RETRY_MS);
+            } else {
+                g_main_loop = false; // give up: reboot, as the wdog runout did
             }
-            ;
         }
     }
 }
@@ -158,6 +198,10 @@ void _handle_gpio_request() {
 void BOARD_MAINCPU_FLEXCOMM_IRQ(void) {
     // If new data arrived
     UART_DATA[UART1].flags = USART_GetStatusFlags(BOARD_MAINCPU_USART);
+    if (kUSART_RxError & UART_DATA[UART1].flags) { // rx fifo overflow
+        PERF_COUNT(UartOverrun[UART1]);
+        USART_ClearStatusFlags(BOARD_MAINCPU_USART, kUSART_RxError);
+    }
     if ((kUSART_RxFifoNotEmptyFlag | kUSART_RxError) & UART_DATA[UART1].flags) {
         *((u8 *)UART_DATA[UART1].RxBufWr) = USART_ReadByte(BOARD_MAINCPU_USART);
         UART_DATA[UART1].RxBufWr++;
@@ -166,6 +210,10 @@ void BOARD_MAINCPU_FLEXCOMM_IRQ(void) {
                                          UART_DATA[UART1].RxBufSize)) {
             UART_DATA[UART1].RxBufWr = UART_DATA[UART1].RxBuf; // reset write pointer
         }
+        if (UART_DATA[UART1].RxBufWr == UART_DATA[UART1].RxBufRd) {
+            PERF_COUNT(UartOverrun[UART1]); // ring wrapped onto unread data
+        }
+        sched_post(SCHED_EV_MAINCPU_RX);
     }
     /*
      * if (kUSART_RxFifoFullFlag & UART_DATA[UART1].flags)
@@ -182,6 +230,10 @@ void BOARD_MAINCPU_FLEXCOMM_IRQ(void) {
 void BOARD_CPU2_FLEXCOMM_IRQ(void) {
     // If new data arrived
     UART_DATA[UART3].flags = USART_GetStatusFlags(BOARD_CPU2_USART);
+    if (kUSART_RxError & UART_DATA[UART3].flags) { // rx fifo overflow
+        PERF_COUNT(UartOverrun[UART3]);
+        USART_ClearStatusFlags(BOARD_CPU2_USART, kUSART_RxError);
+    }
     if ((kUSART_RxFifoNotEmptyFlag | kUSART_RxError) & UART_DATA[UART3].flags) {
         *((u8 *)UART_DATA[UART3].RxBufWr) = USART_ReadByte(BOARD_CPU2_USART);
         UART_DATA[UART3].RxBufWr++;
@@ -190,6 +242,10 @@ void BOARD_CPU2_FLEXCOMM_IRQ(void) {
                                          UART_DATA[UART3].RxBufSize)) {
             UART_DATA[UART3].RxBufWr = UART_DATA[UART3].RxBuf; // reset write pointer
         }
+        if (UART_DATA[UART3].RxBufWr == UART_DATA[UART3].RxBufRd) {
+            PERF_COUNT(UartOverrun[UART3]); // ring wrapped onto unread data
+        }
+        sched_post(SCHED_EV_CPU2_RX);
     }
     /*
      * if (kUSART_RxFifoFullFlag & UART_DATA[UART3].flags)
@@ -214,6 +270,10 @@ void BOARD_GOWIN_FLEXCOMM_IRQ(void) {
     /* Get the 8-bit data from the receiver */
     UART_DATA[UART2].flags = USART_GetStatusFlags(BOARD_GOWIN_USART);
     // LOG_DEBUG("FLEXCOMM1 flag is %X",flags);  <-- DO NOT LOG in IRQ!!
+    if (kUSART_RxError & UART_DATA[UART2].flags) { // rx fifo overflow
+        PERF_COUNT(UartOverrun[UART2]);
+        USART_ClearStatusFlags(BOARD_GOWIN_USART, kUSART_RxError);
+    }
     if ((kUSART_RxFifoNotEmptyFlag | kUSART_RxError) & UART_DATA[UART2].flags) {
         *((u8 *)UART_DATA[UART2].RxBufWr) = USART_ReadByte(BOARD_GOWIN_USART);
         UART_DATA[UART2].RxBufWr++;
@@ -222,13 +282,21 @@ void BOARD_GOWIN_FLEXCOMM_IRQ(void) {
                                          UART_DATA[UART2].RxBufSize)) {
             UART_DATA[UART2].RxBufWr = UART_DATA[UART2].RxBuf; // reset write pointer
         }
+        if (UART_DATA[UART2].RxBufWr == UART_DATA[UART2].RxBufRd) {
+            PERF_COUNT(UartOverrun[UART2]); // ring wrapped onto unread data
+        }
+        sched_post(SCHED_EV_GOWIN_RX);
     }
+    GOWIN_TX_IRQHandler(); // tx ring -> fifo, request sent
+
+    // a full fifo is not a lost byte (kUSART_RxError): the bytes are read one
+    // per interrupt above, don't take one here
     if (kUSART_RxFifoFullFlag & UART_DATA[UART2].flags) {
         wdog_refresh(); // Irq prevents wdog clear in main
         cnt++;
         if (cnt < 20) {
-            LOG_WARN("Gowin FLEXCOMM overrun, fifo cnt [0x%X], rx byte[0x%X]",
-                     USART_GetRxFifoCount(BOARD_GOWIN_USART), USART_ReadByte(BOARD_GOWIN_USART));
+            LOG_WARN("Gowin FLEXCOMM rx fifo full, fifo cnt [0x%X]",
+                     USART_GetRxFifoCount(BOARD_GOWIN_USART));
         } else {
             USART_Deinit(BOARD_GOWIN_USART);
             LOG_ERROR("Gowin FLEXCOMM disabled");
@@ -284,8 +352,16 @@ int main(void) {
     // !< Run Board initialization
     _initialize_board();
 
+    // !< spi flash mux leases, counted in the PerfCounters (SpiMuxSwitches..)
+    spi_mux_init(spi_mux_event, SystemCoreClock / 1000000U);
+    // !< spi flash page cache, counted in the PerfCounters (SpiCacheHit/Miss)
+    spi_cache_init(spi_cache_count);
+
     initialize_global_data_map();
 
+    // !< 1ms time base for all timeouts
+    timer_wheel_init(SystemCoreClock);
+
     Main.VersionInfo.hwid = BOARD_GetRevision();
 
     SCB->SHCSR |= SCB_SHCSR_USGFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk |
@@ -338,6 +414,8 @@ int main(void) {
     }
 
     spi_master_setup();
+    spi_update_init(storage_new_spi_flash_driver());
+    i2c_stream_init(storage_new_spi_flash_driver());
 
     // !< Gowin initialisation
     GOWIN_Queue_Init();
@@ -354,57 +432,27 @@ int main(void) {
     if (!GOWIN_DATA.verifyReadBack)
         LOG_INFO("Appli%c up and running", application);
 
+    // !< Superloop cycle accounting (LoopStats, PerfCounters)
+    loop_stats_init(SystemCoreClock);
+
+    // !< Tasks run on interrupt events, sleep when there is nothing to do
+    sched_init(APP_TASKS, APP_TASKS_NUM);
+
     while (g_main_loop) {
+        bool sample = loop_stats_iteration(LOOP_STATS_NOW());
+
         if (!Main.Diagnostics.WatchDogRunout ) {
             wdog_refresh();
         }
 
-        // !< MainCPU
-        COMM_Protocol(UART1); // process incoming data Main CPU
-        if (COMM_DATA[UART1].MsgCount) { // handle received messages...
-            comm_handler();
-            COMM_DATA[UART1].MsgCount = 0; // release RX message buffer
-        }
-
-#ifdef BOARD_GAIA
-        // !< 2nd CPU
-        COMM_Protocol(UART3); // process incoming data 2nd CPU
-        if (COMM_DATA[UART3].MsgCount) { // handle received messages...
-            comm_handler();
-            COMM_DATA[UART3].MsgCount = 0; // release RX message buffer
+        if (!sched_run_once(sample)) {
+            sched_idle(); // WFI, the tick timer wakes us at least every SCHED_TICK_MS
+            loop_stats_idle();
         }
-
-        _detect_cable_change_gaia();
-#endif
-
-        // !< GOWIN FPGA
-        if (GOWIN_Protocol(UART2) == GOWIN_RETURN_TIMEOUT) {
-            LOG_WARN("No Reply from Gowin");
-            LOG_INFO("Gowin Ready State is [%s]", (BOARD_Ready_Gowin() == 1 ? "OK" : "NOK"));
-            GOWIN_Queue_Init();
-        }
-        if (GOWIN_DATA.MsgCount) { // handle received messages...
-            comm_handler_gowin();
-            GOWIN_DATA.MsgCount = 0; // release RX message buffer
-            if ((GOWIN_Queue_size() == 0) && (GOWIN_DATA.verifyReadBack == true)) {
-                // Gowin tx finished, let's verify the readback
-                GOWIN_Compare_EdidDpcd(Main.Edid.Edid1, Main.Edid.Edid3, "Edid1==Edid3");
-                GOWIN_Compare_EdidDpcd(Main.Dpcd.Dpcd1, Main.Dpcd.Dpcd3, "Dpcd1==Dpcd3");
-                GOWIN_DATA.verifyReadBack = false;
-                LOG_INFO("Appli%c up and running", application);
-            }
-        }
-
-        // !< I2C
-        i2c_update();
-
-        // !< SPI
-        spi_master_update();
-
-        // !< GPIO request
-        _handle_gpio_request();
     }
 
+    sched_deinit();
+    timer_wheel_deinit();
     disable_user_irq();
     BOARD_AppInitClocks(FRO96, true);
     _gdata.reboot_counter++; // !< Cold start detection
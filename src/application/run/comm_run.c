@@ -14,6 +14,7 @@
 #include "string.h"
 
 #include "data_map.h"
+#include "loop_stats.h"
 #include "logger.h"
 #include "comm_run.h"
 #include "comm/protocol.h"
@@ -163,6 +164,10 @@ u8 byteReadbyId(u8 Identifier) {
             ret = Main.BoardIdentification.SpiFlash_Identification[Identifier - 0x50];
             break;
 
+        case 0x71: // LoopStats task sample rate (1 per 2^n iterations)
+            ret = (u8)Main.LoopStats.SampleShift;
+            break;
+
         default:
             // default statement - reply 0xff
             ret = 0xff;
@@ -247,6 +252,12 @@ void c4ByteRead(u8 * RxBuf,
                    SIZE);
             break;
 
+        case 0x60 ... 0x60 + PERF_COUNTERS_NUM - 1: // PerfCounters, one u32 per register
+            memcpy(&value,
+                   IdentifierInternalAddress[PerfCounters] + (Identifier - 0x60) * 4,
+                   SIZE);
+            break;
+
         case 0xAA:
             LOG_DEBUG("Read4Byte - testregister");
             value = Main.Debug.intTestRegister;
@@ -308,8 +319,8 @@ bool byteWritebyId(u8 Identifier,
             break;
 
         // 0x40.. Gowin
-        case 0x40: // any Gowin cmd
-            GOWIN_TX_SendMsg(data);
+        case 0x40: // any Gowin cmd, queued
+            GOWIN_Queue_Tx_Msg(data);
             break;
 
         case 0x41: // trigger gowin reconfigure
@@ -321,6 +332,18 @@ bool byteWritebyId(u8 Identifier,
             LOG_ERROR("..should go over byteWrite2SPI()");
             break;
 
+        case 0x60: // clear the PerfCounters, any data value
+            clear_perf_counters();
+            break;
+
+        case 0x70: // reset the LoopStats, any data value
+            loop_stats_request_reset();
+            break;
+
+        case 0x71: // LoopStats task sample rate (1 per 2^n iterations)
+            return loop_stats_set_sample_shift(data);
+            break;
+
         default:
             // default statement
             return false;
@@ -565,6 +588,16 @@ void cArrayRead(u8 * RxBuf,
             sizeRestriction = sizeof(Main.Dpcd.Dpcd3);
             break;
         // --------------------------------------------------------------------------
+        case CMD_ID_PERFCOUNTERS:
+            Identifier = PerfCounters;
+            sizeRestriction = sizeof(Main.PerfCounters);
+            break;
+        case CMD_ID_LOOPSTATS: // Offset = task, LOOP_TASK_NUM for the trailer
+            Identifier = LoopStats;
+            Offset *= sizeof(LoopStatsEntry_t);
+            sizeRestriction = sizeof(LoopStatsEntry_t);
+            break;
+        // --------------------------------------------------------------------------
         case CMD_ID_BOOTLOG: // BOOTLOG
         // processed in comm.c, does not apply to Main-struct
 
@@ -790,6 +823,10 @@ void ReadCommandHandler(u16 Identifier,
         case DebugLog:
             break;
 
+        case LoopStats:
+            loop_stats_update_mean();
+            break;
+
         default: // no task to be executed/triggered -> data will be read directly from ram
             break;
     }
@@ -0,0 +1,108 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : scheduler.c
+* Author              : Barco
+* created             : 09/10/2022
+* Description         : Cooperative run-to-completion scheduler, WFI when idle
+* History:
+* 09/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "scheduler.h"
+#include "loop_stats.h"
+#include "timer_wheel.h"
+
+#ifndef UNIT_TEST
+#include "fsl_device_registers.h"
+#endif
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static _Atomic u32 _pending = 0;          // !< posted events, cleared per pass
+static u32 _busy = 0;                     // !< bit per task: reported more work
+static const SchedTask_t * _tasks = NULL;
+static u8 _task_num = 0;
+static Timer_t _tick = TIMER_EVENT_INIT(SCHED_EV_TICK);
+
+#ifdef UNIT_TEST
+static void (*_idle_hook)(void) = NULL;
+#endif
+
+/*******************************************************************************
+ * Port
+ ******************************************************************************/
+#ifndef UNIT_TEST
+static void _port_idle(void) {
+    // an interrupt between the check and WFI is not lost: with PRIMASK set
+    // it still wakes the core, the handler runs after __enable_irq
+    __disable_irq();
+    if (atomic_load(&_pending) == 0) {
+        PERF_COUNT(IdleSleeps);
+        __DSB();
+        __WFI();
+    }
+    __enable_irq();
+}
+#else
+static void _port_idle(void) {
+    if (atomic_load(&_pending) == 0) {
+        PERF_COUNT(IdleSleeps);
+        if (_idle_hook)
+            _idle_hook();
+    }
+}
+
+void sched_set_idle_hook(void (*hook)(void)) {
+    _idle_hook = hook;
+}
+#endif
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+void sched_init(const SchedTask_t * tasks,
+                u8 num) {
+    _tasks = tasks;
+    _task_num = (num > SCHED_TASKS_MAX) ? SCHED_TASKS_MAX : num;
+    _busy = 0;
+    atomic_store(&_pending, SCHED_EV_ALL);
+    timer_start_periodic(&_tick, SCHED_TICK_MS);
+}
+
+void sched_deinit(void) {
+    timer_cancel(&_tick);
+    _task_num = 0;
+}
+
+void sched_post(u32 events) {
+    atomic_fetch_or(&_pending, events);
+}
+
+bool sched_run_once(bool sample) {
+    u32 events = atomic_exchange(&_pending, 0);
+    u32 busy = 0;
+    bool ran = false;
+
+    for (u8 i = 0; i < _task_num; i++) {
+        const SchedTask_t * task = &_tasks[i];
+        bool more;
+
+        if (!(events & task->events) && !(_busy & (1UL << i)))
+            continue;
+
+        LOOP_STATS_RUN(sample, task->stats, more = task->run());
+        if (more)
+            busy |= 1UL << i;
+        ran = true;
+    }
+    _busy = busy;
+
+    return ran;
+}
+
+void sched_idle(void) {
+    _port_idle();
+}
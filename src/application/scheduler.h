@@ -0,0 +1,103 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : scheduler.h
+* Author              : Barco
+* created             : 09/10/2022
+* Description         : Cooperative run-to-completion scheduler
+*
+*   Interrupts post events (sched_post), a task only runs when one of its
+*   events is pending or when it reported more work on its previous run.
+*   Nothing to do -> the core sleeps (WFI) until the next interrupt. Timeouts
+*   are timer_wheel.h timers on the 1 kHz SysTick: the tick wakes the core
+*   every ms, it only posts SCHED_EV_TIMER when a timer is due, so in
+*   between the loop finds nothing pending and goes straight back to WFI.
+*   A periodic timer posts SCHED_EV_TICK every SCHED_TICK_MS for what still
+*   polls (watchdog, gaia cable detection).
+*
+*   sched_init(APP_TASKS, APP_TASKS_NUM);
+*   while (g_main_loop) {
+*       if (!sched_run_once(sample))
+*           sched_idle();
+*   }
+*
+* History:
+* 09/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "data_map.h"
+
+#define SCHED_TICK_MS   10U  // !< SCHED_EV_TICK period
+#define SCHED_TASKS_MAX 32   // !< one busy bit per task
+
+/* events, posted from interrupt or task context */
+#define SCHED_EV_MAINCPU_RX  (1UL << 0) // !< UART1 rx byte
+#define SCHED_EV_MAINCPU_MSG (1UL << 1) // !< MainCPU message decoded
+#define SCHED_EV_CPU2_RX     (1UL << 2) // !< UART3 rx byte (gaia)
+#define SCHED_EV_GOWIN_RX    (1UL << 3) // !< UART2 rx byte
+#define SCHED_EV_GOWIN_MSG   (1UL << 4) // !< Gowin message decoded
+#define SCHED_EV_I2C         (1UL << 5) // !< i2c slave transfer started/completed
+#define SCHED_EV_REQUEST     (1UL << 6) // !< data-map written: gowin/spi/gpio requests
+#define SCHED_EV_TICK        (1UL << 7) // !< every SCHED_TICK_MS
+#define SCHED_EV_TIMER       (1UL << 8) // !< SysTick, a timer is due
+#define SCHED_EV_ALL         (0xFFFFFFFFUL)
+
+/**
+ * @brief  Task descriptor
+ */
+typedef struct {
+    const char * name;
+    u32 events;         // !< events that wake the task
+    LoopTask_t stats;   // !< LoopStats slot the run time is accounted to
+    bool (*run)(void);  // !< returns true while work remains, runs again next pass
+} SchedTask_t;
+
+/**
+ * @brief  Register the task table and start the tick timer, every task runs once
+ *
+ * timer_wheel_init() first, the tick is a timer.
+ *
+ * @param tasks table in priority order, lives as long as the scheduler
+ * @param num number of tasks, max SCHED_TASKS_MAX
+ */
+void sched_init(const SchedTask_t * tasks,
+                u8 num);
+
+/**
+ * @brief  Stop the tick, called before leaving the application
+ */
+void sched_deinit(void);
+
+/**
+ * @brief  Post events, safe from interrupt context
+ */
+void sched_post(u32 events);
+
+/**
+ * @brief  Run every task that has a pending event or is still busy, in table order
+ *
+ * Events posted during the pass are handled in the next pass.
+ *
+ * @param sample time the tasks (LoopStats)
+ *
+ * @returns true if a task ran, false if there was nothing to do
+ */
+bool sched_run_once(bool sample);
+
+/**
+ * @brief  Sleep until the next interrupt, returns at once if events are pending
+ */
+void sched_idle(void);
+
+#ifdef UNIT_TEST
+/**
+ * @brief  Native port: called instead of WFI, may post events (= the interrupt)
+ */
+void sched_set_idle_hook(void (*hook)(void));
+#endif
+
+#endif /* _SCHEDULER_H_ */
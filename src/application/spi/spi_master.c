@@ -6,19 +6,40 @@
 * Description         : spi
 *   - Spi communication is meant to program/verify the SPI Flash holding the
 *     Gowin bitfile.
-*   - Communication is Blocking (not IRQ based - to do)
+*   - Page reads and programs are interrupt driven transfers, erases and
+*     programs are not waited for: the queue entries stay in the queue until
+*     the operation is reaped, spi_master_update() only starts and reaps.
+*     The write cycle is polled every SPI_WIP_POLL_MS by a timer.
+*   - The queue (spi_queue.c) hands out batches: 2 contiguous page reads in
+*     one transfer, up to 4 contiguous page programs in one operation
+*   - Short commands (RDSR, RDID, DP, RDP) stay blocking
+*   - Page reads go through the page cache (spi_cache.c), programs and
+*     erases drop their pages from it
+*   - The mux is leased (spi_mux.c) while messages are queued, it goes back to
+*     the Gowin once idle (SCHED_EV_TICK polls it)
 * History:
 * 13/12/2021 : introduced in gpmcu code (DAVTH)
+* 16/10/2022 : 0x61 readback page ping-pong, SPI_IS25_PREFETCH
+* 18/10/2022 : non-blocking queue, read/program/erase timing PerfCounters
+* 18/10/2022 : priority queue with batching, moved to spi_queue.c
+* 18/10/2022 : spi mux lease instead of switching per message
+* 18/10/2022 : LRU page cache shared with the storage layer
 *******************************************************************************/
 
 #define _SPI_MASTER_C_
 
 #include <stdio.h> // for sprintf
+#include <string.h>
 
 // run code includes
 #include "spi_master.h"
 #include "data_map.h"
 #include "is25xp.h"
+#include "spi_cache.h"
+#include "i2c/i2c_slave_addr.h"
+#include "loop_stats.h"
+#include "scheduler.h"
+#include "timer_wheel.h"
 
 #ifndef UNIT_TEST
   #include "fsl_spi.h"
@@ -41,79 +62,103 @@
 #define SPI_MASTER_IRQHandler FLEXCOMM8_IRQHandler
 #define SPI_SPOL              kSPI_SpolActiveAllLow
 // #define SPI_BAUDRATE        500000U // uncomment to slow down to 5MHz
+#define SPI_WIP_POLL_MS       1 // page program 0.2..0.8ms, 4k erase 70..300ms
+
+/* operation in progress on the taken batch */
+typedef enum {
+    SPI_OP_IDLE = 0,
+    SPI_OP_XFER,                // interrupt transfer in flight (read, program)
+    SPI_OP_WIP,                 // write cycle of a program/erase
+} t_spi_op_state;
+
+typedef struct {
+    t_spi_op_state state;
+    t_spi_batch batch;          // queue entries, released when reaped
+    u8 pos;                     // entry in progress (page program batch)
+    u8 * data;                  // read buffer (one page)
+    u32 start;                  // core cycles when started
+    u32 epoch;                  // page cache epoch when the read started
+} t_spi_op;
 
 /*******************************************************************************
  * Prototypes
  ******************************************************************************/
+static void spi_queue_wait();
 
 /*******************************************************************************
  * Variables
  ******************************************************************************/
-static volatile u8 MsgIndex = 0;
-
-static volatile bool SpiMuxSelected = 0;
-
-static t_spi_msg SPI_MSG_QUEUE[SPI_MSG_QUEUE_LENGTH];
+static bool SpiMuxLeased = false;
 
+static t_spi_op SpiOp = { SPI_OP_IDLE, { 0 }, 0, NULL, 0, 0 };
+static Timer_t WipTimer = TIMER_EVENT_INIT(SCHED_EV_REQUEST);
+static bool SpiVerbose = true;
+static u8 SpiReadBuf[SPI_BATCH_READ_PAGES * SPI_BUFFER_SIZE]; // batched reads
 
 /*******************************************************************************
  * Code
  ******************************************************************************/
 
-/*  Code prepared for IRQ based communication, we'd need to supply this struct to is25xp... TO DO
- *
- * static SpiBuffer_t SPIBuffer={{}, {}, 0, 0, true}; // IRQ based buffer
- *
- * void FLEXCOMM8_IRQHandler(void)
- * {
- * // Check for oversize
- * if(SPIBuffer.rxIndex>BUFFER_SIZE)
- *  SPIBuffer.rxIndex = BUFFER_SIZE;
- * if(SPIBuffer.txIndex>BUFFER_SIZE)
- *  SPIBuffer.txIndex = BUFFER_SIZE;
- *
- * if ((SPI_GetStatusFlags(SPI_MASTER) & kSPI_RxNotEmptyFlag) && (SPIBuffer.rxIndex != 0))
- * {
- *  SPIBuffer.rxIndex--;
- *  SPIBuffer.rxBuff[SPIBuffer.rxIndex] = (u8) SPI_ReadData(SPI_MASTER);
- *  LOG_DEBUG("SPI_ReadData 0x%02X index=%d", SPIBuffer.rxBuff[SPIBuffer.rxIndex], SPIBuffer.rxIndex);
- * }
- *
- * if ((SPI_GetStatusFlags(SPI_MASTER) & kSPI_TxNotFullFlag) && (SPIBuffer.txIndex != 0))
- * {
- *    SPIBuffer.txIndex--;
- *    if (SPIBuffer.txIndex == 0)
- *    {
- *        if(SPIBuffer.txBuff[SPIBuffer.txIndex]!=IS25_DUMMY)
- *          LOG_DEBUG("SPI_WriteData last byte , 0x%02X",SPIBuffer.txBuff[SPIBuffer.txIndex]);
- *        // need to disable interrupts before write last data
- *        SPI_DisableInterrupts(SPI8, kSPI_TxLvlIrq);
- *        // param: kSPI_FrameAssert will take CS down
- *        SPI_WriteData(SPI_MASTER, SPIBuffer.txBuff[SPIBuffer.txIndex], kSPI_FrameAssert);
- *    }
- *    else
- *    {
- *        SPI_WriteData(SPI_MASTER, SPIBuffer.txBuff[SPIBuffer.txIndex], 0);
- *        if (SPIBuffer.txBuff[SPIBuffer.txIndex]!=IS25_DUMMY)
- *          LOG_DEBUG("SPI_WriteData, %02X",SPIBuffer.txBuff[SPIBuffer.txIndex]);
- *    }
- * }
- *
- * if ((SPIBuffer.txIndex == 0U) && (SPIBuffer.rxIndex == 0U))
- * {
- *    LOG_DEBUG("masterFinished");
- *    SPIBuffer.masterFinished = true;
- *    SPI_DisableInterrupts(SPI_MASTER, kSPI_RxLvlIrq);
- * }
- * SDK_ISR_EXIT_BARRIER;
- * }
- *
- *
- * void masterCallback(SPI_Type *base, spi_master_handle_t *masterHandle, status_t status, void *userData)
- * {
- *  masterFinished = true;
- * }
+void SPI_MASTER_IRQHandler(void) {
+    is25xp_irqhandler();
+    SDK_ISR_EXIT_BARRIER;
+}
+
+// transfer completed (interrupt): wake the spi task to reap it
+static void spi_transfer_done(void) {
+    sched_post(SCHED_EV_REQUEST);
+}
+
+void spi_mux_event(spi_mux_event_t ev,
+                   u32 value) {
+    switch (ev) {
+        case SPI_MUX_EV_SWITCH:
+            PERF_COUNT(SpiMuxSwitches);
+            break;
+        case SPI_MUX_EV_LEASE:
+            PERF_COUNT(SpiMuxLeases);
+            break;
+        case SPI_MUX_EV_HOLD:
+            PERF_MAX(SpiMuxHoldMaxUs, value);
+            break;
+        case SPI_MUX_EV_TIMEOUT:
+            PERF_COUNT(SpiMuxTimeouts);
+            break;
+        case SPI_MUX_EV_REVOKE:
+            PERF_COUNT(SpiMuxRevoked);
+            break;
+    }
+}
+
+void spi_cache_count(bool hit) {
+    if (hit)
+        PERF_COUNT(SpiCacheHit);
+    else
+        PERF_COUNT(SpiCacheMiss);
+}
+
+static u32 spi_elapsed_us(u32 start) {
+    u32 cycles_per_us = SystemCoreClock / 1000000U;
+
+    return (LOOP_STATS_NOW() - start) / (cycles_per_us ? cycles_per_us : 1U);
+}
+
+static const t_spi_msg * spi_op_msg(u8 pos) {
+    return spi_queue_entry(SpiOp.batch.index[pos]);
+}
+
+/*!
+ * @brief spi_write_invalidate()
+ * A program/erase changes the pages of the message: dropped from the 0x61
+ * ping-pong and from the page cache
  */
+static void spi_write_invalidate(const t_spi_msg * msg) {
+    u32 first, end;
+
+    i2c_slave_page_invalidate();
+    if (spi_queue_pages(msg, &first, &end))
+        spi_cache_invalidate(first, end - first);
+}
 
 /*!
  * @brief spi_master_setup()
@@ -131,43 +176,34 @@ void spi_master_setup() {
 #if defined(SPI_BAUDRATE)
     masterConfig.baudRate_Bps = SPI_BAUDRATE;
 #else
-    masterConfig.baudRate_Bps = 25000000U;
+    masterConfig.baudRate_Bps = CONFIG_IS25XP_SPIFREQUENCY;
 #endif
     SPI_MasterInit(SPI_MASTER, &masterConfig, srcClock_Hz);
 
-    BOARD_SetSPIMux(1);
-
     LOG_DEBUG("spi_master_setup on flexcomm8");
 
-    for (int i = 0; i < SPI_MSG_QUEUE_LENGTH; i++) {
-        SPI_MSG_QUEUE[i].cmd = SPI_NO_CMD;
-        SPI_MSG_QUEUE[i].param[0] = 0;
-        SPI_MSG_QUEUE[i].param[1] = 0;
-        SPI_MSG_QUEUE[i].param[2] = 0;
-    }
+    spi_queue_init(SystemCoreClock / 1000000U);
+    is25xp_async_init(spi_transfer_done);
+    SpiOp.state = SPI_OP_IDLE;
 
     // initialisation of SPI Flash struct
-    is25xp_readid(Main.BoardIdentification.SpiFlash_Identification, 1);
-
-    BOARD_SetSPIMux(0);
+    if (spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, SPI_MUX_FPGA_LOAD_US)) {
+        is25xp_readid(Main.BoardIdentification.SpiFlash_Identification, 1);
+        spi_mux_release(SPI_MUX_CLIENT_QUEUE);
+    } else {
+        LOG_ERROR("SPI Flash in use by the Gowin");
+    }
 }
 
 /*!
- * @brief spi_read_page()
- * Helper function for reading back data inside the SPI Flash with printout
+ * @brief spi_print_page()
+ * Printout of a page read back
  */
-void spi_read_page(u16 startpage,
-                   bool verbose) {
-    int ret = is25xp_bread(startpage, 1, Main.Debug.SpiFlashPage, verbose);
-
-    if (!verbose)
-        return;
-
-    LOG_DEBUG("is25xp_bread startblock: %04lx returned [%d]", (long)startpage, ret);
+static void spi_print_page(u16 startpage,
+                           const u8 * data) {
+    LOG_DEBUG("is25xp read page: %04lx", (long)startpage);
 
     // print the read buffer = 1page
-    u8 * data;
-    data = Main.Debug.SpiFlashPage;
     for (int j = 0; j <= (8 * 2) - 1; j++) {
         char buf[128], * pos = buf;
         for (int i = 0; i != 16; i++) {
@@ -179,90 +215,191 @@ void spi_read_page(u16 startpage,
 }
 
 /*!
- * @brief spi_master_update()
+ * @brief spi_read_cached()
+ * A page held on 0x61 (READ) or in the page cache: published or kept back
+ * without spi read
+ * @return true: done, false: to be read
  */
-void spi_master_update() {
-    if (spi_queue_size(false) > 0) {
-        BOARD_SetSPIMux(1);
-        SpiMuxSelected = true;
-        spi_queue_process();
-    } else {
-        if (SpiMuxSelected) {
-            BOARD_SetSPIMux(0);
-            SpiMuxSelected = false;
-            // LOG_DEBUG("SPI Mux off");
+static bool spi_read_cached(u16 startpage,
+                            bool publish,
+                            bool verbose) {
+    if (publish) {
+        const u8 * data = i2c_slave_page_lookup(startpage);
+
+        if (data) {
+            PERF_COUNT(I2cPagePrefetchHit);
+            if (verbose)
+                spi_print_page(startpage, data);
+            return true;
         }
     }
+
+    const u8 * cached = spi_cache_lookup(startpage);
+    if (!cached)
+        return false;
+
+    u8 * page = i2c_slave_page_back(startpage, !publish);
+    if (page) { // NULL: prefetched already or the back buffer waits to be published
+        memcpy(page, cached, SPI_BUFFER_SIZE);
+        i2c_slave_page_filled(startpage, publish);
+        if (publish && verbose)
+            spi_print_page(startpage, page);
+    }
+    return true;
 }
 
 /*!
- * @brief spi_master_disable
+ * @brief spi_read_page()
+ * Reading back data inside the SPI Flash, published on i2c 0x61 once read.
+ * A prefetched or cached page is published without spi read.
+ * @return 0: done, 1: read in flight, <0: flash busy
  */
-void spi_master_disable() {
-    LOG_DEBUG("spi_master_setup on flexcomm8 disabled");
-    /* Enable interrupt, first enable slave and then master. */
-    DisableIRQ(SPI_MASTER_IRQ);
-    SPI_DisableInterrupts(SPI_MASTER, kSPI_TxLvlIrq | kSPI_RxLvlIrq);
-    BOARD_SetSPIMux(0);
+int spi_read_page(u16 startpage,
+                  bool verbose) {
+    if (spi_read_cached(startpage, true, verbose))
+        return 0;
+
+    u8 * page = i2c_slave_page_back(startpage, false);
+    int ret = is25xp_read_start((off_t)startpage << IS25_IS25LP128_PAGE_SHIFT,
+                                IS25_IS25XP_BYTES_PER_PAGE, page);
+    if (ret < 0)
+        return ret;
+    SpiOp.data = page;
+    SpiOp.epoch = spi_cache_epoch();
+    return 1;
 }
 
-const char * returnSpiCmdName(t_spi_command val) {
-    switch (val) {
-        case SPI_NO_CMD:
-            return "NO_CMD";
-        case SPI_IS25_PP:
-            return "IS25_PageProgram";
-        case SPI_IS25_RDSR:
-            return "IS25_ReadStatusReg";
-        case SPI_IS25_READ:
-            return "IS25_READ";
-        case SPI_IS25_CER:
-            return "IS25_ChipErase";
-        case SPI_IS25_RDID:
-            return "IS25_ReadId";
-        case SPI_IS25_SE:
-        case SPI_IS25_SE_:
-            return "IS25_SectorErase";
-        case SPI_IS25_BER32:
-            return "IS25_BlockErase 32k";
-        case SPI_IS25_BER64:
-            return "IS25_BlockErase 64k";
-        case SPI_IS25_DP:
-            return "IS25_DeepPowerDown";
-        case SPI_IS25_RDP:
-            return "IS25_ReleasePowerdown";
-        case SPI_IS25_VERBOSE:
-            return "IS25_Verbosity";
+/*!
+ * @brief spi_prefetch_page()
+ * Read ahead of the 0x61 readback: the next page goes in the back buffer
+ * while the host clocks out the current one, its READ then only swaps
+ * @return 0: done, 1: read in flight, <0: flash busy
+ */
+int spi_prefetch_page(u16 startpage) {
+    u8 * page = i2c_slave_page_back(startpage, true);
+
+    if (!page) // held already or the back buffer waits to be published
+        return 0;
+    if (spi_read_cached(startpage, false, false))
+        return 0;
+
+    int ret = is25xp_read_start((off_t)startpage << IS25_IS25LP128_PAGE_SHIFT,
+                                IS25_IS25XP_BYTES_PER_PAGE, page);
+    if (ret < 0)
+        return ret;
+    SpiOp.data = page;
+    SpiOp.epoch = spi_cache_epoch();
+    return 1;
+}
 
-        default:
-            return "";
+/*!
+ * @brief spi_read_batch()
+ * Contiguous READ/PREFETCH messages in one transfer: a page held on 0x61 or
+ * in the page cache is served right away, the rest is read
+ * @return 0: done, 1: read in flight, <0: flash busy
+ */
+static int spi_read_batch() {
+    const t_spi_msg * msg;
+    u8 keep = 0;
+
+    if (SpiOp.batch.count == 1) {
+        msg = spi_op_msg(0);
+        if (msg->cmd == SPI_IS25_READ)
+            return spi_read_page(spi_queue_page(msg), SpiVerbose);
+        return spi_prefetch_page(spi_queue_page(msg));
     }
+
+    for (u8 pos = 0; pos < SpiOp.batch.count; pos++) {
+        msg = spi_op_msg(pos);
+        if (spi_read_cached(spi_queue_page(msg), msg->cmd == SPI_IS25_READ, SpiVerbose))
+            spi_queue_release(SpiOp.batch.index[pos]);
+        else
+            SpiOp.batch.index[keep++] = SpiOp.batch.index[pos];
+    }
+    SpiOp.batch.count = keep;
+    if (keep == 0)
+        return 0;
+
+    // SPI_BATCH_READ_PAGES (2): the pages left are contiguous still
+    msg = spi_op_msg(0);
+    int ret = is25xp_read_start((off_t)spi_queue_page(msg) << IS25_IS25LP128_PAGE_SHIFT,
+                                keep * IS25_IS25XP_BYTES_PER_PAGE, SpiReadBuf);
+    if (ret < 0)
+        return ret;
+    SpiOp.data = NULL;
+    SpiOp.epoch = spi_cache_epoch();
+    return 1;
 }
 
 /*!
- * @brief invalid_spi_cmd
- * @param cmd command
+ * @brief spi_read_reap()
+ * Read transfer completed: publish the READ pages, keep the PREFETCH one back,
+ * all go in the page cache
  */
-bool invalid_spi_cmd(t_spi_command cmd) {
-    switch (cmd) {
-        case SPI_IS25_PP:
-        case SPI_IS25_RDSR:
-        case SPI_IS25_READ:
-        case SPI_IS25_CER:
-        case SPI_IS25_RDID:
-        case SPI_IS25_SE:
-        case SPI_IS25_SE_:
-        case SPI_IS25_BER32:
-        case SPI_IS25_BER64:
-        case SPI_IS25_DP:
-        case SPI_IS25_RDP:
-        case SPI_IS25_VERBOSE:
-            return false;
+static void spi_read_reap() {
+    for (u8 pos = 0; pos < SpiOp.batch.count; pos++) {
+        const t_spi_msg * msg = spi_op_msg(pos);
+        bool publish = (msg->cmd == SPI_IS25_READ);
+        u16 startpage = spi_queue_page(msg);
+        u8 * page = SpiOp.data;
+
+        if (!page) { // batched, copy from the transfer buffer
+            spi_cache_fill(startpage, &SpiReadBuf[pos * SPI_BUFFER_SIZE], SpiOp.epoch);
+            page = i2c_slave_page_back(startpage, !publish);
+            if (!page)
+                continue;
+            memcpy(page, &SpiReadBuf[pos * SPI_BUFFER_SIZE], SPI_BUFFER_SIZE);
+        } else {
+            spi_cache_fill(startpage, page, SpiOp.epoch);
+        }
+        i2c_slave_page_filled(startpage, publish);
+        if (publish && SpiVerbose)
+            spi_print_page(startpage, page);
+    }
+}
 
-        default:
-            LOG_ERROR("[%02X]is not an SPI command", cmd);
-            return true;
+/*!
+ * @brief spi_master_update()
+ */
+bool spi_master_update() {
+    if (spi_queue_size(false) > 0) {
+        if (!SpiMuxLeased) {
+            if (!spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0)) { // the Gowin loads its bitfile
+                spi_queue_wait();
+                return false;
+            }
+            SpiMuxLeased = true;
+        }
+        spi_queue_process();
+        // in progress or flash busy: the transfer interrupt or the poll timer wakes us
+        return (SpiOp.state == SPI_OP_IDLE) && !timer_pending(&WipTimer) &&
+               (spi_queue_size(false) > 0);
+    }
+    if (SpiMuxLeased) {
+        spi_mux_release(SPI_MUX_CLIENT_QUEUE);
+        SpiMuxLeased = false;
+    }
+    spi_mux_poll(); // back to the Gowin once idle, SCHED_EV_TICK polls again
+    return false;
+}
+
+/*!
+ * @brief spi_master_disable
+ */
+void spi_master_disable() {
+    LOG_DEBUG("spi_master_setup on flexcomm8 disabled");
+    while (!is25xp_transfer_done())
+        ;
+    timer_cancel(&WipTimer);
+    if (SpiOp.state != SPI_OP_IDLE) { // the write cycle ends without us
+        spi_queue_done();
+        SpiOp.state = SPI_OP_IDLE;
     }
+    /* Enable interrupt, first enable slave and then master. */
+    DisableIRQ(SPI_MASTER_IRQ);
+    SPI_DisableInterrupts(SPI_MASTER, kSPI_TxLvlIrq | kSPI_RxLvlIrq);
+    SpiMuxLeased = false;
+    spi_mux_reset();
 }
 
 /*!
@@ -274,137 +411,152 @@ bool invalid_spi_cmd(t_spi_command cmd) {
  */
 void spi_queue_msg_param(u8 * data,
                          u16 size) {
-    if (invalid_spi_cmd(data[0]))
-        return;
-
-    if (spi_queue_size(false) >= SPI_MSG_QUEUE_LENGTH) {
-        LOG_WARN("SPI QUEUE is full");
-        spi_queue_size(true);
-        return;
-    }
+    spi_queue_push(data, size, LOOP_STATS_NOW());
+}
 
-    u8 newId = MsgIndex;
-    for (int i = 0u; i < SPI_MSG_QUEUE_LENGTH; i++) {
-        if (SPI_MSG_QUEUE[i].cmd == SPI_NO_CMD) {
-            newId = (u8)i;
-            break;
-        }
-    }
+/*!
+ * @brief spi_queue_msg(t_spi_command cmd)
+ */
+void spi_queue_msg(t_spi_command cmd) {
+    u8 data = (u8)cmd;
 
-    int i = 0; // data iterator
-    SPI_MSG_QUEUE[newId].cmd = data[i++];
-    for (int j = 0u; i < size; i++) {
-        if (data[0] == SPI_IS25_PP) {
-            if (i < 3) // u16 address to program
-                SPI_MSG_QUEUE[newId].param[i - 1] = data[i];
-            else
-                SPI_MSG_QUEUE[newId].data[j++] = data[i];
-        } else {
-            // LOG_DEBUG("adding param %d[%02X]",i-1,data[i]);
-            SPI_MSG_QUEUE[newId].param[i - 1] = data[i];
-        }
-    }
+    if (spi_queue_push(&data, 1, LOOP_STATS_NOW()))
+        LOG_DEBUG("SPI_Queue_Msg %s", returnSpiCmdName(cmd));
+}
 
-    // LOG_DEBUG("SPI_Queue_Msg[%s] on index[%d]", returnSpiCmdName(data[0]), newId);
+/*!
+ * @brief spi_queue_wait
+ * Flash busy: poll again after SPI_WIP_POLL_MS
+ */
+static void spi_queue_wait() {
+    if (!timer_pending(&WipTimer))
+        timer_start(&WipTimer, SPI_WIP_POLL_MS);
 }
 
 /*!
- * @brief spi_queue_msg(t_spi_command cmd)
+ * @brief spi_queue_reap
+ * Completes the operation in progress, the next page of a program batch is
+ * started right away
+ * @return false while it is in progress
  */
-void spi_queue_msg(t_spi_command cmd) {
-    if (invalid_spi_cmd(cmd))
-        return;
+static bool spi_queue_reap() {
+    t_spi_command cmd = spi_op_msg(SpiOp.pos)->cmd;
 
-    if (spi_queue_size(false) >= SPI_MSG_QUEUE_LENGTH) {
-        LOG_WARN("SPI QUEUE is full");
-        return;
+    if (SpiOp.state == SPI_OP_XFER) {
+        if (!is25xp_transfer_done())
+            return false;
+        if (cmd != SPI_IS25_PP) { // page reads, published or kept back
+            spi_read_reap();
+            PERF_MAX(SpiReadMaxUs, spi_elapsed_us(SpiOp.start));
+            spi_queue_done();
+            SpiOp.state = SPI_OP_IDLE;
+            return true;
+        }
+        SpiOp.state = SPI_OP_WIP;
     }
 
-    u8 newId = MsgIndex;
-    for (int i = 0u; i < SPI_MSG_QUEUE_LENGTH; i++) {
-        if (SPI_MSG_QUEUE[i].cmd == SPI_NO_CMD) {
-            newId = (u8)i;
-            break;
-        }
+    if (is25xp_busy()) {
+        PERF_COUNT(SpiWipPolls);
+        spi_queue_wait();
+        return false;
     }
+    timer_cancel(&WipTimer);
 
-    SPI_MSG_QUEUE[newId].cmd = cmd;
+    if (cmd != SPI_IS25_PP) {
+        PERF_MAX(SpiEraseMaxUs, spi_elapsed_us(SpiOp.start));
+        spi_queue_done();
+        SpiOp.state = SPI_OP_IDLE;
+        return true;
+    }
 
-    LOG_DEBUG("SPI_Queue_Msg %s on index %d", returnSpiCmdName(cmd), newId);
+    PERF_MAX(SpiProgramMaxUs, spi_elapsed_us(SpiOp.start));
+    spi_queue_release(SpiOp.batch.index[SpiOp.pos]);
+    while (++SpiOp.pos < SpiOp.batch.count) { // next page of the batch
+        const t_spi_msg * msg = spi_op_msg(SpiOp.pos);
+        int ret;
+
+        SpiOp.start = LOOP_STATS_NOW();
+        spi_write_invalidate(msg);
+        ret = is25xp_pagewrite_start(msg->data, spi_queue_page(msg));
+        if (ret == 0) {
+            SpiOp.state = SPI_OP_XFER;
+            return false;
+        }
+        LOG_ERROR("%s failed [%d]", returnSpiCmdName(msg->cmd), ret);
+        spi_queue_release(SpiOp.batch.index[SpiOp.pos]);
+    }
+    SpiOp.state = SPI_OP_IDLE;
+    return true;
 }
 
 /*!
  * @brief spi_queue_process
+ * Reaps the operation in progress, else takes the next batch and starts it
  */
 void spi_queue_process() {
-    static u8 prevIndex = 0;
-    static bool verbose = true;
-
-    // set index to next command , try to maintain order of commands
-    if (prevIndex < (SPI_MSG_QUEUE_LENGTH - 1)) {
-        if (SPI_MSG_QUEUE[prevIndex + 1].cmd != SPI_NO_CMD)
-            MsgIndex = (u8)(prevIndex + 1);
-        else
-            MsgIndex = 0;
-    } else {
-        MsgIndex = 0;
-    }
-
-    if (MsgIndex == 0) {
-        for (int i = 0u; i < SPI_MSG_QUEUE_LENGTH; i++) {
-            if (SPI_MSG_QUEUE[i].cmd != SPI_NO_CMD) {
-                MsgIndex = (u8)i;
-                break;
-            }
-        }
-    }
-
-    prevIndex = MsgIndex;
+    if ((SpiOp.state != SPI_OP_IDLE) && !spi_queue_reap())
+        return;
 
-    if (SPI_MSG_QUEUE[MsgIndex].cmd == SPI_NO_CMD)
+    if (!spi_queue_take(&SpiOp.batch, LOOP_STATS_NOW()))
         return;
 
+    const t_spi_msg * msg = spi_op_msg(0);
+
     /*
-     * LOG_DEBUG("SPI_Process_Queue index[%d] cmd[%s] param[%02x %02x %02x]", MsgIndex,
-     *        returnSpiCmdName(SPI_MSG_QUEUE[MsgIndex].cmd),
-     *        SPI_MSG_QUEUE[MsgIndex].param[0],
-     *        SPI_MSG_QUEUE[MsgIndex].param[1],
-     *        SPI_MSG_QUEUE[MsgIndex].param[2]);
+     * LOG_DEBUG("SPI_Process_Queue cmd[%s] param[%02x %02x %02x] batch[%d]",
+     *        returnSpiCmdName(msg->cmd), msg->param[0], msg->param[1], msg->param[2],
+     *        SpiOp.batch.count);
      */
 
-    u16 blockNr = (u16)((SPI_MSG_QUEUE[MsgIndex].param[0] << 8) +
-                        SPI_MSG_QUEUE[MsgIndex].param[1]);
+    u16 blockNr = spi_queue_page(msg);
     u16 sectorNr = blockNr >> 4; // 1 sector is 4k 0x0..0x1000(12bit)
+    t_spi_op_state next = SPI_OP_IDLE; // what the started command waits for
+    int ret = 0;
 
-    switch (SPI_MSG_QUEUE[MsgIndex].cmd) {
+    SpiOp.pos = 0;
+    SpiOp.start = LOOP_STATS_NOW();
+
+    switch (msg->cmd) {
         case SPI_NO_CMD:
             break;
         case SPI_IS25_PP:
-            is25xp_pagewrite(SPI_MSG_QUEUE[MsgIndex].data, blockNr);
+            spi_write_invalidate(msg);
+            ret = is25xp_pagewrite_start(msg->data, blockNr);
+            next = SPI_OP_XFER;
             break;
         case SPI_IS25_RDSR:
-            is25xp_read_status_register(verbose);
+            is25xp_read_status_register(SpiVerbose);
             break;
         case SPI_IS25_READ: // Page Read verbose
-            spi_read_page(blockNr, verbose);
+        case SPI_IS25_PREFETCH:
+            ret = spi_read_batch();
+            next = (ret > 0) ? SPI_OP_XFER : SPI_OP_IDLE; // 0: pages held already, no read
             break;
         // ---------------------- ERASE COMMANDS --------------------------------------
         case SPI_IS25_BER32:
-            is25xp_sectorerase(sectorNr, IS25_BE32);
+            spi_write_invalidate(msg);
+            ret = is25xp_erase_start(sectorNr, IS25_BE32);
+            next = SPI_OP_WIP;
             break;
         case SPI_IS25_BER64:
-            is25xp_sectorerase(sectorNr, IS25_BE64);
+            spi_write_invalidate(msg);
+            ret = is25xp_erase_start(sectorNr, IS25_BE64);
+            next = SPI_OP_WIP;
             break;
         case SPI_IS25_SE: // Sector Erase is per 4K
-            is25xp_erase(sectorNr, 1);
+            spi_write_invalidate(msg);
+            ret = is25xp_erase_start(sectorNr, IS25_SE);
+            next = SPI_OP_WIP;
             break;
         case SPI_IS25_SE_: // Sector Erase is per 4K, identical commands
-            is25xp_sectorerase(sectorNr, IS25_SE_);
+            spi_write_invalidate(msg);
+            ret = is25xp_erase_start(sectorNr, IS25_SE_);
+            next = SPI_OP_WIP;
             break;
         case SPI_IS25_CER: // to be disabled for safeguarding Flash???
-            Main.Diagnostics.WatchDogDisabled = true;
-            is25xp_bulkerase();
-            Main.Diagnostics.WatchDogDisabled = false;
+            spi_write_invalidate(msg);
+            ret = is25xp_erase_start(0, IS25_CER); // the loop keeps the watchdog fed
+            next = SPI_OP_WIP;
             break;
         // ----------------------------------------------------------------------------
         case SPI_IS25_RDID:
@@ -417,36 +569,28 @@ void spi_queue_process() {
             is25xp_PowerDown();
             break;
         case SPI_IS25_VERBOSE:
-            if (SPI_MSG_QUEUE[MsgIndex].param[0] == 0)
-                verbose = false;
+            if (msg->param[0] == 0)
+                SpiVerbose = false;
             else
-                verbose = true;
-            LOG_DEBUG("input[%x]->spi verbose is %s", SPI_MSG_QUEUE[MsgIndex].param[0], verbose ?
+                SpiVerbose = true;
+            LOG_DEBUG("input[%x]->spi verbose is %s", msg->param[0], SpiVerbose ?
                       "ON" : "OFF");
             break;
         default:
             break;
     }
 
-    SPI_MSG_QUEUE[MsgIndex].cmd = SPI_NO_CMD;
-}
-
-u8 spi_queue_size(bool verbose) {
-    u8 pending_msg = 0;
-
-    for (int i = 0u; i < SPI_MSG_QUEUE_LENGTH; i++) {
-        if (SPI_MSG_QUEUE[i].cmd != SPI_NO_CMD) {
-            if (verbose)
-                LOG_DEBUG("Queue item[%d] -> [%s]", i, returnSpiCmdName(SPI_MSG_QUEUE[i].cmd));
-            pending_msg++;
-        }
+    if (ret == -EBUSY) { // write cycle of an other user (spi_update, i2c stream)
+        spi_queue_retry(); // keeps its place
+        spi_queue_wait();
+        return;
+    }
+    if (ret < 0) {
+        LOG_ERROR("%s failed [%d]", returnSpiCmdName(msg->cmd), ret);
+        next = SPI_OP_IDLE;
     }
 
-    if (pending_msg != 0 && verbose)
-        LOG_DEBUG("Queue size is %d", pending_msg);
-
-    if (pending_msg >= SPI_MSG_QUEUE_LENGTH && verbose)
-        LOG_WARN("SPI message-Queue is FULL!");
-
-    return pending_msg;
+    SpiOp.state = next;
+    if (next == SPI_OP_IDLE)
+        spi_queue_done();
 }
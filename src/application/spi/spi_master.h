@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "spi_queue.h"
+#include "spi_mux.h"
+
 typedef uint8_t u8;
 typedef uint16_t u16;
 typedef uint32_t u32;
@@ -18,43 +21,6 @@ typedef uint32_t u32;
 #define EXTERN extern
 #endif
 
-typedef enum {
-    SPI_NO_CMD       = 0x00u,
-    SPI_IS25_PP      = 0x02u,
-    SPI_IS25_RDSR    = 0x05u,
-    SPI_IS25_READ    = 0x03u,
-    SPI_IS25_CER     = 0xC7u,
-    SPI_IS25_RDID    = 0x9fu,
-    SPI_IS25_SE      = 0x20u,
-    SPI_IS25_SE_     = 0xd7u,
-    SPI_IS25_BER32   = 0x52,
-    SPI_IS25_BER64   = 0xd8,
-    SPI_IS25_DP      = 0xB9, // deep powerdown
-    SPI_IS25_RDP     = 0xAB, // release deep sleep
-    // custom commands
-    SPI_IS25_VERBOSE = 0xDE,
-}
-t_spi_command;
-
-typedef struct __attribute__((packed)) {
-    t_spi_command cmd;
-    u8 param[3]; // Address var
-    u8 data[256]; // for Page Program data
-} t_spi_msg;
-
-#define SPI_MSG_QUEUE_LENGTH 5
-#define SPI_BUFFER_SIZE      256
-
-/* SPI buffer */
-#define BUFFER_SIZE          (10)
-typedef struct __attribute__((packed)) {
-    u8 txBuff[BUFFER_SIZE];
-    u8 rxBuff[BUFFER_SIZE];
-    u16 txIndex;
-    u16 rxIndex;
-    volatile bool masterFinished;
-} SpiBuffer_t;
-
 /*
  * @brief spi_master_setup
  * setup and initialize SPI
@@ -71,17 +37,38 @@ void spi_master_disable();
 /*
  * @brief spi_master_update
  * Called from main routin to check for queued messages
- * Takes care of disabling the MUX-select when no data needs to be sent
- * @return void
+ * Starts the next message or reaps the one in progress, never waits on the
+ * flash. Leases the spi mux while messages are queued, the mux goes back to
+ * the Gowin once idle (spi_mux_poll)
+ * @return true when the next message can be started right away, an operation
+ *         in progress wakes the task (transfer interrupt, write cycle poll)
+ */
+bool spi_master_update();
+
+/*
+ * @brief spi_read_page / spi_prefetch_page
+ * Start the read of a page for i2c 0x61, reaped by spi_queue_process()
+ * @return 0: done (page held), 1: read in flight, <0: flash busy or error
  */
-void spi_master_update();
+int spi_read_page(u16 startpage,
+                  bool print);
+int spi_prefetch_page(u16 startpage);
 
-void spi_read_page(u16 startpage,
-                   bool print);
+/*
+ * @brief spi_mux_event
+ * Counts the spi mux statistics in the PerfCounters, hook of spi_mux_init()
+ */
+void spi_mux_event(spi_mux_event_t ev,
+                   u32 value);
+
+/*
+ * @brief spi_cache_count
+ * Counts the page cache hits/misses in the PerfCounters, hook of spi_cache_init()
+ */
+void spi_cache_count(bool hit);
 EXTERN void spi_queue_msg_param(u8 * param,
                                 u16 size);
 EXTERN void spi_queue_msg(t_spi_command cmd);
 void spi_queue_process();
-u8 spi_queue_size(bool verbose);
 
 #endif // __SPI_MASTER_H__
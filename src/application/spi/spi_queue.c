@@ -0,0 +1,344 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : spi_queue.c
+* Author              : Barco
+* created             : 18/10/2022
+* Description         : SPI flash message queue, priorities and batching, no
+*                       hardware access: spi_master.c executes the batches
+* History:
+* 18/10/2022 : introduced in gpmcu code, split from spi_master.c
+*******************************************************************************/
+
+#include <string.h>
+
+#include "spi_queue.h"
+
+#include "logger.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define SPI_PAGES_ALL       0x10000UL // !< chip erase, 16MB of 256 byte pages
+
+typedef struct {
+    t_spi_msg msg;
+    u32 seq;                // !< order of arrival
+    u32 queued;             // !< core cycles when pushed
+    bool taken;             // !< in the batch in progress
+} t_spi_entry;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static t_spi_entry _queue[SPI_MSG_QUEUE_LENGTH];
+static u32 _seq = 0;
+static u32 _cycles_per_us = 1;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+const char * returnSpiCmdName(t_spi_command val) {
+    switch (val) {
+        case SPI_NO_CMD:
+            return "NO_CMD";
+        case SPI_IS25_PP:
+            return "IS25_PageProgram";
+        case SPI_IS25_RDSR:
+            return "IS25_ReadStatusReg";
+        case SPI_IS25_READ:
+            return "IS25_READ";
+        case SPI_IS25_CER:
+            return "IS25_ChipErase";
+        case SPI_IS25_RDID:
+            return "IS25_ReadId";
+        case SPI_IS25_SE:
+        case SPI_IS25_SE_:
+            return "IS25_SectorErase";
+        case SPI_IS25_BER32:
+            return "IS25_BlockErase 32k";
+        case SPI_IS25_BER64:
+            return "IS25_BlockErase 64k";
+        case SPI_IS25_DP:
+            return "IS25_DeepPowerDown";
+        case SPI_IS25_RDP:
+            return "IS25_ReleasePowerdown";
+        case SPI_IS25_VERBOSE:
+            return "IS25_Verbosity";
+        case SPI_IS25_PREFETCH:
+            return "IS25_Prefetch";
+
+        default:
+            return "";
+    }
+}
+
+/*!
+ * @brief invalid_spi_cmd
+ * @param cmd command
+ */
+bool invalid_spi_cmd(t_spi_command cmd) {
+    switch (cmd) {
+        case SPI_IS25_PP:
+        case SPI_IS25_RDSR:
+        case SPI_IS25_READ:
+        case SPI_IS25_CER:
+        case SPI_IS25_RDID:
+        case SPI_IS25_SE:
+        case SPI_IS25_SE_:
+        case SPI_IS25_BER32:
+        case SPI_IS25_BER64:
+        case SPI_IS25_DP:
+        case SPI_IS25_RDP:
+        case SPI_IS25_VERBOSE:
+        case SPI_IS25_PREFETCH:
+            return false;
+
+        default:
+            LOG_ERROR("[%02X]is not an SPI command", cmd);
+            return true;
+    }
+}
+
+u16 spi_queue_page(const t_spi_msg * msg) {
+    return (u16)((msg->param[0] << 8) + msg->param[1]);
+}
+
+static t_spi_prio _prio(t_spi_command cmd) {
+    switch (cmd) {
+        case SPI_IS25_READ:
+            return SPI_PRIO_READ;
+        case SPI_IS25_PREFETCH:
+            return SPI_PRIO_PREFETCH;
+        default:
+            return SPI_PRIO_BACKGROUND;
+    }
+}
+
+static bool _writes(t_spi_command cmd) {
+    switch (cmd) {
+        case SPI_IS25_PP:
+        case SPI_IS25_SE:
+        case SPI_IS25_SE_:
+        case SPI_IS25_BER32:
+        case SPI_IS25_BER64:
+        case SPI_IS25_CER:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool spi_queue_pages(const t_spi_msg * msg,
+                     u32 * first,
+                     u32 * end) {
+    u32 page = spi_queue_page(msg);
+    u32 pages;
+
+    switch (msg->cmd) {
+        case SPI_IS25_READ:
+        case SPI_IS25_PREFETCH:
+        case SPI_IS25_PP:
+            pages = 1;
+            break;
+        case SPI_IS25_SE:
+        case SPI_IS25_SE_:
+            pages = 4096 / SPI_BUFFER_SIZE;
+            break;
+        case SPI_IS25_BER32:
+            pages = 32768 / SPI_BUFFER_SIZE;
+            break;
+        case SPI_IS25_BER64:
+            pages = 65536 / SPI_BUFFER_SIZE;
+            break;
+        case SPI_IS25_CER:
+            page = 0;
+            pages = SPI_PAGES_ALL;
+            break;
+        default:
+            return false;
+    }
+    *first = page & ~(pages - 1); // erases are aligned by the flash
+    *end = *first + pages;
+    return true;
+}
+
+// a can't be reordered with b
+static bool _conflict(const t_spi_msg * a,
+                      const t_spi_msg * b) {
+    u32 a_first, a_end, b_first, b_end;
+
+    if (!spi_queue_pages(a, &a_first, &a_end) || !spi_queue_pages(b, &b_first, &b_end))
+        return true; // no address: keeps its place
+    if (!_writes(a->cmd) && !_writes(b->cmd))
+        return false;
+    return (a_first < b_end) && (b_first < a_end);
+}
+
+// no earlier message (taken ones excepted) it conflicts with
+static bool _eligible(u8 i) {
+    for (u8 j = 0; j < SPI_MSG_QUEUE_LENGTH; j++) {
+        if ((_queue[j].msg.cmd == SPI_NO_CMD) || _queue[j].taken)
+            continue;
+        if (((int32_t)(_queue[j].seq - _queue[i].seq) < 0) && _conflict(&_queue[i].msg, &_queue[j].msg))
+            return false;
+    }
+    return true;
+}
+
+void spi_queue_init(u32 cycles_per_us) {
+    _cycles_per_us = cycles_per_us ? cycles_per_us : 1U;
+    for (int i = 0; i < SPI_MSG_QUEUE_LENGTH; i++) {
+        _queue[i].msg.cmd = SPI_NO_CMD;
+        _queue[i].msg.param[0] = 0;
+        _queue[i].msg.param[1] = 0;
+        _queue[i].msg.param[2] = 0;
+        _queue[i].taken = false;
+    }
+}
+
+/*!
+ * @brief spi_queue_push
+ *
+ * @param data data pointer
+ *             The data pointer first 3 bytes are cmd + 2 data bytes
+ * @param size size of the data
+ */
+bool spi_queue_push(const u8 * data,
+                    u16 size,
+                    u32 now) {
+    if (invalid_spi_cmd(data[0]))
+        return false;
+
+    u8 pending = spi_queue_size(false);
+    if (pending >= SPI_MSG_QUEUE_LENGTH) {
+        LOG_WARN("SPI QUEUE is full");
+        PERF_COUNT(SpiQueueOverflow);
+        spi_queue_size(true);
+        return false;
+    }
+    PERF_MAX(SpiQueueHighWater, pending + 1);
+
+    u8 newId = 0;
+    for (int i = 0u; i < SPI_MSG_QUEUE_LENGTH; i++) {
+        if (_queue[i].msg.cmd == SPI_NO_CMD) {
+            newId = (u8)i;
+            break;
+        }
+    }
+
+    t_spi_msg * msg = &_queue[newId].msg;
+    int i = 0; // data iterator
+    msg->cmd = data[i++];
+    msg->param[0] = 0;
+    msg->param[1] = 0;
+    msg->param[2] = 0;
+    for (int j = 0u; (i < size) && (j < SPI_BUFFER_SIZE); i++) {
+        if (data[0] == SPI_IS25_PP) {
+            if (i < 3) // u16 address to program
+                msg->param[i - 1] = data[i];
+            else
+                msg->data[j++] = data[i];
+        } else if (i < 4) {
+            msg->param[i - 1] = data[i];
+        }
+    }
+    _queue[newId].seq = _seq++;
+    _queue[newId].queued = now;
+    _queue[newId].taken = false;
+
+    // LOG_DEBUG("SPI_Queue_Msg[%s] on index[%d]", returnSpiCmdName(data[0]), newId);
+    return true;
+}
+
+u8 spi_queue_size(bool verbose) {
+    u8 pending_msg = 0;
+
+    for (int i = 0u; i < SPI_MSG_QUEUE_LENGTH; i++) {
+        if (_queue[i].msg.cmd != SPI_NO_CMD) {
+            if (verbose)
+                LOG_DEBUG("Queue item[%d] -> [%s]", i, returnSpiCmdName(_queue[i].msg.cmd));
+            pending_msg++;
+        }
+    }
+
+    if (pending_msg != 0 && verbose)
+        LOG_DEBUG("Queue size is %d", pending_msg);
+
+    if (pending_msg >= SPI_MSG_QUEUE_LENGTH && verbose)
+        LOG_WARN("SPI message-Queue is FULL!");
+
+    return pending_msg;
+}
+
+// queued message of page that can join the batch of cmd
+static int _next_page(t_spi_command cmd,
+                      u32 page) {
+    for (u8 i = 0; i < SPI_MSG_QUEUE_LENGTH; i++) {
+        t_spi_command c = _queue[i].msg.cmd;
+
+        if ((c == SPI_NO_CMD) || _queue[i].taken || (spi_queue_page(&_queue[i].msg) != page))
+            continue;
+        if ((cmd == SPI_IS25_PP) ? (c != SPI_IS25_PP) : (_prio(c) > SPI_PRIO_PREFETCH))
+            continue;
+        if (_eligible(i))
+            return i;
+    }
+    return -1;
+}
+
+bool spi_queue_take(t_spi_batch * batch,
+                    u32 now) {
+    int best = -1;
+
+    batch->count = 0;
+    for (u8 i = 0; i < SPI_MSG_QUEUE_LENGTH; i++) {
+        if ((_queue[i].msg.cmd == SPI_NO_CMD) || _queue[i].taken || !_eligible(i))
+            continue;
+        if ((best < 0) ||
+            (_prio(_queue[i].msg.cmd) < _prio(_queue[best].msg.cmd)) ||
+            ((_prio(_queue[i].msg.cmd) == _prio(_queue[best].msg.cmd)) &&
+             ((int32_t)(_queue[i].seq - _queue[best].seq) < 0)))
+            best = i;
+    }
+    if (best < 0)
+        return false;
+
+    t_spi_command cmd = _queue[best].msg.cmd;
+    u8 max = 1;
+    if (cmd == SPI_IS25_PP)
+        max = SPI_BATCH_PROGRAM_PAGES;
+    else if (_prio(cmd) <= SPI_PRIO_PREFETCH)
+        max = SPI_BATCH_READ_PAGES;
+
+    u32 page = spi_queue_page(&_queue[best].msg);
+    int i = best;
+    do {
+        _queue[i].taken = true;
+        batch->index[batch->count++] = (u8)i;
+        PERF_MAX(SpiQueueMaxWaitUs, (now - _queue[i].queued) / _cycles_per_us);
+        page++;
+    } while ((batch->count < max) && (page < SPI_PAGES_ALL) && ((i = _next_page(cmd, page)) >= 0));
+
+    Main.PerfCounters.SpiMerged += (u32)(batch->count - 1);
+    return true;
+}
+
+const t_spi_msg * spi_queue_entry(u8 index) {
+    return &_queue[index].msg;
+}
+
+void spi_queue_release(u8 index) {
+    _queue[index].msg.cmd = SPI_NO_CMD;
+    _queue[index].taken = false;
+}
+
+void spi_queue_done(void) {
+    for (u8 i = 0; i < SPI_MSG_QUEUE_LENGTH; i++) {
+        if (_queue[i].taken)
+            spi_queue_release(i);
+    }
+}
+
+void spi_queue_retry(void) {
+    for (u8 i = 0; i < SPI_MSG_QUEUE_LENGTH; i++)
+        _queue[i].taken = false;
+}
@@ -0,0 +1,150 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : spi_queue.h
+* Author              : Barco
+* created             : 18/10/2022
+* Description         : SPI flash message queue, split from spi_master.c
+*
+*   Bounded priority queue of SPI_MSG_QUEUE_LENGTH messages, no hardware
+*   access: spi_master.c takes the next batch and executes it.
+*
+*     SPI_PRIO_READ        0x50 READ, the host waits on i2c 0x61
+*     SPI_PRIO_PREFETCH    read ahead of the 0x61 page
+*     SPI_PRIO_BACKGROUND  page programs, erases and the other commands
+*
+*   Within a priority the order of arrival is kept. A message never overtakes
+*   an earlier one it conflicts with: a read waits for an earlier program or
+*   erase of the same page, RDSR/RDID/DP/RDP/VERBOSE overtake nothing and are
+*   not overtaken. A taken message is merged with queued ones of the next
+*   pages into one batch (reads: one transfer, programs: one operation).
+*
+* History:
+* 18/10/2022 : introduced in gpmcu code, priorities and batching
+*******************************************************************************/
+
+#ifndef _SPI_QUEUE_H_
+#define _SPI_QUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data_map.h"
+
+typedef enum {
+    SPI_NO_CMD       = 0x00u,
+    SPI_IS25_PP      = 0x02u,
+    SPI_IS25_RDSR    = 0x05u,
+    SPI_IS25_READ    = 0x03u,
+    SPI_IS25_CER     = 0xC7u,
+    SPI_IS25_RDID    = 0x9fu,
+    SPI_IS25_SE      = 0x20u,
+    SPI_IS25_SE_     = 0xd7u,
+    SPI_IS25_BER32   = 0x52,
+    SPI_IS25_BER64   = 0xd8,
+    SPI_IS25_DP      = 0xB9, // deep powerdown
+    SPI_IS25_RDP     = 0xAB, // release deep sleep
+    // custom commands
+    SPI_IS25_VERBOSE = 0xDE,
+    SPI_IS25_PREFETCH = 0xDF, // read ahead of the 0x61 readback page
+}
+t_spi_command;
+
+typedef struct __attribute__((packed)) {
+    t_spi_command cmd;
+    u8 param[3]; // Address var
+    u8 data[256]; // for Page Program data
+} t_spi_msg;
+
+typedef enum {
+    SPI_PRIO_READ = 0,
+    SPI_PRIO_PREFETCH,
+    SPI_PRIO_BACKGROUND,
+    SPI_PRIO_NUM
+} t_spi_prio;
+
+#ifndef SPI_MSG_QUEUE_LENGTH
+#define SPI_MSG_QUEUE_LENGTH    16 // !< queue depth, override with -DSPI_MSG_QUEUE_LENGTH=n
+#endif
+#define SPI_BUFFER_SIZE         256
+
+#define SPI_BATCH_READ_PAGES    2  // !< one is25xp transfer (SpiReadBuf)
+#define SPI_BATCH_PROGRAM_PAGES 4
+#define SPI_BATCH_MAX           4  // !< max of the above
+
+// queue entries of one operation, in page order
+typedef struct {
+    u8 count;
+    u8 index[SPI_BATCH_MAX];
+} t_spi_batch;
+
+/**
+ * @brief  Empty the queue
+ *
+ * @param cycles_per_us clock of the push/take times, for the latency stats
+ */
+void spi_queue_init(u32 cycles_per_us);
+
+/**
+ * @brief  Queue a message: the command byte, the page (2 bytes), the page
+ *         program data
+ *
+ * @param now core cycles, for the latency stats
+ * @returns false for an unknown command or a full queue (PerfCounters
+ *          SpiQueueOverflow)
+ */
+bool spi_queue_push(const u8 * data,
+                    u16 size,
+                    u32 now);
+
+/**
+ * @brief  Messages queued, taken ones included
+ */
+u8 spi_queue_size(bool verbose);
+
+/**
+ * @brief  Take the next batch, best priority first; its messages stay queued
+ *         until released (spi_queue_done)
+ *
+ * @param now core cycles, PerfCounters SpiQueueMaxWaitUs
+ * @returns false when nothing is queued
+ */
+bool spi_queue_take(t_spi_batch * batch,
+                    u32 now);
+
+/**
+ * @brief  Message of a queue entry (batch index)
+ */
+const t_spi_msg * spi_queue_entry(u8 index);
+
+/**
+ * @brief  Page (param) of a message
+ */
+u16 spi_queue_page(const t_spi_msg * msg);
+
+/**
+ * @brief  Pages [first, end) a message reads or writes, erases aligned
+ * @returns false for a command without address
+ */
+bool spi_queue_pages(const t_spi_msg * msg,
+                     u32 * first,
+                     u32 * end);
+
+/**
+ * @brief  One taken message is done
+ */
+void spi_queue_release(u8 index);
+
+/**
+ * @brief  All taken messages are done
+ */
+void spi_queue_done(void);
+
+/**
+ * @brief  The taken messages could not be started: queue them again, they
+ *         keep their place
+ */
+void spi_queue_retry(void);
+
+const char * returnSpiCmdName(t_spi_command val);
+bool invalid_spi_cmd(t_spi_command cmd);
+
+#endif /* _SPI_QUEUE_H_ */
@@ -0,0 +1,335 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : spi_update.c
+* Author              : Barco
+* created             : 13/10/2022
+* Description         : Gowin bitfile update in application mode, windowed
+*                       transfer into the backup spi partition (spi1)
+* History:
+* 13/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#include <string.h>
+
+#include "spi_update.h"
+
+#include "comm/comm.h"
+#include "comm/protocol.h"
+#include "comm_protocol.h"
+#include "storage_spi_flash.h"
+#include "i2c/i2c_slave_addr.h"
+
+#include "logger.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define SPI_UPDATE_IMAGE_SIZE (SPI_PART_SIZE - MIN_ERASE_SIZE) // !< last 4k: spi context
+
+/*******************************************************************************
+ * external code - crc.c
+ ******************************************************************************/
+extern uint32_t crc32(uint32_t crc,
+                      const uint8_t * buf,
+                      size_t len);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static struct storage_driver_t * _sdriver = NULL;
+static struct spi_flash_area_t _area;          // !< target partition
+static struct spi_flash_area_t _sector;        // !< erase step, context copy
+static t_spi_update_state _state = SPI_UPDATE_IDLE;
+static t_spi_update_error _error = SPI_UPDATE_ERR_NONE;
+static gowin_partition_t _target = GOWIN_PARTITION_NONE; // !< spi1 once started
+static u32 _size = 0;                          // !< bitfile size
+static u32 _offset = 0;                        // !< erase/readback position, context step
+static u16 _next = 0;                          // !< next block expected from the host
+static u16 _written = 0;                       // !< blocks in flash, _next - _written buffered
+static u8 _slots[SPI_UPDATE_WINDOW][SPI_UPDATE_BLOCK_SIZE];
+static bool _crc_received = false;
+static u32 _crc_host = 0;
+static u32 _crc = 0;                           // !< readback, running
+static u32 _crc_bitfile = 0;
+static spi_ctxt_t _ctxt;                       // !< written on COMMP_CMD_SET_SPI1
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+static u32 _get_u32(const u8 * data) {
+    return ((u32)data[0] << 24) | ((u32)data[1] << 16) | ((u32)data[2] << 8) | (u32)data[3];
+}
+
+static u16 _blocks(void) {
+    return (u16)((_size + SPI_UPDATE_BLOCK_SIZE - 1) / SPI_UPDATE_BLOCK_SIZE);
+}
+
+static u8 _free_slots(void) {
+    if ((_state != SPI_UPDATE_ERASING) && (_state != SPI_UPDATE_RECEIVING))
+        return 0;
+    return (u8)(SPI_UPDATE_WINDOW - (_next - _written));
+}
+
+static bool _fail(t_spi_update_error error) {
+    LOG_ERROR("spi update: failed in state %d (error %d)", _state, error);
+    _state = SPI_UPDATE_ERROR;
+    _error = error;
+    return false;
+}
+
+static void _set_area(struct spi_flash_area_t * farea,
+                      const char * name,
+                      u32 start_addr,
+                      u32 size) {
+    strncpy(farea->area_name, name, MAX_AREA_NAME);
+    farea->start_addr = start_addr;
+    farea->size = size;
+    farea->offset = 0;
+}
+
+// erase of one 4k sector through the driver: an area of one sector
+static int _erase_sector(u32 addr) {
+    _set_area(&_sector, _area.area_name, addr, MIN_ERASE_SIZE);
+    STORAGE_SETPRIV(_sdriver, &_sector);
+    i2c_slave_page_invalidate(); // 0x61 readback pages
+    return storage_erase_storage(_sdriver);
+}
+
+static int _write_block(u32 offset,
+                        u8 * data) {
+    _area.offset = offset;
+    STORAGE_SETPRIV(_sdriver, &_area);
+    i2c_slave_page_invalidate();
+    return storage_write_data(_sdriver, data, SPI_UPDATE_BLOCK_SIZE);
+}
+
+static bool _start(u32 size) {
+    if (!_sdriver || (size == 0) || (size > SPI_UPDATE_IMAGE_SIZE) ||
+        (_state == SPI_UPDATE_CTXT_WRITE))
+        return false;
+
+    _target = GOWIN_PARTITION_1; // the FPGA loads spi0, whatever the context says
+    _set_area(&_area, COMMP_ROMNAME_SPIFLASH1, (u32)_target * SPI_PART_SIZE, SPI_PART_SIZE);
+    _size = size;
+    _offset = 0;
+    _next = 0;
+    _written = 0;
+    _crc_received = false;
+    _error = SPI_UPDATE_ERR_NONE;
+    _state = SPI_UPDATE_ERASING;
+    LOG_INFO("spi update: %d bytes into %s", size, _area.area_name);
+    return true;
+}
+
+static bool _data(u16 block,
+                  const u8 * data,
+                  u16 length) {
+    u16 expected;
+
+    if ((_state != SPI_UPDATE_ERASING) && (_state != SPI_UPDATE_RECEIVING))
+        return false;
+    if (block < _next) // resent, the reply got lost
+        return true;
+    if ((block != _next) || (block >= _blocks()) || (_free_slots() == 0))
+        return false;
+
+    expected = (block == _blocks() - 1) ? (u16)(_size - (u32)block * SPI_UPDATE_BLOCK_SIZE) :
+               SPI_UPDATE_BLOCK_SIZE;
+    if (length != expected)
+        return false;
+
+    u8 * slot = _slots[block % SPI_UPDATE_WINDOW];
+    memcpy(slot, data, length);
+    memset(slot + length, 0xFF, SPI_UPDATE_BLOCK_SIZE - length); // erased flash
+    _next++;
+    return true;
+}
+
+static bool _store_ctxt(void) {
+    spi_partition_ctxt_t * gowin = &_ctxt.gowin[_target];
+
+    _ctxt = Main.GowinPartitionInfo;
+    gowin->start_addr = _area.start_addr;
+    gowin->partition_size = SPI_PART_SIZE;
+    gowin->image_size = SPI_UPDATE_IMAGE_SIZE;
+    gowin->crc = _crc;
+    gowin->bitfile_size = _size;
+    gowin->bitfile_crc = _crc_bitfile;
+    _ctxt.part = GOWIN_PARTITION_0; // as _bootloader_spi_store_ctxt
+    _ctxt.crc = crc32(0, (const uint8_t *)_ctxt.gowin, sizeof(_ctxt.gowin));
+    _offset = 0;
+    _state = SPI_UPDATE_CTXT_WRITE;
+    return true;
+}
+
+static bool _command(const u8 * args,
+                     u16 length) {
+    if (length < 2)
+        return false;
+
+    switch ((args[0] << 8) | args[1]) {
+        case COMMP_CMD_CRC:
+            if ((length != 6) || (_next != _blocks()) ||
+                ((_state != SPI_UPDATE_ERASING) && (_state != SPI_UPDATE_RECEIVING)))
+                return false;
+            _crc_host = _get_u32(args + 2);
+            _crc_received = true;
+            return true;
+        case COMMP_CMD_SET_SPI1:
+            if (_state != SPI_UPDATE_VERIFIED)
+                return false;
+            return _store_ctxt();
+        case COMMP_CMD_INFO_SPI:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// [ADR, CMD, ACK/NACK, STATE, PARTITION, NEXT_BLOCK(2byte BE), FREE_SLOTS, ERROR]
+static void _reply(u8 * RxBuf,
+                   bool ack) {
+    RxBuf[PROTOCOL_RX_OFFSET_ADR] = ack ? COMM_REPLY_ACK : COMM_REPLY_NACK;
+    RxBuf[3] = (u8)_state;
+    RxBuf[4] = (u8)_target;
+    RxBuf[5] = (u8)(_next >> 8);
+    RxBuf[6] = (u8)_next;
+    RxBuf[7] = _free_slots();
+    RxBuf[8] = (u8)_error;
+    PROTO_TX_SendMsg(UART1, RxBuf, SPI_UPDATE_REPLY_LENGTH);
+}
+
+void spi_update_init(struct storage_driver_t * sdriver) {
+    _sdriver = sdriver;
+    _state = SPI_UPDATE_IDLE;
+    _error = SPI_UPDATE_ERR_NONE;
+    _target = GOWIN_PARTITION_NONE;
+    _next = 0;
+    _written = 0;
+}
+
+void spi_update_handler(u8 * RxBuf,
+                        u16 MsgLength) {
+    const u8 * args = RxBuf + SPI_UPDATE_OFFSET_ARGS;
+    bool ack = false;
+
+    if (MsgLength <= SPI_UPDATE_OFFSET_OPCODE) {
+        reply_invalid(COMM_NACK_MSG_LENGTH);
+        return;
+    }
+
+    switch (RxBuf[SPI_UPDATE_OFFSET_OPCODE]) {
+        case COMMP_WRQ:
+            if (MsgLength == SPI_UPDATE_OFFSET_ARGS + 4)
+                ack = _start(_get_u32(args));
+            break;
+        case COMMP_DATA:
+            if (MsgLength > SPI_UPDATE_OFFSET_DATA)
+                ack = _data((u16)((args[0] << 8) | args[1]), RxBuf + SPI_UPDATE_OFFSET_DATA,
+                            (u16)(MsgLength - SPI_UPDATE_OFFSET_DATA));
+            break;
+        case COMMP_CMD:
+            ack = _command(args, (u16)(MsgLength - SPI_UPDATE_OFFSET_ARGS));
+            break;
+        case COMMP_ERR: // abort, the context is not written yet
+            if (_state != SPI_UPDATE_CTXT_WRITE) {
+                LOG_WARN("spi update: aborted in state %d", _state);
+                _state = SPI_UPDATE_IDLE;
+                ack = true;
+            }
+            break;
+        default:
+            break;
+    }
+    if (!ack)
+        LOG_DEBUG("spi update: opcode %d refused in state %d", RxBuf[SPI_UPDATE_OFFSET_OPCODE],
+                  _state);
+    _reply(RxBuf, ack);
+}
+
+bool spi_update_process(void) {
+    switch (_state) {
+        case SPI_UPDATE_ERASING: // image area, sector by sector
+            if (_erase_sector(_area.start_addr + _offset) < 0)
+                return _fail(SPI_UPDATE_ERR_ERASE);
+            _offset += MIN_ERASE_SIZE;
+            if (_offset >= SPI_UPDATE_IMAGE_SIZE)
+                _state = SPI_UPDATE_RECEIVING;
+            return true;
+
+        case SPI_UPDATE_RECEIVING:
+            if (_written < _next) {
+                if (_write_block((u32)_written * SPI_UPDATE_BLOCK_SIZE,
+                                 _slots[_written % SPI_UPDATE_WINDOW]) < 0)
+                    return _fail(SPI_UPDATE_ERR_WRITE);
+                _written++;
+                return true;
+            }
+            if (!_crc_received || (_written != _blocks()))
+                return false; // waiting for the host
+            LOG_INFO("spi update: %d blocks written, verifying", _written);
+            _offset = 0;
+            _crc = 0;
+            _state = SPI_UPDATE_VERIFYING;
+            return true;
+
+        case SPI_UPDATE_VERIFYING: { // bitfile crc, continued over the image (partition crc)
+            u8 buffer[SPI_UPDATE_BLOCK_SIZE];
+            u32 end = (_offset < _size) ? _size : SPI_UPDATE_IMAGE_SIZE;
+            u32 length = ((end - _offset) > sizeof(buffer)) ? sizeof(buffer) : (end - _offset);
+
+            _area.offset = _offset;
+            STORAGE_SETPRIV(_sdriver, &_area);
+            if (storage_read_data(_sdriver, buffer, length) < 0)
+                return _fail(SPI_UPDATE_ERR_READ);
+            _crc = crc32(_crc, buffer, length);
+            _offset += length;
+            if (_offset == _size)
+                _crc_bitfile = _crc;
+            if (_offset < SPI_UPDATE_IMAGE_SIZE)
+                return true;
+            if (_crc_bitfile != _crc_host) {
+                LOG_ERROR("spi update: crc 0x%X <> 0x%X received", _crc_bitfile, _crc_host);
+                return _fail(SPI_UPDATE_ERR_CRC);
+            }
+            LOG_OK("spi update: %s verified, crc 0x%X", _area.area_name, _crc_bitfile);
+            _state = SPI_UPDATE_VERIFIED;
+            return false;
+        }
+
+        case SPI_UPDATE_CTXT_WRITE: { // per copy, spi1 first: erase, write
+            gowin_partition_t part = (_offset < 2) ? _target :
+                                     ((_target == GOWIN_PARTITION_0) ? GOWIN_PARTITION_1 :
+                                      GOWIN_PARTITION_0);
+            u32 start = (u32)part * SPI_PART_SIZE;
+
+            if ((_offset & 1) == 0) {
+                if (_erase_sector(start + SPI_PART_SIZE - MIN_ERASE_SIZE) < 0)
+                    return _fail(SPI_UPDATE_ERR_CTXT);
+            } else {
+                u8 buffer[FLASH_SECTOR_SIZE];
+
+                memset(buffer, 0, sizeof(buffer));
+                memcpy(buffer, &_ctxt, sizeof(_ctxt));
+                _set_area(&_sector, _area.area_name, start, SPI_PART_SIZE);
+                _sector.offset = SPI_PART_SIZE - FLASH_SECTOR_SIZE;
+                STORAGE_SETPRIV(_sdriver, &_sector);
+                i2c_slave_page_invalidate();
+                if (storage_write_data(_sdriver, buffer, sizeof(buffer)) < 0)
+                    return _fail(SPI_UPDATE_ERR_CTXT);
+            }
+            if (++_offset < 4)
+                return true;
+            Main.GowinPartitionInfo = _ctxt;
+            LOG_OK("spi update: spi%d recorded in the spi context", _target);
+            _state = SPI_UPDATE_DONE;
+            return false;
+        }
+
+        default:
+            return false;
+    }
+}
+
+t_spi_update_state spi_update_state(void) {
+    return _state;
+}
@@ -0,0 +1,105 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : spi_update.h
+* Author              : Barco
+* created             : 13/10/2022
+* Description         : Gowin bitfile update in application mode
+*
+*   The MainCPU streams a bitfile into the backup spi partition (spi1) without
+*   a reboot to the bootloader. The FPGA always loads spi0, the partition in
+*   use is never written: bringing the new bitfile into spi0 is left to the
+*   bootloader. The sequence follows the bootloader COMMP transfer, carried by
+*   the MainCPU protocol in array writes with identifier CMD_ID_SPIUPDATE:
+*
+*     COMMP_WRQ       [SIZE(4byte BE)]           start, the image area is erased
+*     COMMP_DATA      [BLOCK(2byte BE), DATA]    SPI_UPDATE_BLOCK_SIZE bytes, last one shorter
+*     COMMP_CMD       [COMMP_CMD_CRC(2byte BE), CRC(4byte BE)]  all blocks sent, verify
+*     COMMP_CMD       [COMMP_CMD_SET_SPI1(2byte BE)]    verified: record spi1 in the context
+*     COMMP_CMD       [COMMP_CMD_INFO_SPI(2byte BE)]    status only
+*     COMMP_ERR                                  abort
+*
+*   request : [ADR, CMD_WRITE_ARRAY, CMD_ID_SPIUPDATE, OPCODE, ARGS]
+*   reply   : [ADR, CMD_WRITE_ARRAY, ACK/NACK, STATE, PARTITION, NEXT_BLOCK(2byte BE),
+*              FREE_SLOTS, ERROR]
+*
+*   Blocks are windowed: a block is acknowledged once it is buffered, the host
+*   keeps up to FREE_SLOTS blocks going without waiting for the flash. A NACK
+*   on a block means out of sequence or no free slot: resend from NEXT_BLOCK.
+*   Blocks below NEXT_BLOCK are acknowledged again (lost reply). The erase,
+*   the page writes and the CRC readback run in the background, one step per
+*   run of the task, the register traffic continues meanwhile. The host polls
+*   with COMMP_CMD_INFO_SPI until the state is SPI_UPDATE_VERIFIED.
+*
+*   SET_SPI1 writes the spi context (one sector, the copy in each partition)
+*   with the spi1 bitfile size/crc, also in the background: poll until
+*   SPI_UPDATE_DONE. The copies are erased and written one after the other,
+*   spi1's first, so a power cut leaves at most one of them invalid (the
+*   bootloader checks both). part stays 0, as _bootloader_spi_store_ctxt
+*   writes it.
+*
+* History:
+* 13/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#ifndef _SPI_UPDATE_H_
+#define _SPI_UPDATE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "data_map.h"
+#include "storage.h"
+
+#define SPI_UPDATE_BLOCK_SIZE    512 // !< data block, 2 flash pages (FLASH_SECTOR_SIZE)
+#define SPI_UPDATE_WINDOW        4   // !< blocks buffered ahead of the flash writes
+#define SPI_UPDATE_REPLY_LENGTH  9   // !< ADR, CMD, ACK and the status
+
+// request offsets in the received message
+#define SPI_UPDATE_OFFSET_OPCODE 3
+#define SPI_UPDATE_OFFSET_ARGS   4
+#define SPI_UPDATE_OFFSET_DATA   6   // !< COMMP_DATA, after the block number
+
+typedef enum {
+    SPI_UPDATE_IDLE = 0,
+    SPI_UPDATE_ERASING,      // !< image area of spi1
+    SPI_UPDATE_RECEIVING,    // !< blocks are buffered and written
+    SPI_UPDATE_VERIFYING,    // !< CRC readback of the written image
+    SPI_UPDATE_VERIFIED,     // !< waiting for COMMP_CMD_SET_SPI1
+    SPI_UPDATE_CTXT_WRITE,   // !< spi context write, both copies
+    SPI_UPDATE_DONE,         // !< spi1 recorded in the context
+    SPI_UPDATE_ERROR,
+} t_spi_update_state;
+
+typedef enum {
+    SPI_UPDATE_ERR_NONE = 0,
+    SPI_UPDATE_ERR_ERASE,
+    SPI_UPDATE_ERR_WRITE,
+    SPI_UPDATE_ERR_READ,
+    SPI_UPDATE_ERR_CRC,      // !< readback does not match the host CRC
+    SPI_UPDATE_ERR_CTXT,     // !< spi context write
+} t_spi_update_error;
+
+/**
+ * @brief  Set the storage driver of the spi flash, NULL: updates are refused
+ */
+void spi_update_init(struct storage_driver_t * sdriver);
+
+/**
+ * @brief  Handle a CMD_ID_SPIUPDATE request, always replies
+ *
+ * @param RxBuf received message, reused for the reply
+ * @param MsgLength length of the message (ADR included)
+ */
+void spi_update_handler(u8 * RxBuf,
+                        u16 MsgLength);
+
+/**
+ * @brief  Background step: erase a sector, write a block, read back a block or
+ *         write a context copy
+ *
+ * @returns true while work remains
+ */
+bool spi_update_process(void);
+
+t_spi_update_state spi_update_state(void);
+
+#endif /* _SPI_UPDATE_H_ */
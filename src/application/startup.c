@@ -73,6 +73,7 @@ void ResetISR(void) {
     *vtor = oldvtor;      // Restore vtable before jumping too bootloader
 
     LOG_INFO("*** Vector table restored, back to bootcode ");
+    logger_close();       // !< Transmit pending (async uart) log lines
 
     NVIC_SystemReset();   // !< Run NVIC Reset!
 }
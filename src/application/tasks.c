@@ -0,0 +1,162 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : tasks.c
+* Author              : Barco
+* created             : 09/10/2022
+* Description         : Application task set, the former superloop body split
+*                       in run-to-completion tasks. A task returns true while
+*                       it has work left (rx bytes, queue), timeouts are
+*                       timers that post the task's event.
+* History:
+* 09/10/2022 : introduced in gpmcu code
+* 18/10/2022 : spi task on SCHED_EV_TICK, idle release of the spi mux
+*******************************************************************************/
+
+#include "tasks.h"
+#include "timer_wheel.h"
+
+#include "comm/protocol.h"
+#include "comm/gowin_protocol.h"
+#include "comm/comm.h"
+#include "i2c/i2c_slave.h"
+#include "i2c/i2c_stream.h"
+#include "spi/spi_master.h"
+#include "spi/spi_update.h"
+
+#include "logger.h"
+
+#ifndef UNIT_TEST
+#include "board.h"
+#include "pin_mux.h"
+#include "../bootloader/bootloader_usb_helpers.h"
+#endif
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+extern volatile t_uart_data_raw UART_DATA[NUMBER_OF_PROTOCOL_UARTS]; // main.c
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+static inline bool _rx_pending(t_uart_channel uart_channel) {
+    return UART_DATA[uart_channel].RxBufWr != UART_DATA[uart_channel].RxBufRd;
+}
+
+// !< Timers, first: expiries post the events of the tasks below
+static bool _task_timer(void) {
+    timer_process();
+    return false;
+}
+
+// !< MainCPU
+static bool _task_maincpu(void) {
+    COMM_Protocol(UART1); // process incoming data Main CPU
+    if (COMM_DATA[UART1].MsgCount) {
+        sched_post(SCHED_EV_MAINCPU_MSG);
+        return false; // parsing continues after the message is released
+    }
+    return _rx_pending(UART1);
+}
+
+static bool _task_maincpu_handler(void) {
+    if (COMM_DATA[UART1].MsgCount) { // handle received messages...
+        comm_handler();
+        COMM_DATA[UART1].MsgCount = 0; // release RX message buffer
+        sched_post(SCHED_EV_MAINCPU_RX | SCHED_EV_REQUEST);
+    }
+    return false;
+}
+
+#ifdef BOARD_GAIA
+// !< 2nd CPU
+static bool _task_cpu2(void) {
+    COMM_Protocol(UART3); // process incoming data 2nd CPU
+    if (COMM_DATA[UART3].MsgCount) { // handle received messages...
+        comm_handler();
+        COMM_DATA[UART3].MsgCount = 0; // release RX message buffer
+        sched_post(SCHED_EV_REQUEST);
+    }
+    return _rx_pending(UART3);
+}
+#endif
+
+// !< GOWIN FPGA
+static bool _task_gowin(void) {
+    if (GOWIN_Protocol(UART2) == GOWIN_RETURN_TIMEOUT) {
+        LOG_WARN("No Reply from Gowin");
+#ifndef UNIT_TEST
+        LOG_INFO("Gowin Ready State is [%s]", (BOARD_Ready_Gowin() == 1 ? "OK" : "NOK"));
+#endif
+        GOWIN_Queue_Init();
+    }
+    if (GOWIN_DATA.MsgCount)
+        sched_post(SCHED_EV_GOWIN_MSG);
+
+    // !< an awaited reply is not busy: rx bytes or the reply timer wake us
+    return _rx_pending(UART2) || GOWIN_Busy();
+}
+
+static bool _task_gowin_handler(void) {
+    if (GOWIN_DATA.MsgCount) { // handle received messages...
+        comm_handler_gowin();
+        GOWIN_DATA.MsgCount = 0; // release RX message buffer
+        if ((GOWIN_Queue_size() == 0) && (GOWIN_DATA.verifyReadBack == true)) {
+            // Gowin tx finished, let's verify the readback
+            GOWIN_Compare_EdidDpcd(Main.Edid.Edid1, Main.Edid.Edid3, "Edid1==Edid3");
+            GOWIN_Compare_EdidDpcd(Main.Dpcd.Dpcd1, Main.Dpcd.Dpcd3, "Dpcd1==Dpcd3");
+            GOWIN_DATA.verifyReadBack = false;
+            LOG_INFO("Appli%c up and running", (Main.PartitionInfo.part == 1 ? '1' : '0'));
+        }
+        sched_post(SCHED_EV_GOWIN_RX);
+    }
+    return false;
+}
+
+// !< I2C
+static bool _task_i2c(void) {
+    i2c_update();
+    return false;
+}
+
+// !< Streamed spi flash programming over i2c, one flash step per run
+static bool _task_i2c_stream(void) {
+    return i2c_stream_process();
+}
+
+// !< SPI, the tick gives the idle spi mux back to the Gowin
+static bool _task_spi(void) {
+    return spi_master_update();
+}
+
+// !< Gowin bitfile update, one flash step per run
+static bool _task_spi_update(void) {
+    return spi_update_process();
+}
+
+// !< GPIO request
+static bool _task_gpio(void) {
+    _handle_gpio_request();
+#ifdef BOARD_GAIA
+    _detect_cable_change_gaia();
+#endif
+    return false;
+}
+
+// in priority order, timers first, then the former superloop order
+const SchedTask_t APP_TASKS[] = {
+    { "timer",         SCHED_EV_TIMER,                         LOOP_TASK_TIMER,         _task_timer           },
+    { "maincpu",       SCHED_EV_MAINCPU_RX,                    LOOP_TASK_COMM,          _task_maincpu         },
+    { "maincpu_hdl",   SCHED_EV_MAINCPU_MSG,                   LOOP_TASK_COMM_HANDLER,  _task_maincpu_handler },
+#ifdef BOARD_GAIA
+    { "cpu2",          SCHED_EV_CPU2_RX,                       LOOP_TASK_CPU2,          _task_cpu2            },
+#endif
+    { "gowin",         SCHED_EV_GOWIN_RX | SCHED_EV_REQUEST,   LOOP_TASK_GOWIN,         _task_gowin           },
+    { "gowin_hdl",     SCHED_EV_GOWIN_MSG,                     LOOP_TASK_GOWIN_HANDLER, _task_gowin_handler   },
+    { "i2c",           SCHED_EV_I2C,                           LOOP_TASK_I2C,           _task_i2c             },
+    { "spi",           SCHED_EV_REQUEST | SCHED_EV_TICK,       LOOP_TASK_SPI,           _task_spi             },
+    { "spi_update",    SCHED_EV_REQUEST,                       LOOP_TASK_SPI_UPDATE,    _task_spi_update      },
+    { "i2c_stream",    SCHED_EV_REQUEST,                       LOOP_TASK_I2C_STREAM,    _task_i2c_stream      },
+    { "gpio",          SCHED_EV_REQUEST | SCHED_EV_TICK,       LOOP_TASK_GPIO,          _task_gpio            },
+};
+
+const u8 APP_TASKS_NUM = sizeof(APP_TASKS) / sizeof(APP_TASKS[0]);
@@ -0,0 +1,23 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : tasks.h
+* Author              : Barco
+* created             : 09/10/2022
+* Description         : Application task set for the scheduler
+* History:
+* 09/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#ifndef _TASKS_H_
+#define _TASKS_H_
+
+#include "scheduler.h"
+
+extern const SchedTask_t APP_TASKS[];
+extern const u8 APP_TASKS_NUM;
+
+/**
+ * @brief  Data-map GPIO requests, board access -> implemented in main.c
+ */
+void _handle_gpio_request(void);
+
+#endif /* _TASKS_H_ */
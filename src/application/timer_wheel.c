@@ -0,0 +1,220 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : timer_wheel.c
+* Author              : Barco
+* created             : 10/10/2022
+* Description         : Hierarchical timer wheel, 1ms SysTick time base
+* History:
+* 10/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#include "timer_wheel.h"
+#include "scheduler.h"
+
+#ifndef UNIT_TEST
+#include "fsl_device_registers.h"
+#endif
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static volatile u32 _ticks = 0;                    // !< ms, incremented by the SysTick
+static u32 _wheel_now = 1;                         // !< next ms the wheel processes
+static Timer_t * _wheel[TIMER_LEVELS][TIMER_SLOTS];
+
+/*******************************************************************************
+ * Port
+ ******************************************************************************/
+#ifndef UNIT_TEST
+void SysTick_Handler(void) {
+    u32 now = _ticks + 1;
+
+    _ticks = now;
+    // only wake the timer task for a due slot or a cascade, not every ms
+    if (((now & TIMER_SLOT_MASK) == 0) || (_wheel[0][now & TIMER_SLOT_MASK] != NULL))
+        sched_post(SCHED_EV_TIMER);
+}
+
+static void _port_init(u32 core_clk_hz) {
+    SysTick_Config(core_clk_hz / TIMER_TICK_HZ);
+}
+
+static void _port_deinit(void) {
+    SysTick->CTRL = 0;
+}
+#else
+static void _port_init(u32 core_clk_hz) {
+    (void)core_clk_hz;
+}
+
+static void _port_deinit(void) {
+}
+
+void timer_fake_advance(u32 ms) {
+    _ticks += ms;
+    timer_process();
+}
+#endif
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+static void _unlink(Timer_t * timer) {
+    if (timer->pprev) {
+        *timer->pprev = timer->next;
+        if (timer->next)
+            timer->next->pprev = timer->pprev;
+        timer->next = NULL;
+        timer->pprev = NULL;
+    }
+}
+
+/**
+ * @brief  Link in the slot of the lowest level that covers the delay
+ *
+ * @returns the ms the timer is due in the wheel (late: the next processed ms)
+ */
+static u32 _link(Timer_t * timer) {
+    int32_t delta = (int32_t)(timer->expires - _wheel_now);
+    u32 at = timer->expires;
+    u8 level = 0;
+    Timer_t ** slot;
+
+    if (delta < 0) {
+        delta = 0;
+        at = _wheel_now;
+    } else if ((u32)delta > TIMER_MAX_DELAY) { // re-cascaded from the top level
+        delta = TIMER_MAX_DELAY;
+        at = _wheel_now + TIMER_MAX_DELAY;
+    }
+    while ((level < TIMER_LEVELS - 1) && ((u32)delta >= (1UL << (TIMER_SLOT_BITS * (level + 1)))))
+        level++;
+
+    slot = &_wheel[level][(at >> (TIMER_SLOT_BITS * level)) & TIMER_SLOT_MASK];
+    timer->next = *slot;
+    if (timer->next)
+        timer->next->pprev = &timer->next;
+    timer->pprev = slot;
+    *slot = timer;
+    timer->state = TIMER_PENDING;
+
+    return at;
+}
+
+static void _start(Timer_t * timer,
+                   u32 deadline,
+                   u32 period) {
+    _unlink(timer);
+    timer->expires = deadline;
+    timer->period = period;
+    if ((int32_t)(_link(timer) - _ticks) <= 0)
+        sched_post(SCHED_EV_TIMER); // tick already passed, the SysTick won't post it
+}
+
+static void _cascade(Timer_t ** slot) {
+    Timer_t * timer = *slot;
+
+    *slot = NULL;
+    while (timer) {
+        Timer_t * next = timer->next;
+
+        timer->next = NULL;
+        timer->pprev = NULL;
+        _link(timer);
+        timer = next;
+    }
+}
+
+static void _fire(Timer_t * timer) {
+    if (timer->period) {
+        timer->expires += timer->period;
+        _link(timer);
+    } else {
+        timer->state = TIMER_EXPIRED;
+    }
+    if (timer->events)
+        sched_post(timer->events);
+    if (timer->callback)
+        timer->callback(timer, timer->arg);
+}
+
+void timer_wheel_init(u32 core_clk_hz) {
+    for (u8 level = 0; level < TIMER_LEVELS; level++) {
+        for (u8 i = 0; i < TIMER_SLOTS; i++) {
+            Timer_t * timer = _wheel[level][i];
+
+            while (timer) {
+                Timer_t * next = timer->next;
+
+                timer->next = NULL;
+                timer->pprev = NULL;
+                timer->state = TIMER_IDLE;
+                timer = next;
+            }
+            _wheel[level][i] = NULL;
+        }
+    }
+    _ticks = 0;
+    _wheel_now = 1;
+    _port_init(core_clk_hz);
+}
+
+void timer_wheel_deinit(void) {
+    _port_deinit();
+}
+
+u32 timer_now(void) {
+    return _ticks;
+}
+
+void timer_start_at(Timer_t * timer,
+                    u32 deadline) {
+    _start(timer, deadline, 0);
+}
+
+void timer_start(Timer_t * timer,
+                 u32 delay_ms) {
+    _start(timer, timer_now() + delay_ms, 0);
+}
+
+void timer_start_periodic(Timer_t * timer,
+                          u32 period_ms) {
+    if (period_ms == 0)
+        period_ms = 1;
+    _start(timer, timer_now() + period_ms, period_ms);
+}
+
+void timer_cancel(Timer_t * timer) {
+    _unlink(timer);
+    timer->state = TIMER_IDLE;
+}
+
+void timer_process(void) {
+    u32 now = timer_now();
+
+    while ((int32_t)(now - _wheel_now) >= 0) {
+        Timer_t * expired;
+
+        // cascade the levels that wrapped, low to high
+        for (u8 level = 1; level < TIMER_LEVELS; level++) {
+            u8 shift = TIMER_SLOT_BITS * level;
+
+            if (_wheel_now & ((1UL << shift) - 1UL))
+                break;
+            _cascade(&_wheel[level][(_wheel_now >> shift) & TIMER_SLOT_MASK]);
+        }
+
+        // detach the due slot: timers (re)started by the callbacks go to the next ms
+        expired = _wheel[0][_wheel_now & TIMER_SLOT_MASK];
+        _wheel[0][_wheel_now & TIMER_SLOT_MASK] = NULL;
+        if (expired)
+            expired->pprev = &expired;
+        _wheel_now++;
+
+        while (expired) { // a callback may cancel the others
+            Timer_t * timer = expired;
+
+            _unlink(timer);
+            _fire(timer);
+        }
+    }
+}
@@ -0,0 +1,136 @@
+/*********************** (C) COPYRIGHT BARCO 2022 ******************************
+* File Name           : timer_wheel.h
+* Author              : Barco
+* created             : 10/10/2022
+* Description         : Hierarchical timer wheel, 1ms SysTick time base
+*
+*   TIMER_LEVELS levels of TIMER_SLOTS slots, level n has a resolution of
+*   TIMER_SLOTS^n ms. Start and cancel are O(1) (doubly linked slot lists),
+*   far timers cascade one level down when the lower level wraps. Deadlines
+*   are absolute ms (timer_now() + delay), a late start fires at the next tick.
+*
+*   Expired timers post their events and/or call their callback from the
+*   timer task (SCHED_EV_TIMER), never from interrupt context. Timers are
+*   started and cancelled from task context only.
+*
+*   static Timer_t Reply = TIMER_EVENT_INIT(SCHED_EV_GOWIN_RX);
+*   timer_start(&Reply, GOWIN_REPLY_TIMEOUT_MS);
+*   ...
+*   if (timer_expired(&Reply)) ...
+*
+*   Native (UNIT_TEST): no SysTick, the clock only moves by timer_fake_advance().
+*
+* History:
+* 10/10/2022 : introduced in gpmcu code
+*******************************************************************************/
+
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "data_map.h"
+
+#define TIMER_TICK_HZ   1000U // !< 1ms resolution
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS     (1U << TIMER_SLOT_BITS)
+#define TIMER_SLOT_MASK (TIMER_SLOTS - 1U)
+#define TIMER_LEVELS    4
+#define TIMER_MAX_DELAY ((1UL << (TIMER_SLOT_BITS * TIMER_LEVELS)) - 1UL) // !< ~4.6h, longer delays are re-cascaded
+
+typedef enum {
+    TIMER_IDLE = 0, // !< never started or cancelled
+    TIMER_PENDING,  // !< linked in the wheel
+    TIMER_EXPIRED,  // !< fired, until restarted or cancelled
+} TimerState_t;
+
+typedef struct Timer_s Timer_t;
+typedef void (*TimerCallback_t)(Timer_t * timer, void * arg);
+
+struct Timer_s {
+    Timer_t * next;
+    Timer_t ** pprev;         // !< link pointing to this timer, NULL when not linked
+    u32 expires;              // !< absolute deadline [ms]
+    u32 period;               // !< 0: one shot
+    TimerCallback_t callback; // !< optional, called when expired
+    void * arg;
+    u32 events;               // !< optional, posted when expired
+    TimerState_t state;
+};
+
+#define TIMER_CALLBACK_INIT(cb, cb_arg) { NULL, NULL, 0, 0, (cb), (cb_arg), 0, TIMER_IDLE }
+#define TIMER_EVENT_INIT(ev)            { NULL, NULL, 0, 0, NULL, NULL, (ev), TIMER_IDLE }
+
+/**
+ * @brief  Clear the wheel and start the 1ms SysTick
+ *
+ * Timers still linked are set idle.
+ *
+ * @param core_clk_hz SysTick input clock
+ */
+void timer_wheel_init(u32 core_clk_hz);
+
+/**
+ * @brief  Stop the SysTick, called before leaving the application
+ */
+void timer_wheel_deinit(void);
+
+/**
+ * @brief  Current time [ms] since timer_wheel_init, wraps after ~49 days
+ */
+u32 timer_now(void);
+
+/**
+ * @brief  (Re)start a one shot timer on an absolute deadline
+ *
+ * @param deadline timer_now() based [ms]
+ */
+void timer_start_at(Timer_t * timer,
+                    u32 deadline);
+
+/**
+ * @brief  (Re)start a one shot timer
+ *
+ * @param delay_ms from now
+ */
+void timer_start(Timer_t * timer,
+                 u32 delay_ms);
+
+/**
+ * @brief  (Re)start a periodic timer, first expiry one period from now
+ *
+ * @param period_ms min 1
+ */
+void timer_start_periodic(Timer_t * timer,
+                          u32 period_ms);
+
+/**
+ * @brief  Stop a timer, no-op when it is not pending, state becomes idle
+ */
+void timer_cancel(Timer_t * timer);
+
+static inline bool timer_pending(const Timer_t * timer) {
+    return timer->state == TIMER_PENDING;
+}
+
+static inline bool timer_expired(const Timer_t * timer) {
+    return timer->state == TIMER_EXPIRED;
+}
+
+/**
+ * @brief  Advance the wheel to timer_now() and fire the expired timers
+ *
+ * Runs as the timer task on SCHED_EV_TIMER.
+ */
+void timer_process(void);
+
+#ifdef UNIT_TEST
+/**
+ * @brief  Native fake clock: advance the time and process the wheel
+ */
+void timer_fake_advance(u32 ms);
+#endif
+
+#endif /* _TIMER_WHEEL_H_ */
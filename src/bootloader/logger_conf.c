@@ -16,12 +16,17 @@ extern struct logger_driver_t stdio_logger;
 
 extern struct logger_driver_t uart_logger;
 extern struct logger_driver_t btl_mem_logger;
+extern struct logger_driver_t btl_tok_logger;
 
 struct logger_driver_t * adrivers[] = {
 #if defined(CFG_LOGGER_SIMPLE_LOGGER) && !defined(CFG_LOGGER_ADV_LOGGER)
     &stdio_logger,
 #endif /* CFG_LOGGER_SIMPLE_LOGGER && !CFG_LOGGER_ADV_LOGGER */
     &uart_logger,
+#if defined(CFG_LOGGER_TOKENIZED)
+    &btl_tok_logger,
+#else
     &btl_mem_logger,
+#endif /* CFG_LOGGER_TOKENIZED */
     NULL,
 };
@@ -5,6 +5,8 @@
  *         David Thio <david.thio@barco.com>
  * @version v0.0.1 - bram v - initial
  *          v0.1.0 - davth - memory remap + spi flash
+ *          v0.1.1 - barco - spi flash mux leases (spi_mux.c)
+ *          v0.1.2 - barco - spi flash page cache (spi_cache.c)
  * @date 2020-08-13
  */
 
@@ -21,11 +23,14 @@
 #include "storage.h"
 #include "storage_flash.h"
 #include "storage_spi_flash.h"
+#include "spi_mux.h"
+#include "spi_cache.h"
 #include "bootloader_helpers.h"
 #include "bootloader_spi_helpers.h"
 #include "bootloader_usb_helpers.h"
 
 #include "logger.h"
+#include "tracer.h"
 #include "version.h" // git version
 #include "../application/softversions.h" // hardcoded version
 
@@ -76,6 +81,9 @@ static int _initialize_board(void) {
     BOARD_PwrOn_MainCPU(500000);
 
     logger_init();
+#if defined(CFG_TRACER)
+    tracer_init(SSRAM_TRACE_START, SSRAM_TRACE_SIZE, SystemCoreClock); // !< Application restarts it
+#endif /* CFG_TRACER */
 
     LOG_OK("%s Board initialized", BOARD_NAME);
 
@@ -279,6 +287,10 @@ int main(void) {
         return -1;
     }
 
+    // !< the Gowin may still load its bitfile, the first lease waits for READY
+    spi_mux_init(NULL, SystemCoreClock / 1000000U);
+    spi_cache_init(NULL);
+
     err = storage_init_storage(spi_flash_driver);
     if (err < 0) {
         LOG_ERROR("spi_flash_driver is bad...");
@@ -423,6 +435,8 @@ int main(void) {
             /* for comm_protocol_run() there is a wdog refresh in commp_uart.c */
             int retval = comm_protocol_run(&_bctxt, cdriver, sdriver, spi_flash_driver,
                                            &_spi0_ctxt);
+            // !< the spi writes of a transfer share one mux selection, idle now
+            spi_mux_reset();
 
             LOG_INFO("comm_protocol_run returned (%d)", retval);
             switch (retval) {
@@ -465,6 +479,7 @@ int main(void) {
                 case COMMP_CMD_RECONFIG_GOWIN:
                     LOG_DEBUG("Reconfigure Gowin -> MainCPU will RESET!");
                     SDK_DelayAtLeastUs(1000000, 96000000U);
+                    spi_mux_fpga_request(); // the Gowin reads its bitfile
                     BOARD_Reconfigure_Gowin(200000);
                     SDK_DelayAtLeastUs(1000000, 96000000U);
                     LOG_INFO("Gowin Ready State is [%s]", (BOARD_Ready_Gowin() == 1 ? "OK" :
@@ -474,8 +489,15 @@ int main(void) {
                 case COMMP_CMD_END:                    // communication finished
                     trigger_reboot = true;
                     break;
-                case COMMP_CMD_SPI_END:                // Spi Flashing finished
+                case COMMP_CMD_SPI_END: {              // Spi Flashing finished
+                    const struct spi_mux_stats_t * mux = spi_mux_stats();
+                    LOG_INFO("spi mux: %d switches, %d leases, max hold %dus, %d timeouts",
+                             mux->switches, mux->leases, mux->hold_max_us, mux->timeouts);
+                    const struct spi_cache_stats_t * cache = spi_cache_stats();
+                    LOG_INFO("spi cache: %d hits, %d misses, %d invalidated",
+                             cache->hits, cache->misses, cache->invalidated);
                     break;
+                }
                 case COMMP_CMD_RESET:
                     LOG_OK("Reset Requested");
                     SDK_DelayAtLeastUs(3000000, 96000000U);
@@ -615,6 +637,7 @@ int main(void) {
         uint32_t pc = app_code[1];
 
         LOG_INFO("Jmp to application[%d] PC(%X) SP(%X)", _bctxt.part, pc, sp);
+        spi_mux_reset();
         BOARD_BootDeinitPeripherals();
         SDK_DelayAtLeastUs(1000000, 96000000U); // delay needed!
         jump_to(pc, sp);
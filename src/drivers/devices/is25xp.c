@@ -11,6 +11,7 @@
 #include "is25xp.h"
 
 #include "logger.h"
+#include "tracer.h"
 
 #include "fsl_spi.h"
 
@@ -23,6 +24,22 @@ static uint8_t destBuff[BUFFER_SIZE];
 
 static struct is25xp_dev_s priv;
 
+// non-blocking operations, srcBuff/destBuff are owned by the transfer in flight
+static spi_master_handle_t asyncHandle;
+static volatile bool asyncBusy = false;
+static bool asyncReady = false;
+static void (*asyncDone)(void) = NULL;
+
+/*******************************************************************************
+ * Name: is25xp_sync
+ * Wait for the interrupt transfer in flight, before a blocking access
+ ******************************************************************************/
+
+static void is25xp_sync() {
+    while (asyncBusy)
+        ;
+}
+
 /*******************************************************************************
  * Name: is25xp_readid
  ******************************************************************************/
@@ -36,6 +53,8 @@ int is25xp_readid(uint8_t * productIdentification,
     spi_transfer_t xfer;
     uint8_t productIdIndex = 0;
 
+    is25xp_sync();
+
     /* Send the "Read ID (RDID)" command and read the first three ID bytes */
     xfer.txData = srcBuff;
     xfer.rxData = destBuff;
@@ -113,6 +132,7 @@ uint8_t is25xp_read_status_register(uint8_t verbose) {
     static uint8_t status;
     spi_transfer_t xfer;
 
+    is25xp_sync();
 
     xfer.txData = srcBuff;
     xfer.rxData = destBuff;
@@ -138,6 +158,7 @@ uint8_t is25xp_read_status_register(uint8_t verbose) {
  ******************************************************************************/
 
 void is25xp_waitwritecomplete() {
+    TRACE_SCOPE("is25xp_waitwritecomplete");
     uint8_t status;
     uint32_t delay = 0;
 
@@ -167,6 +188,7 @@ void is25xp_waitwritecomplete() {
  ******************************************************************************/
 
 void is25xp_writeenable() {
+    is25xp_sync();
 
     /* Send "Write Enable (WREN)" command */
     SPI_WriteData(SPI8, (uint16_t)(IS25_WREN), kSPI_FrameAssert);
@@ -366,6 +388,7 @@ static inline void is25xp_bytewrite(const uint8_t * buffer,
 
 int is25xp_erase(off_t startblock,
                  size_t nblocks) {
+    TRACE_SCOPE("is25xp_erase");
     size_t blocksleft = nblocks;
 
     LOG_DEBUG("startblock: %08lx nblocks: %d\n", (long)startblock, (int)nblocks);
@@ -462,6 +485,7 @@ ssize_t is25xp_bwrite(off_t startblock,
                       size_t nblocks,
                       uint8_t * buffer,
                       uint8_t verbose) {
+    TRACE_SCOPE("is25xp_bwrite");
     size_t blocksleft = nblocks;
     size_t pagesize = (size_t)(1 << priv.pageshift);
 
@@ -479,21 +503,43 @@ ssize_t is25xp_bwrite(off_t startblock,
     return (ssize_t)nblocks;
 }
 
-// void masterCallback(SPI_Type *base, spi_master_handle_t *masterHandle, status_t status, void *userData)
-// {
-//   LOG_DEBUG("masterCallback");
-// }
+/*******************************************************************************
+ * Name: is25xp_read_header
+ * FAST_READ instruction, address and dummy byte. The chip select stays
+ * asserted (no kSPI_FrameAssert): the data follows in a second transfer,
+ * straight into the caller's buffer
+ ******************************************************************************/
+
+static void is25xp_read_header(off_t offset) {
+    uint8_t header[IS25_FAST_READ_HEADER];
+    spi_transfer_t xfer;
+
+    header[0] = IS25_FAST_READ;
+    header[1] = (uint8_t)((offset >> 16) & 0xff); // Address bytes
+    header[2] = (uint8_t)((offset >> 8) & 0xff);
+    header[3] = (uint8_t)(offset & 0xff);
+    header[4] = IS25_DUMMY;
+    xfer.txData = header;
+    xfer.rxData = NULL;
+    xfer.configFlags = 0;
+    xfer.dataSize = sizeof(header);
+    SPI_MasterTransferBlocking(SPI8, &xfer);
+}
 
 /*******************************************************************************
  * Name: is25xp_read
+ * Any length, the data is received in buffer (no bounce buffer)
  ******************************************************************************/
 
 ssize_t is25xp_read(off_t offset,
                     size_t nbytes,
                     uint8_t * buffer,
                     uint8_t verbose) {
+    TRACE_SCOPE("is25xp_read");
     if (verbose)
         LOG_DEBUG("offset: %08lx nbytes: %d", (long)offset, (int)nbytes);
+    if (nbytes == 0)
+        return 0;
 
     /* Wait for any preceding write to complete.  We could simplify things by
      * perform this wait at the end of each write operation (rather than at
@@ -504,21 +550,16 @@ ssize_t is25xp_read(off_t offset,
     if (priv.lastwaswrite) {
         is25xp_waitwritecomplete();
     }
+    is25xp_sync();
 
-    srcBuff[0] = IS25_READ;
-    srcBuff[1] = (uint8_t)((offset >> 16) & 0xff); // Address bytes
-    srcBuff[2] = (uint8_t)((offset >> 8) & 0xff);
-    srcBuff[3] = (uint8_t)(offset & 0xff);
+    is25xp_read_header(offset);
 
     spi_transfer_t xfer;
-    xfer.txData = srcBuff;
-    xfer.rxData = destBuff;
+    xfer.txData = NULL; // dummy bytes clock the data out
+    xfer.rxData = buffer;
     xfer.configFlags = kSPI_FrameAssert;
-    xfer.dataSize = nbytes + 4;
+    xfer.dataSize = nbytes;
     SPI_MasterTransferBlocking(SPI8, &xfer);
-    for (size_t i = 0; i < nbytes; i++) {
-        buffer[i] = destBuff[4 + i];
-    }
 
     if (verbose)
         LOG_DEBUG("return nbytes: %d", (int)nbytes);
@@ -526,6 +567,28 @@ ssize_t is25xp_read(off_t offset,
     return (ssize_t)nbytes;
 }
 
+/*******************************************************************************
+ * Name: is25xp_read_throughput
+ * Times one is25xp_read with the DWT cycle counter (spi_mux_init enables it)
+ ******************************************************************************/
+
+uint32_t is25xp_read_throughput(off_t offset,
+                                size_t nbytes,
+                                uint8_t * buffer) {
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+    uint32_t start = DWT->CYCCNT;
+
+    if (is25xp_read(offset, nbytes, buffer, 0) != (ssize_t)nbytes)
+        return 0;
+
+    uint32_t us = (DWT->CYCCNT - start) / (cycles_per_us ? cycles_per_us : 1U);
+    uint32_t kBps = us ? (uint32_t)(((uint64_t)nbytes * 1000U) / us) : 0;
+
+    LOG_INFO("is25xp - FAST_READ %d.%02d MB/s (%d bytes in %dus)", kBps / 1000,
+             (kBps % 1000) / 10, nbytes, us);
+    return kBps;
+}
+
 /*******************************************************************************
  * Name: is25xp_write
  ******************************************************************************/
@@ -601,6 +664,7 @@ ssize_t is25xp_write(off_t offset,
 **		This function implements the Release from Deep-Power-Down
 */
 void is25xp_ReleasePowerDownGetDeviceID() {
+    is25xp_sync();
     SPI_WriteData(SPI8, (uint16_t)IS25_RDID_RDPD, kSPI_FrameAssert);
 }
 
@@ -611,5 +675,166 @@ void is25xp_ReleasePowerDownGetDeviceID() {
 **   the minimizing the power consumption.
 */
 void is25xp_PowerDown() {
+    is25xp_sync();
     SPI_WriteData(SPI8, (uint16_t)IS25_DP, kSPI_FrameAssert);
 }
+
+/*******************************************************************************
+ * Non-blocking operations
+ ******************************************************************************/
+
+static void is25xp_callback(__attribute__((unused)) SPI_Type * base,
+                            __attribute__((unused)) spi_master_handle_t * handle,
+                            __attribute__((unused)) status_t status,
+                            __attribute__((unused)) void * userData) {
+    asyncBusy = false;
+    if (asyncDone)
+        asyncDone();
+}
+
+void is25xp_async_init(void (*done)(void)) {
+    asyncDone = done;
+    SPI_MasterTransferCreateHandle(SPI8, &asyncHandle, is25xp_callback, NULL);
+    asyncReady = true;
+}
+
+bool is25xp_async_ready(void) {
+    return asyncReady;
+}
+
+void is25xp_irqhandler(void) {
+    SPI_MasterTransferHandleIRQ(SPI8, &asyncHandle);
+}
+
+bool is25xp_transfer_done(void) {
+    return !asyncBusy;
+}
+
+/*******************************************************************************
+ * Name: is25xp_busy
+ * The write cycle is only polled after a program/erase, one RDSR per call
+ ******************************************************************************/
+
+bool is25xp_busy(void) {
+    if (asyncBusy)
+        return true;
+    if (!priv.lastwaswrite)
+        return false;
+    if (is25xp_read_status_register(false) & IS25_SR_WIP)
+        return true;
+
+    priv.lastwaswrite = false;
+    return false;
+}
+
+/*******************************************************************************
+ * Name: is25xp_command
+ * Single byte instruction, blocking (the fifo is emptied by the next transfer)
+ ******************************************************************************/
+
+static void is25xp_command(uint8_t cmd) {
+    spi_transfer_t xfer;
+
+    srcBuff[0] = cmd;
+    xfer.txData = srcBuff;
+    xfer.rxData = destBuff;
+    xfer.configFlags = kSPI_FrameAssert;
+    xfer.dataSize = 1;
+    SPI_MasterTransferBlocking(SPI8, &xfer);
+}
+
+/*******************************************************************************
+ * Name: is25xp_erase_start
+ ******************************************************************************/
+
+int is25xp_erase_start(off_t sector,
+                       uint8_t type) {
+    off_t offset = sector << priv.sectorshift;
+
+    if (is25xp_busy())
+        return -EBUSY;
+
+    is25xp_command(IS25_WREN);
+    if (type == IS25_CER) {
+        is25xp_command(IS25_CER);
+    } else {
+        spi_transfer_t xfer;
+
+        srcBuff[0] = type;
+        srcBuff[1] = (uint8_t)((offset >> 16) & 0xff);
+        srcBuff[2] = (uint8_t)((offset >> 8) & 0xff);
+        srcBuff[3] = (uint8_t)(offset & 0xff);
+        xfer.txData = srcBuff;
+        xfer.rxData = destBuff;
+        xfer.configFlags = kSPI_FrameAssert;
+        xfer.dataSize = 4;
+        SPI_MasterTransferBlocking(SPI8, &xfer);
+    }
+
+    priv.lastwaswrite = true;
+    return 0;
+}
+
+/*******************************************************************************
+ * Name: is25xp_pagewrite_start
+ ******************************************************************************/
+
+int is25xp_pagewrite_start(const uint8_t * buffer,
+                           off_t page) {
+    off_t offset = page << priv.pageshift;
+    spi_transfer_t xfer;
+
+    if (is25xp_busy())
+        return -EBUSY;
+
+    is25xp_command(IS25_WREN);
+
+    srcBuff[0] = IS25_PP;
+    srcBuff[1] = (uint8_t)((offset >> 16) & 0xff);
+    srcBuff[2] = (uint8_t)((offset >> 8) & 0xff);
+    srcBuff[3] = (uint8_t)(offset & 0xff);
+    for (int i = 0; i < IS25_IS25XP_BYTES_PER_PAGE; i++) {
+        srcBuff[4 + i] = buffer[i];
+    }
+    xfer.txData = srcBuff;
+    xfer.rxData = destBuff;
+    xfer.configFlags = kSPI_FrameAssert;
+    xfer.dataSize = 4 + IS25_IS25XP_BYTES_PER_PAGE;
+
+    asyncBusy = true;
+    priv.lastwaswrite = true;
+    if (SPI_MasterTransferNonBlocking(SPI8, &asyncHandle, &xfer) != kStatus_Success) {
+        asyncBusy = false;
+        return -EIO;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Name: is25xp_read_start
+ ******************************************************************************/
+
+int is25xp_read_start(off_t offset,
+                      size_t nbytes,
+                      uint8_t * buffer) {
+    spi_transfer_t xfer;
+
+    if (nbytes == 0)
+        return -EINVAL;
+    if (is25xp_busy())
+        return -EBUSY;
+
+    is25xp_read_header(offset); // 5 bytes, blocking
+    xfer.txData = NULL;
+    xfer.rxData = buffer;
+    xfer.configFlags = kSPI_FrameAssert;
+    xfer.dataSize = nbytes;
+
+    asyncBusy = true;
+    if (SPI_MasterTransferNonBlocking(SPI8, &asyncHandle, &xfer) != kStatus_Success) {
+        asyncBusy = false;
+        SPI_WriteData(SPI8, IS25_DUMMY, kSPI_FrameAssert); // ends the frame of the header
+        return -EIO;
+    }
+    return 0;
+}
@@ -13,6 +13,7 @@
 #include "comm_parser.h"
 #include "comm_protocol.h"
 #include "logger.h"
+#include "tracer.h"
 
 extern struct comm_driver_t uart_comm;
 extern struct comm_driver_t serial_comm;
@@ -215,6 +216,7 @@ int comm_protocol_run(struct bootloader_ctxt_t * bctxt,
             }
         }
 
+        TRACE_SCOPE("commp_packet"); // !< Handling, the wait for the packet excluded
         err = comm_protocol_parse_packet(&run_transfer_ctxt, recv_buffer, readlen);
         if (err < 0) {
             LOG_ERROR("Failed to parse packet");
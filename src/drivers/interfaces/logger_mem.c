@@ -113,6 +113,13 @@ static int _init_application_mem(void * drv) {
 
     struct mem_ctxt_t * ctxt = (struct mem_ctxt_t *)&__ssram_log_start__;
 
+    /* Continue the bootloader's log, unless its context is not usable */
+    if ((ctxt->mem_base != &__ssram_log_start__) ||
+        (ctxt->curr_offset < ctxt->mem_start) ||
+        (ctxt->curr_offset >= ctxt->mem_end)) {
+        return _init_bootloader_mem(drv);
+    }
+
     driver->priv_data = ctxt;
 
     return 0;
@@ -133,7 +140,7 @@ static int _write_mem(void * drv,
 
     struct logger_driver_t * driver = (struct logger_driver_t *)drv;
 
-    if (!driver) {
+    if (!driver || !driver->priv_data) {
         return -1;
     }
     struct mem_ctxt_t * ctxt = (struct mem_ctxt_t *)driver->priv_data;
@@ -145,7 +152,7 @@ static int _write_mem(void * drv,
     char * mem_reg = (char *)ctxt->curr_offset;
 
     /* Offset with 4 Byte. first 4 bytes are a 32bit counter */
-    vsnprintf(&mem_reg[sizeof(uint32_t)], MAX_LOG_LEN, fmt, *v);
+    vsnprintf(&mem_reg[sizeof(uint32_t)], MAX_LOG_LEN - sizeof(uint32_t), fmt, *v);
 
     if (ctxt->curr_offset ==
         (ctxt->mem_end - (MAX_LOG_LEN / sizeof(uint32_t)))) {
@@ -166,11 +173,17 @@ static const struct logger_ops_t app_mem_ops = {
     .close = NULL,
 };
 
+/*
+ * The application's superloop logs every handled message on debug level.
+ * Keeping those out leaves room in the ring for entries worth reading back
+ * (also when a host is polling the log over the MainCPU protocol).
+ */
 struct logger_driver_t app_mem_logger = {
     .enabled   = true,
     .name      = "memory",
     .ops       = &app_mem_ops,
     .priv_data = NULL,
+    .levels    = LOG_LVL_ALL,
 };
 
 static const struct logger_ops_t btl_mem_ops = {
@@ -0,0 +1,92 @@
+/**
+ * @file logger_tok_mem.c
+ * @brief  Tokenized memory logger
+ *
+ * Places the tokenized log ring (logger-tok.c) in the shared SRAM log region.
+ * Used instead of the text memory logger when built with CFG_LOGGER_TOKENIZED.
+ * Records are 4 bytes + 4 bytes per argument, the 8Kb region holds ~700
+ * typical entries instead of 63 text slots.
+ *
+ * @version v0.1
+ * @date 2022-09-19
+ */
+
+#include "logger.h"
+#include "logger-tok.h"
+#include "memory_map.h"
+
+/**
+ * @brief  Size of the shared SRAM log region
+ */
+static size_t _tok_region_size() {
+    return (size_t)((uint8_t *)&__ssram_log_end__ - (uint8_t *)&__ssram_log_start__);
+}
+
+/**
+ * @brief  Initialize the tokenized logger if in bootloader mode, starts a new log
+ *
+ * @param drv Driver which will be initialized
+ *
+ * @returns  -1 if failed otherwise 0
+ */
+static int _init_bootloader_tok(void * drv) {
+    struct logger_driver_t * driver = (struct logger_driver_t *)drv;
+
+    if (!driver) {
+        return -1;
+    }
+
+    driver->priv_data = &__ssram_log_start__;
+
+    return logger_tok_init(&__ssram_log_start__, _tok_region_size(), true);
+}
+
+/**
+ * @brief  Initialize the tokenized logger if in application mode, continues the log
+ *
+ * @param drv Driver which will be initialized
+ *
+ * @returns  -1 if failed otherwise 0
+ */
+static int _init_application_tok(void * drv) {
+    struct logger_driver_t * driver = (struct logger_driver_t *)drv;
+
+    if (!driver) {
+        return -1;
+    }
+
+    driver->priv_data = &__ssram_log_start__;
+
+    return logger_tok_init(&__ssram_log_start__, _tok_region_size(), false);
+}
+
+/* No write op: LOG_* macros store records directly via logger_tok_write() */
+static const struct logger_ops_t app_tok_ops = {
+    .init  = _init_application_tok,
+    .write = NULL,
+    .read  = NULL,
+    .flush = NULL,
+    .close = NULL,
+};
+
+struct logger_driver_t app_tok_logger = {
+    .enabled   = true,
+    .name      = "tokenized",
+    .ops       = &app_tok_ops,
+    .priv_data = NULL,
+};
+
+static const struct logger_ops_t btl_tok_ops = {
+    .init  = _init_bootloader_tok,
+    .write = NULL,
+    .read  = NULL,
+    .flush = NULL,
+    .close = NULL,
+};
+
+struct logger_driver_t btl_tok_logger = {
+    .enabled   = true,
+    .name      = "tokenized",
+    .ops       = &btl_tok_ops,
+    .priv_data = NULL,
+};
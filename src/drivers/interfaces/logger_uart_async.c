@@ -0,0 +1,334 @@
+/**
+ * @file logger_uart_async.c
+ * @brief  Non-blocking UART driver for logger
+ *
+ * A LOG_* call formats its line on the stack and copies it into a ring, the
+ * logger UART's TX FIFO interrupt drains the ring. Nothing waits for the
+ * 115200 baud transmission anymore.
+ *
+ * The ring is lock-free for multiple producers (superloop and interrupts) and
+ * one consumer (the TX interrupt):
+ *  - producers claim space by advancing 'reserve' with a CAS and copy their
+ *    line into it
+ *  - the last producer to finish (writers drops to 0) publishes everything
+ *    reserved so far by moving 'commit'. Interrupts nest, so an interrupting
+ *    producer always finishes before the one it interrupted.
+ *  - the consumer only transmits bytes between 'tail' and 'commit'
+ *
+ * When the ring is full the line is dropped (LOGGER_UART_DROP_NEWEST) or the
+ * oldest published lines make room (LOGGER_UART_DROP_OLDEST). Dropped lines
+ * are counted and reported with a marker line once there is room again.
+ *
+ * @version v0.1
+ * @date 2022-09-26
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "board.h"
+#include "peripherals.h"
+#include "fsl_usart.h"
+#include "logger.h"
+#include "logger_uart_async.h"
+
+#define RING_MASK    (LOGGER_UART_ASYNC_SIZE - 1U)
+#define MAX_HDR_LEN  128
+#define MAX_LINE_LEN (MAX_HDR_LEN + MAX_STR_LEN + 2) // header + message + "\r\n"
+
+#if LOGGER_UART_ASYNC_SIZE < (2 * MAX_LINE_LEN)
+#error "LOGGER_UART_ASYNC_SIZE must hold at least 2 full log lines"
+#endif
+
+struct uart_async_ctxt_t {
+    USART_Type *       base;
+    _Atomic uint32_t   reserve;  // !< End of the space claimed by producers
+    _Atomic uint32_t   commit;   // !< End of the completely written lines
+    _Atomic uint32_t   tail;     // !< Next byte to transmit
+    _Atomic uint32_t   writers;  // !< Producers busy copying
+    _Atomic uint32_t   dropped;  // !< Lines dropped since boot
+    _Atomic uint32_t   reported; // !< Dropped lines already reported
+    uint8_t            buf[LOGGER_UART_ASYNC_SIZE];
+};
+
+static struct uart_async_ctxt_t _ctxt = {
+    .base = UART_LOGGER,
+};
+
+/**
+ * @brief  Publish all reserved space if no other producer is still busy
+ */
+static void _ring_publish(struct uart_async_ctxt_t * ctxt) {
+    if (atomic_fetch_sub(&ctxt->writers, 1) != 1) {
+        return; // the interrupted producer publishes when it is done
+    }
+
+    uint32_t commit = atomic_load(&ctxt->commit);
+    uint32_t reserve = atomic_load(&ctxt->reserve);
+
+    // an interrupt may publish more in between, commit only moves forward
+    while ((commit != reserve) &&
+           !atomic_compare_exchange_weak(&ctxt->commit, &commit, reserve)) {
+        reserve = atomic_load(&ctxt->reserve);
+    }
+}
+
+#if LOGGER_UART_ASYNC_POLICY == LOGGER_UART_DROP_OLDEST
+/**
+ * @brief  Discard the oldest published lines to free 'needed' bytes
+ *
+ * Only published bytes are touched, space another producer is still
+ * writing into stays as is.
+ *
+ * @returns  true if the tail moved (caller retries), false if not enough
+ *           published data could be dropped
+ */
+static bool _ring_drop_oldest(struct uart_async_ctxt_t * ctxt,
+                              uint32_t tail,
+                              uint32_t needed) {
+    uint32_t commit = atomic_load(&ctxt->commit);
+    uint32_t pos = tail;
+    uint32_t lines = 0;
+
+    // whole lines only, stop at the first line end past 'needed'
+    for (;;) {
+        if (pos == commit) {
+            return false;
+        }
+        if (ctxt->buf[pos++ & RING_MASK] == '\n') {
+            lines++;
+            if ((pos - tail) >= needed) {
+                break;
+            }
+        }
+    }
+
+    // fails if the TX interrupt moved the tail meanwhile, caller re-evaluates
+    if (atomic_compare_exchange_strong(&ctxt->tail, &tail, pos)) {
+        atomic_fetch_add(&ctxt->dropped, lines);
+    }
+    return true;
+}
+#endif /* LOGGER_UART_DROP_OLDEST */
+
+/**
+ * @brief  Copy a line into the ring, safe from any context
+ *
+ * @param evict Apply LOGGER_UART_DROP_OLDEST when full, else just fail
+ *
+ * @returns  false if the line did not fit
+ */
+static bool _ring_put(struct uart_async_ctxt_t * ctxt,
+                      const char * data,
+                      uint32_t len,
+                      bool evict) {
+    bool stored = false;
+
+    atomic_fetch_add(&ctxt->writers, 1);
+
+    uint32_t start = atomic_load(&ctxt->reserve);
+    for (;;) {
+        uint32_t tail = atomic_load(&ctxt->tail);
+        uint32_t space = LOGGER_UART_ASYNC_SIZE - (start - tail);
+
+        if (space < len) {
+#if LOGGER_UART_ASYNC_POLICY == LOGGER_UART_DROP_OLDEST
+            if (evict && _ring_drop_oldest(ctxt, tail, len - space)) {
+                start = atomic_load(&ctxt->reserve);
+                continue;
+            }
+#else
+            (void)evict;
+#endif /* LOGGER_UART_DROP_OLDEST */
+            break;
+        }
+
+        if (atomic_compare_exchange_weak(&ctxt->reserve, &start, start + len)) {
+            for (uint32_t i = 0; i < len; i++) {
+                ctxt->buf[(start + i) & RING_MASK] = (uint8_t)data[i];
+            }
+            stored = true;
+            break;
+        }
+    }
+
+    _ring_publish(ctxt);
+
+    return stored;
+}
+
+/**
+ * @brief  Feed the TX FIFO from the ring, called from the logger UART IRQ
+ */
+static void _ring_drain(struct uart_async_ctxt_t * ctxt) {
+    for (;;) {
+        uint32_t tail = atomic_load(&ctxt->tail);
+
+        if (tail == atomic_load(&ctxt->commit)) {
+            USART_DisableInterrupts(ctxt->base, kUSART_TxLevelInterruptEnable);
+            // a producer may have published between the check and the disable
+            if (atomic_load(&ctxt->tail) == atomic_load(&ctxt->commit)) {
+                return;
+            }
+            USART_EnableInterrupts(ctxt->base, kUSART_TxLevelInterruptEnable);
+            continue;
+        }
+
+        if (!(USART_GetStatusFlags(ctxt->base) & kUSART_TxFifoNotFullFlag)) {
+            return; // back when the FIFO is empty
+        }
+
+        // claim the byte first, a DROP_OLDEST producer may move the tail
+        uint8_t c = ctxt->buf[tail & RING_MASK];
+        if (atomic_compare_exchange_strong(&ctxt->tail, &tail, tail + 1)) {
+            USART_WriteByte(ctxt->base, c);
+        }
+    }
+}
+
+/**
+ * @brief  Start draining, the TX level interrupt fires while the FIFO is empty
+ */
+static inline void _kick(struct uart_async_ctxt_t * ctxt) {
+    USART_EnableInterrupts(ctxt->base, kUSART_TxLevelInterruptEnable);
+}
+
+/**
+ * @brief  Format one log line (header, message, "\r\n")
+ *
+ * @returns  line length
+ */
+static uint32_t _format_line(char * line,
+                             struct line_info_t * linfo,
+                             char * fmt,
+                             va_list * v) {
+    uint32_t len = 0;
+    int n;
+
+    if (linfo->lvl != LOG_LVL_RAW) {
+        n = snprintf(line, MAX_HDR_LEN,
+                     "[%s%5s%s] (%20s)(%30s @%3d) : ",
+                     _log_levels[logger_mask2id(linfo->lvl)].color,
+                     _log_levels[logger_mask2id(linfo->lvl)].name,
+                     RESET, linfo->file, linfo->fn, linfo->ln);
+        if (n > 0) {
+            len = ((uint32_t)n < MAX_HDR_LEN) ? (uint32_t)n : MAX_HDR_LEN - 1;
+        }
+    }
+
+    n = vsnprintf(&line[len], MAX_STR_LEN, fmt, *v);
+    if (n > 0) {
+        len += ((uint32_t)n < MAX_STR_LEN) ? (uint32_t)n : MAX_STR_LEN - 1;
+    }
+
+    line[len++] = '\r';
+    line[len++] = '\n';
+    return len;
+}
+
+static int _init_uart_async(void * drv) {
+    struct logger_driver_t * driver = (struct logger_driver_t *)drv;
+
+    if (!driver) {
+        return -1;
+    }
+    struct uart_async_ctxt_t * ctxt = (struct uart_async_ctxt_t *)driver->priv_data;
+
+    EnableIRQ(BOARD_LOGGER_FLEXCOMM_IRQN);
+
+    // lines logged before init (peripheral reset cleared the interrupt enable)
+    if (atomic_load(&ctxt->tail) != atomic_load(&ctxt->commit)) {
+        _kick(ctxt);
+    }
+
+    return 0;
+}
+
+static int _write_uart_async(void * drv,
+                             struct line_info_t * linfo,
+                             char * fmt,
+                             va_list * v) {
+    struct logger_driver_t * driver = (struct logger_driver_t *)drv;
+
+    if (!driver) {
+        return -1;
+    }
+    struct uart_async_ctxt_t * ctxt = (struct uart_async_ctxt_t *)driver->priv_data;
+    char line[MAX_LINE_LEN];
+
+    // report drops once there is room again, the marker itself never evicts.
+    // Claim the count with a CAS, an interrupting producer reports only what
+    // was dropped after the claim; give it back if the marker does not fit.
+    uint32_t dropped = atomic_load(&ctxt->dropped);
+    uint32_t reported = atomic_load(&ctxt->reported);
+    if ((dropped != reported) &&
+        atomic_compare_exchange_strong(&ctxt->reported, &reported, dropped)) {
+        int n = snprintf(line, sizeof(line), "--- %lu log lines dropped ---\r\n",
+                         (unsigned long)(dropped - reported));
+        if ((n <= 0) || !_ring_put(ctxt, line, (uint32_t)n, false)) {
+            atomic_fetch_sub(&ctxt->reported, dropped - reported);
+        }
+    }
+
+    bool stored = _ring_put(ctxt, line, _format_line(line, linfo, fmt, v), true);
+    if (!stored) {
+        atomic_fetch_add(&ctxt->dropped, 1);
+    }
+
+    _kick(ctxt);
+
+    return stored ? 0 : -1;
+}
+
+/**
+ * @brief  Transmit everything still in the ring (blocking), e.g. before a reset
+ */
+static void _close_uart_async(void * drv) {
+    struct logger_driver_t * driver = (struct logger_driver_t *)drv;
+
+    if (!driver) {
+        return;
+    }
+    struct uart_async_ctxt_t * ctxt = (struct uart_async_ctxt_t *)driver->priv_data;
+
+    DisableIRQ(BOARD_LOGGER_FLEXCOMM_IRQN);
+    USART_DisableInterrupts(ctxt->base, kUSART_TxLevelInterruptEnable);
+
+    uint32_t tail = atomic_load(&ctxt->tail);
+    while (tail != atomic_load(&ctxt->commit)) {
+        uint8_t c = ctxt->buf[tail & RING_MASK];
+        if (atomic_compare_exchange_strong(&ctxt->tail, &tail, tail + 1)) {
+            USART_WriteBlocking(ctxt->base, &c, 1);
+            tail++;
+        }
+    }
+}
+
+uint32_t logger_uart_async_dropped(void) {
+    return atomic_load(&_ctxt.dropped);
+}
+
+/**
+ * @brief  Logger UART IRQ, TX FIFO level (empty)
+ */
+void BOARD_LOGGER_FLEXCOMM_IRQ(void) {
+    _ring_drain(&_ctxt);
+
+    SDK_ISR_EXIT_BARRIER;
+}
+
+static const struct logger_ops_t uart_async_ops = {
+    .init  = _init_uart_async,
+    .write = _write_uart_async,
+    .read  = NULL,
+    .flush = NULL,
+    .close = _close_uart_async,
+};
+
+struct logger_driver_t uart_async_logger = {
+    .enabled   = true,
+    .name      = "uart_async",
+    .ops       = &uart_async_ops,
+    .priv_data = &_ctxt,
+};
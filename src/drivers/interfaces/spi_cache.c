@@ -0,0 +1,164 @@
+/**
+ * @file spi_cache.c
+ * @brief  LRU read cache of spi flash pages
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include <string.h>
+
+#include "is25xp.h"
+#include "spi_cache.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+struct spi_cache_entry_t {
+    uint32_t page;
+    uint32_t used;              // !< _clock of the last access, LRU
+    bool valid;
+    uint8_t data[SPI_CACHE_PAGE_SIZE];
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static struct spi_cache_entry_t _cache[SPI_CACHE_PAGES];
+static struct spi_cache_stats_t _stats;
+static void (*_count)(bool hit) = NULL;
+static uint32_t _clock = 0;
+static uint32_t _epoch = 0;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+static void _account(bool hit) {
+    if (hit)
+        _stats.hits++;
+    else
+        _stats.misses++;
+    if (_count)
+        _count(hit);
+}
+
+static int _find(uint32_t page) {
+    for (int i = 0; i < SPI_CACHE_PAGES; i++) {
+        if (_cache[i].valid && (_cache[i].page == page)) {
+            _cache[i].used = ++_clock;
+            return i;
+        }
+    }
+    return -1;
+}
+
+// !< a free entry, else the least recently used one
+static int _victim(void) {
+    int victim = 0;
+
+    for (int i = 0; i < SPI_CACHE_PAGES; i++) {
+        if (!_cache[i].valid)
+            return i;
+        if ((int32_t)(_cache[i].used - _cache[victim].used) < 0)
+            victim = i;
+    }
+    return victim;
+}
+
+static void _store(int i,
+                   uint32_t page) {
+    _cache[i].page = page;
+    _cache[i].used = ++_clock;
+    _cache[i].valid = true;
+}
+
+void spi_cache_init(void (*count)(bool hit)) {
+    _count = count;
+    memset(&_stats, 0, sizeof(_stats));
+    for (int i = 0; i < SPI_CACHE_PAGES; i++)
+        _cache[i].valid = false;
+    _epoch++;
+}
+
+ssize_t spi_cache_read(off_t offset,
+                       size_t nbytes,
+                       uint8_t * buffer) {
+    bool fill = (nbytes <= SPI_CACHE_PAGE_SIZE);
+    size_t done = 0;
+
+    while (done < nbytes) {
+        uint32_t pos = (uint32_t)offset + done;
+        uint32_t page = pos >> SPI_CACHE_PAGE_SHIFT;
+        size_t chunk = SPI_CACHE_PAGE_SIZE - (pos & (SPI_CACHE_PAGE_SIZE - 1));
+        int i = _find(page);
+
+        if (chunk > nbytes - done)
+            chunk = nbytes - done;
+        _account(i >= 0);
+
+        if ((i < 0) && fill) {
+            i = _victim();
+            _cache[i].valid = false;
+            ssize_t ret = is25xp_read((off_t)page << SPI_CACHE_PAGE_SHIFT, SPI_CACHE_PAGE_SIZE,
+                                      _cache[i].data, 0);
+            if (ret < 0)
+                return ret;
+            _store(i, page);
+        } else if (i < 0) {
+            // scan: the following misses in one read, not cached
+            while ((done + chunk < nbytes) && (_find(page + 1) < 0)) {
+                size_t next = nbytes - done - chunk;
+
+                chunk += (next > SPI_CACHE_PAGE_SIZE) ? SPI_CACHE_PAGE_SIZE : next;
+                page++;
+                _account(false);
+            }
+            ssize_t ret = is25xp_read((off_t)pos, chunk, buffer + done, 0);
+            if (ret < 0)
+                return ret;
+            done += chunk;
+            continue;
+        }
+        memcpy(buffer + done, &_cache[i].data[pos & (SPI_CACHE_PAGE_SIZE - 1)], chunk);
+        done += chunk;
+    }
+    return (ssize_t)nbytes;
+}
+
+const uint8_t * spi_cache_lookup(uint32_t page) {
+    int i = _find(page);
+
+    _account(i >= 0);
+    return (i < 0) ? NULL : _cache[i].data;
+}
+
+uint32_t spi_cache_epoch(void) {
+    return _epoch;
+}
+
+void spi_cache_fill(uint32_t page,
+                    const uint8_t * data,
+                    uint32_t epoch) {
+    if (epoch != _epoch)
+        return; // programmed or erased while it was read
+    int i = _find(page);
+    if (i < 0) {
+        i = _victim();
+        _store(i, page);
+    }
+    memcpy(_cache[i].data, data, SPI_CACHE_PAGE_SIZE);
+}
+
+void spi_cache_invalidate(uint32_t page,
+                          uint32_t pages) {
+    for (int i = 0; i < SPI_CACHE_PAGES; i++) {
+        if (_cache[i].valid && (_cache[i].page - page < pages)) {
+            _cache[i].valid = false;
+            _stats.invalidated++;
+        }
+    }
+    _epoch++; // reads in flight may hold the old data
+}
+
+const struct spi_cache_stats_t * spi_cache_stats(void) {
+    return &_stats;
+}
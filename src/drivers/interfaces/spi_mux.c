@@ -0,0 +1,166 @@
+/**
+ * @file spi_mux.c
+ * @brief  Lease arbiter of the spi flash mux (GP <-> Gowin)
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include <string.h>
+
+#include "spi_mux.h"
+
+#ifndef UNIT_TEST
+#include "fsl_device_registers.h"
+#include <board.h>
+#include <pin_mux.h>
+#define SPI_MUX_NOW() (DWT->CYCCNT) // !< core cycles
+#else
+// !< native: the pin_mux access and the clock are mocked by the test
+void BOARD_SetSPIMux(uint8_t on);
+bool BOARD_Ready_Gowin(void);
+uint32_t spi_mux_test_now(void);
+#define SPI_MUX_NOW() spi_mux_test_now()
+#endif
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static struct spi_mux_stats_t _stats;
+static void (*_event)(spi_mux_event_t ev, uint32_t value) = NULL;
+static uint32_t _cycles_per_us = 1;
+
+static uint8_t _held[SPI_MUX_CLIENT_NUM];   // !< lease count per client
+static bool _selected = false;              // !< the GP has the bus
+static uint32_t _selected_at = 0;
+static uint32_t _idle_since = 0;            // !< last lease ended
+static bool _fpga_loading = false;          // !< until READY or SPI_MUX_FPGA_LOAD_US
+static uint32_t _fpga_since = 0;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+static uint32_t _elapsed_us(uint32_t since) {
+    return (SPI_MUX_NOW() - since) / _cycles_per_us;
+}
+
+static void _count(spi_mux_event_t ev,
+                   uint32_t value) {
+    switch (ev) {
+        case SPI_MUX_EV_SWITCH:
+            _stats.switches++;
+            break;
+        case SPI_MUX_EV_LEASE:
+            _stats.leases++;
+            break;
+        case SPI_MUX_EV_HOLD:
+            if (value > _stats.hold_max_us)
+                _stats.hold_max_us = value;
+            break;
+        case SPI_MUX_EV_TIMEOUT:
+            _stats.timeouts++;
+            break;
+        case SPI_MUX_EV_REVOKE:
+            _stats.revoked++;
+            break;
+    }
+    if (_event)
+        _event(ev, value);
+}
+
+static bool _leased(void) {
+    for (int i = 0; i < SPI_MUX_CLIENT_NUM; i++) {
+        if (_held[i])
+            return true;
+    }
+    return false;
+}
+
+static void _deselect(void) {
+    if (!_selected)
+        return;
+    BOARD_SetSPIMux(0);
+    _selected = false;
+    _count(SPI_MUX_EV_HOLD, _elapsed_us(_selected_at));
+}
+
+// !< the FPGA loads its bitfile: READY or the max load time ends it. The
+// cycle counter wraps (~28s at 150MHz): spi_mux_poll() closes the window in time
+static bool _fpga_busy(void) {
+    if (_fpga_loading &&
+        (BOARD_Ready_Gowin() || (_elapsed_us(_fpga_since) >= SPI_MUX_FPGA_LOAD_US)))
+        _fpga_loading = false;
+    return _fpga_loading;
+}
+
+void spi_mux_init(void (*event)(spi_mux_event_t ev, uint32_t value),
+                  uint32_t cycles_per_us) {
+#ifndef UNIT_TEST
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    _event = event;
+    memset(&_stats, 0, sizeof(_stats));
+    _cycles_per_us = cycles_per_us ? cycles_per_us : 1U;
+    memset(_held, 0, sizeof(_held));
+
+    BOARD_SetSPIMux(0);
+    _selected = false;
+    _fpga_loading = true; // power-up, unless READY already
+    _fpga_since = SPI_MUX_NOW();
+}
+
+bool spi_mux_acquire(spi_mux_client_t client,
+                     uint32_t timeout_us) {
+    if (!_selected) {
+        uint32_t start = SPI_MUX_NOW();
+
+        while (_fpga_busy()) {
+            if (_elapsed_us(start) >= timeout_us) {
+                _count(SPI_MUX_EV_TIMEOUT, 0);
+                return false;
+            }
+        }
+        BOARD_SetSPIMux(1);
+        _selected = true;
+        _selected_at = SPI_MUX_NOW();
+        _count(SPI_MUX_EV_SWITCH, 0);
+    }
+    _held[client]++;
+    _count(SPI_MUX_EV_LEASE, 0);
+    return true;
+}
+
+void spi_mux_release(spi_mux_client_t client) {
+    if (_held[client] == 0) // revoked
+        return;
+    if (--_held[client] == 0 && !_leased())
+        _idle_since = SPI_MUX_NOW();
+}
+
+bool spi_mux_poll(void) {
+    _fpga_busy(); // ends the load window long before the cycle counter wraps
+    if (_selected && !_leased() && (_elapsed_us(_idle_since) >= SPI_MUX_IDLE_US))
+        _deselect();
+    return _selected;
+}
+
+void spi_mux_reset(void) {
+    if (_leased())
+        _count(SPI_MUX_EV_REVOKE, 0);
+    memset(_held, 0, sizeof(_held));
+    _deselect();
+}
+
+void spi_mux_fpga_request(void) {
+    spi_mux_reset();
+    _fpga_loading = true;
+    _fpga_since = SPI_MUX_NOW();
+}
+
+uint8_t spi_mux_held(spi_mux_client_t client) {
+    return _held[client];
+}
+
+const struct spi_mux_stats_t * spi_mux_stats(void) {
+    return &_stats;
+}
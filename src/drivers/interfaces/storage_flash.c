@@ -34,39 +34,103 @@ static int _init_flash_storage(struct storage_driver_t * sdriver) {
     return 0;
 }
 
-static int _read_flash_storage(struct storage_driver_t * sdriver,
-                               uint8_t * buffer,
-                               size_t len) {
-    LOG_INFO("Read from flash backed storage driver");
+// !< a program page gathered from a scatter-gather list
+static uint8_t _page[FLASH_SECTOR_SIZE];
+
+static bool _in_area(struct flash_area_t * farea,
+                     uint32_t offset,
+                     size_t len) {
+    if (!farea || (offset > farea->size) || (len > farea->size - offset)) {
+        LOG_ERROR("Access outside of the flash area: 0x%X + %d", offset, len);
+        return false;
+    }
+    return true;
+}
+
+static int _preadv_flash_storage(struct storage_driver_t * sdriver,
+                                 uint32_t offset,
+                                 const struct storage_iovec_t * iov,
+                                 int iovcnt) {
     struct flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+    size_t len = storage_iov_length(iov, iovcnt);
 
-    LOG_DEBUG("Reading from 0x%.8X, len: %d", farea->start_addr, len);
+    if (!_in_area(farea, offset, len))
+        return -1;
+
+    LOG_DEBUG("Reading from 0x%.8X + 0x%X, len: %d", farea->start_addr, offset, len);
 
     __DSB();
     __ISB();
-    int error = FLASH_Read(&_fcfg, farea->start_addr, buffer, len);
-    if (error != kStatus_Success) {
-        LOG_ERROR("Flash error status: %d", error);
+    uint32_t addr = farea->start_addr + offset;
+    for (int i = 0; i < iovcnt; i++) {
+        if (!iov[i].len)
+            continue;
+        int error = FLASH_Read(&_fcfg, addr, iov[i].base, iov[i].len);
+        if (error != kStatus_Success) {
+            LOG_ERROR("Flash error status: %d", error);
+            return -1;
+        }
+        addr += iov[i].len;
+    }
+    return (int)len;
+}
+
+// page by page: straight from the caller's buffer when the page is in one
+// buffer, gathered otherwise. A short last page is padded with the erased
+// value: a programmed page can't be programmed again before an erase
+static int _pwritev_flash_storage(struct storage_driver_t * sdriver,
+                                  uint32_t offset,
+                                  const struct storage_iovec_t * iov,
+                                  int iovcnt) {
+    struct flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+    size_t len = storage_iov_length(iov, iovcnt);
+
+    if (!_in_area(farea, offset, len))
+        return -1;
+    if (offset % FLASH_SECTOR_SIZE) {
+        LOG_ERROR("Flash write at 0x%X not page aligned", offset);
         return -1;
     }
-    return 0;
+
+    LOG_DEBUG("Writing len %d to 0x%.8X + 0x%X", len, farea->start_addr, offset);
+
+    for (size_t done = 0; done < len; done += FLASH_SECTOR_SIZE) {
+        size_t avail = 0;
+        uint8_t * src = storage_iov_at(iov, iovcnt, done, &avail);
+
+        if ((avail < FLASH_SECTOR_SIZE) || (len - done < FLASH_SECTOR_SIZE)) {
+            memset(_page, 0xFF, sizeof(_page));
+            storage_iov_copy(iov, iovcnt, done, _page, sizeof(_page));
+            src = _page;
+        }
+        int err = FLASH_Program(&_fcfg, farea->start_addr + offset + done, src,
+                                FLASH_SECTOR_SIZE);
+        if (err != kStatus_Success) {
+            LOG_ERROR("Failed to write data..");
+            return -1;
+        }
+    }
+    return (int)len;
+}
+
+// the area from its start, the cursor is not used
+static int _read_flash_storage(struct storage_driver_t * sdriver,
+                               uint8_t * buffer,
+                               size_t len) {
+    LOG_INFO("Read from flash backed storage driver");
+    const struct storage_iovec_t iov = { buffer, len };
+
+    return (_preadv_flash_storage(sdriver, 0, &iov, 1) < 0) ? -1 : 0;
 }
 
 static int _write_flash_storage(struct storage_driver_t * sdriver,
                                 uint8_t * buffer,
                                 size_t len) {
     struct flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+    const struct storage_iovec_t iov = { buffer, len };
 
-    LOG_DEBUG("Writing len %d to 0x%.8X + 0x%X", len,
-              farea->start_addr, farea->offset);
-
-    int err = FLASH_Program(&_fcfg, farea->start_addr +
-                            farea->offset, buffer,
-                            len);
-    if (err != kStatus_Success) {
-        LOG_ERROR("Failed to write data..");
+    if (_pwritev_flash_storage(sdriver, farea->offset, &iov, 1) < 0)
         return -1;
-    }
 
     farea->offset += len;
     return 1;
@@ -122,13 +186,15 @@ static int _close_flash_storage(struct storage_driver_t * sdriver) {
 }
 
 static const struct storage_ops_t fops = {
-    .init  = _init_flash_storage,
-    .read  = _read_flash_storage,
-    .write = _write_flash_storage,
-    .erase = _erase_flash_storage,
-    .flush = _flush_flash_storage,
-    .crc   = _crc_flash_storage,
-    .close = _close_flash_storage,
+    .init    = _init_flash_storage,
+    .read    = _read_flash_storage,
+    .write   = _write_flash_storage,
+    .erase   = _erase_flash_storage,
+    .flush   = _flush_flash_storage,
+    .crc     = _crc_flash_storage,
+    .close   = _close_flash_storage,
+    .preadv  = _preadv_flash_storage,
+    .pwritev = _pwritev_flash_storage,
 };
 
 static struct storage_driver_t fdriver = {
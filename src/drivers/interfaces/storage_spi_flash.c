@@ -6,6 +6,7 @@
  * @date 2022-03-30
  */
 
+#include <errno.h>
 #include <stdlib.h>
 
 #include "is25xp.h"
@@ -16,6 +17,8 @@
 #include "logger.h"
 #include "storage.h"
 #include "storage_spi_flash.h"
+#include "spi_mux.h"
+#include "spi_cache.h"
 
 #include <board.h>
 #include <pin_mux.h>
@@ -32,12 +35,24 @@
 #define SPI_SSEL              0
 #define SPI_MASTER_IRQHandler FLEXCOMM8_IRQHandler
 #define SPI_SPOL              kSPI_SpolActiveAllLow
+#define SPI_CRC_BLOCK_SIZE    4096 // one FAST_READ per crc block
 
 /*******************************************************************************
  * Variables
  ******************************************************************************/
 // Identification , 4byte: manufacturer, memory, capacity, device ID
 static uint8_t SpiFlash_Identification[5];
+// crc blocks and the throughput measurement, not on the stack
+static uint8_t SpiCrcBlock[SPI_CRC_BLOCK_SIZE];
+// a program page gathered from a scatter-gather list
+static uint8_t SpiPage[IS25_IS25XP_BYTES_PER_PAGE];
+
+// asynchronous requests: the head is in progress, one is25xp operation of
+// SpiReqStep bytes in flight
+static struct storage_req_t * SpiReqQueue = NULL;
+static size_t SpiReqDone = 0;
+static size_t SpiReqStep = 0;
+static bool SpiReqLeased = false;
 
 /*******************************************************************************
  * external code - crc.c
@@ -63,7 +78,7 @@ static void _storage_init_spi_flash() {
 #if defined(SPI_BAUDRATE)
     masterConfig.baudRate_Bps = SPI_BAUDRATE;
 #else
-    masterConfig.baudRate_Bps = 25000000U;
+    masterConfig.baudRate_Bps = CONFIG_IS25XP_SPIFREQUENCY;
 #endif
     int error = SPI_MasterInit(SPI_MASTER, &masterConfig, srcClock_Hz);
     if (error != kStatus_Success) {
@@ -71,7 +86,10 @@ static void _storage_init_spi_flash() {
         return;
     }
 
-    BOARD_SetSPIMux(1);
+    if (!spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, SPI_MUX_FPGA_LOAD_US)) {
+        LOG_ERROR("SPI Flash in use by the Gowin");
+        return;
+    }
 
     // initialisation of SPI Flash struct
     is25xp_readid(SpiFlash_Identification, 0);
@@ -84,7 +102,9 @@ static void _storage_init_spi_flash() {
 
     LOG_DEBUG("spi_master_setup on flexcomm8");
 
-    BOARD_SetSPIMux(0);
+    is25xp_read_throughput(0, sizeof(SpiCrcBlock), SpiCrcBlock);
+
+    spi_mux_release(SPI_MUX_CLIENT_STORAGE);
 }
 
 static int _init_spi_flash_storage(struct storage_driver_t * sdriver) {
@@ -94,23 +114,113 @@ static int _init_spi_flash_storage(struct storage_driver_t * sdriver) {
     return 0;
 }
 
+static bool _in_area(struct spi_flash_area_t * farea,
+                     uint32_t offset,
+                     size_t len) {
+    if (!farea || (offset > farea->size) || (len > farea->size - offset)) {
+        LOG_ERROR("Access outside of the spi flash area: 0x%X + %d", offset, len);
+        return false;
+    }
+    return true;
+}
+
+// the page at addr (any offset in it) out of the list from byte 'from': the
+// caller's buffer when it holds the whole page, gathered in SpiPage otherwise
+// with the rest of the page left erased (a program only clears bits)
+static uint8_t * _spi_page_data(uint32_t addr,
+                                const struct storage_iovec_t * iov,
+                                int iovcnt,
+                                size_t from,
+                                size_t * len) {
+    size_t pos = addr % IS25_IS25XP_BYTES_PER_PAGE;
+    size_t avail = 0;
+    uint8_t * data = storage_iov_at(iov, iovcnt, from, &avail);
+
+    if (*len > IS25_IS25XP_BYTES_PER_PAGE - pos)
+        *len = IS25_IS25XP_BYTES_PER_PAGE - pos;
+    if ((pos == 0) && (*len == IS25_IS25XP_BYTES_PER_PAGE) && (avail >= IS25_IS25XP_BYTES_PER_PAGE))
+        return data;
+
+    memset(SpiPage, 0xFF, sizeof(SpiPage));
+    storage_iov_copy(iov, iovcnt, from, &SpiPage[pos], *len);
+    return SpiPage;
+}
+
+static int _preadv_spi_flash_storage(struct storage_driver_t * sdriver,
+                                     uint32_t offset,
+                                     const struct storage_iovec_t * iov,
+                                     int iovcnt) {
+    struct spi_flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+    size_t len = storage_iov_length(iov, iovcnt);
+
+    if (!_in_area(farea, offset, len))
+        return -1;
+
+    // one lease for all the buffers
+    if (!spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, SPI_MUX_TIMEOUT_US)) {
+        LOG_ERROR("SPI Flash in use by the Gowin");
+        return -1;
+    }
+    off_t addr = (off_t)farea->start_addr + (off_t)offset;
+    for (int i = 0; i < iovcnt; i++) {
+        if (!iov[i].len)
+            continue;
+        if (spi_cache_read(addr, iov[i].len, iov[i].base) <= 0) {
+            spi_mux_release(SPI_MUX_CLIENT_STORAGE);
+            LOG_ERROR("Flash read error");
+            return -1;
+        }
+        addr += (off_t)iov[i].len;
+    }
+    spi_mux_release(SPI_MUX_CLIENT_STORAGE);
+    return (int)len;
+}
+
+// page programs at any offset, the pages are expected erased
+static int _pwritev_spi_flash_storage(struct storage_driver_t * sdriver,
+                                      uint32_t offset,
+                                      const struct storage_iovec_t * iov,
+                                      int iovcnt) {
+    struct spi_flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+    size_t len = storage_iov_length(iov, iovcnt);
+
+    if (!_in_area(farea, offset, len))
+        return -1;
+    if (!len)
+        return 0;
+
+    uint32_t addr = farea->start_addr + offset;
+    uint32_t first = addr / IS25_IS25XP_BYTES_PER_PAGE;
+
+    if (!spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, SPI_MUX_TIMEOUT_US)) {
+        LOG_ERROR("SPI Flash in use by the Gowin");
+        return -1;
+    }
+    spi_cache_invalidate(first, (addr + len - 1) / IS25_IS25XP_BYTES_PER_PAGE - first + 1);
+    for (size_t done = 0; done < len;) {
+        size_t n = len - done;
+        uint8_t * data = _spi_page_data(addr + done, iov, iovcnt, done, &n);
+
+        is25xp_pagewrite(data, (off_t)((addr + done) / IS25_IS25XP_BYTES_PER_PAGE));
+        done += n;
+    }
+    spi_mux_release(SPI_MUX_CLIENT_STORAGE);
+    return (int)len;
+}
+
 static int _read_spi_flash_storage(struct storage_driver_t * sdriver,
                                    uint8_t * buffer,
                                    size_t len) {
     struct spi_flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+    const struct storage_iovec_t iov = { buffer, len };
 
     if (farea->offset == 0)
         LOG_INFO("Reading from[%s]at 0x%x, offset: %d len: %d", farea->area_name,
                  farea->start_addr, farea->offset, len);
-    BOARD_SetSPIMux(1);
-    int ret = is25xp_read((off_t)farea->start_addr + (off_t)farea->offset, len, buffer, 1);
-    BOARD_SetSPIMux(0);
-    // LOG_DEBUG("is25xp_read startblock: %04lx returned [%d] bytes", (long)farea->start_addr, ret);
 
-    if (ret <= 0) {
-        LOG_ERROR("Flash read error");
+    int ret = _preadv_spi_flash_storage(sdriver, farea->offset, &iov, 1);
+    if (ret <= 0)
         return -1;
-    }
     farea->offset += len;
     return ret;
 }
@@ -119,25 +229,126 @@ static int _write_spi_flash_storage(struct storage_driver_t * sdriver,
                                     uint8_t * buffer,
                                     size_t len) {
     struct spi_flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+    const struct storage_iovec_t iov = { buffer, len };
+
+    if (_pwritev_spi_flash_storage(sdriver, farea->offset, &iov, 1) < 0)
+        return -1;
+    farea->offset += len;
+    return 1;
+}
+
+// ------------------------------------------------------------------------------
+// asynchronous requests on the is25xp non-blocking operations: one read per
+// buffer, one page program per page, started from storage_poll_requests
+static void _complete_spi_request(int result) {
+    struct storage_req_t * req = SpiReqQueue;
+
+    SpiReqQueue = req->next;
+    SpiReqDone = 0;
+    SpiReqStep = 0;
+    if (SpiReqLeased && spi_mux_held(SPI_MUX_CLIENT_STORAGE))
+        spi_mux_release(SPI_MUX_CLIENT_STORAGE);
+    SpiReqLeased = false;
+
+    req->next = NULL;
+    req->result = result;
+    req->busy = false;
+    if (req->done)
+        req->done(req);
+}
+
+// the next operation of the head request, -EBUSY: the flash is busy
+static int _start_spi_step(struct storage_req_t * req,
+                           size_t len) {
+    struct spi_flash_area_t * farea = req->area;
+    uint32_t addr = farea->start_addr + req->offset + SpiReqDone;
+    size_t n = len - SpiReqDone;
+    int ret;
 
-    off_t startPage = (off_t)farea->start_addr / IS25_IS25XP_BYTES_PER_PAGE;
-    off_t blockNr = (off_t)farea->offset / IS25_IS25XP_BYTES_PER_PAGE;
+    if (req->op == STORAGE_REQ_READ) {
+        uint8_t * data = storage_iov_at(req->iov, req->iovcnt, SpiReqDone, &n);
 
-    BOARD_SetSPIMux(1);
+        ret = is25xp_read_start((off_t)addr, n, data);
+    } else {
+        uint8_t * data = _spi_page_data(addr, req->iov, req->iovcnt, SpiReqDone, &n);
+        uint32_t page = addr / IS25_IS25XP_BYTES_PER_PAGE;
 
-    is25xp_pagewrite(buffer, startPage + blockNr++);
-    // transfer is per 512 bytes we need a 2nd page-write
-    if (len > IS25_IS25XP_BYTES_PER_PAGE) {
-        is25xp_pagewrite(buffer + IS25_IS25XP_BYTES_PER_PAGE, startPage + blockNr++);
+        spi_cache_invalidate(page, 1);
+        ret = is25xp_pagewrite_start(data, (off_t)page);
     }
+    if (ret == 0)
+        SpiReqStep = n;
+    return ret;
+}
 
-    // LOG_INFO("Spi write len %d to 0x%x per 256 bytes (blockNr:%d)", len,
-    //        farea->offset, blockNr, pages);
+static int _submit_spi_flash_storage(struct storage_driver_t * sdriver,
+                                     struct storage_req_t * req) {
+    struct spi_flash_area_t * farea = STORAGE_GETPRIV(sdriver);
 
-    BOARD_SetSPIMux(0);
+    if (!_in_area(farea, req->offset, storage_iov_length(req->iov, req->iovcnt)))
+        return -1;
 
-    farea->offset += len;
-    return 1;
+    // no transfer handle (bootloader): done right away
+    if (!is25xp_async_ready()) {
+        if (req->op == STORAGE_REQ_READ)
+            req->result = _preadv_spi_flash_storage(sdriver, req->offset, req->iov, req->iovcnt);
+        else
+            req->result = _pwritev_spi_flash_storage(sdriver, req->offset, req->iov, req->iovcnt);
+        req->busy = false;
+        if (req->done)
+            req->done(req);
+        return 0;
+    }
+
+    struct storage_req_t ** tail = &SpiReqQueue;
+
+    while (*tail)
+        tail = &(*tail)->next;
+    req->area = farea;
+    req->next = NULL;
+    *tail = req;
+    return 0;
+}
+
+static int _poll_spi_flash_storage(struct storage_driver_t * sdriver) {
+    (void)sdriver;
+    int completed = 0;
+
+    while (SpiReqQueue) {
+        struct storage_req_t * req = SpiReqQueue;
+        size_t len = storage_iov_length(req->iov, req->iovcnt);
+
+        if (!SpiReqLeased) {
+            // an FPGA loading its bitfile is not waited for, next poll
+            if (!spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, 0))
+                return completed;
+            SpiReqLeased = true;
+        } else if (!spi_mux_held(SPI_MUX_CLIENT_STORAGE)) {
+            LOG_ERROR("SPI Flash taken back by the Gowin");
+            _complete_spi_request(-1);
+            completed++;
+            continue;
+        }
+
+        // the transfer, and the write cycle of a program
+        if (is25xp_busy())
+            return completed;
+        SpiReqDone += SpiReqStep;
+        SpiReqStep = 0;
+
+        if (SpiReqDone < len) {
+            int ret = _start_spi_step(req, len);
+
+            if ((ret == 0) || (ret == -EBUSY)) // -EBUSY: the spi queue's operation
+                return completed;
+            LOG_ERROR("SPI Flash request failed (%d)", ret);
+            _complete_spi_request(-1);
+        } else {
+            _complete_spi_request((int)len);
+        }
+        completed++;
+    }
+    return completed;
 }
 
 static int _flush_spi_flash_storage(struct storage_driver_t * sdriver) {
@@ -165,9 +376,14 @@ static int _erase_spi_flash_storage(struct storage_driver_t * sdriver) {
     LOG_INFO("spi erase: Addr 0x%x size: 0x%X (Nr of blocks = %d)", farea->start_addr,
              farea->size, nBlocks);
 
-    BOARD_SetSPIMux(1);
+    if (!spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, SPI_MUX_TIMEOUT_US)) {
+        LOG_ERROR("SPI Flash in use by the Gowin");
+        return -1;
+    }
+    spi_cache_invalidate((uint32_t)startBlock * (SECTOR_SIZE / SPI_CACHE_PAGE_SIZE),
+                         nBlocks * (SECTOR_SIZE / SPI_CACHE_PAGE_SIZE));
     size_t erasedBlocks = (size_t)is25xp_erase(startBlock, nBlocks);
-    BOARD_SetSPIMux(0);
+    spi_mux_release(SPI_MUX_CLIENT_STORAGE);
 
     if (erasedBlocks != nBlocks) {
         LOG_ERROR("Erased blocks don't match %d<>%d", erasedBlocks, nBlocks);
@@ -190,13 +406,16 @@ static uint32_t _crc_spi_flash_storage(struct storage_driver_t * sdriver,
 
     LOG_INFO("spi calculate crc length of %X..%X", farea->start_addr, farea->start_addr + len);
 
-    const uint32_t BLOCKSIZE = FLASH_SECTOR_SIZE;
-    uint8_t buffer[BLOCKSIZE];
+    const uint32_t BLOCKSIZE = SPI_CRC_BLOCK_SIZE;
+    uint8_t * buffer = SpiCrcBlock;
     uint32_t crc = 0;
     uint32_t blocks = len / BLOCKSIZE;
-    uint8_t rest = (uint8_t)(len % BLOCKSIZE);
+    uint32_t rest = len % BLOCKSIZE;
 
-    LOG_DEBUG("spi crc calculation blocks of 512: %d rest: %d", blocks, rest);
+    LOG_DEBUG("spi crc calculation blocks of %d: %d rest: %d", BLOCKSIZE, blocks, rest);
+
+    // one lease for all the block reads
+    bool leased = spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, SPI_MUX_TIMEOUT_US);
 
     for (uint32_t i = 0; i < blocks; i++) {
         _read_spi_flash_storage(sdriver, buffer, BLOCKSIZE);
@@ -206,6 +425,8 @@ static uint32_t _crc_spi_flash_storage(struct storage_driver_t * sdriver,
         _read_spi_flash_storage(sdriver, buffer, rest);
         crc = crc32(crc, buffer, rest);
     }
+    if (leased)
+        spi_mux_release(SPI_MUX_CLIENT_STORAGE);
 
     return crc;
 }
@@ -216,13 +437,17 @@ static int _close_spi_flash_storage(struct storage_driver_t * sdriver) {
 }
 
 static const struct storage_ops_t fops = {
-    .init  = _init_spi_flash_storage,
-    .read  = _read_spi_flash_storage,
-    .write = _write_spi_flash_storage,
-    .erase = _erase_spi_flash_storage,
-    .flush = _flush_spi_flash_storage,
-    .crc   = _crc_spi_flash_storage,
-    .close = _close_spi_flash_storage,
+    .init    = _init_spi_flash_storage,
+    .read    = _read_spi_flash_storage,
+    .write   = _write_spi_flash_storage,
+    .erase   = _erase_spi_flash_storage,
+    .flush   = _flush_spi_flash_storage,
+    .crc     = _crc_spi_flash_storage,
+    .close   = _close_spi_flash_storage,
+    .preadv  = _preadv_spi_flash_storage,
+    .pwritev = _pwritev_spi_flash_storage,
+    .submit  = _submit_spi_flash_storage,
+    .poll    = _poll_spi_flash_storage,
 };
 
 static struct storage_driver_t fdriver = {
@@ -280,9 +505,14 @@ int storage_wipe_partial_spi_flash(struct spi_flash_area_t * farea) {
     LOG_INFO("spi erase: Addr 0x%x size: 0x%X (number of blocks %d)",
              farea->start_addr, farea->size, nBlocks);
 
-    BOARD_SetSPIMux(1);
+    if (!spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, SPI_MUX_TIMEOUT_US)) {
+        LOG_ERROR("SPI Flash in use by the Gowin");
+        return -1;
+    }
+    spi_cache_invalidate((uint32_t)startBlock * (SECTOR_SIZE / SPI_CACHE_PAGE_SIZE),
+                         nBlocks * (SECTOR_SIZE / SPI_CACHE_PAGE_SIZE));
     size_t erasedBlocks = (size_t)is25xp_erase(startBlock, nBlocks);
-    BOARD_SetSPIMux(0);
+    spi_mux_release(SPI_MUX_CLIENT_STORAGE);
 
     if (erasedBlocks != nBlocks) {
         LOG_ERROR("Number of erased blocks don't match %d<>%d", erasedBlocks,
@@ -8,6 +8,7 @@
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include "crc_linux.h"
 #include "logger.h"
@@ -18,6 +19,7 @@
 #define I2C_DEVICE_NAME_LENGTH   15
 #define I2C_ADDRESS              0x60 // the gpmcu-device command interface
 #define I2C_ADDRESS_BIS          0x61 // gpmcu-device - readback of spi flash pages
+#define I2C_ADDRESS_STREAM       0x63 // gpmcu-device - streamed spi flash programming
 
 // 8Byte r/w register addresses accesible via i2c (instead of default uart)
 #define I2C_FLASH_CMD_BOOTPART   (0x09u) // Read 0 or 1
@@ -27,6 +29,19 @@
 
 #define I2C_DATA_LENGTH          (256) // MAX is 256
 
+// streamed programming on 0x63, see application i2c/i2c_stream.h
+#define I2C_STREAM_CMD_START     0x01
+#define I2C_STREAM_CMD_DATA      0x02
+#define I2C_STREAM_CMD_ABORT     0x04
+#define I2C_STREAM_FLAG_BUSY     (1 << 0)
+#define I2C_STREAM_FLAG_ACTIVE   (1 << 1)
+#define I2C_STREAM_FLAG_ERROR    (1 << 2)
+#define I2C_STREAM_HEADER        3 // CMD, PAGE(2)
+#define I2C_STREAM_STATUS_LENGTH 9
+#define I2C_STREAM_TIMEOUT_S     5 // no progress, a 4k erase takes 300ms max
+#define I2C_STREAM_SECTOR_PAGES  16 // START: whole 4k sectors
+#define I2C_STREAM_IMAGE_PAGES   0x3F0 // spi0 without the context sector
+
 static int fd;
 static uint32_t crc_input_file;  // CRC calculation of the input file
 static char i2c_device_name[I2C_DEVICE_NAME_LENGTH] = I2C_DEVICE; // set i2c device
@@ -426,4 +441,152 @@ int i2c_isp_flash_calculate_crc(const char * filename) {
     i2c_spi_flash_cmd_set_page_access(false);
 
     return crc;
-}
\ No newline at end of file
+}
+
+// ------------------------------------------------------------------------------
+
+/*!
+ * @brief _stream_write() on 0x63
+ * One i2c write: a command or a page
+ * @return a non-negative on success, or -1 on failure.
+ */
+static int _stream_write(uint8_t * frame,
+                         uint16_t length) {
+    struct i2c_msg message = { I2C_ADDRESS_STREAM, 0, length, frame };
+    struct i2c_rdwr_ioctl_data ioctl_data = { &message, 1 };
+
+    return (ioctl(fd, I2C_RDWR, &ioctl_data) == 1) ? 0 : -1;
+}
+
+/*!
+ * @brief _stream_status() on 0x63
+ * [FLAGS, FREE_SLOTS, LAST_ERROR, COMMITTED(4byte BE), NEXT_PAGE(2byte BE)]
+ * @return a non-negative on success, or -1 on failure.
+ */
+static int _stream_status(uint8_t * status) {
+    struct i2c_msg message = { I2C_ADDRESS_STREAM, I2C_M_RD, I2C_STREAM_STATUS_LENGTH, status };
+    struct i2c_rdwr_ioctl_data ioctl_data = { &message, 1 };
+
+    return (ioctl(fd, I2C_RDWR, &ioctl_data) == 1) ? 0 : -1;
+}
+
+/*!
+ * @brief i2c_spi_flash_program_stream()
+ * Erase and write a binary firmware file from address 0 on, streamed: the pages
+ * go into the gpmcu staging fifo while there are free slots, the status
+ * register is polled instead of sleeping. The device is opened once.
+ * @param filename the file reference
+ * @return a non-negative on success, or -1 on failure.
+ */
+int i2c_spi_flash_program_stream(const char * filename) {
+    int fp = open(filename, O_RDONLY);
+
+    if (fp < 0) {
+        LOG_ERROR("Failed to open %s bin file", filename);
+        return -1;
+    }
+
+    struct stat st;
+    fstat(fp, &st);
+    const uint32_t sectors = (st.st_size + I2C_STREAM_SECTOR_PAGES * I2C_DATA_LENGTH - 1) /
+                             (I2C_STREAM_SECTOR_PAGES * I2C_DATA_LENGTH);
+    const uint32_t pages = sectors * I2C_STREAM_SECTOR_PAGES; // tail padded with 0xff
+    if ((pages == 0) || (pages > I2C_STREAM_IMAGE_PAGES)) {
+        LOG_ERROR("%s: %d pages can not be streamed", filename, pages);
+        close(fp);
+        return -1;
+    }
+
+    uint8_t * buf = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fp, 0);
+    if (buf == MAP_FAILED) {
+        LOG_ERROR("Failed to mmap file");
+        close(fp);
+        return -1;
+    }
+
+    crc_input_file = calculate_bin_crc(filename);
+    LOG_INFO("File(%s)-CRC32: %x, streaming %d pages", filename, crc_input_file, pages);
+
+    fd = open_i2c_device(i2c_device_name);
+    if (fd < 0) {
+        LOG_ERROR("i2c device %s missing", i2c_device_name);
+        munmap(buf, st.st_size);
+        close(fp);
+        return -1;
+    }
+
+    int ret = 0;
+    uint8_t frame[I2C_STREAM_HEADER + I2C_DATA_LENGTH] = { I2C_STREAM_CMD_START, 0, 0,
+                                                           (uint8_t)(pages >> 8),
+                                                           (uint8_t)pages };
+    uint8_t status[I2C_STREAM_STATUS_LENGTH];
+    uint32_t committed = 0;
+    uint32_t progress = 0;
+    time_t last_progress = time(NULL);
+
+    if (_stream_write(frame, 5) < 0) {
+        perror("failed to start the stream");
+        ret = -1;
+    }
+
+    while (ret == 0) {
+        if (_stream_status(status) < 0) {
+            perror("failed to read the stream status");
+            ret = -1;
+            break;
+        }
+        committed = ((uint32_t)status[3] << 24) | ((uint32_t)status[4] << 16) |
+                    ((uint32_t)status[5] << 8) | status[6];
+        if (status[0] & I2C_STREAM_FLAG_ERROR) {
+            LOG_ERROR("gpmcu flash error %d at 0x%X", status[2], committed);
+            ret = -1;
+            break;
+        }
+        if (!(status[0] & (I2C_STREAM_FLAG_BUSY | I2C_STREAM_FLAG_ACTIVE)))
+            break; // all committed, or refused
+
+        // resend from where the gpmcu is, dropped pages included
+        uint32_t next = ((uint32_t)status[7] << 8) | status[8];
+        for (uint8_t n = 0; (n < status[1]) && (next < pages); n++, next++) {
+            uint32_t offset = next * I2C_DATA_LENGTH;
+            uint32_t length = 0;
+            if (offset < (uint32_t)st.st_size)
+                length = ((st.st_size - offset) < I2C_DATA_LENGTH) ?
+                         (uint32_t)(st.st_size - offset) : I2C_DATA_LENGTH;
+            frame[0] = I2C_STREAM_CMD_DATA;
+            frame[1] = (uint8_t)(next >> 8);
+            frame[2] = (uint8_t)next;
+            memcpy(&frame[I2C_STREAM_HEADER], buf + offset, length);
+            memset(&frame[I2C_STREAM_HEADER + length], 0xff, I2C_DATA_LENGTH - length);
+            if (_stream_write(frame, sizeof(frame)) < 0) {
+                LOG_WARN("page %d not sent", next);
+                break; // next status tells where to go on
+            }
+        }
+
+        if (committed != progress) {
+            if ((committed / I2C_DATA_LENGTH) / 100 != (progress / I2C_DATA_LENGTH) / 100)
+                LOG_DEBUG("Flashed Block: %d/%d", committed / I2C_DATA_LENGTH, pages);
+            progress = committed;
+            last_progress = time(NULL);
+        } else if (time(NULL) - last_progress > I2C_STREAM_TIMEOUT_S) {
+            LOG_ERROR("no progress at 0x%X, last error %d", committed, status[2]);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && committed != pages * I2C_DATA_LENGTH) {
+        LOG_ERROR("stream stopped at 0x%X, last error %d", committed, status[2]);
+        ret = -1;
+    }
+    if (ret < 0) {
+        frame[0] = I2C_STREAM_CMD_ABORT;
+        _stream_write(frame, 1);
+    } else
+        LOG_INFO("Streamed %d pages", pages);
+
+    close(fd);
+    munmap(buf, st.st_size);
+    close(fp);
+    return ret;
+}
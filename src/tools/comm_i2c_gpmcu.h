@@ -40,6 +40,7 @@ int i2c_isp_flash_set_device(const char * devicename);
 int i2c_spi_flash_cmd(gp_flash_msg cmd);
 int i2c_spi_flash_cmd_set_page_access(bool PageAccessOn);
 int i2c_spi_flash_program(const char * filename);
+int i2c_spi_flash_program_stream(const char * filename);
 
 int i2c_isp_flash_calculate_crc(const char * filename);
 int i2c_spi_flash_readback_page(const uint16_t address,
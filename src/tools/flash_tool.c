@@ -560,6 +560,9 @@ void _print_tools_help() {
     //     "\t\t spi-Flash : flash_tool -s 0x02 -f gw-greenpower.bin -p %s",I2C_DEVICE);
     LOG_RAW(
         "\t\t spi-Flash Status Register: flash_tool -s 0x05 -p %s", I2C_DEVICE);
+    LOG_RAW(
+        "\t\t spi-Flash streamed program: flash_tool -s stream -f gw-greenpower.bin -p %s",
+        I2C_DEVICE);
     LOG_RAW(
         "\t\t spi-Flash commands can be in hex \"0x\". or decimal\".\" See SPI Flash data-sheet");
     LOG_RAW(
@@ -631,6 +634,9 @@ int main(int argc,
                 if (optarg[0] == 'c' && optarg[1] == 'r' && optarg[2] == 'c') {
                     // create local CRC cmd identifier
                     spi_cmd.cmd = ~SPI_IS25_READ;
+                } else if (strcmp(optarg, "stream") == 0) {
+                    // create local streamed program cmd identifier
+                    spi_cmd.cmd = ~SPI_IS25_PP;
                 } else if (optarg[1] != 'x') {
                     spi_cmd.cmd = atoi(optarg);
                 } else {
@@ -684,6 +690,9 @@ int main(int argc,
             case SPI_IS25_PP:     // program the flash
                 ret = i2c_spi_flash_program(ctxt.file);
                 break;
+            case (~SPI_IS25_PP):  // program the flash, streamed
+                ret = i2c_spi_flash_program_stream(ctxt.file);
+                break;
             default:     // regular commands
                 ret = i2c_spi_flash_cmd(spi_cmd);
         }
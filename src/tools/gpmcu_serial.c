@@ -0,0 +1,151 @@
+/**
+ * @file gpmcu_serial.c
+ * @brief  MainCPU protocol over the serial port, host side
+ *
+ * @version v0.1
+ * @date 2022-10-07
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "gpmcu_serial.h"
+#include "logger.h"
+
+#define MAX_REQUEST_SIZE   16
+#define READ_TIMEOUT_LOOPS 10   // x 100ms (VTIME)
+
+static speed_t _baudrate(int baud) {
+    switch (baud) {
+        case 57600:  return B57600;
+        case 115200: return B115200;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default:     return B230400;
+    }
+}
+
+int gpmcu_serial_open(char * params) {
+    char * sep = strchr(params, ':');
+    int baud = 230400;
+
+    if (sep) {
+        *sep = '\0';
+        baud = atoi(sep + 1);
+    }
+
+    int fd = open(params, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open port %s", params);
+        return -1;
+    }
+
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        LOG_ERROR("error %d from tcgetattr", errno);
+        close(fd);
+        return -1;
+    }
+    cfmakeraw(&tty);
+    cfsetospeed(&tty, _baudrate(baud));
+    cfsetispeed(&tty, _baudrate(baud));
+    tty.c_cflag |= (CLOCAL | CREAD);
+    tty.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 1;                                // 0.1 seconds read timeout
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        LOG_ERROR("error %d from tcsetattr", errno);
+        close(fd);
+        return -1;
+    }
+    tcflush(fd, TCIOFLUSH);
+
+    LOG_OK("Connected to %s @ %d", params, baud);
+    return fd;
+}
+
+int gpmcu_serial_send(int fd,
+                      const uint8_t * data,
+                      size_t len) {
+    uint8_t frame[2 * (MAX_REQUEST_SIZE + 1) + 2];
+    size_t pos = 0;
+    uint8_t checksum = 0;
+
+    if (len > MAX_REQUEST_SIZE)
+        return -1;
+
+    frame[pos++] = COMM_START_BYTE;
+    for (size_t i = 0; i <= len; i++) {
+        uint8_t c;
+        if (i < len) {
+            c = data[i];
+            checksum = (uint8_t)(checksum + c);
+        } else {
+            c = checksum;
+        }
+        if ((c == COMM_ESCAPE) || (c == COMM_START_BYTE) || (c == COMM_STOP_BYTE)) {
+            frame[pos++] = COMM_ESCAPE;
+            c = (uint8_t)(c - COMM_ESCAPE);
+        }
+        frame[pos++] = c;
+    }
+    frame[pos++] = COMM_STOP_BYTE;
+
+    return (write(fd, frame, pos) == (ssize_t)pos) ? 0 : -1;
+}
+
+int gpmcu_serial_read(int fd,
+                      uint8_t * msg,
+                      size_t size) {
+    bool started = false;
+    bool escaped = false;
+    size_t len = 0;
+    int timeout = READ_TIMEOUT_LOOPS;
+
+    while (1) {
+        uint8_t c;
+        ssize_t n = read(fd, &c, 1);
+        if (n < 0) {
+            if (errno != EINTR)
+                LOG_ERROR("Failed to read from serial");
+            return -1;
+        }
+        if (n == 0) {
+            if (--timeout == 0)
+                return -1;
+            continue;
+        }
+
+        if (c == COMM_START_BYTE) {
+            started = true;
+            escaped = false;
+            len = 0;
+        } else if (!started) {
+            continue;
+        } else if (c == COMM_STOP_BYTE) {
+            if (len < 2)
+                return -1;
+            uint8_t checksum = 0;
+            for (size_t i = 0; i < len - 1; i++)
+                checksum = (uint8_t)(checksum + msg[i]);
+            if (checksum != msg[len - 1]) {
+                LOG_WARN("Checksum error in reply");
+                return -1;
+            }
+            return (int)(len - 1);
+        } else if (c == COMM_ESCAPE) {
+            escaped = true;
+        } else if (len < size) {
+            msg[len++] = escaped ? (uint8_t)(c + COMM_ESCAPE) : c;
+            escaped = false;
+        } else {
+            return -1;
+        }
+    }
+}
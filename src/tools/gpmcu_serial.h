@@ -0,0 +1,64 @@
+/**
+ * @file gpmcu_serial.h
+ * @brief  MainCPU protocol over the serial port, host side
+ *
+ * Framing as in src/application/comm/protocol.c: SOP, escaped data and
+ * checksum, EOP. Shared by the application-code tools (log_follow,
+ * perf_sample).
+ *
+ * @version v0.1
+ * @date 2022-10-07
+ */
+
+#ifndef _TOOLS_GPMCU_SERIAL_H_
+#define _TOOLS_GPMCU_SERIAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GPMCU_DEFAULT_PORT    "/dev/ttyPS1:230400"
+
+/* MainCPU protocol, see src/application/comm/protocol.h and comm.h */
+#define COMM_START_BYTE       0xFE
+#define COMM_STOP_BYTE        0xFF
+#define COMM_ESCAPE           0x80
+#define COMM_CMD_NACK         0x00
+#define COMM_REPLY_ACK        0x01
+#define GPMCU_ADDRESS         0x10
+#define CMD_READ_BYTE         0x10
+#define CMD_WRITE_BYTE        0x11
+#define CMD_READ_4BYTE        0x14
+#define CMD_READ_ARRAY        0x18
+
+/**
+ * @brief  Open and configure the serial port (raw, 0.1s read timeout)
+ *
+ * @param params "<device>:<baudrate>", the ':' gets replaced by '\0'
+ *
+ * @returns  file descriptor or -1
+ */
+int gpmcu_serial_open(char * params);
+
+/**
+ * @brief  Encode and send one message, checksum is added
+ *
+ * @param fd Serial port
+ * @param data [ADR, CMD, DATA...]
+ * @param len Length of data
+ *
+ * @returns  0 on success, -1 on error
+ */
+int gpmcu_serial_send(int fd,
+                      const uint8_t * data,
+                      size_t len);
+
+/**
+ * @brief  Receive and decode one frame, checksum byte is verified and stripped
+ *
+ * @returns  decoded length or -1 on timeout (~1s)/checksum error
+ */
+int gpmcu_serial_read(int fd,
+                      uint8_t * msg,
+                      size_t size);
+
+#endif /* _TOOLS_GPMCU_SERIAL_H_ */
@@ -0,0 +1,170 @@
+/**
+ * @file log_follow.c
+ * @brief  Tail the gpmcu memory log over the MainCPU protocol
+ *
+ * Polls the application with the CMD_ID_LOGFOLLOW array read and prints every
+ * new memory-log entry. The reply contains all entries newer than the cursor
+ * we send, so we keep polling back-to-back while there is data and only sleep
+ * when the log is idle. The MCU keeps running, nothing gets halted.
+ *
+ * @version v0.1
+ * @date 2022-09-12
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "gpmcu_serial.h"
+
+#define DEFAULT_PORT          GPMCU_DEFAULT_PORT
+#define MAX_PARAM_LEN         128
+
+#define CMD_ID_LOGFOLLOW      0xA1
+#define LOGFOLLOW_HEADER_SIZE 5
+#define LOGFOLLOW_RECORD_HDR  5
+
+#define MAX_FRAME_SIZE        1100 // worst case: every byte of a 514 byte reply escaped
+
+static volatile bool _running = true;
+
+static void _sigint_handler(int sig) {
+    (void)sig;
+    _running = false;
+}
+
+/**
+ * @brief  Send [ADR, CMD_READ_ARRAY, CMD_ID_LOGFOLLOW, CURSOR(4byte BE)]
+ */
+static int _send_request(int fd,
+                         uint32_t cursor) {
+    const uint8_t data[] = { GPMCU_ADDRESS, CMD_READ_ARRAY, CMD_ID_LOGFOLLOW,
+                             (uint8_t)(cursor >> 24), (uint8_t)(cursor >> 16),
+                             (uint8_t)(cursor >> 8), (uint8_t)cursor };
+
+    return gpmcu_serial_send(fd, data, sizeof(data));
+}
+
+static uint32_t _be32(const uint8_t * p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void _print_help() {
+    LOG_RAW("log_follow - tail the gpmcu memory log (application code)");
+    LOG_RAW("\t -p <port:baud> : serial port (default %s)", DEFAULT_PORT);
+    LOG_RAW("\t -c <counter>   : start at log counter (default 0 = oldest available)");
+    LOG_RAW("\t -i <ms>        : poll interval when the log is idle (default 50)");
+    LOG_RAW("\t -n             : dump the current log and exit");
+    LOG_RAW("\t -h             : Print this");
+    exit(0);
+}
+
+int main(int argc,
+         char ** argv) {
+    char params[MAX_PARAM_LEN + 1] = DEFAULT_PORT;
+    uint32_t cursor = 0;
+    int interval_ms = 50;
+    bool follow = true;
+    int c;
+
+    logger_init();
+
+    while ((c = getopt(argc, argv, "p:c:i:nh")) != -1) {
+        switch (c) {
+            case 'p':
+                strncpy(params, optarg, MAX_PARAM_LEN);
+                break;
+            case 'c':
+                cursor = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                interval_ms = atoi(optarg);
+                break;
+            case 'n':
+                follow = false;
+                break;
+            case 'h':
+            default:
+                _print_help();
+        }
+    }
+
+    int fd = gpmcu_serial_open(params);
+    if (fd < 0)
+        return 1;
+
+    signal(SIGINT, _sigint_handler);
+
+    uint8_t msg[MAX_FRAME_SIZE];
+    unsigned long lost = 0;
+    unsigned long received = 0;
+
+    while (_running) {
+        if (_send_request(fd, cursor) < 0) {
+            LOG_ERROR("Failed to write to serial");
+            break;
+        }
+
+        int len = gpmcu_serial_read(fd, msg, sizeof(msg));
+        if (len < 0) {
+            usleep(interval_ms * 1000);
+            continue;
+        }
+        if ((len < 2) || (msg[0] != GPMCU_ADDRESS)) {
+            continue;
+        }
+        if (msg[1] == COMM_CMD_NACK) {
+            LOG_ERROR("Log follow not supported or memory log not initialised (nack %d)",
+                      len > 2 ? msg[2] : -1);
+            break;
+        }
+        if ((msg[1] != CMD_READ_ARRAY) || (len < 2 + LOGFOLLOW_HEADER_SIZE)) {
+            continue;
+        }
+
+        const uint8_t * data = &msg[2];
+        uint32_t head = _be32(data);
+        uint8_t records = data[4];
+        int pos = LOGFOLLOW_HEADER_SIZE;
+
+        if (head < cursor) {
+            LOG_WARN("--- gpmcu log restarted (head %u < cursor %u) ---", head, cursor);
+        }
+
+        for (uint8_t r = 0; r < records; r++) {
+            if (2 + pos + LOGFOLLOW_RECORD_HDR > len)
+                break;
+            uint32_t counter = _be32(&data[pos]);
+            uint8_t text_len = data[pos + 4];
+            if (2 + pos + LOGFOLLOW_RECORD_HDR + text_len > len)
+                break;
+
+            if ((counter > cursor) && (received || cursor)) {
+                lost += counter - cursor;
+                LOG_WARN("--- %u entries lost ---", counter - cursor);
+            }
+            printf("%u : %.*s\n", counter, text_len, (const char *)&data[pos + LOGFOLLOW_RECORD_HDR]);
+            cursor = counter + 1;
+            received++;
+            pos += LOGFOLLOW_RECORD_HDR + text_len;
+        }
+        fflush(stdout);
+
+        if (records == 0) {
+            cursor = head; // also resyncs after a restart without new entries
+            if (!follow)
+                break;
+            usleep(interval_ms * 1000);
+        }
+    }
+
+    LOG_INFO("Received %lu entries, %lu lost", received, lost);
+    close(fd);
+    return 0;
+}
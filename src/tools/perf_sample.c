@@ -0,0 +1,346 @@
+/**
+ * @file perf_sample.c
+ * @brief  Sample the gpmcu PerfCounters and print rates
+ *
+ * Reads the PerfCounters block (CMD_ID_PERFCOUNTERS array read) over the
+ * MainCPU protocol every interval and prints the counters as events per
+ * second, computed from the difference with the previous sample. The
+ * counters are free running u32's, wrapping is handled by the unsigned
+ * subtraction. Maxima (loop time, SPI queue high-water) are printed as is.
+ *
+ * With -l the per-task superloop statistics (CMD_ID_LOOPSTATS) are printed
+ * instead: count, min/mean/max in us and the log2 cycle histogram.
+ *
+ * @version v0.1
+ * @date 2022-10-07
+ */
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "gpmcu_serial.h"
+
+#define MAX_PARAM_LEN       128
+#define MAX_FRAME_SIZE      256
+
+#define CMD_ID_PERFCOUNTERS 0x60 // array read identifier
+#define PERF_CLEAR_REGISTER 0x60 // byte write identifier
+#define CMD_ID_LOOPSTATS    0x61 // array read identifier, offset = task
+#define LOOPSTATS_RESET     0x70 // byte write identifier
+#define LOOPSTATS_BUCKETS   20
+
+/* PerfCounters_t in src/application/data_map.h, same order */
+static const struct {
+    const char * name;
+    bool rate;  // counter: print per second, otherwise a maximum
+} _counters[] = {
+    { "loops",       true  },
+    { "loop_max_us", false },
+    { "ovr_main",    true  },
+    { "ovr_gowin",   true  },
+    { "ovr_cpu2",    true  },
+    { "crc_err",     true  },
+    { "gw_nack",     true  },
+    { "gw_tmo",      true  },
+    { "spi_hw",      false },
+    { "i2c_err",     true  },
+    { "sleeps",      true  },
+    { "gw_drop",     true  },
+    { "gw_coal",     true  },
+    { "gw_skip",     true  },
+    { "i2c_pf_hit",  true  },
+    { "spi_rd_us",   false },
+    { "spi_pp_us",   false },
+    { "spi_er_us",   false },
+    { "spi_polls",   true  },
+    { "spi_ovf",     true  },
+    { "spi_wait_us", false },
+    { "spi_merge",   true  },
+    { "mux_switch",  true  },
+    { "mux_lease",   true  },
+    { "mux_hold_us", false },
+    { "mux_tmo",     true  },
+    { "mux_revoke",  true  },
+    { "spi_c_hit",   true  },
+    { "spi_c_miss",  true  },
+    { "gw_rt_drop",  true  },
+};
+
+#define NR_OF_COUNTERS (sizeof(_counters) / sizeof(_counters[0]))
+
+/* LoopTask_t in src/application/data_map.h, same order */
+static const char * _tasks[] = {
+    "comm", "comm_handler", "cpu2", "gowin", "gowin_handler", "i2c", "spi", "gpio", "timer",
+    "spi_update", "i2c_stream", "iteration",
+};
+
+#define NR_OF_TASKS (sizeof(_tasks) / sizeof(_tasks[0]))
+#define LOOPSTATS_ENTRY_SIZE (4 * 4 + 8 + LOOPSTATS_BUCKETS * 4) // LoopStatsEntry_t
+
+static volatile bool _running = true;
+
+static void _sigint_handler(int sig) {
+    (void)sig;
+    _running = false;
+}
+
+static double _now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t _le32(const uint8_t * p) {
+    return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[1] << 8) | (uint32_t)p[0];
+}
+
+/**
+ * @brief  Read the PerfCounters block
+ *
+ * @returns  0 on success, -1 on timeout or NACK
+ */
+static int _read_counters(int fd,
+                          uint32_t * values) {
+    const uint8_t request[] = { GPMCU_ADDRESS, CMD_READ_ARRAY, CMD_ID_PERFCOUNTERS, 0,
+                                NR_OF_COUNTERS * sizeof(uint32_t) };
+    uint8_t msg[MAX_FRAME_SIZE];
+
+    if (gpmcu_serial_send(fd, request, sizeof(request)) < 0) {
+        LOG_ERROR("Failed to write to serial");
+        return -1;
+    }
+
+    int len = gpmcu_serial_read(fd, msg, sizeof(msg));
+    if (len < 0)
+        return -1;
+    if ((msg[0] != GPMCU_ADDRESS) || (msg[1] != CMD_READ_ARRAY) ||
+        (len < (int)(2 + NR_OF_COUNTERS * sizeof(uint32_t)))) {
+        LOG_ERROR("PerfCounters not supported by this application (reply length %d)", len);
+        return -1;
+    }
+
+    for (size_t i = 0; i < NR_OF_COUNTERS; i++) {
+        values[i] = _le32(&msg[2 + i * sizeof(uint32_t)]);
+    }
+    return 0;
+}
+
+/**
+ * @brief  Read one LoopStats array item, offset = task or NR_OF_TASKS (trailer)
+ *
+ * @returns  data length, -1 on timeout or NACK
+ */
+static int _read_loopstats(int fd,
+                           uint8_t offset,
+                           uint8_t length,
+                           uint8_t * data) {
+    const uint8_t request[] = { GPMCU_ADDRESS, CMD_READ_ARRAY, CMD_ID_LOOPSTATS, offset, length };
+    uint8_t msg[MAX_FRAME_SIZE];
+
+    if (gpmcu_serial_send(fd, request, sizeof(request)) < 0)
+        return -1;
+
+    int len = gpmcu_serial_read(fd, msg, sizeof(msg));
+    if ((len < 2 + length) || (msg[0] != GPMCU_ADDRESS) || (msg[1] != CMD_READ_ARRAY)) {
+        LOG_ERROR("LoopStats not supported by this application (reply length %d)", len);
+        return -1;
+    }
+    memcpy(data, &msg[2], length);
+    return length;
+}
+
+static int _print_loopstats(int fd) {
+    uint8_t data[MAX_FRAME_SIZE];
+
+    if (_read_loopstats(fd, NR_OF_TASKS, 5, data) < 0)
+        return -1;
+    double cycles_per_us = (double)_le32(data) / 1e6;
+    if (cycles_per_us <= 0.0)
+        cycles_per_us = 1.0;
+    LOG_RAW("LoopStats: core %.0f MHz, tasks timed 1/%u iterations", cycles_per_us, 1u << data[4]);
+    printf("%-14s %10s %10s %10s %10s  histogram [2^n cycles]=count\n",
+           "task", "count", "min_us", "mean_us", "max_us");
+
+    for (uint8_t t = 0; t < NR_OF_TASKS; t++) {
+        if (_read_loopstats(fd, t, LOOPSTATS_ENTRY_SIZE, data) < 0)
+            return -1;
+        uint32_t count = _le32(&data[0]);
+        uint32_t min = count ? _le32(&data[4]) : 0;
+        printf("%-14s %10u %10.2f %10.2f %10.2f ", _tasks[t], count,
+               min / cycles_per_us, _le32(&data[12]) / cycles_per_us,
+               _le32(&data[8]) / cycles_per_us);
+        for (int b = 0; b < LOOPSTATS_BUCKETS; b++) {
+            uint32_t hits = _le32(&data[24 + b * 4]);
+            if (hits)
+                printf(" [%d]=%u", b, hits);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+static int _write_byte(int fd,
+                       uint8_t reg) {
+    const uint8_t request[] = { GPMCU_ADDRESS, CMD_WRITE_BYTE, reg, 0 };
+    uint8_t msg[MAX_FRAME_SIZE];
+
+    if (gpmcu_serial_send(fd, request, sizeof(request)) < 0)
+        return -1;
+
+    int len = gpmcu_serial_read(fd, msg, sizeof(msg));
+    if ((len < 3) || (msg[1] != CMD_WRITE_BYTE) || (msg[2] != COMM_REPLY_ACK))
+        return -1;
+    return 0;
+}
+
+static int _clear_counters(int fd) {
+    return _write_byte(fd, PERF_CLEAR_REGISTER);
+}
+
+static void _print_header(void) {
+    printf("%8s", "time");
+    for (size_t i = 0; i < NR_OF_COUNTERS; i++) {
+        char label[24];
+        snprintf(label, sizeof(label), "%s%s", _counters[i].name, _counters[i].rate ? "/s" : "");
+        printf(" %12s", label);
+    }
+    printf("\n");
+}
+
+static void _print_totals(const uint32_t * values) {
+    LOG_RAW("PerfCounters:");
+    for (size_t i = 0; i < NR_OF_COUNTERS; i++) {
+        LOG_RAW("\t%-12s %u", _counters[i].name, values[i]);
+    }
+}
+
+static void _print_help() {
+    LOG_RAW("perf_sample - sample the gpmcu PerfCounters (application code)");
+    LOG_RAW("\t -p <port:baud> : serial port (default %s)", GPMCU_DEFAULT_PORT);
+    LOG_RAW("\t -i <ms>        : sample interval (default 1000)");
+    LOG_RAW("\t -n <samples>   : stop after n rate samples (default 0 = ctrl-c)");
+    LOG_RAW("\t -c             : clear the counters first");
+    LOG_RAW("\t -t             : print the totals once and exit");
+    LOG_RAW("\t -l             : print the per-task loop statistics and exit (-c resets them)");
+    LOG_RAW("\t -h             : Print this");
+    exit(0);
+}
+
+int main(int argc,
+         char ** argv) {
+    char params[MAX_PARAM_LEN + 1] = GPMCU_DEFAULT_PORT;
+    int interval_ms = 1000;
+    long samples = 0;
+    bool clear = false;
+    bool totals = false;
+    bool loopstats = false;
+    int c;
+
+    logger_init();
+
+    while ((c = getopt(argc, argv, "p:i:n:ctlh")) != -1) {
+        switch (c) {
+            case 'p':
+                strncpy(params, optarg, MAX_PARAM_LEN);
+                break;
+            case 'i':
+                interval_ms = atoi(optarg);
+                break;
+            case 'n':
+                samples = atol(optarg);
+                break;
+            case 'c':
+                clear = true;
+                break;
+            case 't':
+                totals = true;
+                break;
+            case 'l':
+                loopstats = true;
+                break;
+            case 'h':
+            default:
+                _print_help();
+        }
+    }
+    if (interval_ms <= 0)
+        interval_ms = 1000;
+
+    int fd = gpmcu_serial_open(params);
+    if (fd < 0)
+        return 1;
+
+    signal(SIGINT, _sigint_handler);
+
+    if (loopstats) {
+        int ret = _print_loopstats(fd);
+        if ((ret == 0) && clear && (_write_byte(fd, LOOPSTATS_RESET) < 0)) {
+            LOG_ERROR("Failed to reset the LoopStats");
+            ret = -1;
+        }
+        close(fd);
+        return (ret < 0) ? 1 : 0;
+    }
+
+    if (clear && (_clear_counters(fd) < 0)) {
+        LOG_ERROR("Failed to clear the PerfCounters");
+        close(fd);
+        return 1;
+    }
+
+    uint32_t prev[NR_OF_COUNTERS];
+    uint32_t curr[NR_OF_COUNTERS];
+    double t_prev = _now();
+    double t_start = t_prev;
+
+    if (_read_counters(fd, prev) < 0) {
+        close(fd);
+        return 1;
+    }
+    if (totals) {
+        _print_totals(prev);
+        close(fd);
+        return 0;
+    }
+
+    _print_header();
+    for (long n = 0; _running && ((samples == 0) || (n < samples)); ) {
+        usleep(interval_ms * 1000);
+        if (!_running)
+            break;
+
+        if (_read_counters(fd, curr) < 0) {
+            LOG_WARN("No reply, retrying");
+            continue;
+        }
+        double t_curr = _now();
+        double dt = t_curr - t_prev;
+
+        printf("%8.1f", t_curr - t_start);
+        for (size_t i = 0; i < NR_OF_COUNTERS; i++) {
+            if (_counters[i].rate)
+                printf(" %12.1f", (double)(uint32_t)(curr[i] - prev[i]) / dt);
+            else
+                printf(" %12u", curr[i]);
+        }
+        printf("\n");
+        fflush(stdout);
+
+        memcpy(prev, curr, sizeof(prev));
+        t_prev = t_curr;
+        n++;
+    }
+
+    _print_totals(prev);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file clock_config.c
+ * @brief  Native stand-in of boards/zeus300s/clock_config.c
+ *
+ * The clock tree is not modelled: a configuration only sets
+ * SystemCoreClock, the flexcomms and the watchdog run from the fixed
+ * frequencies of CLOCK_GetFreq (fsl_common.c). The watchdog setup is the
+ * board's own.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include "clock_config.h"
+
+#include "fsl_clock.h"
+#include "fsl_wwdt.h"
+
+#include "logger.h"
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+/**< System clock frequency. */
+extern uint32_t SystemCoreClock;
+bool g_Verbose;
+
+/*******************************************************************************
+ * Code for BOARD_AppInitClocks
+ ******************************************************************************/
+void BOARD_AppInitClocks(enum bootClock Clk, bool verbose) {
+    g_Verbose = verbose;
+    switch (Clk) {
+        case FRO12:
+            SystemCoreClock = BOARD_BOOTCLOCKFRO12M_CORE_CLOCK;
+            break;
+        case FRO96:
+            SystemCoreClock = BOARD_BOOTCLOCKFROHF96M_CORE_CLOCK;
+            break;
+        case PLL100:
+            SystemCoreClock = BOARD_BOOTCLOCKPLL100M_CORE_CLOCK;
+            break;
+        case PLL150:
+        default:
+            SystemCoreClock = BOARD_BOOTCLOCKPLL150M_CORE_CLOCK;
+            break;
+    }
+    if (g_Verbose)
+        LOG_DEBUG("SystemCoreClock %u Hz", SystemCoreClock);
+}
+
+/*******************************************************************************
+ * Code for BOARD_BootInitClocks configuration
+ ******************************************************************************/
+void BOARD_BootInitClocks(void) {
+    SystemCoreClock = BOARD_BOOTCLOCKFROHF96M_CORE_CLOCK;
+}
+
+/*******************************************************************************
+ * Code for BOARD_WWDT_init configuration
+ ******************************************************************************/
+void BOARD_WWDT_init(wwdt_config_t * config) {
+    uint32_t wdtFreq;
+
+    /* Check if reset is due to Watchdog */
+    if (WWDT_GetStatusFlags(WWDT) & kWWDT_TimeoutFlag) {
+        LOG_WARN("Watchdog reset occurred");
+        /* The timeout flag can only clear when and after wwdt intial. */
+    }
+    wdtFreq = CLOCK_GetWdtClkFreq() / 4;
+
+    WWDT_GetDefaultConfig(config);
+    /*
+     * Set watchdog feed time constant to approximately 4s
+     * Set watchdog warning time to 512 ticks after feed time constant
+     * Set watchdog window time disabled
+     */
+    config->timeoutValue = wdtFreq * 4;
+    config->warningValue = 512;
+    config->windowValue = 0xffffff;
+    /* Configure WWDT to go to IRQ on timeout , instead of reset */
+    config->enableWatchdogReset = false;
+    /* Setup watchdog clock frequency(Hz). */
+    config->clockFreq_Hz = CLOCK_GetWdtClkFreq();
+
+    WWDT_Init(WWDT, config);
+
+    NVIC_EnableIRQ(WDT_BOD_IRQn);
+}
+
+/*******************************************************************************
+ * Code for BOARD_WWDT disable
+ ******************************************************************************/
+void BOARD_WWDT_deinit() {
+    NVIC_DisableIRQ(WDT_BOD_IRQn);
+    WWDT_Deinit(WWDT);
+}
+
+void BOARD_WWDT_disable(wwdt_config_t * config) {
+    config->enableWwdt = false;
+    WWDT_Init(WWDT, config);
+}
+
+void BOARD_WWDT_enable(wwdt_config_t * config) {
+    config->enableWwdt = true;
+    WWDT_Init(WWDT, config);
+}
@@ -0,0 +1,244 @@
+/**
+ * @file gowin_peer.c
+ * @brief  The simulated Gowin FPGA (tests/native/hal/sim_gowin.c) for
+ *         gpmcu_native, on the wall clock
+ *
+ * Listens on a unix stream socket, serves one gpmcu_native --gowin
+ * unix:<path> until it disconnects (or SIGINT) and prints what the
+ * firmware asked for: requests per command, commands/s and the request
+ * interval and firmware turnaround (last reply byte out -> next request
+ * complete) percentiles. gpmcu_native paces its bytes at the baud rate, the
+ * replies here are paced by sim_gowin.
+ *
+ *   gowin_peer --listen <path> [--delay-us n] [--jitter-us n] [--nack n]
+ *              [--garbage n] [--silent n] [--seed n] [--wake-up-ms n]
+ * faults per mille, --wake-up-ms: an FPGA reload every n ms
+ *
+ * @version v0.1
+ * @date 2022-10-19
+ */
+
+#define _GNU_SOURCE // ppoll
+
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim_gowin.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define SAMPLES_MAX 1000000     // !< intervals kept for the percentiles
+#define MS_NS       1000000ULL
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static volatile sig_atomic_t _stop;
+
+static uint64_t * _interval;    // !< request to request
+static uint64_t * _turnaround;  // !< last reply byte to the next request
+static uint32_t _samples;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+static uint64_t _now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void _on_signal(int sig) {
+    (void)sig;
+    _stop = 1;
+}
+
+static int _listen(const char * path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if ((fd < 0) || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 1)) {
+        perror(path);
+        exit(1);
+    }
+    return fd;
+}
+
+static int _cmp(const void * a,
+                const void * b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void _percentiles(const char * name,
+                         uint64_t * samples,
+                         uint32_t count) {
+    if (!count)
+        return;
+    qsort(samples, count, sizeof(uint64_t), _cmp);
+    printf("  %-10s p50 %8.2f ms  p90 %8.2f  p99 %8.2f  p99.9 %8.2f  max %8.2f\n", name,
+           samples[(uint32_t)(0.50 * (count - 1) + 0.5)] / 1e6,
+           samples[(uint32_t)(0.90 * (count - 1) + 0.5)] / 1e6,
+           samples[(uint32_t)(0.99 * (count - 1) + 0.5)] / 1e6,
+           samples[(uint32_t)(0.999 * (count - 1) + 0.5)] / 1e6,
+           samples[count - 1] / 1e6);
+}
+
+static void _report(uint64_t first,
+                    uint64_t last) {
+    const struct sim_gowin_stats_t * stats = sim_gowin_stats();
+    double s = (last > first) ? (double)(last - first) / 1e9 : 0;
+
+    printf("%u requests", stats->requests);
+    if (s > 0)
+        printf(" in %.2f s: %.1f commands/s", s, (stats->requests - 1) / s);
+    printf(", GPMCU tx %lu rx %lu bytes\n", (unsigned long)stats->bytes_rx,
+           (unsigned long)stats->bytes_tx);
+    for (int cmd = 0; cmd < 128; cmd++)
+        if (stats->per_cmd[cmd])
+            printf("  '%c' %u\n", (cmd > 0x20) ? cmd : '?', stats->per_cmd[cmd]);
+    printf("  %u acks, %u nacks (%u injected), %u garbage, %u silent, %u wake ups, %u stray\n",
+           stats->acks, stats->nacks, stats->injected_nacks, stats->garbage, stats->silent,
+           stats->wake_ups, stats->stray);
+    _percentiles("interval", _interval, _samples);
+    _percentiles("turnaround", _turnaround, _samples);
+}
+
+static void _usage(const char * argv0) {
+    fprintf(stderr,
+            "usage: %s --listen <path> [--delay-us n] [--jitter-us n] [--nack n]\n"
+            "          [--garbage n] [--silent n] [--seed n] [--wake-up-ms n]\n"
+            "faults per mille\n", argv0);
+}
+
+int main(int argc,
+         char ** argv) {
+    static const struct option options[] = {
+        { "listen",     required_argument, NULL, 'l' },
+        { "delay-us",   required_argument, NULL, 'd' },
+        { "jitter-us",  required_argument, NULL, 'j' },
+        { "nack",       required_argument, NULL, 'n' },
+        { "garbage",    required_argument, NULL, 'g' },
+        { "silent",     required_argument, NULL, 's' },
+        { "seed",       required_argument, NULL, 'r' },
+        { "wake-up-ms", required_argument, NULL, 'w' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL,         0,                 NULL, 0   },
+    };
+    struct sim_gowin_config_t config = { 0 };
+    const char * path = NULL;
+    uint64_t wake_up_ns = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 'l': path = optarg; break;
+            case 'd': config.delay_ns = strtoull(optarg, NULL, 0) * 1000; break;
+            case 'j': config.jitter_ns = strtoull(optarg, NULL, 0) * 1000; break;
+            case 'n': config.nack_permille = (uint16_t)atoi(optarg); break;
+            case 'g': config.garbage_permille = (uint16_t)atoi(optarg); break;
+            case 's': config.silent_permille = (uint16_t)atoi(optarg); break;
+            case 'r': config.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'w': wake_up_ns = strtoull(optarg, NULL, 0) * MS_NS; break;
+            default:
+                _usage(argv[0]);
+                return (opt == 'h') ? 0 : 1;
+        }
+    }
+    if (!path) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    _interval = malloc(SAMPLES_MAX * sizeof(uint64_t));
+    _turnaround = malloc(SAMPLES_MAX * sizeof(uint64_t));
+    signal(SIGINT, _on_signal);
+    signal(SIGTERM, _on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    int server = _listen(path);
+
+    printf("listening on %s\n", path);
+    int fd = accept(server, NULL, NULL);
+
+    if (fd < 0) {
+        perror("accept");
+        return 1;
+    }
+    sim_gowin_init(&config);
+
+    uint64_t first = 0, last = 0, reply_done = 0;
+    uint64_t next_wake_up = wake_up_ns ? _now_ns() + wake_up_ns : SIM_GOWIN_NEVER;
+
+    while (!_stop) {
+        uint64_t now = _now_ns();
+        uint64_t next = sim_gowin_next_ns();
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        uint8_t buf[256];
+
+        if (next_wake_up < next)
+            next = next_wake_up;
+        uint64_t wait = (next == SIM_GOWIN_NEVER) ? 100 * MS_NS : (next > now) ? next - now : 0;
+        struct timespec ts = { (time_t)(wait / 1000000000ULL), (long)(wait % 1000000000ULL) };
+
+        // sleep to the next reply byte, a spinning peer starves the firmware on one cpu
+        if (ppoll(&pfd, 1, &ts, NULL) < 0)
+            continue; // EINTR
+        now = _now_ns();
+
+        if (pfd.revents & (POLLIN | POLLHUP)) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+
+            if (n <= 0)
+                break;
+            for (ssize_t i = 0; i < n; i++) {
+                uint32_t requests = sim_gowin_stats()->requests;
+
+                sim_gowin_rx(buf[i], now);
+                if (sim_gowin_stats()->requests == requests)
+                    continue;
+                if (!first) {
+                    first = now;
+                } else if (_samples < SAMPLES_MAX) {
+                    _interval[_samples] = now - last;
+                    _turnaround[_samples] = (reply_done > last) ? now - reply_done : 0;
+                    _samples++;
+                }
+                last = now;
+            }
+        }
+
+        if (now >= next_wake_up) {
+            sim_gowin_wake_up(now);
+            next_wake_up = now + wake_up_ns;
+        }
+
+        size_t count = sim_gowin_tx(buf, sizeof(buf), now);
+
+        if (count) {
+            if (write(fd, buf, count) != (ssize_t)count)
+                break;
+            if (sim_gowin_next_ns() == SIM_GOWIN_NEVER)
+                reply_done = now;
+        }
+    }
+
+    _report(first, last);
+    close(fd);
+    close(server);
+    unlink(path);
+    return 0;
+}
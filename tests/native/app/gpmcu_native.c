@@ -0,0 +1,368 @@
+/**
+ * @file gpmcu_native.c
+ * @brief  The GPMCU application as a Linux process
+ *
+ * src/application/main.c runs unchanged (as app_main) on the native HAL
+ * (tests/native/hal) with the core started: the uarts, the i2c slaves, the
+ * spi flash and the watchdog raise their interrupts on the wall clock.
+ * The outside world:
+ *  - --maincpu, --gowin: FLEXCOMM0 (Zynq) and FLEXCOMM1 (Gowin) uarts, on
+ *    "pty" (the slave's name is printed), "unix:<path>" (connects to a
+ *    listening stream socket) or a file/tty path
+ *  - --i2c unix:<path>: an outside master on the FLEXCOMM4 i2c slave (the
+ *    Zynq's bus). Frames, lengths little endian:
+ *      request  'W' addr len16 data[len] | 'R' addr len16
+ *      reply    status count16 data[count] (reads)
+ *    status 0: ack, 1: address nack, 2: data nack, 3: other
+ *  - --spi-image, --flash-image: the IS25LP128 and the internal flash
+ *    contents, loaded at start when the file exists, saved on exit (also
+ *    SIGINT, SIGTERM)
+ * The USB hub and clock generator on FLEXCOMM5 acknowledge everything.
+ * The application exits (ResetISR, NVIC_SystemReset) where the part
+ * would reboot.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#define _GNU_SOURCE // posix_openpt, ptsname, cfmakeraw
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "fsl_common.h"
+#include "fsl_i2c.h"
+#include "fsl_iap.h"
+#include "fsl_usart.h"
+#include "hal_core.h"
+#include "hal_sim.h"
+#include "sim_is25lp128.h"
+
+#include "peripherals.h"
+
+#define SSRAM_SIZE          0x4000U
+#define I2C_BRIDGE_MAX      1024U
+#define I2C_USB5807C_ADDR   0x2D
+#define I2C_SI5341_ADDR     0x74
+
+int app_main(void);
+
+// !< __ssram_*__ of the link (CMakeLists.txt)
+uint8_t hal_ssram[SSRAM_SIZE] __attribute__((aligned(4)));
+
+static const char * SpiImage;
+static const char * FlashImage;
+
+/*******************************************************************************
+ * Board
+ ******************************************************************************/
+static const struct hal_i2c_device_t Usb5807c = { .address = I2C_USB5807C_ADDR };
+static const struct hal_i2c_device_t Si5341 = { .address = I2C_SI5341_ADDR };
+
+// !< startup.c: back to the bootloader, which is not here
+void ResetISR(void) {
+    fprintf(stderr, "ResetISR: exit\n");
+    exit(EXIT_SUCCESS);
+}
+
+// !< the usb hub masters of BOARD_BootInitPeripherals, not in the board files
+void BOARD_AppInitI2CMASTERPeripherals(void) {
+    i2c_master_config_t config;
+
+    RESET_PeripheralReset(kFC4_RST_SHIFT_RSTn);
+    RESET_PeripheralReset(kFC5_RST_SHIFT_RSTn);
+    I2C_MasterGetDefaultConfig(&config);
+    I2C_MasterInit(FLEXCOMM4_PERIPHERAL, &config, FLEXCOMM4_CLOCK_SOURCE);
+    I2C_MasterInit(FLEXCOMM5_PERIPHERAL, &config, FLEXCOMM5_CLOCK_SOURCE);
+}
+
+void BOARD_AppDeInitI2CMASTERPeripherals(void) {
+    I2C_MasterDeinit(FLEXCOMM4_PERIPHERAL);
+    I2C_MasterDeinit(FLEXCOMM5_PERIPHERAL);
+}
+
+/*******************************************************************************
+ * Endpoints
+ ******************************************************************************/
+static int _open_pty(const char * name) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    struct termios tio;
+
+    if ((fd < 0) || grantpt(fd) || unlockpt(fd))
+        return -1;
+
+    // raw, and the slave held open: no EIO before the peer opens it
+    int slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+
+    if ((slave >= 0) && !tcgetattr(slave, &tio)) {
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+    fprintf(stderr, "%s: %s\n", name, ptsname(fd));
+    return fd;
+}
+
+static int _open_unix(const char * path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0)
+        return -1;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int _open_endpoint(const char * name,
+                          const char * spec) {
+    int fd;
+
+    if (!strcmp(spec, "pty"))
+        fd = _open_pty(name);
+    else if (!strncmp(spec, "unix:", 5))
+        fd = _open_unix(spec + 5);
+    else
+        fd = open(spec, O_RDWR | O_NOCTTY);
+
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s: %s\n", name, spec, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+/*******************************************************************************
+ * i2c bridge
+ ******************************************************************************/
+struct i2c_bridge_t {
+    struct hal_source_t source;
+    int fd;
+    uint8_t rx[4 + I2C_BRIDGE_MAX];
+    size_t rx_len;
+    bool busy;
+    struct hal_i2c_bus_t xfer;
+    uint8_t data[I2C_BRIDGE_MAX];
+};
+
+static struct i2c_bridge_t Bridge = { .fd = -1 };
+
+static void _bridge_send(const void * data,
+                         size_t size) {
+    const uint8_t * p = data;
+
+    while (size) {
+        ssize_t n = write(Bridge.fd, p, size);
+
+        if ((n < 0) && (errno == EAGAIN))
+            continue;
+        if (n <= 0)
+            return;
+        p += n;
+        size -= (size_t)n;
+    }
+}
+
+static void _bridge_done(void * ctx,
+                         status_t status,
+                         size_t count) {
+    uint8_t reply[3];
+
+    (void)ctx;
+    reply[0] = (status == kStatus_Success) ? 0 :
+        (status == kStatus_I2C_Addr_Nak) ? 1 :
+        (status == kStatus_I2C_Nak) ? 2 : 3;
+    reply[1] = (uint8_t)count;
+    reply[2] = (uint8_t)(count >> 8);
+    _bridge_send(reply, sizeof(reply));
+    if (Bridge.xfer.read)
+        _bridge_send(Bridge.data, count);
+    Bridge.busy = false;
+}
+
+static void _bridge_poll(void * ctx,
+                         uint64_t now) {
+    (void)ctx;
+    (void)now;
+
+    if (Bridge.rx_len < sizeof(Bridge.rx)) {
+        ssize_t n = read(Bridge.fd, &Bridge.rx[Bridge.rx_len], sizeof(Bridge.rx) - Bridge.rx_len);
+
+        if (n == 0) {
+            fprintf(stderr, "i2c: peer closed\n");
+            exit(EXIT_SUCCESS);
+        }
+        if (n > 0)
+            Bridge.rx_len += (size_t)n;
+    }
+    if (Bridge.busy || (Bridge.rx_len < 4))
+        return;
+
+    bool read = (Bridge.rx[0] == 'R');
+    size_t len = Bridge.rx[2] | ((size_t)Bridge.rx[3] << 8);
+    size_t frame = 4 + (read ? 0 : len);
+
+    if (((Bridge.rx[0] != 'R') && (Bridge.rx[0] != 'W')) || (len > I2C_BRIDGE_MAX)) {
+        fprintf(stderr, "i2c: bad frame\n");
+        exit(EXIT_FAILURE);
+    }
+    if (Bridge.rx_len < frame)
+        return;
+
+    Bridge.xfer = (struct hal_i2c_bus_t) {
+        .address = Bridge.rx[1],
+        .read = read,
+        .data = Bridge.data,
+        .size = len,
+        .done = _bridge_done,
+    };
+    if (!read)
+        memcpy(Bridge.data, &Bridge.rx[4], len);
+    memmove(Bridge.rx, &Bridge.rx[frame], Bridge.rx_len - frame);
+    Bridge.rx_len -= frame;
+    Bridge.busy = true;
+    hal_i2c_bus_transfer(FLEXCOMM4_PERIPHERAL, &Bridge.xfer);
+}
+
+static int _bridge_fd(void * ctx) {
+    (void)ctx;
+    return Bridge.fd;
+}
+
+static void _bridge_open(const char * spec) {
+    Bridge.fd = _open_endpoint("i2c", spec);
+    fcntl(Bridge.fd, F_SETFL, fcntl(Bridge.fd, F_GETFL) | O_NONBLOCK);
+    Bridge.source = (struct hal_source_t) {
+        .irq = -1,
+        .poll = _bridge_poll,
+        .fd = _bridge_fd,
+    };
+    hal_core_attach(&Bridge.source);
+}
+
+/*******************************************************************************
+ * Images
+ ******************************************************************************/
+static void _image_load(const char * path,
+                        uint8_t * mem,
+                        size_t size) {
+    FILE * f = path ? fopen(path, "rb") : NULL;
+
+    if (!f)
+        return;
+    if (fread(mem, 1, size, f) != size)
+        fprintf(stderr, "%s: short image, the rest stays erased\n", path);
+    fclose(f);
+}
+
+// !< open/write: also from the signal handler
+static void _image_save(const char * path,
+                        const uint8_t * mem,
+                        size_t size) {
+    int fd = path ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+
+    if (fd < 0)
+        return;
+    while (size) {
+        ssize_t n = write(fd, mem, size);
+
+        if (n <= 0)
+            break;
+        mem += n;
+        size -= (size_t)n;
+    }
+    close(fd);
+}
+
+static void _images_save(void) {
+    _image_save(SpiImage, sim_is25lp128_memory(), SIM_IS25_SIZE);
+    _image_save(FlashImage, hal_flash, HAL_FLASH_SIZE);
+}
+
+static void _on_signal(int sig) {
+    (void)sig;
+    _images_save();
+    _exit(EXIT_SUCCESS);
+}
+
+/*******************************************************************************
+ * Main
+ ******************************************************************************/
+static void _usage(const char * argv0) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --maincpu <ep>       FLEXCOMM0 uart to the Zynq\n"
+            "  --gowin <ep>         FLEXCOMM1 uart to the Gowin\n"
+            "  --i2c <ep>           outside master on the FLEXCOMM4 i2c slave\n"
+            "  --spi-image <file>   IS25LP128 contents, saved on exit\n"
+            "  --flash-image <file> internal flash contents, saved on exit\n"
+            "<ep>: pty | unix:<path> | <path>\n", argv0);
+}
+
+int main(int argc,
+         char ** argv) {
+    static const struct option options[] = {
+        { "maincpu",     required_argument, NULL, 'm' },
+        { "gowin",       required_argument, NULL, 'g' },
+        { "i2c",         required_argument, NULL, 'i' },
+        { "spi-image",   required_argument, NULL, 's' },
+        { "flash-image", required_argument, NULL, 'f' },
+        { "help",        no_argument,       NULL, 'h' },
+        { NULL,          0,                 NULL, 0   },
+    };
+    const char * maincpu = NULL;
+    const char * gowin = NULL;
+    const char * i2c = NULL;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'm': maincpu = optarg;
+                break;
+            case 'g': gowin = optarg;
+                break;
+            case 'i': i2c = optarg;
+                break;
+            case 's': SpiImage = optarg;
+                break;
+            case 'f': FlashImage = optarg;
+                break;
+            default:
+                _usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    hal_sim_reset();
+    sim_is25lp128_init(NULL);
+    _image_load(SpiImage, sim_is25lp128_memory(), SIM_IS25_SIZE);
+    _image_load(FlashImage, hal_flash, HAL_FLASH_SIZE);
+    atexit(_images_save);
+    signal(SIGINT, _on_signal);
+    signal(SIGTERM, _on_signal);
+
+    hal_i2c_attach(FLEXCOMM5_PERIPHERAL, &Usb5807c);
+    hal_i2c_attach(FLEXCOMM5_PERIPHERAL, &Si5341);
+    if (maincpu)
+        hal_usart_attach(FLEXCOMM0_PERIPHERAL, _open_endpoint("maincpu", maincpu));
+    if (gowin)
+        hal_usart_attach(FLEXCOMM1_PERIPHERAL, _open_endpoint("gowin", gowin));
+    if (i2c)
+        _bridge_open(i2c);
+
+    hal_realtime(true);
+    hal_core_start();
+    return app_main();
+}
@@ -0,0 +1,276 @@
+/**
+ * @file i2c_scenario.c
+ * @brief  gpmcu_native i2c scenario: spi flash pages through the 0x60
+ *         gateway and the 0x61 readback, as flash_tool and i2cdump do
+ *
+ * Starts gpmcu_native with --i2c on a socket it listens on and an spi image
+ * of known pages, then, as the Zynq's i2c master:
+ *  - 0x61 page mode [0xFF, 1], the first write after i2c_slave_setup
+ *  - a READ in two writes on 0x60: [0x50, 0x03] then the page [hi, lo]
+ *  - a READ in one write (flash_tool): [0x50, 0x03, hi, lo]
+ * and reads the page back on 0x61 until it is there or SCENARIO_PAGE_MS
+ * passed. Every transaction after the first must be acknowledged.
+ *
+ *   i2c_scenario <path to gpmcu_native>
+ * exit 0: passed
+ *
+ * @version v0.1
+ * @date 2022-10-19
+ */
+
+#define _GNU_SOURCE // mkdtemp
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define ADDR_GPMCU        0x60
+#define ADDR_PAGE         0x61
+#define PAGE_SIZE         256
+#define IMAGE_PAGES       16
+#define SCENARIO_BOOT_MS  10000   // !< gpmcu_native up to the i2c slave setup
+#define SCENARIO_PAGE_MS  2000    // !< a READ until the page is on 0x61
+#define RETRY_MS          10
+
+enum { STATUS_ACK, STATUS_ADDR_NACK, STATUS_DATA_NACK, STATUS_OTHER };
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static int _fd = -1;
+static char _dir[] = "/tmp/i2c_scenario.XXXXXX";
+static char _sock[sizeof(_dir) + 16];
+static char _image[sizeof(_dir) + 16];
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+static uint64_t _now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static void _sleep_ms(unsigned ms) {
+    struct timespec ts = { (time_t)(ms / 1000U), (long)(ms % 1000U) * 1000000L };
+
+    nanosleep(&ts, NULL);
+}
+
+static uint8_t _pattern(unsigned page,
+                        unsigned i) {
+    return (uint8_t)(page * 13U + i);
+}
+
+static bool _io(void * data,
+                size_t size,
+                bool rx) {
+    uint8_t * p = data;
+
+    while (size) {
+        ssize_t n = rx ? read(_fd, p, size) : write(_fd, p, size);
+
+        if ((n < 0) && (errno == EINTR))
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// !< one transaction through the gpmcu_native i2c bridge, returns the status
+static int _xfer(uint8_t address,
+                 bool read,
+                 uint8_t * data,
+                 uint16_t size,
+                 uint16_t * count) {
+    uint8_t request[4 + PAGE_SIZE] = { read ? 'R' : 'W', address, (uint8_t)size,
+                                       (uint8_t)(size >> 8) };
+    uint8_t reply[3];
+    size_t len = 4;
+
+    if (!read) {
+        memcpy(&request[4], data, size);
+        len += size;
+    }
+    if (!_io(request, len, false) || !_io(reply, sizeof(reply), true)) {
+        fprintf(stderr, "FAIL: gpmcu_native closed the i2c bridge\n");
+        exit(EXIT_FAILURE);
+    }
+    *count = (uint16_t)(reply[1] | (reply[2] << 8));
+    if (read && !_io(data, *count, true)) {
+        fprintf(stderr, "FAIL: gpmcu_native closed the i2c bridge\n");
+        exit(EXIT_FAILURE);
+    }
+    return reply[0];
+}
+
+static void _write(uint8_t address,
+                   const uint8_t * data,
+                   uint16_t size) {
+    uint8_t buf[PAGE_SIZE];
+    uint16_t count = 0;
+    int status;
+
+    memcpy(buf, data, size);
+    status = _xfer(address, false, buf, size, &count);
+    if ((status != STATUS_ACK) || (count != size)) {
+        fprintf(stderr, "FAIL: write 0x%02X: status %d, %u of %u bytes\n", address, status, count,
+                size);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// !< the first write: address NACKs while gpmcu_native boots
+static void _write_first(uint8_t address,
+                         const uint8_t * data,
+                         uint16_t size) {
+    uint64_t until = _now_ms() + SCENARIO_BOOT_MS;
+    uint8_t buf[PAGE_SIZE];
+    uint16_t count = 0;
+    int status;
+
+    for (;;) {
+        memcpy(buf, data, size);
+        status = _xfer(address, false, buf, size, &count);
+        if ((status != STATUS_ADDR_NACK) || (_now_ms() >= until))
+            break;
+        _sleep_ms(RETRY_MS);
+    }
+    if ((status != STATUS_ACK) || (count != size)) {
+        fprintf(stderr, "FAIL: first write 0x%02X: status %d, %u of %u bytes\n", address, status,
+                count, size);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// !< 0x61 until it holds page, as the host polls after a READ
+static void _expect_page(unsigned page) {
+    uint64_t until = _now_ms() + SCENARIO_PAGE_MS;
+    uint8_t data[PAGE_SIZE];
+    uint16_t count = 0;
+    unsigned i = 0;
+
+    do {
+        int status = _xfer(ADDR_PAGE, true, data, sizeof(data), &count);
+
+        if ((status != STATUS_ACK) || (count != sizeof(data))) {
+            fprintf(stderr, "FAIL: read 0x61: status %d, %u bytes\n", status, count);
+            exit(EXIT_FAILURE);
+        }
+        for (i = 0; (i < sizeof(data)) && (data[i] == _pattern(page, i)); i++)
+            ;
+        if (i == sizeof(data)) {
+            printf("page %u on 0x61\n", page);
+            return;
+        }
+        _sleep_ms(RETRY_MS);
+    } while (_now_ms() < until);
+
+    fprintf(stderr, "FAIL: 0x61 does not hold page %u: byte %u is 0x%02X, not 0x%02X\n", page, i,
+            data[i], _pattern(page, i));
+    exit(EXIT_FAILURE);
+}
+
+static void _image_create(void) {
+    FILE * f = fopen(_image, "wb");
+
+    if (!f) {
+        perror(_image);
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned page = 0; page < IMAGE_PAGES; page++)
+        for (unsigned i = 0; i < PAGE_SIZE; i++)
+            fputc(_pattern(page, i), f);
+    fclose(f);
+}
+
+static int _listen(void) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    strncpy(addr.sun_path, _sock, sizeof(addr.sun_path) - 1);
+    if ((fd < 0) || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 1)) {
+        perror(_sock);
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+static void _cleanup(void) {
+    unlink(_sock);
+    unlink(_image);
+    rmdir(_dir);
+}
+
+int main(int argc,
+         char ** argv) {
+    const uint8_t page_mode[] = { 0xFF, 0x01 };
+    const uint8_t read_cmd[] = { 0x50, 0x03 };
+    const uint8_t read_page5[] = { 0x00, 0x05 };
+    const uint8_t read_page9[] = { 0x50, 0x03, 0x00, 0x09 };
+    char endpoint[sizeof(_sock) + 8];
+    int status = 0;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <path to gpmcu_native>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!mkdtemp(_dir)) {
+        perror(_dir);
+        return EXIT_FAILURE;
+    }
+    snprintf(_sock, sizeof(_sock), "%s/i2c.sock", _dir);
+    snprintf(_image, sizeof(_image), "%s/spi.img", _dir);
+    snprintf(endpoint, sizeof(endpoint), "unix:%s", _sock);
+    atexit(_cleanup);
+    signal(SIGPIPE, SIG_IGN);
+    _image_create();
+
+    int server = _listen();
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        execl(argv[1], argv[1], "--i2c", endpoint, "--spi-image", _image, (char *)NULL);
+        perror(argv[1]);
+        _exit(EXIT_FAILURE);
+    }
+    _fd = accept(server, NULL, NULL);
+    close(server);
+    if (_fd < 0) {
+        perror("accept");
+        kill(pid, SIGTERM);
+        return EXIT_FAILURE;
+    }
+
+    _write_first(ADDR_PAGE, page_mode, sizeof(page_mode));
+    _write(ADDR_GPMCU, read_cmd, sizeof(read_cmd));
+    _write(ADDR_GPMCU, read_page5, sizeof(read_page5));
+    _expect_page(5);
+    _write(ADDR_GPMCU, read_page9, sizeof(read_page9));
+    _expect_page(9);
+
+    close(_fd); // gpmcu_native exits on a closed bridge
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) ||
+        (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        fprintf(stderr, "FAIL: gpmcu_native did not exit cleanly\n");
+        return EXIT_FAILURE;
+    }
+    printf("PASSED\n");
+    return EXIT_SUCCESS;
+}
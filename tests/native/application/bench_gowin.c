@@ -0,0 +1,248 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : bench_gowin.c  - native
+ * Author              : Barco
+ * created             : 19/10/2022
+ * Description         : gowin_protocol.c against the simulated Gowin FPGA
+ *                       (tests/native/hal/sim_gowin.c) over a 57600 baud
+ *                       wire: commands/sec and latency percentiles per
+ *                       command class, with reply delays, NACKs, garbage
+ *                       and lost replies (not a test, run by hand:
+ *                       bench_gowin [commands [delay_us [nack garbage
+ *                       silent]]], faults per mille)
+ * History:
+ * 19/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+#include "comm/gowin_protocol.h"
+#include "data_map.h"
+#include "sim_gowin.h"
+#include "timer_wheel.h"
+
+#define COMMANDS   10000
+#define CMD_MAX_NS (2ULL * 1000000000ULL)  // a command stuck this long ends the run
+#define MS_NS      1000000ULL
+
+u8 MCU_RXBUF[0]; // uart1 ring buffer - not in use for gowin
+u8 GOWIN_RXBUF[GOWIN_RXBUF_SIZE]; // UART2 ring buffer - raw data -> holds any incoming byte!
+
+volatile t_uart_data_raw UART_DATA[2] = { { (u8 *)&MCU_RXBUF,   MCU_RXBUF_SIZE,   (u8 *)&MCU_RXBUF,   (u8 *)&MCU_RXBUF   },
+                                          { (u8 *)&GOWIN_RXBUF, GOWIN_RXBUF_SIZE, (u8 *)&GOWIN_RXBUF, (u8 *)&GOWIN_RXBUF } };
+
+// the mix, one in flight: outputs ACKed, status reads, table writes/reads
+enum { CLASS_OUTPUT, CLASS_STATUS, CLASS_WRITE, CLASS_READ, CLASS_NUM };
+
+static const char * const _class_name[CLASS_NUM] = { "output", "status", "write", "read" };
+
+static const struct {
+    t_gowin_command cmd;
+    int cls;
+} _mix[] = {
+    { BACKLIGHT_ON,    CLASS_OUTPUT }, { PANEL_VOLTAGEHI, CLASS_OUTPUT },
+    { READ_BL_CURRENT, CLASS_STATUS }, { BACKLIGHT_OFF,   CLASS_OUTPUT },
+    { SET_STANDBY_ON,  CLASS_OUTPUT }, { READ_ETH_STATUS, CLASS_STATUS },
+    { SET_STANDBY_OFF, CLASS_OUTPUT }, { WRITE_EDID,      CLASS_WRITE  },
+    { READ_EDID,       CLASS_READ   }, { PANEL_VOLTAGELO, CLASS_OUTPUT },
+    { WRITE_DPCD,      CLASS_WRITE  }, { READ_DPCD,       CLASS_READ   },
+};
+
+#define MIX_SIZE (sizeof(_mix) / sizeof(_mix[0]))
+
+static uint64_t * _latency[CLASS_NUM];
+static uint32_t _count[CLASS_NUM];
+
+// the simulated time, the firmware's ms clock follows
+static uint64_t _now;
+static uint64_t _wire_free;    // GPMCU tx: the last byte's stop bit
+
+// ------------------------------------------------------------------------------
+static void _feed(u8 c) {
+    *((u8 *)UART_DATA[UART2].RxBufWr) = c;
+    UART_DATA[UART2].RxBufWr++;
+    if (UART_DATA[UART2].RxBufWr >= (UART_DATA[UART2].RxBuf + UART_DATA[UART2].RxBufSize))
+        UART_DATA[UART2].RxBufWr = UART_DATA[UART2].RxBuf; // reset write pointer
+}
+
+static void _advance(uint64_t ns) {
+    u32 ms = (u32)(ns / MS_NS - _now / MS_NS);
+
+    _now = ns;
+    while (ms--)
+        timer_fake_advance(1);
+}
+
+// the gowin tasks of tasks.c
+static void _tasks(void) {
+    for (int i = 0; i < 4; i++) {
+        if (GOWIN_Protocol(UART2) == GOWIN_RETURN_TIMEOUT)
+            GOWIN_Queue_Init();
+        GOWIN_DATA.MsgCount = 0; // replies are not handled further
+        if (!GOWIN_Busy())
+            break;
+    }
+}
+
+static bool _idle(void) {
+    return (GOWIN_Queue_size() == 0) && (GOWIN_Protocol_state_get() == GOWIN_WAIT_FOR_START) &&
+           !GOWIN_DATA.WaitForReply;
+}
+
+// ------------------------------------------------------------------------------
+// one command from queued to the firmware idle again, false: stuck
+static bool _command(t_gowin_command cmd) {
+    uint64_t start = _now;
+
+    switch (cmd) {
+        case WRITE_EDID: // a changed table, the shadow would skip it
+            Main.Edid.Edid1[0]++;
+            GOWIN_Protocol_edid_write(0);
+            break;
+        case WRITE_DPCD:
+            Main.Dpcd.Dpcd1[0]++;
+            GOWIN_Protocol_dpcd_write(0);
+            break;
+        case READ_EDID:
+            GOWIN_Protocol_edid_readback(2);
+            break;
+        case READ_DPCD:
+            GOWIN_Protocol_dpcd_readback(2);
+            break;
+        default:
+            GOWIN_Queue_Tx_Msg(cmd);
+            break;
+    }
+
+    for (;;) {
+        bool progress = false;
+        u8 c;
+
+        _tasks();
+
+        if ((_now >= _wire_free) && GOWIN_TX_fake_transmit(&c, 1)) {
+            _wire_free = _now + sim_gowin_byte_ns();
+            sim_gowin_rx(c, _wire_free);
+            progress = true;
+        }
+        while (sim_gowin_tx(&c, 1, _now)) {
+            _feed(c);
+            progress = true;
+        }
+        if (progress)
+            continue;
+        if (_idle())
+            return true;
+        if (_now - start > CMD_MAX_NS)
+            return false;
+
+        // next event: a tx byte slot, a reply byte, the next ms tick
+        uint64_t next = (_now / MS_NS + 1) * MS_NS;
+
+        if ((_wire_free > _now) && (_wire_free < next))
+            next = _wire_free;
+        if (sim_gowin_next_ns() < next)
+            next = sim_gowin_next_ns();
+        _advance(next);
+    }
+}
+
+static int _cmp(const void * a,
+                const void * b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double _pct(const uint64_t * sorted,
+                   uint32_t count,
+                   double pct) {
+    uint32_t i = (uint32_t)(pct / 100.0 * (count - 1) + 0.5);
+
+    return (double)sorted[i] / 1e6; // ms
+}
+
+// ------------------------------------------------------------------------------
+static void _run(const char * name,
+                 uint32_t commands,
+                 const struct sim_gowin_config_t * config) {
+    PerfCounters_t before;
+    uint64_t start;
+    uint32_t done = 0;
+
+    sim_gowin_init(config);
+    GOWIN_Queue_Init();
+    GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_START);
+    GOWIN_DATA.WaitForReply = false;
+    memcpy(&before, &Main.PerfCounters, sizeof(before));
+    memset(_count, 0, sizeof(_count));
+    start = _now;
+
+    for (uint32_t i = 0; i < commands; i++, done++) {
+        int cls = _mix[i % MIX_SIZE].cls;
+        uint64_t t0 = _now;
+
+        if (!_command(_mix[i % MIX_SIZE].cmd)) {
+            printf("  stuck on %s\n", returnCmdName(_mix[i % MIX_SIZE].cmd));
+            break;
+        }
+        _latency[cls][_count[cls]++] = _now - t0;
+    }
+
+    double s = (double)(_now - start) / 1e9;
+    const struct sim_gowin_stats_t * stats = sim_gowin_stats();
+
+    printf("%s: delay %lu+%lu us, faults nack %u garbage %u silent %u per mille\n", name,
+           (unsigned long)(config->delay_ns / 1000), (unsigned long)(config->jitter_ns / 1000),
+           config->nack_permille, config->garbage_permille, config->silent_permille);
+    printf("  %u commands in %.2f s: %.1f commands/s, GPMCU tx %lu rx %lu bytes\n", done, s,
+           done / s, (unsigned long)stats->bytes_rx, (unsigned long)stats->bytes_tx);
+    for (int cls = 0; cls < CLASS_NUM; cls++) {
+        if (!_count[cls])
+            continue;
+        qsort(_latency[cls], _count[cls], sizeof(uint64_t), _cmp);
+        printf("  %-7s %6u  p50 %8.2f ms  p90 %8.2f  p99 %8.2f  p99.9 %8.2f  max %8.2f\n",
+               _class_name[cls], _count[cls], _pct(_latency[cls], _count[cls], 50),
+               _pct(_latency[cls], _count[cls], 90),
+               _pct(_latency[cls], _count[cls], 99),
+               _pct(_latency[cls], _count[cls], 99.9),
+               (double)_latency[cls][_count[cls] - 1] / 1e6);
+    }
+    printf("  peer: %u requests, %u nacks (%u injected), %u garbage, %u silent, %u stray\n",
+           stats->requests, stats->nacks, stats->injected_nacks, stats->garbage, stats->silent,
+           stats->stray);
+    printf("  firmware: GowinNack %u GowinTimeout %u GowinCoalesced %u GowinQueueDrop %u\n",
+           Main.PerfCounters.GowinNack - before.GowinNack,
+           Main.PerfCounters.GowinTimeout - before.GowinTimeout,
+           Main.PerfCounters.GowinCoalesced - before.GowinCoalesced,
+           Main.PerfCounters.GowinQueueDrop - before.GowinQueueDrop);
+}
+
+int main(int argc,
+         char ** argv) {
+    uint32_t commands = (argc > 1) ? (uint32_t)atoi(argv[1]) : COMMANDS;
+
+    initialize_global_data_map();
+    for (int cls = 0; cls < CLASS_NUM; cls++)
+        _latency[cls] = malloc(commands * sizeof(uint64_t));
+
+    if (argc > 2) {
+        struct sim_gowin_config_t config = {
+            .delay_ns = (uint64_t)atoi(argv[2]) * 1000,
+            .nack_permille = (argc > 3) ? (uint16_t)atoi(argv[3]) : 0,
+            .garbage_permille = (argc > 4) ? (uint16_t)atoi(argv[4]) : 0,
+            .silent_permille = (argc > 5) ? (uint16_t)atoi(argv[5]) : 0,
+        };
+        _run("custom", commands, &config);
+        return 0;
+    }
+
+    _run("clean", commands, &(struct sim_gowin_config_t) { .delay_ns = 50000 });
+    _run("slow", commands, &(struct sim_gowin_config_t) { .delay_ns = 2000000, .jitter_ns = 3000000 });
+    _run("nack", commands, &(struct sim_gowin_config_t) { .delay_ns = 50000, .nack_permille = 10 });
+    _run("garbage", commands, &(struct sim_gowin_config_t) { .delay_ns = 50000, .garbage_permille = 10 });
+    _run("silent", commands, &(struct sim_gowin_config_t) { .delay_ns = 50000, .silent_permille = 2 });
+    return 0;
+}
@@ -0,0 +1,133 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : bench_is25xp.c  - native
+ * Author              : Barco
+ * created             : 18/10/2022
+ * Description         : spi_update of a partition through storage_spi_flash.c
+ *                       and is25xp.c on the simulated IS25LP128: simulated
+ *                       time per phase against the datasheet write cycles,
+ *                       bus bytes, status polls and wear (not a test, run by
+ *                       hand: bench_is25xp)
+ * History:
+ * 18/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fsl_spi.h"
+#include "pin_mux.h"
+#include "sim_is25lp128.h"
+#include "is25xp.h"
+#include "spi_cache.h"
+#include "spi_mux.h"
+#include "storage.h"
+#include "storage_spi_flash.h"
+
+#define IMAGE_SIZE (SPI_PART_SIZE - 0x1000)    // SPI_UPDATE_IMAGE_SIZE
+#define BLOCK_SIZE 512                          // storage write blocks
+#define UPDATES    10
+
+static uint8_t _image[SPI_PART_SIZE];
+
+// what a phase cost
+struct phase_t {
+    uint64_t ns;
+    uint64_t busy_ns;
+    uint64_t bytes;
+    uint32_t rdsr;
+};
+
+// ------------------------------------------------------------------------------
+uint32_t spi_mux_test_now(void) {
+    return DWT->CYCCNT;
+}
+
+static struct phase_t _mark(void) {
+    struct phase_t mark = {
+        .ns = hal_now_ns(),
+        .busy_ns = sim_is25lp128_stats()->busy_ns,
+        .bytes = hal_spi_stats(SPI8)->bytes,
+        .rdsr = sim_is25lp128_stats()->rdsr,
+    };
+    return mark;
+}
+
+static void _report(const char * name,
+                    struct phase_t start) {
+    struct phase_t end = _mark();
+    double ms = (double)(end.ns - start.ns) / 1e6;
+
+    printf("  %-8s %9.1f ms (write cycles %9.1f ms)  bus %8lu bytes  rdsr %6u\n", name, ms,
+           (double)(end.busy_ns - start.busy_ns) / 1e6, (unsigned long)(end.bytes - start.bytes),
+           end.rdsr - start.rdsr);
+}
+
+// ------------------------------------------------------------------------------
+static void _update(struct storage_driver_t * sdriver,
+                    struct spi_flash_area_t * farea,
+                    bool verbose) {
+    struct phase_t start = _mark();
+
+    farea->offset = 0;
+    storage_erase_storage(sdriver);
+    if (verbose)
+        _report("erase", start);
+
+    start = _mark();
+    for (uint32_t offset = 0; offset < IMAGE_SIZE; offset += BLOCK_SIZE)
+        storage_write_data(sdriver, &_image[offset], BLOCK_SIZE);
+    storage_flush_storage(sdriver);
+    is25xp_waitwritecomplete();
+    if (verbose)
+        _report("program", start);
+
+    start = _mark();
+    static uint8_t block[4096];
+    for (uint32_t offset = 0; offset < IMAGE_SIZE; offset += sizeof(block)) {
+        storage_read_data(sdriver, block, sizeof(block));
+        if (memcmp(block, &_image[offset], sizeof(block)))
+            printf("  verify failed at 0x%x\n", offset);
+    }
+    if (verbose)
+        _report("verify", start);
+}
+
+static void _run(const char * name,
+                 const struct sim_is25_timing_t * timing) {
+    struct storage_driver_t * sdriver = storage_new_spi_flash_driver();
+    struct spi_flash_area_t farea = storage_new_spi_flash_area("spi1", SPI1_START_ADDR, SPI_PART_SIZE);
+
+    hal_sim_reset();
+    sim_is25lp128_init(timing);
+    spi_cache_init(NULL);
+    spi_mux_init(NULL, SystemCoreClock / 1000000U);
+    storage_set_spi_flash_area(sdriver, &farea);
+    storage_init_storage(sdriver);
+
+    printf("%s write cycles, %u byte image:\n", name, IMAGE_SIZE);
+    uint64_t start = hal_now_ns();
+    _update(sdriver, &farea, true);
+    printf("  total    %9.1f ms\n", (double)(hal_now_ns() - start) / 1e6);
+
+    for (int i = 1; i < UPDATES; i++)
+        _update(sdriver, &farea, false);
+
+    const struct sim_is25_stats_t * stats = sim_is25lp128_stats();
+    uint32_t sector;
+    uint32_t wear = sim_is25lp128_wear(&sector);
+
+    printf("  %d updates: %u erases, %u programs, wear %u/%u (sector %u), "
+           "violations and %u wrap %u busy %u wel %u unmuxed %u\n",
+           UPDATES, stats->erases, stats->programs, wear, SIM_IS25_ENDURANCE, sector,
+           stats->and_violations, stats->page_wraps, stats->busy_violations,
+           stats->wel_violations, stats->unmuxed);
+}
+
+int main(void) {
+    for (uint32_t i = 0; i < sizeof(_image); i++)
+        _image[i] = (uint8_t)(i ^ (i >> 8) ^ (i >> 16));
+
+    _run("typical", &sim_is25_typical);
+    _run("max", &sim_is25_max);
+    return 0;
+}
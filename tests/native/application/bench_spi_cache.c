@@ -0,0 +1,190 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : bench_spi_cache.c  - native
+ * Author              : Barco
+ * created             : 18/10/2022
+ * Description         : spi flash page cache hit rate on the access traces of
+ *                       the bootloader, spi_update and the 0x61 readback,
+ *                       simulated is25xp (not a test, run by hand:
+ *                       bench_spi_cache)
+ * History:
+ * 18/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spi_cache.h"
+
+#define PART_SIZE   0x40000                     // SPI_PART_SIZE
+#define IMAGE_SIZE  (PART_SIZE - 0x1000)        // SPI_UPDATE_IMAGE_SIZE
+#define CTXT_OFFSET (PART_SIZE - 512)           // _bootloader_spi_retrieve_ctxt
+#define CTXT_SIZE   53                          // sizeof(struct spi_ctxt_t)
+#define BLOCK_SIZE  512                         // storage write blocks
+#define CRC_BLOCK   4096                        // SPI_CRC_BLOCK_SIZE
+#define PAGE        SPI_CACHE_PAGE_SIZE
+
+static uint8_t _flash[2 * PART_SIZE];
+static uint8_t _buf[CRC_BLOCK];
+static bool _cached = true;
+
+// what went over the spi bus
+static struct {
+    unsigned long calls;
+    unsigned long bytes;
+} _bus;
+
+// 0x61 ping-pong (i2c_slave_addr.c): front and back page
+static uint32_t _held[2];
+
+// ------------------------------------------------------------------------------
+// simulated is25xp
+ssize_t is25xp_read(off_t offset,
+                    size_t nbytes,
+                    uint8_t * buffer,
+                    uint8_t verbose) {
+    (void)verbose;
+    memcpy(buffer, &_flash[offset], nbytes);
+    _bus.calls++;
+    _bus.bytes += 5 + nbytes; // FAST_READ header
+    return (ssize_t)nbytes;
+}
+
+// storage_spi_flash.c read
+static void _storage_read(uint32_t offset,
+                          uint32_t len) {
+    if (_cached)
+        spi_cache_read(offset, len, _buf);
+    else
+        is25xp_read(offset, len, _buf, 0);
+}
+
+// storage_spi_flash.c write of one block (2 page programs), erase per 4k
+static void _storage_write(uint32_t offset) {
+    if (_cached)
+        spi_cache_invalidate(offset / PAGE, BLOCK_SIZE / PAGE);
+    memset(&_flash[offset], 0x5A, BLOCK_SIZE);
+}
+
+static void _storage_erase(uint32_t offset,
+                           uint32_t len) {
+    if (_cached)
+        spi_cache_invalidate(offset / PAGE, len / PAGE);
+    memset(&_flash[offset], 0xFF, len);
+}
+
+// _crc_spi_flash_storage
+static void _storage_crc(uint32_t start,
+                         uint32_t len) {
+    for (uint32_t done = 0; done < len; done += CRC_BLOCK)
+        _storage_read(start + done, (len - done > CRC_BLOCK) ? CRC_BLOCK : len - done);
+}
+
+// spi_master.c: 0x50 READ (publish) or SPI_IS25_PREFETCH of a page
+static void _spi_page(uint32_t page,
+                      bool publish) {
+    uint8_t data[PAGE];
+
+    if ((_held[0] == page) || (_held[1] == page))
+        return; // ping-pong hit, no lookup
+    if (!_cached || !spi_cache_lookup(page)) {
+        is25xp_read((off_t)page * PAGE, PAGE, data, 0);
+        if (_cached)
+            spi_cache_fill(page, data, spi_cache_epoch());
+    }
+    _held[publish ? 0 : 1] = page;
+}
+
+// spi_master.c: 0x50 PP
+static void _spi_program(uint32_t page) {
+    _held[0] = _held[1] = UINT32_MAX;
+    if (_cached)
+        spi_cache_invalidate(page, 1);
+}
+
+// ------------------------------------------------------------------------------
+// bootloader _initialize_spi_info: context and crc of both partitions, the
+// application reads the context of spi0 again (init_spi_rom)
+static void _trace_boot(void) {
+    for (int part = 0; part < 2; part++) {
+        _storage_read(part * PART_SIZE + CTXT_OFFSET, CTXT_SIZE);
+        _storage_crc(part * PART_SIZE, IMAGE_SIZE);
+    }
+    _storage_read(CTXT_OFFSET, CTXT_SIZE);
+}
+
+// spi_update of partition 1: erase, window writes, crc readback, context
+static void _trace_update(void) {
+    _storage_read(PART_SIZE + CTXT_OFFSET, CTXT_SIZE);
+    _storage_erase(PART_SIZE, PART_SIZE);
+    for (uint32_t offset = 0; offset < IMAGE_SIZE; offset += BLOCK_SIZE)
+        _storage_write(PART_SIZE + offset);
+    _storage_crc(PART_SIZE, IMAGE_SIZE);
+    _storage_read(PART_SIZE + CTXT_OFFSET, CTXT_SIZE);
+    _storage_write(PART_SIZE + CTXT_OFFSET);
+    _storage_read(PART_SIZE + CTXT_OFFSET, CTXT_SIZE);
+}
+
+// 0x61 dump of a partition: READ p, PREFETCH p + 1
+static void _trace_dump(void) {
+    for (uint32_t page = 0; page < PART_SIZE / PAGE; page++) {
+        _spi_page(page, true);
+        _spi_page(page + 1, false);
+    }
+}
+
+// 0x61 host polling: the header pages and contexts of both partitions, a
+// page of the image in between
+static void _trace_poll(void) {
+    const uint32_t pages[] = { 0, CTXT_OFFSET / PAGE, PART_SIZE / PAGE,
+                               (PART_SIZE + CTXT_OFFSET) / PAGE };
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        _spi_page(pages[i % 4], true);
+        if ((i % 4) == 3)
+            _spi_page(16 + (i / 4) % 256, true);
+    }
+}
+
+// 0x61 programming with readback: PP of a page, READ of it and the one before
+static void _trace_program(void) {
+    for (uint32_t page = 1; page < 1024; page++) {
+        _spi_program(page);
+        _spi_page(page, true);
+        _spi_page(page - 1, true);
+    }
+}
+
+// ------------------------------------------------------------------------------
+static void _run(const char * name,
+                 void (*trace)(void)) {
+    unsigned long calls[2], bytes[2];
+
+    for (int cached = 0; cached < 2; cached++) {
+        memset(_flash, 0xA5, sizeof(_flash));
+        memset(&_bus, 0, sizeof(_bus));
+        _held[0] = _held[1] = UINT32_MAX;
+        _cached = cached;
+        spi_cache_init(NULL);
+        trace();
+        calls[cached] = _bus.calls;
+        bytes[cached] = _bus.bytes;
+    }
+
+    const struct spi_cache_stats_t * stats = spi_cache_stats();
+    unsigned long lookups = stats->hits + stats->misses;
+
+    printf("%-10s pages %7lu hit %5.1f%%  spi bytes %8lu -> %8lu (%5.1f%%)  reads %6lu -> %6lu\n",
+           name, lookups, lookups ? 100.0 * stats->hits / lookups : 0.0,
+           bytes[0], bytes[1], bytes[0] ? 100.0 * bytes[1] / bytes[0] : 0.0,
+           calls[0], calls[1]);
+}
+
+int main(void) {
+    printf("spi_cache: %d pages of %u bytes\n", SPI_CACHE_PAGES, PAGE);
+    _run("boot", _trace_boot);
+    _run("update", _trace_update);
+    _run("0x61 dump", _trace_dump);
+    _run("0x61 poll", _trace_poll);
+    _run("0x61 prog", _trace_program);
+    return 0;
+}
@@ -8,6 +8,7 @@
  * 25/5/2021 - initial
  *******************************************************************************/
 #include "unit_test_comm_protocol_helper.h"
+#include "loop_stats.h"
 
 
 const u8 ByteWrite[] = { CMD_WRITE_BYTE, BYTE_TEST_REG, 0xAA };
@@ -28,6 +29,7 @@ void empty_buffers_test(void ** states) {
 void crc_error_test(void ** states) {
     LOG_INFO("Running COMM_Protocol BAD CRC Test should fail");
     u8 tmpCmd[sizeof(ByteWriteReply)];
+    u32 errors = Main.PerfCounters.ChecksumError;
 
     feed_RingBuffer(ByteWrite, sizeof(ByteWrite), false);
     // manipulate the buffer, change data value
@@ -35,6 +37,7 @@ void crc_error_test(void ** states) {
     t_comm_protocol_return_value ret = COMM_Protocol(UART1);
 
     assert_int_equal(ret, CRC_ERROR);
+    assert_int_equal(Main.PerfCounters.ChecksumError, errors + 1);
 }
 
 // ------------------------------------------------------------------------------
@@ -254,6 +257,86 @@ void int_read_msg_test(void ** states) {
     assert_memory_equal(unitTest_SendBuf + 2, read4ByteReply, sizeof(read4ByteReply));
 }
 
+// ------------------------------------------------------------------------------
+// PerfCounters: integerRead of one counter at 0x60 + index, byte write 0x60 clears
+void perf_counters_msg_test(void ** states) {
+    const u8 index = offsetof(PerfCounters_t, GowinNack) / sizeof(u32);
+    const u8 readCounter[] = { CMD_READ_4BYTE, 0x60 + index };
+    const u8 readCounterReply[] = { CMD_READ_4BYTE, 0x11, 0x22, 0x33, 0x44 };
+    const u8 clearCounters[] = { CMD_WRITE_BYTE, 0x60, 0x00 };
+    t_comm_protocol_return_value ret;
+
+    initialize_global_data_map();
+    Main.PerfCounters.GowinNack = 0x11223344;
+    Main.PerfCounters.MainLoopMaxUs = 1234;
+    COMM_DATA[UART1].MsgCount = 0;
+    LOG_INFO("PerfCounters read and clear - should pass");
+
+    feed_RingBuffer(readCounter, sizeof(readCounter), false);
+    ret = COMM_Protocol(UART1);
+    assert_int_equal(ret, NEW_MSG);
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_memory_equal(unitTest_SendBuf + 2, readCounterReply, sizeof(readCounterReply));
+
+    feed_RingBuffer(clearCounters, sizeof(clearCounters), false);
+    ret = COMM_Protocol(UART1);
+    assert_int_equal(ret, NEW_MSG);
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_int_equal(unitTest_SendBuf[3], COMM_REPLY_ACK);
+    assert_int_equal(Main.PerfCounters.GowinNack, 0);
+    assert_int_equal(Main.PerfCounters.MainLoopMaxUs, 0);
+}
+
+// ------------------------------------------------------------------------------
+// LoopStats control registers: 0x70 reset, 0x71 task sample shift
+void loop_stats_msg_test(void ** states) {
+    const u8 setShift[] = { CMD_WRITE_BYTE, 0x71, 0x02 };
+    const u8 setShiftTooBig[] = { CMD_WRITE_BYTE, 0x71, LOOPSTATS_SHIFT_MAX + 1 };
+    const u8 readShift[] = { CMD_READ_BYTE, 0x71 };
+    const u8 resetStats[] = { CMD_WRITE_BYTE, 0x70, 0x00 };
+    t_comm_protocol_return_value ret;
+
+    initialize_global_data_map();
+    loop_stats_init(96000000U);
+    loop_stats_add(LOOP_TASK_COMM, 100);
+    COMM_DATA[UART1].MsgCount = 0;
+    LOG_INFO("LoopStats sample shift and reset - should pass");
+
+    feed_RingBuffer(setShift, sizeof(setShift), false);
+    ret = COMM_Protocol(UART1);
+    assert_int_equal(ret, NEW_MSG);
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_int_equal(unitTest_SendBuf[3], COMM_REPLY_ACK);
+
+    feed_RingBuffer(setShiftTooBig, sizeof(setShiftTooBig), false);
+    ret = COMM_Protocol(UART1);
+    assert_int_equal(ret, NEW_MSG);
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_int_equal(unitTest_SendBuf[3], COMM_CMD_NACK);
+
+    feed_RingBuffer(readShift, sizeof(readShift), false);
+    ret = COMM_Protocol(UART1);
+    assert_int_equal(ret, NEW_MSG);
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_int_equal(unitTest_SendBuf[3], 0x02);
+
+    feed_RingBuffer(resetStats, sizeof(resetStats), false);
+    ret = COMM_Protocol(UART1);
+    assert_int_equal(ret, NEW_MSG);
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_int_equal(unitTest_SendBuf[3], COMM_REPLY_ACK);
+    // applied by the main loop
+    assert_int_equal(Main.LoopStats.Task[LOOP_TASK_COMM].Count, 1);
+    loop_stats_iteration(0);
+    assert_int_equal(Main.LoopStats.Task[LOOP_TASK_COMM].Count, 0);
+}
+
 // ------------------------------------------------------------------------------
 int main(void) {
     const struct CMUnitTest tests_protocol[] = {
@@ -265,7 +348,9 @@ int main(void) {
         cmocka_unit_test(byte_write_data_size_nok_msg_test),
         cmocka_unit_test(int_rw_testregister_msg_test),
         cmocka_unit_test(int_w_faulty_testregister_msg_test),
-        cmocka_unit_test(int_read_msg_test)
+        cmocka_unit_test(int_read_msg_test),
+        cmocka_unit_test(perf_counters_msg_test),
+        cmocka_unit_test(loop_stats_msg_test)
     };
 
     return cmocka_run_group_tests(tests_protocol, NULL, NULL);
@@ -161,6 +161,89 @@ void array_wrong_read_log_test(void ** states) {
     assert_memory_equal(unitTest_SendBuf, NACKSizeErrorReply, sizeof(NACKSizeErrorReply));
 }
 
+// ------------------------------------------------------------------------------
+// Memory-log collect - ring of 4 slots, 6 entries logged, counters 2..5 present
+void array_log_collect_test(void ** states) {
+    u8 dest[LOGFOLLOW_MAX_PAYLOAD];
+    u32 cursor;
+    u16 used;
+
+    LOG_INFO("Memory-log collect should pass");
+    unitTest_fill_log_slots(6);
+
+    // overwritten entries are skipped, continue at the oldest
+    cursor = 0;
+    used = sharedram_log_collect(unitTest_LogSlots, UNITTEST_LOG_SLOTS, 6, &cursor,
+                                 dest, sizeof(dest));
+    assert_int_equal(cursor, 6);
+    assert_int_equal(used, 4 * (LOGFOLLOW_RECORD_HEADER + 7));
+    const u8 first[] = { 0, 0, 0, 2, 7, 'e', 'n', 't', 'r', 'y', ' ', '2' };
+    assert_memory_equal(dest, first, sizeof(first));
+
+    // nothing new
+    used = sharedram_log_collect(unitTest_LogSlots, UNITTEST_LOG_SLOTS, 6, &cursor,
+                                 dest, sizeof(dest));
+    assert_int_equal(used, 0);
+    assert_int_equal(cursor, 6);
+
+    // cursor beyond head (restarted log) starts over at the oldest
+    cursor = 100;
+    used = sharedram_log_collect(unitTest_LogSlots, UNITTEST_LOG_SLOTS, 6, &cursor,
+                                 dest, sizeof(dest));
+    assert_int_equal(cursor, 6);
+    assert_int_equal(dest[3], 2);
+
+    // limited room, the next call continues where we stopped
+    cursor = 3;
+    used = sharedram_log_collect(unitTest_LogSlots, UNITTEST_LOG_SLOTS, 6, &cursor,
+                                 dest, 2 * (LOGFOLLOW_RECORD_HEADER + 7) + 1);
+    assert_int_equal(used, 2 * (LOGFOLLOW_RECORD_HEADER + 7));
+    assert_int_equal(cursor, 5);
+}
+
+// ------------------------------------------------------------------------------
+// Array Read log-follow - cursor 4 returns entries 4 and 5
+void array_read_logfollow_test(void ** states) {
+    const u8 readLog[] = { CMD_READ_ARRAY, CMD_ID_LOGFOLLOW, 0, 0, 0, 4 };
+    const u8 expectedReply[] = { 0, 0, 0, 6, 2,
+                                 0, 0, 0, 4, 7, 'e', 'n', 't', 'r', 'y', ' ', '4',
+                                 0, 0, 0, 5, 7, 'e', 'n', 't', 'r', 'y', ' ', '5' };
+
+    u8 size;
+    t_comm_protocol_return_value ret;
+
+    COMM_DATA[UART1].MsgCount = 0;
+    LOG_INFO("Array Read LOGFOLLOW COMM_Protocol should pass");
+
+    size = feed_RingBuffer(readLog, sizeof(readLog), false);
+    ret = COMM_Protocol(UART1);
+    assert_return_code(ret, NO_ERROR);
+    assert_int_equal(COMM_DATA[UART1].MsgLength, size);
+
+    comm_handler(); // sharedram_log_follow - Mock
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_memory_equal(unitTest_SendBuf + 3, expectedReply, sizeof(expectedReply));
+}
+
+// ------------------------------------------------------------------------------
+// Array Read log-follow - cursor of 2 bytes instead of 4
+void array_wrong_read_logfollow_test(void ** states) {
+    const u8 readLog[] = { CMD_READ_ARRAY, CMD_ID_LOGFOLLOW, 0, 0 };
+
+    t_comm_protocol_return_value ret;
+
+    COMM_DATA[UART1].MsgCount = 0;
+    LOG_INFO("Array wrong Read LOGFOLLOW COMM_Protocol should pass");
+
+    feed_RingBuffer(readLog, sizeof(readLog), false);
+    ret = COMM_Protocol(UART1);
+    assert_return_code(ret, NO_ERROR);
+
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_memory_equal(unitTest_SendBuf, NACKSizeErrorReply, sizeof(NACKSizeErrorReply));
+}
+
 // ------------------------------------------------------------------------------
 // Array Read Edid1 - including escape chars
 void array_read_edid1_test(void ** states) {
@@ -386,6 +469,58 @@ void array_read_outofboundary_test(void ** states) {
     assert_memory_equal(unitTest_SendBuf, rx, sizeof(rx));
 }
 
+// ------------------------------------------------------------------------------
+// Array Read PerfCounters block, raw (little endian) copy of Main.PerfCounters
+void array_read_perfcounters_test(void ** states) {
+    const u8 readPerf[] = { CMD_READ_ARRAY, CMD_ID_PERFCOUNTERS, 0x00, sizeof(PerfCounters_t) };
+
+    initialize_global_data_map();
+    Main.PerfCounters.MainLoopCount = 0x01020304;
+    Main.PerfCounters.UartOverrun[UART2] = 7;
+    Main.PerfCounters.I2cSlaveError = 3;
+    PerfCounters_t expected = Main.PerfCounters;
+
+    t_comm_protocol_return_value ret;
+    COMM_DATA[UART1].MsgCount = 0;
+    LOG_INFO("Array Read PerfCounters COMM_Protocol should pass");
+
+    feed_RingBuffer(readPerf, sizeof(readPerf), false);
+    ret = COMM_Protocol(UART1);
+    assert_return_code(ret, NO_ERROR);
+
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_int_equal(unitTest_SendBuf[2], CMD_READ_ARRAY);
+    assert_memory_equal(unitTest_SendBuf + 3, (u8 *)&expected, sizeof(expected));
+}
+
+// ------------------------------------------------------------------------------
+void array_read_loopstats_test(void ** states) {
+    const u8 readStats[] = { CMD_READ_ARRAY, CMD_ID_LOOPSTATS, LOOP_TASK_GPIO, sizeof(LoopStatsEntry_t) };
+
+    initialize_global_data_map();
+    memset(&Main.LoopStats, 0, sizeof(Main.LoopStats));
+    Main.LoopStats.Task[LOOP_TASK_GPIO].Count = 2;
+    Main.LoopStats.Task[LOOP_TASK_GPIO].Sum = 300;
+    Main.LoopStats.Task[LOOP_TASK_GPIO].Max = 200;
+    Main.LoopStats.Task[LOOP_TASK_GPIO].Histogram[7] = 2;
+
+    t_comm_protocol_return_value ret;
+    COMM_DATA[UART1].MsgCount = 0;
+    LOG_INFO("Array Read LoopStats COMM_Protocol should pass, mean filled in");
+
+    feed_RingBuffer(readStats, sizeof(readStats), false);
+    ret = COMM_Protocol(UART1);
+    assert_return_code(ret, NO_ERROR);
+
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    LoopStatsEntry_t expected = Main.LoopStats.Task[LOOP_TASK_GPIO];
+    assert_int_equal(expected.Mean, 150);
+    assert_int_equal(unitTest_SendBuf[2], CMD_READ_ARRAY);
+    assert_memory_equal(unitTest_SendBuf + 3, (u8 *)&expected, sizeof(expected));
+}
+
 // ------------------------------------------------------------------------------
 int main(void) {
     const struct CMUnitTest tests_array[] = {
@@ -394,6 +529,9 @@ int main(void) {
         cmocka_unit_test(array_read_beyond_maxpage_log_test),
         cmocka_unit_test(array_read_log_test),
         cmocka_unit_test(array_wrong_read_log_test),
+        cmocka_unit_test(array_log_collect_test),
+        cmocka_unit_test(array_read_logfollow_test),
+        cmocka_unit_test(array_wrong_read_logfollow_test),
         cmocka_unit_test(array_read_edid1_test),
         cmocka_unit_test(array_write_readback_edid_test),
         cmocka_unit_test(array_write_unknow_id_test),
@@ -402,6 +540,8 @@ int main(void) {
         cmocka_unit_test(array_write_missing_data_id_test),
         cmocka_unit_test(array_read_unknow_id_test),
         cmocka_unit_test(array_read_outofboundary_test),
+        cmocka_unit_test(array_read_perfcounters_test),
+        cmocka_unit_test(array_read_loopstats_test),
     };
 
     return cmocka_run_group_tests(tests_array, NULL, NULL);;
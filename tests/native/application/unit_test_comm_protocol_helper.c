@@ -45,6 +45,10 @@ u8 feed_RingBuffer(const char * data, u16 length, bool print) {
             UART_DATA[UART1].RxBufWr = UART_DATA[UART1].RxBuf; // reset write pointer
         }
     }
+    if ((crc == COMM_ESCAPE) || (crc == COMM_START_BYTE) || (crc == COMM_STOP_BYTE)) {
+        *((u8 *)UART_DATA[UART1].RxBufWr++) = COMM_ESCAPE;
+        crc -= COMM_ESCAPE;
+    }
     *((u8 *)UART_DATA[UART1].RxBufWr++) = crc;
     *((u8 *)UART_DATA[UART1].RxBufWr++) = (u8)COMM_STOP_BYTE;
 
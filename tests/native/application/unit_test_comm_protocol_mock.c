@@ -91,6 +91,46 @@ void __wrap_sharedram_log_read(u8 * RxBuf, u8 Offset, u8 NrOfBytes) {
     PROTO_TX_SendMsg(UART1, RxBuf, (u16)(NrOfBytes + PROTOCOL_RX_OFFSET_ADR));
 }
 
+// ------------------------------------------------------------------------------
+// fake memory-log ring, same slot layout as logger_mem.c
+u8 unitTest_LogSlots[UNITTEST_LOG_SLOTS * LOG_MEM_SLOT_SIZE];
+
+void unitTest_fill_log_slots(u32 Head) {
+    memset(unitTest_LogSlots, 0, sizeof(unitTest_LogSlots));
+    for (u32 Counter = 0; Counter < Head; Counter++) {
+        u8 * Slot = unitTest_LogSlots + (Counter % UNITTEST_LOG_SLOTS) * LOG_MEM_SLOT_SIZE;
+        memset(Slot, 0, LOG_MEM_SLOT_SIZE);
+        Slot[0] = (u8)(Counter >> 24);
+        Slot[1] = (u8)(Counter >> 16);
+        Slot[2] = (u8)(Counter >> 8);
+        Slot[3] = (u8)Counter;
+        snprintf((char *)Slot + sizeof(u32), LOG_MEM_SLOT_SIZE - sizeof(u32), "entry %d", Counter);
+    }
+}
+
+// ------------------------------------------------------------------------------
+// wrapped sharedram_log_follow is called from comm/comm.c
+void __wrap_sharedram_log_follow(u8 * RxBuf, u32 Cursor) {
+    const u32 HEAD = 6;
+    LOG_DEBUG("mocked: sharedram_log_follow Cursor(%d)", Cursor);
+
+    unitTest_fill_log_slots(HEAD);
+
+    u8 * Data = RxBuf + PROTOCOL_RX_OFFSET_ADR;
+    u8 * Records = Data + LOGFOLLOW_HEADER_SIZE;
+    u16 Used = sharedram_log_collect(unitTest_LogSlots, UNITTEST_LOG_SLOTS, HEAD, &Cursor,
+                                     Records, LOGFOLLOW_MAX_PAYLOAD - LOGFOLLOW_HEADER_SIZE);
+    u8 NrOfRecords = 0;
+    for (u16 i = 0; i < Used; i += LOGFOLLOW_RECORD_HEADER + Records[i + sizeof(u32)])
+        NrOfRecords++;
+
+    Data[0] = (u8)(HEAD >> 24);
+    Data[1] = (u8)(HEAD >> 16);
+    Data[2] = (u8)(HEAD >> 8);
+    Data[3] = (u8)HEAD;
+    Data[4] = NrOfRecords;
+    PROTO_TX_SendMsg(UART1, RxBuf, (u16)(PROTOCOL_RX_OFFSET_ADR + LOGFOLLOW_HEADER_SIZE + Used));
+}
 
 app_partition_t __wrap_switch_boot_partition() {
     LOG_DEBUG("mocked: switch_boot_partition");
@@ -102,3 +142,8 @@ app_partition_t __wrap_switch_boot_partition() {
 void __wrap_wdog_refresh() {
     LOG_DEBUG("mocked: wdog_refresh");
 }
+
+// ------------------------------------------------------------------------------
+// spi_update writes the spi flash: no i2c slave (0x61 readback pages) linked
+void i2c_slave_page_invalidate(void) {
+}
@@ -20,6 +20,14 @@ void __wrap_PROTO_TX_SendMsg(t_uart_channel uart_channel, u8 * data, u16 length)
 void __real_sharedram_log_read(u8 * RxBuf, u8 Offset, u8 NrOfBytes);
 void __wrap_sharedram_log_read(u8 * RxBuf, u8 Offset, u8 NrOfBytes);
 
+void __real_sharedram_log_follow(u8 * RxBuf, u32 Cursor);
+void __wrap_sharedram_log_follow(u8 * RxBuf, u32 Cursor);
+
+// fake memory-log ring used by the sharedram_log_follow mock
+#define UNITTEST_LOG_SLOTS 4
+extern u8 unitTest_LogSlots[UNITTEST_LOG_SLOTS * LOG_MEM_SLOT_SIZE];
+void unitTest_fill_log_slots(u32 Head);
+
 void __real_spi_queue_msg_param(u8 * data, u16 size);
 void __wrap_spi_queue_msg_param(u8 * data, u16 size);
 
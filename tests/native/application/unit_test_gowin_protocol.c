@@ -20,6 +20,7 @@
 
 #include "comm/gowin_protocol.h"
 #include "data_map.h"
+#include "timer_wheel.h"
 
 u8 MCU_RXBUF[0]; // uart1 ring buffer - not in use for gowin
 u8 GOWIN_RXBUF[GOWIN_RXBUF_SIZE]; // UART2 ring buffer - raw data -> holds any incoming byte!
@@ -198,15 +199,13 @@ void msg_edid_timeout_should_pass_tests(void ** state) {
 
     int cnt = GOWIN_DATA.BadMsgCount; // check bad message counter
 
-    for (int i = 0; i < GOWIN_REPLY_TIMEOUT + 1; i++) { // trigger timeout
-        ret = GOWIN_Protocol(UART2);
-        if (ret == GOWIN_RETURN_TIMEOUT) {
-            // LOG_INFO("timeout iterations needed %d",i);
-            assert_in_range(i, 2, GOWIN_REPLY_TIMEOUT + 1);
-            break;
-        }
-        assert_int_equal(GOWIN_DATA.RxBusy, true);
-    }
+    timer_fake_advance(GOWIN_REPLY_TIMEOUT_MS - 1); // no timeout yet
+    ret = GOWIN_Protocol(UART2);
+    assert_int_equal(ret, GOWIN_RETURN_NONE);
+    assert_int_equal(GOWIN_DATA.RxBusy, true);
+
+    timer_fake_advance(1); // trigger timeout
+    ret = GOWIN_Protocol(UART2);
     assert_int_not_equal(GOWIN_DATA.BadMsgCount, cnt);
     assert_int_equal(ret, GOWIN_RETURN_TIMEOUT);
     ret = GOWIN_Protocol(UART2);
@@ -236,14 +235,12 @@ void msg_stopbyte_timeout_should_pass_tests(void ** state) {
 
     int cnt = GOWIN_DATA.BadMsgCount; // check bad message counter
 
-    for (int i = 0; i < GOWIN_REPLY_TIMEOUT + 1; i++) { // trigger timeout
-        ret = GOWIN_Protocol(UART2);
-        if (ret == GOWIN_RETURN_TIMEOUT) {
-            LOG_INFO("timeout iterations needed %d", i);
-            assert_in_range(i, 2, GOWIN_REPLY_TIMEOUT + 1);
-            break;
-        }
-    }
+    timer_fake_advance(GOWIN_REPLY_TIMEOUT_MS - 1); // no timeout yet
+    ret = GOWIN_Protocol(UART2);
+    assert_int_equal(ret, GOWIN_RETURN_NONE);
+
+    timer_fake_advance(1); // trigger timeout
+    ret = GOWIN_Protocol(UART2);
     assert_int_not_equal(GOWIN_DATA.BadMsgCount, cnt);
     assert_int_equal(ret, GOWIN_RETURN_TIMEOUT);
 
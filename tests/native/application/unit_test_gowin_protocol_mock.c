@@ -17,7 +17,7 @@
 extern t_uart_data_raw UART_DATA[2];
 
 // ------------------------------------------------------------------------------
-void __wrap_GOWIN_TX_SendMsg(t_gowin_command cmd) {
+int8_t __wrap_GOWIN_TX_SendMsg(t_gowin_command cmd) {
     GOWIN_DATA.WaitForReply = true;
     if ((cmd == ACK) | (cmd == NACK)) { // single byte reply
         GOWIN_DATA.WaitForReply = false;
@@ -47,5 +47,6 @@ void __wrap_GOWIN_TX_SendMsg(t_gowin_command cmd) {
         LOG_DEBUG("UNIT_TEST - GOWIN %s '%c' sent", returnCmdName(cmd), cmd);
         GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_ACK);
     }
+    return 0;
 }
 
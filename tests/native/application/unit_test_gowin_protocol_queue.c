@@ -20,6 +20,7 @@
 
 #include "comm/gowin_protocol.h"
 #include "data_map.h"
+#include "timer_wheel.h"
 
 u8 MCU_RXBUF[0]; // uart1 ring buffer - not in use for gowin
 u8 GOWIN_RXBUF[GOWIN_RXBUF_SIZE]; // UART2 ring buffer - raw data -> holds any incoming byte!
@@ -53,10 +54,11 @@ void msg_queue_init_test(void ** state) {
     GOWIN_DATA.MsgCount = 0;
     LOG_INFO("Testing message init");
 
-    assert_int_equal(GOWIN_QueueIndex_get(), 0);
+    assert_int_equal(GOWIN_Queue_current(), NO_GOWIN_CMD);
     assert_int_equal(GOWIN_Queue_size(), 0);
 
     GOWIN_Process_Queue();
+    assert_int_equal(GOWIN_Queue_current(), NO_GOWIN_CMD);
 
     LOG_OK("message queue init test passed");
 }
@@ -74,7 +76,7 @@ void msg_queue_should_pass_test(void ** state) {
     int cnt = GOWIN_DATA.GoodMsgCount; // check message counter
 
     GOWIN_Queue_Tx_Msg(BACKLIGHT_ON);
-    GOWIN_Queue_Tx_Msg(BACKLIGHT_OFF);
+    GOWIN_Queue_Tx_Msg(HDMI_WRITE_PROTECT_ON);
     assert_int_equal(GOWIN_Queue_size(), 2);
     ret = GOWIN_Protocol(UART2);
     assert_int_equal(ret, GOWIN_RETURN_NONE);
@@ -110,7 +112,7 @@ void msg_queue_should_pass_test(void ** state) {
 }
 
 // ------------------------------------------------------------------------------
-// Check the message queue function, wait/test for ACK before sending another msg
+// Check the message queue overflow: a full FIFO drops the new message
 void msg_queue_overflow_should_pass_test(void ** state) {
     int8_t ret;
 
@@ -121,40 +123,26 @@ void msg_queue_overflow_should_pass_test(void ** state) {
     char _tx[1] = { ACK }; // ACK reply
     int cnt = GOWIN_DATA.GoodMsgCount; // check message counter
 
-    assert_int_equal(GOWIN_QueueIndex_get(), 0);
     assert_int_equal(GOWIN_Queue_size(), 0);
 
-    GOWIN_Queue_Tx_Msg(BACKLIGHT_ON); // gets written on index0
-    GOWIN_Queue_Tx_Msg(BACKLIGHT_OFF); // gets written on index1...
-    GOWIN_Queue_Tx_Msg(PANEL_VOLTAGELO);
-    GOWIN_Queue_Tx_Msg(PANEL_VOLTAGEHI);
-    GOWIN_Queue_Tx_Msg(BACKLIGHT_OFF);
-    GOWIN_Queue_Tx_Msg(BACKLIGHT_ON);
-    GOWIN_Queue_Tx_Msg(PANEL_PWR_OFF);
-    GOWIN_Queue_Tx_Msg(PANEL_PWR_ON);
-    assert_int_equal(GOWIN_Queue_size(), 8);
-    assert_int_equal(GOWIN_QueueIndex_get(), 0);
-    GOWIN_Queue_Tx_Msg(BACKLIGHT_OFF);
-    GOWIN_Queue_Tx_Msg(PANEL_VOLTAGELO); // gets written on index9
-    GOWIN_Queue_Tx_Msg(PANEL_VOLTAGEHI); // overwrites index0
-    GOWIN_Queue_Tx_Msg(PANEL_PWR_OFF); // overwrites index0
+    // pass through commands (byte write 0x40) are never coalesced
+    for (int i = 0; i < GOWIN_MSG_QUEUE_SIZE + 2; i++)
+        GOWIN_Queue_Tx_Msg((t_gowin_command)('0' + i));
     assert_int_equal(GOWIN_Queue_size(), GOWIN_MSG_QUEUE_SIZE);
+    assert_int_equal(Main.PerfCounters.GowinQueueDrop, 2);
     ret = GOWIN_Protocol(UART2);
     assert_int_equal(ret, GOWIN_RETURN_NONE);
     assert_int_equal(GOWIN_DATA.State, GOWIN_WAIT_FOR_ACK);
 
-
-    for (int i; i <= GOWIN_MSG_QUEUE_SIZE + 1; i++) {
+    // in order, the dropped ones are not sent
+    for (int i = 0; i < GOWIN_MSG_QUEUE_SIZE; i++) {
+        assert_int_equal(GOWIN_Queue_current(), '0' + i);
+        assert_int_equal(GOWIN_Queue_size(), GOWIN_MSG_QUEUE_SIZE - i);
         feed_RingBuffer(_tx, 1);
         ret = GOWIN_Protocol(UART2); // process the ACK
         ret = GOWIN_Protocol(UART2); // new cmd in queue
-        if (GOWIN_Queue_size()) {
-            assert_int_equal(GOWIN_DATA.State, GOWIN_WAIT_FOR_ACK);
-            assert_int_equal(GOWIN_Queue_size(), GOWIN_MSG_QUEUE_SIZE - 1 - i);
-            assert_int_equal(GOWIN_QueueIndex_get(), i + 1);
-        } else
-            assert_int_equal(GOWIN_DATA.State, GOWIN_WAIT_FOR_START);
     }
+    assert_int_equal(GOWIN_DATA.State, GOWIN_WAIT_FOR_START);
     assert_int_equal(GOWIN_Queue_size(), 0);
 
     assert_int_not_equal(GOWIN_DATA.GoodMsgCount, cnt);
@@ -162,7 +150,7 @@ void msg_queue_overflow_should_pass_test(void ** state) {
     // Queue is empty let's see if we can add a new element
     GOWIN_Queue_Tx_Msg(BACKLIGHT_ON);
     ret = GOWIN_Protocol(UART2);
-    assert_int_equal(GOWIN_QueueIndex_get(), 0);
+    assert_int_equal(GOWIN_Queue_current(), BACKLIGHT_ON);
     assert_int_equal(GOWIN_Queue_size(), 1);
     feed_RingBuffer(_tx, 1);
     ret = GOWIN_Protocol(UART2);
@@ -171,6 +159,237 @@ void msg_queue_overflow_should_pass_test(void ** state) {
     LOG_OK("message queue overflow test passed");
 }
 
+// ------------------------------------------------------------------------------
+// Check the priorities: power before control before EDID/DPCD, the message in
+// flight is not preempted
+void msg_queue_priority_test(void ** state) {
+    const t_gowin_command order[] = { WRITE_EDID, SET_STANDBY_ON, HDMI_WRITE_PROTECT_ON, WRITE_DPCD };
+    char _tx[1] = { ACK };
+
+    initialize_global_data_map();
+    GOWIN_Queue_Init();
+    GOWIN_DATA.MsgCount = 0;
+    LOG_INFO("Testing message queue priority");
+
+    GOWIN_Protocol_edid_write(0);
+    GOWIN_Protocol(UART2); // edid write in flight
+    GOWIN_Protocol_dpcd_write(0);
+    GOWIN_Queue_Tx_Msg(HDMI_WRITE_PROTECT_ON);
+    GOWIN_Queue_Tx_Msg(SET_STANDBY_ON);
+    assert_int_equal(GOWIN_Queue_size(), 4);
+
+    for (int i = 0; i < 4; i++) {
+        assert_int_equal(GOWIN_Queue_current(), order[i]);
+        feed_RingBuffer(_tx, 1);
+        GOWIN_Protocol(UART2); // process the ACK
+        GOWIN_Protocol(UART2); // next
+    }
+    assert_int_equal(GOWIN_Queue_size(), 0);
+
+    LOG_OK("message queue priority test passed");
+}
+
+// ------------------------------------------------------------------------------
+// Check the coalescing: a newer value of a pending setting replaces it in place
+void msg_queue_coalesce_test(void ** state) {
+    char _tx[1] = { ACK };
+
+    initialize_global_data_map();
+    GOWIN_Queue_Init();
+    GOWIN_DATA.MsgCount = 0;
+    LOG_INFO("Testing message queue coalescing");
+
+    GOWIN_Queue_Tx_Msg(HDMI_WRITE_PROTECT_ON);
+    GOWIN_Queue_Tx_Msg(PANEL_VOLTAGELO);
+    GOWIN_Queue_Tx_Msg(READ_BL_CURRENT);
+    GOWIN_Queue_Tx_Msg(HDMI_WRITE_PROTECT_OFF);
+    GOWIN_Queue_Tx_Msg(PANEL_VOLTAGEHI);
+    GOWIN_Protocol_edid_write(0);
+    GOWIN_Protocol_edid_write(1);
+    GOWIN_Protocol_edid_readback(2);
+    GOWIN_Protocol_edid_write(0); // same index: coalesced
+    GOWIN_Protocol_edid_readback(2); // verifies the last write: queued
+    assert_int_equal(GOWIN_Queue_size(), 7);
+    assert_int_equal(Main.PerfCounters.GowinCoalesced, 3);
+
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Queue_current(), PANEL_VOLTAGEHI);
+    feed_RingBuffer(_tx, 1);
+    GOWIN_Protocol(UART2);
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Queue_current(), HDMI_WRITE_PROTECT_OFF); // kept its place
+
+    // the message in flight is not touched, the new value is queued
+    GOWIN_Queue_Tx_Msg(HDMI_WRITE_PROTECT_ON);
+    assert_int_equal(GOWIN_Queue_current(), HDMI_WRITE_PROTECT_OFF);
+    assert_int_equal(GOWIN_Queue_size(), 7);
+    assert_int_equal(Main.PerfCounters.GowinCoalesced, 3);
+
+    LOG_OK("message queue coalesce test passed");
+}
+
+// ------------------------------------------------------------------------------
+// Check the panel sequence: backlight and power keep their order, a new value
+// only replaces the newest pending power message
+void msg_queue_power_order_test(void ** state) {
+    const t_gowin_command order[] = { BACKLIGHT_OFF, PANEL_PWR_ON, BACKLIGHT_ON };
+    char _tx[1] = { ACK };
+
+    initialize_global_data_map();
+    GOWIN_Queue_Init();
+    GOWIN_DATA.MsgCount = 0;
+    GOWIN_DATA.WaitForReply = false;
+    GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_START); // the previous test left a request in flight
+    LOG_INFO("Testing message queue power order");
+
+    GOWIN_Queue_Tx_Msg(BACKLIGHT_OFF);
+    GOWIN_Queue_Tx_Msg(PANEL_PWR_OFF);
+    GOWIN_Queue_Tx_Msg(PANEL_PWR_ON); // newest: coalesced
+    GOWIN_Queue_Tx_Msg(BACKLIGHT_ON); // not ahead of the panel power
+    assert_int_equal(GOWIN_Queue_size(), 3);
+    assert_int_equal(Main.PerfCounters.GowinCoalesced, 1);
+
+    GOWIN_Protocol(UART2);
+    for (int i = 0; i < 3; i++) {
+        assert_int_equal(GOWIN_Queue_current(), order[i]);
+        feed_RingBuffer(_tx, 1);
+        GOWIN_Protocol(UART2); // process the ACK
+        GOWIN_Protocol(UART2); // next
+    }
+    assert_int_equal(GOWIN_Queue_size(), 0);
+
+    LOG_OK("message queue power order test passed");
+}
+
+// ------------------------------------------------------------------------------
+// Replay a burst of 1000 backlight changes (1 per ms, the Gowin acknowledges
+// 3ms after a request): the queue stays short, the last value is sent and a
+// standby request queued in the middle of the burst waits at most for the
+// message in flight and the backlight change queued before it
+#define BURST_CHANGES 1000
+#define BURST_ACK_MS  3
+#define BURST_STANDBY 500 // ms
+
+void msg_queue_burst_latency_test(void ** state) {
+    char _tx[1] = { ACK };
+    bool in_flight = false;
+    u32 sent_at = 0;
+    u32 standby_at = 0;
+    int backlight_sent = 0;
+    t_gowin_command last_backlight = NO_GOWIN_CMD;
+
+    initialize_global_data_map();
+    GOWIN_Queue_Init();
+    GOWIN_DATA.MsgCount = 0;
+    GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_START);
+    timer_wheel_init(96000000U);
+    LOG_INFO("Testing message queue burst latency");
+
+    for (u32 t = 0; t < BURST_CHANGES + 10 * BURST_ACK_MS; t++) {
+        if (t < BURST_CHANGES)
+            GOWIN_Queue_Tx_Msg((t & 1) ? BACKLIGHT_OFF : BACKLIGHT_ON);
+        if (t == BURST_STANDBY)
+            GOWIN_Queue_Tx_Msg(SET_STANDBY_ON);
+
+        if (in_flight && (t - sent_at >= BURST_ACK_MS)) {
+            feed_RingBuffer(_tx, 1);
+            GOWIN_Protocol(UART2); // process the ACK
+            in_flight = false;
+        }
+        GOWIN_Protocol(UART2); // next message
+        if (!in_flight && (GOWIN_Queue_current() != NO_GOWIN_CMD)) {
+            in_flight = true;
+            sent_at = t;
+            if (GOWIN_Queue_current() == SET_STANDBY_ON) {
+                standby_at = t;
+            } else {
+                backlight_sent++;
+                last_backlight = GOWIN_Queue_current();
+            }
+        }
+        assert_true(GOWIN_Queue_size() <= 4); // in flight + backlight + standby + backlight
+        timer_fake_advance(1);
+    }
+
+    assert_int_equal(GOWIN_Queue_size(), 0);
+    assert_true(standby_at >= BURST_STANDBY);
+    assert_true(standby_at - BURST_STANDBY <= 2 * BURST_ACK_MS);
+    assert_int_equal(last_backlight, BACKLIGHT_OFF); // the last change
+    assert_true(backlight_sent <= BURST_CHANGES / BURST_ACK_MS + 1);
+    assert_int_equal(Main.PerfCounters.GowinCoalesced, BURST_CHANGES - backlight_sent);
+    assert_int_equal(Main.PerfCounters.GowinQueueDrop, 0);
+    LOG_INFO("%d backlight changes sent, standby after %d ms", backlight_sent,
+             standby_at - BURST_STANDBY);
+
+    LOG_OK("message queue burst latency test passed");
+}
+
+// ------------------------------------------------------------------------------
+// Check the retry of a message without reply, the queue behind it keeps waiting
+void msg_queue_timeout_retry_test(void ** state) {
+    char _tx[1] = { ACK };
+
+    initialize_global_data_map();
+    GOWIN_Queue_Init();
+    GOWIN_DATA.MsgCount = 0;
+    LOG_INFO("Testing message queue timeout retry");
+
+    GOWIN_Queue_Tx_Msg(BACKLIGHT_ON);
+    GOWIN_Queue_Tx_Msg(HDMI_WRITE_PROTECT_ON);
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Queue_current(), BACKLIGHT_ON);
+
+    timer_fake_advance(GOWIN_REPLY_TIMEOUT_MS);
+    assert_int_equal(GOWIN_Protocol(UART2), GOWIN_RETURN_TIMEOUT);
+    GOWIN_Protocol(UART2); // sent again
+    assert_int_equal(GOWIN_DATA.State, GOWIN_WAIT_FOR_ACK);
+    assert_int_equal(GOWIN_Queue_current(), BACKLIGHT_ON);
+    assert_int_equal(GOWIN_Queue_size(), 2);
+
+    feed_RingBuffer(_tx, 1);
+    GOWIN_Protocol(UART2);
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Queue_current(), HDMI_WRITE_PROTECT_ON);
+    assert_int_equal(GOWIN_Queue_size(), 1);
+
+    LOG_OK("message queue timeout retry test passed");
+}
+
+// ------------------------------------------------------------------------------
+// Check the retry cap: a message never answered is dropped, the queue goes on
+void msg_queue_retry_drop_test(void ** state) {
+    initialize_global_data_map();
+    GOWIN_Queue_Init();
+    GOWIN_DATA.MsgCount = 0;
+    GOWIN_DATA.WaitForReply = false;
+    GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_START); // the previous test left a request in flight
+    LOG_INFO("Testing message queue retry drop");
+
+    GOWIN_Queue_Tx_Msg(SET_STANDBY_ON);
+    GOWIN_Queue_Tx_Msg(HDMI_WRITE_PROTECT_ON);
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Queue_current(), SET_STANDBY_ON);
+
+    for (int i = 0; i < GOWIN_MSG_RETRY_MAX; i++) {
+        timer_fake_advance(GOWIN_REPLY_TIMEOUT_MS);
+        assert_int_equal(GOWIN_Protocol(UART2), GOWIN_RETURN_TIMEOUT);
+        GOWIN_Protocol(UART2); // sent again
+        assert_int_equal(GOWIN_Queue_current(), SET_STANDBY_ON);
+        assert_int_equal(GOWIN_Queue_size(), 2);
+    }
+    assert_int_equal(Main.PerfCounters.GowinRetryDrop, 0);
+
+    timer_fake_advance(GOWIN_REPLY_TIMEOUT_MS);
+    assert_int_equal(GOWIN_Protocol(UART2), GOWIN_RETURN_TIMEOUT);
+    GOWIN_Protocol(UART2); // dropped, the next one is sent
+    assert_int_equal(Main.PerfCounters.GowinRetryDrop, 1);
+    assert_int_equal(GOWIN_Queue_current(), HDMI_WRITE_PROTECT_ON);
+    assert_int_equal(GOWIN_DATA.State, GOWIN_WAIT_FOR_ACK);
+    assert_int_equal(GOWIN_Queue_size(), 1);
+
+    LOG_OK("message queue retry drop test passed");
+}
+
 // ------------------------------------------------------------------------------
 // Check the message queue NACK response
 void msg_queue_nack_test(void ** state) {
@@ -208,7 +427,13 @@ int main(void) {
         cmocka_unit_test(msg_queue_init_test),
         cmocka_unit_test(msg_queue_should_pass_test),
         cmocka_unit_test(msg_queue_overflow_should_pass_test),
+        cmocka_unit_test(msg_queue_timeout_retry_test),
+        cmocka_unit_test(msg_queue_retry_drop_test),
         cmocka_unit_test(msg_queue_nack_test),
+        cmocka_unit_test(msg_queue_priority_test),
+        cmocka_unit_test(msg_queue_coalesce_test),
+        cmocka_unit_test(msg_queue_power_order_test),
+        cmocka_unit_test(msg_queue_burst_latency_test),
     };
 
     return cmocka_run_group_tests(gowin_protocol_queue_tests, NULL, NULL);
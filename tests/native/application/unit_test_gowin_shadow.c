@@ -0,0 +1,166 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_gowin_shadow.c  - native
+ * Author              : Barco
+ * created             : 12/10/2022
+ * Description         : GOWIN EDID/DPCD shadow: redundant table writes are not sent
+ * History:
+ * 12/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "logger.h"
+
+#include "crc.h"
+#include "comm/gowin_protocol.h"
+#include "comm/gowin_shadow.h"
+#include "data_map.h"
+#include "timer_wheel.h"
+
+u8 MCU_RXBUF[0]; // uart1 ring buffer - not in use for gowin
+u8 GOWIN_RXBUF[GOWIN_RXBUF_SIZE]; // UART2 ring buffer - raw data -> holds any incoming byte!
+
+volatile t_uart_data_raw UART_DATA[2] = { { (u8 *)&MCU_RXBUF,   MCU_RXBUF_SIZE,   (u8 *)&MCU_RXBUF,   (u8 *)&MCU_RXBUF   },
+                                          { (u8 *)&GOWIN_RXBUF, GOWIN_RXBUF_SIZE, (u8 *)&GOWIN_RXBUF, (u8 *)&GOWIN_RXBUF } };
+
+void feed_RingBuffer(char * data, u16 length) {
+    for (int i = 0; i < length; i++) {
+        *((u8 *)UART_DATA[UART2].RxBufWr) = *data;
+        UART_DATA[UART2].RxBufWr++;
+        if (UART_DATA[UART2].RxBufWr >= (UART_DATA[UART2].RxBuf + UART_DATA[UART2].RxBufSize))
+            UART_DATA[UART2].RxBufWr = UART_DATA[UART2].RxBuf; // reset write pointer
+        data++;
+    }
+}
+
+static int setup(void ** state) {
+    (void)state;
+    initialize_global_data_map();
+    GOWIN_Queue_Init(); // shadow invalid
+    GOWIN_DATA.MsgCount = 0;
+    GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_START);
+    GOWIN_DATA.WaitForReply = false;
+    for (int i = 0; i < EDID_SIZE; i++) {
+        Main.Edid.Edid1[i] = (u8)i;
+        Main.Dpcd.Dpcd1[i] = (u8)~i;
+    }
+    return 0;
+}
+
+// queue -> mock send, ACK, back to idle
+// @returns true when the write went out
+static bool _write(t_gowin_command cmd,
+                   u8 index) {
+    u32 skipped = Main.PerfCounters.GowinWriteSkipped;
+
+    if (cmd == WRITE_EDID)
+        GOWIN_Protocol_edid_write(index);
+    else
+        GOWIN_Protocol_dpcd_write(index);
+    GOWIN_Protocol(UART2);
+    if (Main.PerfCounters.GowinWriteSkipped != skipped) {
+        assert_int_equal(GOWIN_Queue_size(), 0);
+        return false;
+    }
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_EDID_WRITE_ACK);
+    feed_RingBuffer("\x06", 1);
+    GOWIN_Protocol(UART2);
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Queue_size(), 0);
+    return true;
+}
+
+// ------------------------------------------------------------------------------
+// native CRC matches the CRC engine setup (CRC-32 check value)
+void shadow_crc_test(void ** states) {
+    u8 check[] = "123456789";
+
+    assert_int_equal(crc_run_crc32(check, 9), 0xCBF43926);
+}
+
+// ------------------------------------------------------------------------------
+// the acknowledged table is not sent again, a change in either EDID half is
+void shadow_edid_test(void ** states) {
+    assert_true(_write(WRITE_EDID, 0));
+    assert_false(_write(WRITE_EDID, 0));
+    assert_int_equal(Main.PerfCounters.GowinWriteSkipped, 1);
+
+    memcpy(Main.Edid.Edid2, Main.Edid.Edid1, EDID_SIZE); // other index, same content
+    assert_false(_write(WRITE_EDID, 1));
+
+    Main.Edid.Edid1[200] ^= 0xFF; // upper half
+    assert_int_equal(gowin_shadow_dirty(GOWIN_TABLE_EDID, Main.Edid.Edid1), 0x2);
+    assert_true(_write(WRITE_EDID, 0));
+    Main.Edid.Edid1[3] ^= 0xFF; // lower half
+    assert_true(_write(WRITE_EDID, 0));
+    assert_int_equal(Main.PerfCounters.GowinWriteSkipped, 2);
+}
+
+// ------------------------------------------------------------------------------
+// the FPGA keeps 128 bytes of DPCD: upper half changes are not sent
+void shadow_dpcd_test(void ** states) {
+    assert_true(_write(WRITE_DPCD, 0));
+    Main.Dpcd.Dpcd1[200] ^= 0xFF;
+    assert_false(_write(WRITE_DPCD, 0));
+    Main.Dpcd.Dpcd1[100] ^= 0xFF;
+    assert_true(_write(WRITE_DPCD, 0));
+
+    // tables are tracked apart
+    assert_true(_write(WRITE_EDID, 0));
+    assert_false(_write(WRITE_DPCD, 0));
+}
+
+// ------------------------------------------------------------------------------
+// WAKE_UP from the FPGA and reply timeouts: the tables are sent again
+void shadow_invalidate_test(void ** states) {
+    assert_true(_write(WRITE_EDID, 0));
+    feed_RingBuffer("%", 1); // WAKE_UP
+    GOWIN_Protocol(UART2);
+    assert_true(_write(WRITE_EDID, 0));
+
+    GOWIN_Queue_Tx_Msg(BACKLIGHT_ON);
+    GOWIN_Protocol(UART2);
+    timer_fake_advance(GOWIN_REPLY_TIMEOUT_MS);
+    assert_int_equal(GOWIN_Protocol(UART2), GOWIN_RETURN_TIMEOUT);
+    GOWIN_Protocol(UART2); // retry
+    feed_RingBuffer("\x06", 1);
+    GOWIN_Protocol(UART2);
+    GOWIN_Protocol(UART2);
+    assert_true(_write(WRITE_EDID, 0));
+    assert_false(_write(WRITE_EDID, 0));
+}
+
+// ------------------------------------------------------------------------------
+// a readback tells what the FPGA holds: writing it back is skipped
+void shadow_readback_test(void ** states) {
+    GOWIN_Protocol_edid_readback(2);
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_EDID);
+    feed_RingBuffer("$", 1);
+    feed_RingBuffer((char *)Main.Edid.Edid1, EDID_SIZE);
+    GOWIN_Protocol(UART2);
+    assert_memory_equal(Main.Edid.Edid3, Main.Edid.Edid1, EDID_SIZE);
+
+    assert_false(_write(WRITE_EDID, 0));
+    assert_int_equal(Main.PerfCounters.GowinWriteSkipped, 1);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest gowin_shadow_tests[] = {
+        cmocka_unit_test_setup(shadow_crc_test,        setup),
+        cmocka_unit_test_setup(shadow_edid_test,       setup),
+        cmocka_unit_test_setup(shadow_dpcd_test,       setup),
+        cmocka_unit_test_setup(shadow_invalidate_test, setup),
+        cmocka_unit_test_setup(shadow_readback_test,   setup),
+    };
+
+    return cmocka_run_group_tests(gowin_shadow_tests, NULL, NULL);
+}
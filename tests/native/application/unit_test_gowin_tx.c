@@ -0,0 +1,174 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_gowin_tx.c  - native
+ * Author              : Barco
+ * created             : 11/10/2022
+ * Description         : GOWIN protocol interrupt driven TX path, native port:
+ *                       GOWIN_TX_fake_transmit plays the UART interrupt
+ * History:
+ * 11/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "logger.h"
+
+#include "comm/gowin_protocol.h"
+#include "data_map.h"
+#include "timer_wheel.h"
+
+u8 MCU_RXBUF[0]; // uart1 ring buffer - not in use for gowin
+u8 GOWIN_RXBUF[GOWIN_RXBUF_SIZE]; // UART2 ring buffer - raw data -> holds any incoming byte!
+
+volatile t_uart_data_raw UART_DATA[2] = { { (u8 *)&MCU_RXBUF,   MCU_RXBUF_SIZE,   (u8 *)&MCU_RXBUF,   (u8 *)&MCU_RXBUF   },
+                                          { (u8 *)&GOWIN_RXBUF, GOWIN_RXBUF_SIZE, (u8 *)&GOWIN_RXBUF, (u8 *)&GOWIN_RXBUF } };
+
+static u8 tx[GOWIN_TX_RING_SIZE];
+
+void feed_RingBuffer(char * data, u16 length) {
+    for (int i = 0; i < length; i++) {
+        *((u8 *)UART_DATA[UART2].RxBufWr) = *data;
+        UART_DATA[UART2].RxBufWr++;
+        if (UART_DATA[UART2].RxBufWr >= (UART_DATA[UART2].RxBuf + UART_DATA[UART2].RxBufSize))
+            UART_DATA[UART2].RxBufWr = UART_DATA[UART2].RxBuf; // reset write pointer
+        data++;
+    }
+}
+
+static int setup(void ** state) {
+    (void)state;
+    initialize_global_data_map();
+    GOWIN_Queue_Init();
+    GOWIN_DATA.MsgCount = 0;
+    GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_START);
+    GOWIN_DATA.WaitForReply = false;
+    GOWIN_TX_fake_transmit(tx, sizeof(tx)); // drop leftovers
+    memset(tx, 0, sizeof(tx));
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+// the reply state is entered once the request is sent, not when it is queued
+void tx_read_request_test(void ** states) {
+    const u8 request[] = { GOWIN_START_BYTE, READ_EDID, GOWIN_STOP_BYTE };
+
+    assert_int_equal(GOWIN_TX_SendMsg(READ_EDID), 0);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_TX);
+    assert_false(GOWIN_Busy()); // the TX interrupt wakes the task
+
+    assert_int_equal(GOWIN_Protocol(UART2), GOWIN_RETURN_NONE);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_TX);
+
+    assert_int_equal(GOWIN_TX_fake_transmit(tx, sizeof(tx)), sizeof(request));
+    assert_memory_equal(tx, request, sizeof(request));
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_EDID);
+}
+
+// ------------------------------------------------------------------------------
+// EDID write: header and 256 byte payload, acknowledged after the transmission
+void tx_edid_write_test(void ** states) {
+    for (int i = 0; i < EDID_SIZE; i++)
+        Main.Edid.Edid2[i] = (u8)(i ^ 0x5A);
+    GOWIN_Protocol_edid_write(1);
+    GOWIN_Protocol(UART2); // queue -> tx ring
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_TX);
+
+    // partial: still sending
+    assert_int_equal(GOWIN_TX_fake_transmit(tx, 100), 100);
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_TX);
+
+    assert_int_equal(GOWIN_TX_fake_transmit(&tx[100], sizeof(tx) - 100), 3 + EDID_SIZE - 100);
+    assert_int_equal(tx[1], WRITE_EDID);
+    assert_memory_equal(&tx[3], Main.Edid.Edid2, EDID_SIZE);
+    assert_int_equal(GOWIN_Protocol(UART2), GOWIN_RETURN_WAIT_EDID_ACK);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_EDID_WRITE_ACK);
+
+    feed_RingBuffer("\x06", 1);
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_START);
+}
+
+// ------------------------------------------------------------------------------
+// standby takes effect once the command left
+void tx_standby_test(void ** states) {
+    Main.Diagnostics.InLowPowerMode = false;
+    GOWIN_TX_SendMsg(SET_STANDBY_ON);
+    GOWIN_Protocol(UART2);
+    assert_false(Main.Diagnostics.InLowPowerMode);
+
+    GOWIN_TX_fake_transmit(tx, sizeof(tx));
+    GOWIN_Protocol(UART2);
+    assert_true(Main.Diagnostics.InLowPowerMode);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_ACK);
+}
+
+// ------------------------------------------------------------------------------
+// 2 byte read: '$' b0 b1, no stop byte
+void tx_read_2byte_test(void ** states) {
+    GOWIN_TX_SendMsg(READ_BL_CURRENT);
+    GOWIN_TX_fake_transmit(tx, sizeof(tx));
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_READING_2BYTE);
+
+    feed_RingBuffer("$\x34\x12", 3);
+    GOWIN_Protocol(UART2);
+    assert_int_equal(Main.DeviceState.PanelCurrent, 0x1234);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_START);
+}
+
+// ------------------------------------------------------------------------------
+// ACK/NACK replies are single bytes and leave the state alone
+void tx_ack_test(void ** states) {
+    assert_int_equal(GOWIN_TX_SendMsg(ACK), 0);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_START);
+    assert_int_equal(GOWIN_TX_fake_transmit(tx, sizeof(tx)), 1);
+    assert_int_equal(tx[0], ACK);
+}
+
+// ------------------------------------------------------------------------------
+// the reply timeout counts from the end of the transmission
+void tx_reply_timeout_test(void ** states) {
+    GOWIN_TX_SendMsg(BACKLIGHT_ON);
+    timer_fake_advance(GOWIN_REPLY_TIMEOUT_MS / 2); // slow link
+    GOWIN_TX_fake_transmit(tx, sizeof(tx));
+    GOWIN_Protocol(UART2);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_ACK);
+
+    timer_fake_advance(GOWIN_REPLY_TIMEOUT_MS - 1);
+    assert_int_equal(GOWIN_Protocol(UART2), GOWIN_RETURN_NONE);
+    timer_fake_advance(1);
+    assert_int_equal(GOWIN_Protocol(UART2), GOWIN_RETURN_TIMEOUT);
+}
+
+// ------------------------------------------------------------------------------
+// no room: the request is refused, nothing partial in the ring
+void tx_ring_full_test(void ** states) {
+    for (int i = 0; i < GOWIN_TX_RING_SIZE - 2; i++)
+        GOWIN_TX_SendMsg(ACK);
+    assert_int_equal(GOWIN_TX_SendMsg(READ_EDID), -1);
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_START);
+    assert_int_equal(GOWIN_TX_fake_transmit(tx, sizeof(tx)), GOWIN_TX_RING_SIZE - 2);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest gowin_tx_tests[] = {
+        cmocka_unit_test_setup(tx_read_request_test,  setup),
+        cmocka_unit_test_setup(tx_edid_write_test,    setup),
+        cmocka_unit_test_setup(tx_standby_test,       setup),
+        cmocka_unit_test_setup(tx_read_2byte_test,    setup),
+        cmocka_unit_test_setup(tx_ack_test,           setup),
+        cmocka_unit_test_setup(tx_reply_timeout_test, setup),
+        cmocka_unit_test_setup(tx_ring_full_test,     setup),
+    };
+
+    return cmocka_run_group_tests(gowin_tx_tests, NULL, NULL);
+}
@@ -0,0 +1,446 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_i2c_slave.c  - native
+ * Author              : Barco
+ * created             : 16/10/2022
+ * Description         : i2c slave addresses 0x60..0x63, transfers of two ports
+ *                       interleaved (i2c_fake_start/clock/stop), 0x61 page
+ *                       ping-pong and prefetch; i2c_slave.c on the native
+ *                       HAL's flexcomm slave (the vendor driver's events)
+ * History:
+ * 16/10/2022 - initial
+ * 18/10/2022 - fill spanning a flash change
+ * 19/10/2022 - transfers through i2c_slave.c in the vendor event order
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "logger.h"
+
+#include "board.h"
+#include "fsl_i2c.h"
+#include "hal_sim.h"
+
+#include "data_map.h"
+#include "i2c/i2c_slave.h"
+#include "i2c/i2c_slave_addr.h"
+#include "i2c/i2c_stream.h"
+
+#define PAGE_A 7
+#define PAGE_B 8
+
+#define BUS_STEP_NS 10000 // the slave interrupt is polled this often
+
+static u8 _written_id = 0;
+static u8 _written_data = 0;
+static int _spi_calls = 0;
+static u8 _spi_data[2];
+
+// ------------------------------------------------------------------------------
+// mocked, not linked: comm_run.c
+u8 byteReadbyId(u8 Identifier) {
+    return (u8)(Identifier ^ 0xFF);
+}
+
+bool byteWritebyId(u8 Identifier,
+                   u8 data) {
+    _written_id = Identifier;
+    _written_data = data;
+    return true;
+}
+
+// a page program: the 2 byte command, the address, then the data
+u16 byteWrite2SPI(u8 * data,
+                  u16 size) {
+    _spi_calls++;
+    memcpy(_spi_data, data, sizeof(_spi_data));
+    if ((size == 2) && (data[0] == 0x50))
+        return 2;
+    return 0;
+}
+
+// mocked, not linked: spi_queue.c (i2c_update prefetch)
+u8 spi_queue_size(bool verbose) {
+    (void)verbose;
+    return 0;
+}
+
+void spi_queue_msg_param(u8 * param,
+                         u8 size) {
+    (void)param;
+    (void)size;
+}
+
+// ------------------------------------------------------------------------------
+static void _fill(u16 page) {
+    u8 * back = i2c_slave_page_back(page, false);
+
+    assert_non_null(back);
+    for (int i = 0; i < I2C_DATA_LENGTH; i++)
+        back[i] = (u8)(page * 13 + i);
+}
+
+// the spi task: a 0x50 READ of page, served from the prefetch or read
+static bool _read(u16 page) {
+    if (i2c_slave_page_lookup(page))
+        return true;
+    _fill(page);
+    i2c_slave_page_filled(page, true);
+    return false;
+}
+
+static void _write(u8 address,
+                   const u8 * data,
+                   u16 length) {
+    t_i2c_fake_xfer xfer;
+
+    i2c_fake_start(&xfer, address, false);
+    assert_int_equal(i2c_fake_clock(&xfer, (u8 *)data, length), length);
+    i2c_fake_stop(&xfer);
+}
+
+// smbus block read: offset write, repeated start, read
+static u16 _block_read(u8 address,
+                       u8 offset,
+                       u8 * data,
+                       u16 length) {
+    t_i2c_fake_xfer xfer;
+    u16 n;
+
+    _write(address, &offset, 1);
+    i2c_fake_start(&xfer, address, true);
+    n = i2c_fake_clock(&xfer, data, length);
+    i2c_fake_stop(&xfer);
+    return n;
+}
+
+static void _page_mode(u8 address,
+                       bool on) {
+    const u8 toggle[] = { I2C_TOGGLE_TX_SIZE_CMD, on ? 1 : 0 };
+
+    _write(address, toggle, sizeof(toggle));
+}
+
+static void _assert_page(const u8 * data,
+                         u16 page,
+                         u16 offset,
+                         u16 length) {
+    for (u16 i = 0; i < length; i++)
+        assert_int_equal(data[i], (u8)(page * 13 + offset + i));
+}
+
+// ------------------------------------------------------------------------------
+void BOARD_I2C_MAINCPU_FLEXCOMM_IRQ(void); // i2c_slave.c
+
+// a transaction of the Zynq on the FLEXCOMM4 slave: the native HAL walks the
+// vendor state machine, i2c_slave.c gets its events in the driver's order
+struct bus_result_t {
+    bool done;
+    status_t status;
+    size_t count;
+};
+
+static void _bus_done(void * ctx,
+                      status_t status,
+                      size_t count) {
+    struct bus_result_t * result = ctx;
+
+    result->done = true;
+    result->status = status;
+    result->count = count;
+}
+
+static size_t _bus(u8 address,
+                   bool read,
+                   u8 * data,
+                   size_t size) {
+    struct bus_result_t result = { 0 };
+    struct hal_i2c_bus_t xfer = {
+        .address = address,
+        .read = read,
+        .data = data,
+        .size = size,
+        .done = _bus_done,
+        .ctx = &result,
+    };
+
+    assert_int_equal(hal_i2c_bus_transfer((I2C_Type *)BOARD_I2C_MAINCPU_BASE, &xfer),
+                     kStatus_Success);
+    while (!result.done) {
+        hal_advance_ns(BUS_STEP_NS);
+        BOARD_I2C_MAINCPU_FLEXCOMM_IRQ();
+    }
+    assert_int_equal(result.status, kStatus_Success);
+    return result.count;
+}
+
+static int setup_bus(void ** state) {
+    (void)state;
+    hal_sim_reset();
+    assert_int_equal(i2c_slave_setup(), 0);
+    i2c_slave_page_invalidate();
+    memset(Main.Debug.eeprom, 0, sizeof(Main.Debug.eeprom));
+    _written_id = 0;
+    _spi_calls = 0;
+    return 0;
+}
+
+static int setup(void ** state) {
+    (void)state;
+    i2c_slave_addr_init();
+    i2c_slave_page_invalidate();
+    _page_mode(I2C_MASTER_SLAVE_ADDR_BIS, true);
+    _page_mode(I2C_MASTER_SLAVE_ADDR_EEPROM, false);
+    memset(Main.Debug.eeprom, 0, sizeof(Main.Debug.eeprom));
+    i2c_stream_init(NULL);
+    _spi_calls = 0;
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+// port 1 clocks out the 0x61 page, port 2 writes the eeprom and a byte on
+// 0x60 in the middle of it: the page read is not disturbed
+void concurrent_address_test(void ** states) {
+    const u8 eeprom[] = { 5, 0xAB };
+    const u8 byte[] = { 0x12, 0x34 };
+    t_i2c_fake_xfer port1;
+    u8 page[I2C_DATA_LENGTH];
+    u8 value = 0;
+
+    _read(PAGE_A);
+    i2c_fake_start(&port1, I2C_MASTER_SLAVE_ADDR_BIS, true);
+    assert_int_equal(i2c_fake_clock(&port1, page, 100), 100);
+
+    _write(I2C_MASTER_SLAVE_ADDR_EEPROM, eeprom, sizeof(eeprom));
+    _write(I2C_MASTER_SLAVE_ADDR_7BIT, byte, sizeof(byte));
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_EEPROM, 5, &value, 1), 1);
+
+    assert_int_equal(i2c_fake_clock(&port1, &page[100], I2C_DATA_LENGTH), I2C_DATA_LENGTH - 100);
+    i2c_fake_stop(&port1);
+
+    _assert_page(page, PAGE_A, 0, I2C_DATA_LENGTH);
+    assert_int_equal(value, 0xAB);
+    assert_int_equal(Main.Debug.eeprom[5], 0xAB);
+    assert_int_equal(_written_id, 0x12);
+    assert_int_equal(_written_data, 0x34);
+}
+
+// ------------------------------------------------------------------------------
+// a page read asks for the next page, its READ then needs no spi read
+void prefetch_test(void ** states) {
+    u8 page[I2C_DATA_LENGTH];
+    u16 next;
+
+    assert_false(i2c_slave_page_prefetch(&next));
+    assert_false(_read(PAGE_A));
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_BIS, 0, page, 32), 32);
+    assert_true(i2c_slave_page_prefetch(&next));
+    assert_int_equal(next, PAGE_B);
+    assert_false(i2c_slave_page_prefetch(&next)); // taken once
+
+    // the spi task (spi_prefetch_page): the back buffer, not shown yet
+    _fill(PAGE_B);
+    i2c_slave_page_filled(PAGE_B, false);
+    assert_null(i2c_slave_page_back(PAGE_B, true)); // held already
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_BIS, 32, page, 32), 32);
+    _assert_page(page, PAGE_A, 32, 32);
+
+    assert_true(_read(PAGE_B));
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_BIS, 0, page, I2C_DATA_LENGTH),
+                     I2C_DATA_LENGTH);
+    _assert_page(page, PAGE_B, 0, I2C_DATA_LENGTH);
+
+    // the flash changed: not served from the buffers anymore
+    i2c_slave_page_invalidate();
+    assert_false(i2c_slave_page_prefetch(&next));
+    assert_false(_read(PAGE_B));
+}
+
+// ------------------------------------------------------------------------------
+// the READ of the prefetched page during a read: swapped once it completes
+void deferred_swap_test(void ** states) {
+    t_i2c_fake_xfer port1;
+    u8 page[I2C_DATA_LENGTH];
+    u16 next;
+
+    _read(PAGE_A);
+    _fill(PAGE_B);
+    i2c_slave_page_filled(PAGE_B, false);
+
+    i2c_fake_start(&port1, I2C_MASTER_SLAVE_ADDR_BIS, true);
+    i2c_fake_clock(&port1, page, 64);
+    assert_true(_read(PAGE_B));
+    assert_null(i2c_slave_page_back(PAGE_A + 2, true)); // waits to be published
+    i2c_fake_clock(&port1, &page[64], I2C_DATA_LENGTH);
+    i2c_fake_stop(&port1);
+    _assert_page(page, PAGE_A, 0, I2C_DATA_LENGTH);
+
+    assert_false(i2c_slave_page_prefetch(&next)); // PAGE_B was held already
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_BIS, 0, page, 16), 16);
+    _assert_page(page, PAGE_B, 0, 16);
+}
+
+// ------------------------------------------------------------------------------
+// the non-blocking spi read completes after a program/erase: the data read
+// is not kept as the page
+void stale_fill_test(void ** states) {
+    u8 page[I2C_DATA_LENGTH];
+    u8 * back;
+
+    _read(PAGE_A);
+    back = i2c_slave_page_back(PAGE_B, true); // prefetch started
+    assert_non_null(back);
+    i2c_slave_page_invalidate();              // i2c stream programs the flash
+    memset(back, 0, I2C_DATA_LENGTH);         // read completes
+    i2c_slave_page_filled(PAGE_B, false);
+    assert_null(i2c_slave_page_lookup(PAGE_B));
+
+    // a READ in flight is shown, but read again the next time
+    back = i2c_slave_page_back(PAGE_B, false);
+    i2c_slave_page_invalidate();
+    for (int i = 0; i < I2C_DATA_LENGTH; i++)
+        back[i] = (u8)(PAGE_B * 13 + i);
+    i2c_slave_page_filled(PAGE_B, true);
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_BIS, 0, page, 16), 16);
+    _assert_page(page, PAGE_B, 0, 16);
+    assert_null(i2c_slave_page_lookup(PAGE_B));
+    assert_false(_read(PAGE_B));
+    assert_true(_read(PAGE_B));
+}
+
+// ------------------------------------------------------------------------------
+// page mode follows the offset of the block reads, byte mode one byte
+void page_offset_test(void ** states) {
+    u8 page[I2C_DATA_LENGTH];
+    u8 value = 0;
+
+    _read(PAGE_A);
+    for (u16 offset = 0; offset < I2C_DATA_LENGTH; offset += 32)
+        assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_BIS, (u8)offset, &page[offset], 32),
+                         32);
+    _assert_page(page, PAGE_A, 0, I2C_DATA_LENGTH);
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_BIS, 0xF0, page, 32), 16); // page end
+
+    _page_mode(I2C_MASTER_SLAVE_ADDR_BIS, false);
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_BIS, 9, &value, 4), 1);
+    assert_int_equal(value, (u8)(PAGE_A * 13 + 9));
+}
+
+// ------------------------------------------------------------------------------
+// 24c02 emulation: byte and block mode
+void eeprom_test(void ** states) {
+    const u8 block[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    const u8 outside[] = { I2C_EMULATED_EEPROM_SIZE, 0x77 };
+    u8 data[I2C_EMULATED_EEPROM_SIZE + 1];
+
+    _write(I2C_MASTER_SLAVE_ADDR_EEPROM, outside, sizeof(outside)); // ignored
+    _page_mode(I2C_MASTER_SLAVE_ADDR_EEPROM, true);
+    assert_int_equal(Main.Debug.eeprom[0], 0); // the toggle is no write
+    _write(I2C_MASTER_SLAVE_ADDR_EEPROM, block, sizeof(block));
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_EEPROM, 0, data, sizeof(data)),
+                     I2C_EMULATED_EEPROM_SIZE);
+    assert_memory_equal(data, block, sizeof(block));
+
+    _page_mode(I2C_MASTER_SLAVE_ADDR_EEPROM, false);
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_EEPROM, 3, data, 2), 1);
+    assert_int_equal(data[0], 4);
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_EEPROM, I2C_EMULATED_EEPROM_SIZE, data, 1),
+                     1);
+    assert_int_equal(data[0], 0);
+}
+
+// ------------------------------------------------------------------------------
+// 0x60: byte read by id, page program gateway; 0x63 status
+void command_stream_test(void ** states) {
+    const u8 pp[] = { 0x50, 0x02 };
+    const u8 address[] = { 0x00, 0x10 };
+    t_i2c_fake_xfer xfer;
+    u8 status[I2C_STREAM_STATUS_LENGTH + 1];
+    u8 value = 0;
+
+    assert_int_equal(_block_read(I2C_MASTER_SLAVE_ADDR_7BIT, 0x21, &value, 1), 1);
+    assert_int_equal(value, 0x21 ^ 0xFF);
+
+    _write(I2C_MASTER_SLAVE_ADDR_7BIT, pp, sizeof(pp));
+    assert_true(i2c_slave_addr_expecting());
+    i2c_fake_start(&xfer, I2C_MASTER_SLAVE_ADDR_7BIT, false);
+    assert_int_equal(xfer.size, 2);
+    i2c_fake_clock(&xfer, (u8 *)address, sizeof(address));
+    i2c_fake_stop(&xfer);
+    assert_false(i2c_slave_addr_expecting());
+    assert_int_equal(_spi_calls, 2);
+
+    i2c_fake_start(&xfer, I2C_MASTER_SLAVE_ADDR_STREAM, true);
+    assert_int_equal(i2c_fake_clock(&xfer, status, sizeof(status)), I2C_STREAM_STATUS_LENGTH);
+    i2c_fake_stop(&xfer);
+    assert_int_equal(status[0], 0); // no stream
+
+    i2c_fake_start(&xfer, 0x70, true);
+    assert_int_equal(xfer.size, 0);
+    assert_false(i2c_slave_addr_done(0x70, true, 0));
+}
+
+// ------------------------------------------------------------------------------
+// the buffer is asked for before the address match event: the first write
+// after i2c_slave_setup is taken, each address gets its own buffer
+void bus_first_write_test(void ** states) {
+    u8 byte[] = { 0x12, 0x34 };
+    u8 offset = 5;
+    u8 value = 0;
+
+    Main.Debug.eeprom[5] = 0xA5;
+    Main.Debug.eeprom[6] = 0x5A;
+    assert_int_equal(_bus(I2C_MASTER_SLAVE_ADDR_7BIT, false, byte, sizeof(byte)), sizeof(byte));
+    assert_int_equal(_written_id, 0x12);
+    assert_int_equal(_written_data, 0x34);
+
+    // one transmit buffer per read: the eeprom cursor moves a byte per byte
+    assert_int_equal(_bus(I2C_MASTER_SLAVE_ADDR_EEPROM, false, &offset, 1), 1);
+    assert_int_equal(_bus(I2C_MASTER_SLAVE_ADDR_EEPROM, true, &value, 1), 1);
+    assert_int_equal(value, 0xA5);
+    assert_int_equal(_bus(I2C_MASTER_SLAVE_ADDR_EEPROM, true, &value, 1), 1);
+    assert_int_equal(value, 0x5A);
+}
+
+// the 0x60 gateway: READ of a page in two writes, then the page on 0x61
+void bus_flash_gateway_test(void ** states) {
+    u8 toggle[] = { I2C_TOGGLE_TX_SIZE_CMD, 1 };
+    u8 read[] = { 0x50, 0x03 };
+    u8 address[] = { 0x00, PAGE_B };
+    u8 page[I2C_DATA_LENGTH];
+
+    assert_int_equal(_bus(I2C_MASTER_SLAVE_ADDR_BIS, false, toggle, sizeof(toggle)), 2);
+    assert_int_equal(_bus(I2C_MASTER_SLAVE_ADDR_7BIT, false, read, sizeof(read)), 2);
+    assert_true(i2c_slave_addr_expecting());
+    assert_int_equal(_bus(I2C_MASTER_SLAVE_ADDR_7BIT, false, address, sizeof(address)), 2);
+    assert_false(i2c_slave_addr_expecting());
+    assert_int_equal(_spi_calls, 2);
+    assert_memory_equal(_spi_data, address, sizeof(address)); // not a stale or empty buffer
+
+    _read(PAGE_B); // the spi task
+    assert_int_equal(_bus(I2C_MASTER_SLAVE_ADDR_BIS, true, page, sizeof(page)), sizeof(page));
+    _assert_page(page, PAGE_B, 0, I2C_DATA_LENGTH);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest i2c_slave_tests[] = {
+        cmocka_unit_test_setup(concurrent_address_test, setup),
+        cmocka_unit_test_setup(prefetch_test,           setup),
+        cmocka_unit_test_setup(deferred_swap_test,      setup),
+        cmocka_unit_test_setup(stale_fill_test,         setup),
+        cmocka_unit_test_setup(page_offset_test,        setup),
+        cmocka_unit_test_setup(eeprom_test,             setup),
+        cmocka_unit_test_setup(command_stream_test,     setup),
+        cmocka_unit_test_setup(bus_first_write_test,    setup_bus),
+        cmocka_unit_test_setup(bus_flash_gateway_test,  setup_bus),
+    };
+
+    return cmocka_run_group_tests(i2c_slave_tests, NULL, NULL);
+}
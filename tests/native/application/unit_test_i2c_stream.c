@@ -0,0 +1,359 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_i2c_stream.c  - native
+ * Author              : Barco
+ * created             : 14/10/2022
+ * Description         : Streamed spi flash programming over i2c, native i2c
+ *                       slave side (i2c_stream_fake_write/read) on a RAM backed
+ *                       spi flash storage driver
+ * History:
+ * 14/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "logger.h"
+
+#include "storage.h"
+#include "storage_spi_flash.h"
+#include "i2c/i2c_stream.h"
+
+#define FAKE_FLASH_SIZE (64 * 1024)
+#define SECTOR_PAGES    ((MIN_ERASE_SIZE) / I2C_STREAM_PAGE_SIZE)
+#define PART_PAGES      (SPI_PART_SIZE / I2C_STREAM_PAGE_SIZE)
+#define FIRST_PAGE      (2 * SECTOR_PAGES)
+#define PAGES           (3 * SECTOR_PAGES)
+
+static u8 _flash[FAKE_FLASH_SIZE];
+static u8 _image[PAGES][I2C_STREAM_PAGE_SIZE];
+static int _erases = 0;
+static bool _erase_fails = false;
+
+// ------------------------------------------------------------------------------
+// mocked, not linked: the i2c slave (0x61 readback pages)
+void i2c_slave_page_invalidate(void) {
+}
+
+// ------------------------------------------------------------------------------
+// RAM flash: a write only clears bits, as a page program
+static int _fake_write(struct storage_driver_t * sdriver,
+                       uint8_t * data,
+                       size_t len) {
+    struct spi_flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+
+    assert_true(farea->start_addr + farea->offset + len <= FAKE_FLASH_SIZE);
+    for (size_t i = 0; i < len; i++)
+        _flash[farea->start_addr + farea->offset + i] &= data[i];
+    farea->offset += len;
+    return 1;
+}
+
+static int _fake_erase(struct storage_driver_t * sdriver) {
+    struct spi_flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+
+    if (_erase_fails)
+        return -1;
+    assert_int_equal(farea->start_addr % (MIN_ERASE_SIZE), 0);
+    assert_int_equal(farea->size, MIN_ERASE_SIZE);
+    memset(_flash + farea->start_addr, 0xFF, farea->size);
+    _erases++;
+    return 0;
+}
+
+static const struct storage_ops_t _fake_ops = {
+    .write = _fake_write,
+    .erase = _fake_erase,
+};
+
+static struct storage_driver_t _fake_driver = {
+    .name     = "fakespi",
+    .type     = STORAGE_SPI_EXTERNAL,
+    .ops      = &_fake_ops,
+    .privdata = NULL,
+};
+
+// ------------------------------------------------------------------------------
+static int setup(void ** state) {
+    (void)state;
+    memset(_flash, 0x5A, sizeof(_flash)); // old content everywhere
+    for (int p = 0; p < PAGES; p++)
+        for (int i = 0; i < I2C_STREAM_PAGE_SIZE; i++)
+            _image[p][i] = (u8)(p * 31 + i);
+    _erases = 0;
+    _erase_fails = false;
+    i2c_stream_init(&_fake_driver);
+    return 0;
+}
+
+typedef struct {
+    u8 flags;
+    u8 free;
+    u8 error;
+    u32 committed;
+    u16 next;
+} t_status;
+
+static t_status _status(void) {
+    u8 buf[I2C_STREAM_STATUS_LENGTH];
+    t_status s;
+
+    assert_int_equal(i2c_stream_fake_read(buf), I2C_STREAM_STATUS_LENGTH);
+    s.flags = buf[0];
+    s.free = buf[1];
+    s.error = buf[2];
+    s.committed = ((u32)buf[3] << 24) | ((u32)buf[4] << 16) | ((u32)buf[5] << 8) | buf[6];
+    s.next = (u16)((buf[7] << 8) | buf[8]);
+    return s;
+}
+
+static void _start(u16 page,
+                   u16 count) {
+    const u8 frame[] = { I2C_STREAM_CMD_START, (u8)(page >> 8), (u8)page,
+                         (u8)(count >> 8), (u8)count };
+
+    i2c_stream_fake_write(frame, sizeof(frame));
+}
+
+static void _page(u16 page,
+                  const u8 * data) {
+    u8 frame[I2C_STREAM_FRAME_SIZE];
+
+    frame[0] = I2C_STREAM_CMD_DATA;
+    frame[1] = (u8)(page >> 8);
+    frame[2] = (u8)page;
+    memcpy(&frame[I2C_STREAM_HEADER], data, I2C_STREAM_PAGE_SIZE);
+    i2c_stream_fake_write(frame, sizeof(frame));
+}
+
+static void _drain(void) {
+    while (i2c_stream_process())
+        ;
+}
+
+// ------------------------------------------------------------------------------
+// the host of flash_tool -s stream: send while there are free slots, one
+// background step per poll, no sleeps
+void stream_transfer_test(void ** states) {
+    const u32 end = (FIRST_PAGE + PAGES) * I2C_STREAM_PAGE_SIZE;
+    t_status s;
+    int polls = 0;
+
+    _start(FIRST_PAGE, PAGES);
+    i2c_stream_process();
+    s = _status();
+    assert_true(s.flags & I2C_STREAM_FLAG_ACTIVE);
+    assert_int_equal(s.free, I2C_STREAM_SLOTS);
+    assert_int_equal(s.next, FIRST_PAGE);
+
+    do {
+        s = _status();
+        assert_false(s.flags & I2C_STREAM_FLAG_ERROR);
+        for (u16 n = 0; (n < s.free) && (s.next + n < FIRST_PAGE + PAGES); n++)
+            _page(s.next + n, _image[s.next + n - FIRST_PAGE]);
+        i2c_stream_process();
+        polls++;
+    } while (s.flags & (I2C_STREAM_FLAG_BUSY | I2C_STREAM_FLAG_ACTIVE));
+
+    assert_int_equal(s.error, I2C_STREAM_ERR_NONE);
+    assert_int_equal(s.committed, end);
+    assert_int_equal(s.flags, 0);
+    assert_true(polls < 2 * PAGES);
+    assert_memory_equal(&_flash[FIRST_PAGE * I2C_STREAM_PAGE_SIZE], _image, sizeof(_image));
+    // the sectors of the range, nothing around it
+    assert_int_equal(_erases, PAGES / SECTOR_PAGES);
+    assert_int_equal(_flash[FIRST_PAGE * I2C_STREAM_PAGE_SIZE - 1], 0x5A);
+    assert_int_equal(_flash[end], 0x5A);
+}
+
+// ------------------------------------------------------------------------------
+// START is taken by the task: busy and no slots until then
+void stream_status_test(void ** states) {
+    t_status s = _status();
+
+    assert_int_equal(s.flags, 0);
+    assert_int_equal(s.free, 0);
+
+    _page(0, _image[0]); // no stream open
+    assert_int_equal(_status().error, I2C_STREAM_ERR_STATE);
+
+    _start(0, SECTOR_PAGES);
+    s = _status();
+    assert_int_equal(s.flags, I2C_STREAM_FLAG_BUSY);
+    assert_int_equal(s.free, 0);
+    _page(0, _image[0]);
+    assert_int_equal(_status().error, I2C_STREAM_ERR_STATE);
+
+    i2c_stream_process();
+    s = _status();
+    assert_int_equal(s.flags, I2C_STREAM_FLAG_BUSY | I2C_STREAM_FLAG_ACTIVE); // erase pending
+    assert_int_equal(s.error, I2C_STREAM_ERR_NONE);
+    _drain();
+    assert_int_equal(_status().flags, I2C_STREAM_FLAG_ACTIVE); // waiting for the host
+
+    const u8 bad[] = { 0x7F };
+    i2c_stream_fake_write(bad, sizeof(bad));
+    assert_int_equal(_status().error, I2C_STREAM_ERR_COMMAND);
+    _start(0xFFF0, SECTOR_PAGES); // past the end of spi1
+    i2c_stream_process();
+    assert_int_equal(_status().error, I2C_STREAM_ERR_COMMAND);
+}
+
+// ------------------------------------------------------------------------------
+// START: whole sectors only, the erase would wipe the pages around the range
+void stream_unaligned_test(void ** states) {
+    const u16 starts[][2] = {
+        { FIRST_PAGE + 2, SECTOR_PAGES },     // start inside a sector
+        { FIRST_PAGE, SECTOR_PAGES + 3 },     // end inside a sector
+        { FIRST_PAGE - 1, SECTOR_PAGES + 1 }, // both, page before the range
+        { FIRST_PAGE, 0 },
+    };
+
+    for (size_t i = 0; i < sizeof(starts) / sizeof(starts[0]); i++) {
+        _start(starts[i][0], starts[i][1]);
+        i2c_stream_process();
+        assert_int_equal(_status().error, I2C_STREAM_ERR_COMMAND);
+        assert_int_equal(_status().flags, 0);
+        _drain();
+    }
+    assert_int_equal(_erases, 0);
+    for (size_t i = 0; i < sizeof(_flash); i++)
+        assert_int_equal(_flash[i], 0x5A);
+}
+
+// ------------------------------------------------------------------------------
+// START: the image area of one partition, the context sector is not streamed
+void stream_range_test(void ** states) {
+    const u16 context = PART_PAGES - SECTOR_PAGES;
+    const u16 refused[][2] = {
+        { context, SECTOR_PAGES },                          // spi0 context
+        { context - SECTOR_PAGES, 2 * SECTOR_PAGES },       // into the spi0 context
+        { context - SECTOR_PAGES, 4 * SECTOR_PAGES },       // spi0 into spi1
+        { PART_PAGES + context, SECTOR_PAGES },             // spi1 context
+        { 2 * PART_PAGES, SECTOR_PAGES },                   // past spi1
+        { 0, PART_PAGES },                                  // all of spi0
+    };
+    const u16 accepted[][2] = {
+        { 0, context },                                     // spi0 image
+        { PART_PAGES, context },                            // spi1 image
+        { PART_PAGES + context - SECTOR_PAGES, SECTOR_PAGES },
+    };
+    const u8 abort[] = { I2C_STREAM_CMD_ABORT };
+
+    for (size_t i = 0; i < sizeof(refused) / sizeof(refused[0]); i++) {
+        _start(refused[i][0], refused[i][1]);
+        i2c_stream_process();
+        assert_int_equal(_status().error, I2C_STREAM_ERR_COMMAND);
+        assert_int_equal(_status().flags, 0);
+    }
+    for (size_t i = 0; i < sizeof(accepted) / sizeof(accepted[0]); i++) {
+        _start(accepted[i][0], accepted[i][1]);
+        i2c_stream_process();
+        assert_int_equal(_status().error, I2C_STREAM_ERR_NONE);
+        assert_int_equal(_status().next, accepted[i][0]);
+        assert_true(_status().flags & I2C_STREAM_FLAG_ACTIVE);
+        i2c_stream_fake_write(abort, sizeof(abort)); // before the first erase
+        i2c_stream_process();
+    }
+    assert_int_equal(_erases, 0);
+}
+
+// ------------------------------------------------------------------------------
+// dropped pages: no free slot, out of sequence, short; the stream stays open
+void stream_dropped_test(void ** states) {
+    u8 frame[I2C_STREAM_HEADER + 10] = { I2C_STREAM_CMD_DATA, 0, 0 };
+    t_status s;
+
+    _start(0, PAGES);
+    i2c_stream_process();
+    for (u16 p = 0; p < I2C_STREAM_SLOTS; p++)
+        _page(p, _image[p]);
+    s = _status();
+    assert_int_equal(s.free, 0);
+    assert_int_equal(s.error, I2C_STREAM_ERR_NONE);
+
+    _page(I2C_STREAM_SLOTS, _image[I2C_STREAM_SLOTS]);
+    s = _status();
+    assert_int_equal(s.error, I2C_STREAM_ERR_OVERFLOW);
+    assert_int_equal(s.next, I2C_STREAM_SLOTS);
+
+    _drain();
+    assert_int_equal(_status().committed, I2C_STREAM_SLOTS * I2C_STREAM_PAGE_SIZE);
+    _page(I2C_STREAM_SLOTS + 1, _image[I2C_STREAM_SLOTS + 1]);
+    assert_int_equal(_status().error, I2C_STREAM_ERR_SEQUENCE);
+    _page(3, _image[3]); // already committed
+    assert_int_equal(_status().error, I2C_STREAM_ERR_SEQUENCE);
+    frame[2] = I2C_STREAM_SLOTS;
+    i2c_stream_fake_write(frame, sizeof(frame));
+    assert_int_equal(_status().error, I2C_STREAM_ERR_LENGTH);
+
+    s = _status();
+    assert_int_equal(s.next, I2C_STREAM_SLOTS);
+    assert_int_equal(s.free, I2C_STREAM_SLOTS);
+    assert_true(s.flags & I2C_STREAM_FLAG_ACTIVE);
+    assert_memory_equal(_flash, _image, I2C_STREAM_SLOTS * I2C_STREAM_PAGE_SIZE);
+}
+
+// ------------------------------------------------------------------------------
+// abort closes the stream, buffered pages are not programmed
+void stream_abort_test(void ** states) {
+    const u8 abort[] = { I2C_STREAM_CMD_ABORT };
+
+    _start(0, PAGES);
+    _drain();
+    _page(0, _image[0]);
+    i2c_stream_fake_write(abort, sizeof(abort));
+    _page(1, _image[1]);
+    assert_int_equal(_status().error, I2C_STREAM_ERR_STATE);
+    _drain();
+    assert_int_equal(_status().flags, 0);
+    assert_int_equal(_flash[0], 0xFF);
+
+    _start(0, SECTOR_PAGES); // a new stream
+    _drain();
+    for (u16 p = 0; p < SECTOR_PAGES; p++) {
+        _page(p, _image[p]);
+        _drain();
+    }
+    assert_int_equal(_status().flags, 0);
+    assert_memory_equal(_flash, _image, SECTOR_PAGES * I2C_STREAM_PAGE_SIZE);
+}
+
+// ------------------------------------------------------------------------------
+// a flash failure stops the stream and shows in the flags
+void stream_erase_error_test(void ** states) {
+    t_status s;
+
+    _erase_fails = true;
+    _start(0, PAGES);
+    _drain();
+    s = _status();
+    assert_int_equal(s.flags, I2C_STREAM_FLAG_ERROR);
+    assert_int_equal(s.error, I2C_STREAM_ERR_ERASE);
+    assert_int_equal(s.free, 0);
+
+    _erase_fails = false;
+    _start(0, SECTOR_PAGES); // cleared by the next stream
+    i2c_stream_process();
+    assert_int_equal(_status().flags & I2C_STREAM_FLAG_ERROR, 0);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest i2c_stream_tests[] = {
+        cmocka_unit_test_setup(stream_transfer_test,    setup),
+        cmocka_unit_test_setup(stream_status_test,      setup),
+        cmocka_unit_test_setup(stream_unaligned_test,   setup),
+        cmocka_unit_test_setup(stream_range_test,       setup),
+        cmocka_unit_test_setup(stream_dropped_test,     setup),
+        cmocka_unit_test_setup(stream_abort_test,       setup),
+        cmocka_unit_test_setup(stream_erase_error_test, setup),
+    };
+
+    return cmocka_run_group_tests(i2c_stream_tests, NULL, NULL);
+}
@@ -0,0 +1,445 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_is25xp.c  - native
+ * Author              : Barco
+ * created             : 18/10/2022
+ * Description         : is25xp.c and storage_spi_flash.c on the simulated
+ *                       IS25LP128 (tests/native/hal): identification, reads,
+ *                       page program and erase semantics, WIP timing, the
+ *                       non-blocking transfers, the storage driver (v1
+ *                       cursor, v2 positional, scatter-gather and
+ *                       asynchronous requests) and mux
+ * History:
+ * 18/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "fsl_spi.h"
+#include "pin_mux.h"
+#include "sim_is25lp128.h"
+#include "is25xp.h"
+#include "spi_cache.h"
+#include "spi_mux.h"
+#include "storage.h"
+#include "storage_spi_flash.h"
+
+#define PAGE   IS25_IS25XP_BYTES_PER_PAGE
+#define SECTOR SIM_IS25_SECTOR_SIZE
+
+static uint8_t _buf[2 * SECTOR];
+static int _done = 0;           // !< non-blocking completions
+static int _requests = 0;       // !< storage requests completed
+
+// ------------------------------------------------------------------------------
+// spi_mux.c on the simulated DWT
+uint32_t spi_mux_test_now(void) {
+    return DWT->CYCCNT;
+}
+
+static void _transfer_done(void) {
+    _done++;
+}
+
+static void _request_done(struct storage_req_t * req) {
+    (void)req;
+    _requests++;
+}
+
+// the "interrupt" until the transfer in flight is done
+static void _irq(void) {
+    while (hal_spi_irq_pending(SPI8))
+        is25xp_irqhandler();
+}
+
+static void _pattern(uint8_t * buf,
+                     size_t len,
+                     uint8_t seed) {
+    for (size_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)(seed + i * 7);
+}
+
+// PP as a frame of its own, without the driver
+static void _raw_pp(uint32_t offset,
+                    const uint8_t * data,
+                    size_t len) {
+    uint8_t frame[4 + 2 * PAGE];
+    spi_transfer_t xfer = { frame, NULL, kSPI_FrameAssert, 4 + len };
+
+    frame[0] = IS25_PP;
+    frame[1] = (uint8_t)(offset >> 16);
+    frame[2] = (uint8_t)(offset >> 8);
+    frame[3] = (uint8_t)offset;
+    memcpy(&frame[4], data, len);
+    SPI_MasterTransferBlocking(SPI8, &xfer);
+}
+
+// ------------------------------------------------------------------------------
+static int setup(void ** state) {
+    (void)state;
+    spi_master_config_t config;
+
+    hal_sim_reset();
+    SPI_MasterGetDefaultConfig(&config);
+    config.baudRate_Bps = CONFIG_IS25XP_SPIFREQUENCY;
+    SPI_MasterInit(SPI8, &config, CLOCK_GetHsLspiClkFreq());
+    sim_is25lp128_init(NULL);
+    BOARD_SetSPIMux(1);
+    spi_cache_init(NULL);
+    _done = 0;
+    _requests = 0;
+    is25xp_async_init(_transfer_done);
+
+    uint8_t id[5];
+    return is25xp_readid(id, 0);
+}
+
+// ------------------------------------------------------------------------------
+static void readid_test(void ** state) {
+    (void)state;
+    uint8_t id[5];
+
+    assert_int_equal(is25xp_readid(id, 1), 0);
+    assert_int_equal(id[0], IS25_MANUFACTURER);
+    assert_int_equal(id[1], IS25_MEMORY_TYPE);
+    assert_int_equal(id[2], IS25_IS25LP128_CAPACITY);
+    assert_int_equal(id[3], IS25_DEVICE_ID);
+
+    // 150MHz / 3
+    assert_int_equal(SPI8->baud, 50000000);
+    assert_int_equal(sim_is25lp128_stats()->unknown, 0);
+}
+
+static void read_test(void ** state) {
+    (void)state;
+    uint8_t * mem = sim_is25lp128_memory();
+    uint32_t frames = hal_spi_stats(SPI8)->frames;
+
+    _pattern(mem, 2 * SECTOR, 3);
+    _pattern(&mem[SIM_IS25_SIZE - 16], 16, 99);
+
+    // header and data in one frame
+    assert_int_equal(is25xp_read(0x123, 1, _buf, 0), 1);
+    assert_int_equal(_buf[0], mem[0x123]);
+    assert_int_equal(is25xp_read(0x1F7, 300, _buf, 0), 300);
+    assert_memory_equal(_buf, &mem[0x1F7], 300);
+    assert_int_equal(is25xp_read(0, 2 * SECTOR, _buf, 0), 2 * SECTOR);
+    assert_memory_equal(_buf, mem, 2 * SECTOR);
+    assert_int_equal(hal_spi_stats(SPI8)->frames - frames, 3);
+    assert_int_equal(sim_is25lp128_stats()->reads, 3);
+    assert_int_equal(sim_is25lp128_stats()->bytes_read, 1 + 300 + 2 * SECTOR);
+
+    // the address counter wraps at the end of the array
+    assert_int_equal(is25xp_read(SIM_IS25_SIZE - 4, 8, _buf, 0), 8);
+    assert_memory_equal(_buf, &mem[SIM_IS25_SIZE - 4], 4);
+    assert_memory_equal(&_buf[4], mem, 4);
+
+    // 5 + 4096 bytes at 50MHz: 656us on the bus
+    assert_int_equal(is25xp_read_throughput(0, SECTOR, _buf), 6243);
+}
+
+static void program_test(void ** state) {
+    (void)state;
+    uint8_t * mem = sim_is25lp128_memory();
+    uint8_t page[PAGE], again[PAGE];
+
+    _pattern(page, PAGE, 1);
+    _pattern(again, PAGE, 2);
+
+    is25xp_pagewrite(page, 16); // sector 1
+    assert_int_equal(is25xp_read(16 * PAGE, PAGE, _buf, 0), PAGE);
+    assert_memory_equal(_buf, page, PAGE);
+
+    // a program only clears bits
+    is25xp_pagewrite(again, 16);
+    is25xp_read(16 * PAGE, PAGE, _buf, 0);
+    for (int i = 0; i < PAGE; i++)
+        assert_int_equal(_buf[i], page[i] & again[i]);
+    assert_true(sim_is25lp128_stats()->and_violations > 0);
+
+    is25xp_erase(1, 1);
+    assert_int_equal(mem[16 * PAGE], 0xFF);
+    is25xp_pagewrite(again, 16);
+    is25xp_read(16 * PAGE, PAGE, _buf, 0);
+    assert_memory_equal(_buf, again, PAGE);
+
+    assert_int_equal(sim_is25lp128_stats()->sector_programs[1], 3);
+    assert_int_equal(sim_is25lp128_stats()->sector_erases[1], 1);
+    assert_int_equal(sim_is25lp128_stats()->wel_violations, 0);
+    assert_int_equal(sim_is25lp128_stats()->busy_violations, 0);
+    assert_int_equal(sim_is25lp128_stats()->page_wraps, 0);
+}
+
+static void page_wrap_test(void ** state) {
+    (void)state;
+    uint8_t * mem = sim_is25lp128_memory();
+    uint8_t data[2 * PAGE];
+
+    _pattern(data, sizeof(data), 5);
+
+    // is25xp_write splits at the page boundaries
+    assert_int_equal(is25xp_write(0xF0, 0x130, data), 0x130);
+    is25xp_waitwritecomplete();
+    assert_memory_equal(&mem[0xF0], data, 0x130);
+    assert_int_equal(sim_is25lp128_stats()->programs, 3);
+    assert_int_equal(sim_is25lp128_stats()->page_wraps, 0);
+
+    // past the end of the page: back to its start
+    is25xp_writeenable();
+    _raw_pp(0x1080, data, 0x100);
+    is25xp_waitwritecomplete();
+    assert_memory_equal(&mem[0x1080], data, 0x80);
+    assert_memory_equal(&mem[0x1000], &data[0x80], 0x80);
+    assert_int_equal(sim_is25lp128_stats()->page_wraps, 1);
+
+    // more than a page: the last 256 bytes
+    is25xp_writeenable();
+    _raw_pp(0x2000, data, 2 * PAGE);
+    is25xp_waitwritecomplete();
+    assert_memory_equal(&mem[0x2000], &data[PAGE], PAGE);
+    assert_int_equal(sim_is25lp128_stats()->page_wraps, 2);
+}
+
+static void wip_test(void ** state) {
+    (void)state;
+    uint8_t * mem = sim_is25lp128_memory();
+    uint8_t page[PAGE];
+
+    memset(&mem[SECTOR], 0, SECTOR);
+    assert_int_equal(is25xp_erase_start(1, IS25_SE), 0);
+    assert_true(is25xp_busy());
+    assert_int_equal(is25xp_erase_start(2, IS25_SE), -EBUSY);
+    assert_int_equal(is25xp_read_status_register(0), IS25_SR_WIP | IS25_SR_WEL);
+
+    // tSER typical 70ms, everything but RDSR is ignored meanwhile
+    hal_advance_ns(69000000ULL);
+    assert_true(is25xp_busy());
+    is25xp_writeenable();
+    assert_int_equal(sim_is25lp128_stats()->busy_violations, 1);
+    hal_advance_ns(1000000ULL);
+    assert_false(is25xp_busy());
+    assert_int_equal(is25xp_read_status_register(0), 0);
+    assert_int_equal(mem[SECTOR], 0xFF);
+    assert_int_equal(mem[2 * SECTOR - 1], 0xFF);
+
+    // program without WREN
+    _pattern(page, PAGE, 0);
+    _raw_pp(SECTOR, page, PAGE);
+    assert_false(sim_is25lp128_busy());
+    assert_int_equal(sim_is25lp128_stats()->wel_violations, 1);
+    assert_int_equal(mem[SECTOR + 1], 0xFF);
+
+    // tPP typical 0.2ms
+    assert_int_equal(is25xp_pagewrite_start(page, SECTOR / PAGE), 0);
+    _irq();
+    assert_true(is25xp_busy());
+    hal_advance_ns(200000ULL);
+    assert_false(is25xp_busy());
+}
+
+static void erase_test(void ** state) {
+    (void)state;
+    uint64_t start = hal_now_ns();
+
+    // 8..15 BE32, 16..31 BE64, 32 SE
+    assert_int_equal(is25xp_erase(8, 25), 25);
+    assert_int_equal(sim_is25lp128_stats()->erases, 3);
+    assert_int_equal(sim_is25lp128_stats()->sector_erases[7], 0);
+    for (int s = 8; s <= 32; s++)
+        assert_int_equal(sim_is25lp128_stats()->sector_erases[s], 1);
+    assert_int_equal(sim_is25lp128_stats()->sector_erases[33], 0);
+    assert_int_equal(sim_is25lp128_wear(NULL), 1);
+
+    // 320ms of erase, polled every 100ms
+    assert_true(hal_now_ns() - start >= 320000000ULL);
+    assert_int_equal(sim_is25lp128_stats()->busy_violations, 0);
+}
+
+static void async_test(void ** state) {
+    (void)state;
+    uint8_t page[PAGE];
+
+    _pattern(page, PAGE, 9);
+    assert_int_equal(is25xp_pagewrite_start(page, 40), 0);
+    assert_false(is25xp_transfer_done());
+    _irq();
+    assert_true(is25xp_transfer_done());
+    assert_int_equal(_done, 1);
+
+    while (is25xp_busy())
+        hal_advance_ns(10000);
+
+    memset(_buf, 0, PAGE);
+    assert_int_equal(is25xp_read_start(40 * PAGE, PAGE, _buf), 0);
+    assert_int_equal(is25xp_read_start(40 * PAGE, PAGE, _buf), -EBUSY);
+    _irq();
+    assert_int_equal(_done, 2);
+    assert_memory_equal(_buf, page, PAGE);
+    assert_int_equal(is25xp_read_start(0, 0, _buf), -EINVAL);
+    assert_int_equal(hal_spi_stats(SPI8)->collisions, 0);
+}
+
+static void storage_test(void ** state) {
+    (void)state;
+    struct storage_driver_t * sdriver = storage_new_spi_flash_driver();
+    struct spi_flash_area_t farea = storage_new_spi_flash_area("spi1", SPI1_START_ADDR, 2 * SECTOR);
+    uint8_t * mem = sim_is25lp128_memory();
+    uint8_t block[512];
+
+    BOARD_SetSPIMux(0);
+    spi_mux_init(NULL, SystemCoreClock / 1000000U);
+    storage_set_spi_flash_area(sdriver, &farea);
+    assert_int_equal(storage_init_storage(sdriver), 0);
+    assert_int_equal(storage_erase_storage(sdriver), 0);
+
+    for (int i = 0; i < 2 * SECTOR / 512; i++) {
+        _pattern(block, sizeof(block), (uint8_t)i);
+        assert_int_equal(storage_write_data(sdriver, block, sizeof(block)), 1);
+    }
+    storage_flush_storage(sdriver);
+    for (int i = 0; i < 2 * SECTOR / 512; i++) {
+        _pattern(block, sizeof(block), (uint8_t)i);
+        assert_memory_equal(&mem[SPI1_START_ADDR + i * 512], block, sizeof(block));
+    }
+    assert_int_equal(storage_read_data(sdriver, _buf, 2 * SECTOR), 2 * SECTOR);
+    assert_memory_equal(_buf, &mem[SPI1_START_ADDR], 2 * SECTOR);
+
+    assert_int_equal(sim_is25lp128_stats()->sector_erases[SPI1_START_ADDR / SECTOR], 1);
+    assert_int_equal(sim_is25lp128_stats()->sector_programs[SPI1_START_ADDR / SECTOR], SECTOR / PAGE);
+    assert_int_equal(sim_is25lp128_stats()->and_violations, 0);
+    assert_int_equal(sim_is25lp128_stats()->unmuxed, 0);
+
+    // the mux goes back to the Gowin when idle: the flash is out of reach
+    hal_advance_ns(1000ULL * SPI_MUX_IDLE_US);
+    assert_false(spi_mux_poll());
+    assert_int_equal(hal_spi_mux(), 0);
+    assert_int_equal(is25xp_read(SPI1_START_ADDR, 16, _buf, 0), 16);
+    assert_int_equal(_buf[0], 0xFF);
+    assert_int_equal(sim_is25lp128_stats()->unmuxed, 1);
+}
+
+static void storage_v2_test(void ** state) {
+    (void)state;
+    struct storage_driver_t * sdriver = storage_new_spi_flash_driver();
+    struct spi_flash_area_t farea = storage_new_spi_flash_area("spi1", SPI1_START_ADDR, 2 * SECTOR);
+    uint8_t * mem = sim_is25lp128_memory() + SPI1_START_ADDR;
+    uint8_t data[3 * PAGE];
+    uint8_t head[10];
+
+    BOARD_SetSPIMux(0);
+    spi_mux_init(NULL, SystemCoreClock / 1000000U);
+    storage_set_spi_flash_area(sdriver, &farea);
+    assert_int_equal(storage_erase_storage(sdriver), 0);
+
+    // gathered: an unaligned start, an empty buffer, a page crossed
+    _pattern(data, sizeof(data), 3);
+    const struct storage_iovec_t out[] = { { data, 50 }, { data, 0 }, { data + 50, 400 } };
+    assert_int_equal(storage_pwritev_data(sdriver, 100, out, 3), 450);
+    assert_memory_equal(&mem[100], data, 450);
+    assert_int_equal(mem[99], 0xFF);
+    assert_int_equal(mem[550], 0xFF);
+    assert_int_equal(sim_is25lp128_stats()->sector_programs[SPI1_START_ADDR / SECTOR], 3);
+
+    // whole pages straight from the buffer, the cursor is left alone
+    assert_int_equal(storage_pwrite_data(sdriver, 4 * PAGE, data, 2 * PAGE), 2 * PAGE);
+    assert_memory_equal(&mem[4 * PAGE], data, 2 * PAGE);
+    assert_int_equal(sim_is25lp128_stats()->sector_programs[SPI1_START_ADDR / SECTOR], 5);
+    assert_int_equal(farea.offset, 0);
+
+    // scattered
+    memset(_buf, 0, sizeof(_buf));
+    const struct storage_iovec_t in[] = { { head, sizeof(head) }, { _buf, 440 } };
+    assert_int_equal(storage_preadv_data(sdriver, 100, in, 2), 450);
+    assert_memory_equal(head, data, sizeof(head));
+    assert_memory_equal(_buf, data + sizeof(head), 440);
+    assert_int_equal(storage_pread_data(sdriver, 4 * PAGE, _buf, 2 * PAGE), 2 * PAGE);
+    assert_memory_equal(_buf, data, 2 * PAGE);
+
+    // not past the area
+    assert_int_equal(storage_pread_data(sdriver, 2 * SECTOR - 10, _buf, 20), -1);
+    assert_int_equal(storage_pwrite_data(sdriver, 2 * SECTOR, data, 1), -1);
+    assert_int_equal(sim_is25lp128_stats()->and_violations, 0);
+    assert_int_equal(spi_mux_held(SPI_MUX_CLIENT_STORAGE), 0);
+}
+
+static void storage_async_test(void ** state) {
+    (void)state;
+    struct storage_driver_t * sdriver = storage_new_spi_flash_driver();
+    struct spi_flash_area_t farea = storage_new_spi_flash_area("spi1", SPI1_START_ADDR, 2 * SECTOR);
+    uint8_t * mem = sim_is25lp128_memory() + SPI1_START_ADDR;
+    uint8_t data[3 * PAGE];
+    uint8_t tail[100];
+
+    BOARD_SetSPIMux(0);
+    spi_mux_init(NULL, SystemCoreClock / 1000000U);
+    storage_set_spi_flash_area(sdriver, &farea);
+    assert_int_equal(storage_erase_storage(sdriver), 0);
+
+    _pattern(data, sizeof(data), 5);
+    _pattern(tail, sizeof(tail), 77);
+    const struct storage_iovec_t out[] = { { data, sizeof(data) }, { tail, sizeof(tail) } };
+    struct storage_req_t wr = { .op = STORAGE_REQ_WRITE, .offset = PAGE, .iov = out, .iovcnt = 2,
+                                .done = _request_done };
+    memset(_buf, 0, sizeof(_buf));
+    const struct storage_iovec_t in[] = { { _buf, 2 * PAGE }, { _buf + 2 * PAGE, 2 * PAGE } };
+    struct storage_req_t rd = { .op = STORAGE_REQ_READ, .offset = 0, .iov = in, .iovcnt = 2,
+                                .done = _request_done };
+
+    // queued in order, nothing on the bus until polled
+    assert_int_equal(storage_submit_request(sdriver, &wr), 0);
+    assert_int_equal(storage_submit_request(sdriver, &rd), 0);
+    assert_int_equal(storage_submit_request(sdriver, &rd), -1);
+    assert_true(wr.busy);
+    assert_int_equal(sim_is25lp128_stats()->sector_programs[SPI1_START_ADDR / SECTOR], 0);
+
+    int polls = 0;
+    while (rd.busy) {
+        storage_poll_requests(sdriver);
+        _irq();
+        hal_advance_ns(10000);
+        assert_true(++polls < 1000);
+    }
+    assert_false(wr.busy);
+    assert_int_equal(wr.result, sizeof(data) + sizeof(tail));
+    assert_int_equal(rd.result, 4 * PAGE);
+    assert_int_equal(_requests, 2);
+    assert_int_equal(sim_is25lp128_stats()->sector_programs[SPI1_START_ADDR / SECTOR], 4);
+
+    assert_memory_equal(&mem[PAGE], data, sizeof(data));
+    assert_memory_equal(&mem[4 * PAGE], tail, sizeof(tail));
+    assert_memory_equal(_buf, mem, 4 * PAGE);
+    assert_int_equal(_buf[0], 0xFF);
+    assert_int_equal(sim_is25lp128_stats()->busy_violations, 0);
+    assert_int_equal(sim_is25lp128_stats()->and_violations, 0);
+    assert_int_equal(spi_mux_held(SPI_MUX_CLIENT_STORAGE), 0);
+    assert_int_equal(storage_poll_requests(sdriver), 0);
+
+    // outside of the area: not submitted
+    struct storage_req_t past = { .op = STORAGE_REQ_READ, .offset = 2 * SECTOR, .iov = in, .iovcnt = 1 };
+    assert_int_equal(storage_submit_request(sdriver, &past), -1);
+    assert_false(past.busy);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest is25xp_tests[] = {
+        cmocka_unit_test_setup(readid_test,    setup),
+        cmocka_unit_test_setup(read_test,      setup),
+        cmocka_unit_test_setup(program_test,   setup),
+        cmocka_unit_test_setup(page_wrap_test, setup),
+        cmocka_unit_test_setup(wip_test,       setup),
+        cmocka_unit_test_setup(erase_test,     setup),
+        cmocka_unit_test_setup(async_test,     setup),
+        cmocka_unit_test_setup(storage_test,   setup),
+        cmocka_unit_test_setup(storage_v2_test, setup),
+        cmocka_unit_test_setup(storage_async_test, setup),
+    };
+
+    return cmocka_run_group_tests(is25xp_tests, NULL, NULL);
+}
@@ -0,0 +1,138 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_loop_stats.c  - native
+ * Author              : Barco
+ * created             : 08/10/2022
+ * Description         : superloop cycle accounting test, fake cycle counter
+ * History:
+ * 8/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "logger.h"
+
+#include "data_map.h"
+
+static u32 fake_cycles = 0;
+#define LOOP_STATS_NOW() (fake_cycles)
+#include "loop_stats.h"
+
+#define CORE_CLK 96000000U
+
+static int setup(void ** state) {
+    (void)state;
+    memset(&Main.PerfCounters, 0, sizeof(Main.PerfCounters));
+    fake_cycles = 1000;
+    loop_stats_init(CORE_CLK);
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+// whole iteration: measured from the 2nd call on, also feeds the PerfCounters
+void iteration_test(void ** states) {
+    const LoopStatsEntry_t * it = &Main.LoopStats.Task[LOOP_TASK_ITERATION];
+
+    assert_true(loop_stats_iteration(fake_cycles));
+    assert_int_equal(it->Count, 0);
+
+    fake_cycles += 960; // 10us
+    loop_stats_iteration(fake_cycles);
+    fake_cycles += 96; // 1us
+    loop_stats_iteration(fake_cycles);
+
+    assert_int_equal(it->Count, 2);
+    assert_int_equal(it->Min, 96);
+    assert_int_equal(it->Max, 960);
+    assert_int_equal(it->Histogram[6], 1); // 64..127
+    assert_int_equal(it->Histogram[9], 1); // 512..1023
+    assert_int_equal(Main.PerfCounters.MainLoopCount, 3);
+    assert_int_equal(Main.PerfCounters.MainLoopMaxUs, 10);
+    assert_int_equal(Main.LoopStats.CoreClockHz, CORE_CLK);
+}
+
+// ------------------------------------------------------------------------------
+// cycle counter wraps between two iterations
+void iteration_wrap_test(void ** states) {
+    fake_cycles = 0xFFFFFF00u;
+    loop_stats_iteration(fake_cycles);
+    fake_cycles += 0x200; // wraps
+    loop_stats_iteration(fake_cycles);
+
+    assert_int_equal(Main.LoopStats.Task[LOOP_TASK_ITERATION].Max, 0x200);
+}
+
+// ------------------------------------------------------------------------------
+// tasks are timed 1 per 2^SampleShift iterations
+void sample_rate_test(void ** states) {
+    int sampled = 0;
+
+    assert_int_equal(Main.LoopStats.SampleShift, LOOPSTATS_SAMPLE_SHIFT);
+    for (int i = 0; i < 64; i++) {
+        bool sample = loop_stats_iteration(fake_cycles);
+        LOOP_STATS_RUN(sample, LOOP_TASK_I2C, fake_cycles += 100);
+        sampled += sample;
+    }
+    assert_int_equal(sampled, 64 >> LOOPSTATS_SAMPLE_SHIFT);
+    assert_int_equal(Main.LoopStats.Task[LOOP_TASK_I2C].Count, 64 >> LOOPSTATS_SAMPLE_SHIFT);
+    assert_int_equal(Main.LoopStats.Task[LOOP_TASK_I2C].Min, 100);
+
+    assert_true(loop_stats_set_sample_shift(0));
+    assert_true(loop_stats_iteration(fake_cycles));
+    assert_true(loop_stats_iteration(fake_cycles));
+    assert_false(loop_stats_set_sample_shift(LOOPSTATS_SHIFT_MAX + 1));
+    assert_int_equal(Main.LoopStats.SampleShift, 0);
+}
+
+// ------------------------------------------------------------------------------
+void histogram_bounds_test(void ** states) {
+    const LoopStatsEntry_t * spi = &Main.LoopStats.Task[LOOP_TASK_SPI];
+
+    loop_stats_add(LOOP_TASK_SPI, 0);
+    loop_stats_add(LOOP_TASK_SPI, 1);
+    loop_stats_add(LOOP_TASK_SPI, 0xFFFFFFFFu);
+    loop_stats_add(LOOP_TASK_SPI, 1u << (LOOPSTATS_BUCKETS - 1));
+
+    assert_int_equal(spi->Histogram[0], 2);
+    assert_int_equal(spi->Histogram[LOOPSTATS_BUCKETS - 1], 2);
+    assert_int_equal(spi->Min, 0);
+    assert_int_equal(spi->Max, 0xFFFFFFFFu);
+}
+
+// ------------------------------------------------------------------------------
+// mean on read, reset applied at the start of the next iteration
+void mean_reset_test(void ** states) {
+    const LoopStatsEntry_t * gpio = &Main.LoopStats.Task[LOOP_TASK_GPIO];
+
+    loop_stats_add(LOOP_TASK_GPIO, 10);
+    loop_stats_add(LOOP_TASK_GPIO, 31);
+    loop_stats_update_mean();
+    assert_int_equal(gpio->Mean, 20);
+    assert_int_equal(Main.LoopStats.Task[LOOP_TASK_COMM].Mean, 0);
+
+    loop_stats_request_reset();
+    assert_int_equal(gpio->Count, 2);
+    loop_stats_iteration(fake_cycles);
+    assert_int_equal(gpio->Count, 0);
+    assert_int_equal(gpio->Sum, 0);
+    assert_int_equal(gpio->Min, UINT32_MAX);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest tests_loop_stats[] = {
+        cmocka_unit_test_setup(iteration_test,        setup),
+        cmocka_unit_test_setup(iteration_wrap_test,   setup),
+        cmocka_unit_test_setup(sample_rate_test,      setup),
+        cmocka_unit_test_setup(histogram_bounds_test, setup),
+        cmocka_unit_test_setup(mean_reset_test,       setup),
+    };
+
+    return cmocka_run_group_tests(tests_loop_stats, NULL, NULL);
+}
@@ -0,0 +1,307 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_scheduler.c  - native
+ * Author              : Barco
+ * created             : 09/10/2022
+ * Description         : scheduler test, native port (idle hook instead of WFI)
+ *                       with fake tasks and with the application task set
+ * History:
+ * 9/10/2022 - initial
+ *******************************************************************************/
+#include "unit_test_comm_protocol_helper.h"
+#include "unit_test_comm_protocol_mock.h"
+
+#include "comm/gowin_protocol.h"
+#include "scheduler.h"
+#include "tasks.h"
+#include "timer_wheel.h"
+
+#define EV_A (1UL << 0)
+#define EV_B (1UL << 1)
+
+static int runs[3];
+static int busy_runs = 0;
+static int idle_calls = 0;
+static int gpio_calls = 0;
+static int spi_calls = 0;
+
+// ------------------------------------------------------------------------------
+// mocked, not linked: board access
+void i2c_update() {
+}
+
+bool spi_master_update() {
+    spi_calls++;
+    return false;
+}
+
+void _handle_gpio_request(void) {
+    gpio_calls++;
+}
+
+// ------------------------------------------------------------------------------
+static bool _task0(void) {
+    runs[0]++;
+    return false;
+}
+
+static bool _task1(void) {
+    runs[1]++;
+    return false;
+}
+
+static bool _task2(void) {
+    runs[2]++;
+    return false;
+}
+
+static bool _task_busy(void) {
+    return ++busy_runs < 3;
+}
+
+static bool _task_post_b(void) {
+    runs[0]++;
+    sched_post(EV_B);
+    return false;
+}
+
+static const SchedTask_t fake_tasks[] = {
+    { "t0", EV_A,        LOOP_TASK_COMM, _task0 },
+    { "t1", EV_B,        LOOP_TASK_I2C,  _task1 },
+    { "t2", EV_A | EV_B, LOOP_TASK_SPI,  _task2 },
+};
+
+static void _drain(void) {
+    while (sched_run_once(false)) {
+    }
+}
+
+static void _idle_hook(void) {
+    idle_calls++;
+    sched_post(EV_B); // interrupt during sleep
+}
+
+static int setup(void ** state) {
+    (void)state;
+    memset(runs, 0, sizeof(runs));
+    busy_runs = 0;
+    idle_calls = 0;
+    gpio_calls = 0;
+    spi_calls = 0;
+    memset(&Main.PerfCounters, 0, sizeof(Main.PerfCounters));
+    sched_set_idle_hook(NULL);
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+// every task runs once after init, then only on its events
+void events_test(void ** states) {
+    sched_init(fake_tasks, 3);
+    assert_true(sched_run_once(false));
+    assert_int_equal(runs[0], 1);
+    assert_int_equal(runs[1], 1);
+    assert_int_equal(runs[2], 1);
+    assert_false(sched_run_once(false));
+
+    sched_post(EV_A);
+    assert_true(sched_run_once(false));
+    assert_int_equal(runs[0], 2);
+    assert_int_equal(runs[1], 1);
+    assert_int_equal(runs[2], 2);
+
+    sched_post(EV_B);
+    sched_post(EV_B); // events collapse
+    assert_true(sched_run_once(false));
+    assert_false(sched_run_once(false));
+    assert_int_equal(runs[1], 2);
+    assert_int_equal(runs[2], 3);
+}
+
+// ------------------------------------------------------------------------------
+// a task reporting more work runs again without event
+void busy_test(void ** states) {
+    const SchedTask_t tasks[] = {
+        { "busy", EV_A, LOOP_TASK_GOWIN, _task_busy },
+        { "t1",   EV_B, LOOP_TASK_I2C,   _task1     },
+    };
+
+    sched_init(tasks, 2);
+    _drain();
+    assert_int_equal(busy_runs, 3);
+    assert_int_equal(runs[1], 1);
+}
+
+// ------------------------------------------------------------------------------
+// events posted during a pass are handled in the next pass
+void post_in_pass_test(void ** states) {
+    const SchedTask_t tasks[] = {
+        { "post", EV_A, LOOP_TASK_COMM, _task_post_b },
+        { "t1",   EV_B, LOOP_TASK_I2C,  _task1       },
+    };
+
+    sched_init(tasks, 2);
+    _drain();
+    runs[1] = 0;
+
+    sched_post(EV_A);
+    assert_true(sched_run_once(false));
+    assert_int_equal(runs[1], 0);
+    assert_true(sched_run_once(false));
+    assert_int_equal(runs[1], 1);
+    assert_false(sched_run_once(false));
+}
+
+// ------------------------------------------------------------------------------
+// sleep only without pending events, the 'interrupt' wakes the task
+void idle_test(void ** states) {
+    sched_init(fake_tasks, 3);
+    sched_set_idle_hook(_idle_hook);
+
+    sched_idle(); // init posted everything
+    assert_int_equal(idle_calls, 0);
+    _drain();
+
+    sched_idle();
+    assert_int_equal(idle_calls, 1);
+    assert_int_equal(Main.PerfCounters.IdleSleeps, 1);
+    assert_true(sched_run_once(false));
+    assert_int_equal(runs[1], 2);
+}
+
+// ------------------------------------------------------------------------------
+// sampled passes account the tasks in LoopStats
+void loop_stats_test(void ** states) {
+    loop_stats_init(96000000U);
+    sched_init(fake_tasks, 3);
+    assert_true(sched_run_once(true));
+    assert_int_equal(Main.LoopStats.Task[LOOP_TASK_COMM].Count, 1);
+    assert_int_equal(Main.LoopStats.Task[LOOP_TASK_SPI].Count, 1);
+    sched_post(EV_B);
+    assert_true(sched_run_once(false));
+    assert_int_equal(Main.LoopStats.Task[LOOP_TASK_I2C].Count, 1);
+}
+
+// ------------------------------------------------------------------------------
+// application task set: MainCPU byte write via the rx event, reply sent
+void task_set_maincpu_test(void ** states) {
+    const u8 ByteWrite[] = { CMD_WRITE_BYTE, BYTE_TEST_REG, 0x5A };
+    const u8 ByteWriteReply[] = { COMM_START_BYTE, ADR, CMD_WRITE_BYTE, 0x01, 0x22, COMM_STOP_BYTE };
+
+    initialize_global_data_map();
+    GOWIN_Queue_Init();
+    COMM_DATA[UART1].MsgCount = 0;
+    sched_init(APP_TASKS, APP_TASKS_NUM);
+    _drain();
+    assert_int_equal(gpio_calls, 1);
+    memset(unitTest_SendBuf, 0, sizeof(unitTest_SendBuf));
+
+    // nothing posted -> nothing runs
+    feed_RingBuffer(ByteWrite, sizeof(ByteWrite), false);
+    assert_false(sched_run_once(false));
+
+    sched_post(SCHED_EV_MAINCPU_RX);
+    _drain();
+    assert_memory_equal(unitTest_SendBuf, ByteWriteReply, sizeof(ByteWriteReply));
+    assert_int_equal(Main.Debug.byteTestRegister, 0x5A);
+    assert_int_equal(COMM_DATA[UART1].MsgCount, 0);
+    // handled write wakes the request consumers
+    assert_int_equal(gpio_calls, 2);
+    assert_int_equal(spi_calls, 2);
+}
+
+// ------------------------------------------------------------------------------
+// Gowin awaiting a reply sleeps, the reply timer wakes it on the timeout
+void task_set_gowin_timeout_test(void ** states) {
+    initialize_global_data_map();
+    GOWIN_Queue_Init();
+    sched_init(APP_TASKS, APP_TASKS_NUM);
+    _drain();
+
+    GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_EDID);
+    sched_post(SCHED_EV_GOWIN_RX);
+    _drain();
+    assert_false(sched_run_once(false));
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_EDID);
+
+    timer_fake_advance(GOWIN_REPLY_TIMEOUT_MS - 1);
+    _drain();
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_EDID);
+    assert_int_equal(Main.PerfCounters.GowinTimeout, 0);
+
+    timer_fake_advance(1);
+    _drain();
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_START);
+    assert_int_equal(Main.PerfCounters.GowinTimeout, 1);
+    sched_deinit();
+}
+
+// ------------------------------------------------------------------------------
+// EDID write in flight: the MainCPU is served meanwhile, the TX completion
+// (interrupt) wakes the Gowin task to wait for the ACK
+void task_set_gowin_tx_test(void ** states) {
+    const u8 ByteWrite[] = { CMD_WRITE_BYTE, BYTE_TEST_REG, 0x5A };
+    const u8 ByteWriteReply[] = { COMM_START_BYTE, ADR, CMD_WRITE_BYTE, 0x01, 0x22, COMM_STOP_BYTE };
+    u8 tx[GOWIN_TX_RING_SIZE];
+
+    initialize_global_data_map();
+    GOWIN_Queue_Init();
+    COMM_DATA[UART1].MsgCount = 0;
+    GOWIN_Protocol_state_set(GOWIN_WAIT_FOR_START);
+    GOWIN_TX_fake_transmit(tx, sizeof(tx));
+    sched_init(APP_TASKS, APP_TASKS_NUM);
+    _drain();
+
+    GOWIN_Protocol_edid_write(0);
+    sched_post(SCHED_EV_GOWIN_RX);
+    _drain();
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_TX);
+    assert_false(sched_run_once(false));
+
+    memset(unitTest_SendBuf, 0, sizeof(unitTest_SendBuf));
+    feed_RingBuffer(ByteWrite, sizeof(ByteWrite), false);
+    sched_post(SCHED_EV_MAINCPU_RX);
+    _drain();
+    assert_memory_equal(unitTest_SendBuf, ByteWriteReply, sizeof(ByteWriteReply));
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_TX);
+
+    assert_int_equal(GOWIN_TX_fake_transmit(tx, sizeof(tx)), 3 + EDID_SIZE);
+    _drain();
+    assert_int_equal(GOWIN_Protocol_state_get(), GOWIN_WAIT_FOR_EDID_WRITE_ACK);
+    sched_deinit();
+}
+
+// ------------------------------------------------------------------------------
+// the tick timer posts SCHED_EV_TICK every SCHED_TICK_MS
+void tick_test(void ** states) {
+    const SchedTask_t tasks[] = {
+        { "tick", SCHED_EV_TICK, LOOP_TASK_GPIO, _task0 },
+    };
+
+    sched_init(tasks, 1);
+    _drain();
+    timer_fake_advance(SCHED_TICK_MS - 1);
+    assert_false(sched_run_once(false));
+    timer_fake_advance(1);
+    assert_true(sched_run_once(false));
+    assert_int_equal(runs[0], 2);
+
+    sched_deinit();
+    timer_fake_advance(SCHED_TICK_MS);
+    assert_false(sched_run_once(false));
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest tests_scheduler[] = {
+        cmocka_unit_test_setup(events_test,                 setup),
+        cmocka_unit_test_setup(busy_test,                   setup),
+        cmocka_unit_test_setup(post_in_pass_test,           setup),
+        cmocka_unit_test_setup(idle_test,                   setup),
+        cmocka_unit_test_setup(loop_stats_test,             setup),
+        cmocka_unit_test_setup(task_set_maincpu_test,       setup),
+        cmocka_unit_test_setup(task_set_gowin_timeout_test, setup),
+        cmocka_unit_test_setup(task_set_gowin_tx_test,      setup),
+        cmocka_unit_test_setup(tick_test,                   setup),
+    };
+
+    return cmocka_run_group_tests(tests_scheduler, NULL, NULL);
+}
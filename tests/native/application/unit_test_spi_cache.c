@@ -0,0 +1,254 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_spi_cache.c  - native
+ * Author              : Barco
+ * created             : 18/10/2022
+ * Description         : spi flash page cache: hits and misses, partial pages,
+ *                       LRU eviction, invalidation on program/erase, epoch
+ *                       of asynchronous fills, long reads not cached
+ * History:
+ * 18/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "spi_cache.h"
+
+#define FLASH_SIZE  (64 * SPI_CACHE_PAGE_SIZE)
+
+static uint8_t _flash[FLASH_SIZE];
+static int _reads = 0;          // is25xp_read calls
+static size_t _read_bytes = 0;
+static int _read_error = 0;
+static int _hits = 0, _misses = 0;
+
+// ------------------------------------------------------------------------------
+// mocked, not linked: is25xp.c on the simulated flash
+ssize_t is25xp_read(off_t offset,
+                    size_t nbytes,
+                    uint8_t * buffer,
+                    uint8_t verbose) {
+    (void)verbose;
+    assert_true((size_t)offset + nbytes <= FLASH_SIZE);
+    if (_read_error)
+        return _read_error;
+    memcpy(buffer, &_flash[offset], nbytes);
+    _reads++;
+    _read_bytes += nbytes;
+    return (ssize_t)nbytes;
+}
+
+static void _count(bool hit) {
+    if (hit)
+        _hits++;
+    else
+        _misses++;
+}
+
+// page program: only clears bits
+static void _program(uint32_t page,
+                     uint8_t value) {
+    for (uint32_t i = 0; i < SPI_CACHE_PAGE_SIZE; i++)
+        _flash[page * SPI_CACHE_PAGE_SIZE + i] &= value;
+}
+
+// ------------------------------------------------------------------------------
+static int setup(void ** state) {
+    (void)state;
+    for (uint32_t i = 0; i < FLASH_SIZE; i++)
+        _flash[i] = (uint8_t)(i ^ (i >> 8));
+    _reads = 0;
+    _read_bytes = 0;
+    _read_error = 0;
+    _hits = 0;
+    _misses = 0;
+    spi_cache_init(_count);
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+static void hit_miss_test(void ** state) {
+    (void)state;
+    uint8_t buf[SPI_CACHE_PAGE_SIZE];
+
+    // the partition context: one page read, served from the cache again
+    assert_int_equal(spi_cache_read(0x310, 100, buf), 100);
+    assert_memory_equal(buf, &_flash[0x310], 100);
+    assert_int_equal(_reads, 1);
+    assert_int_equal(_read_bytes, SPI_CACHE_PAGE_SIZE);
+
+    assert_int_equal(spi_cache_read(0x300, SPI_CACHE_PAGE_SIZE, buf), SPI_CACHE_PAGE_SIZE);
+    assert_memory_equal(buf, &_flash[0x300], SPI_CACHE_PAGE_SIZE);
+    assert_int_equal(_reads, 1);
+
+    assert_int_equal(spi_cache_stats()->hits, 1);
+    assert_int_equal(spi_cache_stats()->misses, 1);
+    assert_int_equal(_hits, 1);
+    assert_int_equal(_misses, 1);
+
+    // the 0x61 readback looks pages up
+    assert_non_null(spi_cache_lookup(3));
+    assert_memory_equal(spi_cache_lookup(3), &_flash[0x300], SPI_CACHE_PAGE_SIZE);
+    assert_null(spi_cache_lookup(4));
+    assert_int_equal(spi_cache_stats()->hits, 3);
+    assert_int_equal(spi_cache_stats()->misses, 2);
+}
+
+static void partial_page_test(void ** state) {
+    (void)state;
+    uint8_t buf[SPI_CACHE_PAGE_SIZE];
+
+    // across a page boundary: both pages cached
+    assert_int_equal(spi_cache_read(0x1F0, 200, buf), 200);
+    assert_memory_equal(buf, &_flash[0x1F0], 200);
+    assert_int_equal(_reads, 2);
+    assert_int_equal(spi_cache_stats()->misses, 2);
+
+    assert_int_equal(spi_cache_read(0x200, 16, buf), 16);
+    assert_memory_equal(buf, &_flash[0x200], 16);
+    assert_int_equal(spi_cache_read(0x1FF, 2, buf), 2);
+    assert_memory_equal(buf, &_flash[0x1FF], 2);
+    assert_int_equal(_reads, 2);
+    assert_int_equal(spi_cache_stats()->hits, 3);
+
+    // a read error is passed on, nothing cached
+    _read_error = -EIO;
+    assert_int_equal(spi_cache_read(0x800, 16, buf), -EIO);
+    _read_error = 0;
+    assert_null(spi_cache_lookup(8));
+}
+
+static void lru_test(void ** state) {
+    (void)state;
+    uint8_t buf[16];
+
+    for (uint32_t page = 0; page < SPI_CACHE_PAGES; page++)
+        spi_cache_read(page * SPI_CACHE_PAGE_SIZE, sizeof(buf), buf);
+    assert_int_equal(_reads, SPI_CACHE_PAGES);
+
+    // page 0 used again: page 1 is the least recently used
+    spi_cache_read(0, sizeof(buf), buf);
+    spi_cache_read(SPI_CACHE_PAGES * SPI_CACHE_PAGE_SIZE, sizeof(buf), buf);
+    assert_int_equal(_reads, SPI_CACHE_PAGES + 1);
+
+    assert_non_null(spi_cache_lookup(0));
+    assert_null(spi_cache_lookup(1));
+    assert_non_null(spi_cache_lookup(2));
+    assert_non_null(spi_cache_lookup(SPI_CACHE_PAGES));
+
+    // a lookup counts as a use too
+    spi_cache_read((SPI_CACHE_PAGES + 1) * SPI_CACHE_PAGE_SIZE, sizeof(buf), buf);
+    assert_null(spi_cache_lookup(3));
+    assert_non_null(spi_cache_lookup(2));
+}
+
+static void invalidate_test(void ** state) {
+    (void)state;
+    uint8_t buf[SPI_CACHE_PAGE_SIZE];
+
+    for (uint32_t page = 16; page < 20; page++)
+        spi_cache_read(page * SPI_CACHE_PAGE_SIZE, SPI_CACHE_PAGE_SIZE, buf);
+
+    // page program of 17 and 18, as storage_spi_flash writes 512 bytes
+    spi_cache_invalidate(17, 2);
+    _program(17, 0x0F);
+    _program(18, 0x00);
+    assert_int_equal(spi_cache_stats()->invalidated, 2);
+
+    spi_cache_read(17 * SPI_CACHE_PAGE_SIZE, SPI_CACHE_PAGE_SIZE, buf);
+    assert_memory_equal(buf, &_flash[17 * SPI_CACHE_PAGE_SIZE], SPI_CACHE_PAGE_SIZE);
+    assert_non_null(spi_cache_lookup(16));
+    assert_non_null(spi_cache_lookup(19));
+    assert_null(spi_cache_lookup(18));
+
+    // 4k sector erase
+    spi_cache_invalidate(16, 16);
+    assert_null(spi_cache_lookup(16));
+    assert_null(spi_cache_lookup(17));
+    assert_null(spi_cache_lookup(19));
+    assert_int_equal(spi_cache_stats()->invalidated, 5);
+
+    // nothing below the range
+    spi_cache_read(0, SPI_CACHE_PAGE_SIZE, buf);
+    spi_cache_invalidate(1, 0xFFFF);
+    assert_non_null(spi_cache_lookup(0));
+}
+
+static void epoch_test(void ** state) {
+    (void)state;
+    uint8_t page[SPI_CACHE_PAGE_SIZE];
+
+    // 0x61 read in flight while the storage programs the page: not cached
+    uint32_t epoch = spi_cache_epoch();
+    memcpy(page, &_flash[5 * SPI_CACHE_PAGE_SIZE], sizeof(page));
+    spi_cache_invalidate(5, 1);
+    _program(5, 0x00);
+    spi_cache_fill(5, page, epoch);
+    assert_null(spi_cache_lookup(5));
+
+    // read after the program: cached
+    epoch = spi_cache_epoch();
+    memcpy(page, &_flash[5 * SPI_CACHE_PAGE_SIZE], sizeof(page));
+    spi_cache_fill(5, page, epoch);
+    assert_non_null(spi_cache_lookup(5));
+    assert_memory_equal(spi_cache_lookup(5), &_flash[5 * SPI_CACHE_PAGE_SIZE], SPI_CACHE_PAGE_SIZE);
+
+    // filled again (READ after its PREFETCH): one entry
+    spi_cache_fill(5, page, epoch);
+    spi_cache_invalidate(5, 1);
+    assert_int_equal(spi_cache_stats()->invalidated, 1);
+
+    // init: empty
+    spi_cache_fill(6, page, spi_cache_epoch());
+    spi_cache_init(_count);
+    assert_null(spi_cache_lookup(6));
+    assert_int_equal(spi_cache_stats()->hits, 0);
+    assert_int_equal(spi_cache_stats()->misses, 1);
+}
+
+static void scan_test(void ** state) {
+    (void)state;
+    uint8_t buf[8 * SPI_CACHE_PAGE_SIZE];
+
+    // crc of a partition: 512 byte blocks, the misses read through
+    spi_cache_read(2 * SPI_CACHE_PAGE_SIZE, 16, buf);
+    _reads = 0;
+    _read_bytes = 0;
+    assert_int_equal(spi_cache_read(0, 512, buf), 512);
+    assert_int_equal(spi_cache_read(512, 512, buf + 512), 512);
+    assert_memory_equal(buf, _flash, 1024);
+    assert_int_equal(_reads, 2); // pages 0+1, page 3: page 2 from the cache
+    assert_int_equal(_read_bytes, 3 * SPI_CACHE_PAGE_SIZE);
+    assert_null(spi_cache_lookup(0));
+    assert_null(spi_cache_lookup(3));
+    assert_non_null(spi_cache_lookup(2));
+
+    // longer and unaligned: one read
+    _reads = 0;
+    assert_int_equal(spi_cache_read(0x480, 5 * SPI_CACHE_PAGE_SIZE, buf), 5 * SPI_CACHE_PAGE_SIZE);
+    assert_memory_equal(buf, &_flash[0x480], 5 * SPI_CACHE_PAGE_SIZE);
+    assert_int_equal(_reads, 1);
+    assert_int_equal(spi_cache_stats()->hits, 2);
+    assert_int_equal(spi_cache_stats()->misses, 2 + 3 + 1 + 6);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest spi_cache_tests[] = {
+        cmocka_unit_test_setup(hit_miss_test,     setup),
+        cmocka_unit_test_setup(partial_page_test, setup),
+        cmocka_unit_test_setup(lru_test,          setup),
+        cmocka_unit_test_setup(invalidate_test,   setup),
+        cmocka_unit_test_setup(epoch_test,        setup),
+        cmocka_unit_test_setup(scan_test,         setup),
+    };
+
+    return cmocka_run_group_tests(spi_cache_tests, NULL, NULL);
+}
@@ -0,0 +1,226 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_spi_mux.c  - native
+ * Author              : Barco
+ * created             : 18/10/2022
+ * Description         : spi flash mux leases: one switch for consecutive
+ *                       leases, idle release, the Gowin loading its bitfile
+ *                       and reconfigure requests, hold-time statistics, the
+ *                       load window across a wrap of the cycle counter
+ * History:
+ * 18/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "spi_mux.h"
+
+static uint8_t _mux = 0xFF;
+static int _mux_writes = 0;
+static bool _ready = true;
+static uint32_t _now = 0;
+static uint32_t _step = 0;      // clock advance per read, for the waits
+static uint32_t _events[SPI_MUX_EV_REVOKE + 1];
+
+// ------------------------------------------------------------------------------
+// mocked, not linked: pin_mux.c and the DWT cycle counter
+void BOARD_SetSPIMux(uint8_t on) {
+    _mux = on;
+    _mux_writes++;
+}
+
+bool BOARD_Ready_Gowin(void) {
+    return _ready;
+}
+
+uint32_t spi_mux_test_now(void) {
+    _now += _step;
+    return _now;
+}
+
+static void _event(spi_mux_event_t ev,
+                   uint32_t value) {
+    if (ev == SPI_MUX_EV_HOLD)
+        _events[ev] = value;
+    else
+        _events[ev]++;
+}
+
+// ------------------------------------------------------------------------------
+static int setup(void ** state) {
+    (void)state;
+    _ready = true;
+    _now = 1000;
+    _step = 0;
+    memset(_events, 0, sizeof(_events));
+    spi_mux_init(_event, 1); // 1 cycle per us
+    _mux_writes = 0;
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+static void linger_test(void ** state) {
+    (void)state;
+
+    assert_int_equal(_mux, 0);
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0));
+    assert_int_equal(_mux, 1);
+    spi_mux_release(SPI_MUX_CLIENT_QUEUE);
+
+    // consecutive leases keep the mux
+    _now += 100;
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, 0));
+    spi_mux_release(SPI_MUX_CLIENT_STORAGE);
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0));
+    spi_mux_release(SPI_MUX_CLIENT_QUEUE);
+    assert_int_equal(_mux_writes, 1);
+    assert_int_equal(spi_mux_stats()->switches, 1);
+    assert_int_equal(spi_mux_stats()->leases, 3);
+
+    // idle release
+    _now += SPI_MUX_IDLE_US - 1;
+    assert_true(spi_mux_poll());
+    assert_int_equal(_mux, 1);
+    _now += 1;
+    assert_false(spi_mux_poll());
+    assert_int_equal(_mux, 0);
+    assert_int_equal(spi_mux_stats()->hold_max_us, 100 + SPI_MUX_IDLE_US);
+
+    assert_int_equal(_events[SPI_MUX_EV_SWITCH], 1);
+    assert_int_equal(_events[SPI_MUX_EV_LEASE], 3);
+    assert_int_equal(_events[SPI_MUX_EV_HOLD], 100 + SPI_MUX_IDLE_US);
+}
+
+static void nested_test(void ** state) {
+    (void)state;
+
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, 0));
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, 0)); // crc over the block reads
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0));
+    assert_int_equal(spi_mux_held(SPI_MUX_CLIENT_STORAGE), 2);
+
+    spi_mux_release(SPI_MUX_CLIENT_QUEUE);
+    spi_mux_release(SPI_MUX_CLIENT_STORAGE);
+    _now += SPI_MUX_IDLE_US;
+    assert_true(spi_mux_poll()); // still leased
+
+    spi_mux_release(SPI_MUX_CLIENT_STORAGE);
+    spi_mux_release(SPI_MUX_CLIENT_STORAGE); // one too many, ignored
+    assert_int_equal(spi_mux_held(SPI_MUX_CLIENT_STORAGE), 0);
+    assert_true(spi_mux_poll());
+    _now += SPI_MUX_IDLE_US;
+    assert_false(spi_mux_poll());
+    assert_int_equal(_mux_writes, 2);
+}
+
+static void fpga_loading_test(void ** state) {
+    (void)state;
+
+    _ready = false;
+    spi_mux_init(_event, 1);
+    _mux_writes = 0;
+
+    // non-blocking client: refused while the Gowin loads
+    assert_false(spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0));
+    assert_int_equal(_mux_writes, 0);
+    assert_int_equal(spi_mux_stats()->timeouts, 1);
+
+    // blocking client: waits for READY, at most its timeout
+    _step = 10;
+    assert_false(spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, 500));
+    assert_int_equal(spi_mux_stats()->timeouts, 2);
+
+    _ready = true;
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, 500));
+    assert_int_equal(_mux, 1);
+    assert_int_equal(_events[SPI_MUX_EV_TIMEOUT], 2);
+}
+
+static void fpga_without_bitfile_test(void ** state) {
+    (void)state;
+
+    // never READY: the leases wait no longer than a bitfile load
+    _ready = false;
+    spi_mux_fpga_request();
+    _step = 1000;
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_STORAGE, 2 * SPI_MUX_FPGA_LOAD_US));
+    assert_int_equal(_mux, 1);
+    _step = 0;
+    spi_mux_release(SPI_MUX_CLIENT_STORAGE);
+
+    // a non-blocking client is not held up any more either
+    _now += SPI_MUX_IDLE_US;
+    assert_false(spi_mux_poll());
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0));
+}
+
+static void fpga_counter_wrap_test(void ** state) {
+    (void)state;
+
+    // the load window across the wrap of the cycle counter
+    _ready = false;
+    _now = UINT32_MAX - 100;
+    spi_mux_fpga_request();
+    _now += SPI_MUX_FPGA_LOAD_US - 1;
+    assert_true(_now < 1000000);
+    assert_false(spi_mux_poll());
+    assert_false(spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0));
+
+    // the poll ends it, no lease needed
+    _now += 1;
+    assert_false(spi_mux_poll());
+
+    // a lease a full counter period later: the same cycle count as at the
+    // request, the window must not open again
+    _now = UINT32_MAX - 100 + 10;
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0));
+    assert_int_equal(_mux, 1);
+    assert_int_equal(spi_mux_stats()->timeouts, 1);
+}
+
+static void fpga_request_test(void ** state) {
+    (void)state;
+
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0));
+    _now += 300;
+
+    // reconfigure: the bus goes back now, the leases are gone
+    _ready = false;
+    spi_mux_fpga_request();
+    assert_int_equal(_mux, 0);
+    assert_int_equal(spi_mux_held(SPI_MUX_CLIENT_QUEUE), 0);
+    assert_int_equal(spi_mux_stats()->revoked, 1);
+    assert_int_equal(spi_mux_stats()->hold_max_us, 300);
+    spi_mux_release(SPI_MUX_CLIENT_QUEUE);
+
+    assert_false(spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0));
+    _ready = true;
+    assert_true(spi_mux_acquire(SPI_MUX_CLIENT_QUEUE, 0));
+
+    // reset without leases: nothing revoked
+    spi_mux_release(SPI_MUX_CLIENT_QUEUE);
+    spi_mux_reset();
+    assert_int_equal(_mux, 0);
+    assert_int_equal(spi_mux_stats()->revoked, 1);
+    assert_int_equal(_events[SPI_MUX_EV_REVOKE], 1);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest spi_mux_tests[] = {
+        cmocka_unit_test_setup(linger_test,               setup),
+        cmocka_unit_test_setup(nested_test,               setup),
+        cmocka_unit_test_setup(fpga_loading_test,         setup),
+        cmocka_unit_test_setup(fpga_without_bitfile_test, setup),
+        cmocka_unit_test_setup(fpga_counter_wrap_test,    setup),
+        cmocka_unit_test_setup(fpga_request_test,         setup),
+    };
+
+    return cmocka_run_group_tests(spi_mux_tests, NULL, NULL);
+}
@@ -0,0 +1,236 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_spi_queue.c  - native
+ * Author              : Barco
+ * created             : 18/10/2022
+ * Description         : spi flash message queue, priorities, ordering of
+ *                       conflicting messages, batching and the queue stats
+ * History:
+ * 18/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "logger.h"
+
+#include "data_map.h"
+#include "spi/spi_queue.h"
+
+// ------------------------------------------------------------------------------
+static void _push(t_spi_command cmd,
+                  u16 page,
+                  u32 now) {
+    u8 data[3 + SPI_BUFFER_SIZE];
+    u16 size = 3;
+
+    data[0] = (u8)cmd;
+    data[1] = (u8)(page >> 8);
+    data[2] = (u8)page;
+    if (cmd == SPI_IS25_PP) {
+        memset(&data[3], (u8)page, SPI_BUFFER_SIZE);
+        size += SPI_BUFFER_SIZE;
+    }
+    assert_true(spi_queue_push(data, size, now));
+}
+
+// takes the next batch, checks its command and pages and releases it
+static void _expect(t_spi_command cmd,
+                    u16 page,
+                    u8 count) {
+    t_spi_batch batch;
+
+    assert_true(spi_queue_take(&batch, 0));
+    assert_int_equal(batch.count, count);
+    for (u8 i = 0; i < count; i++) {
+        const t_spi_msg * msg = spi_queue_entry(batch.index[i]);
+        assert_int_equal(msg->cmd, cmd);
+        assert_int_equal(spi_queue_page(msg), page + i);
+        if (cmd == SPI_IS25_PP)
+            assert_int_equal(msg->data[SPI_BUFFER_SIZE - 1], (u8)(page + i));
+    }
+    spi_queue_done();
+}
+
+static int setup(void ** state) {
+    (void)state;
+    spi_queue_init(1);
+    memset(&Main.PerfCounters, 0, sizeof(Main.PerfCounters));
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+static void priority_test(void ** state) {
+    (void)state;
+    t_spi_batch batch;
+
+    _push(SPI_IS25_SE, 0x100, 0);
+    _push(SPI_IS25_PREFETCH, 0x21, 0);
+    _push(SPI_IS25_READ, 0x10, 0);
+    assert_int_equal(spi_queue_size(false), 3);
+
+    _expect(SPI_IS25_READ, 0x10, 1);
+    _expect(SPI_IS25_PREFETCH, 0x21, 1);
+    _expect(SPI_IS25_SE, 0x100, 1);
+    assert_false(spi_queue_take(&batch, 0));
+    assert_int_equal(spi_queue_size(false), 0);
+}
+
+static void conflict_test(void ** state) {
+    (void)state;
+
+    // a read never overtakes an earlier write of its page
+    _push(SPI_IS25_PP, 0x20, 0);
+    _push(SPI_IS25_READ, 0x20, 0);
+    _push(SPI_IS25_READ, 0x40, 0);
+    _expect(SPI_IS25_READ, 0x40, 1);
+    _expect(SPI_IS25_PP, 0x20, 1);
+    _expect(SPI_IS25_READ, 0x20, 1);
+
+    // nor of its sector (16 pages, aligned)
+    _push(SPI_IS25_SE, 0x35, 0);
+    _push(SPI_IS25_READ, 0x3F, 0);
+    _expect(SPI_IS25_SE, 0x35, 1);
+    _expect(SPI_IS25_READ, 0x3F, 1);
+
+    // a chip erase is in the way of every page
+    _push(SPI_IS25_CER, 0, 0);
+    _push(SPI_IS25_READ, 0x1234, 0);
+    _expect(SPI_IS25_CER, 0, 1);
+    _expect(SPI_IS25_READ, 0x1234, 1);
+}
+
+static void barrier_test(void ** state) {
+    (void)state;
+
+    // commands without address are not reordered
+    _push(SPI_IS25_DP, 0, 0);
+    _push(SPI_IS25_READ, 0x10, 0);
+    _push(SPI_IS25_RDP, 0, 0);
+    _expect(SPI_IS25_DP, 0, 1);
+    _expect(SPI_IS25_READ, 0x10, 1);
+    _expect(SPI_IS25_RDP, 0, 1);
+}
+
+static void fifo_test(void ** state) {
+    (void)state;
+
+    _push(SPI_IS25_SE, 0x200, 0);
+    _push(SPI_IS25_BER32, 0x400, 0);
+    _push(SPI_IS25_SE, 0x100, 0);
+    _expect(SPI_IS25_SE, 0x200, 1);
+    _expect(SPI_IS25_BER32, 0x400, 1);
+    _expect(SPI_IS25_SE, 0x100, 1);
+}
+
+static void batch_test(void ** state) {
+    (void)state;
+
+    // contiguous reads, SPI_BATCH_READ_PAGES per transfer
+    _push(SPI_IS25_READ, 0x11, 0);
+    _push(SPI_IS25_READ, 0x10, 0);
+    _push(SPI_IS25_READ, 0x12, 0);
+    _expect(SPI_IS25_READ, 0x11, 2);
+    _expect(SPI_IS25_READ, 0x10, 1);
+    assert_int_equal(Main.PerfCounters.SpiMerged, 1);
+
+    // contiguous programs, SPI_BATCH_PROGRAM_PAGES per operation
+    for (u16 page = 0x80; page < 0x86; page++)
+        _push(SPI_IS25_PP, page, 0);
+    _expect(SPI_IS25_PP, 0x80, SPI_BATCH_PROGRAM_PAGES);
+    _expect(SPI_IS25_PP, 0x84, 2);
+    assert_int_equal(Main.PerfCounters.SpiMerged, 1 + 3 + 1);
+}
+
+static void batch_conflict_test(void ** state) {
+    (void)state;
+
+    // the program of page 0x51 waits for the erase queued before it
+    _push(SPI_IS25_PP, 0x50, 0);
+    _push(SPI_IS25_SE, 0x51, 0);
+    _push(SPI_IS25_PP, 0x51, 0);
+    _expect(SPI_IS25_PP, 0x50, 1);
+    _expect(SPI_IS25_SE, 0x51, 1);
+    _expect(SPI_IS25_PP, 0x51, 1);
+
+    // a read is not merged with a program
+    _push(SPI_IS25_READ, 0x60, 0);
+    _push(SPI_IS25_PP, 0x61, 0);
+    _expect(SPI_IS25_READ, 0x60, 1);
+    _expect(SPI_IS25_PP, 0x61, 1);
+}
+
+static void overflow_test(void ** state) {
+    (void)state;
+    u8 data[3] = { SPI_IS25_READ, 0, 0 };
+
+    for (u16 i = 0; i < SPI_MSG_QUEUE_LENGTH; i++)
+        _push(SPI_IS25_SE, (u16)(i << 4), 0);
+    assert_int_equal(Main.PerfCounters.SpiQueueHighWater, SPI_MSG_QUEUE_LENGTH);
+    assert_false(spi_queue_push(data, sizeof(data), 0));
+    assert_int_equal(Main.PerfCounters.SpiQueueOverflow, 1);
+
+    data[0] = 0x42; // no spi command
+    _expect(SPI_IS25_SE, 0, 1);
+    assert_false(spi_queue_push(data, sizeof(data), 0));
+    assert_int_equal(Main.PerfCounters.SpiQueueOverflow, 1);
+}
+
+static void latency_test(void ** state) {
+    (void)state;
+    t_spi_batch batch;
+
+    spi_queue_init(10); // 10 cycles per us
+    _push(SPI_IS25_SE, 0x100, 1000);
+    _push(SPI_IS25_READ, 0x10, 5000);
+    assert_true(spi_queue_take(&batch, 6000));
+    spi_queue_done();
+    assert_int_equal(Main.PerfCounters.SpiQueueMaxWaitUs, 100);
+    assert_true(spi_queue_take(&batch, 9000));
+    spi_queue_done();
+    assert_int_equal(Main.PerfCounters.SpiQueueMaxWaitUs, 800);
+}
+
+static void retry_test(void ** state) {
+    (void)state;
+    t_spi_batch batch;
+
+    _push(SPI_IS25_PP, 0x10, 0);
+    _push(SPI_IS25_PP, 0x11, 0);
+    _push(SPI_IS25_SE, 0x100, 0);
+
+    // flash busy: the batch goes back, in its place
+    assert_true(spi_queue_take(&batch, 0));
+    assert_int_equal(batch.count, 2);
+    spi_queue_retry();
+    assert_int_equal(spi_queue_size(false), 3);
+
+    // one page of the batch done, the other one not
+    assert_true(spi_queue_take(&batch, 0));
+    spi_queue_release(batch.index[0]);
+    spi_queue_retry();
+    _expect(SPI_IS25_PP, 0x11, 1);
+    _expect(SPI_IS25_SE, 0x100, 1);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest spi_queue_tests[] = {
+        cmocka_unit_test_setup(priority_test,       setup),
+        cmocka_unit_test_setup(conflict_test,       setup),
+        cmocka_unit_test_setup(barrier_test,        setup),
+        cmocka_unit_test_setup(fifo_test,           setup),
+        cmocka_unit_test_setup(batch_test,          setup),
+        cmocka_unit_test_setup(batch_conflict_test, setup),
+        cmocka_unit_test_setup(overflow_test,       setup),
+        cmocka_unit_test_setup(latency_test,        setup),
+        cmocka_unit_test_setup(retry_test,          setup),
+    };
+
+    return cmocka_run_group_tests(spi_queue_tests, NULL, NULL);
+}
@@ -0,0 +1,326 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_spi_update.c  - native
+ * Author              : Barco
+ * created             : 13/10/2022
+ * Description         : Gowin bitfile update in application mode, through
+ *                       comm.c on a RAM backed spi flash storage driver
+ * History:
+ * 13/10/2022 - initial
+ *******************************************************************************/
+#include "unit_test_comm_protocol_helper.h"
+#include "unit_test_comm_protocol_mock.h"
+
+#include "comm_protocol.h"
+#include "storage.h"
+#include "storage_spi_flash.h"
+#include "spi/spi_update.h"
+
+extern volatile t_uart_data_raw UART_DATA[NUMBER_OF_PROTOCOL_UARTS]; // helper
+
+extern uint32_t crc32(uint32_t crc,
+                      const uint8_t * buf,
+                      size_t len);
+
+#define FAKE_FLASH_SIZE (2 * SPI_PART_SIZE)
+#define BITFILE_SIZE    (5 * SPI_UPDATE_BLOCK_SIZE + 100)
+#define BITFILE_BLOCKS  6
+
+static u8 _flash[FAKE_FLASH_SIZE];
+static u8 _bitfile[BITFILE_SIZE];
+static int _erases = 0;
+
+// ------------------------------------------------------------------------------
+// RAM flash: a write only clears bits, as a page program
+static int _fake_read(struct storage_driver_t * sdriver,
+                      uint8_t * data,
+                      size_t len) {
+    struct spi_flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+
+    memcpy(data, _flash + farea->start_addr + farea->offset, len);
+    farea->offset += len;
+    return (int)len;
+}
+
+static int _fake_write(struct storage_driver_t * sdriver,
+                       uint8_t * data,
+                       size_t len) {
+    struct spi_flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+
+    for (size_t i = 0; i < len; i++)
+        _flash[farea->start_addr + farea->offset + i] &= data[i];
+    farea->offset += len;
+    return 1;
+}
+
+static int _fake_erase(struct storage_driver_t * sdriver) {
+    struct spi_flash_area_t * farea = STORAGE_GETPRIV(sdriver);
+
+    assert_int_equal(farea->start_addr % (MIN_ERASE_SIZE), 0);
+    memset(_flash + farea->start_addr, 0xFF, farea->size);
+    _erases++;
+    return 0;
+}
+
+static const struct storage_ops_t _fake_ops = {
+    .read  = _fake_read,
+    .write = _fake_write,
+    .erase = _fake_erase,
+};
+
+static struct storage_driver_t _fake_driver = {
+    .name     = "fakespi",
+    .type     = STORAGE_SPI_EXTERNAL,
+    .ops      = &_fake_ops,
+    .privdata = NULL,
+};
+
+// ------------------------------------------------------------------------------
+static int setup(void ** state) {
+    (void)state;
+    initialize_global_data_map();
+    memset(&Main.GowinPartitionInfo, 0, sizeof(Main.GowinPartitionInfo)); // running spi0
+    Main.GowinPartitionInfo.gowin[0].bitfile_crc = 0x12345678;
+    COMM_DATA[UART1].MsgCount = 0;
+    memset(_flash, 0x5A, sizeof(_flash)); // old content everywhere
+    for (int i = 0; i < BITFILE_SIZE; i++)
+        _bitfile[i] = (u8)((i * 7 + i / 251) % 0x7F); // no escaping, a frame fits the ring
+    _erases = 0;
+    spi_update_init(&_fake_driver);
+    return 0;
+}
+
+// one request through the protocol and comm_handler
+// @returns the reply: ACK/NACK, STATE, PARTITION, NEXT_BLOCK(2), FREE_SLOTS, ERROR
+static const u8 * _request(const u8 * msg,
+                           u16 length) {
+    UART_DATA[UART1].RxBufWr = UART_DATA[UART1].RxBuf;
+    UART_DATA[UART1].RxBufRd = UART_DATA[UART1].RxBuf;
+    feed_RingBuffer((const char *)msg, length, false);
+    COMM_Protocol(UART1);
+    assert_int_equal(COMM_DATA[UART1].MsgCount, 1);
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_int_equal(unitTest_SendBuf[2], CMD_WRITE_ARRAY);
+    return &unitTest_SendBuf[3];
+}
+
+static const u8 * _start(u32 size) {
+    const u8 msg[] = { CMD_WRITE_ARRAY, CMD_ID_SPIUPDATE, COMMP_WRQ,
+                       (u8)(size >> 24), (u8)(size >> 16), (u8)(size >> 8), (u8)size };
+
+    return _request(msg, sizeof(msg));
+}
+
+static const u8 * _block(u16 block,
+                         u16 length) {
+    u8 msg[3 + 2 + SPI_UPDATE_BLOCK_SIZE] = { CMD_WRITE_ARRAY, CMD_ID_SPIUPDATE, COMMP_DATA,
+                                              (u8)(block >> 8), (u8)block };
+
+    memcpy(&msg[5], &_bitfile[block * SPI_UPDATE_BLOCK_SIZE], length);
+    return _request(msg, (u16)(5 + length));
+}
+
+static u16 _length(u16 block) {
+    return (block == BITFILE_BLOCKS - 1) ? (BITFILE_SIZE % SPI_UPDATE_BLOCK_SIZE) :
+           SPI_UPDATE_BLOCK_SIZE;
+}
+
+static const u8 * _command(u16 cmd,
+                           u32 crc) {
+    const u8 msg[] = { CMD_WRITE_ARRAY, CMD_ID_SPIUPDATE, COMMP_CMD, (u8)(cmd >> 8), (u8)cmd,
+                       (u8)(crc >> 24), (u8)(crc >> 16), (u8)(crc >> 8), (u8)crc };
+
+    return _request(msg, (cmd == COMMP_CMD_CRC) ? sizeof(msg) : 5);
+}
+
+static int _drain(void) {
+    int steps = 0;
+
+    while (spi_update_process())
+        steps++;
+    return steps;
+}
+
+static u16 _next(const u8 * reply) {
+    return (u16)((reply[3] << 8) | reply[4]);
+}
+
+// ------------------------------------------------------------------------------
+// whole update: window, background erase/write/readback, spi1 in the context
+void update_transfer_test(void ** states) {
+    const u8 ByteWrite[] = { CMD_WRITE_BYTE, BYTE_TEST_REG, 0x5A };
+    const u8 * reply;
+    u32 crc = crc32(0, _bitfile, BITFILE_SIZE);
+    spi_ctxt_t ctxt;
+
+    reply = _start(BITFILE_SIZE);
+    assert_int_equal(reply[0], COMM_REPLY_ACK);
+    assert_int_equal(reply[1], SPI_UPDATE_ERASING);
+    assert_int_equal(reply[2], GOWIN_PARTITION_1); // spi0 runs
+    assert_int_equal(reply[5], SPI_UPDATE_WINDOW);
+
+    // the window fills while the erase runs
+    for (u16 block = 0; block < SPI_UPDATE_WINDOW; block++)
+        assert_int_equal(_block(block, _length(block))[0], COMM_REPLY_ACK);
+    reply = _block(SPI_UPDATE_WINDOW, _length(SPI_UPDATE_WINDOW));
+    assert_int_equal(reply[0], COMM_REPLY_NACK);
+    assert_int_equal(_next(reply), SPI_UPDATE_WINDOW);
+    assert_int_equal(reply[5], 0);
+
+    // one step per run, the register traffic is served in between
+    assert_true(spi_update_process());
+    assert_int_equal(_erases, 1);
+    UART_DATA[UART1].RxBufWr = UART_DATA[UART1].RxBuf;
+    UART_DATA[UART1].RxBufRd = UART_DATA[UART1].RxBuf;
+    feed_RingBuffer((const char *)ByteWrite, sizeof(ByteWrite), false);
+    COMM_Protocol(UART1);
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_int_equal(Main.Debug.byteTestRegister, 0x5A);
+
+    _drain();
+    assert_int_equal(_erases, SPI_PART_SIZE / (MIN_ERASE_SIZE) - 1);
+    for (u16 block = SPI_UPDATE_WINDOW; block < BITFILE_BLOCKS; block++)
+        assert_int_equal(_block(block, _length(block))[0], COMM_REPLY_ACK);
+    assert_int_equal(_command(COMMP_CMD_CRC, crc)[0], COMM_REPLY_ACK);
+    _drain();
+    assert_int_equal(spi_update_state(), SPI_UPDATE_VERIFIED);
+    assert_memory_equal(&_flash[SPI1_START_ADDR], _bitfile, BITFILE_SIZE);
+    assert_int_equal(_flash[SPI1_START_ADDR + BITFILE_SIZE], 0xFF);
+    assert_int_equal(_flash[SPI0_START_ADDR], 0x5A); // running partition untouched
+
+    // spi0 is refused, spi1 recorded: its copy first, spi0's is still the old one
+    assert_int_equal(_command(COMMP_CMD_SET_SPI0, 0)[0], COMM_REPLY_NACK);
+    assert_int_equal(_command(COMMP_CMD_SET_SPI1, 0)[0], COMM_REPLY_ACK);
+    assert_true(spi_update_process());
+    assert_true(spi_update_process());
+    memcpy(&ctxt, &_flash[SPI1_START_ADDR + SPI_PART_SIZE - FLASH_SECTOR_SIZE], sizeof(ctxt));
+    assert_int_equal(ctxt.gowin[1].bitfile_size, BITFILE_SIZE);
+    assert_int_equal(_flash[SPI0_START_ADDR + SPI_PART_SIZE - FLASH_SECTOR_SIZE], 0x5A);
+    _drain();
+    assert_int_equal(spi_update_state(), SPI_UPDATE_DONE);
+    assert_int_equal(Main.GowinPartitionInfo.part, GOWIN_PARTITION_0); // the FPGA loads spi0
+    assert_int_equal(Main.GowinPartitionInfo.gowin[1].bitfile_size, BITFILE_SIZE);
+    assert_int_equal(Main.GowinPartitionInfo.gowin[1].bitfile_crc, crc);
+    assert_int_equal(Main.GowinPartitionInfo.gowin[1].start_addr, SPI1_START_ADDR);
+    assert_int_equal(Main.GowinPartitionInfo.gowin[1].crc,
+                     crc32(0, &_flash[SPI1_START_ADDR], SPI_PART_SIZE - MIN_ERASE_SIZE));
+    assert_int_equal(Main.GowinPartitionInfo.gowin[0].bitfile_crc, 0x12345678);
+
+    // the context in both partitions
+    for (u32 start = SPI0_START_ADDR; start <= SPI1_START_ADDR; start += SPI_PART_SIZE) {
+        memcpy(&ctxt, &_flash[start + SPI_PART_SIZE - FLASH_SECTOR_SIZE], sizeof(ctxt));
+        assert_memory_equal(&ctxt, &Main.GowinPartitionInfo, sizeof(ctxt));
+        assert_int_equal(ctxt.crc, crc32(0, (const uint8_t *)ctxt.gowin, sizeof(ctxt.gowin)));
+    }
+
+    // a next update goes to spi1 again, spi0 is never erased
+    assert_int_equal(_start(BITFILE_SIZE)[2], GOWIN_PARTITION_1);
+    _drain();
+    assert_int_equal(_flash[SPI0_START_ADDR], 0x5A);
+    assert_int_equal(_flash[SPI1_START_ADDR], 0xFF);
+}
+
+// ------------------------------------------------------------------------------
+// go-back-n: gaps and wrong lengths are refused, resent blocks acknowledged
+void update_sequence_test(void ** states) {
+    const u8 * reply;
+
+    _start(BITFILE_SIZE);
+    _drain();
+    assert_int_equal(_block(0, _length(0))[0], COMM_REPLY_ACK);
+
+    reply = _block(2, _length(2)); // block 1 lost
+    assert_int_equal(reply[0], COMM_REPLY_NACK);
+    assert_int_equal(_next(reply), 1);
+
+    reply = _block(0, _length(0)); // reply of block 0 lost
+    assert_int_equal(reply[0], COMM_REPLY_ACK);
+    assert_int_equal(_next(reply), 1);
+
+    assert_int_equal(_block(1, 100)[0], COMM_REPLY_NACK);
+    for (u16 block = 1; block < BITFILE_BLOCKS - 1; block++) {
+        assert_int_equal(_block(block, _length(block))[0], COMM_REPLY_ACK);
+        _drain();
+    }
+    assert_int_equal(_block(BITFILE_BLOCKS - 1, SPI_UPDATE_BLOCK_SIZE)[0], COMM_REPLY_NACK);
+
+    // crc before the last block
+    assert_int_equal(_command(COMMP_CMD_CRC, 0)[0], COMM_REPLY_NACK);
+    assert_int_equal(_block(BITFILE_BLOCKS - 1, _length(BITFILE_BLOCKS - 1))[0], COMM_REPLY_ACK);
+    assert_int_equal(_block(BITFILE_BLOCKS, SPI_UPDATE_BLOCK_SIZE)[0], COMM_REPLY_NACK);
+    assert_int_equal(_command(COMMP_CMD_CRC, crc32(0, _bitfile, BITFILE_SIZE))[0], COMM_REPLY_ACK);
+    _drain();
+    assert_int_equal(spi_update_state(), SPI_UPDATE_VERIFIED);
+    assert_memory_equal(&_flash[SPI1_START_ADDR], _bitfile, BITFILE_SIZE);
+}
+
+// ------------------------------------------------------------------------------
+// crc mismatch: error, no switch
+void update_crc_error_test(void ** states) {
+    const u8 * reply;
+
+    _start(BITFILE_SIZE);
+    for (u16 block = 0; block < BITFILE_BLOCKS; block++) {
+        _drain();
+        _block(block, _length(block));
+    }
+    _command(COMMP_CMD_CRC, crc32(0, _bitfile, BITFILE_SIZE) ^ 1);
+    _drain();
+
+    reply = _command(COMMP_CMD_INFO_SPI, 0);
+    assert_int_equal(reply[0], COMM_REPLY_ACK);
+    assert_int_equal(reply[1], SPI_UPDATE_ERROR);
+    assert_int_equal(reply[6], SPI_UPDATE_ERR_CRC);
+    assert_int_equal(_command(COMMP_CMD_SET_SPI1, 0)[0], COMM_REPLY_NACK);
+    assert_int_equal(Main.GowinPartitionInfo.part, GOWIN_PARTITION_0);
+    assert_int_equal(_flash[SPI1_START_ADDR + SPI_PART_SIZE - FLASH_SECTOR_SIZE], 0x5A);
+
+    // a new start clears the error
+    reply = _start(BITFILE_SIZE);
+    assert_int_equal(reply[0], COMM_REPLY_ACK);
+    assert_int_equal(reply[6], SPI_UPDATE_ERR_NONE);
+}
+
+// ------------------------------------------------------------------------------
+// abort, refused requests
+void update_refused_test(void ** states) {
+    const u8 Abort[] = { CMD_WRITE_ARRAY, CMD_ID_SPIUPDATE, COMMP_ERR };
+    const u8 Short[] = { CMD_WRITE_ARRAY, CMD_ID_SPIUPDATE };
+    const u8 NACKSizeErrorReply[] = { COMM_START_BYTE, ADR, COMM_CMD_NACK, COMM_NACK_MSG_LENGTH, 0x11,
+                                      COMM_STOP_BYTE };
+
+    assert_int_equal(_start(0)[0], COMM_REPLY_NACK);
+    assert_int_equal(_start(SPI_PART_SIZE - MIN_ERASE_SIZE + 1)[0], COMM_REPLY_NACK);
+    assert_int_equal(_block(0, _length(0))[0], COMM_REPLY_NACK); // no transfer
+    assert_int_equal(_command(COMMP_CMD_SET_SPI1, 0)[0], COMM_REPLY_NACK);
+
+    _start(BITFILE_SIZE);
+    assert_int_equal(_request(Abort, sizeof(Abort))[1], SPI_UPDATE_IDLE);
+    assert_int_equal(_block(0, _length(0))[0], COMM_REPLY_NACK);
+    assert_false(spi_update_process());
+
+    // no flash driver
+    spi_update_init(NULL);
+    assert_int_equal(_start(BITFILE_SIZE)[0], COMM_REPLY_NACK);
+
+    UART_DATA[UART1].RxBufWr = UART_DATA[UART1].RxBuf;
+    UART_DATA[UART1].RxBufRd = UART_DATA[UART1].RxBuf;
+    feed_RingBuffer((const char *)Short, sizeof(Short), false);
+    COMM_Protocol(UART1);
+    comm_handler();
+    COMM_DATA[UART1].MsgCount = 0;
+    assert_memory_equal(unitTest_SendBuf, NACKSizeErrorReply, sizeof(NACKSizeErrorReply));
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest spi_update_tests[] = {
+        cmocka_unit_test_setup(update_transfer_test,  setup),
+        cmocka_unit_test_setup(update_sequence_test,  setup),
+        cmocka_unit_test_setup(update_crc_error_test, setup),
+        cmocka_unit_test_setup(update_refused_test,   setup),
+    };
+
+    return cmocka_run_group_tests(spi_update_tests, NULL, NULL);
+}
@@ -0,0 +1,187 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_storage_flash.c  - native
+ * Author              : Barco
+ * created             : 19/10/2022
+ * Description         : storage_flash.c on the native internal flash
+ *                       (tests/native/hal fsl_iap.c): v1 cursor, v2
+ *                       positional and scatter-gather calls, requests
+ *                       without submit, area bounds and crc
+ * History:
+ * 19/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "fsl_iap.h"
+#include "storage.h"
+#include "storage_flash.h"
+
+#define PAGE       FLASH_SECTOR_SIZE
+#define AREA_PAGES 4
+#define AREA_START 0x51400 // !< approm1 of the native memory map
+
+extern uint32_t crc32(uint32_t crc,
+                      const uint8_t * buf,
+                      size_t len);
+
+static uint8_t * _mem = &hal_flash[AREA_START];
+static struct flash_area_t _farea;
+static struct storage_driver_t * _sdriver = NULL;
+static uint8_t _buf[AREA_PAGES * PAGE];
+static int _requests = 0;
+
+// ------------------------------------------------------------------------------
+static void _pattern(uint8_t * buf,
+                     size_t len,
+                     uint8_t seed) {
+    for (size_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)(seed + i * 7);
+}
+
+static void _request_done(struct storage_req_t * req) {
+    (void)req;
+    _requests++;
+}
+
+// ------------------------------------------------------------------------------
+static int setup(void ** state) {
+    (void)state;
+    memset(hal_flash, 0x5A, sizeof(hal_flash)); // old content everywhere
+    _requests = 0;
+    _sdriver = storage_new_flash_driver();
+    _farea = storage_new_flash_area("approm1", (uint32_t)(uintptr_t)_mem, AREA_PAGES * PAGE);
+    storage_set_flash_area(_sdriver, &_farea);
+    assert_int_equal(storage_init_storage(_sdriver), 0);
+    assert_false(storage_is_empty_partition(_sdriver));
+    assert_int_equal(storage_erase_storage(_sdriver), 0);
+    assert_true(storage_is_empty_partition(_sdriver));
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+// v1: writes at the cursor, reads from the area start, flush rewinds
+static void flash_cursor_test(void ** state) {
+    (void)state;
+    uint8_t block[PAGE];
+
+    for (int i = 0; i < AREA_PAGES; i++) {
+        _pattern(block, sizeof(block), (uint8_t)i);
+        assert_int_equal(storage_write_data(_sdriver, block, sizeof(block)), 1);
+        assert_int_equal(_farea.offset, (i + 1) * PAGE);
+    }
+    assert_int_equal(storage_write_data(_sdriver, block, 1), -1); // area full
+    assert_int_equal(storage_flush_storage(_sdriver), 0);
+    assert_int_equal(_farea.offset, 0);
+
+    assert_int_equal(storage_read_data(_sdriver, _buf, sizeof(_buf)), 0);
+    for (int i = 0; i < AREA_PAGES; i++) {
+        _pattern(block, sizeof(block), (uint8_t)i);
+        assert_memory_equal(&_buf[i * PAGE], block, sizeof(block));
+    }
+    assert_memory_equal(_mem, _buf, sizeof(_buf));
+    assert_int_equal(_mem[-1], 0x5A);
+    assert_int_equal(_mem[AREA_PAGES * PAGE], 0x5A);
+}
+
+// v2: gathered pages, a short last page padded with 0xFF, the cursor is
+// left alone, page aligned writes inside the area only
+static void flash_v2_test(void ** state) {
+    (void)state;
+    uint8_t data[3 * PAGE];
+    uint8_t head[10];
+
+    // page 1 straddles two buffers (gathered), page 2 is straight from the
+    // last buffer, page 3 is short
+    _pattern(data, sizeof(data), 3);
+    const struct storage_iovec_t out[] = { { data, 300 }, { data, 0 }, { data + 300, 900 } };
+    assert_int_equal(storage_pwritev_data(_sdriver, PAGE, out, 3), 1200);
+    assert_memory_equal(&_mem[PAGE], data, 1200);
+    for (int i = 1200; i < 2 * PAGE; i++)
+        assert_int_equal(_mem[PAGE + i], 0xFF);
+    for (int i = 0; i < PAGE; i++)
+        assert_int_equal(_mem[i], 0xFF);
+    assert_int_equal(_farea.offset, 0);
+
+    assert_int_equal(storage_pwrite_data(_sdriver, 0, data, PAGE), PAGE);
+    assert_memory_equal(_mem, data, PAGE);
+
+    // scattered, from any offset
+    memset(_buf, 0, sizeof(_buf));
+    const struct storage_iovec_t in[] = { { head, sizeof(head) }, { _buf, 0 }, { _buf, 1000 } };
+    assert_int_equal(storage_preadv_data(_sdriver, PAGE + 5, in, 3), 1010);
+    assert_memory_equal(head, data + 5, sizeof(head));
+    assert_memory_equal(_buf, data + 5 + sizeof(head), 1000);
+    assert_int_equal(storage_pread_data(_sdriver, 0, _buf, sizeof(_buf)), sizeof(_buf));
+    assert_memory_equal(_buf, _mem, sizeof(_buf));
+
+    // refused, nothing written
+    assert_int_equal(storage_pwrite_data(_sdriver, 100, data, PAGE), -1);
+    assert_int_equal(storage_pwrite_data(_sdriver, (AREA_PAGES - 1) * PAGE, data, 2 * PAGE), -1);
+    assert_int_equal(storage_pwrite_data(_sdriver, AREA_PAGES * PAGE, data, 1), -1);
+    assert_int_equal(storage_pread_data(_sdriver, AREA_PAGES * PAGE - 10, _buf, 20), -1);
+    assert_memory_equal(_buf, _mem, sizeof(_buf));
+    assert_int_equal(_mem[AREA_PAGES * PAGE], 0x5A);
+}
+
+// no submit: the request completes within storage_submit_request
+static void flash_request_test(void ** state) {
+    (void)state;
+    uint8_t data[PAGE + 100];
+
+    _pattern(data, sizeof(data), 9);
+    const struct storage_iovec_t out[] = { { data, PAGE }, { data + PAGE, 100 } };
+    struct storage_req_t wr = { .op = STORAGE_REQ_WRITE, .offset = 2 * PAGE, .iov = out,
+                                .iovcnt = 2, .done = _request_done };
+    memset(_buf, 0, sizeof(_buf));
+    const struct storage_iovec_t in[] = { { _buf, sizeof(data) } };
+    struct storage_req_t rd = { .op = STORAGE_REQ_READ, .offset = 2 * PAGE, .iov = in,
+                                .iovcnt = 1, .done = _request_done };
+
+    assert_int_equal(storage_submit_request(_sdriver, &wr), 0);
+    assert_false(wr.busy);
+    assert_int_equal(wr.result, sizeof(data));
+    assert_int_equal(_requests, 1);
+    assert_int_equal(storage_submit_request(_sdriver, &rd), 0);
+    assert_false(rd.busy);
+    assert_int_equal(rd.result, sizeof(data));
+    assert_int_equal(_requests, 2);
+    assert_memory_equal(_buf, data, sizeof(data));
+    assert_int_equal(storage_poll_requests(_sdriver), 0);
+
+    // a failed request completes with -1
+    struct storage_req_t past = { .op = STORAGE_REQ_WRITE, .offset = 100, .iov = out,
+                                  .iovcnt = 1, .done = _request_done };
+    assert_int_equal(storage_submit_request(_sdriver, &past), 0);
+    assert_int_equal(past.result, -1);
+    assert_int_equal(_requests, 3);
+}
+
+// the whole area, the length is not used by the internal flash
+static void flash_crc_test(void ** state) {
+    (void)state;
+    uint8_t data[PAGE];
+
+    _pattern(data, sizeof(data), 1);
+    assert_int_equal(storage_pwrite_data(_sdriver, PAGE, data, sizeof(data)), PAGE);
+    assert_int_equal(storage_crc_storage(_sdriver, 0), crc32(0, _mem, AREA_PAGES * PAGE));
+    assert_int_equal(storage_crc_storage(_sdriver, PAGE), crc32(0, _mem, AREA_PAGES * PAGE));
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest storage_flash_tests[] = {
+        cmocka_unit_test_setup(flash_cursor_test,  setup),
+        cmocka_unit_test_setup(flash_v2_test,      setup),
+        cmocka_unit_test_setup(flash_request_test, setup),
+        cmocka_unit_test_setup(flash_crc_test,     setup),
+    };
+
+    return cmocka_run_group_tests(storage_flash_tests, NULL, NULL);
+}
@@ -0,0 +1,246 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_timer_wheel.c  - native
+ * Author              : Barco
+ * created             : 10/10/2022
+ * Description         : timer wheel test, fake clock
+ * History:
+ * 10/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "logger.h"
+
+#include "data_map.h"
+#include "scheduler.h"
+#include "timer_wheel.h"
+
+#define EV_A (1UL << 0)
+
+static int fired = 0;
+static u32 fired_at = 0;
+static int ev_runs = 0;
+
+static void _count(Timer_t * timer,
+                   void * arg) {
+    (void)timer;
+    fired++;
+    fired_at = timer_now();
+    if (arg)
+        (*(int *)arg)++;
+}
+
+static void _restart(Timer_t * timer,
+                     void * arg) {
+    (void)arg;
+    fired++;
+    if (fired < 3)
+        timer_start(timer, 5);
+}
+
+static bool _task_ev(void) {
+    ev_runs++;
+    return false;
+}
+
+static const SchedTask_t ev_tasks[] = {
+    { "ev", EV_A, LOOP_TASK_GPIO, _task_ev },
+};
+
+static int setup(void ** state) {
+    (void)state;
+    fired = 0;
+    fired_at = 0;
+    ev_runs = 0;
+    timer_wheel_init(96000000U);
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+// one shot: fires once, on the ms of its deadline
+void start_test(void ** states) {
+    Timer_t t = TIMER_CALLBACK_INIT(_count, NULL);
+
+    assert_false(timer_pending(&t));
+    timer_start(&t, 10);
+    assert_true(timer_pending(&t));
+
+    timer_fake_advance(9);
+    assert_int_equal(fired, 0);
+    timer_fake_advance(1);
+    assert_int_equal(fired, 1);
+    assert_int_equal(fired_at, 10);
+    assert_true(timer_expired(&t));
+
+    timer_fake_advance(100);
+    assert_int_equal(fired, 1);
+}
+
+// ------------------------------------------------------------------------------
+// cancel and restart, also of an other timer in the same slot
+void cancel_test(void ** states) {
+    Timer_t t1 = TIMER_CALLBACK_INIT(_count, NULL);
+    Timer_t t2 = TIMER_CALLBACK_INIT(_count, NULL);
+    Timer_t t3 = TIMER_CALLBACK_INIT(_count, NULL);
+
+    timer_start(&t1, 5);
+    timer_start(&t2, 5);
+    timer_start(&t3, 5);
+    timer_cancel(&t2);
+    assert_false(timer_pending(&t2));
+    assert_false(timer_expired(&t2));
+    timer_cancel(&t2); // not pending: no-op
+
+    timer_start(&t1, 20); // restart moves it
+    timer_fake_advance(5);
+    assert_int_equal(fired, 1); // t3
+    assert_true(timer_pending(&t1));
+
+    timer_fake_advance(15);
+    assert_int_equal(fired, 2);
+    assert_int_equal(fired_at, 20);
+}
+
+// ------------------------------------------------------------------------------
+// absolute deadlines: late start fires at the next tick
+void start_at_test(void ** states) {
+    Timer_t t = TIMER_CALLBACK_INIT(_count, NULL);
+
+    timer_fake_advance(100);
+    timer_start_at(&t, 150);
+    timer_fake_advance(49);
+    assert_int_equal(fired, 0);
+    timer_fake_advance(1);
+    assert_int_equal(fired_at, 150);
+
+    timer_start_at(&t, 120); // past
+    assert_true(timer_pending(&t));
+    timer_fake_advance(1);
+    assert_int_equal(fired, 2);
+    assert_int_equal(fired_at, 151);
+}
+
+// ------------------------------------------------------------------------------
+// far timers cascade through the levels and still fire on their ms
+void cascade_test(void ** states) {
+    const u32 delays[] = { 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 300001 };
+    Timer_t t[sizeof(delays) / sizeof(delays[0])];
+    int hits[sizeof(delays) / sizeof(delays[0])] = { 0 };
+
+    timer_fake_advance(37); // not aligned to a slot boundary
+    for (u8 i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+        t[i] = (Timer_t)TIMER_CALLBACK_INIT(_count, &hits[i]);
+        timer_start(&t[i], delays[i]);
+    }
+
+    for (u8 i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+        timer_fake_advance(37 + delays[i] - 1 - timer_now());
+        assert_int_equal(hits[i], 0);
+        timer_fake_advance(1);
+        assert_int_equal(hits[i], 1);
+        assert_int_equal(fired_at, 37 + delays[i]);
+    }
+}
+
+// ------------------------------------------------------------------------------
+// delays beyond the top level are re-cascaded
+void long_delay_test(void ** states) {
+    Timer_t t = TIMER_CALLBACK_INIT(_count, NULL);
+
+    timer_start(&t, TIMER_MAX_DELAY + 1000);
+    timer_fake_advance(TIMER_MAX_DELAY);
+    assert_int_equal(fired, 0);
+    timer_fake_advance(999);
+    assert_int_equal(fired, 0);
+    timer_fake_advance(1);
+    assert_int_equal(fired, 1);
+    assert_int_equal(fired_at, TIMER_MAX_DELAY + 1000);
+}
+
+// ------------------------------------------------------------------------------
+// periodic keeps its phase, also when processed late
+void periodic_test(void ** states) {
+    Timer_t t = TIMER_CALLBACK_INIT(_count, NULL);
+
+    timer_start_periodic(&t, 10);
+    timer_fake_advance(35);
+    assert_int_equal(fired, 3);
+    timer_fake_advance(5);
+    assert_int_equal(fired, 4);
+    assert_int_equal(fired_at, 40);
+    assert_true(timer_pending(&t));
+
+    timer_cancel(&t);
+    timer_fake_advance(100);
+    assert_int_equal(fired, 4);
+}
+
+// ------------------------------------------------------------------------------
+// a callback restarting its own timer
+void callback_restart_test(void ** states) {
+    Timer_t t = TIMER_CALLBACK_INIT(_restart, NULL);
+
+    timer_start(&t, 5);
+    for (int i = 0; i < 100; i++)
+        timer_fake_advance(1);
+    assert_int_equal(fired, 3);
+    assert_true(timer_expired(&t));
+}
+
+// ------------------------------------------------------------------------------
+// event timers post to the scheduler
+void event_test(void ** states) {
+    Timer_t t = TIMER_EVENT_INIT(EV_A);
+
+    sched_init(ev_tasks, 1);
+    while (sched_run_once(false)) {
+    }
+    ev_runs = 0;
+
+    timer_start(&t, 3);
+    timer_fake_advance(2);
+    assert_false(sched_run_once(false));
+    timer_fake_advance(1);
+    assert_true(sched_run_once(false));
+    assert_int_equal(ev_runs, 1);
+    assert_true(timer_expired(&t));
+
+    sched_deinit();
+}
+
+// ------------------------------------------------------------------------------
+// init drops the timers still linked
+void init_test(void ** states) {
+    Timer_t t = TIMER_CALLBACK_INIT(_count, NULL);
+
+    timer_start(&t, 5);
+    timer_wheel_init(96000000U);
+    assert_false(timer_pending(&t));
+    assert_int_equal(timer_now(), 0);
+    timer_fake_advance(10);
+    assert_int_equal(fired, 0);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest tests_timer_wheel[] = {
+        cmocka_unit_test_setup(start_test,            setup),
+        cmocka_unit_test_setup(cancel_test,           setup),
+        cmocka_unit_test_setup(start_at_test,         setup),
+        cmocka_unit_test_setup(cascade_test,          setup),
+        cmocka_unit_test_setup(long_delay_test,       setup),
+        cmocka_unit_test_setup(periodic_test,         setup),
+        cmocka_unit_test_setup(callback_restart_test, setup),
+        cmocka_unit_test_setup(event_test,            setup),
+        cmocka_unit_test_setup(init_test,             setup),
+    };
+
+    return cmocka_run_group_tests(tests_timer_wheel, NULL, NULL);
+}
@@ -6,21 +6,26 @@
  * @date 2020-10-14
  */
 
+#define _DEFAULT_SOURCE // preadv, pwritev
+
 #include <stdio.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/uio.h>
 
 #include "storage.h"
 #include "logger.h"
 
 #define MAX_FILE_NAME 128
+#define MAX_FILE_IOV  16        // !< buffers per preadv/pwritev call
 
 struct fd_ctxt_t {
     FILE * fd;
     char filestr[MAX_FILE_NAME];
     int written;
+    uint32_t offset;            // !< read/write cursor
 };
 
 static int _init_file_storage(struct storage_driver_t * sdriver) {
@@ -40,24 +45,82 @@ static int _init_file_storage(struct storage_driver_t * sdriver) {
     return 0;
 }
 
+// the buffers in chunks of MAX_FILE_IOV, short at the end of the file
+static int _prwv_file_storage(struct storage_driver_t * sdriver,
+                              uint32_t offset,
+                              const struct storage_iovec_t * iov,
+                              int iovcnt,
+                              bool write) {
+    struct fd_ctxt_t * ctxt = (struct fd_ctxt_t *)STORAGE_GETPRIV(sdriver);
+    if (!ctxt || !ctxt->fd) {
+        LOG_ERROR("Context cannot be NULL");
+        return -1;
+    }
+    fflush(ctxt->fd);
+
+    int fd = fileno(ctxt->fd);
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i += MAX_FILE_IOV) {
+        struct iovec vec[MAX_FILE_IOV];
+        int cnt = (iovcnt - i < MAX_FILE_IOV) ? iovcnt - i : MAX_FILE_IOV;
+        size_t len = storage_iov_length(&iov[i], cnt);
+
+        for (int v = 0; v < cnt; v++) {
+            vec[v].iov_base = iov[i + v].base;
+            vec[v].iov_len = iov[i + v].len;
+        }
+        ssize_t n = write ? pwritev(fd, vec, cnt, (off_t)(offset + total)) :
+                    preadv(fd, vec, cnt, (off_t)(offset + total));
+        if (n < 0) {
+            LOG_ERROR("Failed to access %s", ctxt->filestr);
+            return -1;
+        }
+        total += (size_t)n;
+        if ((size_t)n < len)
+            break;
+    }
+    return (int)total;
+}
+
+static int _preadv_file_storage(struct storage_driver_t * sdriver,
+                                uint32_t offset,
+                                const struct storage_iovec_t * iov,
+                                int iovcnt) {
+    return _prwv_file_storage(sdriver, offset, iov, iovcnt, false);
+}
+
+static int _pwritev_file_storage(struct storage_driver_t * sdriver,
+                                 uint32_t offset,
+                                 const struct storage_iovec_t * iov,
+                                 int iovcnt) {
+    return _prwv_file_storage(sdriver, offset, iov, iovcnt, true);
+}
+
 static int _read_file_storage(struct storage_driver_t * sdriver, uint8_t * buffer,
                               size_t len) {
     LOG_INFO("Read from file backed storage driver");
-    return 0;
+    struct fd_ctxt_t * ctxt = (struct fd_ctxt_t *)STORAGE_GETPRIV(sdriver);
+    const struct storage_iovec_t iov = { buffer, len };
+
+    int read = _preadv_file_storage(sdriver, ctxt ? ctxt->offset : 0, &iov, 1);
+    if (read > 0)
+        ctxt->offset += read;
+    return read;
 }
 
 static int _write_file_storage(struct storage_driver_t * sdriver,
                                uint8_t * buffer, size_t len) {
     LOG_INFO("Write to file backed storage driver");
     struct fd_ctxt_t * ctxt = (struct fd_ctxt_t *)STORAGE_GETPRIV(sdriver);
-    if (!ctxt) {
-        LOG_ERROR("Context cannot be NULL");
-        return -1;
-    }
+    const struct storage_iovec_t iov = { buffer, len };
 
-    int written = fwrite(buffer, sizeof(uint8_t), len, ctxt->fd);
+    int written = _pwritev_file_storage(sdriver, ctxt ? ctxt->offset : 0, &iov, 1);
+    if (written < 0)
+        return -1;
     LOG_DEBUG("Written %d", written);
+    ctxt->offset += written;
     ctxt->written += written;
+    return written;
 }
 
 static int _flush_file_storage(struct storage_driver_t * sdriver) {
@@ -89,18 +152,21 @@ static int _close_file_storage(struct storage_driver_t * sdriver) {
     return 0;
 }
 
-static uint32_t _crc_file_storage(struct storage_driver_t * sdriver) {
+static uint32_t _crc_file_storage(struct storage_driver_t * sdriver,
+                                  size_t len) {
     return 0;
 }
 
 static const struct storage_ops_t fdops = {
-    .init  = _init_file_storage,
-    .read  = _read_file_storage,
-    .write = _write_file_storage,
-    .erase = _erase_file_storage,
-    .flush = _flush_file_storage,
-    .crc   = _crc_file_storage,
-    .close = _close_file_storage,
+    .init    = _init_file_storage,
+    .read    = _read_file_storage,
+    .write   = _write_file_storage,
+    .erase   = _erase_file_storage,
+    .flush   = _flush_file_storage,
+    .crc     = _crc_file_storage,
+    .close   = _close_file_storage,
+    .preadv  = _preadv_file_storage,
+    .pwritev = _pwritev_file_storage,
 };
 
 struct storage_driver_t * storage_new_linux_fd_driver(char * filename) {
@@ -0,0 +1,161 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_storage_file.c  - native
+ * Author              : Barco
+ * created             : 19/10/2022
+ * Description         : storage_linux_file.c: v1 cursor, v2 positional and
+ *                       scatter-gather calls (more buffers than one
+ *                       preadv/pwritev takes), short reads at the end of the
+ *                       file, requests without submit
+ * History:
+ * 19/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "storage.h"
+#include "storage_linux.h"
+
+#define IOV_NUM  20             // !< more than MAX_FILE_IOV
+#define IOV_SIZE 37
+
+static char _file[] = "/tmp/unit_storage_file.XXXXXX";
+static struct storage_driver_t * _sdriver = NULL;
+static uint8_t _data[IOV_NUM * IOV_SIZE];
+static uint8_t _buf[IOV_NUM * IOV_SIZE];
+static struct storage_iovec_t _iov[IOV_NUM];
+static int _requests = 0;
+
+// ------------------------------------------------------------------------------
+static void _pattern(uint8_t * buf,
+                     size_t len,
+                     uint8_t seed) {
+    for (size_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)(seed + i * 7);
+}
+
+// IOV_NUM buffers over buf, every other one empty
+static const struct storage_iovec_t * _split(uint8_t * buf) {
+    size_t at = 0;
+
+    for (int i = 0; i < IOV_NUM; i++) {
+        size_t len = (i % 2) ? 0 : 2 * IOV_SIZE;
+
+        _iov[i].base = buf + at;
+        _iov[i].len = len;
+        at += len;
+    }
+    return _iov;
+}
+
+static void _request_done(struct storage_req_t * req) {
+    (void)req;
+    _requests++;
+}
+
+// ------------------------------------------------------------------------------
+static int setup(void ** state) {
+    (void)state;
+    int fd = mkstemp(_file);
+
+    assert_true(fd >= 0);
+    close(fd);
+    _requests = 0;
+    _pattern(_data, sizeof(_data), 3);
+    memset(_buf, 0, sizeof(_buf));
+    _sdriver = storage_new_linux_fd_driver(_file);
+    assert_non_null(_sdriver);
+    assert_int_equal(storage_init_storage(_sdriver), 0);
+    return 0;
+}
+
+static int teardown(void ** state) {
+    (void)state;
+    storage_close_storage(_sdriver);
+    free(_sdriver->privdata);
+    free(_sdriver);
+    unlink(_file);
+    strcpy(&_file[sizeof(_file) - 7], "XXXXXX");
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+// v1: one cursor for writes and reads, the bytes written are returned
+static void file_cursor_test(void ** state) {
+    (void)state;
+
+    assert_int_equal(storage_write_data(_sdriver, _data, 100), 100);
+    assert_int_equal(storage_write_data(_sdriver, _data + 100, 50), 50);
+    assert_int_equal(storage_flush_storage(_sdriver), 0);
+    assert_int_equal(storage_read_data(_sdriver, _buf, 10), 0); // at the end
+
+    FILE * f = fopen(_file, "rb");
+    assert_non_null(f);
+    assert_int_equal(fread(_buf, 1, sizeof(_buf), f), 150);
+    fclose(f);
+    assert_memory_equal(_buf, _data, 150);
+}
+
+// v2: more buffers than one call takes, empty ones between, the cursor is
+// left alone, a read past the end of the file is short
+static void file_v2_test(void ** state) {
+    (void)state;
+    const size_t len = IOV_NUM / 2 * 2 * IOV_SIZE;
+
+    assert_int_equal(storage_pwritev_data(_sdriver, 100, _split(_data), IOV_NUM), len);
+    assert_int_equal(storage_pread_data(_sdriver, 0, _buf, 100), 100);
+    for (int i = 0; i < 100; i++)
+        assert_int_equal(_buf[i], 0); // the hole before the offset
+
+    memset(_buf, 0, sizeof(_buf));
+    assert_int_equal(storage_preadv_data(_sdriver, 100, _split(_buf), IOV_NUM), len);
+    assert_memory_equal(_buf, _data, len);
+
+    memset(_buf, 0, sizeof(_buf));
+    assert_int_equal(storage_preadv_data(_sdriver, 100 + len - 30, _split(_buf), IOV_NUM), 30);
+    assert_memory_equal(_buf, _data + len - 30, 30);
+    assert_int_equal(storage_pread_data(_sdriver, 100 + len, _buf, 10), 0);
+
+    // the cursor did not move: a v1 write lands at 0
+    assert_int_equal(storage_write_data(_sdriver, _data, 10), 10);
+    assert_int_equal(storage_pread_data(_sdriver, 0, _buf, 10), 10);
+    assert_memory_equal(_buf, _data, 10);
+}
+
+// no submit: the request completes within storage_submit_request
+static void file_request_test(void ** state) {
+    (void)state;
+    const struct storage_iovec_t out[] = { { _data, 200 }, { _data + 200, 55 } };
+    struct storage_req_t wr = { .op = STORAGE_REQ_WRITE, .offset = 8, .iov = out, .iovcnt = 2,
+                                .done = _request_done };
+    const struct storage_iovec_t in[] = { { _buf, 255 } };
+    struct storage_req_t rd = { .op = STORAGE_REQ_READ, .offset = 8, .iov = in, .iovcnt = 1,
+                                .done = _request_done };
+
+    assert_int_equal(storage_submit_request(_sdriver, &wr), 0);
+    assert_false(wr.busy);
+    assert_int_equal(wr.result, 255);
+    assert_int_equal(storage_submit_request(_sdriver, &rd), 0);
+    assert_false(rd.busy);
+    assert_int_equal(rd.result, 255);
+    assert_int_equal(_requests, 2);
+    assert_memory_equal(_buf, _data, 255);
+    assert_int_equal(storage_poll_requests(_sdriver), 0);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest storage_file_tests[] = {
+        cmocka_unit_test_setup_teardown(file_cursor_test,  setup, teardown),
+        cmocka_unit_test_setup_teardown(file_v2_test,      setup, teardown),
+        cmocka_unit_test_setup_teardown(file_request_test, setup, teardown),
+    };
+
+    return cmocka_run_group_tests(storage_file_tests, NULL, NULL);
+}
@@ -0,0 +1,273 @@
+/**
+ * @file LPC55S69_cm33_core0.h
+ * @brief  Native stand-in of the device header: interrupt numbers, the core
+ *         peripherals (NVIC, SCB, SysTick, DWT) and the registers the
+ *         firmware touches directly
+ *
+ * The flexcomms are one hal_flexcomm_t each: USARTn, I2Cn, FLEXCOMMn and
+ * In_BASE of the SDK all point at hal_flexcomm[n], the models of fsl_usart.c
+ * and fsl_i2c.c keep their state next to it. Only the registers the
+ * firmware accesses behind the drivers' back are there (gowin_protocol.c:
+ * STAT, INTENSET, INTENCLR).
+ *
+ * The core and its interrupts are run by hal_core.c, see hal_core.h.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _LPC55S69_CM33_CORE0_H_
+#define _LPC55S69_CM33_CORE0_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Interrupts
+ ******************************************************************************/
+typedef enum IRQn {
+    NonMaskableInt_IRQn = -14,
+    HardFault_IRQn = -13,
+    MemoryManagement_IRQn = -12,
+    BusFault_IRQn = -11,
+    UsageFault_IRQn = -10,
+    SecureFault_IRQn = -9,
+    SVCall_IRQn = -5,
+    DebugMonitor_IRQn = -4,
+    PendSV_IRQn = -2,
+    SysTick_IRQn = -1,
+    WDT_BOD_IRQn = 0,
+    FLEXCOMM0_IRQn = 14,
+    FLEXCOMM1_IRQn = 15,
+    FLEXCOMM2_IRQn = 16,
+    FLEXCOMM3_IRQn = 17,
+    FLEXCOMM4_IRQn = 18,
+    FLEXCOMM5_IRQn = 19,
+    FLEXCOMM6_IRQn = 20,
+    FLEXCOMM7_IRQn = 21,
+    RTC_IRQn = 29,
+    LSPI_HS_IRQn = 59, // !< FLEXCOMM8
+} IRQn_Type;
+
+#define HAL_IRQ_NUM 64 // !< NVIC lines modelled
+
+/*******************************************************************************
+ * Core
+ ******************************************************************************/
+typedef struct {
+    volatile uint32_t SHCSR;
+} SCB_Type;
+
+#define SCB_SHCSR_MEMFAULTENA_Msk    (1UL << 16)
+#define SCB_SHCSR_BUSFAULTENA_Msk    (1UL << 17)
+#define SCB_SHCSR_USGFAULTENA_Msk    (1UL << 18)
+#define SCB_SHCSR_SECUREFAULTENA_Msk (1UL << 19)
+#define SCB_SHCSR_MEMFAULTACT_Msk    (1UL << 0)
+#define SCB_SHCSR_BUSFAULTACT_Msk    (1UL << 1)
+#define SCB_SHCSR_HARDFAULTACT_Msk   (1UL << 2)
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+    volatile uint32_t CALIB;
+} SysTick_Type;
+
+#define SysTick_CTRL_ENABLE_Msk    (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk   (1UL << 1)
+#define SysTick_CTRL_CLKSOURCE_Msk (1UL << 2)
+#define SysTick_LOAD_RELOAD_Msk    (0xFFFFFFUL)
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk     (1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+extern SCB_Type hal_scb;
+extern SysTick_Type hal_systick;
+extern CoreDebug_Type hal_core_debug;
+
+#define SCB       (&hal_scb)
+#define SysTick   (&hal_systick)
+#define CoreDebug (&hal_core_debug)
+#define DWT       (hal_dwt_sync()) // !< CYCCNT follows hal_now_ns at SystemCoreClock
+
+DWT_Type * hal_dwt_sync(void);
+
+uint32_t SysTick_Config(uint32_t ticks);
+
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+uint32_t NVIC_GetEnableIRQ(IRQn_Type IRQn);
+void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn);
+void NVIC_SystemReset(void);
+
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __WFI(void);
+
+#define __DSB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __ISB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DMB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __NOP() ((void)0)
+
+/*******************************************************************************
+ * Flexcomm 0..7
+ ******************************************************************************/
+typedef struct hal_flexcomm_t {
+    volatile uint32_t STAT;     // !< USART: TXIDLE, kept up to date by the model
+    volatile uint32_t INTENSET; // !< USART: TXIDLEEN (a store sets, unlike the SoC's write-1-to-set)
+    volatile uint32_t INTENCLR; // !< USART: write-1-to-clear, folded into INTENSET by the model
+} FLEXCOMM_Type;
+
+typedef FLEXCOMM_Type USART_Type;
+typedef FLEXCOMM_Type I2C_Type;
+
+#define HAL_FLEXCOMM_NUM 8
+
+extern FLEXCOMM_Type hal_flexcomm[HAL_FLEXCOMM_NUM];
+
+#define USART_STAT_TXIDLE_MASK        (0x8U)
+#define USART_INTENSET_TXIDLEEN_MASK  (0x8U)
+#define USART_INTENCLR_TXIDLECLR_MASK (0x8U)
+
+#define FLEXCOMM0 (&hal_flexcomm[0])
+#define FLEXCOMM1 (&hal_flexcomm[1])
+#define FLEXCOMM2 (&hal_flexcomm[2])
+#define FLEXCOMM3 (&hal_flexcomm[3])
+#define FLEXCOMM4 (&hal_flexcomm[4])
+#define FLEXCOMM5 (&hal_flexcomm[5])
+#define FLEXCOMM6 (&hal_flexcomm[6])
+#define FLEXCOMM7 (&hal_flexcomm[7])
+
+#define USART0 FLEXCOMM0
+#define USART1 FLEXCOMM1
+#define USART2 FLEXCOMM2
+#define USART3 FLEXCOMM3
+#define USART4 FLEXCOMM4
+#define USART5 FLEXCOMM5
+#define USART6 FLEXCOMM6
+#define USART7 FLEXCOMM7
+
+#define I2C0 FLEXCOMM0
+#define I2C1 FLEXCOMM1
+#define I2C2 FLEXCOMM2
+#define I2C3 FLEXCOMM3
+#define I2C4 FLEXCOMM4
+#define I2C5 FLEXCOMM5
+#define I2C6 FLEXCOMM6
+#define I2C7 FLEXCOMM7
+
+#define I2C4_BASE ((uintptr_t)FLEXCOMM4)
+#define I2C5_BASE ((uintptr_t)FLEXCOMM5)
+
+/**
+ * @brief  Flexcomm number of a base, HAL_FLEXCOMM_NUM: not a flexcomm
+ */
+static inline uint32_t hal_flexcomm_index(const FLEXCOMM_Type * base) {
+    uintptr_t offset = (uintptr_t)base - (uintptr_t)hal_flexcomm;
+
+    if ((uintptr_t)base < (uintptr_t)hal_flexcomm)
+        return HAL_FLEXCOMM_NUM;
+    offset /= sizeof(FLEXCOMM_Type);
+    return (offset < HAL_FLEXCOMM_NUM) ? (uint32_t)offset : HAL_FLEXCOMM_NUM;
+}
+
+/*******************************************************************************
+ * IOCON, SYSCON: written by pin_mux.c, no effect
+ ******************************************************************************/
+typedef struct {
+    volatile uint32_t PIO[2][32];
+} IOCON_Type;
+
+#define IOCON_PIO_FUNC_MASK     (0xFU)
+#define IOCON_PIO_FUNC(x)       ((uint32_t)(x) & IOCON_PIO_FUNC_MASK)
+#define IOCON_PIO_DIGIMODE_MASK (0x100U)
+#define IOCON_PIO_DIGIMODE(x)   (((uint32_t)(x) << 8) & IOCON_PIO_DIGIMODE_MASK)
+
+typedef struct {
+    volatile uint32_t MCLKIO;
+    volatile uint32_t CLOCK_CTRL;
+} SYSCON_Type;
+
+#define SYSCON_MCLKIO_MCLKIO_MASK             (0x1U)
+#define SYSCON_MCLKIO_MCLKIO(x)               ((uint32_t)(x) & SYSCON_MCLKIO_MCLKIO_MASK)
+#define SYSCON_CLOCK_CTRL_FRO1MHZ_CLK_ENA_MASK (0x10U)
+#define SYSCON_CLOCK_CTRL_CLKIN_ENA_MASK      (0x20U)
+
+extern IOCON_Type hal_iocon;
+extern SYSCON_Type hal_syscon;
+
+#define IOCON  (&hal_iocon)
+#define SYSCON (&hal_syscon)
+
+/*******************************************************************************
+ * GPIO: ports 0 and 1, see fsl_gpio.h
+ ******************************************************************************/
+typedef struct {
+    volatile uint32_t DIR[2]; // !< 1: output
+    volatile uint32_t SET[2]; // !< output latch
+    volatile uint32_t PIN[2]; // !< level driven from outside on inputs
+} GPIO_Type;
+
+extern GPIO_Type hal_gpio;
+
+#define GPIO (&hal_gpio)
+
+/*******************************************************************************
+ * WWDT, CRC engine, RTC
+ ******************************************************************************/
+typedef struct {
+    volatile uint32_t MOD;     // !< WDEN, WDRESET, WDTOF, WDINT, WDPROTECT, LOCK
+    volatile uint32_t TC;      // !< timeout reload
+    volatile uint32_t WARNINT; // !< warning compare
+    volatile uint32_t WINDOW;
+} WWDT_Type;
+
+#define WWDT_MOD_WDEN_MASK    (0x1U)
+#define WWDT_MOD_WDRESET_MASK (0x2U)
+#define WWDT_MOD_WDTOF_MASK   (0x4U)
+#define WWDT_MOD_WDINT_MASK   (0x8U)
+
+typedef struct {
+    volatile uint32_t MODE;    // !< CRC_POLY, BIT_RVS_WR, CMPL_WR, BIT_RVS_SUM, CMPL_SUM
+    volatile uint32_t SEED;
+    volatile uint32_t SUM;     // !< shift register, before BIT_RVS_SUM and CMPL_SUM
+} CRC_Type;
+
+#define CRC_MODE_CRC_POLY_MASK    (0x3U)
+#define CRC_MODE_BIT_RVS_WR_MASK  (0x4U)
+#define CRC_MODE_CMPL_WR_MASK     (0x8U)
+#define CRC_MODE_BIT_RVS_SUM_MASK (0x10U)
+#define CRC_MODE_CMPL_SUM_MASK    (0x20U)
+
+typedef struct {
+    volatile uint32_t GPREG[8];
+} RTC_Type;
+
+extern WWDT_Type hal_wwdt;
+extern CRC_Type hal_crc_engine;
+extern RTC_Type hal_rtc;
+
+#define WWDT       (&hal_wwdt)
+#define CRC_ENGINE (&hal_crc_engine)
+#define RTC        (&hal_rtc)
+
+/**
+ * @brief  Silicon revision, 1: 1B
+ */
+static inline uint32_t Chip_GetVersion(void) {
+    return 1U;
+}
+
+#endif /* _LPC55S69_CM33_CORE0_H_ */
@@ -0,0 +1,70 @@
+/**
+ * @file fsl_clock.h
+ * @brief  Native stand-in of the SDK fsl_clock.h: the clock tree is not
+ *         modelled, the frequencies are the board's (clock_config.c)
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_CLOCK_H_
+#define _FSL_CLOCK_H_
+
+#include "fsl_common.h"
+
+typedef enum _clock_ip_name {
+    kCLOCK_Iocon,
+    kCLOCK_Gpio0,
+    kCLOCK_Gpio1,
+    kCLOCK_Crc,
+    kCLOCK_Wwdt,
+    kCLOCK_Flexcomm0,
+    kCLOCK_Flexcomm1,
+    kCLOCK_Flexcomm2,
+    kCLOCK_Flexcomm3,
+    kCLOCK_Flexcomm4,
+    kCLOCK_Flexcomm5,
+    kCLOCK_Flexcomm6,
+    kCLOCK_Flexcomm7,
+    kCLOCK_Flexcomm8,
+} clock_ip_name_t;
+
+typedef enum _clock_name {
+    kCLOCK_CoreSysClk,
+    kCLOCK_BusClk,
+    kCLOCK_FroHf,
+    kCLOCK_Fro12M,
+    kCLOCK_Fro1M,
+    kCLOCK_WdtClk,
+} clock_name_t;
+
+typedef enum _clock_attach_id {
+    kFRO12M_to_MAIN_CLK,
+    kFRO_HF_to_MAIN_CLK,
+    kPLL0_to_MAIN_CLK,
+    kFRO12M_to_FLEXCOMM0,
+    kFRO12M_to_FLEXCOMM1,
+    kFRO12M_to_FLEXCOMM2,
+    kFRO12M_to_FLEXCOMM3,
+    kFRO12M_to_FLEXCOMM4,
+    kFRO12M_to_FLEXCOMM5,
+    kFRO12M_to_FLEXCOMM6,
+    kFRO12M_to_FLEXCOMM7,
+    kMAIN_CLK_to_HSLSPI,
+} clock_attach_id_t;
+
+typedef enum _clock_div_name {
+    kCLOCK_DivAhbClk,
+    kCLOCK_DivWdtClk,
+    kCLOCK_DivPll0Clk,
+} clock_div_name_t;
+
+void CLOCK_EnableClock(clock_ip_name_t clk);
+void CLOCK_DisableClock(clock_ip_name_t clk);
+void CLOCK_AttachClk(clock_attach_id_t connection);
+void CLOCK_SetClkDiv(clock_div_name_t div_name, uint32_t divided_by_value, bool reset);
+
+uint32_t CLOCK_GetFreq(clock_name_t clockName);
+uint32_t CLOCK_GetHsLspiClkFreq(void); // !< main clock, FLEXCOMM8 runs from it
+uint32_t CLOCK_GetWdtClkFreq(void);    // !< FRO 1MHz
+
+#endif /* _FSL_CLOCK_H_ */
@@ -0,0 +1,88 @@
+/**
+ * @file fsl_common.c
+ * @brief  Native stand-in of the SDK common code, clock and reset drivers,
+ *         the board pins seen by the simulated devices
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include "fsl_common.h"
+#include "fsl_gpio.h"
+#include "hal_core.h"
+
+#define SPI_MUX_PORT     1U
+#define SPI_MUX_PIN      31U
+#define GOWIN_READY_PORT 1U
+#define GOWIN_READY_PIN  13U
+
+uint32_t SystemCoreClock = 150000000U;
+
+/*******************************************************************************
+ * Simulation control
+ ******************************************************************************/
+uint8_t hal_spi_mux(void) {
+    return (uint8_t)((GPIO->SET[SPI_MUX_PORT] >> SPI_MUX_PIN) & 1U);
+}
+
+void hal_set_gowin_ready(bool ready) {
+    if (ready)
+        GPIO->PIN[GOWIN_READY_PORT] |= 1U << GOWIN_READY_PIN;
+    else
+        GPIO->PIN[GOWIN_READY_PORT] &= ~(1U << GOWIN_READY_PIN);
+}
+
+/*******************************************************************************
+ * SDK
+ ******************************************************************************/
+void SDK_DelayAtLeastUs(uint32_t delayTime_us,
+                        uint32_t coreClock_Hz) {
+    (void)coreClock_Hz;
+    hal_delay_ns((uint64_t)delayTime_us * 1000U);
+}
+
+void CLOCK_EnableClock(clock_ip_name_t clk) {
+    (void)clk;
+}
+
+void CLOCK_DisableClock(clock_ip_name_t clk) {
+    (void)clk;
+}
+
+void CLOCK_AttachClk(clock_attach_id_t connection) {
+    (void)connection;
+}
+
+void CLOCK_SetClkDiv(clock_div_name_t div_name,
+                     uint32_t divided_by_value,
+                     bool reset) {
+    (void)div_name;
+    (void)divided_by_value;
+    (void)reset;
+}
+
+uint32_t CLOCK_GetFreq(clock_name_t clockName) {
+    switch (clockName) {
+        case kCLOCK_Fro12M:
+            return 12000000U;
+        case kCLOCK_Fro1M:
+        case kCLOCK_WdtClk:
+            return CLOCK_GetWdtClkFreq();
+        case kCLOCK_FroHf:
+            return 96000000U;
+        default:
+            return SystemCoreClock;
+    }
+}
+
+uint32_t CLOCK_GetHsLspiClkFreq(void) {
+    return SystemCoreClock;
+}
+
+uint32_t CLOCK_GetWdtClkFreq(void) {
+    return 1000000U;
+}
+
+void RESET_PeripheralReset(reset_ip_name_t peripheral) {
+    if (peripheral <= kFC7_RST_SHIFT_RSTn)
+        memset((void *)&hal_flexcomm[peripheral], 0, sizeof(hal_flexcomm[peripheral]));
+}
@@ -0,0 +1,52 @@
+/**
+ * @file fsl_common.h
+ * @brief  Native stand-in of the SDK fsl_common.h: status codes,
+ *         SystemCoreClock and SDK_DelayAtLeastUs on the native clock
+ *         (hal_sim.h), the device registers (LPC55S69_cm33_core0.h)
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_COMMON_H_
+#define _FSL_COMMON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fsl_device_registers.h"
+#include "hal_sim.h"
+
+#define MAKE_STATUS(group, code) ((((group)*100) + (code)))
+
+enum _status_groups {
+    kStatusGroup_Generic = 0,
+    kStatusGroup_FLASH = 1,
+    kStatusGroup_FLASHIAP = 25,
+    kStatusGroup_FLEXCOMM_I2C = 26,
+    kStatusGroup_LPC_SPI = 56,
+    kStatusGroup_LPC_USART = 57,
+    kStatusGroup_LPC_I2C = 58,
+};
+
+enum {
+    kStatus_Success = MAKE_STATUS(kStatusGroup_Generic, 0),
+    kStatus_Fail = MAKE_STATUS(kStatusGroup_Generic, 1),
+    kStatus_ReadOnly = MAKE_STATUS(kStatusGroup_Generic, 2),
+    kStatus_OutOfRange = MAKE_STATUS(kStatusGroup_Generic, 3),
+    kStatus_InvalidArgument = MAKE_STATUS(kStatusGroup_Generic, 4),
+    kStatus_Timeout = MAKE_STATUS(kStatusGroup_Generic, 5),
+    kStatus_NoTransferInProgress = MAKE_STATUS(kStatusGroup_Generic, 6),
+    kStatus_Busy = MAKE_STATUS(kStatusGroup_Generic, 7),
+};
+
+typedef int32_t status_t;
+
+extern uint32_t SystemCoreClock; // !< 150MHz, BOARD_BootClockPLL150M
+
+void SDK_DelayAtLeastUs(uint32_t delayTime_us, uint32_t coreClock_Hz);
+
+#include "fsl_common_arm.h"
+
+#endif /* _FSL_COMMON_H_ */
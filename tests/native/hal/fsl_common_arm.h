@@ -0,0 +1,30 @@
+/**
+ * @file fsl_common_arm.h
+ * @brief  Native stand-in of the SDK fsl_common_arm.h: the NVIC helpers
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_COMMON_ARM_H_
+#define _FSL_COMMON_ARM_H_
+
+#define SDK_ISR_EXIT_BARRIER __DSB()
+
+static inline status_t EnableIRQ(IRQn_Type interrupt) {
+    if ((int)interrupt < 0)
+        return kStatus_Fail;
+    NVIC_EnableIRQ(interrupt);
+    return kStatus_Success;
+}
+
+static inline status_t DisableIRQ(IRQn_Type interrupt) {
+    if ((int)interrupt < 0)
+        return kStatus_Fail;
+    NVIC_DisableIRQ(interrupt);
+    return kStatus_Success;
+}
+
+#include "fsl_clock.h"
+#include "fsl_reset.h"
+
+#endif /* _FSL_COMMON_ARM_H_ */
@@ -0,0 +1,96 @@
+/**
+ * @file fsl_crc.c
+ * @brief  Native stand-in of the SDK crc driver
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include "fsl_crc.h"
+
+CRC_Type hal_crc_engine = {
+    .MODE = kCRC_Polynomial_CRC_32 | CRC_MODE_BIT_RVS_WR_MASK | CRC_MODE_BIT_RVS_SUM_MASK |
+        CRC_MODE_CMPL_SUM_MASK,
+    .SEED = 0xFFFFFFFFU,
+    .SUM = 0xFFFFFFFFU,
+};
+
+static const struct {
+    uint32_t poly;
+    uint32_t width;
+} _polys[] = {
+    [kCRC_Polynomial_CRC_CCITT] = { 0x1021U, 16U },
+    [kCRC_Polynomial_CRC_16] = { 0x8005U, 16U },
+    [kCRC_Polynomial_CRC_32] = { 0x04C11DB7U, 32U },
+};
+
+static uint32_t _reverse(uint32_t value,
+                         uint32_t width) {
+    uint32_t out = 0U;
+
+    for (uint32_t bit = 0U; bit < width; bit++)
+        out |= ((value >> bit) & 1U) << (width - 1U - bit);
+    return out;
+}
+
+static uint32_t _mask(uint32_t width) {
+    return (width == 32U) ? 0xFFFFFFFFU : ((1U << width) - 1U);
+}
+
+void CRC_GetDefaultConfig(crc_config_t * config) {
+    memset(config, 0, sizeof(*config));
+    config->polynomial = kCRC_Polynomial_CRC_CCITT;
+    config->seed = 0xFFFFU;
+}
+
+void CRC_Init(CRC_Type * base,
+              const crc_config_t * config) {
+    base->MODE = ((uint32_t)config->polynomial & CRC_MODE_CRC_POLY_MASK) |
+        (config->reverseIn ? CRC_MODE_BIT_RVS_WR_MASK : 0U) |
+        (config->complementIn ? CRC_MODE_CMPL_WR_MASK : 0U) |
+        (config->reverseOut ? CRC_MODE_BIT_RVS_SUM_MASK : 0U) |
+        (config->complementOut ? CRC_MODE_CMPL_SUM_MASK : 0U);
+    base->SEED = config->seed;
+    base->SUM = config->seed & _mask(_polys[config->polynomial].width);
+}
+
+void CRC_Reset(CRC_Type * base) {
+    crc_config_t config;
+
+    CRC_GetDefaultConfig(&config);
+    CRC_Init(base, &config);
+}
+
+void CRC_WriteData(CRC_Type * base,
+                   const uint8_t * data,
+                   size_t dataSize) {
+    uint32_t mode = base->MODE;
+    uint32_t poly = _polys[mode & CRC_MODE_CRC_POLY_MASK].poly;
+    uint32_t width = _polys[mode & CRC_MODE_CRC_POLY_MASK].width;
+    uint32_t top = 1U << (width - 1U);
+    uint32_t sum = base->SUM;
+
+    while (dataSize--) {
+        uint32_t byte = *data++;
+
+        if (mode & CRC_MODE_BIT_RVS_WR_MASK)
+            byte = _reverse(byte, 8U);
+        if (mode & CRC_MODE_CMPL_WR_MASK)
+            byte = ~byte & 0xFFU;
+        sum ^= byte << (width - 8U);
+        for (int bit = 0; bit < 8; bit++)
+            sum = (sum & top) ? ((sum << 1) ^ poly) : (sum << 1);
+        sum &= _mask(width);
+    }
+    base->SUM = sum;
+}
+
+uint32_t CRC_Get32bitResult(CRC_Type * base) {
+    uint32_t width = _polys[base->MODE & CRC_MODE_CRC_POLY_MASK].width;
+    uint32_t sum = base->SUM;
+
+    if (base->MODE & CRC_MODE_BIT_RVS_SUM_MASK)
+        sum = _reverse(sum, width);
+    if (base->MODE & CRC_MODE_CMPL_SUM_MASK)
+        sum = ~sum & _mask(width);
+    return sum;
+}
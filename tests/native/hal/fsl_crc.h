@@ -0,0 +1,48 @@
+/**
+ * @file fsl_crc.h
+ * @brief  Native stand-in of the SDK fsl_crc.h: the crc engine computed
+ *         bit by bit
+ *
+ * The engine powers up the way the bootloader leaves it (CRCEngine_init of
+ * peripherals.c: CRC-32, reflected, seed 0xFFFFFFFF, complemented out), the
+ * application never sets it up before its first crc_run_crc32.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_CRC_H_
+#define _FSL_CRC_H_
+
+#include "fsl_common.h"
+
+typedef enum _crc_polynomial {
+    kCRC_Polynomial_CRC_CCITT = 0U,
+    kCRC_Polynomial_CRC_16 = 1U,
+    kCRC_Polynomial_CRC_32 = 2U,
+} crc_polynomial_t;
+
+typedef struct _crc_config {
+    crc_polynomial_t polynomial;
+    bool reverseIn;
+    bool complementIn;
+    bool reverseOut;
+    bool complementOut;
+    uint32_t seed;
+} crc_config_t;
+
+void CRC_Init(CRC_Type * base, const crc_config_t * config);
+void CRC_Reset(CRC_Type * base);
+void CRC_GetDefaultConfig(crc_config_t * config);
+void CRC_WriteData(CRC_Type * base, const uint8_t * data, size_t dataSize);
+uint32_t CRC_Get32bitResult(CRC_Type * base);
+
+static inline void CRC_Deinit(CRC_Type * base) {
+    (void)base;
+}
+
+static inline uint16_t CRC_Get16bitResult(CRC_Type * base) {
+    return (uint16_t)CRC_Get32bitResult(base);
+}
+
+#endif /* _FSL_CRC_H_ */
@@ -0,0 +1,13 @@
+/**
+ * @file fsl_device_registers.h
+ * @brief  Native stand-in of the device registers header
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_DEVICE_REGISTERS_H_
+#define _FSL_DEVICE_REGISTERS_H_
+
+#include "LPC55S69_cm33_core0.h"
+
+#endif /* _FSL_DEVICE_REGISTERS_H_ */
@@ -0,0 +1,51 @@
+/**
+ * @file fsl_gpio.c
+ * @brief  Native stand-in of the SDK gpio driver
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include "fsl_gpio.h"
+
+GPIO_Type hal_gpio;
+
+void hal_gpio_reset(void) {
+    memset((void *)&hal_gpio, 0, sizeof(hal_gpio));
+    hal_set_gowin_ready(true);
+}
+
+void GPIO_PortInit(GPIO_Type * base,
+                   uint32_t port) {
+    (void)base;
+    (void)port;
+}
+
+void GPIO_PinInit(GPIO_Type * base,
+                  uint32_t port,
+                  uint32_t pin,
+                  const gpio_pin_config_t * config) {
+    if (config->pinDirection == kGPIO_DigitalOutput) {
+        GPIO_PinWrite(base, port, pin, config->outputLogic);
+        base->DIR[port] |= 1U << pin;
+    } else {
+        base->DIR[port] &= ~(1U << pin);
+    }
+}
+
+void GPIO_PinWrite(GPIO_Type * base,
+                   uint32_t port,
+                   uint32_t pin,
+                   uint8_t output) {
+    if (output)
+        base->SET[port] |= 1U << pin;
+    else
+        base->SET[port] &= ~(1U << pin);
+}
+
+uint32_t GPIO_PinRead(GPIO_Type * base,
+                      uint32_t port,
+                      uint32_t pin) {
+    uint32_t level = (base->DIR[port] & (1U << pin)) ? base->SET[port] : base->PIN[port];
+
+    return (level >> pin) & 1U;
+}
@@ -0,0 +1,34 @@
+/**
+ * @file fsl_gpio.h
+ * @brief  Native stand-in of the SDK fsl_gpio.h: outputs latch in
+ *         GPIO->SET, inputs read the level the simulation drives in GPIO->PIN
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_GPIO_H_
+#define _FSL_GPIO_H_
+
+#include "fsl_common.h"
+
+typedef enum _gpio_pin_direction {
+    kGPIO_DigitalInput = 0U,
+    kGPIO_DigitalOutput = 1U,
+} gpio_pin_direction_t;
+
+typedef struct _gpio_pin_config {
+    gpio_pin_direction_t pinDirection;
+    uint8_t outputLogic;
+} gpio_pin_config_t;
+
+void GPIO_PortInit(GPIO_Type * base, uint32_t port);
+void GPIO_PinInit(GPIO_Type * base, uint32_t port, uint32_t pin, const gpio_pin_config_t * config);
+void GPIO_PinWrite(GPIO_Type * base, uint32_t port, uint32_t pin, uint8_t output);
+uint32_t GPIO_PinRead(GPIO_Type * base, uint32_t port, uint32_t pin);
+
+/**
+ * @brief  Pins to their reset state: inputs, latches low, Gowin READY high
+ */
+void hal_gpio_reset(void);
+
+#endif /* _FSL_GPIO_H_ */
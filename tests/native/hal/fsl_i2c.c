@@ -0,0 +1,517 @@
+/**
+ * @file fsl_i2c.c
+ * @brief  Native stand-in of the SDK i2c driver
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include <stdlib.h>
+
+#include "fsl_i2c.h"
+#include "hal_core.h"
+
+#define DEFAULT_HZ 100000U
+
+enum phase_t {
+    PHASE_IDLE,
+    PHASE_ADDR,     // !< address byte waits for the slave
+    PHASE_DATA,     // !< data byte waits for the slave
+    PHASE_STOP,     // !< stop, deselect waits for the slave
+};
+
+enum slvstate_t {
+    SLVST_ADDR,
+    SLVST_RX,
+    SLVST_TX,
+};
+
+enum slvctl_t {
+    SLVCTL_NONE,        // !< nothing written: the slave stretches the clock
+    SLVCTL_CONTINUE,
+    SLVCTL_NACK,
+};
+
+struct hal_i2c_t {
+    // master
+    const struct hal_i2c_device_t * devices[HAL_I2C_DEVICES];
+    uint32_t master_hz;
+
+    // slave
+    struct hal_source_t source;
+    bool slave_on;
+    i2c_slave_address_t addresses[4];
+
+    // outside master on the slave's bus
+    struct hal_i2c_bus_t * queue[HAL_I2C_QUEUE];
+    uint32_t queue_rd;
+    uint32_t queue_count;
+    struct hal_i2c_bus_t * cur;
+    enum phase_t phase;
+    size_t index;
+    status_t status;
+    uint64_t byte_ns;
+    uint64_t ready_ns;
+
+    // slave registers
+    bool pending;       // !< STAT SLVPENDING
+    bool desel;         // !< STAT SLVDESEL
+    enum slvstate_t slvstate;
+    uint8_t slvdat;
+    enum slvctl_t slvctl;
+};
+
+static struct hal_i2c_t _buses[HAL_FLEXCOMM_NUM];
+
+static struct hal_i2c_t * _bus(I2C_Type * base) {
+    uint32_t index = hal_flexcomm_index(base);
+
+    return (index < HAL_FLEXCOMM_NUM) ? &_buses[index] : NULL;
+}
+
+static uint64_t _byte_ns(uint32_t hz) {
+    return 9ULL * 1000000000ULL / (hz ? hz : DEFAULT_HZ);
+}
+
+/*******************************************************************************
+ * Outside master
+ ******************************************************************************/
+static bool _match(const struct hal_i2c_t * bus,
+                   uint8_t address) {
+    if (!bus->slave_on)
+        return false;
+    for (int i = 0; i < 4; i++) {
+        if (!bus->addresses[i].addressDisable && (bus->addresses[i].address == address))
+            return true;
+    }
+    return false;
+}
+
+static void _start(struct hal_i2c_t * bus,
+                   uint64_t now) {
+    while ((bus->phase == PHASE_IDLE) && bus->queue_count) {
+        struct hal_i2c_bus_t * xfer = bus->queue[bus->queue_rd];
+
+        bus->queue_rd = (bus->queue_rd + 1) % HAL_I2C_QUEUE;
+        bus->queue_count--;
+        if (!_match(bus, xfer->address)) {
+            if (xfer->done)
+                xfer->done(xfer->ctx, kStatus_I2C_Addr_Nak, 0);
+            continue;
+        }
+        bus->cur = xfer;
+        bus->phase = PHASE_ADDR;
+        bus->index = 0;
+        bus->status = kStatus_Success;
+        bus->byte_ns = _byte_ns(xfer->hz);
+        bus->ready_ns = now + bus->byte_ns;
+        bus->slvstate = SLVST_ADDR;
+        bus->slvdat = (uint8_t)((xfer->address << 1) | (xfer->read ? 1U : 0U));
+        bus->pending = true;
+    }
+}
+
+static void _stop(struct hal_i2c_t * bus,
+                  status_t status,
+                  uint64_t now) {
+    if (bus->status == kStatus_Success)
+        bus->status = status;
+    bus->phase = PHASE_STOP;
+    bus->pending = false;
+    bus->desel = true;
+    bus->ready_ns = now + bus->byte_ns / 9U;
+}
+
+static void _finish(struct hal_i2c_t * bus,
+                    uint64_t now) {
+    struct hal_i2c_bus_t * xfer = bus->cur;
+
+    bus->cur = NULL;
+    bus->phase = PHASE_IDLE;
+    bus->pending = false;
+    bus->desel = false;
+    if (xfer && xfer->done)
+        xfer->done(xfer->ctx, bus->status, bus->index);
+    _start(bus, now);
+}
+
+// the master's side of the step the slave's handler answered
+static void _step(struct hal_i2c_t * bus,
+                  uint64_t now) {
+    struct hal_i2c_bus_t * xfer = bus->cur;
+    enum slvctl_t ctl = bus->slvctl;
+
+    // a handler that wrote nothing would stretch the clock forever, the
+    // master gives up on that byte as on a NACK
+    if (ctl == SLVCTL_NONE)
+        ctl = SLVCTL_NACK;
+    bus->slvctl = SLVCTL_NONE;
+
+    switch (bus->phase) {
+        case PHASE_ADDR:
+            if (ctl == SLVCTL_NACK) {
+                _stop(bus, kStatus_I2C_Addr_Nak, now);
+            } else if (!xfer->size) {
+                _stop(bus, kStatus_Success, now);
+            } else {
+                bus->phase = PHASE_DATA;
+                bus->slvstate = xfer->read ? SLVST_TX : SLVST_RX;
+                bus->slvdat = xfer->read ? 0xFFU : xfer->data[0];
+                bus->ready_ns = now + bus->byte_ns;
+            }
+            break;
+
+        case PHASE_DATA:
+            if (xfer->read) {
+                xfer->data[bus->index] = (ctl == SLVCTL_CONTINUE) ? bus->slvdat : 0xFFU;
+            } else if (ctl == SLVCTL_NACK) {
+                _stop(bus, kStatus_I2C_Nak, now);
+                break;
+            }
+            if (++bus->index == xfer->size) {
+                _stop(bus, kStatus_Success, now);
+            } else {
+                bus->slvdat = xfer->read ? 0xFFU : xfer->data[bus->index];
+                bus->ready_ns = now + bus->byte_ns;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static bool _asserted(void * ctx) {
+    struct hal_i2c_t * bus = ctx;
+
+    return (bus->pending || bus->desel) && (hal_now_ns() >= bus->ready_ns);
+}
+
+static void _poll(void * ctx,
+                  uint64_t now) {
+    _start(ctx, now);
+}
+
+static uint64_t _next_ns(void * ctx) {
+    struct hal_i2c_t * bus = ctx;
+
+    return (bus->pending || bus->desel) ? bus->ready_ns : HAL_NEVER;
+}
+
+static void _attach_source(struct hal_i2c_t * bus) {
+    bus->source = (struct hal_source_t) {
+        .irq = FLEXCOMM0_IRQn + (int)(bus - _buses),
+        .asserted = _asserted,
+        .poll = _poll,
+        .next_ns = _next_ns,
+        .ctx = bus,
+    };
+    hal_core_attach(&bus->source);
+}
+
+void hal_i2c_attach(I2C_Type * base,
+                    const struct hal_i2c_device_t * device) {
+    struct hal_i2c_t * bus = _bus(base);
+
+    for (int i = 0; i < HAL_I2C_DEVICES; i++) {
+        if (!bus->devices[i] || (bus->devices[i]->address == device->address)) {
+            bus->devices[i] = device;
+            return;
+        }
+    }
+}
+
+status_t hal_i2c_bus_transfer(I2C_Type * base,
+                              struct hal_i2c_bus_t * xfer) {
+    struct hal_i2c_t * bus = _bus(base);
+
+    if (bus->queue_count == HAL_I2C_QUEUE)
+        return kStatus_I2C_Busy;
+
+    hal_enter();
+    if (!bus->source.ctx)
+        _attach_source(bus);
+    bus->queue[(bus->queue_rd + bus->queue_count) % HAL_I2C_QUEUE] = xfer;
+    bus->queue_count++;
+    _start(bus, hal_now_ns());
+    hal_exit();
+    return kStatus_Success;
+}
+
+/*******************************************************************************
+ * SDK master
+ ******************************************************************************/
+void I2C_MasterGetDefaultConfig(i2c_master_config_t * masterConfig) {
+    memset(masterConfig, 0, sizeof(*masterConfig));
+    masterConfig->enableMaster = true;
+    masterConfig->baudRate_Bps = DEFAULT_HZ;
+    masterConfig->timeout_Ms = 35;
+}
+
+void I2C_MasterInit(I2C_Type * base,
+                    const i2c_master_config_t * masterConfig,
+                    uint32_t srcClock_Hz) {
+    (void)srcClock_Hz;
+    _bus(base)->master_hz = masterConfig->baudRate_Bps;
+}
+
+void I2C_MasterDeinit(I2C_Type * base) {
+    (void)base;
+}
+
+status_t I2C_MasterTransferBlocking(I2C_Type * base,
+                                    i2c_master_transfer_t * xfer) {
+    struct hal_i2c_t * bus = _bus(base);
+    const struct hal_i2c_device_t * dev = NULL;
+    uint8_t sub[4];
+    status_t status = kStatus_Success;
+
+    if (!bus || !xfer || (xfer->subaddressSize > sizeof(sub)))
+        return kStatus_InvalidArgument;
+
+    for (int i = 0; i < HAL_I2C_DEVICES; i++) {
+        if (bus->devices[i] && (bus->devices[i]->address == xfer->slaveAddress))
+            dev = bus->devices[i];
+    }
+
+    size_t bytes = 1U;
+
+    for (size_t i = 0; i < xfer->subaddressSize; i++)
+        sub[i] = (uint8_t)(xfer->subaddress >> (8U * (xfer->subaddressSize - 1U - i)));
+
+    if (!dev) {
+        status = kStatus_I2C_Addr_Nak;
+    } else if (xfer->direction == kI2C_Write) {
+        uint8_t * msg = malloc(xfer->subaddressSize + xfer->dataSize + 1U);
+
+        memcpy(msg, sub, xfer->subaddressSize);
+        if (xfer->dataSize)
+            memcpy(&msg[xfer->subaddressSize], xfer->data, xfer->dataSize);
+        bytes += xfer->subaddressSize + xfer->dataSize;
+        if (dev->write && !dev->write(dev->ctx, msg, xfer->subaddressSize + xfer->dataSize))
+            status = kStatus_I2C_Nak;
+        free(msg);
+    } else {
+        if (xfer->subaddressSize) {
+            bytes += xfer->subaddressSize + 1U; // repeated start, address again
+            if (dev->write && !dev->write(dev->ctx, sub, xfer->subaddressSize))
+                status = kStatus_I2C_Nak;
+        }
+        if (status == kStatus_Success) {
+            bytes += xfer->dataSize;
+            if (!dev->read)
+                memset(xfer->data, 0, xfer->dataSize);
+            else if (!dev->read(dev->ctx, xfer->data, xfer->dataSize))
+                status = kStatus_I2C_Nak;
+        }
+    }
+
+    hal_delay_ns(bytes * _byte_ns(bus->master_hz));
+    return status;
+}
+
+void I2C_MasterTransferCreateHandle(I2C_Type * base,
+                                    i2c_master_handle_t * handle,
+                                    i2c_master_transfer_callback_t callback,
+                                    void * userData) {
+    (void)base;
+    memset(handle, 0, sizeof(*handle));
+    handle->completionCallback = callback;
+    handle->userData = userData;
+}
+
+status_t I2C_MasterTransferNonBlocking(I2C_Type * base,
+                                       i2c_master_handle_t * handle,
+                                       i2c_master_transfer_t * xfer) {
+    status_t status = I2C_MasterTransferBlocking(base, xfer);
+
+    handle->transfer = *xfer;
+    if (handle->completionCallback)
+        handle->completionCallback(base, handle, status, handle->userData);
+    return kStatus_Success;
+}
+
+void I2C_MasterTransferHandleIRQ(I2C_Type * base,
+                                 i2c_master_handle_t * handle) {
+    (void)base;
+    (void)handle;
+}
+
+/*******************************************************************************
+ * SDK slave
+ ******************************************************************************/
+void I2C_SlaveGetDefaultConfig(i2c_slave_config_t * slaveConfig) {
+    memset(slaveConfig, 0, sizeof(*slaveConfig));
+    slaveConfig->enableSlave = true;
+    slaveConfig->address1.addressDisable = true;
+    slaveConfig->address2.addressDisable = true;
+    slaveConfig->address3.addressDisable = true;
+}
+
+status_t I2C_SlaveInit(I2C_Type * base,
+                       const i2c_slave_config_t * slaveConfig,
+                       uint32_t srcClock_Hz) {
+    struct hal_i2c_t * bus = _bus(base);
+
+    (void)srcClock_Hz;
+    hal_enter();
+    if (!bus->source.ctx)
+        _attach_source(bus);
+    bus->addresses[0] = slaveConfig->address0;
+    bus->addresses[1] = slaveConfig->address1;
+    bus->addresses[2] = slaveConfig->address2;
+    bus->addresses[3] = slaveConfig->address3;
+    I2C_SlaveEnable(base, slaveConfig->enableSlave);
+    hal_exit();
+    return kStatus_Success;
+}
+
+void I2C_SlaveDeinit(I2C_Type * base) {
+    I2C_SlaveEnable(base, false);
+}
+
+void I2C_SlaveEnable(I2C_Type * base,
+                     bool enable) {
+    struct hal_i2c_t * bus = _bus(base);
+
+    hal_enter();
+    bus->slave_on = enable;
+    if (!enable && (bus->phase != PHASE_IDLE)) {
+        // the master sees the slave vanish
+        if (bus->status == kStatus_Success)
+            bus->status = (bus->phase == PHASE_ADDR) ? kStatus_I2C_Addr_Nak : kStatus_I2C_Nak;
+        _finish(bus, hal_now_ns());
+    }
+    hal_exit();
+}
+
+void I2C_SlaveTransferCreateHandle(I2C_Type * base,
+                                   i2c_slave_handle_t * handle,
+                                   i2c_slave_transfer_callback_t callback,
+                                   void * userData) {
+    uint32_t index = hal_flexcomm_index(base);
+
+    memset(handle, 0, sizeof(*handle));
+    handle->callback = callback;
+    handle->userData = userData;
+    (void)EnableIRQ((IRQn_Type)(FLEXCOMM0_IRQn + (int)index));
+}
+
+status_t I2C_SlaveTransferNonBlocking(I2C_Type * base,
+                                      i2c_slave_handle_t * handle,
+                                      uint32_t eventMask) {
+    status_t status = handle->isBusy ? kStatus_I2C_Busy : kStatus_Success;
+
+    handle->transfer.txData = NULL;
+    handle->transfer.txSize = 0;
+    handle->transfer.rxData = NULL;
+    handle->transfer.rxSize = 0;
+    handle->transfer.transferredCount = 0;
+    handle->transfer.eventMask = eventMask | kI2C_SlaveTransmitEvent | kI2C_SlaveReceiveEvent;
+    handle->isBusy = true;
+    I2C_SlaveEnable(base, true);
+    return status;
+}
+
+void I2C_SlaveTransferAbort(I2C_Type * base,
+                            i2c_slave_handle_t * handle) {
+    I2C_SlaveEnable(base, false);
+    handle->isBusy = false;
+    handle->transfer.txSize = 0U;
+    handle->transfer.rxSize = 0U;
+}
+
+// I2C_SlaveInvokeEvent of the SDK
+static void _invoke(I2C_Type * base,
+                    i2c_slave_handle_t * handle,
+                    i2c_slave_transfer_event_t event) {
+    uint32_t eventMask = handle->transfer.eventMask;
+
+    handle->transfer.event = event;
+    if (handle->callback && (eventMask & (uint32_t)event)) {
+        handle->callback(base, &handle->transfer, handle->userData);
+
+        if (!handle->isBusy &&
+            ((handle->transfer.txData && handle->transfer.txSize) ||
+             (handle->transfer.rxData && handle->transfer.rxSize)))
+            handle->isBusy = true;
+
+        if ((event == kI2C_SlaveReceiveEvent) || (event == kI2C_SlaveTransmitEvent))
+            handle->transfer.transferredCount = 0;
+    }
+}
+
+// I2C_SlaveAddressIRQ of the SDK
+static void _address(struct hal_i2c_t * bus,
+                     I2C_Type * base,
+                     i2c_slave_handle_t * handle) {
+    handle->transfer.receivedAddress = bus->slvdat;
+
+    if (bus->slvdat & 1U) {
+        if (!handle->transfer.txData || !handle->transfer.txSize)
+            _invoke(base, handle, kI2C_SlaveTransmitEvent);
+        if (!handle->transfer.txData || !handle->transfer.txSize) {
+            bus->slvctl = SLVCTL_NACK;
+            return;
+        }
+        handle->slaveFsm = kI2C_SlaveFsmTransmit;
+    } else {
+        if (!handle->transfer.rxData || !handle->transfer.rxSize)
+            _invoke(base, handle, kI2C_SlaveReceiveEvent);
+        if (!handle->transfer.rxData || !handle->transfer.rxSize) {
+            bus->slvctl = SLVCTL_NACK;
+            return;
+        }
+        handle->slaveFsm = kI2C_SlaveFsmReceive;
+    }
+    bus->slvctl = SLVCTL_CONTINUE;
+}
+
+void I2C_SlaveTransferHandleIRQ(I2C_Type * base,
+                                i2c_slave_handle_t * handle) {
+    struct hal_i2c_t * bus = _bus(base);
+    uint64_t now = hal_now_ns();
+
+    hal_enter();
+    if (bus->desel && (now >= bus->ready_ns)) {
+        _invoke(base, handle, kI2C_SlaveDeselectedEvent);
+        _finish(bus, now);
+    } else if (bus->pending && (now >= bus->ready_ns)) {
+        bus->slvctl = SLVCTL_NONE;
+        if (bus->slvstate == SLVST_ADDR) {
+            _address(bus, base, handle);
+            _invoke(base, handle, kI2C_SlaveAddressMatchEvent);
+        } else if ((handle->slaveFsm == kI2C_SlaveFsmReceive) && (bus->slvstate == SLVST_RX)) {
+            if (!handle->transfer.rxData || !handle->transfer.rxSize)
+                _invoke(base, handle, kI2C_SlaveReceiveEvent);
+            if (handle->transfer.rxData && handle->transfer.rxSize) {
+                bus->slvctl = SLVCTL_CONTINUE;
+                *(handle->transfer.rxData) = bus->slvdat;
+                handle->transfer.rxSize--;
+                handle->transfer.rxData++;
+                handle->transfer.transferredCount++;
+            }
+            if (!handle->transfer.rxSize && !handle->transfer.txSize) {
+                handle->isBusy = false;
+                _invoke(base, handle, kI2C_SlaveCompletionEvent);
+            }
+        } else if ((handle->slaveFsm == kI2C_SlaveFsmTransmit) && (bus->slvstate == SLVST_TX)) {
+            if (!handle->transfer.txData || !handle->transfer.txSize)
+                _invoke(base, handle, kI2C_SlaveTransmitEvent);
+            if (handle->transfer.txData && handle->transfer.txSize) {
+                bus->slvdat = *(handle->transfer.txData);
+                bus->slvctl = SLVCTL_CONTINUE;
+                handle->transfer.txSize--;
+                handle->transfer.txData++;
+                handle->transfer.transferredCount++;
+            }
+            if (!handle->transfer.rxSize && !handle->transfer.txSize) {
+                handle->isBusy = false;
+                _invoke(base, handle, kI2C_SlaveCompletionEvent);
+            }
+        } else {
+            bus->slvctl = SLVCTL_NACK;
+        }
+        _step(bus, now);
+    }
+    hal_exit();
+}
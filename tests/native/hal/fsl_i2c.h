@@ -0,0 +1,235 @@
+/**
+ * @file fsl_i2c.h
+ * @brief  Native stand-in of the SDK fsl_i2c.h
+ *
+ * Same types and calls as vendor/drivers/fsl_i2c.h on a flexcomm model:
+ *  - master: I2C_MasterTransferBlocking talks to the devices attached with
+ *    hal_i2c_attach, an address nobody answers is kStatus_I2C_Addr_Nak.
+ *    The subaddress goes first, MSB first, a read writes it and reads after
+ *    a repeated start. Each byte takes 9 clocks at the baud rate. A
+ *    non-blocking transfer runs the same way and calls back before it
+ *    returns.
+ *  - slave: hal_i2c_bus_transfer queues what an outside master does on the
+ *    bus. Every step (address, each data byte, the stop) raises
+ *    FLEXCOMMn_IRQn 9 clocks after the previous one, the firmware's
+ *    handler runs I2C_SlaveTransferHandleIRQ which walks the vendor state
+ *    machine and events. An address the slave does not match or NACKs ends
+ *    the transaction with kStatus_I2C_Addr_Nak, a data byte without a
+ *    receive buffer with kStatus_I2C_Nak, a read without data reads 0xFF.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_I2C_H_
+#define _FSL_I2C_H_
+
+#include "fsl_common.h"
+
+#define HAL_I2C_DEVICES 8 // !< attached devices per master
+#define HAL_I2C_QUEUE   8 // !< bus transactions waiting per slave
+
+enum {
+    kStatus_I2C_Busy = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 0),
+    kStatus_I2C_Idle = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 1),
+    kStatus_I2C_Nak = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 2),
+    kStatus_I2C_InvalidParameter = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 3),
+    kStatus_I2C_BitError = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 4),
+    kStatus_I2C_ArbitrationLost = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 5),
+    kStatus_I2C_NoTransferInProgress = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 6),
+    kStatus_I2C_DmaRequestFail = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 7),
+    kStatus_I2C_StartStopError = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 8),
+    kStatus_I2C_UnexpectedState = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 9),
+    kStatus_I2C_Timeout = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 10),
+    kStatus_I2C_Addr_Nak = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 11),
+    kStatus_I2C_EventTimeout = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 12),
+    kStatus_I2C_SclLowTimeout = MAKE_STATUS(kStatusGroup_FLEXCOMM_I2C, 13),
+};
+
+/*******************************************************************************
+ * Master
+ ******************************************************************************/
+typedef enum _i2c_direction {
+    kI2C_Write = 0U,
+    kI2C_Read = 1U,
+} i2c_direction_t;
+
+enum _i2c_master_transfer_flags {
+    kI2C_TransferDefaultFlag = 0x00U,
+    kI2C_TransferNoStartFlag = 0x01U,
+    kI2C_TransferRepeatedStartFlag = 0x02U,
+    kI2C_TransferNoStopFlag = 0x04U,
+};
+
+typedef struct _i2c_master_config {
+    bool enableMaster;
+    uint32_t baudRate_Bps;
+    bool enableTimeout;
+    uint8_t timeout_Ms;
+} i2c_master_config_t;
+
+typedef struct _i2c_master_transfer {
+    uint32_t flags;
+    uint8_t slaveAddress;
+    i2c_direction_t direction;
+    uint32_t subaddress;        // !< sent MSB first
+    size_t subaddressSize;
+    void * data;
+    size_t dataSize;
+} i2c_master_transfer_t;
+
+typedef struct _i2c_master_handle i2c_master_handle_t;
+
+typedef void (*i2c_master_transfer_callback_t)(I2C_Type * base,
+                                               i2c_master_handle_t * handle,
+                                               status_t completionStatus,
+                                               void * userData);
+
+struct _i2c_master_handle {
+    uint8_t state;
+    uint32_t transferCount;
+    uint32_t remainingBytes;
+    uint8_t * buf;
+    uint32_t remainingSubaddr;
+    uint8_t subaddrBuf[4];
+    bool checkAddrNack;
+    i2c_master_transfer_t transfer;
+    i2c_master_transfer_callback_t completionCallback;
+    void * userData;
+};
+
+void I2C_MasterGetDefaultConfig(i2c_master_config_t * masterConfig);
+void I2C_MasterInit(I2C_Type * base, const i2c_master_config_t * masterConfig, uint32_t srcClock_Hz);
+void I2C_MasterDeinit(I2C_Type * base);
+status_t I2C_MasterTransferBlocking(I2C_Type * base, i2c_master_transfer_t * xfer);
+void I2C_MasterTransferCreateHandle(I2C_Type * base,
+                                    i2c_master_handle_t * handle,
+                                    i2c_master_transfer_callback_t callback,
+                                    void * userData);
+status_t I2C_MasterTransferNonBlocking(I2C_Type * base, i2c_master_handle_t * handle, i2c_master_transfer_t * xfer);
+void I2C_MasterTransferHandleIRQ(I2C_Type * base, i2c_master_handle_t * handle);
+
+/*******************************************************************************
+ * Slave
+ ******************************************************************************/
+typedef struct _i2c_slave_address {
+    uint8_t address;
+    bool addressDisable;
+} i2c_slave_address_t;
+
+typedef enum _i2c_slave_address_qual_mode {
+    kI2C_QualModeMask = 0U,
+    kI2C_QualModeExtend,
+} i2c_slave_address_qual_mode_t;
+
+typedef enum _i2c_slave_bus_speed {
+    kI2C_SlaveStandardMode = 0U,
+    kI2C_SlaveFastMode,
+    kI2C_SlaveFastModePlus,
+    kI2C_SlaveHsMode,
+} i2c_slave_bus_speed_t;
+
+typedef struct _i2c_slave_config {
+    i2c_slave_address_t address0;
+    i2c_slave_address_t address1;
+    i2c_slave_address_t address2;
+    i2c_slave_address_t address3;
+    i2c_slave_address_qual_mode_t qualMode;
+    uint8_t qualAddress;
+    i2c_slave_bus_speed_t busSpeed;
+    bool enableSlave;
+} i2c_slave_config_t;
+
+typedef enum _i2c_slave_transfer_event {
+    kI2C_SlaveAddressMatchEvent = 0x01U,
+    kI2C_SlaveTransmitEvent = 0x02U,
+    kI2C_SlaveReceiveEvent = 0x04U,
+    kI2C_SlaveCompletionEvent = 0x20U,
+    kI2C_SlaveDeselectedEvent = 0x40U,
+    kI2C_SlaveAllEvents = kI2C_SlaveAddressMatchEvent | kI2C_SlaveTransmitEvent | kI2C_SlaveReceiveEvent |
+        kI2C_SlaveCompletionEvent | kI2C_SlaveDeselectedEvent,
+} i2c_slave_transfer_event_t;
+
+typedef struct _i2c_slave_handle i2c_slave_handle_t;
+
+typedef struct _i2c_slave_transfer {
+    i2c_slave_handle_t * handle;
+    i2c_slave_transfer_event_t event;
+    uint8_t receivedAddress;    // !< address byte, R/nW in bit 0
+    uint32_t eventMask;
+    uint8_t * rxData;
+    const uint8_t * txData;
+    size_t txSize;
+    size_t rxSize;
+    size_t transferredCount;
+    status_t completionStatus;
+} i2c_slave_transfer_t;
+
+typedef void (*i2c_slave_transfer_callback_t)(I2C_Type * base,
+                                              volatile i2c_slave_transfer_t * transfer,
+                                              void * userData);
+
+typedef enum _i2c_slave_fsm {
+    kI2C_SlaveFsmAddressMatch = 0u,
+    kI2C_SlaveFsmReceive = 2u,
+    kI2C_SlaveFsmTransmit = 3u,
+} i2c_slave_fsm_t;
+
+struct _i2c_slave_handle {
+    volatile i2c_slave_transfer_t transfer;
+    volatile bool isBusy;
+    volatile i2c_slave_fsm_t slaveFsm;
+    i2c_slave_transfer_callback_t callback;
+    void * userData;
+};
+
+void I2C_SlaveGetDefaultConfig(i2c_slave_config_t * slaveConfig);
+status_t I2C_SlaveInit(I2C_Type * base, const i2c_slave_config_t * slaveConfig, uint32_t srcClock_Hz);
+void I2C_SlaveDeinit(I2C_Type * base);
+void I2C_SlaveEnable(I2C_Type * base, bool enable);
+void I2C_SlaveTransferCreateHandle(I2C_Type * base,
+                                   i2c_slave_handle_t * handle,
+                                   i2c_slave_transfer_callback_t callback,
+                                   void * userData);
+status_t I2C_SlaveTransferNonBlocking(I2C_Type * base, i2c_slave_handle_t * handle, uint32_t eventMask);
+void I2C_SlaveTransferAbort(I2C_Type * base, i2c_slave_handle_t * handle);
+void I2C_SlaveTransferHandleIRQ(I2C_Type * base, i2c_slave_handle_t * handle);
+
+/*******************************************************************************
+ * Simulation
+ ******************************************************************************/
+/**
+ * @brief  A device on a master's bus, false from a callback: NACK. NULL
+ *         callbacks ACK, reads return 0
+ */
+struct hal_i2c_device_t {
+    uint8_t address;    // !< 7 bit
+    bool (*write)(void * ctx, const uint8_t * data, size_t size);
+    bool (*read)(void * ctx, uint8_t * data, size_t size);
+    void * ctx;
+};
+
+/**
+ * @brief  A transaction of an outside master on a slave's bus: start,
+ *         address, size bytes, stop. done runs from the slave's interrupt
+ *         with the status the master saw and the bytes acknowledged
+ */
+struct hal_i2c_bus_t {
+    uint8_t address;    // !< 7 bit
+    bool read;
+    uint8_t * data;
+    size_t size;
+    uint32_t hz;        // !< bus clock, 0: 100kHz
+    void (*done)(void * ctx, status_t status, size_t count);
+    void * ctx;
+};
+
+void hal_i2c_attach(I2C_Type * base, const struct hal_i2c_device_t * device);
+
+/**
+ * @brief  Queue a transaction, the caller keeps xfer until done.
+ *         kStatus_I2C_Busy: queue full
+ */
+status_t hal_i2c_bus_transfer(I2C_Type * base, struct hal_i2c_bus_t * xfer);
+
+#endif /* _FSL_I2C_H_ */
@@ -0,0 +1,95 @@
+/**
+ * @file fsl_iap.c
+ * @brief  Native stand-in of the SDK iap flash driver
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include "fsl_iap.h"
+
+uint8_t hal_flash[HAL_FLASH_SIZE] __attribute__((aligned(0x8000)));
+
+// !< erased at power on
+__attribute__((constructor)) static void _erase_all(void) {
+    memset(hal_flash, 0xFF, sizeof(hal_flash));
+}
+
+// !< pointer into hal_flash, NULL: outside
+static uint8_t * _flash(uint32_t start,
+                        uint32_t length) {
+    uintptr_t base = (uintptr_t)hal_flash;
+
+    if ((start < base) || (start - base > HAL_FLASH_SIZE) || (length > HAL_FLASH_SIZE - (start - base)))
+        return NULL;
+    return &hal_flash[start - base];
+}
+
+status_t FLASH_Init(flash_config_t * config) {
+    if (!config)
+        return kStatus_FLASH_InvalidArgument;
+    config->PFlashBlockBase = (uint32_t)(uintptr_t)hal_flash;
+    config->PFlashTotalSize = HAL_FLASH_SIZE;
+    config->PFlashPageSize = HAL_FLASH_PAGE_SIZE;
+    return kStatus_FLASH_Success;
+}
+
+status_t FLASH_Erase(flash_config_t * config,
+                     uint32_t start,
+                     uint32_t lengthInBytes,
+                     uint32_t key) {
+    uint8_t * at = _flash(start, lengthInBytes);
+
+    (void)config;
+    if (key != kFLASH_ApiEraseKey)
+        return kStatus_FLASH_EraseKeyError;
+    if (!at)
+        return kStatus_FLASH_AddressError;
+    if (((at - hal_flash) % HAL_FLASH_PAGE_SIZE) || (lengthInBytes % HAL_FLASH_PAGE_SIZE))
+        return kStatus_FLASH_AlignmentError;
+    memset(at, 0xFF, lengthInBytes);
+    return kStatus_FLASH_Success;
+}
+
+status_t FLASH_Program(flash_config_t * config,
+                       uint32_t start,
+                       uint8_t * src,
+                       uint32_t lengthInBytes) {
+    uint8_t * at = _flash(start, lengthInBytes);
+
+    (void)config;
+    if (!at)
+        return kStatus_FLASH_AddressError;
+    if ((at - hal_flash) % HAL_FLASH_PAGE_SIZE)
+        return kStatus_FLASH_AlignmentError;
+    for (uint32_t i = 0; i < lengthInBytes; i++)
+        at[i] &= src[i];
+    return kStatus_FLASH_Success;
+}
+
+status_t FLASH_Read(flash_config_t * config,
+                    uint32_t start,
+                    uint8_t * dest,
+                    uint32_t lengthInBytes) {
+    uint8_t * at = _flash(start, lengthInBytes);
+
+    (void)config;
+    if (!at)
+        return kStatus_FLASH_AddressError;
+    memcpy(dest, at, lengthInBytes);
+    return kStatus_FLASH_Success;
+}
+
+status_t FLASH_VerifyErase(flash_config_t * config,
+                           uint32_t start,
+                           uint32_t lengthInBytes) {
+    uint8_t * at = _flash(start, lengthInBytes);
+
+    (void)config;
+    if (!at)
+        return kStatus_FLASH_AddressError;
+    for (uint32_t i = 0; i < lengthInBytes; i++) {
+        if (at[i] != 0xFFU)
+            return kStatus_FLASH_CommandFailure;
+    }
+    return kStatus_FLASH_Success;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file fsl_iap.h
+ * @brief  Native stand-in of the SDK fsl_iap.h: the internal flash is
+ *         hal_flash, the flash addresses are pointers into it (the native
+ *         application links its partitions there, memory_map.h)
+ *
+ * Erase works on 512 byte pages and fills 0xFF, program needs a page
+ * aligned start and can only clear bits.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_IAP_H_
+#define _FSL_IAP_H_
+
+#include "fsl_common.h"
+
+#define HAL_FLASH_SIZE      0x9D800U // !< 630kB, up to the protected flash region
+#define HAL_FLASH_PAGE_SIZE 512U
+
+#define FOUR_CHAR_CODE(a, b, c, d) (((uint32_t)(d) << 24) | ((uint32_t)(c) << 16) | ((uint32_t)(b) << 8) | ((uint32_t)(a)))
+
+enum _flash_status {
+    kStatus_FLASH_Success = MAKE_STATUS(kStatusGroup_Generic, 0),
+    kStatus_FLASH_InvalidArgument = MAKE_STATUS(kStatusGroup_Generic, 4),
+    kStatus_FLASH_SizeError = MAKE_STATUS(kStatusGroup_FLASH, 0),
+    kStatus_FLASH_AlignmentError = MAKE_STATUS(kStatusGroup_FLASH, 1),
+    kStatus_FLASH_AddressError = MAKE_STATUS(kStatusGroup_FLASH, 2),
+    kStatus_FLASH_AccessError = MAKE_STATUS(kStatusGroup_FLASH, 3),
+    kStatus_FLASH_CommandFailure = MAKE_STATUS(kStatusGroup_FLASH, 5),
+    kStatus_FLASH_EraseKeyError = MAKE_STATUS(kStatusGroup_FLASH, 7),
+};
+
+enum _flash_driver_api_keys {
+    kFLASH_ApiEraseKey = FOUR_CHAR_CODE('l', 'f', 'e', 'k'),
+};
+
+typedef struct {
+    uint32_t sysFreqInMHz;
+} flash_mode_config_t;
+
+typedef struct {
+    uint32_t PFlashBlockBase;
+    uint32_t PFlashTotalSize;
+    uint32_t PFlashPageSize;
+    flash_mode_config_t modeConfig;
+} flash_config_t;
+
+extern uint8_t hal_flash[HAL_FLASH_SIZE];
+
+status_t FLASH_Init(flash_config_t * config);
+status_t FLASH_Erase(flash_config_t * config, uint32_t start, uint32_t lengthInBytes, uint32_t key);
+status_t FLASH_Program(flash_config_t * config, uint32_t start, uint8_t * src, uint32_t lengthInBytes);
+status_t FLASH_Read(flash_config_t * config, uint32_t start, uint8_t * dest, uint32_t lengthInBytes);
+status_t FLASH_VerifyErase(flash_config_t * config, uint32_t start, uint32_t lengthInBytes);
+
+#endif /* _FSL_IAP_H_ */
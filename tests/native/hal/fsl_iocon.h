@@ -0,0 +1,21 @@
+/**
+ * @file fsl_iocon.h
+ * @brief  Native stand-in of the SDK fsl_iocon.h: IOCON is plain memory
+ *         (LPC55S69_cm33_core0.h)
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_IOCON_H_
+#define _FSL_IOCON_H_
+
+#include "fsl_common.h"
+
+static inline void IOCON_PinMuxSet(IOCON_Type * base,
+                                   uint8_t port,
+                                   uint8_t pin,
+                                   uint32_t modefunc) {
+    base->PIO[port][pin] = modefunc;
+}
+
+#endif /* _FSL_IOCON_H_ */
@@ -0,0 +1,33 @@
+/**
+ * @file fsl_reset.h
+ * @brief  Native stand-in of the SDK fsl_reset.h: a flexcomm reset clears
+ *         its registers, the models start over at their _Init
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_RESET_H_
+#define _FSL_RESET_H_
+
+#include "fsl_common.h"
+
+typedef enum _SYSCON_RSTn {
+    kFC0_RST_SHIFT_RSTn = 0,
+    kFC1_RST_SHIFT_RSTn,
+    kFC2_RST_SHIFT_RSTn,
+    kFC3_RST_SHIFT_RSTn,
+    kFC4_RST_SHIFT_RSTn,
+    kFC5_RST_SHIFT_RSTn,
+    kFC6_RST_SHIFT_RSTn,
+    kFC7_RST_SHIFT_RSTn,
+    kHSLSPI_RST_SHIFT_RSTn,
+    kCRC_RST_SHIFT_RSTn,
+    kGPIO0_RST_SHIFT_RSTn,
+    kGPIO1_RST_SHIFT_RSTn,
+} SYSCON_RSTn_t;
+
+typedef SYSCON_RSTn_t reset_ip_name_t;
+
+void RESET_PeripheralReset(reset_ip_name_t peripheral);
+
+#endif /* _FSL_RESET_H_ */
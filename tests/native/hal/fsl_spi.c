@@ -0,0 +1,257 @@
+/**
+ * @file fsl_spi.c
+ * @brief  Native stand-in of the SDK spi master driver
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include "fsl_spi.h"
+#include "hal_core.h"
+
+#define SPI_IDLE 0
+#define SPI_BUSY 1
+
+SPI_Type hal_spi8;
+
+static struct hal_source_t _source; // !< hal_spi8 on LSPI_HS_IRQn
+
+static const uint8_t s_dummyData = 0xFF; // !< SPI_DUMMYDATA of the SDK
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+// one byte on the bus, its time advances the clock or adds to *wait_ns
+static uint8_t _exchange(SPI_Type * base,
+                         uint8_t mosi,
+                         uint64_t * wait_ns) {
+    const struct hal_spi_device_t * dev = base->device;
+    uint64_t ns = (8ULL * 1000000000ULL) / (base->baud ? base->baud : 1U);
+
+    if (!base->selected) {
+        base->selected = true;
+        base->stats.frames++;
+        if (dev && dev->select)
+            dev->select(dev->ctx);
+    }
+    base->stats.bytes++;
+    base->stats.busy_ns += ns;
+    if (wait_ns)
+        *wait_ns += ns;
+    else
+        hal_advance_ns(ns);
+    return (dev && dev->exchange) ? dev->exchange(dev->ctx, mosi) : 0xFF;
+}
+
+// the bus time once the core runs: interrupts are taken while it passes
+static uint64_t * _wait(uint64_t * ns) {
+    *ns = 0;
+    return hal_core_started() ? ns : NULL;
+}
+
+static bool _asserted(void * ctx) {
+    SPI_Type * base = ctx;
+
+    return base->pending && base->fifointen && (hal_now_ns() >= base->ready_ns);
+}
+
+static uint64_t _next_ns(void * ctx) {
+    SPI_Type * base = ctx;
+
+    return (base->pending && base->fifointen) ? base->ready_ns : HAL_NEVER;
+}
+
+static void _end_frame(SPI_Type * base) {
+    const struct hal_spi_device_t * dev = base->device;
+
+    if (!base->selected)
+        return;
+    base->selected = false;
+    if (dev && dev->deselect)
+        dev->deselect(dev->ctx);
+}
+
+void SPI_MasterGetDefaultConfig(spi_master_config_t * config) {
+    memset(config, 0, sizeof(*config));
+    config->enableMaster = true;
+    config->baudRate_Bps = 500000U;
+    config->dataWidth = kSPI_Data8Bits;
+    config->sselNum = kSPI_Ssel0;
+}
+
+status_t SPI_MasterInit(SPI_Type * base,
+                        const spi_master_config_t * config,
+                        uint32_t srcClock_Hz) {
+    if (!config || !config->baudRate_Bps)
+        return kStatus_InvalidArgument;
+
+    // SPI_MasterSetBaud: DIV = round(src / baud) - 1
+    uint32_t div = ((srcClock_Hz * 10U) / config->baudRate_Bps + 5U) / 10U;
+    if ((div == 0) || (div > 0x10000U))
+        return kStatus_InvalidArgument;
+
+    hal_enter();
+    base->baud = srcClock_Hz / div;
+    base->selected = false;
+    base->fifointen = 0;
+    base->pending = NULL;
+    memset(&base->stats, 0, sizeof(base->stats));
+    hal_exit();
+    return kStatus_Success;
+}
+
+void SPI_DisableInterrupts(SPI_Type * base,
+                           uint32_t irqs) {
+    hal_enter();
+    base->fifointen &= ~irqs;
+    hal_exit();
+}
+
+void SPI_WriteData(SPI_Type * base,
+                   uint16_t data,
+                   uint32_t configFlags) {
+    uint64_t ns;
+    uint64_t * wait = _wait(&ns);
+
+    hal_enter();
+    if (base->pending)
+        base->stats.collisions++;
+    _exchange(base, (uint8_t)data, wait);
+    if (configFlags & kSPI_FrameAssert)
+        _end_frame(base);
+    hal_exit();
+    if (wait)
+        hal_delay_ns(ns);
+}
+
+status_t SPI_MasterTransferBlocking(SPI_Type * base,
+                                   spi_transfer_t * xfer) {
+    uint64_t ns;
+    uint64_t * wait = _wait(&ns);
+
+    if (!xfer || !xfer->dataSize || (!xfer->txData && !xfer->rxData))
+        return kStatus_InvalidArgument;
+
+    hal_enter();
+    if (base->pending)
+        base->stats.collisions++;
+
+    for (size_t i = 0; i < xfer->dataSize; i++) {
+        uint8_t rx = _exchange(base, xfer->txData ? xfer->txData[i] : s_dummyData, wait);
+
+        if (xfer->rxData)
+            xfer->rxData[i] = rx;
+    }
+    if (xfer->configFlags & kSPI_FrameAssert)
+        _end_frame(base);
+    hal_exit();
+    if (wait)
+        hal_delay_ns(ns);
+    return kStatus_Success;
+}
+
+status_t SPI_MasterTransferCreateHandle(SPI_Type * base,
+                                        spi_master_handle_t * handle,
+                                        spi_master_callback_t callback,
+                                        void * userData) {
+    memset(handle, 0, sizeof(*handle));
+    handle->callback = callback;
+    handle->userData = userData;
+
+    hal_enter();
+    _source = (struct hal_source_t) {
+        .irq = LSPI_HS_IRQn,
+        .asserted = _asserted,
+        .next_ns = _next_ns,
+        .ctx = base,
+    };
+    hal_core_attach(&_source);
+    hal_exit();
+    (void)EnableIRQ(LSPI_HS_IRQn);
+    return kStatus_Success;
+}
+
+status_t SPI_MasterTransferNonBlocking(SPI_Type * base,
+                                       spi_master_handle_t * handle,
+                                       spi_transfer_t * xfer) {
+    if (!xfer || !xfer->dataSize || (!xfer->txData && !xfer->rxData))
+        return kStatus_InvalidArgument;
+    if (handle->state == SPI_BUSY)
+        return kStatus_SPI_Busy;
+
+    hal_enter();
+    if (base->pending)
+        base->stats.collisions++;
+
+    handle->txData = xfer->txData;
+    handle->rxData = xfer->rxData;
+    handle->txRemainingBytes = xfer->dataSize;
+    handle->totalByteCount = xfer->dataSize;
+    handle->configFlags = xfer->configFlags;
+    handle->state = SPI_BUSY;
+    base->pending = handle;
+    base->fifointen = kSPI_TxLvlIrq | kSPI_RxLvlIrq;
+    base->ready_ns = hal_now_ns(); // the tx fifo is empty
+    hal_exit();
+    return kStatus_Success;
+}
+
+static void _complete(SPI_Type * base,
+                      spi_master_handle_t * handle) {
+    hal_enter();
+    if (handle->configFlags & kSPI_FrameAssert)
+        _end_frame(base);
+    handle->state = SPI_IDLE;
+    base->pending = NULL;
+    base->fifointen = 0;
+    hal_exit();
+    if (handle->callback)
+        handle->callback(base, handle, kStatus_Success, handle->userData);
+}
+
+void SPI_MasterTransferHandleIRQ(SPI_Type * base,
+                                 spi_master_handle_t * handle) {
+    uint64_t ns;
+    uint64_t * wait = _wait(&ns);
+
+    if ((handle->state != SPI_BUSY) || (base->pending != handle))
+        return;
+    if (wait && (hal_now_ns() < base->ready_ns))
+        return; // the previous batch is still on the bus
+    if (!handle->txRemainingBytes) {
+        _complete(base, handle); // the last batch is out
+        return;
+    }
+
+    hal_enter();
+    for (int i = 0; (i < HAL_SPI_FIFO_DEPTH) && handle->txRemainingBytes; i++) {
+        uint8_t rx = _exchange(base, handle->txData ? *handle->txData++ : s_dummyData, wait);
+
+        if (handle->rxData)
+            *handle->rxData++ = rx;
+        handle->txRemainingBytes--;
+    }
+    if (wait)
+        base->ready_ns = hal_now_ns() + ns;
+    hal_exit();
+    if (!handle->txRemainingBytes && !wait)
+        _complete(base, handle);
+}
+
+/*******************************************************************************
+ * Simulation
+ ******************************************************************************/
+void hal_spi_attach(SPI_Type * base,
+                    const struct hal_spi_device_t * device) {
+    base->device = device;
+    base->selected = false;
+    base->fifointen = 0;
+    base->pending = NULL;
+}
+
+bool hal_spi_irq_pending(SPI_Type * base) {
+    return base->pending != NULL;
+}
+
+const struct hal_spi_stats_t * hal_spi_stats(SPI_Type * base) {
+    return &base->stats;
+}
@@ -0,0 +1,188 @@
+/**
+ * @file fsl_spi.h
+ * @brief  Native stand-in of the SDK spi master driver
+ *
+ * Same types and calls as vendor/drivers/fsl_spi.h, the bytes go to the
+ * device model attached with hal_spi_attach (sim_is25lp128.c). The chip
+ * select is asserted by the first byte and released by kSPI_FrameAssert,
+ * each byte takes 8 clocks at the baud rate SPI_MasterInit settles on.
+ *
+ * A non-blocking transfer moves HAL_SPI_FIFO_DEPTH bytes per
+ * SPI_MasterTransferHandleIRQ call and calls back when it is done. Before
+ * hal_core_start the caller runs the handler (hal_spi_irq_pending) and the
+ * clock advances as the bytes go. Once the core runs, the transfer raises
+ * LSPI_HS_IRQn, a fifo's worth of bytes after the previous batch, and a
+ * blocking transfer takes interrupts while it waits for the bus.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_SPI_H_
+#define _FSL_SPI_H_
+
+#include "fsl_common.h"
+
+#define HAL_SPI_FIFO_DEPTH 8 // !< FIFOWR/FIFORD entries of a flexcomm
+
+enum {
+    kStatus_SPI_Busy = MAKE_STATUS(kStatusGroup_LPC_SPI, 0),
+    kStatus_SPI_Idle = MAKE_STATUS(kStatusGroup_LPC_SPI, 1),
+    kStatus_SPI_Error = MAKE_STATUS(kStatusGroup_LPC_SPI, 2),
+    kStatus_SPI_BaudrateNotSupport = MAKE_STATUS(kStatusGroup_LPC_SPI, 3),
+};
+
+typedef enum _spi_xfer_option {
+    kSPI_FrameDelay = (1UL << 21),  // !< SPI_FIFOWR_EOF_MASK
+    kSPI_FrameAssert = (1UL << 20), // !< SPI_FIFOWR_EOT_MASK, SSEL released after the last byte
+} spi_xfer_option_t;
+
+enum _spi_interrupt_enable {
+    kSPI_TxLvlIrq = (1UL << 2), // !< SPI_FIFOINTENSET_TXLVL_MASK
+    kSPI_RxLvlIrq = (1UL << 3), // !< SPI_FIFOINTENSET_RXLVL_MASK
+};
+
+typedef enum _spi_clock_polarity {
+    kSPI_ClockPolarityActiveHigh = 0x0U,
+    kSPI_ClockPolarityActiveLow,
+} spi_clock_polarity_t;
+
+typedef enum _spi_clock_phase {
+    kSPI_ClockPhaseFirstEdge = 0x0U,
+    kSPI_ClockPhaseSecondEdge,
+} spi_clock_phase_t;
+
+typedef enum _spi_shift_direction {
+    kSPI_MsbFirst = 0x0U,
+    kSPI_LsbFirst,
+} spi_shift_direction_t;
+
+typedef enum _spi_data_width {
+    kSPI_Data8Bits = 7,
+} spi_data_width_t;
+
+typedef enum _spi_ssel {
+    kSPI_Ssel0 = 0,
+    kSPI_Ssel1 = 1,
+    kSPI_Ssel2 = 2,
+    kSPI_Ssel3 = 3,
+} spi_ssel_t;
+
+typedef enum _spi_spol {
+    kSPI_SpolActiveAllLow = 0,
+} spi_spol_t;
+
+typedef struct _spi_delay_config {
+    uint8_t preDelay;
+    uint8_t postDelay;
+    uint8_t frameDelay;
+    uint8_t transferDelay;
+} spi_delay_config_t;
+
+typedef struct _spi_master_config {
+    bool enableLoopback;
+    bool enableMaster;
+    spi_clock_polarity_t polarity;
+    spi_clock_phase_t phase;
+    spi_shift_direction_t direction;
+    uint32_t baudRate_Bps;
+    spi_data_width_t dataWidth;
+    spi_ssel_t sselNum;
+    spi_spol_t sselPol;
+    uint8_t txWatermark;
+    uint8_t rxWatermark;
+    spi_delay_config_t delayConfig;
+} spi_master_config_t;
+
+typedef struct _spi_transfer {
+    uint8_t * txData;           // !< NULL: dummy bytes
+    uint8_t * rxData;           // !< NULL: received bytes dropped
+    uint32_t configFlags;       // !< spi_xfer_option_t
+    size_t dataSize;
+} spi_transfer_t;
+
+/**
+ * @brief  Device on the bus, one per flexcomm
+ */
+struct hal_spi_device_t {
+    void (*select)(void * ctx);                 // !< SSEL asserted
+    uint8_t (*exchange)(void * ctx, uint8_t mosi); // !< one byte, returns MISO
+    void (*deselect)(void * ctx);               // !< SSEL released
+    void * ctx;
+};
+
+/**
+ * @brief  Bus statistics since SPI_MasterInit
+ */
+struct hal_spi_stats_t {
+    uint32_t frames;            // !< chip selects
+    uint64_t bytes;
+    uint64_t busy_ns;           // !< time the bus clocked
+    uint32_t collisions;        // !< transfers started with one in flight
+};
+
+typedef struct _spi_master_handle spi_master_handle_t;
+
+typedef struct {
+    uint32_t baud;              // !< baud rate of the divider
+    bool selected;
+    uint32_t fifointen;         // !< FIFOINTENSET
+    uint64_t ready_ns;          // !< the fifo reaches its watermark
+    spi_master_handle_t * pending; // !< non-blocking transfer in flight
+    const struct hal_spi_device_t * device;
+    struct hal_spi_stats_t stats;
+} SPI_Type;
+
+typedef void (*spi_master_callback_t)(SPI_Type * base,
+                                      spi_master_handle_t * handle,
+                                      status_t status,
+                                      void * userData);
+
+struct _spi_master_handle {
+    uint8_t * volatile txData;
+    uint8_t * volatile rxData;
+    volatile size_t txRemainingBytes;
+    volatile size_t totalByteCount;
+    volatile uint32_t state;
+    uint32_t configFlags;
+    spi_master_callback_t callback;
+    void * userData;
+};
+
+extern SPI_Type hal_spi8;
+
+#define SPI8 (&hal_spi8) // !< FLEXCOMM8, the HS spi to the flash
+
+/*******************************************************************************
+ * SDK
+ ******************************************************************************/
+void SPI_MasterGetDefaultConfig(spi_master_config_t * config);
+status_t SPI_MasterInit(SPI_Type * base, const spi_master_config_t * config, uint32_t srcClock_Hz);
+void SPI_DisableInterrupts(SPI_Type * base, uint32_t irqs);
+void SPI_WriteData(SPI_Type * base, uint16_t data, uint32_t configFlags);
+status_t SPI_MasterTransferBlocking(SPI_Type * base, spi_transfer_t * xfer);
+status_t SPI_MasterTransferCreateHandle(SPI_Type * base,
+                                        spi_master_handle_t * handle,
+                                        spi_master_callback_t callback,
+                                        void * userData);
+status_t SPI_MasterTransferNonBlocking(SPI_Type * base,
+                                       spi_master_handle_t * handle,
+                                       spi_transfer_t * xfer);
+void SPI_MasterTransferHandleIRQ(SPI_Type * base, spi_master_handle_t * handle);
+
+/*******************************************************************************
+ * Simulation
+ ******************************************************************************/
+/**
+ * @brief  Attach a device model, NULL: MISO floats high
+ */
+void hal_spi_attach(SPI_Type * base, const struct hal_spi_device_t * device);
+
+/**
+ * @brief  A non-blocking transfer waits for SPI_MasterTransferHandleIRQ
+ */
+bool hal_spi_irq_pending(SPI_Type * base);
+
+const struct hal_spi_stats_t * hal_spi_stats(SPI_Type * base);
+
+#endif /* _FSL_SPI_H_ */
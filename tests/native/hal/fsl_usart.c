@@ -0,0 +1,384 @@
+/**
+ * @file fsl_usart.c
+ * @brief  Native stand-in of the SDK usart driver
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fsl_usart.h"
+#include "hal_core.h"
+
+#define HUP_BACKOFF_NS 100000000ULL // !< peer gone (pty closed, socket EOF): look again this much later
+#define TX_RING        (HAL_USART_FIFO_DEPTH + 1) // !< fifo and shift register
+
+struct hal_usart_t {
+    struct hal_source_t source;
+    int fd;
+    bool enabled;
+    bool rx_on;
+    bool tx_on;
+    uint64_t byte_ns;           // !< one character on the wire
+    uint32_t fifointen;
+    uint32_t txwm;
+    uint32_t rxwm;
+    uint32_t fifostat;          // !< TXERR, RXERR
+    uint64_t hup_until_ns;
+
+    // rx: wire -> fifo
+    uint8_t wire[HAL_USART_WIRE_SIZE];
+    uint32_t wire_rd;
+    uint32_t wire_count;
+    uint64_t rx_due_ns;         // !< wire head complete
+    uint64_t rx_last_ns;        // !< last byte complete
+    bool rx_late;               // !< wire head counted late
+    uint8_t rx[HAL_USART_FIFO_DEPTH];
+    uint32_t rx_rd;
+    uint32_t rx_count;
+
+    // tx: fifo -> wire
+    uint8_t tx[TX_RING];
+    uint64_t tx_done_ns[TX_RING];
+    uint32_t tx_rd;
+    uint32_t tx_count;
+    uint64_t tx_last_ns;
+
+    struct hal_usart_stats_t stats;
+};
+
+static struct hal_usart_t _ports[HAL_FLEXCOMM_NUM] = {
+    [0 ... HAL_FLEXCOMM_NUM - 1] = { .fd = -1 },
+};
+
+static struct hal_usart_t * _port(USART_Type * base) {
+    uint32_t index = hal_flexcomm_index(base);
+
+    return (index < HAL_FLEXCOMM_NUM) ? &_ports[index] : NULL;
+}
+
+/*******************************************************************************
+ * Simulation
+ ******************************************************************************/
+// !< tx bytes out and rx bytes in, as of now
+static void _advance(struct hal_usart_t * port,
+                     uint64_t now) {
+    while (port->tx_count && (port->tx_done_ns[port->tx_rd] <= now)) {
+        uint8_t byte = port->tx[port->tx_rd];
+
+        if ((port->fd >= 0) && (write(port->fd, &byte, 1) != 1))
+            port->stats.tx_dropped++;
+        port->stats.tx_bytes++;
+        port->tx_rd = (port->tx_rd + 1) % TX_RING;
+        port->tx_count--;
+    }
+
+    while (port->enabled && port->rx_on && port->wire_count && (now >= port->rx_due_ns)) {
+        if (port->rx_count == HAL_USART_FIFO_DEPTH) {
+            if (!port->rx_late)
+                port->stats.rx_late++;
+            port->rx_late = true;
+            break;
+        }
+        port->rx[(port->rx_rd + port->rx_count) % HAL_USART_FIFO_DEPTH] = port->wire[port->wire_rd];
+        port->rx_count++;
+        port->wire_rd = (port->wire_rd + 1) % HAL_USART_WIRE_SIZE;
+        port->wire_count--;
+        port->stats.rx_bytes++;
+        if (port->rx_count > port->stats.rx_fifo_max)
+            port->stats.rx_fifo_max = port->rx_count;
+        // a late byte held the sender back
+        port->rx_last_ns = port->rx_late ? now : port->rx_due_ns;
+        port->rx_due_ns = port->rx_last_ns + port->byte_ns;
+        port->rx_late = false;
+    }
+
+    FLEXCOMM_Type * regs = &hal_flexcomm[port - _ports];
+
+    if (regs->INTENCLR) {
+        regs->INTENSET &= ~regs->INTENCLR;
+        regs->INTENCLR = 0U;
+    }
+    if (port->tx_count)
+        regs->STAT &= ~USART_STAT_TXIDLE_MASK;
+    else
+        regs->STAT |= USART_STAT_TXIDLE_MASK;
+}
+
+static void _read_wire(struct hal_usart_t * port,
+                       uint64_t now) {
+    if ((port->fd < 0) || (now < port->hup_until_ns))
+        return;
+
+    while (port->wire_count < HAL_USART_WIRE_SIZE) {
+        uint32_t wr = (port->wire_rd + port->wire_count) % HAL_USART_WIRE_SIZE;
+        uint32_t room = (wr < port->wire_rd) ? port->wire_rd - wr : HAL_USART_WIRE_SIZE - wr;
+
+        ssize_t n = read(port->fd, &port->wire[wr], room);
+
+        if (n > 0) {
+            if (!port->wire_count) {
+                uint64_t start = (now > port->rx_last_ns) ? now : port->rx_last_ns;
+
+                port->rx_due_ns = start + port->byte_ns;
+            }
+            port->wire_count += (uint32_t)n;
+            continue;
+        }
+        if ((n == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+            port->hup_until_ns = now + HUP_BACKOFF_NS;
+        break;
+    }
+}
+
+static uint32_t _tx_level(const struct hal_usart_t * port) {
+    return port->tx_count ? port->tx_count - 1U : 0U;
+}
+
+static void _poll(void * ctx,
+                  uint64_t now) {
+    struct hal_usart_t * port = ctx;
+
+    _read_wire(port, now);
+    _advance(port, now);
+}
+
+static bool _asserted(void * ctx) {
+    struct hal_usart_t * port = ctx;
+    FLEXCOMM_Type * regs = &hal_flexcomm[port - _ports];
+
+    if (!port->enabled)
+        return false;
+    _advance(port, hal_now_ns());
+
+    return ((port->fifointen & kUSART_RxLevelInterruptEnable) && (port->rx_count > port->rxwm)) ||
+           ((port->fifointen & kUSART_TxLevelInterruptEnable) && (_tx_level(port) <= port->txwm)) ||
+           ((port->fifointen & kUSART_RxErrorInterruptEnable) && (port->fifostat & kUSART_RxError)) ||
+           ((regs->INTENSET & USART_INTENSET_TXIDLEEN_MASK) && !port->tx_count);
+}
+
+static uint64_t _next_ns(void * ctx) {
+    struct hal_usart_t * port = ctx;
+    uint64_t next = HAL_NEVER;
+
+    if (port->enabled && port->rx_on && port->wire_count && (port->rx_count < HAL_USART_FIFO_DEPTH))
+        next = port->rx_due_ns;
+    if (port->tx_count && (port->tx_done_ns[port->tx_rd] < next))
+        next = port->tx_done_ns[port->tx_rd];
+    return next;
+}
+
+static int _fd(void * ctx) {
+    struct hal_usart_t * port = ctx;
+
+    if ((port->wire_count == HAL_USART_WIRE_SIZE) || (hal_now_ns() < port->hup_until_ns))
+        return -1;
+    return port->fd;
+}
+
+void hal_usart_attach(USART_Type * base,
+                      int fd) {
+    struct hal_usart_t * port = _port(base);
+
+    if (!port)
+        return;
+    if (fd >= 0)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    port->fd = fd;
+    port->hup_until_ns = 0;
+}
+
+const struct hal_usart_stats_t * hal_usart_stats(USART_Type * base) {
+    struct hal_usart_t * port = _port(base);
+
+    return port ? &port->stats : NULL;
+}
+
+/*******************************************************************************
+ * SDK
+ ******************************************************************************/
+void USART_GetDefaultConfig(usart_config_t * config) {
+    memset(config, 0, sizeof(*config));
+    config->baudRate_Bps = 115200U;
+    config->parityMode = kUSART_ParityDisabled;
+    config->stopBitCount = kUSART_OneStopBit;
+    config->bitCountPerChar = kUSART_8BitsPerChar;
+    config->txWatermark = kUSART_TxFifo0;
+    config->rxWatermark = kUSART_RxFifo1;
+}
+
+status_t USART_Init(USART_Type * base,
+                    const usart_config_t * config,
+                    uint32_t srcClock_Hz) {
+    struct hal_usart_t * port = _port(base);
+
+    if (!port || !config || !config->baudRate_Bps || !srcClock_Hz)
+        return kStatus_InvalidArgument;
+
+    uint32_t bits = 1U + ((config->bitCountPerChar == kUSART_7BitsPerChar) ? 7U : 8U) +
+        ((config->parityMode != kUSART_ParityDisabled) ? 1U : 0U) +
+        ((config->stopBitCount == kUSART_TwoStopBit) ? 2U : 1U);
+
+    hal_enter();
+    port->source = (struct hal_source_t) {
+        .irq = FLEXCOMM0_IRQn + (int)(port - _ports),
+        .asserted = _asserted,
+        .poll = _poll,
+        .next_ns = _next_ns,
+        .fd = _fd,
+        .ctx = port,
+    };
+    hal_core_attach(&port->source);
+
+    port->byte_ns = (uint64_t)bits * 1000000000ULL / config->baudRate_Bps;
+    port->rx_on = config->enableRx;
+    port->tx_on = config->enableTx;
+    port->txwm = config->txWatermark;
+    port->rxwm = config->rxWatermark;
+    port->fifointen = 0U;
+    port->fifostat = 0U;
+    port->rx_count = 0U;
+    port->tx_count = 0U;
+    port->rx_late = false;
+    port->rx_last_ns = hal_now_ns();
+    port->tx_last_ns = port->rx_last_ns;
+    base->STAT = USART_STAT_TXIDLE_MASK;
+    base->INTENSET = 0U;
+    base->INTENCLR = 0U;
+    port->enabled = true;
+    hal_exit();
+    return kStatus_Success;
+}
+
+void USART_Deinit(USART_Type * base) {
+    struct hal_usart_t * port = _port(base);
+
+    if (!port)
+        return;
+    hal_enter();
+    port->enabled = false;
+    port->fifointen = 0U;
+    port->rx_count = 0U;
+    port->tx_count = 0U;
+    base->INTENSET = 0U;
+    hal_exit();
+}
+
+uint32_t USART_GetStatusFlags(USART_Type * base) {
+    struct hal_usart_t * port = _port(base);
+    uint32_t flags;
+
+    hal_enter();
+    _advance(port, hal_now_ns());
+    flags = port->fifostat;
+    if (!port->tx_count)
+        flags |= kUSART_TxFifoEmptyFlag;
+    if (port->tx_count <= HAL_USART_FIFO_DEPTH)
+        flags |= kUSART_TxFifoNotFullFlag;
+    if (port->rx_count)
+        flags |= kUSART_RxFifoNotEmptyFlag;
+    if (port->rx_count == HAL_USART_FIFO_DEPTH)
+        flags |= kUSART_RxFifoFullFlag;
+    hal_exit();
+    return flags;
+}
+
+void USART_ClearStatusFlags(USART_Type * base,
+                            uint32_t mask) {
+    struct hal_usart_t * port = _port(base);
+
+    port->fifostat &= ~(mask & (kUSART_TxError | kUSART_RxError));
+}
+
+void USART_EnableInterrupts(USART_Type * base,
+                            uint32_t mask) {
+    hal_enter();
+    _port(base)->fifointen |= mask & 0xFU;
+    hal_exit();
+}
+
+void USART_DisableInterrupts(USART_Type * base,
+                             uint32_t mask) {
+    _port(base)->fifointen &= ~(mask & 0xFU);
+}
+
+uint32_t USART_GetEnabledInterrupts(USART_Type * base) {
+    return _port(base)->fifointen;
+}
+
+uint32_t USART_GetRxFifoCount(USART_Type * base) {
+    struct hal_usart_t * port = _port(base);
+
+    hal_enter();
+    _advance(port, hal_now_ns());
+    uint32_t count = port->rx_count;
+    hal_exit();
+    return count;
+}
+
+uint32_t USART_GetTxFifoCount(USART_Type * base) {
+    struct hal_usart_t * port = _port(base);
+
+    hal_enter();
+    _advance(port, hal_now_ns());
+    uint32_t count = _tx_level(port);
+    hal_exit();
+    return count;
+}
+
+void USART_WriteByte(USART_Type * base,
+                     uint8_t data) {
+    struct hal_usart_t * port = _port(base);
+
+    if (!port->enabled || !port->tx_on || (port->fd < 0))
+        return;
+
+    hal_enter();
+    uint64_t now = hal_now_ns();
+
+    _advance(port, now);
+    if (port->tx_count == TX_RING) {
+        port->fifostat |= kUSART_TxError;
+    } else {
+        uint32_t wr = (port->tx_rd + port->tx_count) % TX_RING;
+        uint64_t start = (now > port->tx_last_ns) ? now : port->tx_last_ns;
+
+        port->tx[wr] = data;
+        port->tx_done_ns[wr] = start + port->byte_ns;
+        port->tx_last_ns = port->tx_done_ns[wr];
+        port->tx_count++;
+        base->STAT &= ~USART_STAT_TXIDLE_MASK;
+    }
+    hal_exit();
+}
+
+uint8_t USART_ReadByte(USART_Type * base) {
+    struct hal_usart_t * port = _port(base);
+    uint8_t data = 0U;
+
+    hal_enter();
+    _advance(port, hal_now_ns());
+    if (port->rx_count) {
+        data = port->rx[port->rx_rd];
+        port->rx_rd = (port->rx_rd + 1) % HAL_USART_FIFO_DEPTH;
+        port->rx_count--;
+    }
+    hal_exit();
+    return data;
+}
+
+status_t USART_WriteBlocking(USART_Type * base,
+                             const uint8_t * data,
+                             size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        while (!(USART_GetStatusFlags(base) & kUSART_TxFifoNotFullFlag)) {
+        }
+        USART_WriteByte(base, data[i]);
+    }
+    // last stop bit out
+    while (!(USART_GetStatusFlags(base) & kUSART_TxFifoEmptyFlag) || !(base->STAT & USART_STAT_TXIDLE_MASK)) {
+    }
+    return kStatus_Success;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file fsl_usart.h
+ * @brief  Native stand-in of the SDK fsl_usart.h
+ *
+ * Same types and calls as vendor/drivers/fsl_usart.h on a flexcomm model
+ * whose wire is a file descriptor (hal_usart_attach: a pty, a socket):
+ *  - rx: the bytes read from the descriptor enter the 16 entry fifo one
+ *    character time apart, a byte that finds the fifo full waits for room
+ *    (counted late, on the part it would overrun)
+ *  - tx: the fifo drains one character time per byte, a byte is written to
+ *    the descriptor when its stop bit is out, STAT TXIDLE once all are
+ *  - FIFOINTENSET levels (watermarks) and INTENSET TXIDLEEN raise
+ *    FLEXCOMMn_IRQn (hal_core.h)
+ * A port without a descriptor sends into the void, receives nothing.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_USART_H_
+#define _FSL_USART_H_
+
+#include "fsl_common.h"
+
+#define HAL_USART_FIFO_DEPTH 16
+#define HAL_USART_WIRE_SIZE  4096 // !< bytes read ahead from the descriptor
+
+enum {
+    kStatus_USART_TxBusy = MAKE_STATUS(kStatusGroup_LPC_USART, 0),
+    kStatus_USART_RxBusy = MAKE_STATUS(kStatusGroup_LPC_USART, 1),
+    kStatus_USART_TxIdle = MAKE_STATUS(kStatusGroup_LPC_USART, 2),
+    kStatus_USART_RxIdle = MAKE_STATUS(kStatusGroup_LPC_USART, 3),
+    kStatus_USART_TxError = MAKE_STATUS(kStatusGroup_LPC_USART, 7),
+    kStatus_USART_RxRingBufferOverrun = MAKE_STATUS(kStatusGroup_LPC_USART, 8),
+    kStatus_USART_RxError = MAKE_STATUS(kStatusGroup_LPC_USART, 9),
+    kStatus_USART_NoiseError = MAKE_STATUS(kStatusGroup_LPC_USART, 10),
+    kStatus_USART_FramingError = MAKE_STATUS(kStatusGroup_LPC_USART, 11),
+    kStatus_USART_ParityError = MAKE_STATUS(kStatusGroup_LPC_USART, 12),
+    kStatus_USART_BaudrateNotSupport = MAKE_STATUS(kStatusGroup_LPC_USART, 13),
+    kStatus_USART_Timeout = MAKE_STATUS(kStatusGroup_LPC_USART, 14),
+};
+
+typedef enum _usart_sync_mode {
+    kUSART_SyncModeDisabled = 0x0U,
+    kUSART_SyncModeSlave = 0x2U,
+    kUSART_SyncModeMaster = 0x3U,
+} usart_sync_mode_t;
+
+typedef enum _usart_parity_mode {
+    kUSART_ParityDisabled = 0x0U,
+    kUSART_ParityEven = 0x2U,
+    kUSART_ParityOdd = 0x3U,
+} usart_parity_mode_t;
+
+typedef enum _usart_stop_bit_count {
+    kUSART_OneStopBit = 0U,
+    kUSART_TwoStopBit = 1U,
+} usart_stop_bit_count_t;
+
+typedef enum _usart_data_len {
+    kUSART_7BitsPerChar = 0U,
+    kUSART_8BitsPerChar = 1U,
+} usart_data_len_t;
+
+typedef enum _usart_clock_polarity {
+    kUSART_RxSampleOnFallingEdge = 0x0U,
+    kUSART_RxSampleOnRisingEdge = 0x1U,
+} usart_clock_polarity_t;
+
+typedef enum _usart_txfifo_watermark {
+    kUSART_TxFifo0 = 0,
+    kUSART_TxFifo1 = 1,
+    kUSART_TxFifo2 = 2,
+    kUSART_TxFifo3 = 3,
+    kUSART_TxFifo4 = 4,
+    kUSART_TxFifo5 = 5,
+    kUSART_TxFifo6 = 6,
+    kUSART_TxFifo7 = 7,
+} usart_txfifo_watermark_t;
+
+typedef enum _usart_rxfifo_watermark {
+    kUSART_RxFifo1 = 0,
+    kUSART_RxFifo2 = 1,
+    kUSART_RxFifo3 = 2,
+    kUSART_RxFifo4 = 3,
+    kUSART_RxFifo5 = 4,
+    kUSART_RxFifo6 = 5,
+    kUSART_RxFifo7 = 6,
+    kUSART_RxFifo8 = 7,
+} usart_rxfifo_watermark_t;
+
+enum _usart_interrupt_enable {
+    kUSART_TxErrorInterruptEnable = 0x1U,
+    kUSART_RxErrorInterruptEnable = 0x2U,
+    kUSART_TxLevelInterruptEnable = 0x4U,
+    kUSART_RxLevelInterruptEnable = 0x8U,
+};
+
+enum _usart_flags {
+    kUSART_TxError = 0x1U,
+    kUSART_RxError = 0x2U,
+    kUSART_TxFifoEmptyFlag = 0x10U,
+    kUSART_TxFifoNotFullFlag = 0x20U,
+    kUSART_RxFifoNotEmptyFlag = 0x40U,
+    kUSART_RxFifoFullFlag = 0x80U,
+};
+
+typedef struct _usart_config {
+    uint32_t baudRate_Bps;
+    usart_parity_mode_t parityMode;
+    usart_stop_bit_count_t stopBitCount;
+    usart_data_len_t bitCountPerChar;
+    bool loopback;
+    bool enableRx;
+    bool enableTx;
+    bool enableContinuousSCLK;
+    bool enableMode32k;
+    bool enableHardwareFlowControl;
+    usart_txfifo_watermark_t txWatermark;
+    usart_rxfifo_watermark_t rxWatermark;
+    usart_sync_mode_t syncMode;
+    usart_clock_polarity_t clockPolarity;
+} usart_config_t;
+
+status_t USART_Init(USART_Type * base, const usart_config_t * config, uint32_t srcClock_Hz);
+void USART_Deinit(USART_Type * base);
+void USART_GetDefaultConfig(usart_config_t * config);
+
+uint32_t USART_GetStatusFlags(USART_Type * base);
+void USART_ClearStatusFlags(USART_Type * base, uint32_t mask);
+void USART_EnableInterrupts(USART_Type * base, uint32_t mask);
+void USART_DisableInterrupts(USART_Type * base, uint32_t mask);
+uint32_t USART_GetEnabledInterrupts(USART_Type * base);
+uint32_t USART_GetRxFifoCount(USART_Type * base);
+uint32_t USART_GetTxFifoCount(USART_Type * base);
+
+void USART_WriteByte(USART_Type * base, uint8_t data);
+uint8_t USART_ReadByte(USART_Type * base);
+status_t USART_WriteBlocking(USART_Type * base, const uint8_t * data, size_t length);
+
+/*******************************************************************************
+ * Simulation
+ ******************************************************************************/
+struct hal_usart_stats_t {
+    uint64_t rx_bytes;      // !< into the rx fifo
+    uint64_t tx_bytes;      // !< out of the tx shift register
+    uint32_t rx_late;       // !< bytes that found the rx fifo full
+    uint32_t tx_dropped;    // !< the descriptor did not take them
+    uint32_t rx_fifo_max;   // !< deepest rx fifo seen
+};
+
+/**
+ * @brief  Wire the port to a file descriptor (made non-blocking), -1: none
+ */
+void hal_usart_attach(USART_Type * base, int fd);
+
+const struct hal_usart_stats_t * hal_usart_stats(USART_Type * base);
+
+#endif /* _FSL_USART_H_ */
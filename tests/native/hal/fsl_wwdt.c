@@ -0,0 +1,128 @@
+/**
+ * @file fsl_wwdt.c
+ * @brief  Native stand-in of the SDK wwdt driver
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include "fsl_wwdt.h"
+#include "hal_core.h"
+
+WWDT_Type hal_wwdt;
+
+static struct {
+    uint64_t tick_ns;   // !< one count
+    uint64_t fed_ns;    // !< last refresh
+    bool warned;
+    bool expired;
+} _wdt;
+
+/*******************************************************************************
+ * Simulation
+ ******************************************************************************/
+static bool _running(void) {
+    return (hal_wwdt.MOD & WWDT_MOD_WDEN_MASK) && _wdt.tick_ns;
+}
+
+static uint64_t _warning_ns(void) {
+    uint32_t tc = hal_wwdt.TC;
+    uint32_t warn = hal_wwdt.WARNINT;
+
+    return _wdt.fed_ns + (uint64_t)((tc > warn) ? tc - warn : 0U) * _wdt.tick_ns;
+}
+
+static uint64_t _timeout_ns(void) {
+    return _wdt.fed_ns + (uint64_t)hal_wwdt.TC * _wdt.tick_ns;
+}
+
+static void _poll(void * ctx,
+                  uint64_t now) {
+    (void)ctx;
+    if (!_running() || !hal_core_started())
+        return;
+
+    if (!_wdt.warned && hal_wwdt.WARNINT && (now >= _warning_ns())) {
+        _wdt.warned = true;
+        hal_wwdt.MOD |= WWDT_MOD_WDINT_MASK;
+    }
+    if (!_wdt.expired && (now >= _timeout_ns())) {
+        _wdt.expired = true;
+        hal_wwdt.MOD |= WWDT_MOD_WDTOF_MASK;
+        if (hal_wwdt.MOD & WWDT_MOD_WDRESET_MASK)
+            NVIC_SystemReset();
+    }
+}
+
+static bool _asserted(void * ctx) {
+    (void)ctx;
+    return (hal_wwdt.MOD & WWDT_MOD_WDINT_MASK) != 0U;
+}
+
+static uint64_t _next_ns(void * ctx) {
+    (void)ctx;
+    if (!_running())
+        return HAL_NEVER;
+    if (!_wdt.warned && hal_wwdt.WARNINT)
+        return _warning_ns();
+    return _wdt.expired ? HAL_NEVER : _timeout_ns();
+}
+
+static const struct hal_source_t _source = {
+    .irq = WDT_BOD_IRQn,
+    .asserted = _asserted,
+    .poll = _poll,
+    .next_ns = _next_ns,
+};
+
+/*******************************************************************************
+ * SDK
+ ******************************************************************************/
+void WWDT_GetDefaultConfig(wwdt_config_t * config) {
+    memset(config, 0, sizeof(*config));
+    config->enableWwdt = true;
+    config->windowValue = 0xFFFFFFU;
+    config->timeoutValue = 0xFFFFFFU;
+}
+
+void WWDT_Init(WWDT_Type * base,
+               const wwdt_config_t * config) {
+    hal_enter();
+    hal_core_attach(&_source);
+    _wdt.tick_ns = config->clockFreq_Hz ? (4000000000ULL / config->clockFreq_Hz) : 0U;
+    base->TC = config->timeoutValue & 0xFFFFFFU;
+    base->WARNINT = config->warningValue & 0x3FFU;
+    base->WINDOW = config->windowValue & 0xFFFFFFU;
+    base->MOD = (base->MOD & (WWDT_MOD_WDTOF_MASK | WWDT_MOD_WDINT_MASK)) |
+        (config->enableWwdt ? WWDT_MOD_WDEN_MASK : 0U) |
+        (config->enableWatchdogReset ? WWDT_MOD_WDRESET_MASK : 0U);
+    _wdt.fed_ns = hal_now_ns();
+    _wdt.warned = false;
+    _wdt.expired = false;
+    hal_exit();
+}
+
+void WWDT_Deinit(WWDT_Type * base) {
+    base->MOD = 0U;
+}
+
+void WWDT_Refresh(WWDT_Type * base) {
+    (void)base;
+    hal_enter();
+    _wdt.fed_ns = hal_now_ns();
+    _wdt.warned = false;
+    _wdt.expired = false;
+    hal_exit();
+}
+
+uint32_t WWDT_GetStatusFlags(WWDT_Type * base) {
+    hal_enter();
+    _poll(NULL, hal_now_ns());
+    uint32_t flags = base->MOD & (WWDT_MOD_WDTOF_MASK | WWDT_MOD_WDINT_MASK);
+    hal_exit();
+    return flags;
+}
+
+void WWDT_ClearStatusFlags(WWDT_Type * base,
+                           uint32_t mask) {
+    base->MOD &= ~(mask & (WWDT_MOD_WDTOF_MASK | WWDT_MOD_WDINT_MASK));
+}
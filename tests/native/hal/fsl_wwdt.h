@@ -0,0 +1,42 @@
+/**
+ * @file fsl_wwdt.h
+ * @brief  Native stand-in of the SDK fsl_wwdt.h
+ *
+ * The counter runs at clockFreq_Hz / 4 from the last WWDT_Refresh: WDINT
+ * and WDT_BOD_IRQn once it falls to warningValue, WDTOF at 0, with
+ * enableWatchdogReset the part resets (NVIC_SystemReset). It only counts
+ * once the core runs (hal_core_start).
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _FSL_WWDT_H_
+#define _FSL_WWDT_H_
+
+#include "fsl_common.h"
+
+typedef struct _wwdt_config {
+    bool enableWwdt;
+    bool enableWatchdogReset;
+    bool enableWatchdogProtect;
+    bool enableLockOscillator;
+    uint32_t windowValue;
+    uint32_t timeoutValue;
+    uint32_t warningValue;
+    uint32_t clockFreq_Hz;
+} wwdt_config_t;
+
+enum _wwdt_status_flags_t {
+    kWWDT_TimeoutFlag = WWDT_MOD_WDTOF_MASK,
+    kWWDT_WarningFlag = WWDT_MOD_WDINT_MASK,
+};
+
+void WWDT_GetDefaultConfig(wwdt_config_t * config);
+void WWDT_Init(WWDT_Type * base, const wwdt_config_t * config);
+void WWDT_Deinit(WWDT_Type * base);
+void WWDT_Refresh(WWDT_Type * base);
+uint32_t WWDT_GetStatusFlags(WWDT_Type * base);
+void WWDT_ClearStatusFlags(WWDT_Type * base, uint32_t mask);
+
+#endif /* _FSL_WWDT_H_ */
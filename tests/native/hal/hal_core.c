@@ -0,0 +1,442 @@
+/**
+ * @file hal_core.c
+ * @brief  Native cortex-m33 core: clock, NVIC, SysTick, PRIMASK, WFI and
+ *         the interrupt sources of the peripheral models
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#define _GNU_SOURCE // ppoll
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "fsl_common.h"
+#include "fsl_gpio.h"
+#include "hal_core.h"
+
+#define HAL_SOURCES   16
+#define HAL_WAIT_NS   10000000ULL // !< longest sleep without looking around
+#define HAL_SPIN_NS   100000ULL   // !< shorter waits spin
+
+SCB_Type hal_scb;
+SysTick_Type hal_systick;
+CoreDebug_Type hal_core_debug;
+FLEXCOMM_Type hal_flexcomm[HAL_FLEXCOMM_NUM];
+IOCON_Type hal_iocon;
+SYSCON_Type hal_syscon;
+RTC_Type hal_rtc;
+
+static DWT_Type _dwt;
+
+// time
+static bool _realtime = false;
+static uint64_t _now_ns = 0;            // !< simulated time, realtime: latest reading
+static uint64_t _t0_ns = 0;             // !< monotonic clock at time 0
+
+// core
+static volatile sig_atomic_t _started = 0;
+static volatile sig_atomic_t _depth = 0;   // !< SDK calls and handlers in progress
+static volatile sig_atomic_t _primask = 0;
+static volatile uint64_t _last_exit_ns = 0;
+static volatile uint64_t _enabled = 0;     // !< NVIC ISER
+static volatile uint64_t _pending = 0;     // !< NVIC ISPR
+static uint64_t _systick_next_ns = 0;
+static uint64_t _last_poll_ns = 0;
+
+static const struct hal_source_t * _sources[HAL_SOURCES];
+static volatile sig_atomic_t _nsources = 0;
+
+/*******************************************************************************
+ * Vectors, the firmware's handlers when it has them
+ ******************************************************************************/
+extern void SysTick_Handler(void) __attribute__((weak));
+extern void WDT_BOD_IRQHandler(void) __attribute__((weak));
+extern void FLEXCOMM0_IRQHandler(void) __attribute__((weak));
+extern void FLEXCOMM1_IRQHandler(void) __attribute__((weak));
+extern void FLEXCOMM2_IRQHandler(void) __attribute__((weak));
+extern void FLEXCOMM3_IRQHandler(void) __attribute__((weak));
+extern void FLEXCOMM4_IRQHandler(void) __attribute__((weak));
+extern void FLEXCOMM5_IRQHandler(void) __attribute__((weak));
+extern void FLEXCOMM6_IRQHandler(void) __attribute__((weak));
+extern void FLEXCOMM7_IRQHandler(void) __attribute__((weak));
+extern void FLEXCOMM8_IRQHandler(void) __attribute__((weak));
+
+static void (*const _vectors[HAL_IRQ_NUM])(void) = {
+    [WDT_BOD_IRQn]   = WDT_BOD_IRQHandler,
+    [FLEXCOMM0_IRQn] = FLEXCOMM0_IRQHandler,
+    [FLEXCOMM1_IRQn] = FLEXCOMM1_IRQHandler,
+    [FLEXCOMM2_IRQn] = FLEXCOMM2_IRQHandler,
+    [FLEXCOMM3_IRQn] = FLEXCOMM3_IRQHandler,
+    [FLEXCOMM4_IRQn] = FLEXCOMM4_IRQHandler,
+    [FLEXCOMM5_IRQn] = FLEXCOMM5_IRQHandler,
+    [FLEXCOMM6_IRQn] = FLEXCOMM6_IRQHandler,
+    [FLEXCOMM7_IRQn] = FLEXCOMM7_IRQHandler,
+    [LSPI_HS_IRQn]   = FLEXCOMM8_IRQHandler,
+};
+
+/*******************************************************************************
+ * Time
+ ******************************************************************************/
+static uint64_t _wall_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void hal_sim_reset(void) {
+    _now_ns = 0;
+    _t0_ns = _wall_ns();
+    _dwt.CYCCNT = 0;
+    _enabled = 0;
+    _pending = 0;
+    hal_gpio_reset();
+}
+
+uint64_t hal_now_ns(void) {
+    if (_realtime) {
+        uint64_t wall = _wall_ns() - _t0_ns;
+
+        if (wall > _now_ns)
+            _now_ns = wall;
+    }
+    return _now_ns;
+}
+
+void hal_advance_ns(uint64_t ns) {
+    if (!_realtime) {
+        _now_ns += ns;
+        return;
+    }
+
+    uint64_t until = hal_now_ns() + ns;
+    uint64_t now;
+
+    while ((now = hal_now_ns()) < until) {
+        if (until - now > HAL_SPIN_NS) {
+            struct timespec ts = { 0, (long)(until - now - HAL_SPIN_NS / 2) };
+
+            nanosleep(&ts, NULL);
+        }
+    }
+}
+
+void hal_realtime(bool on) {
+    uint64_t now = hal_now_ns();
+
+    _realtime = on;
+    _t0_ns = _wall_ns() - now;
+}
+
+DWT_Type * hal_dwt_sync(void) {
+    // free running 32bit counter, like the core's
+    _dwt.CYCCNT = (uint32_t)((hal_now_ns() * (SystemCoreClock / 1000000U)) / 1000U);
+    return &_dwt;
+}
+
+/*******************************************************************************
+ * Interrupts
+ ******************************************************************************/
+static uint64_t _systick_period_ns(void) {
+    uint64_t clk = SystemCoreClock ? SystemCoreClock : 1U;
+
+    return ((uint64_t)(SysTick->LOAD & SysTick_LOAD_RELOAD_Msk) + 1U) * 1000000000ULL / clk;
+}
+
+static bool _systick_on(void) {
+    const uint32_t on = SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk;
+
+    return (SysTick->CTRL & on) == on;
+}
+
+static bool _systick_due(uint64_t now) {
+    return _systick_on() && (now >= _systick_next_ns);
+}
+
+static uint64_t _asserted(void) {
+    uint64_t lines = 0;
+
+    for (int i = 0; i < _nsources; i++) {
+        const struct hal_source_t * s = _sources[i];
+
+        if ((s->irq >= 0) && (s->irq < HAL_IRQ_NUM) && s->asserted && s->asserted(s->ctx))
+            lines |= 1ULL << s->irq;
+    }
+    return lines;
+}
+
+static void _poll(uint64_t now,
+                  bool force) {
+    if (!force && (now - _last_poll_ns < HAL_POLL_NS))
+        return;
+    _last_poll_ns = now;
+    for (int i = 0; i < _nsources; i++) {
+        if (_sources[i]->poll)
+            _sources[i]->poll(_sources[i]->ctx, now);
+    }
+}
+
+static uint64_t _next_event_ns(void) {
+    uint64_t next = _systick_on() ? _systick_next_ns : HAL_NEVER;
+
+    for (int i = 0; i < _nsources; i++) {
+        const struct hal_source_t * s = _sources[i];
+        uint64_t at = s->next_ns ? s->next_ns(s->ctx) : HAL_NEVER;
+
+        if (at < next)
+            next = at;
+    }
+    return next;
+}
+
+// an interrupt would be taken with PRIMASK clear: what ends WFI
+static bool _wakeup(uint64_t now) {
+    return _systick_due(now) || (_enabled & (_pending | _asserted()));
+}
+
+static void _take(void) {
+    if (!_started || _primask || _depth)
+        return;
+
+    _depth++;
+    uint64_t now = hal_now_ns();
+
+    _poll(now, false);
+    for (int n = 0; n < HAL_IRQ_BURST; n++) {
+        if (_systick_due(now)) {
+            uint64_t period = _systick_period_ns();
+
+            // ticks missed while masked are one tick, as on the core
+            _systick_next_ns = (now - _systick_next_ns < period) ? _systick_next_ns + period : now + period;
+            if (SysTick_Handler)
+                SysTick_Handler();
+            continue;
+        }
+
+        uint64_t lines = _enabled & (_pending | _asserted());
+
+        if (!lines)
+            break;
+
+        int irq = __builtin_ctzll(lines);
+
+        _pending &= ~(1ULL << irq);
+        if (_vectors[irq]) {
+            _vectors[irq]();
+        } else {
+            fprintf(stderr, "hal: no handler for irq %d, disabled\n", irq);
+            _enabled &= ~(1ULL << irq);
+        }
+        now = hal_now_ns();
+    }
+    _depth--;
+}
+
+static void _alarm(int sig) {
+    int saved = errno;
+
+    (void)sig;
+    if (!_depth && !_primask && (hal_now_ns() - _last_exit_ns >= HAL_STALL_NS))
+        _take();
+    errno = saved;
+}
+
+void hal_core_attach(const struct hal_source_t * source) {
+    for (int i = 0; i < _nsources; i++) {
+        if (_sources[i] == source)
+            return;
+    }
+    if (_nsources >= HAL_SOURCES) {
+        fprintf(stderr, "hal: too many interrupt sources\n");
+        abort();
+    }
+    _sources[_nsources] = source;
+    _nsources++;
+}
+
+bool hal_core_started(void) {
+    return _started;
+}
+
+void hal_core_start(void) {
+    struct sigaction sa;
+    struct itimerval it = {
+        .it_interval = { 0, HAL_ALARM_US },
+        .it_value    = { 0, HAL_ALARM_US },
+    };
+
+    if (!_realtime)
+        hal_realtime(true);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = _alarm;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGALRM, &sa, NULL);
+    _last_exit_ns = hal_now_ns();
+    _started = 1;
+    setitimer(ITIMER_REAL, &it, NULL);
+}
+
+void hal_enter(void) {
+    _depth++;
+}
+
+void hal_exit(void) {
+    if (--_depth)
+        return;
+    if (_started) {
+        _last_exit_ns = hal_now_ns();
+        _take();
+    }
+}
+
+void hal_sleep_until(uint64_t ns) {
+    struct pollfd fds[HAL_SOURCES];
+    nfds_t nfds = 0;
+    uint64_t now = hal_now_ns();
+
+    if (!_realtime) {
+        if (ns > _now_ns)
+            _now_ns = ns;
+        return;
+    }
+    if (ns <= now)
+        return;
+
+    for (int i = 0; i < _nsources; i++) {
+        const struct hal_source_t * s = _sources[i];
+        int fd = s->fd ? s->fd(s->ctx) : -1;
+
+        if (fd >= 0) {
+            fds[nfds].fd = fd;
+            fds[nfds].events = POLLIN;
+            fds[nfds].revents = 0;
+            nfds++;
+        }
+    }
+
+    uint64_t wait = ns - now;
+
+    if (wait > HAL_WAIT_NS)
+        wait = HAL_WAIT_NS;
+
+    struct timespec ts = { (time_t)(wait / 1000000000ULL), (long)(wait % 1000000000ULL) };
+
+    ppoll(fds, nfds, &ts, NULL); // EINTR: SIGALRM, look again
+}
+
+void hal_delay_ns(uint64_t ns) {
+    if (!_started) {
+        hal_advance_ns(ns);
+        return;
+    }
+
+    uint64_t until = hal_now_ns() + ns;
+
+    for (;;) {
+        _take();
+
+        uint64_t now = hal_now_ns();
+
+        if (now >= until)
+            break;
+        hal_enter();
+        _poll(now, true);
+        if (_primask || _depth > 1 || !_wakeup(now)) {
+            uint64_t next = _next_event_ns();
+
+            hal_sleep_until(next < until ? next : until);
+        }
+        _depth--;
+    }
+}
+
+/*******************************************************************************
+ * CMSIS
+ ******************************************************************************/
+uint32_t SysTick_Config(uint32_t ticks) {
+    if ((ticks - 1U) > SysTick_LOAD_RELOAD_Msk)
+        return 1U;
+
+    SysTick->LOAD = ticks - 1U;
+    SysTick->VAL = 0U;
+    _systick_next_ns = hal_now_ns() + _systick_period_ns();
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+    return 0U;
+}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn) {
+    if ((int)IRQn >= 0) {
+        _enabled |= 1ULL << IRQn;
+        hal_enter();
+        hal_exit();
+    }
+}
+
+void NVIC_DisableIRQ(IRQn_Type IRQn) {
+    if ((int)IRQn >= 0)
+        _enabled &= ~(1ULL << IRQn);
+}
+
+uint32_t NVIC_GetEnableIRQ(IRQn_Type IRQn) {
+    return ((int)IRQn >= 0) ? (uint32_t)((_enabled >> IRQn) & 1U) : 0U;
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn) {
+    if ((int)IRQn >= 0) {
+        _pending |= 1ULL << IRQn;
+        hal_enter();
+        hal_exit();
+    }
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn) {
+    if ((int)IRQn >= 0)
+        _pending &= ~(1ULL << IRQn);
+}
+
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn) {
+    return ((int)IRQn >= 0) ? (uint32_t)((_pending >> IRQn) & 1U) : 0U;
+}
+
+void NVIC_SystemReset(void) {
+    fprintf(stderr, "hal: NVIC_SystemReset\n");
+    exit(EXIT_SUCCESS);
+}
+
+void __disable_irq(void) {
+    _primask = 1;
+}
+
+void __enable_irq(void) {
+    _primask = 0;
+    _take();
+}
+
+uint32_t __get_PRIMASK(void) {
+    return (uint32_t)_primask;
+}
+
+void __WFI(void) {
+    if (!_started)
+        return;
+
+    hal_enter();
+    for (;;) {
+        uint64_t now = hal_now_ns();
+
+        _poll(now, true);
+        if (_wakeup(now))
+            break;
+        hal_sleep_until(_next_event_ns());
+    }
+    hal_exit();
+}
@@ -0,0 +1,82 @@
+/**
+ * @file hal_core.h
+ * @brief  Native cortex-m33 core: interrupt sources and when they are taken
+ *
+ * For the peripheral models of this directory, the firmware sees the
+ * result through the NVIC calls and its IRQ handlers.
+ *
+ * A model registers a source: an interrupt line with its level, the work to
+ * do as time passes (move bytes from a file descriptor, finish a transfer)
+ * and when it changes by itself. Once hal_core_start ran, interrupts are
+ * taken
+ *  - when a native SDK call returns to thread mode (hal_exit), each model
+ *    call is wrapped in hal_enter/hal_exit like a register access
+ *  - at __enable_irq and in __WFI, SDK_DelayAtLeastUs
+ *  - from SIGALRM, when thread mode made no SDK call for HAL_STALL_NS
+ *    (spinning on a flag an interrupt sets)
+ * never while PRIMASK is set or inside another handler. SysTick first, then
+ * the lowest enabled line that is pending or asserted, as the NVIC does with
+ * equal priorities.
+ *
+ * An interrupt preempting thread mode by SIGALRM may interleave its log
+ * lines with the one thread mode was printing.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _HAL_CORE_H_
+#define _HAL_CORE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "LPC55S69_cm33_core0.h"
+
+#define HAL_POLL_NS   20000ULL   // !< sources polled at most this often
+#define HAL_STALL_NS  500000ULL  // !< thread mode without an SDK call this long is preempted
+#define HAL_ALARM_US  250        // !< SIGALRM period
+#define HAL_IRQ_BURST 64         // !< handlers per take, a level that stays asserted does not lock up
+#define HAL_NEVER     UINT64_MAX
+
+/**
+ * @brief  Interrupt source of a peripheral model
+ */
+struct hal_source_t {
+    int irq;                                 // !< IRQn_Type, -1: none (polled only)
+    bool (*asserted)(void * ctx);            // !< level of the request, NULL: never
+    void (*poll)(void * ctx, uint64_t now);  // !< move data as time passed
+    uint64_t (*next_ns)(void * ctx);         // !< next change by itself, NULL or HAL_NEVER: never
+    int (*fd)(void * ctx);                   // !< descriptor waited on for input, NULL or -1: none
+    void * ctx;
+};
+
+/**
+ * @brief  Register a source, again: no effect
+ */
+void hal_core_attach(const struct hal_source_t * source);
+
+/**
+ * @brief  The core runs (hal_core_start)
+ */
+bool hal_core_started(void);
+
+/**
+ * @brief  Around the native SDK calls: interrupts wait for hal_exit
+ */
+void hal_enter(void);
+void hal_exit(void);
+
+/**
+ * @brief  Wait until the wall clock reaches ns or a source descriptor has
+ *         input (realtime)
+ */
+void hal_sleep_until(uint64_t ns);
+
+/**
+ * @brief  SDK_DelayAtLeastUs: interrupts are taken while waiting (realtime,
+ *         started), else the clock advances
+ */
+void hal_delay_ns(uint64_t ns);
+
+#endif /* _HAL_CORE_H_ */
@@ -0,0 +1,67 @@
+/**
+ * @file hal_sim.h
+ * @brief  Native HAL stand-in: simulated clock, board pins and the core
+ *
+ * The native fsl_* headers of this directory replace the SDK drivers for
+ * the native builds (put it in front of vendor/drivers and boards/).
+ *
+ * Two clocks:
+ *  - simulated (the unit tests, the default): time only moves when the
+ *    simulated hardware says so: a byte on the spi bus, SDK_DelayAtLeastUs,
+ *    or the test calling hal_advance_ns. Nothing runs by itself.
+ *  - realtime (the native application, hal_realtime): time is the
+ *    monotonic clock since hal_sim_reset, a byte on a bus takes its wall
+ *    time.
+ * DWT->CYCCNT follows either at SystemCoreClock.
+ *
+ * hal_core_start turns the core on: interrupts are taken (hal_core.h),
+ * SysTick and the watchdog count, __WFI sleeps until an interrupt.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _HAL_SIM_H_
+#define _HAL_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief  Clock back to 0, pins to their reset state (mux to the Gowin,
+ *         Gowin READY)
+ */
+void hal_sim_reset(void);
+
+/**
+ * @brief  Time since hal_sim_reset
+ */
+uint64_t hal_now_ns(void);
+
+/**
+ * @brief  Let time pass, DWT->CYCCNT follows. Realtime: wait for it
+ */
+void hal_advance_ns(uint64_t ns);
+
+/**
+ * @brief  Run on the wall clock from now on
+ */
+void hal_realtime(bool on);
+
+/**
+ * @brief  Start taking interrupts, from here on the firmware runs as on the
+ *         part (realtime only)
+ */
+void hal_core_start(void);
+
+/**
+ * @brief  BOARD_SetSPIMux state: 1 the GP drives the spi flash
+ */
+uint8_t hal_spi_mux(void);
+
+/**
+ * @brief  BOARD_Ready_Gowin level
+ */
+void hal_set_gowin_ready(bool ready);
+
+#endif /* _HAL_SIM_H_ */
@@ -0,0 +1,291 @@
+/**
+ * @file sim_gowin.c
+ * @brief  Simulated Gowin FPGA on the other end of the Gowin uart
+ * @version v0.1
+ * @date 2022-10-19
+ */
+
+#include <string.h>
+
+#include "sim_gowin.h"
+
+/*******************************************************************************
+ * Definitions, from the FPGA design (not gowin_protocol.h: the firmware is
+ * under test)
+ ******************************************************************************/
+#define START        0x24       // !< '$'
+#define STOP         0x23       // !< '#'
+#define ACK          0x06
+#define NACK         0x15
+#define WAKE_UP      0x25       // !< '%'
+
+#define WRITE_EDID   0x77       // !< w
+#define READ_EDID    0x72       // !< r
+#define WRITE_DPCD   0x64       // !< d
+#define READ_DPCD    0x65       // !< e
+#define READ_ETH     0x61       // !< a
+#define READ_BL      0x62       // !< b
+#define FPGA_ON      0x66       // !< f
+#define FPGA_OFF     0x46       // !< F
+#define STANDBY_ON   0x73       // !< s
+#define STANDBY_OFF  0x53       // !< S
+#define VOLTAGE_LO   0x56       // !< V
+#define VOLTAGE_HI   0x76       // !< v
+#define BL_OFF       0x4c       // !< L
+#define BL_ON        0x6c       // !< l
+#define PWR_OFF      0x50       // !< P
+#define PWR_ON       0x70       // !< p
+#define WP_OFF       0x48       // !< H
+#define WP_ON        0x68       // !< h
+
+#define TX_RING_SIZE 1024       // !< a table reply, a garbage byte and WAKE_UPs
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static struct sim_gowin_config_t _config;
+static struct sim_gowin_state_t _state;
+static struct sim_gowin_stats_t _stats;
+static uint32_t _rand;
+
+// !< the request being received
+static enum { RX_IDLE, RX_CMD, RX_STOP, RX_TABLE } _rx;
+static uint8_t _cmd;
+static uint8_t _table[SIM_GOWIN_TABLE_SIZE];
+static size_t _table_count;
+
+// !< the reply bytes, back to back from _tx_next_ns on
+static uint8_t _tx[TX_RING_SIZE];
+static size_t _tx_rd;
+static size_t _tx_count;
+static uint64_t _tx_next_ns = SIM_GOWIN_NEVER;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+// xorshift32, the same faults for the same seed
+static uint32_t _random(void) {
+    _rand ^= _rand << 13;
+    _rand ^= _rand >> 17;
+    _rand ^= _rand << 5;
+    return _rand;
+}
+
+static bool _chance(uint16_t permille) {
+    return permille && ((_random() % 1000U) < permille);
+}
+
+uint64_t sim_gowin_byte_ns(void) {
+    return 10ULL * 1000000000ULL / _config.baud;
+}
+
+// queue reply bytes, the first one is in delay (+ jitter) after now
+static void _send(const uint8_t * data,
+                  size_t size,
+                  uint64_t now) {
+    if (!_tx_count) {
+        uint64_t delay = _config.delay_ns;
+
+        if (_config.jitter_ns)
+            delay += _random() % (_config.jitter_ns + 1);
+        _tx_next_ns = now + delay + sim_gowin_byte_ns();
+    }
+    for (size_t i = 0; (i < size) && (_tx_count < TX_RING_SIZE); i++) {
+        _tx[(_tx_rd + _tx_count) % TX_RING_SIZE] = data[i];
+        _tx_count++;
+    }
+}
+
+static void _send_byte(uint8_t c,
+                       uint64_t now) {
+    _send(&c, 1, now);
+}
+
+static void _send_table(const uint8_t * table,
+                        uint64_t now) {
+    _send_byte(START, now);
+    _send(table, SIM_GOWIN_TABLE_SIZE, now);
+}
+
+// the FPGA's outputs, false: not a command of the design
+static bool _execute(uint8_t cmd) {
+    switch (cmd) {
+        case FPGA_ON:
+        case FPGA_OFF:
+            _state.fpga_on = (cmd == FPGA_ON);
+            break;
+        case STANDBY_ON:
+        case STANDBY_OFF:
+            _state.standby = (cmd == STANDBY_ON);
+            break;
+        case VOLTAGE_LO:
+        case VOLTAGE_HI:
+            _state.panel_voltage_hi = (cmd == VOLTAGE_HI);
+            break;
+        case PWR_ON:
+        case PWR_OFF:
+            _state.panel_power = (cmd == PWR_ON);
+            break;
+        case BL_ON:
+        case BL_OFF:
+            _state.backlight = (cmd == BL_ON);
+            break;
+        case WP_ON:
+        case WP_OFF:
+            _state.write_protect = (cmd == WP_ON);
+            break;
+        case WRITE_EDID:
+            memcpy(_state.edid, _table, sizeof(_state.edid));
+            break;
+        case WRITE_DPCD:
+            memcpy(_state.dpcd, _table, sizeof(_state.dpcd));
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+// a complete request: faults, then the reply
+static void _request(uint64_t now) {
+    _stats.requests++;
+    _stats.per_cmd[_cmd & 0x7F]++;
+
+    if (_chance(_config.silent_permille)) {
+        _stats.silent++;
+        return;
+    }
+    if (_chance(_config.garbage_permille)) {
+        _send_byte((uint8_t)_random(), now);
+        _stats.garbage++;
+    }
+    if (_chance(_config.nack_permille)) {
+        _send_byte(NACK, now);
+        _stats.nacks++;
+        _stats.injected_nacks++;
+        return;
+    }
+
+    switch (_cmd) {
+        case READ_EDID:
+            _send_table(_state.edid, now);
+            break;
+        case READ_DPCD:
+            _send_table(_state.dpcd, now);
+            break;
+        case READ_ETH: {
+            const uint8_t reply[] = { START, _state.eth_status };
+
+            _send(reply, sizeof(reply), now);
+            break;
+        }
+        case READ_BL: {
+            const uint8_t reply[] = { START, (uint8_t)_state.bl_current, (uint8_t)(_state.bl_current >> 8) };
+
+            _send(reply, sizeof(reply), now);
+            break;
+        }
+        default:
+            if (_execute(_cmd)) {
+                _send_byte(ACK, now);
+                _stats.acks++;
+            } else {
+                _send_byte(NACK, now);
+                _stats.nacks++;
+            }
+            break;
+    }
+}
+
+void sim_gowin_init(const struct sim_gowin_config_t * config) {
+    memset(&_config, 0, sizeof(_config));
+    if (config)
+        _config = *config;
+    if (!_config.baud)
+        _config.baud = SIM_GOWIN_BAUD;
+    _rand = _config.seed ? _config.seed : 1U;
+
+    memset(&_state, 0, sizeof(_state));
+    memset(&_stats, 0, sizeof(_stats));
+    _rx = RX_IDLE;
+    _table_count = 0;
+    _tx_rd = 0;
+    _tx_count = 0;
+    _tx_next_ns = SIM_GOWIN_NEVER;
+}
+
+void sim_gowin_rx(uint8_t c,
+                  uint64_t now) {
+    _stats.bytes_rx++;
+
+    switch (_rx) {
+        case RX_IDLE:
+            if (c == START)
+                _rx = RX_CMD;
+            else
+                _stats.stray++;
+            break;
+
+        case RX_CMD:
+            _cmd = c;
+            _rx = RX_STOP;
+            break;
+
+        case RX_STOP:
+            if (c != STOP) { // broken frame, a start byte starts over
+                _stats.stray++;
+                _rx = (c == START) ? RX_CMD : RX_IDLE;
+            } else if ((_cmd == WRITE_EDID) || (_cmd == WRITE_DPCD)) {
+                _table_count = 0;
+                _rx = RX_TABLE;
+            } else {
+                _rx = RX_IDLE;
+                _request(now);
+            }
+            break;
+
+        case RX_TABLE: // binary, no framing inside
+            _table[_table_count++] = c;
+            if (_table_count == SIM_GOWIN_TABLE_SIZE) {
+                _rx = RX_IDLE;
+                _request(now);
+            }
+            break;
+    }
+}
+
+size_t sim_gowin_tx(uint8_t * data,
+                    size_t size,
+                    uint64_t now) {
+    size_t count = 0;
+
+    while (_tx_count && (count < size) && (_tx_next_ns <= now)) {
+        data[count++] = _tx[_tx_rd];
+        _tx_rd = (_tx_rd + 1) % TX_RING_SIZE;
+        _tx_count--;
+        _tx_next_ns += sim_gowin_byte_ns();
+    }
+    if (!_tx_count)
+        _tx_next_ns = SIM_GOWIN_NEVER;
+    _stats.bytes_tx += count;
+    return count;
+}
+
+uint64_t sim_gowin_next_ns(void) {
+    return _tx_next_ns;
+}
+
+void sim_gowin_wake_up(uint64_t now) {
+    memset(_state.edid, 0, sizeof(_state.edid));
+    memset(_state.dpcd, 0, sizeof(_state.dpcd));
+    _send_byte(WAKE_UP, now);
+    _stats.wake_ups++;
+}
+
+struct sim_gowin_state_t * sim_gowin_state(void) {
+    return &_state;
+}
+
+const struct sim_gowin_stats_t * sim_gowin_stats(void) {
+    return &_stats;
+}
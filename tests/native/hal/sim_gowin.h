@@ -0,0 +1,114 @@
+/**
+ * @file sim_gowin.h
+ * @brief  Simulated Gowin FPGA on the other end of the Gowin uart
+ *
+ * The FPGA side of gowin_protocol.c, byte in, bytes out, on the caller's
+ * clock:
+ *  - "$<cmd>#" frames, WRITE_EDID/WRITE_DPCD followed by their 256 byte
+ *    table; bytes outside a frame are ignored
+ *  - READ_EDID/READ_DPCD: '$' and the 256 byte table
+ *  - READ_ETH_STATUS: '$' and the status byte, READ_BL_CURRENT: '$' and the
+ *    current, little endian
+ *  - the table writes and the output commands (fpga, standby, panel
+ *    voltage and power, backlight, write protect): ACK, an unknown command
+ *    NACK
+ * A reply starts delay_ns (+ up to jitter_ns) after the last byte of its
+ * request, then one character time per byte. Faults, per mille of the
+ * requests: a NACK instead of the reply (the command is not executed), a
+ * garbage byte ahead of the reply, no reply at all. sim_gowin_wake_up
+ * sends a WAKE_UP and loses the tables, as an FPGA reload does.
+ *
+ * @version v0.1
+ * @date 2022-10-19
+ */
+
+#ifndef _SIM_GOWIN_H_
+#define _SIM_GOWIN_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SIM_GOWIN_TABLE_SIZE 256
+#define SIM_GOWIN_BAUD       57600  // !< peripherals.c FLEXCOMM1
+#define SIM_GOWIN_NEVER      UINT64_MAX
+
+struct sim_gowin_config_t {
+    uint32_t baud;              // !< 0: SIM_GOWIN_BAUD
+    uint64_t delay_ns;          // !< request -> first reply byte
+    uint64_t jitter_ns;         // !< added to delay_ns, uniform
+    uint16_t nack_permille;
+    uint16_t garbage_permille;
+    uint16_t silent_permille;
+    uint32_t seed;              // !< faults and jitter, 0: 1
+};
+
+/**
+ * @brief  The FPGA's outputs and tables
+ */
+struct sim_gowin_state_t {
+    uint8_t edid[SIM_GOWIN_TABLE_SIZE];
+    uint8_t dpcd[SIM_GOWIN_TABLE_SIZE];
+    bool fpga_on;
+    bool standby;
+    bool panel_voltage_hi;
+    bool panel_power;
+    bool backlight;
+    bool write_protect;
+    uint8_t eth_status;         // !< READ_ETH_STATUS
+    uint16_t bl_current;        // !< READ_BL_CURRENT
+};
+
+/**
+ * @brief  Statistics since sim_gowin_init
+ */
+struct sim_gowin_stats_t {
+    uint32_t requests;          // !< complete frames
+    uint32_t per_cmd[128];      // !< by command byte
+    uint32_t acks;
+    uint32_t nacks;             // !< unknown commands and injected
+    uint32_t injected_nacks;
+    uint32_t garbage;           // !< bytes injected
+    uint32_t silent;            // !< requests not answered
+    uint32_t wake_ups;
+    uint32_t stray;             // !< bytes outside a frame, broken frames
+    uint64_t bytes_rx;
+    uint64_t bytes_tx;
+};
+
+void sim_gowin_init(const struct sim_gowin_config_t * config);
+
+/**
+ * @brief  A byte from the GPMCU, now: when its stop bit is in
+ */
+void sim_gowin_rx(uint8_t c,
+                  uint64_t now);
+
+/**
+ * @brief  The reply bytes on the wire by now, at most size
+ * @return number of bytes
+ */
+size_t sim_gowin_tx(uint8_t * data,
+                    size_t size,
+                    uint64_t now);
+
+/**
+ * @brief  When the next reply byte is in, SIM_GOWIN_NEVER: nothing to send
+ */
+uint64_t sim_gowin_next_ns(void);
+
+/**
+ * @brief  The FPGA (re)starts: WAKE_UP after what is being sent, tables
+ *         cleared
+ */
+void sim_gowin_wake_up(uint64_t now);
+
+/**
+ * @brief  One character on the wire (start, 8 data, stop bit)
+ */
+uint64_t sim_gowin_byte_ns(void);
+
+struct sim_gowin_state_t * sim_gowin_state(void);
+const struct sim_gowin_stats_t * sim_gowin_stats(void);
+
+#endif /* _SIM_GOWIN_H_ */
@@ -0,0 +1,309 @@
+/**
+ * @file sim_is25lp128.c
+ * @brief  Simulated ISSI IS25LP128 spi NOR flash on the native SPI8
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#include <string.h>
+
+#include "fsl_spi.h"
+#include "sim_is25lp128.h"
+
+/*******************************************************************************
+ * Definitions, from the datasheet (not is25xp.h: the driver is under test)
+ ******************************************************************************/
+#define OP_WRSR      0x01
+#define OP_PP        0x02
+#define OP_READ      0x03
+#define OP_WRDI      0x04
+#define OP_RDSR      0x05
+#define OP_WREN      0x06
+#define OP_FAST_READ 0x0B
+#define OP_SE        0x20
+#define OP_SE_       0xD7
+#define OP_BE32      0x52
+#define OP_BE64      0xD8
+#define OP_CER       0xC7
+#define OP_CER_      0x60
+#define OP_RDMDID    0x90
+#define OP_RDID      0x9F
+#define OP_RDPD      0xAB
+#define OP_DP        0xB9
+
+#define SR_WIP       (1 << 0)
+#define SR_WEL       (1 << 1)
+#define SR_WRITABLE  0xBC       // !< BP0-3, QE, SRWD
+
+#define ID_MANUF     0x9D
+#define ID_MEMORY    0x60
+#define ID_CAPACITY  0x18
+#define ID_DEVICE    0x17
+
+#define MS(x)        ((uint64_t)(x) * 1000000ULL)
+
+const struct sim_is25_timing_t sim_is25_typical = {
+    .pp = MS(1) / 5, .se = MS(70), .be32 = MS(100), .be64 = MS(150), .ce = MS(45000), .wrsr = MS(2),
+};
+
+const struct sim_is25_timing_t sim_is25_max = {
+    .pp = MS(4) / 5, .se = MS(300), .be32 = MS(500), .be64 = MS(1000), .ce = MS(180000), .wrsr = MS(15),
+};
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static uint8_t _mem[SIM_IS25_SIZE];
+static struct sim_is25_stats_t _stats;
+static const struct sim_is25_timing_t * _timing = &sim_is25_typical;
+
+static bool _wel = false;
+static bool _deep = false;              // !< deep power down
+static uint8_t _sr = 0;                 // !< written bits of the status register
+static uint64_t _busy_until = 0;
+
+// !< the instruction of the frame being clocked
+static struct {
+    bool ignore;
+    uint8_t op;
+    uint32_t count;                     // !< bytes of the frame
+    uint32_t addr;
+    uint8_t data;                       // !< WRSR
+    uint32_t latched;                   // !< PP data bytes
+    uint8_t latch[SIM_IS25_PAGE_SIZE];
+    bool valid[SIM_IS25_PAGE_SIZE];
+} _frame;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+bool sim_is25lp128_busy(void) {
+    return hal_now_ns() < _busy_until;
+}
+
+static uint8_t _status(void) {
+    // WEL stays set until the write cycle ends
+    if (sim_is25lp128_busy())
+        return _sr | SR_WEL | SR_WIP;
+    return _sr | (_wel ? SR_WEL : 0);
+}
+
+static bool _write_cycle(uint64_t ns) {
+    if (!_wel) {
+        _stats.wel_violations++;
+        return false;
+    }
+    _wel = false;
+    _busy_until = hal_now_ns() + ns;
+    _stats.busy_ns += ns;
+    return true;
+}
+
+static void _program(void) {
+    uint32_t page = _frame.addr & (SIM_IS25_SIZE - SIM_IS25_PAGE_SIZE);
+    uint32_t column = _frame.addr & (SIM_IS25_PAGE_SIZE - 1);
+
+    if (!_write_cycle(_timing->pp))
+        return;
+    if (column + _frame.latched > SIM_IS25_PAGE_SIZE)
+        _stats.page_wraps++;
+
+    for (uint32_t i = 0; i < SIM_IS25_PAGE_SIZE; i++) {
+        if (!_frame.valid[i])
+            continue;
+        if (_frame.latch[i] & ~_mem[page + i])
+            _stats.and_violations++;
+        _mem[page + i] &= _frame.latch[i];
+        _stats.bytes_programmed++;
+    }
+    _stats.programs++;
+    _stats.sector_programs[page / SIM_IS25_SECTOR_SIZE]++;
+}
+
+static void _erase(uint32_t size,
+                   uint64_t ns) {
+    uint32_t start = _frame.addr & (SIM_IS25_SIZE - 1) & ~(size - 1);
+
+    if (!_write_cycle(ns))
+        return;
+    memset(&_mem[start], 0xFF, size);
+    for (uint32_t s = start / SIM_IS25_SECTOR_SIZE; s < (start + size) / SIM_IS25_SECTOR_SIZE; s++)
+        _stats.sector_erases[s]++;
+    _stats.erases++;
+}
+
+static void _select(void * ctx) {
+    (void)ctx;
+    memset(&_frame, 0, sizeof(_frame));
+    if (!hal_spi_mux()) {
+        _stats.unmuxed++;
+        _frame.ignore = true;
+    }
+}
+
+static uint8_t _exchange(void * ctx,
+                         uint8_t mosi) {
+    (void)ctx;
+    uint32_t n = _frame.count++;
+
+    if (_frame.ignore)
+        return 0xFF;
+    if (n == 0) {
+        _frame.op = mosi;
+        if (_deep && (mosi != OP_RDPD)) {
+            _frame.ignore = true;
+        } else if (sim_is25lp128_busy() && (mosi != OP_RDSR)) {
+            _stats.busy_violations++;
+            _frame.ignore = true;
+        } else if (mosi == OP_RDSR) {
+            _stats.rdsr++;
+        } else if ((mosi == OP_READ) || (mosi == OP_FAST_READ)) {
+            _stats.reads++;
+        }
+        return 0xFF;
+    }
+    if (n <= 3)
+        _frame.addr = (_frame.addr << 8) | mosi;
+
+    switch (_frame.op) {
+        case OP_RDSR:
+            return _status();
+        case OP_RDID: {
+            const uint8_t id[] = { ID_MANUF, ID_MEMORY, ID_CAPACITY };
+            return (n <= 3) ? id[n - 1] : 0x00;
+        }
+        case OP_RDMDID:
+            // A0 = 1: device id first
+            if (n <= 3)
+                return 0xFF;
+            return (((n - 4) ^ _frame.addr) & 1) ? ID_DEVICE : ID_MANUF;
+        case OP_RDPD:
+            return (n <= 3) ? 0xFF : ID_DEVICE;
+        case OP_READ:
+        case OP_FAST_READ:
+            if (n < ((_frame.op == OP_READ) ? 4U : 5U))
+                return 0xFF;
+            _stats.bytes_read++;
+            return _mem[_frame.addr++ & (SIM_IS25_SIZE - 1)]; // wraps at the end of the array
+        case OP_PP:
+            if (n >= 4) {
+                uint32_t i = (_frame.addr + n - 4) & (SIM_IS25_PAGE_SIZE - 1);
+
+                _frame.latch[i] = mosi;
+                _frame.valid[i] = true;
+                _frame.latched++;
+            }
+            return 0xFF;
+        case OP_WRSR:
+            if (n == 1)
+                _frame.data = mosi;
+            return 0xFF;
+        default:
+            return 0xFF;
+    }
+}
+
+static void _deselect(void * ctx) {
+    (void)ctx;
+    uint32_t n = _frame.count;
+
+    if (_frame.ignore || (n == 0))
+        return;
+
+    switch (_frame.op) {
+        case OP_WREN:
+            _wel = true;
+            break;
+        case OP_WRDI:
+            _wel = false;
+            break;
+        case OP_WRSR:
+            if (n != 2)
+                _stats.incomplete++;
+            else if (_write_cycle(_timing->wrsr))
+                _sr = _frame.data & SR_WRITABLE;
+            break;
+        case OP_PP:
+            if (n < 5)
+                _stats.incomplete++;
+            else
+                _program();
+            break;
+        case OP_SE:
+        case OP_SE_:
+        case OP_BE32:
+        case OP_BE64:
+            if (n != 4) {
+                _stats.incomplete++;
+                break;
+            }
+            if (_frame.op == OP_BE64)
+                _erase(64 * 1024, _timing->be64);
+            else if (_frame.op == OP_BE32)
+                _erase(32 * 1024, _timing->be32);
+            else
+                _erase(SIM_IS25_SECTOR_SIZE, _timing->se);
+            break;
+        case OP_CER:
+        case OP_CER_:
+            if (n != 1)
+                _stats.incomplete++;
+            else
+                _erase(SIM_IS25_SIZE, _timing->ce);
+            break;
+        case OP_DP:
+            _deep = true;
+            break;
+        case OP_RDPD:
+            _deep = false;
+            break;
+        case OP_RDSR:
+        case OP_RDID:
+        case OP_RDMDID:
+        case OP_READ:
+        case OP_FAST_READ:
+            break;
+        default:
+            _stats.unknown++;
+            break;
+    }
+}
+
+static const struct hal_spi_device_t _device = {
+    .select   = _select,
+    .exchange = _exchange,
+    .deselect = _deselect,
+    .ctx      = NULL,
+};
+
+void sim_is25lp128_init(const struct sim_is25_timing_t * timing) {
+    _timing = timing ? timing : &sim_is25_typical;
+    memset(_mem, 0xFF, sizeof(_mem));
+    memset(&_stats, 0, sizeof(_stats));
+    memset(&_frame, 0, sizeof(_frame));
+    _wel = false;
+    _deep = false;
+    _sr = 0;
+    _busy_until = 0;
+    hal_spi_attach(SPI8, &_device);
+}
+
+uint8_t * sim_is25lp128_memory(void) {
+    return _mem;
+}
+
+const struct sim_is25_stats_t * sim_is25lp128_stats(void) {
+    return &_stats;
+}
+
+uint32_t sim_is25lp128_wear(uint32_t * sector) {
+    uint32_t most = 0;
+
+    for (uint32_t s = 1; s < SIM_IS25_SECTORS; s++) {
+        if (_stats.sector_erases[s] > _stats.sector_erases[most])
+            most = s;
+    }
+    if (sector)
+        *sector = most;
+    return _stats.sector_erases[most];
+}
@@ -0,0 +1,104 @@
+/**
+ * @file sim_is25lp128.h
+ * @brief  Simulated ISSI IS25LP128 spi NOR flash on the native SPI8
+ *
+ * 16MB of memory behind the instructions the driver (is25xp.c) uses: RDID,
+ * RDMDID, RDSR, WREN/WRDI, WRSR, READ, FAST_READ, PP, SE, BE32, BE64, CER,
+ * DP and RDPD. What the part does, not what the driver expects:
+ *  - a page program only clears bits, setting one is counted
+ *    (and_violations) and does not happen
+ *  - PP data wraps to the start of its page, of more than 256 bytes the
+ *    last 256 are programmed (page_wraps)
+ *  - program and erase need WREN, are started by the chip select going
+ *    high after the last address/data byte and keep WIP set for their
+ *    datasheet time; meanwhile everything but RDSR is ignored
+ *    (busy_violations)
+ *  - frames while the mux gives the flash to the Gowin (BOARD_SetSPIMux)
+ *    never reach it (unmuxed)
+ * Block protection and the quad/QPI modes are not modelled.
+ *
+ * @version v0.1
+ * @date 2022-10-18
+ */
+
+#ifndef _SIM_IS25LP128_H_
+#define _SIM_IS25LP128_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIM_IS25_SIZE        (16UL * 1024 * 1024)
+#define SIM_IS25_PAGE_SIZE   256
+#define SIM_IS25_SECTOR_SIZE 4096
+#define SIM_IS25_SECTORS     (SIM_IS25_SIZE / SIM_IS25_SECTOR_SIZE)
+#define SIM_IS25_ENDURANCE   100000 // !< erase cycles per sector
+
+/**
+ * @brief  Write cycle times in ns, datasheet tPP, tSER, tBER32, tBER64,
+ *         tCE and tW
+ */
+struct sim_is25_timing_t {
+    uint64_t pp;
+    uint64_t se;
+    uint64_t be32;
+    uint64_t be64;
+    uint64_t ce;
+    uint64_t wrsr;
+};
+
+extern const struct sim_is25_timing_t sim_is25_typical;
+extern const struct sim_is25_timing_t sim_is25_max;
+
+/**
+ * @brief  Statistics since sim_is25lp128_init
+ */
+struct sim_is25_stats_t {
+    uint32_t reads;             // !< READ/FAST_READ instructions
+    uint64_t bytes_read;
+    uint32_t programs;          // !< page programs done
+    uint64_t bytes_programmed;
+    uint32_t erases;            // !< SE/BE32/BE64/CER done
+    uint32_t rdsr;              // !< status polls
+    uint64_t busy_ns;           // !< time WIP was set
+    // driver errors
+    uint32_t and_violations;    // !< programmed bytes that had to set a bit
+    uint32_t page_wraps;        // !< PP data past the end of its page
+    uint32_t busy_violations;   // !< instructions while WIP
+    uint32_t wel_violations;    // !< program/erase/WRSR without WREN
+    uint32_t incomplete;        // !< chip select high before the address/data
+    uint32_t unknown;           // !< instructions not modelled
+    uint32_t unmuxed;           // !< frames while the Gowin has the flash
+    // wear
+    uint32_t sector_erases[SIM_IS25_SECTORS];   // !< per 4k sector
+    uint32_t sector_programs[SIM_IS25_SECTORS]; // !< page programs per 4k sector
+};
+
+/**
+ * @brief  Erased flash, status register 0, statistics cleared, attached
+ *         to SPI8
+ *
+ * @param timing write cycle times, NULL: sim_is25_typical
+ */
+void sim_is25lp128_init(const struct sim_is25_timing_t * timing);
+
+/**
+ * @brief  The memory array, to preload or check it behind the bus
+ */
+uint8_t * sim_is25lp128_memory(void);
+
+/**
+ * @brief  WIP is set
+ */
+bool sim_is25lp128_busy(void);
+
+const struct sim_is25_stats_t * sim_is25lp128_stats(void);
+
+/**
+ * @brief  Most erased sector
+ *
+ * @param sector NULL or the sector
+ * @returns its erase count, compare with SIM_IS25_ENDURANCE
+ */
+uint32_t sim_is25lp128_wear(uint32_t * sector);
+
+#endif /* _SIM_IS25LP128_H_ */
@@ -0,0 +1,148 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : bench_logger.c  - native
+ * Author              : Barco
+ * created             : 03/10/2022
+ * Description         : ns per LOG_* call, disabled and enabled paths
+ *
+ * Compares the current logger with the previous dispatch (kept below as
+ * _legacy_log): basename walked with strlen on every call before the level
+ * check, and every registered driver visited.
+ * Setup: 1 sink taking all levels + 3 sinks taking ERROR only (like uart +
+ * memory + ...), sinks do no work so only the dispatch is measured.
+ *
+ * History:
+ * 3/10/2022 - initial
+ *******************************************************************************/
+#define _POSIX_C_SOURCE 199309L // clock_gettime with -std=c11
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "logger.h"
+
+#define DEFAULT_LOOPS 2000000UL
+
+static volatile unsigned long sink_bytes = 0;
+
+static int _null_write(void * drv, struct line_info_t * linfo, char * fmt, va_list * v) {
+    (void)drv;
+    (void)v;
+    sink_bytes += (unsigned long)linfo->ln + fmt[0];
+    return 0;
+}
+
+static const struct logger_ops_t null_ops = {
+    .init  = NULL,
+    .write = _null_write,
+    .read  = NULL,
+    .flush = NULL,
+    .close = NULL,
+};
+
+static struct logger_driver_t sink_all = { .enabled = true, .name = "all", .ops = &null_ops };
+static struct logger_driver_t sink_e1 = { .enabled = true, .name = "e1", .ops = &null_ops, .levels = LOG_LVL_ERROR };
+static struct logger_driver_t sink_e2 = { .enabled = true, .name = "e2", .ops = &null_ops, .levels = LOG_LVL_ERROR };
+static struct logger_driver_t sink_e3 = { .enabled = true, .name = "e3", .ops = &null_ops, .levels = LOG_LVL_ERROR };
+
+struct logger_driver_t * adrivers[] = {
+    &sink_all,
+    &sink_e1,
+    &sink_e2,
+    &sink_e3,
+    NULL,
+};
+
+// ------------------------------------------------------------------------------
+// previous logger_log, for the "before" numbers
+static int _legacy_loglvl = LOG_LVL_EXTRA;
+
+static const char * _legacy_basename(const char * filename) {
+    size_t last_index = 0;
+
+    for (size_t i = 0; i < strlen(filename); i++) {
+        if (filename[i] == '/') {
+            last_index = i;
+        }
+    }
+    return &filename[last_index + 1];
+}
+
+static void __attribute__((noinline)) _legacy_log(const int lvl, const char * file, const char * fn,
+                                                  const int ln, char * fmt, ...) {
+    va_list va;
+
+    struct line_info_t linfo = {
+        .lvl  = lvl,
+        .file = _legacy_basename(file),
+        .fn   = fn,
+        .ln   = ln,
+    };
+
+    if (!(lvl & _legacy_loglvl)) {
+        return;
+    }
+
+    va_start(va, fmt);
+    for (int i = 0; adrivers[i] != NULL; i++) {
+        if (adrivers[i]->enabled && adrivers[i]->ops) {
+            if (adrivers[i]->ops->write) {
+                adrivers[i]->ops->write((void *)adrivers[i], &linfo, fmt, &va);
+            }
+            if (adrivers[i]->ops->flush) {
+                adrivers[i]->ops->flush((void *)adrivers[i]);
+            }
+        }
+    }
+    va_end(va);
+}
+
+#define LEGACY_LOG(lvl, msg, ...) \
+    _legacy_log(lvl, __FILE__, __FUNCTION__, __LINE__, msg, ## __VA_ARGS__)
+
+// ------------------------------------------------------------------------------
+static double _now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+#define BENCH(name, loops, stmt) \
+    do { \
+        double _t0 = _now_ns(); \
+        for (unsigned long _i = 0; _i < (loops); _i++) { \
+            stmt; \
+            __asm__ volatile ("" ::: "memory"); \
+        } \
+        printf("  %-44s %8.2f ns/call\n", name, (_now_ns() - _t0) / (double)(loops)); \
+    } while (0)
+
+int main(int argc, char ** argv) {
+    unsigned long loops = (argc > 1) ? strtoul(argv[1], NULL, 0) : DEFAULT_LOOPS;
+
+    logger_init();
+
+    printf("logger dispatch, %lu calls per case, compile level 0x%x\n",
+           loops, (unsigned int)(LOGGER_COMPILE_LVL));
+
+    printf("disabled:\n");
+    _legacy_loglvl = LOG_LVL_ERROR;
+    BENCH("before: runtime level off", loops, LEGACY_LOG(LOG_LVL_INFO, "value %d", 1));
+    logger_set_loglvl(LOG_LVL_ERROR);
+    BENCH("after:  runtime level off", loops, LOG_INFO("value %d", 1));
+    BENCH("after:  compiled out (LOGGER_COMPILE_LVL)", loops, LOG_DEBUG("value %d", 1));
+
+    printf("enabled (1 of 4 sinks interested):\n");
+    _legacy_loglvl = LOG_LVL_EXTRA;
+    logger_set_loglvl(LOG_LVL_EXTRA);
+    BENCH("before", loops, LEGACY_LOG(LOG_LVL_INFO, "value %d", 1));
+    BENCH("after", loops, LOG_INFO("value %d", 1));
+
+    printf("enabled (4 of 4 sinks interested):\n");
+    BENCH("before", loops, LEGACY_LOG(LOG_LVL_ERROR, "value %d", 1));
+    BENCH("after", loops, LOG_ERROR("value %d", 1));
+
+    return (sink_bytes == 0);
+}
@@ -0,0 +1,199 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : bench_ring.c  - native
+ * Author              : Barco
+ * created             : 05/10/2022
+ * Description         : push+pop cost of the previous malloc/mutex queue vs
+ *                       the lock-free rings
+ *
+ * The previous queue is kept below as legacy_*: a malloc'd node per push and
+ * a pthread mutex around push and pop.
+ * - single thread: push 1 + pop 1, ns per pair
+ * - threaded: 1 (SPSC) or 4 (MPSC, legacy) producers, 1 consumer, Mops/s
+ *
+ * History:
+ * 5/10/2022 - initial
+ *******************************************************************************/
+#define _POSIX_C_SOURCE 200809L // clock_gettime, pthread with -std=c11
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "ring.h"
+
+#define DEFAULT_LOOPS 2000000UL
+#define PRODUCERS     4
+
+// ------------------------------------------------------------------------------
+// previous queue.c, for the "before" numbers
+struct legacy_elm_t {
+    struct legacy_elm_t * next;
+    void *                data;
+};
+
+struct legacy_queue_t {
+    int                   n_elements;
+    struct legacy_elm_t * head;
+    struct legacy_elm_t * tail;
+    pthread_mutex_t       mutex;
+};
+
+static struct legacy_queue_t legacy = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+static int __attribute__((noinline)) legacy_push(struct legacy_queue_t * q, void * data) {
+    struct legacy_elm_t * new = malloc(sizeof(struct legacy_elm_t));
+
+    if (!new) {
+        return -1;
+    }
+    memset(new, 0, sizeof(struct legacy_elm_t));
+
+    pthread_mutex_lock(&q->mutex);
+    new->data = data;
+    if (q->n_elements == 0) {
+        q->head = new;
+    } else {
+        q->tail->next = new;
+    }
+    q->tail = new;
+    q->n_elements++;
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+static int __attribute__((noinline)) legacy_pop(struct legacy_queue_t * q, void ** data) {
+    pthread_mutex_lock(&q->mutex);
+    if (q->n_elements == 0) {
+        pthread_mutex_unlock(&q->mutex);
+        return -1;
+    }
+    struct legacy_elm_t * tmp = q->head;
+    q->head = tmp->next;
+    q->n_elements--;
+    *data = tmp->data;
+    free(tmp);
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+static int _legacy_push(void * ctx, const void * elm) {
+    return legacy_push((struct legacy_queue_t *)ctx, *(void * const *)elm);
+}
+
+static int _legacy_pop(void * ctx, void * elm) {
+    return legacy_pop((struct legacy_queue_t *)ctx, (void **)elm);
+}
+
+// ------------------------------------------------------------------------------
+RING_DEFINE(spsc, void *, 256);
+RING_MPSC_DEFINE(mpsc, void *, 256);
+
+static int _spsc_push(void * ctx, const void * elm) {
+    return ring_push((struct ring_t *)ctx, elm);
+}
+
+static int _spsc_pop(void * ctx, void * elm) {
+    return ring_pop((struct ring_t *)ctx, elm);
+}
+
+static int _mpsc_push(void * ctx, const void * elm) {
+    return ring_mpsc_push((struct ring_t *)ctx, elm);
+}
+
+static int _mpsc_pop(void * ctx, void * elm) {
+    return ring_mpsc_pop((struct ring_t *)ctx, elm);
+}
+
+struct impl_t {
+    const char * name;
+    void *       ctx;
+    int          (*push)(void *, const void *);
+    int          (*pop)(void *, void *);
+    int          producers;
+};
+
+static const struct impl_t impls[] = {
+    { "before: malloc/mutex queue", &legacy, _legacy_push, _legacy_pop, PRODUCERS },
+    { "after:  SPSC ring",          &spsc,   _spsc_push,   _spsc_pop,   1 },
+    { "after:  MPSC ring",          &mpsc,   _mpsc_push,   _mpsc_pop,   PRODUCERS },
+};
+
+// ------------------------------------------------------------------------------
+static double _now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+struct producer_t {
+    pthread_t             thread;
+    const struct impl_t * impl;
+    unsigned long         items;
+};
+
+static void * _producer(void * arg) {
+    struct producer_t * p = (struct producer_t *)arg;
+    void * data = p;
+
+    for (unsigned long i = 0; i < p->items; i++) {
+        while (p->impl->push(p->impl->ctx, &data) != 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static double _threaded(const struct impl_t * impl, unsigned long loops) {
+    struct producer_t p[PRODUCERS];
+    unsigned long items = loops / (unsigned long)impl->producers;
+    unsigned long received = 0;
+    void * data;
+
+    double t0 = _now_ns();
+    for (int i = 0; i < impl->producers; i++) {
+        p[i] = (struct producer_t){ .impl = impl, .items = items };
+        pthread_create(&p[i].thread, NULL, _producer, &p[i]);
+    }
+    while (received < items * (unsigned long)impl->producers) {
+        if (impl->pop(impl->ctx, &data) == 0) {
+            received++;
+        } else {
+            sched_yield();
+        }
+    }
+    for (int i = 0; i < impl->producers; i++) {
+        pthread_join(p[i].thread, NULL);
+    }
+    return (double)received / ((_now_ns() - t0) / 1e3);
+}
+
+int main(int argc, char ** argv) {
+    unsigned long loops = (argc > 1) ? strtoul(argv[1], NULL, 0) : DEFAULT_LOOPS;
+    size_t n = sizeof(impls) / sizeof(impls[0]);
+    void * data = &loops;
+
+    printf("queue push+pop, %lu ops per case\n", loops);
+
+    printf("single thread:\n");
+    for (size_t i = 0; i < n; i++) {
+        double t0 = _now_ns();
+        for (unsigned long l = 0; l < loops; l++) {
+            impls[i].push(impls[i].ctx, &data);
+            impls[i].pop(impls[i].ctx, &data);
+            __asm__ volatile ("" ::: "memory");
+        }
+        printf("  %-30s %8.2f ns/pair\n", impls[i].name, (_now_ns() - t0) / (double)loops);
+    }
+
+    printf("threaded (producers -> 1 consumer):\n");
+    for (size_t i = 0; i < n; i++) {
+        printf("  %-30s %d -> 1 %8.2f Mops/s\n", impls[i].name, impls[i].producers,
+               _threaded(&impls[i], loops));
+    }
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_logger.c  - native
+ * Author              : Barco
+ * created             : 03/10/2022
+ * Description         : logger core test, level gating and driver dispatch
+ *
+ * History:
+ * 3/10/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "logger.h"
+
+// built with -DLOGGER_COMPILE_LVL=LOG_LVL_ALL : no debug level compiled in
+#if LOGGER_LVL_COMPILED(LOG_LVL_DEBUG)
+#error "test expects LOG_LVL_DEBUG compiled out"
+#endif
+
+struct spy_t {
+    int          calls;
+    int          lvl;
+    const char * file;
+    const char * fn;
+    char         text[MAX_STR_LEN];
+};
+
+static struct spy_t spy_all;
+static struct spy_t spy_err;
+
+static int _spy_write(void * drv, struct line_info_t * linfo, char * fmt, va_list * v) {
+    struct spy_t * spy = (struct spy_t *)((struct logger_driver_t *)drv)->priv_data;
+
+    spy->calls++;
+    spy->lvl = linfo->lvl;
+    spy->file = linfo->file;
+    spy->fn = linfo->fn;
+    vsnprintf(spy->text, sizeof(spy->text), fmt, *v);
+    return 0;
+}
+
+static const struct logger_ops_t spy_ops = {
+    .init  = NULL,
+    .write = _spy_write,
+    .read  = NULL,
+    .flush = NULL,
+    .close = NULL,
+};
+
+static struct logger_driver_t drv_all = {
+    .enabled   = true,
+    .name      = "spy_all",
+    .ops       = &spy_ops,
+    .priv_data = &spy_all,
+};
+
+static struct logger_driver_t drv_err = {
+    .enabled   = true,
+    .name      = "spy_err",
+    .ops       = &spy_ops,
+    .priv_data = &spy_err,
+    .levels    = LOG_LVL_ERROR | LOG_LVL_WARN,
+};
+
+struct logger_driver_t * adrivers[] = {
+    &drv_all,
+    &drv_err,
+    NULL,
+};
+
+static int _setup(void ** state) {
+    (void)state;
+    memset(&spy_all, 0, sizeof(spy_all));
+    memset(&spy_err, 0, sizeof(spy_err));
+    drv_all.enabled = true;
+    logger_set_loglvl(LOG_LVL_EXTRA);
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+// drivers only get the levels they registered for
+void level_filter_test(void ** state) {
+    (void)state;
+
+    LOG_INFO("info %d", 1);
+    assert_int_equal(spy_all.calls, 1);
+    assert_int_equal(spy_err.calls, 0);
+    assert_string_equal(spy_all.text, "info 1");
+
+    LOG_ERROR("error %s", "two");
+    assert_int_equal(spy_all.calls, 2);
+    assert_int_equal(spy_err.calls, 1);
+    assert_int_equal(spy_err.lvl, LOG_LVL_ERROR);
+    assert_string_equal(spy_err.text, "error two");
+
+    // disabled at runtime is skipped, without rebuilding the lists
+    drv_all.enabled = false;
+    LOG_WARN("warn");
+    assert_int_equal(spy_all.calls, 2);
+    assert_int_equal(spy_err.calls, 2);
+}
+
+// ------------------------------------------------------------------------------
+// compiled out: no call, arguments not evaluated
+void compile_gating_test(void ** state) {
+    (void)state;
+    int n = 0;
+
+    LOG_DEBUG("debug %d", n++);
+    assert_int_equal(n, 0);
+    assert_int_equal(spy_all.calls, 0);
+
+    // still an expression
+    (n == 0) ? LOG_RAW("raw %d", n) : LOG_INFO("info %d", n);
+    assert_int_equal(spy_all.calls, 1);
+    assert_int_equal(spy_all.lvl, LOG_LVL_RAW);
+}
+
+// ------------------------------------------------------------------------------
+// runtime level still applies
+void runtime_level_test(void ** state) {
+    (void)state;
+
+    logger_set_loglvl(LOG_LVL_ERROR);
+    LOG_INFO("info");
+    LOG_WARN("warn");
+    assert_int_equal(spy_all.calls, 0);
+    assert_int_equal(spy_err.calls, 0);
+
+    LOG_ERROR("error");
+    assert_int_equal(spy_all.calls, 1);
+    assert_int_equal(spy_err.calls, 1);
+}
+
+// ------------------------------------------------------------------------------
+// basename resolved by the macro, level id's incl. RAW
+void line_info_test(void ** state) {
+    (void)state;
+    int raw_count = _log_levels[logger_mask2id(LOG_LVL_RAW)].counter;
+
+    LOG_OK("ok");
+    assert_string_equal(spy_all.file, "unit_test_logger.c");
+    assert_string_equal(spy_all.fn, "line_info_test");
+
+    assert_int_equal(logger_mask2id(LOG_LVL_DEBUG), 0);
+    assert_int_equal(logger_mask2id(LOG_LVL_ERROR), 4);
+    assert_int_equal(logger_mask2id(LOG_LVL_RAW), 5);
+    assert_string_equal(_log_levels[logger_mask2id(LOG_LVL_RAW)].name, "RAW");
+
+    LOG_RAW("raw");
+    assert_int_equal(_log_levels[logger_mask2id(LOG_LVL_RAW)].counter, raw_count + 1);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest tests_logger[] = {
+        cmocka_unit_test_setup(level_filter_test, _setup),
+        cmocka_unit_test_setup(compile_gating_test, _setup),
+        cmocka_unit_test_setup(runtime_level_test, _setup),
+        cmocka_unit_test_setup(line_info_test, _setup),
+    };
+
+    logger_init();
+
+    return cmocka_run_group_tests(tests_logger, NULL, NULL);
+}
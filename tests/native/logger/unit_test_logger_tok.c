@@ -0,0 +1,148 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_logger_tok.c  - native
+ * Author              : Barco
+ * created             : 19/09/2022
+ * Description         : tokenized logger ring test
+ *
+ * History:
+ * 19/9/2022 - initial
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "logger.h"
+#include "logger-tok.h"
+
+#define HDR_TOKEN(h) ((h) >> 16)
+#define HDR_LEVEL(h) (((h) >> 12) & 0xF)
+#define HDR_NARGS(h) (((h) >> 8) & 0xF)
+#define HDR_SEQ(h)   ((h) & 0xFF)
+
+static uint32_t region[(sizeof(struct logger_tok_ring_t) + 256) / sizeof(uint32_t)];
+
+// ------------------------------------------------------------------------------
+// walk the ring like the host decoder, returns the number of records
+static int walk_ring(struct logger_tok_ring_t * ring, uint32_t * hdrs, int max) {
+    uint32_t pos = ring->rd;
+    uint32_t left = ring->used;
+    int n = 0;
+
+    while (left) {
+        uint32_t hdr = ring->data[pos / sizeof(uint32_t)];
+        uint32_t len = (hdr == LOGGER_TOK_PAD) ? (ring->size - pos) :
+                       (uint32_t)(sizeof(uint32_t) * (1 + HDR_NARGS(hdr)));
+        if ((hdr != LOGGER_TOK_PAD) && (n < max))
+            hdrs[n++] = hdr;
+        pos = (pos + len) % ring->size;
+        left -= len;
+    }
+    return n;
+}
+
+// ------------------------------------------------------------------------------
+// record contains token, level, arguments, the token resolves to the format string
+void tok_record_test(void ** states) {
+    struct logger_tok_ring_t * ring;
+    const char * name = "name";
+
+    assert_int_equal(logger_tok_init(region, sizeof(region), true), 0);
+    ring = logger_tok_ring();
+    assert_non_null(ring);
+    assert_int_equal(ring->magic, LOGGER_TOK_MAGIC);
+    assert_int_equal(ring->size, 256);
+
+    LOG_INFO("no arguments");
+    LOG_WARN("value %d 0x%x %s", -5, 0xAB, name);
+
+    assert_int_equal(ring->count, 2);
+    assert_int_equal(ring->used, 4 + 16);
+
+    uint32_t hdr = ring->data[0];
+    assert_int_equal(HDR_LEVEL(hdr), LOGGER_TOK_LVL_INFO);
+    assert_int_equal(HDR_NARGS(hdr), 0);
+    assert_int_equal(HDR_SEQ(hdr), 0);
+    assert_string_equal(__start_logtok + HDR_TOKEN(hdr), "no arguments");
+
+    hdr = ring->data[1];
+    assert_int_equal(HDR_LEVEL(hdr), LOGGER_TOK_LVL_WARN);
+    assert_int_equal(HDR_NARGS(hdr), 3);
+    assert_int_equal(HDR_SEQ(hdr), 1);
+    assert_string_equal(__start_logtok + HDR_TOKEN(hdr), "value %d 0x%x %s");
+    assert_int_equal((int32_t)ring->data[2], -5);
+    assert_int_equal(ring->data[3], 0xAB);
+    assert_int_equal(ring->data[4], (uint32_t)(uintptr_t)name);
+}
+
+// ------------------------------------------------------------------------------
+// a full ring evicts the oldest records and wraps with a pad record
+void tok_wrap_test(void ** states) {
+    struct logger_tok_ring_t * ring;
+    uint32_t hdrs[64];
+
+    assert_int_equal(logger_tok_init(region, sizeof(region), true), 0);
+    ring = logger_tok_ring();
+
+    for (int i = 0; i < 100; i++) {
+        if (i % 3)
+            LOG_INFO("two %d %d", i, i);
+        else
+            LOG_ERROR("one %d", i);
+    }
+
+    assert_int_equal(ring->count, 100);
+    assert_true(ring->evicted > 0);
+    assert_true(ring->used <= ring->size);
+
+    int n = walk_ring(ring, hdrs, 64);
+    assert_int_equal(n + ring->evicted, 100);
+    // records are consecutive and end with the newest one
+    for (int i = 0; i < n; i++) {
+        assert_int_equal(HDR_SEQ(hdrs[i]), (100 - n + i) & 0xFF);
+    }
+}
+
+// ------------------------------------------------------------------------------
+// disabled levels are not stored, an existing log is continued
+void tok_level_and_continue_test(void ** states) {
+    struct logger_tok_ring_t * ring;
+
+    assert_int_equal(logger_tok_init(region, sizeof(region), true), 0);
+    ring = logger_tok_ring();
+
+    logger_set_loglvl(LOG_LVL_PRODUCTION);
+    LOG_DEBUG("filtered %d", 1);
+    LOG_ERROR("stored %d", 2);
+    logger_set_loglvl(LOG_LVL_EXTRA);
+    assert_int_equal(ring->count, 1);
+
+    // application start: continue the bootloader log
+    assert_int_equal(logger_tok_init(region, sizeof(region), false), 0);
+    assert_int_equal(ring->count, 1);
+    LOG_OK("continued");
+    assert_int_equal(ring->count, 2);
+
+    // corrupt header starts a new log
+    ring->magic = 0;
+    assert_int_equal(logger_tok_init(region, sizeof(region), false), 0);
+    assert_int_equal(ring->count, 0);
+
+    assert_int_equal(logger_tok_init(region, 16, true), -1);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest tests_tok[] = {
+        cmocka_unit_test(tok_record_test),
+        cmocka_unit_test(tok_wrap_test),
+        cmocka_unit_test(tok_level_and_continue_test),
+    };
+
+    return cmocka_run_group_tests(tests_tok, NULL, NULL);
+}
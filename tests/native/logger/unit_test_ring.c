@@ -0,0 +1,252 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_ring.c  - native
+ * Author              : Barco
+ * created             : 05/10/2022
+ * Description         : lock-free ring (SPSC/MPSC) and queue test, incl.
+ *                       threaded stress
+ *
+ * History:
+ * 5/10/2022 - initial
+ *******************************************************************************/
+#define _POSIX_C_SOURCE 200809L // pthread, sched_yield with -std=c11
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "ring.h"
+#include "queue.h"
+
+#define STRESS_ITEMS     1000000UL
+#define STRESS_PRODUCERS 4
+
+struct item_t {
+    uint32_t producer;
+    uint32_t value;
+};
+
+RING_DEFINE(spsc, uint32_t, 8);
+RING_MPSC_DEFINE(mpsc, uint32_t, 8);
+
+// ------------------------------------------------------------------------------
+// start a ring at 'pos', as if 'pos' elements already went through
+static void _ring_rewind(struct ring_t * r, uint32_t pos) {
+    atomic_store(&r->head, pos);
+    atomic_store(&r->tail, pos);
+    for (uint32_t i = 0; r->seq && i <= r->mask; i++) {
+        uint32_t p = pos + i;
+        atomic_store(&r->seq[p & r->mask], p - (p & r->mask));
+    }
+}
+
+static int _setup(void ** state) {
+    (void)state;
+    _ring_rewind(&spsc, 0);
+    _ring_rewind(&mpsc, 0);
+    return 0;
+}
+
+// ------------------------------------------------------------------------------
+// full, empty and order for both flavours
+static void _basic(struct ring_t * r,
+                   int (*push)(struct ring_t *, const void *),
+                   int (*pop)(struct ring_t *, void *)) {
+    uint32_t v;
+
+    assert_int_equal(ring_capacity(r), 8);
+    assert_int_equal(pop(r, &v), -1);
+
+    for (v = 0; v < 8; v++) {
+        assert_int_equal(push(r, &v), 0);
+    }
+    assert_int_equal(ring_count(r), 8);
+    assert_int_equal(push(r, &v), -1);
+
+    for (uint32_t i = 0; i < 8; i++) {
+        assert_int_equal(pop(r, &v), 0);
+        assert_int_equal(v, i);
+    }
+    assert_int_equal(ring_count(r), 0);
+    assert_int_equal(pop(r, &v), -1);
+}
+
+void spsc_basic_test(void ** state) {
+    (void)state;
+    _basic(&spsc, ring_push, ring_pop);
+}
+
+void mpsc_basic_test(void ** state) {
+    (void)state;
+    _basic(&mpsc, ring_mpsc_push, ring_mpsc_pop);
+}
+
+// ------------------------------------------------------------------------------
+// free running counters crossing UINT32_MAX
+static void _wrap(struct ring_t * r,
+                  int (*push)(struct ring_t *, const void *),
+                  int (*pop)(struct ring_t *, void *)) {
+    uint32_t v;
+
+    _ring_rewind(r, UINT32_MAX - 4);
+    for (uint32_t lap = 0; lap < 3; lap++) {
+        for (v = 0; v < 8; v++) {
+            assert_int_equal(push(r, &v), 0);
+        }
+        assert_int_equal(push(r, &v), -1);
+        assert_int_equal(ring_count(r), 8);
+        for (uint32_t i = 0; i < 8; i++) {
+            assert_int_equal(pop(r, &v), 0);
+            assert_int_equal(v, i);
+        }
+        assert_int_equal(pop(r, &v), -1);
+    }
+}
+
+void spsc_wrap_test(void ** state) {
+    (void)state;
+    _wrap(&spsc, ring_push, ring_pop);
+}
+
+void mpsc_wrap_test(void ** state) {
+    (void)state;
+    _wrap(&mpsc, ring_mpsc_push, ring_mpsc_pop);
+}
+
+// ------------------------------------------------------------------------------
+// runtime init: bad capacity refused, structs as elements
+void init_test(void ** state) {
+    (void)state;
+    struct ring_t r;
+    struct item_t buf[4];
+    _Atomic uint32_t seq[4];
+    struct item_t in = { .producer = 1, .value = 42 };
+    struct item_t out;
+
+    assert_int_equal(ring_init(&r, buf, NULL, sizeof(struct item_t), 3), -1);
+    assert_int_equal(ring_init(&r, buf, NULL, sizeof(struct item_t), 0), -1);
+    assert_int_equal(ring_init(&r, buf, seq, sizeof(struct item_t), 4), 0);
+
+    assert_int_equal(ring_mpsc_push(&r, &in), 0);
+    assert_int_equal(ring_mpsc_pop(&r, &out), 0);
+    assert_memory_equal(&in, &out, sizeof(in));
+}
+
+// ------------------------------------------------------------------------------
+// queue on top of the ring, destroy drains the leftovers
+static int destroyed = 0;
+
+static void _destroy(void * data) {
+    destroyed += *(int *)data;
+}
+
+QUEUE_DEFINE(q, 4, _destroy);
+
+void queue_test(void ** state) {
+    (void)state;
+    int values[5] = { 1, 2, 3, 4, 5 };
+    void * data;
+
+    for (int i = 0; i < 4; i++) {
+        assert_int_equal(queue_push(&q, &values[i]), 0);
+    }
+    assert_int_equal(queue_push(&q, &values[4]), -1);
+    assert_int_equal(QUEUE_SIZE(&q), 4);
+
+    assert_int_equal(queue_pop(&q, &data), 0);
+    assert_ptr_equal(data, &values[0]);
+
+    queue_destroy(&q);
+    assert_int_equal(destroyed, 2 + 3 + 4);
+    assert_int_equal(QUEUE_SIZE(&q), 0);
+    assert_int_equal(queue_pop(&q, &data), -1);
+}
+
+// ------------------------------------------------------------------------------
+// threaded stress: consumer checks order per producer and the total
+RING_DEFINE(stress_spsc, struct item_t, 64);
+RING_MPSC_DEFINE(stress_mpsc, struct item_t, 64);
+
+struct producer_t {
+    pthread_t       thread;
+    struct ring_t * ring;
+    int (*push)(struct ring_t *, const void *);
+    uint32_t        id;
+    unsigned long   items;
+};
+
+static void * _producer(void * arg) {
+    struct producer_t * p = (struct producer_t *)arg;
+
+    for (uint32_t i = 0; i < p->items; i++) {
+        struct item_t it = { .producer = p->id, .value = i };
+        while (p->push(p->ring, &it) != 0) {
+            sched_yield(); // full, let the consumer run
+        }
+    }
+    return NULL;
+}
+
+static void _stress(struct ring_t * r,
+                    int (*push)(struct ring_t *, const void *),
+                    int (*pop)(struct ring_t *, void *),
+                    int producers) {
+    struct producer_t p[STRESS_PRODUCERS];
+    uint32_t next[STRESS_PRODUCERS] = { 0 };
+    unsigned long items = STRESS_ITEMS / (unsigned long)producers;
+    unsigned long received = 0;
+    struct item_t it;
+
+    for (int i = 0; i < producers; i++) {
+        p[i] = (struct producer_t){ .ring = r, .push = push, .id = (uint32_t)i, .items = items };
+        assert_int_equal(pthread_create(&p[i].thread, NULL, _producer, &p[i]), 0);
+    }
+
+    while (received < items * (unsigned long)producers) {
+        if (pop(r, &it) != 0) {
+            sched_yield();
+            continue;
+        }
+        assert_true(it.producer < (uint32_t)producers);
+        assert_int_equal(it.value, next[it.producer]);
+        next[it.producer]++;
+        received++;
+    }
+
+    for (int i = 0; i < producers; i++) {
+        pthread_join(p[i].thread, NULL);
+    }
+    assert_int_equal(pop(r, &it), -1);
+}
+
+void spsc_stress_test(void ** state) {
+    (void)state;
+    _stress(&stress_spsc, ring_push, ring_pop, 1);
+}
+
+void mpsc_stress_test(void ** state) {
+    (void)state;
+    _stress(&stress_mpsc, ring_mpsc_push, ring_mpsc_pop, STRESS_PRODUCERS);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest tests_ring[] = {
+        cmocka_unit_test_setup(spsc_basic_test, _setup),
+        cmocka_unit_test_setup(mpsc_basic_test, _setup),
+        cmocka_unit_test_setup(spsc_wrap_test, _setup),
+        cmocka_unit_test_setup(mpsc_wrap_test, _setup),
+        cmocka_unit_test(init_test),
+        cmocka_unit_test(queue_test),
+        cmocka_unit_test(spsc_stress_test),
+        cmocka_unit_test(mpsc_stress_test),
+    };
+
+    return cmocka_run_group_tests(tests_ring, NULL, NULL);
+}
@@ -0,0 +1,152 @@
+/*********************** (C) COPYRIGHT BARCO  *********************************
+ * File Name           : unit_test_tracer.c  - native
+ * Author              : Barco
+ * created             : 06/10/2022
+ * Description         : span/event tracer test, clock_gettime timestamps
+ *
+ * History:
+ * 6/10/2022 - initial
+ *******************************************************************************/
+#define _POSIX_C_SOURCE 199309L // nanosleep with -std=c11
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tracer.h"
+
+#if !defined(CFG_TRACER)
+#error "test expects CFG_TRACER"
+#endif
+
+// header + 64 records + some slack, capacity rounds down to 64
+static uint32_t region[(16 + 64 * 12 + 40) / sizeof(uint32_t)];
+
+static struct tracer_ring_t * ring;
+
+static int _setup(void ** state) {
+    (void)state;
+    assert_int_equal(tracer_init(region, sizeof(region), 1000000000U), 0);
+    ring = tracer_ring();
+    return 0;
+}
+
+static const struct tracer_rec_t * _rec(uint32_t idx) {
+    return &ring->rec[idx & (ring->capacity - 1)];
+}
+
+// ------------------------------------------------------------------------------
+void init_test(void ** state) {
+    (void)state;
+
+    assert_int_equal(tracer_init(region, 16 + 15 * 12, 1000), -1);
+    assert_int_equal(tracer_init(NULL, sizeof(region), 1000), -1);
+
+    assert_int_equal(tracer_init(region, sizeof(region), 150000000U), 0);
+    assert_ptr_equal(tracer_ring(), region);
+    assert_int_equal(tracer_ring()->magic, TRACER_MAGIC);
+    assert_int_equal(tracer_ring()->capacity, 64);
+    assert_int_equal(tracer_ring()->clk_hz, 150000000U);
+    assert_int_equal(tracer_ring()->head, 0);
+    assert_int_equal(sizeof(struct tracer_rec_t), 12);
+}
+
+// ------------------------------------------------------------------------------
+// begin/end/instant/counter, names resolved from tracetok
+void record_test(void ** state) {
+    (void)state;
+
+    TRACE_BEGIN("outer");
+    TRACE_INSTANT("mark", 7);
+    TRACE_COUNTER("queue", 3);
+    TRACE_END("outer");
+
+    assert_int_equal(ring->head, 4);
+    assert_int_equal(_rec(0)->type, TRACER_BEGIN);
+    assert_string_equal(tracer_name(_rec(0)), "outer");
+    assert_int_equal(_rec(1)->type, TRACER_INSTANT);
+    assert_string_equal(tracer_name(_rec(1)), "mark");
+    assert_int_equal(_rec(1)->arg, 7);
+    assert_int_equal(_rec(2)->type, TRACER_COUNTER);
+    assert_int_equal(_rec(2)->arg, 3);
+    assert_int_equal(_rec(3)->type, TRACER_END);
+    assert_int_equal(_rec(3)->ctx, 0);
+
+    for (uint32_t i = 1; i < 4; i++) {
+        assert_true((int32_t)(_rec(i)->ts - _rec(i - 1)->ts) >= 0);
+    }
+}
+
+// ------------------------------------------------------------------------------
+// scope ends on every way out of the block
+static int _scoped(int early) {
+    TRACE_SCOPE("scoped");
+
+    if (early) {
+        return 1;
+    }
+    TRACE_INSTANT("late", 0);
+    return 0;
+}
+
+void scope_test(void ** state) {
+    (void)state;
+
+    _scoped(1);
+    _scoped(0);
+
+    assert_int_equal(ring->head, 5);
+    assert_int_equal(_rec(0)->type, TRACER_BEGIN);
+    assert_int_equal(_rec(1)->type, TRACER_END);
+    assert_string_equal(tracer_name(_rec(1)), "scoped");
+    assert_int_equal(_rec(2)->type, TRACER_BEGIN);
+    assert_string_equal(tracer_name(_rec(3)), "late");
+    assert_int_equal(_rec(4)->type, TRACER_END);
+}
+
+// ------------------------------------------------------------------------------
+// full ring overwrites the oldest, head keeps counting
+void overwrite_test(void ** state) {
+    (void)state;
+
+    for (uint32_t i = 0; i < ring->capacity + 5; i++) {
+        TRACE_COUNTER("n", i);
+    }
+    assert_int_equal(ring->head, ring->capacity + 5);
+    assert_int_equal(_rec(0)->arg, ring->capacity);
+    assert_int_equal(_rec(4)->arg, ring->capacity + 4);
+    assert_int_equal(_rec(5)->arg, 5);
+}
+
+// ------------------------------------------------------------------------------
+// spans measure real time
+void timing_test(void ** state) {
+    (void)state;
+
+    TRACE_BEGIN("sleep");
+    nanosleep(&(struct timespec){ .tv_nsec = 2000000 }, NULL);
+    TRACE_END("sleep");
+
+    uint32_t ns = _rec(1)->ts - _rec(0)->ts;
+    assert_true(ns >= 2000000U);
+    assert_true(ns < 1000000000U);
+}
+
+// ------------------------------------------------------------------------------
+int main(void) {
+    const struct CMUnitTest tests_tracer[] = {
+        cmocka_unit_test(init_test),
+        cmocka_unit_test_setup(record_test, _setup),
+        cmocka_unit_test_setup(scope_test, _setup),
+        cmocka_unit_test_setup(overwrite_test, _setup),
+        cmocka_unit_test_setup(timing_test, _setup),
+    };
+
+    return cmocka_run_group_tests(tests_tracer, NULL, NULL);
+}
@@ -0,0 +1,148 @@
+/**
+ * @file logger-tok.h
+ * @brief Tokenized (deferred) logging
+ *
+ * With CFG_LOGGER_TOKENIZED the LOG_* macros no longer format text on the
+ * target. The format string is placed in the `logtok` section and only its
+ * offset in that section (the token) is stored, together with the raw
+ * arguments, in a binary ring. The text is rebuilt on the host from the ELF
+ * (see scripts/process_memlog.go).
+ *
+ * Record layout (32bit words, little endian):
+ *   word 0   : token[31:16] | level[15:12] | nargs[11:8] | seq[7:0]
+ *   word 1.. : arguments, each cast to 32bit
+ * A header word of LOGGER_TOK_PAD means: skip to the end of the ring.
+ *
+ * Only integer and pointer arguments are supported. A '%s' argument stores the
+ * pointer, the host can only resolve strings which live in the image.
+ *
+ * @version v0.1
+ * @date 2022-09-19
+ */
+
+#ifndef _LOGGER_TOK_H_
+#define _LOGGER_TOK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "logger.h"
+
+#define LOGGER_TOK_MAGIC        0x4B4F544CU     //!< "LTOK"
+#define LOGGER_TOK_PAD          0xFFFFFFFFU     //!< Pad record, wrap to start
+#define LOGGER_TOK_INVALID      0xFFFEU         //!< Token out of 16bit range
+#define LOGGER_TOK_MAX_ARGS     12              //!< Max arguments per record
+
+/** Level id's, same order as _log_levels[] */
+#define LOGGER_TOK_LVL_DEBUG    0
+#define LOGGER_TOK_LVL_INFO     1
+#define LOGGER_TOK_LVL_OK       2
+#define LOGGER_TOK_LVL_WARN     3
+#define LOGGER_TOK_LVL_ERROR    4
+#define LOGGER_TOK_LVL_RAW      5
+
+/** Ring header, the records follow directly after it */
+struct logger_tok_ring_t {
+	uint32_t	magic;          //!< LOGGER_TOK_MAGIC when initialized
+	uint32_t	size;           //!< Size of the record area in bytes
+	uint32_t	rd;             //!< Offset of the oldest record
+	uint32_t	wr;             //!< Offset of the next record
+	uint32_t	used;           //!< Bytes in use (records + padding)
+	uint32_t	count;          //!< Number of records written
+	uint32_t	evicted;        //!< Number of records overwritten
+	uint32_t	reserved;       //!< Keep header 8byte aligned
+	uint32_t	data[];         //!< Record area
+};
+
+/** Start of the format string section, provided by the linker (weak: none without tokens) */
+extern const char __start_logtok[] __attribute__((weak));
+
+/**
+ * @brief  Attach the tokenized logger to a memory region
+ *
+ * @param mem Start of the region (4 byte aligned)
+ * @param len Length of the region in bytes
+ * @param wipe Start a new log, otherwise continue a valid log in the region
+ *
+ * @returns -1 if the region is too small, otherwise 0
+ */
+int logger_tok_init(void *mem, size_t len, bool wipe);
+
+/**
+ * @brief  Get the attached ring, NULL if not initialized
+ */
+struct logger_tok_ring_t *logger_tok_ring(void);
+
+/**
+ * @brief  Store one record, safe to call from interrupt context
+ *
+ * @param lvl Level id (LOGGER_TOK_LVL_*)
+ * @param fmt Format string in the logtok section
+ * @param args Arguments
+ * @param nargs Number of arguments
+ */
+void logger_tok_write(const int lvl, const char *fmt, const uint32_t *args, uint32_t nargs);
+
+/* Argument counting and casting helpers, up to LOGGER_TOK_MAX_ARGS */
+#define _LOGGER_TOK_CAT_(a, b) a ## b
+#define _LOGGER_TOK_CAT(a, b) _LOGGER_TOK_CAT_(a, b)
+#define _LOGGER_TOK_CNT(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, N, ...) N
+#define _LOGGER_TOK_NARGS(...) \
+	_LOGGER_TOK_CNT(__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+#define _LOGGER_TOK_A(x) (uint32_t)(uintptr_t)(x)
+#define _LOGGER_TOK_MAP_0(...)
+#define _LOGGER_TOK_MAP_1(a) _LOGGER_TOK_A(a)
+#define _LOGGER_TOK_MAP_2(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_1(__VA_ARGS__)
+#define _LOGGER_TOK_MAP_3(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_2(__VA_ARGS__)
+#define _LOGGER_TOK_MAP_4(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_3(__VA_ARGS__)
+#define _LOGGER_TOK_MAP_5(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_4(__VA_ARGS__)
+#define _LOGGER_TOK_MAP_6(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_5(__VA_ARGS__)
+#define _LOGGER_TOK_MAP_7(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_6(__VA_ARGS__)
+#define _LOGGER_TOK_MAP_8(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_7(__VA_ARGS__)
+#define _LOGGER_TOK_MAP_9(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_8(__VA_ARGS__)
+#define _LOGGER_TOK_MAP_10(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_9(__VA_ARGS__)
+#define _LOGGER_TOK_MAP_11(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_10(__VA_ARGS__)
+#define _LOGGER_TOK_MAP_12(a, ...) _LOGGER_TOK_A(a), _LOGGER_TOK_MAP_11(__VA_ARGS__)
+
+/**
+ * @brief  Log a record, the format string never leaves the logtok section
+ *
+ * A (void) statement expression, so LOG_* can still be used as expression.
+ */
+#define LOGGER_TOK_LOG(lvl, msg, ...) \
+	({ \
+		static const char _logger_tok_fmt[] \
+		__attribute__((section("logtok"), used)) = msg; \
+		const uint32_t _logger_tok_args[] = { \
+			0, _LOGGER_TOK_CAT(_LOGGER_TOK_MAP_, \
+					   _LOGGER_TOK_NARGS(0, ## __VA_ARGS__))(__VA_ARGS__) \
+		}; \
+		logger_tok_write(lvl, _logger_tok_fmt, &_logger_tok_args[1], \
+				 _LOGGER_TOK_NARGS(0, ## __VA_ARGS__)); \
+	})
+
+/**
+ * @brief  Tokenized log if the level is compiled in (LOGGER_COMPILE_LVL)
+ */
+#define _LOGGER_TOK(mask, lvl, msg, ...) \
+	(LOGGER_LVL_COMPILED(mask) ? LOGGER_TOK_LOG(lvl, msg, ## __VA_ARGS__) : (void)0)
+
+#if defined(CFG_LOGGER_TOKENIZED)
+#undef LOG_DEBUG
+#undef LOG_INFO
+#undef LOG_OK
+#undef LOG_WARN
+#undef LOG_ERROR
+#undef LOG_RAW
+
+#define LOG_DEBUG(msg, ...) _LOGGER_TOK(LOG_LVL_DEBUG, LOGGER_TOK_LVL_DEBUG, msg, ## __VA_ARGS__)
+#define LOG_INFO(msg, ...)  _LOGGER_TOK(LOG_LVL_INFO, LOGGER_TOK_LVL_INFO, msg, ## __VA_ARGS__)
+#define LOG_OK(msg, ...)    _LOGGER_TOK(LOG_LVL_OK, LOGGER_TOK_LVL_OK, msg, ## __VA_ARGS__)
+#define LOG_WARN(msg, ...)  _LOGGER_TOK(LOG_LVL_WARN, LOGGER_TOK_LVL_WARN, msg, ## __VA_ARGS__)
+#define LOG_ERROR(msg, ...) _LOGGER_TOK(LOG_LVL_ERROR, LOGGER_TOK_LVL_ERROR, msg, ## __VA_ARGS__)
+#define LOG_RAW(msg, ...)   _LOGGER_TOK(LOG_LVL_RAW, LOGGER_TOK_LVL_RAW, msg, ## __VA_ARGS__)
+#endif /* CFG_LOGGER_TOKENIZED */
+
+#endif /* _LOGGER_TOK_H_ */
@@ -43,6 +43,28 @@
 /** Max string length */
 #define MAX_STR_LEN 256
 
+/** Max number of drivers in adrivers[] */
+#define LOGGER_MAX_DRIVERS 8
+
+/**
+ * Levels compiled in. LOG_* calls of other levels produce no code at all,
+ * e.g. -DLOGGER_COMPILE_LVL=LOG_LVL_PRODUCTION drops all debug and info logs.
+ */
+#ifndef LOGGER_COMPILE_LVL
+#define LOGGER_COMPILE_LVL LOG_LVL_EXTRA
+#endif
+
+/** Is the level compiled in (constant expression) */
+#define LOGGER_LVL_COMPILED(lvl) (((LOGGER_COMPILE_LVL) & (lvl)) != 0)
+
+/** Basename of the current file, resolved at compile time */
+#if defined(__FILE_NAME__)
+#define LOGGER_FILE __FILE_NAME__
+#else
+#define LOGGER_FILE (__builtin_strrchr(__FILE__, '/') ? \
+		     __builtin_strrchr(__FILE__, '/') + 1 : __FILE__)
+#endif
+
 struct line_info_t {
 	const int	lvl;    //!< Log level
 	const char *	file;   //!< File string
@@ -80,6 +102,7 @@ struct logger_driver_t {
 	char				name[LOGGER_DRV_NAME];  //!< Driver name
 	const struct logger_ops_t *	ops;                    //!< Logger operations
 	void *				priv_data;              //!< private driver data
+	int				levels;                 //!< Levels written to this driver, 0: all
 };
 
 /** brief  Log level definition */
@@ -131,8 +154,10 @@ void logger_close();
 /**
  * @brief  Write to the logger(s)
  *
+ * Only the drivers interested in the level (driver levels) are called.
+ *
  * @param lvl Log level
- * @param file Current file name
+ * @param file Current file name (basename)
  * @param fn Current function name
  * @param ln Current line number
  * @param fmt string va format
@@ -140,28 +165,23 @@ void logger_close();
  */
 void logger_log(const int lvl, const char *file, const char *fn, const int ln, char *fmt, ...);
 
-#define LOG_DEBUG(msg, ...) \
-	logger_log(LOG_LVL_DEBUG, __FILE__, __FUNCTION__, __LINE__, msg, \
-		   ## __VA_ARGS__)
-
-#define LOG_INFO(msg, ...) \
-	logger_log(LOG_LVL_INFO, __FILE__, __FUNCTION__, __LINE__, msg, \
-		   ## __VA_ARGS__)
-
-#define LOG_OK(msg, ...) \
-	logger_log(LOG_LVL_OK, __FILE__, __FUNCTION__, __LINE__, msg, \
-		   ## __VA_ARGS__)
-
-#define LOG_WARN(msg, ...) \
-	logger_log(LOG_LVL_WARN, __FILE__, __FUNCTION__, __LINE__, msg, \
-		   ## __VA_ARGS__)
-
-#define LOG_ERROR(msg, ...) \
-	logger_log(LOG_LVL_ERROR, __FILE__, __FUNCTION__, __LINE__, msg, \
-		   ## __VA_ARGS__)
-
-#define LOG_RAW(msg, ...) \
-	logger_log(LOG_LVL_RAW, __FILE__, __FUNCTION__, __LINE__, msg, \
-		   ## __VA_ARGS__)
+/**
+ * @brief  Log if the level is compiled in, stays an expression (void)
+ */
+#define _LOGGER_LOG(lvl, msg, ...) \
+	(LOGGER_LVL_COMPILED(lvl) ? \
+	 logger_log(lvl, LOGGER_FILE, __FUNCTION__, __LINE__, msg, ## __VA_ARGS__) : \
+	 (void)0)
+
+#define LOG_DEBUG(msg, ...) _LOGGER_LOG(LOG_LVL_DEBUG, msg, ## __VA_ARGS__)
+#define LOG_INFO(msg, ...)  _LOGGER_LOG(LOG_LVL_INFO, msg, ## __VA_ARGS__)
+#define LOG_OK(msg, ...)    _LOGGER_LOG(LOG_LVL_OK, msg, ## __VA_ARGS__)
+#define LOG_WARN(msg, ...)  _LOGGER_LOG(LOG_LVL_WARN, msg, ## __VA_ARGS__)
+#define LOG_ERROR(msg, ...) _LOGGER_LOG(LOG_LVL_ERROR, msg, ## __VA_ARGS__)
+#define LOG_RAW(msg, ...)   _LOGGER_LOG(LOG_LVL_RAW, msg, ## __VA_ARGS__)
+
+#if defined(CFG_LOGGER_TOKENIZED)
+#include "logger-tok.h"
+#endif /* CFG_LOGGER_TOKENIZED */
 
 #endif /* _LOGGER_V3_H_ */
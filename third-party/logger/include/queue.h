@@ -1,6 +1,11 @@
 /**
  * @file   queue.h
  * @brief  Queue implementation
+ *
+ * Fixed-capacity queue of pointers on top of the MPSC ring (ring.h): no heap,
+ * no mutex, push is safe from several threads or interrupts, pop from one
+ * consumer. Storage is provided with QUEUE_DEFINE or queue_init().
+ *
  * @author Bram Vlerick <bram.vlerick@openpixelsystems.org>
  * @date   Mon May 13 15:48:56 2019
  */
@@ -8,35 +13,11 @@
 #ifndef _QUEUE_H_
 #define _QUEUE_H_
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-
-#ifndef CFG_LOGGER_DEEP_EMBEDDED
-#include <pthread.h>
-#endif /* CFG_LOGGER_DEEP_EMBEDDED */
-
-
-#include "logger-wrapper.h"
+#include "ring.h"
 
 /** Typedef for destroy function pointer */
 typedef void (*queue_destroy_t)(void *data);
 
-/* --------------------------------------------------------------------------*/
-/**
- * @brief  Message queue element structure
- * Used to store data in the queue
- */
-/* --------------------------------------------------------------------------*/
-struct queue_elm_t {
-	int			id;     //!< Psuedo unique id for element
-	struct queue_elm_t *	next;   //!< Ptr to next element
-	struct queue_elm_t *	prev;   //!< Ptr to previous element
-	void *			data;   //!< Ptr to actual data
-};
-
-
 /* --------------------------------------------------------------------------*/
 /**
  * @brief  Queue structure
@@ -44,26 +25,43 @@ struct queue_elm_t {
  */
 /* --------------------------------------------------------------------------*/
 struct queue_t {
-	int			n_elements;     //!< Number of elements in the queue
-	struct queue_elm_t *	head;           //!< Ptr to ::queue_elm_t:: that's the head of the queue
-	struct queue_elm_t *	tail;           //!< Ptr to ::queue_elm_t:: that's the tail of the queue
+	struct ring_t		ring;           //!< MPSC ring of void *
 	queue_destroy_t		destroy;        //!< Callback for deleting data
-#ifndef CFG_LOGGER_DEEP_EMBEDDED
-	pthread_mutex_t		mutex;          //!< Mutex to protect the queue
-#endif /* CFG_LOGGER_DEEP_EMBEDDED */
 };
 
 /** Retrieve the size of a given queue */
-#define QUEUE_SIZE(x) (x)->n_elements
+#define QUEUE_SIZE(x) ((int)ring_count(&(x)->ring))
 
 /**
- * @brief Create new queue
+ * @brief  Define a file local queue of 'capacity' (power of 2) pointers
+ */
+#define QUEUE_DEFINE(name, capacity, destroy_fn) \
+	_Static_assert(_RING_POW2(capacity), "queue capacity must be a power of 2"); \
+	static void *name ## _slots[(capacity)]; \
+	static _Atomic uint32_t name ## _seq[(capacity)]; \
+	static struct queue_t name = { \
+		.ring		= { \
+			.buf		= (uint8_t *)name ## _slots, \
+			.seq		= name ## _seq, \
+			.elm_size	= sizeof(void *), \
+			.mask		= (capacity) - 1, \
+		}, \
+		.destroy	= destroy_fn, \
+	}
+
+/**
+ * @brief Initialize a queue on caller provided storage
  *
- * @param destroy Destroy callback called when queue is removed
+ * @param q Queue
+ * @param slots Storage for 'capacity' pointers
+ * @param seq Sequence storage, 'capacity' entries
+ * @param capacity Max number of elements, power of 2
+ * @param destroy Destroy callback called for the data left by queue_destroy()
  *
- * @return
+ * @return -1 if failed otherwise 0
  */
-struct queue_t *queue_create(queue_destroy_t destroy);
+int queue_init(struct queue_t *q, void **slots, _Atomic uint32_t *seq, uint32_t capacity,
+	       queue_destroy_t destroy);
 
 /**
  * @brief Push some data to a queue
@@ -71,7 +69,7 @@ struct queue_t *queue_create(queue_destroy_t destroy);
  * @param q Queue to which the data will be pushed
  * @param data Data that will be stored
  *
- * @return -1 if failed otherwise 0
+ * @return -1 if failed (full) otherwise 0
  */
 int queue_push(struct queue_t *q, void *data);
 
@@ -81,14 +79,14 @@ int queue_push(struct queue_t *q, void *data);
  * @param q Queue from which data will be pop'd
  * @param data Pointer to the address of the stored data
  *
- * @return -1 if failed otherwise 0
+ * @return -1 if failed (empty) otherwise 0
  */
 int queue_pop(struct queue_t *q, void **data);
 
 /**
- * @brief Remove a given queue
+ * @brief Empty a given queue, calling destroy for every element left
  *
- * @param q Queue that will be removed
+ * @param q Queue that will be emptied
  */
 void queue_destroy(struct queue_t *q);
 
@@ -0,0 +1,136 @@
+/**
+ * @file ring.h
+ * @brief Lock-free, allocation-free ring buffer
+ *
+ * Fixed-size elements, power of 2 capacity, head/tail are free running
+ * 32bit counters masked into the buffer.
+ *
+ * - SPSC (ring_push/ring_pop): one producer, one consumer, e.g. superloop and
+ *   one interrupt. Plain load/store with acquire/release ordering.
+ * - MPSC (ring_mpsc_push/ring_mpsc_pop): any number of producers (threads or
+ *   nested interrupts), one consumer. Producers claim a slot with a CAS on
+ *   head, every slot carries a sequence number telling the consumer when its
+ *   element is complete. A producer never waits for another one; an element
+ *   whose producer got interrupted just becomes visible later.
+ *
+ * A ring is used either as SPSC or as MPSC, not both. All-zero is a valid
+ * empty ring so RING_DEFINE/RING_MPSC_DEFINE need no init call.
+ *
+ * @version v0.1
+ * @date 2022-10-05
+ */
+
+#ifndef _RING_H_
+#define _RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#if defined(__ARM_ARCH)
+#define RING_ALIGN                      //!< No cache, keep it small
+#else
+#define RING_ALIGN _Alignas(64)         //!< Keep head/tail off the same cache line
+#endif
+
+/** Ring structure */
+struct ring_t {
+	uint8_t *		buf;            //!< capacity * elm_size bytes
+	_Atomic uint32_t *	seq;            //!< Per slot sequence (MPSC only, else NULL)
+	uint32_t		elm_size;       //!< Element size in bytes
+	uint32_t		mask;           //!< capacity - 1
+	RING_ALIGN _Atomic uint32_t	head;   //!< Next slot to write
+	RING_ALIGN _Atomic uint32_t	tail;   //!< Next slot to read
+};
+
+#define _RING_POW2(c) ((c) > 0 && ((c) & ((c) - 1)) == 0)
+
+/**
+ * @brief  Define a file local SPSC ring of 'capacity' elements of 'type'
+ */
+#define RING_DEFINE(name, type, capacity) \
+	_Static_assert(_RING_POW2(capacity), "ring capacity must be a power of 2"); \
+	static uint8_t name ## _buf[(capacity) * sizeof(type)] __attribute__((aligned(8))); \
+	static struct ring_t name = { \
+		.buf		= name ## _buf, \
+		.seq		= NULL, \
+		.elm_size	= sizeof(type), \
+		.mask		= (capacity) - 1, \
+	}
+
+/**
+ * @brief  Define a file local MPSC ring of 'capacity' elements of 'type'
+ */
+#define RING_MPSC_DEFINE(name, type, capacity) \
+	_Static_assert(_RING_POW2(capacity), "ring capacity must be a power of 2"); \
+	static uint8_t name ## _buf[(capacity) * sizeof(type)] __attribute__((aligned(8))); \
+	static _Atomic uint32_t name ## _seq[(capacity)]; \
+	static struct ring_t name = { \
+		.buf		= name ## _buf, \
+		.seq		= name ## _seq, \
+		.elm_size	= sizeof(type), \
+		.mask		= (capacity) - 1, \
+	}
+
+/**
+ * @brief  Initialize a ring on caller provided storage
+ *
+ * @param r Ring
+ * @param buf Storage, capacity * elm_size bytes
+ * @param seq Sequence storage, capacity entries for MPSC, NULL for SPSC
+ * @param elm_size Element size in bytes
+ * @param capacity Number of elements, power of 2
+ *
+ * @returns -1 if the capacity is not a power of 2, otherwise 0
+ */
+int ring_init(struct ring_t *r, void *buf, _Atomic uint32_t *seq, uint32_t elm_size,
+	      uint32_t capacity);
+
+/**
+ * @brief  Copy an element in (single producer)
+ *
+ * @returns -1 if full, otherwise 0
+ */
+int ring_push(struct ring_t *r, const void *elm);
+
+/**
+ * @brief  Copy the oldest element out (single consumer)
+ *
+ * @returns -1 if empty, otherwise 0
+ */
+int ring_pop(struct ring_t *r, void *elm);
+
+/**
+ * @brief  Copy an element in, any number of producers
+ *
+ * @returns -1 if full, otherwise 0
+ */
+int ring_mpsc_push(struct ring_t *r, const void *elm);
+
+/**
+ * @brief  Copy the oldest complete element out (single consumer)
+ *
+ * @returns -1 if empty (or the oldest element is still being written), otherwise 0
+ */
+int ring_mpsc_pop(struct ring_t *r, void *elm);
+
+/**
+ * @brief  Number of elements in the ring (claimed ones included for MPSC)
+ */
+static inline uint32_t ring_count(struct ring_t *r)
+{
+	/* tail first: head read afterwards is never behind it */
+	uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+	return atomic_load_explicit(&r->head, memory_order_acquire) - tail;
+}
+
+/**
+ * @brief  Capacity of the ring in elements
+ */
+static inline uint32_t ring_capacity(const struct ring_t *r)
+{
+	return r->mask + 1;
+}
+
+#endif /* _RING_H_ */
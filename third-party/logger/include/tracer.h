@@ -1,52 +1,160 @@
 /**
  * @file tracer.h
- * @brief  A simple header only tracer lib
- * @author Bram Vlerick <bram.vlerick@openpixelsystems.org>
- * @version v0.1
- * @date 2020-04-16
+ * @brief  Span and event tracer
+ *
+ * Fixed-size records in a static ring, no heap, safe from interrupts.
+ * Timestamps are DWT cycles on the target (CYCCNT) and nanoseconds natively
+ * (clock_gettime), both 32bit and wrapping; the host unwraps them from the
+ * record order, so keep gaps between records below 2^31 ticks (~14s at
+ * 150MHz).
+ *
+ * Like tokenized logging, names are placed in the `tracetok` section and only
+ * their offset is recorded. scripts/process_trace.go turns a dump of the ring
+ * into Chrome trace / Perfetto JSON.
+ *
+ * Record layout (12 bytes, little endian):
+ *   ts   : timestamp
+ *   name : offset in the tracetok section
+ *   type : TRACER_BEGIN, TRACER_END, TRACER_INSTANT or TRACER_COUNTER
+ *   ctx  : exception number (IPSR), 0 in thread mode; one track per context
+ *   arg  : instant argument or counter value
+ *
+ * The TRACE_* macros only record something when built with CFG_TRACER,
+ * otherwise they compile to nothing.
+ *
+ * @version v0.2
+ * @date 2022-10-06
  */
 
 #ifndef _TRACER_H_
 #define _TRACER_H_
 
 #include <stdint.h>
-#include <stdbool.h>
-#include <stdio.h>
-#include <time.h>
-
-struct time_trace_t {
-	clock_t begin;
-	clock_t end;
-	double	diff;
-	bool	ended;
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define TRACER_MAGIC            0x43525454U     //!< "TTRC"
+#define TRACER_INVALID          0xFFFFU         //!< Name out of 16bit range
+
+#define TRACER_BEGIN            'B'             //!< Span start
+#define TRACER_END              'E'             //!< Span end
+#define TRACER_INSTANT          'i'             //!< Instant event
+#define TRACER_COUNTER          'C'             //!< Counter value
+
+/** One trace record */
+struct tracer_rec_t {
+	uint32_t	ts;             //!< Timestamp, cycles or ns
+	uint16_t	name;           //!< Offset of the name in tracetok
+	uint8_t		type;           //!< TRACER_BEGIN/END/INSTANT/COUNTER
+	uint8_t		ctx;            //!< Exception number, 0: thread mode
+	uint32_t	arg;            //!< Argument / counter value
 };
 
-static inline struct time_trace_t *tracer_setup_time_trace(void)
-{
-	struct time_trace_t *t =
-		(struct time_trace_t *)malloc(sizeof(struct time_trace_t));
+/** Ring header, the records follow directly after it */
+struct tracer_ring_t {
+	uint32_t		magic;          //!< TRACER_MAGIC when initialized
+	uint32_t		clk_hz;         //!< Timestamp ticks per second
+	uint32_t		capacity;       //!< Number of records, power of 2
+	_Atomic uint32_t	head;           //!< Records written, free running
+	struct tracer_rec_t	rec[];          //!< Record area, oldest overwritten
+};
+
+/** Start of the name section, provided by the linker (weak: none without names) */
+extern const char __start_tracetok[] __attribute__((weak));
 
-	if (!t) {
-		return NULL;
-	}
+#if defined(__ARM_ARCH)
+#define _TRACER_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004U)
 
-	t->begin = clock();
-	return t;
+/**
+ * @brief  Current timestamp, DWT cycle counter
+ */
+static inline uint32_t tracer_now(void)
+{
+	return _TRACER_DWT_CYCCNT;
 }
+#else
+/**
+ * @brief  Current timestamp, monotonic nanoseconds (truncated)
+ */
+uint32_t tracer_now(void);
+#endif
+
+/**
+ * @brief  Attach the tracer to a memory region and start a new trace
+ *
+ * On the target the DWT cycle counter gets enabled.
+ *
+ * @param mem Start of the region (4 byte aligned)
+ * @param len Length of the region in bytes
+ * @param clk_hz Timestamp ticks per second (core clock, 1000000000 natively)
+ *
+ * @returns -1 if the region does not hold 16 records, otherwise 0
+ */
+int tracer_init(void *mem, size_t len, uint32_t clk_hz);
+
+/**
+ * @brief  Get the attached ring, NULL if not initialized
+ */
+struct tracer_ring_t *tracer_ring(void);
+
+/**
+ * @brief  Store one record, safe to call from interrupt context
+ *
+ * @param type TRACER_BEGIN/END/INSTANT/COUNTER
+ * @param name Name in the tracetok section
+ * @param arg Argument
+ */
+void tracer_write(uint8_t type, const char *name, uint32_t arg);
 
-static inline void tracer_time_trace_end(struct time_trace_t *t)
+/**
+ * @brief  Resolve a record's name, NULL if unknown
+ */
+static inline const char *tracer_name(const struct tracer_rec_t *rec)
 {
-	t->end = clock();
-	t->diff = (double)(t->end - t->begin);
-	t->ended = true;
+	return (__start_tracetok && rec->name != TRACER_INVALID) ?
+	       &__start_tracetok[rec->name] : NULL;
 }
 
-static inline void tracer_time_trace_free(struct time_trace_t *t)
+/**
+ * @brief  Record an event, the name never leaves the tracetok section
+ */
+#define TRACER_REC(type, name, arg) \
+	({ \
+		static const char _tracer_name[] \
+		__attribute__((section("tracetok"), used)) = name; \
+		tracer_write(type, _tracer_name, (uint32_t)(arg)); \
+	})
+
+static inline void _tracer_scope_end(const char **name)
 {
-	if (!t->ended) {
-		// WARN user that tracer has not ended
-	}
-	free(t);
+	tracer_write(TRACER_END, *name, 0);
 }
 
+#define _TRACER_CAT_(a, b) a ## b
+#define _TRACER_CAT(a, b) _TRACER_CAT_(a, b)
+
+#if defined(CFG_TRACER)
+#define TRACE_BEGIN(name)          TRACER_REC(TRACER_BEGIN, name, 0)
+#define TRACE_END(name)            TRACER_REC(TRACER_END, name, 0)
+#define TRACE_INSTANT(name, arg)   TRACER_REC(TRACER_INSTANT, name, arg)
+#define TRACE_COUNTER(name, value) TRACER_REC(TRACER_COUNTER, name, value)
+
+/**
+ * @brief  Span until the end of the enclosing block, returns included
+ */
+#define TRACE_SCOPE(name) \
+	static const char _TRACER_CAT(_tracer_scope_, __LINE__)[] \
+	__attribute__((section("tracetok"), used)) = name; \
+	const char *_TRACER_CAT(_tracer_scope_ptr_, __LINE__) \
+	__attribute__((cleanup(_tracer_scope_end))) = \
+		(tracer_write(TRACER_BEGIN, _TRACER_CAT(_tracer_scope_, __LINE__), 0), \
+		 _TRACER_CAT(_tracer_scope_, __LINE__))
+#else
+#define TRACE_BEGIN(name)          ((void)0)
+#define TRACE_END(name)            ((void)0)
+#define TRACE_INSTANT(name, arg)   ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#define TRACE_SCOPE(name)
+#endif /* CFG_TRACER */
+
 #endif /* _TRACER_H_ */
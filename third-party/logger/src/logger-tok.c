@@ -0,0 +1,138 @@
+/**
+ * @file logger-tok.c
+ * @brief Tokenized (deferred) logging ring
+ *
+ * Records are only copied, nothing gets formatted on the target.
+ * When the ring is full the oldest records are evicted.
+ *
+ * @version v0.1
+ * @date 2022-09-19
+ */
+
+#include <string.h>
+
+#include "logger.h"
+#include "logger-tok.h"
+
+static struct logger_tok_ring_t *_ring = NULL;
+
+static const int _tok_masks[] = {
+	LOG_LVL_DEBUG, LOG_LVL_INFO, LOG_LVL_OK, LOG_LVL_WARN, LOG_LVL_ERROR, LOG_LVL_RAW,
+};
+
+#if defined(__ARM_ARCH)
+static inline uint32_t _tok_lock(void)
+{
+	uint32_t primask;
+
+	__asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+	return primask;
+}
+
+static inline void _tok_unlock(uint32_t primask)
+{
+	__asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+#else
+static inline uint32_t _tok_lock(void)
+{
+	return 0;
+}
+
+static inline void _tok_unlock(uint32_t primask)
+{
+	(void)primask;
+}
+#endif
+
+int logger_tok_init(void *mem, size_t len, bool wipe)
+{
+	struct logger_tok_ring_t *ring = (struct logger_tok_ring_t *)mem;
+	uint32_t size = (uint32_t)((len - sizeof(*ring)) & ~3U);
+
+	if (!mem || len < sizeof(*ring) + 64) {
+		return -1;
+	}
+
+	if (wipe || ring->magic != LOGGER_TOK_MAGIC || ring->size != size ||
+	    ring->rd >= size || ring->wr >= size || ring->used > size) {
+		ring->magic = 0;
+		ring->size = size;
+		ring->rd = 0;
+		ring->wr = 0;
+		ring->used = 0;
+		ring->count = 0;
+		ring->evicted = 0;
+		ring->reserved = 0;
+		ring->magic = LOGGER_TOK_MAGIC;
+	}
+
+	_ring = ring;
+	return 0;
+}
+
+struct logger_tok_ring_t *logger_tok_ring(void)
+{
+	return _ring;
+}
+
+/**
+ * @brief  Evict the oldest records until 'len' bytes are free
+ */
+static void _tok_make_room(struct logger_tok_ring_t *ring, uint32_t len)
+{
+	while (ring->size - ring->used < len) {
+		uint32_t hdr = ring->data[ring->rd / sizeof(uint32_t)];
+		uint32_t rlen;
+
+		if (hdr == LOGGER_TOK_PAD) {
+			rlen = ring->size - ring->rd;
+		} else {
+			rlen = (uint32_t)(sizeof(uint32_t) * (1 + ((hdr >> 8) & 0xF)));
+			ring->evicted++;
+		}
+		ring->rd = (ring->rd + rlen) % ring->size;
+		ring->used -= rlen;
+	}
+}
+
+void logger_tok_write(const int lvl, const char *fmt, const uint32_t *args, uint32_t nargs)
+{
+	struct logger_tok_ring_t *ring = _ring;
+
+	if (!ring || !(_tok_masks[lvl] & logger_get_loglvl())) {
+		return;
+	}
+
+	if (nargs > LOGGER_TOK_MAX_ARGS) {
+		nargs = LOGGER_TOK_MAX_ARGS;
+	}
+
+	uintptr_t offset = (uintptr_t)(fmt - __start_logtok);
+	uint32_t token = (offset < LOGGER_TOK_INVALID) ? (uint32_t)offset : LOGGER_TOK_INVALID;
+	uint32_t len = (uint32_t)(sizeof(uint32_t) * (1 + nargs));
+
+	uint32_t primask = _tok_lock();
+
+	if (ring->wr + len > ring->size) {
+		/* Not enough room at the end, pad and restart at the beginning */
+		uint32_t pad = ring->size - ring->wr;
+		_tok_make_room(ring, pad);
+		ring->data[ring->wr / sizeof(uint32_t)] = LOGGER_TOK_PAD;
+		ring->used += pad;
+		ring->wr = 0;
+	}
+	_tok_make_room(ring, len);
+
+	uint32_t *rec = &ring->data[ring->wr / sizeof(uint32_t)];
+	rec[0] = (token << 16) | ((uint32_t)lvl << 12) | (nargs << 8) | (ring->count & 0xFF);
+	for (uint32_t i = 0; i < nargs; i++) {
+		rec[1 + i] = args[i];
+	}
+
+	ring->wr = (ring->wr + len) % ring->size;
+	ring->used += len;
+	ring->count++;
+
+	_tok_unlock(primask);
+}
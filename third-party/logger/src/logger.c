@@ -6,7 +6,6 @@
  * @date 2020-08-10
  */
 
-#include <string.h>
 
 #include "logger.h"
 
@@ -34,34 +33,54 @@ struct log_level_t _log_levels[] = {
 	{ LOG_LVL_RAW,	 "RAW",	  RESET,   0 },
 };
 
+#define LOG_LVL_COUNT (sizeof(_log_levels) / sizeof(_log_levels[0]))
+
 static int _current_loglvl = LOG_LVL_EXTRA;
 
-const char *_basename(const char *filename)
-{
-	size_t last_index = 0;
+/** Per level (id) the drivers handling it, NULL terminated */
+static struct logger_driver_t *_lvl_drivers[LOG_LVL_COUNT][LOGGER_MAX_DRIVERS + 1];
+static bool _lvl_drivers_ready = false;
 
-	for (size_t i = 0; i < strlen(filename); i++) {
-		if (filename[i] == '/') {
-			last_index = i;
-		}
+int logger_mask2id(int mask)
+{
+	if (!mask) {
+		return 0;
 	}
-	return &filename[last_index + 1];
+
+	/* DEBUG..ERROR are bit 0..4, RAW is last */
+	int id = __builtin_ctz((unsigned int)mask);
+
+	return (id < (int)LOG_LVL_COUNT - 1) ? id : (int)LOG_LVL_COUNT - 1;
 }
 
-int logger_mask2id(int mask)
+/**
+ * @brief  Sort the drivers per level so a log call only visits interested ones
+ */
+static void _build_lvl_drivers(void)
 {
-	int n = 1;
-	int i = 0;
+	for (size_t id = 0; id < LOG_LVL_COUNT; id++) {
+		size_t n = 0;
+
+		for (int i = 0; adrivers[i] != NULL && n < LOGGER_MAX_DRIVERS; i++) {
+			const struct logger_driver_t *drv = adrivers[i];
 
-	while (!(mask & n)) {
-		n = n << 1;
-		i++;
+			if (!drv->ops || (!drv->ops->write && !drv->ops->flush)) {
+				continue;
+			}
+			if (drv->levels && !(drv->levels & _log_levels[id].mask)) {
+				continue;
+			}
+			_lvl_drivers[id][n++] = adrivers[i];
+		}
+		_lvl_drivers[id][n] = NULL;
 	}
-	return i;
+	_lvl_drivers_ready = true;
 }
 
 inline int logger_init()
 {
+	_build_lvl_drivers();
+
 	for (int i = 0; adrivers[i] != NULL; i++) {
 		if (adrivers[i]->enabled && adrivers[i]->ops) {
 			if (adrivers[i]->ops->init) {
@@ -92,34 +111,42 @@ void logger_log(const int lvl, const char *file, const char *fn, const int ln,
 {
 	va_list va;
 
+	if (!(lvl & _current_loglvl)) {
+		return;
+	}
+
+	if (!_lvl_drivers_ready) {
+		_build_lvl_drivers(); // logger_init() not called (native tools/tests)
+	}
+
+	int id = logger_mask2id(lvl);
 	struct line_info_t linfo = {
 		.lvl	= lvl,
-		.file	= _basename(file),
+		.file	= file,
 		.fn	= fn,
 		.ln	= ln,
 	};
 
-	if (!(lvl & _current_loglvl)) {
-		return;
-	}
-
 	va_start(va, fmt);
-	for (int i = 0; adrivers[i] != NULL; i++) {
-		if (adrivers[i]->enabled && adrivers[i]->ops) {
-			if (adrivers[i]->ops->write) {
-				adrivers[i]->ops->write(
-					(void *)adrivers[i],
-					&linfo, fmt, &va);
-			}
-			if (adrivers[i]->ops->flush) {
-				adrivers[i]->ops->flush(
-					(void *)adrivers[i]);
-			}
+	for (struct logger_driver_t **drv = _lvl_drivers[id]; *drv != NULL; drv++) {
+		if (!(*drv)->enabled) {
+			continue;
+		}
+		if ((*drv)->ops->write) {
+			va_list vc;
+
+			/* each driver consumes its own copy (va_list is an array on x86_64) */
+			va_copy(vc, va);
+			(*drv)->ops->write((void *)*drv, &linfo, fmt, &vc);
+			va_end(vc);
+		}
+		if ((*drv)->ops->flush) {
+			(*drv)->ops->flush((void *)*drv);
 		}
 	}
 	va_end(va);
 
-	_log_levels[logger_mask2id(lvl)].counter++;
+	_log_levels[id].counter++;
 }
 
 void logger_close()
@@ -0,0 +1,120 @@
+/**
+ * @file ring.c
+ * @brief Lock-free, allocation-free ring buffer
+ *
+ * MPSC follows the bounded queue of D. Vyukov: slot i holds sequence 'pos'
+ * when free for the producer of position pos, 'pos + 1' once that producer
+ * is done and 'pos + capacity' once consumed. The stored value is offset by
+ * the slot index so an all-zero ring is valid.
+ *
+ * @version v0.1
+ * @date 2022-10-05
+ */
+
+#include <string.h>
+
+#include "ring.h"
+
+static inline uint8_t *_slot(struct ring_t *r, uint32_t pos)
+{
+	return &r->buf[(pos & r->mask) * r->elm_size];
+}
+
+static inline uint32_t _seq_load(struct ring_t *r, uint32_t pos)
+{
+	return atomic_load_explicit(&r->seq[pos & r->mask], memory_order_acquire) +
+	       (pos & r->mask);
+}
+
+static inline void _seq_store(struct ring_t *r, uint32_t pos, uint32_t seq)
+{
+	atomic_store_explicit(&r->seq[pos & r->mask], seq - (pos & r->mask),
+			      memory_order_release);
+}
+
+int ring_init(struct ring_t *r, void *buf, _Atomic uint32_t *seq, uint32_t elm_size,
+	      uint32_t capacity)
+{
+	if (!r || !buf || !elm_size || !_RING_POW2(capacity)) {
+		return -1;
+	}
+
+	r->buf = (uint8_t *)buf;
+	r->seq = seq;
+	r->elm_size = elm_size;
+	r->mask = capacity - 1;
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+	for (uint32_t i = 0; seq && i < capacity; i++) {
+		atomic_init(&seq[i], 0);
+	}
+	return 0;
+}
+
+int ring_push(struct ring_t *r, const void *elm)
+{
+	uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+	if (head - tail > r->mask) {
+		return -1;
+	}
+
+	memcpy(_slot(r, head), elm, r->elm_size);
+	atomic_store_explicit(&r->head, head + 1, memory_order_release);
+	return 0;
+}
+
+int ring_pop(struct ring_t *r, void *elm)
+{
+	uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+
+	if (head == tail) {
+		return -1;
+	}
+
+	memcpy(elm, _slot(r, tail), r->elm_size);
+	atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+	return 0;
+}
+
+int ring_mpsc_push(struct ring_t *r, const void *elm)
+{
+	uint32_t pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+	for (;;) {
+		int32_t diff = (int32_t)(_seq_load(r, pos) - pos);
+
+		if (diff == 0) {
+			/* slot free for this lap, claim it */
+			if (atomic_compare_exchange_weak_explicit(&r->head, &pos, pos + 1,
+								  memory_order_relaxed,
+								  memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return -1; /* full: slot not consumed yet since the previous lap */
+		} else {
+			pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+		}
+	}
+
+	memcpy(_slot(r, pos), elm, r->elm_size);
+	_seq_store(r, pos, pos + 1);
+	return 0;
+}
+
+int ring_mpsc_pop(struct ring_t *r, void *elm)
+{
+	uint32_t pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+	if ((int32_t)(_seq_load(r, pos) - (pos + 1)) < 0) {
+		return -1;
+	}
+
+	memcpy(elm, _slot(r, pos), r->elm_size);
+	_seq_store(r, pos, pos + r->mask + 1);
+	atomic_store_explicit(&r->tail, pos + 1, memory_order_release);
+	return 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file tracer.c
+ * @brief  Span and event tracer ring
+ *
+ * A writer claims a record with one atomic increment and fills it in, so
+ * interrupts may nest anywhere. When the ring is full the oldest records are
+ * overwritten (flight recorder), 'head' tells the host how many got lost.
+ *
+ * @version v0.2
+ * @date 2022-10-06
+ */
+
+#if !defined(__ARM_ARCH)
+#define _POSIX_C_SOURCE 199309L // clock_gettime with -std=c11
+#include <time.h>
+#endif
+
+#include "tracer.h"
+
+static struct tracer_ring_t *_ring = NULL;
+
+#if defined(__ARM_ARCH)
+#define _TRACER_DEMCR           (*(volatile uint32_t *)0xE000EDFCU)
+#define _TRACER_DEMCR_TRCENA    (1U << 24)
+#define _TRACER_DWT_CTRL        (*(volatile uint32_t *)0xE0001000U)
+#define _TRACER_DWT_CYCCNTENA   (1U << 0)
+
+static inline void _tracer_clk_enable(void)
+{
+	_TRACER_DEMCR |= _TRACER_DEMCR_TRCENA;
+	_TRACER_DWT_CYCCNT = 0;
+	_TRACER_DWT_CTRL |= _TRACER_DWT_CYCCNTENA;
+}
+
+static inline uint8_t _tracer_ctx(void)
+{
+	uint32_t ipsr;
+
+	__asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+	return (uint8_t)ipsr;
+}
+#else
+uint32_t tracer_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+static inline void _tracer_clk_enable(void)
+{
+}
+
+static inline uint8_t _tracer_ctx(void)
+{
+	return 0;
+}
+#endif
+
+int tracer_init(void *mem, size_t len, uint32_t clk_hz)
+{
+	struct tracer_ring_t *ring = (struct tracer_ring_t *)mem;
+	uint32_t capacity = 16;
+
+	if (!mem || len < sizeof(*ring) + capacity * sizeof(struct tracer_rec_t)) {
+		return -1;
+	}
+
+	while (sizeof(*ring) + 2 * capacity * sizeof(struct tracer_rec_t) <= len) {
+		capacity *= 2;
+	}
+
+	_ring = NULL;
+	ring->magic = 0;
+	ring->clk_hz = clk_hz;
+	ring->capacity = capacity;
+	atomic_store(&ring->head, 0);
+	ring->magic = TRACER_MAGIC;
+
+	_tracer_clk_enable();
+	_ring = ring;
+	return 0;
+}
+
+struct tracer_ring_t *tracer_ring(void)
+{
+	return _ring;
+}
+
+void tracer_write(uint8_t type, const char *name, uint32_t arg)
+{
+	struct tracer_ring_t *ring = _ring;
+
+	if (!ring) {
+		return;
+	}
+
+	uintptr_t offset = (uintptr_t)(name - __start_tracetok);
+	uint32_t idx = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed);
+	struct tracer_rec_t *rec = &ring->rec[idx & (ring->capacity - 1)];
+
+	rec->ts = tracer_now();
+	rec->name = (offset < TRACER_INVALID) ? (uint16_t)offset : TRACER_INVALID;
+	rec->type = type;
+	rec->ctx = _tracer_ctx();
+	rec->arg = arg;
+}